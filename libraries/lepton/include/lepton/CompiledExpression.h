@@ -33,6 +33,7 @@
  * -------------------------------------------------------------------------- */
 
 #include "ExpressionTreeNode.h"
+#include "CompiledExpressionCache.h"
 #include "windowsIncludes.h"
 #include <map>
 #include <set>
@@ -57,7 +58,10 @@ class ParsedExpression;
  * it many times as quickly as possible.  You should treat it as an opaque object; none of the internal representation
  * is visible.
  * 
- * A CompiledExpression is created by calling createCompiledExpression() on a ParsedExpression.
+ * A CompiledExpression is created by calling createCompiledExpression() on a ParsedExpression.  Alternatively, you can
+ * pass a list of ParsedExpressions to the constructor to compile them all into a single program.  This is useful when
+ * several expressions share subexpressions, for example an energy and its derivatives.  Each distinct subexpression is
+ * then evaluated only once, and a single call to evaluate() computes all of them.
  * 
  * WARNING: CompiledExpression is NOT thread safe.  You should never access a CompiledExpression from two threads at
  * the same time.
@@ -67,6 +71,13 @@ class LEPTON_EXPORT CompiledExpression {
 public:
     CompiledExpression();
     CompiledExpression(const CompiledExpression& expression);
+    /**
+     * Create a CompiledExpression that evaluates several expressions at once.  Subexpressions that appear
+     * in more than one of them are only evaluated once.
+     *
+     * @param expressions    the expressions to evaluate.  The results are returned in the same order.
+     */
+    CompiledExpression(const std::vector<ParsedExpression>& expressions);
     ~CompiledExpression();
     CompiledExpression& operator=(const CompiledExpression& expression);
     /**
@@ -84,29 +95,46 @@ public:
      * the value of that variable in one place, and it will be seen by all of them.
      */
     void setVariableLocations(std::map<std::string, double*>& variableLocations);
+    /**
+     * Get the number of expressions that are computed by evaluate().
+     */
+    int getNumResults() const;
     /**
      * Evaluate the expression.  The values of all variables should have been set before calling this.
+     * If this object computes several expressions, the value of the first one is returned.
      */
     double evaluate() const;
+    /**
+     * Evaluate all the expressions.  The values of all variables should have been set before calling this.
+     *
+     * @param results    on exit, this contains the value of each expression.  Its length must be at least
+     *                   getNumResults().
+     */
+    void evaluate(double* results) const;
 private:
     friend class ParsedExpression;
     CompiledExpression(const ParsedExpression& expression);
+    void compileExpressions(const std::vector<ParsedExpression>& expressions);
     void compileExpression(const ExpressionTreeNode& node, std::vector<std::pair<ExpressionTreeNode, int> >& temps);
     int findTempIndex(const ExpressionTreeNode& node, std::vector<std::pair<ExpressionTreeNode, int> >& temps);
+    void evaluateOperations() const;
     std::map<std::string, double*> variablePointers;
     std::vector<std::pair<double*, double*> > variablesToCopy;
     std::vector<std::vector<int> > arguments;
     std::vector<int> target;
+    std::vector<int> resultIndices;
     std::vector<Operation*> operation;
     std::map<std::string, int> variableIndices;
     std::set<std::string> variableNames;
     mutable std::vector<double> workspace;
+    mutable std::vector<double> results;
     mutable std::vector<double> argValues;
     std::map<std::string, double> dummyVariables;
-    double (*jitCode)();
+    double (*jitCode)(void**);
 #ifdef LEPTON_USE_JIT
     void findPowerGroups(std::vector<std::vector<int> >& groups, std::vector<std::vector<int> >& groupPowers, std::vector<int>& stepGroup);
     void generateJitCode();
+    void compileJitCode(CompiledExpressionCache::Entry& entry);
 #if defined(__ARM__) || defined(__ARM64__)
     void generateSingleArgCall(asmjit::a64::Compiler& c, asmjit::arm::Vec& dest, asmjit::arm::Vec& arg, double (*function)(double));
     void generateTwoArgCall(asmjit::a64::Compiler& c, asmjit::arm::Vec& dest, asmjit::arm::Vec& arg1, asmjit::arm::Vec& arg2, double (*function)(double, double));
@@ -115,7 +143,8 @@ private:
     void generateTwoArgCall(asmjit::x86::Compiler& c, asmjit::x86::Xmm& dest, asmjit::x86::Xmm& arg1, asmjit::x86::Xmm& arg2, double (*function)(double, double));
 #endif
     std::vector<double> constants;
-    asmjit::JitRuntime runtime;
+    std::shared_ptr<CompiledExpressionCache::Entry> jitEntry;
+    mutable std::vector<void*> jitBindings;
 #endif
 };
 
@@ -0,0 +1,122 @@
+#ifndef LEPTON_COMPILED_EXPRESSION_CACHE_H_
+#define LEPTON_COMPILED_EXPRESSION_CACHE_H_
+
+/* -------------------------------------------------------------------------- *
+ *                                   Lepton                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the Lepton expression parser originating from              *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "windowsIncludes.h"
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+#ifdef LEPTON_USE_JIT
+#if defined(__ARM__) || defined(__ARM64__)
+#include "asmjit/a64.h"
+#else
+#include "asmjit/x86.h"
+#endif
+#endif
+
+namespace Lepton {
+
+class Operation;
+
+/**
+ * Generating machine code for a CompiledExpression or CompiledVectorExpression is much more expensive than evaluating
+ * it, and many identical expressions are often compiled (for example, when copying expressions or creating many similar
+ * Contexts).  The generated code therefore does not depend on where an expression stores its data, and it is shared
+ * between all expressions with the same operations, variables, and vector width through a process wide cache.  The
+ * cache only holds weak references: code is freed as soon as the last expression using it is deleted.
+ * 
+ * This class provides access to statistics about the cache.  The cache is thread safe, but individual expressions are not.
+ */
+
+class LEPTON_EXPORT CompiledExpressionCache {
+public:
+    /**
+     * Get the number of times code for an expression was found in the cache.
+     */
+    static long long getNumHits();
+    /**
+     * Get the number of times code for an expression was not found in the cache and had to be generated.
+     */
+    static long long getNumMisses();
+    /**
+     * Remove all code from the cache and reset the counters.  Expressions that are currently using cached code keep
+     * a reference to it, so this is always safe to call.
+     */
+    static void clear();
+private:
+    friend class CompiledExpression;
+    friend class CompiledVectorExpression;
+    class Entry;
+    /**
+     * The generated code reads the locations of all data from a table of pointers passed to it as an argument.
+     * These are the positions of the entries in the table.  They are followed by pointers to the variables (in
+     * alphabetical order) and then to the operations (in the order they are evaluated).
+     */
+    enum {ArgumentsBinding = 0, ConstantsBinding = 1, ResultBinding = 2, FirstVariableBinding = 3};
+    /**
+     * Build the key identifying the code for an expression.
+     */
+    static std::string createKey(const std::string& type, const std::vector<Operation*>& operation, const std::vector<std::vector<int> >& arguments,
+            const std::vector<int>& target, const std::vector<int>& results, const std::set<std::string>& variableNames, const std::map<std::string, int>& variableIndices);
+    /**
+     * Look up the code for an expression.  If it is not present, this returns a null pointer.
+     */
+    static std::shared_ptr<Entry> findEntry(const std::string& key);
+    /**
+     * Add newly generated code to the cache.  If another thread has already added code for the same key, that is
+     * returned instead.
+     */
+    static std::shared_ptr<Entry> addEntry(const std::string& key, std::shared_ptr<Entry> entry);
+    static std::map<std::string, std::weak_ptr<Entry> >& getCache();
+};
+
+#ifdef LEPTON_USE_JIT
+/**
+ * An Entry holds the generated code for an expression, along with the constants it reads at run time.
+ */
+class CompiledExpressionCache::Entry {
+public:
+    Entry() : function(NULL) {
+    }
+    asmjit::JitRuntime runtime;
+    void* function;
+    std::vector<double> constants;
+    std::vector<float> vectorConstants;
+};
+#endif
+
+} // namespace Lepton
+
+#endif /*LEPTON_COMPILED_EXPRESSION_CACHE_H_*/
@@ -33,6 +33,7 @@
  * -------------------------------------------------------------------------- */
 
 #include "ExpressionTreeNode.h"
+#include "CompiledExpressionCache.h"
 #include "windowsIncludes.h"
 #include <array>
 #include <map>
@@ -50,6 +51,7 @@
 
 namespace Lepton {
 
+class CustomFunction;
 class Operation;
 class ParsedExpression;
 
@@ -65,6 +67,14 @@ class ParsedExpression;
  * CPU it is running on.  4 is always allowed, and 8 is allowed on x86 processors with AVX.  Call getAllowedWidths() to query
  * the allowed values.
  * 
+ * On x86, exp(), log(), sin(), cos(), erf(), and erfc() are evaluated inline with vectorized polynomial approximations.
+ * All other transcendental functions, including powers with a variable exponent and powers with a non-integer constant
+ * exponent, call the scalar C library function once for each element.  The NEON code generator used on ARM evaluates
+ * nothing inline: every transcendental function calls the C library.
+ * 
+ * You can also pass a list of ParsedExpressions to the constructor to compile them all into a single program.  Subexpressions
+ * they have in common are then evaluated only once, and a single call to evaluate() computes all of them.
+ * 
  * WARNING: CompiledVectorExpression is NOT thread safe.  You should never access a CompiledVectorExpression from two threads at
  * the same time.
  */
@@ -73,6 +83,14 @@ class LEPTON_EXPORT CompiledVectorExpression {
 public:
     CompiledVectorExpression();
     CompiledVectorExpression(const CompiledVectorExpression& expression);
+    /**
+     * Create a CompiledVectorExpression that evaluates several expressions at once.  Subexpressions that appear
+     * in more than one of them are only evaluated once.
+     *
+     * @param expressions    the expressions to evaluate.  The results are returned in the same order.
+     * @param width          the width of the vectors on which to compute the expressions
+     */
+    CompiledVectorExpression(const std::vector<ParsedExpression>& expressions, int width);
     ~CompiledVectorExpression();
     CompiledVectorExpression& operator=(const CompiledVectorExpression& expression);
     /**
@@ -98,10 +116,16 @@ public:
      * be a pointer to N floating point values, where N is the vector width.
      */
     void setVariableLocations(std::map<std::string, float*>& variableLocations);
+    /**
+     * Get the number of expressions that are computed by evaluate().
+     */
+    int getNumResults() const;
     /**
      * Evaluate the expression.  The values of all variables should have been set before calling this.
      * 
-     * @return a pointer to N floating point values, where N is the vector width
+     * @return a pointer to N*M floating point values, where N is the vector width and M is the number of
+     * expressions.  The first N values are the result of the first expression, the next N are the result of
+     * the second one, and so on.
      */
     const float* evaluate() const;
     /**
@@ -111,6 +135,7 @@ public:
 private:
     friend class ParsedExpression;
     CompiledVectorExpression(const ParsedExpression& expression, int width);
+    void compileExpressions(const std::vector<ParsedExpression>& expressions);
     void compileExpression(const ExpressionTreeNode& node, std::vector<std::pair<ExpressionTreeNode, int> >& temps, int& workspaceSize);
     int findTempIndex(const ExpressionTreeNode& node, std::vector<std::pair<ExpressionTreeNode, int> >& temps);
     int width;
@@ -118,25 +143,40 @@ private:
     std::vector<std::pair<float*, float*> > variablesToCopy;
     std::vector<std::vector<int> > arguments;
     std::vector<int> target;
+    std::vector<int> resultIndices;
     std::vector<Operation*> operation;
     std::map<std::string, int> variableIndices;
     std::set<std::string> variableNames;
     mutable std::vector<float> workspace;
+    mutable std::vector<float> results;
     mutable std::vector<double> argValues;
     std::map<std::string, double> dummyVariables;
-    void (*jitCode)();
+    void (*jitCode)(void**);
 #ifdef LEPTON_USE_JIT
     void findPowerGroups(std::vector<std::vector<int> >& groups, std::vector<std::vector<int> >& groupPowers, std::vector<int>& stepGroup);
     void generateJitCode();
+    void compileJitCode(CompiledExpressionCache::Entry& entry);
+    struct SplineTable;
+    void createSplineTables();
+    static std::shared_ptr<SplineTable> createSplineTable(const CustomFunction& function);
 #if defined(__ARM__) || defined(__ARM64__)
     void generateSingleArgCall(asmjit::a64::Compiler& c, asmjit::arm::Vec& dest, asmjit::arm::Vec& arg, float (*function)(float));
     void generateTwoArgCall(asmjit::a64::Compiler& c, asmjit::arm::Vec& dest, asmjit::arm::Vec& arg1, asmjit::arm::Vec& arg2, float (*function)(float, float));
 #else
     void generateSingleArgCall(asmjit::x86::Compiler& c, asmjit::x86::Ymm& dest, asmjit::x86::Ymm& arg, float (*function)(float));
     void generateTwoArgCall(asmjit::x86::Compiler& c, asmjit::x86::Ymm& dest, asmjit::x86::Ymm& arg1, asmjit::x86::Ymm& arg2, float (*function)(float, float));
+    int findConstant(float value);
+    void generateExp(asmjit::x86::Compiler& c, asmjit::x86::Ymm& dest, asmjit::x86::Ymm& arg, std::vector<asmjit::x86::Ymm>& constantVar);
+    void generateLog(asmjit::x86::Compiler& c, asmjit::x86::Ymm& dest, asmjit::x86::Ymm& arg, std::vector<asmjit::x86::Ymm>& constantVar);
+    void generateSinCos(asmjit::x86::Compiler& c, asmjit::x86::Ymm& dest, asmjit::x86::Ymm& arg, std::vector<asmjit::x86::Ymm>& constantVar, bool cosine);
+    void generateErf(asmjit::x86::Compiler& c, asmjit::x86::Ymm& dest, asmjit::x86::Ymm& arg, std::vector<asmjit::x86::Ymm>& constantVar, bool complement);
+    void generateSpline(asmjit::x86::Compiler& c, asmjit::x86::Ymm& dest, asmjit::x86::Gp& table, const SplineTable& spline, const std::vector<int>& derivOrder,
+                        const std::vector<asmjit::x86::Ymm>& args, std::vector<asmjit::x86::Ymm>& constantVar);
 #endif
+    std::vector<std::shared_ptr<SplineTable> > splineTables;
     std::vector<float> constants;
-    asmjit::JitRuntime runtime;
+    std::shared_ptr<CompiledExpressionCache::Entry> jitEntry;
+    mutable std::vector<void*> jitBindings;
 #endif
 };
 
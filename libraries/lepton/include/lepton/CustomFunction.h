@@ -33,6 +33,7 @@
  * -------------------------------------------------------------------------- */
 
 #include "windowsIncludes.h"
+#include <vector>
 
 namespace Lepton {
 
@@ -70,6 +71,22 @@ public:
      * Create a new duplicate of this object on the heap using the "new" operator.
      */
     virtual CustomFunction* clone() const = 0;
+    /**
+     * Some functions, such as interpolating splines, are cubic polynomials in each argument within every cell
+     * of a uniform grid.  CompiledVectorExpression can evaluate such functions much more efficiently if it knows
+     * this.  They should override this method to describe the grid and return true.  The default implementation
+     * returns false.
+     *
+     * @param min        on exit, the lower bound of the grid along each argument
+     * @param max        on exit, the upper bound of the grid along each argument
+     * @param numCells   on exit, the number of cells along each argument
+     * @param periodic   on exit, whether the function is periodic.  If it is not, it must be zero for any argument
+     *                   that is outside the grid.
+     * @return true if the function is a piecewise cubic polynomial on the grid
+     */
+    virtual bool getPiecewiseCubicGrid(std::vector<double>& min, std::vector<double>& max, std::vector<int>& numCells, bool& periodic) const {
+        return false;
+    }
 };
 
 /**
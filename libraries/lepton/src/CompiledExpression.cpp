@@ -44,9 +44,26 @@ CompiledExpression::CompiledExpression() : jitCode(NULL) {
 }
 
 CompiledExpression::CompiledExpression(const ParsedExpression& expression) : jitCode(NULL) {
-    ParsedExpression expr = expression.optimize(); // Just in case it wasn't already optimized.
+    compileExpressions(vector<ParsedExpression>(1, expression));
+}
+
+CompiledExpression::CompiledExpression(const vector<ParsedExpression>& expressions) : jitCode(NULL) {
+    if (expressions.size() == 0)
+        throw Exception("CompiledExpression: At least one expression must be specified");
+    compileExpressions(expressions);
+}
+
+void CompiledExpression::compileExpressions(const vector<ParsedExpression>& expressions) {
+    // All expressions share a single list of temporaries, so any subexpression that appears
+    // in more than one of them is only evaluated once.
+
     vector<pair<ExpressionTreeNode, int> > temps;
-    compileExpression(expr.getRootNode(), temps);
+    for (const ParsedExpression& expression : expressions) {
+        ParsedExpression expr = expression.optimize(); // Just in case it wasn't already optimized.
+        compileExpression(expr.getRootNode(), temps);
+        resultIndices.push_back(temps[findTempIndex(expr.getRootNode(), temps)].second);
+    }
+    results.resize(resultIndices.size());
     int maxArguments = 1;
     for (int i = 0; i < (int) operation.size(); i++)
         if (operation[i]->getNumArguments() > maxArguments)
@@ -70,6 +87,8 @@ CompiledExpression::CompiledExpression(const CompiledExpression& expression) : j
 CompiledExpression& CompiledExpression::operator=(const CompiledExpression& expression) {
     arguments = expression.arguments;
     target = expression.target;
+    resultIndices = expression.resultIndices;
+    results.resize(expression.results.size());
     variableIndices = expression.variableIndices;
     variableNames = expression.variableNames;
     workspace.resize(expression.workspace.size());
@@ -162,9 +181,31 @@ void CompiledExpression::setVariableLocations(map<string, double*>& variableLoca
     }
 }
 
+int CompiledExpression::getNumResults() const {
+    return resultIndices.size();
+}
+
 double CompiledExpression::evaluate() const {
-    if (jitCode)
-        return jitCode();
+    if (jitCode) {
+        jitBindings[CompiledExpressionCache::ResultBinding] = &results[0];
+        return jitCode(&jitBindings[0]);
+    }
+    evaluateOperations();
+    return workspace[resultIndices[0]];
+}
+
+void CompiledExpression::evaluate(double* results) const {
+    if (jitCode) {
+        jitBindings[CompiledExpressionCache::ResultBinding] = results;
+        jitCode(&jitBindings[0]);
+        return;
+    }
+    evaluateOperations();
+    for (int i = 0; i < (int) resultIndices.size(); i++)
+        results[i] = workspace[resultIndices[i]];
+}
+
+void CompiledExpression::evaluateOperations() const {
     for (int i = 0; i < variablesToCopy.size(); i++)
         *variablesToCopy[i].first = *variablesToCopy[i].second;
 
@@ -180,7 +221,6 @@ double CompiledExpression::evaluate() const {
             workspace[target[step]] = operation[step]->evaluate(&argValues[0], dummyVariables);
         }
     }
-    return workspace[workspace.size()-1];
 }
 
 #ifdef LEPTON_USE_JIT
@@ -231,32 +271,62 @@ void CompiledExpression::findPowerGroups(vector<vector<int> >& groups, vector<ve
     }
 }
 
-#if defined(__ARM__) || defined(__ARM64__)
 void CompiledExpression::generateJitCode() {
+    // Identical expressions produce identical code, so look for it in the cache before generating it.
+
+    string key = CompiledExpressionCache::createKey("scalar", operation, arguments, target, resultIndices, variableNames, variableIndices);
+    jitEntry = CompiledExpressionCache::findEntry(key);
+    if (!jitEntry) {
+        shared_ptr<CompiledExpressionCache::Entry> entry = make_shared<CompiledExpressionCache::Entry>();
+        compileJitCode(*entry);
+        jitEntry = CompiledExpressionCache::addEntry(key, entry);
+    }
+    constants = jitEntry->constants;
+    jitCode = (double (*)(void**)) jitEntry->function;
+
+    // Record the locations of all data used by the code.
+
+    jitBindings.resize(CompiledExpressionCache::FirstVariableBinding+variableNames.size()+operation.size());
+    jitBindings[CompiledExpressionCache::ArgumentsBinding] = &argValues[0];
+    jitBindings[CompiledExpressionCache::ConstantsBinding] = (constants.size() > 0 ? &constants[0] : NULL);
+    jitBindings[CompiledExpressionCache::ResultBinding] = &results[0];
+    int binding = CompiledExpressionCache::FirstVariableBinding;
+    for (const string& name : variableNames)
+        jitBindings[binding++] = &getVariableReference(name);
+    for (Operation* op : operation)
+        jitBindings[binding++] = op;
+}
+
+#if defined(__ARM__) || defined(__ARM64__)
+void CompiledExpression::compileJitCode(CompiledExpressionCache::Entry& entry) {
     CodeHolder code;
-    code.init(runtime.environment());
+    code.init(entry.runtime.environment());
     a64::Compiler c(&code);
-    c.addFunc(FuncSignatureT<double>());
+    FuncNode* funcNode = c.addFunc(FuncSignatureT<double, void**>());
+    arm::Gp bindingsPointer = c.newIntPtr();
+    funcNode->setArg(0, bindingsPointer);
     vector<arm::Vec> workspaceVar(workspace.size());
     for (int i = 0; i < (int) workspaceVar.size(); i++)
         workspaceVar[i] = c.newVecD();
     arm::Gp argsPointer = c.newIntPtr();
-    c.mov(argsPointer, imm(&argValues[0]));
+    c.ldr(argsPointer, arm::ptr(bindingsPointer, sizeof(void*)*CompiledExpressionCache::ArgumentsBinding));
     vector<vector<int> > groups, groupPowers;
     vector<int> stepGroup;
     findPowerGroups(groups, groupPowers, stepGroup);
     
     // Load the arguments into variables.
     
+    int variableBinding = CompiledExpressionCache::FirstVariableBinding;
     for (set<string>::const_iterator iter = variableNames.begin(); iter != variableNames.end(); ++iter) {
         map<string, int>::iterator index = variableIndices.find(*iter);
         arm::Gp variablePointer = c.newIntPtr();
-        c.mov(variablePointer, imm(&getVariableReference(index->first)));
+        c.ldr(variablePointer, arm::ptr(bindingsPointer, sizeof(void*)*variableBinding++));
         c.ldr(workspaceVar[index->second], arm::ptr(variablePointer, 0));
     }
 
     // Make a list of all constants that will be needed for evaluation.
-    
+
+    constants.clear();
     vector<int> operationConstantIndex(operation.size(), -1);
     for (int step = 0; step < (int) operation.size(); step++) {
         // Find the constant value (if any) used by this operation.
@@ -302,7 +372,7 @@ void CompiledExpression::generateJitCode() {
     vector<arm::Vec> constantVar(constants.size());
     if (constants.size() > 0) {
         arm::Gp constantsPointer = c.newIntPtr();
-        c.mov(constantsPointer, imm(&constants[0]));
+        c.ldr(constantsPointer, arm::ptr(bindingsPointer, sizeof(void*)*CompiledExpressionCache::ConstantsBinding));
         for (int i = 0; i < (int) constants.size(); i++) {
             constantVar[i] = c.newVecD();
             c.ldr(constantVar[i], arm::ptr(constantsPointer, 8*i));
@@ -481,17 +551,24 @@ void CompiledExpression::generateJitCode() {
                     c.str(workspaceVar[args[i]], arm::ptr(argsPointer, 8*i));
                 arm::Gp fn = c.newIntPtr();
                 c.mov(fn, imm((void*) evaluateOperation));
+                arm::Gp operationPointer = c.newIntPtr();
+                c.ldr(operationPointer, arm::ptr(bindingsPointer, sizeof(void*)*(CompiledExpressionCache::FirstVariableBinding+variableNames.size()+step)));
                 InvokeNode* invoke;
                 c.invoke(&invoke, fn, FuncSignatureT<double, Operation*, double*>());
-                invoke->setArg(0, imm(&op));
-                invoke->setArg(1, imm(&argValues[0]));
+                invoke->setArg(0, operationPointer);
+                invoke->setArg(1, argsPointer);
                 invoke->setRet(0, workspaceVar[target[step]]);
         }
     }
-    c.ret(workspaceVar[workspace.size()-1]);
+    arm::Gp resultPointer = c.newIntPtr();
+    c.ldr(resultPointer, arm::ptr(bindingsPointer, sizeof(void*)*CompiledExpressionCache::ResultBinding));
+    for (int i = 0; i < (int) resultIndices.size(); i++)
+        c.str(workspaceVar[resultIndices[i]], arm::ptr(resultPointer, 8*i));
+    c.ret(workspaceVar[resultIndices[0]]);
     c.endFunc();
     c.finalize();
-    runtime.add(&jitCode, &code);
+    entry.runtime.add(&entry.function, &code);
+    entry.constants = constants;
 }
 
 void CompiledExpression::generateSingleArgCall(a64::Compiler& c, arm::Vec& dest, arm::Vec& arg, double (*function)(double)) {
@@ -513,20 +590,22 @@ void CompiledExpression::generateTwoArgCall(a64::Compiler& c, arm::Vec& dest, ar
     invoke->setRet(0, dest);
 }
 #else
-void CompiledExpression::generateJitCode() {
+void CompiledExpression::compileJitCode(CompiledExpressionCache::Entry& entry) {
     const CpuInfo& cpu = CpuInfo::host();
     if (!cpu.hasFeature(CpuFeatures::X86::kAVX))
         return;
     CodeHolder code;
-    code.init(runtime.environment());
+    code.init(entry.runtime.environment());
     x86::Compiler c(&code);
-    FuncNode* funcNode = c.addFunc(FuncSignatureT<double>());
+    FuncNode* funcNode = c.addFunc(FuncSignatureT<double, void**>());
     funcNode->frame().setAvxEnabled();
+    x86::Gp bindingsPointer = c.newIntPtr();
+    funcNode->setArg(0, bindingsPointer);
     vector<x86::Xmm> workspaceVar(workspace.size());
     for (int i = 0; i < (int) workspaceVar.size(); i++)
         workspaceVar[i] = c.newXmmSd();
     x86::Gp argsPointer = c.newIntPtr();
-    c.mov(argsPointer, imm(&argValues[0]));
+    c.mov(argsPointer, x86::ptr(bindingsPointer, sizeof(void*)*CompiledExpressionCache::ArgumentsBinding));
     vector<vector<int> > groups, groupPowers;
     vector<int> stepGroup;
     findPowerGroups(groups, groupPowers, stepGroup);
@@ -534,14 +613,16 @@ void CompiledExpression::generateJitCode() {
     // Load the arguments into variables.
     
     x86::Gp variablePointer = c.newIntPtr();
+    int variableBinding = CompiledExpressionCache::FirstVariableBinding;
     for (set<string>::const_iterator iter = variableNames.begin(); iter != variableNames.end(); ++iter) {
         map<string, int>::iterator index = variableIndices.find(*iter);
-        c.mov(variablePointer, imm(&getVariableReference(index->first)));
+        c.mov(variablePointer, x86::ptr(bindingsPointer, sizeof(void*)*variableBinding++));
         c.vmovsd(workspaceVar[index->second], x86::ptr(variablePointer, 0, 0));
     }
 
     // Make a list of all constants that will be needed for evaluation.
-    
+
+    constants.clear();
     vector<int> operationConstantIndex(operation.size(), -1);
     for (int step = 0; step < (int) operation.size(); step++) {
         // Find the constant value (if any) used by this operation.
@@ -591,7 +672,7 @@ void CompiledExpression::generateJitCode() {
     vector<x86::Xmm> constantVar(constants.size());
     if (constants.size() > 0) {
         x86::Gp constantsPointer = c.newIntPtr();
-        c.mov(constantsPointer, imm(&constants[0]));
+        c.mov(constantsPointer, x86::ptr(bindingsPointer, sizeof(void*)*CompiledExpressionCache::ConstantsBinding));
         for (int i = 0; i < (int) constants.size(); i++) {
             constantVar[i] = c.newXmmSd();
             c.vmovsd(constantVar[i], x86::ptr(constantsPointer, 8*i, 0));
@@ -777,17 +858,24 @@ void CompiledExpression::generateJitCode() {
                     c.vmovsd(x86::ptr(argsPointer, 8*i, 0), workspaceVar[args[i]]);
                 x86::Gp fn = c.newIntPtr();
                 c.mov(fn, imm((void*) evaluateOperation));
+                x86::Gp operationPointer = c.newIntPtr();
+                c.mov(operationPointer, x86::ptr(bindingsPointer, sizeof(void*)*(CompiledExpressionCache::FirstVariableBinding+variableNames.size()+step)));
                 InvokeNode* invoke;
                 c.invoke(&invoke, fn, FuncSignatureT<double, Operation*, double*>());
-                invoke->setArg(0, imm(&op));
-                invoke->setArg(1, imm(&argValues[0]));
+                invoke->setArg(0, operationPointer);
+                invoke->setArg(1, argsPointer);
                 invoke->setRet(0, workspaceVar[target[step]]);
         }
     }
-    c.ret(workspaceVar[workspace.size()-1]);
+    x86::Gp resultPointer = c.newIntPtr();
+    c.mov(resultPointer, x86::ptr(bindingsPointer, sizeof(void*)*CompiledExpressionCache::ResultBinding));
+    for (int i = 0; i < (int) resultIndices.size(); i++)
+        c.vmovsd(x86::ptr(resultPointer, 8*i, 0), workspaceVar[resultIndices[i]]);
+    c.ret(workspaceVar[resultIndices[0]]);
     c.endFunc();
     c.finalize();
-    runtime.add(&jitCode, &code);
+    entry.runtime.add(&entry.function, &code);
+    entry.constants = constants;
 }
 
 void CompiledExpression::generateSingleArgCall(x86::Compiler& c, x86::Xmm& dest, x86::Xmm& arg, double (*function)(double)) {
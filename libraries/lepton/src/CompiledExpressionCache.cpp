@@ -0,0 +1,141 @@
+/* -------------------------------------------------------------------------- *
+ *                                   Lepton                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the Lepton expression parser originating from              *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "lepton/CompiledExpressionCache.h"
+#include "lepton/Operation.h"
+#include <atomic>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+
+using namespace Lepton;
+using namespace std;
+
+static atomic<long long> numHits(0), numMisses(0);
+
+#ifdef LEPTON_USE_JIT
+static mutex& getCacheLock() {
+    static mutex lock;
+    return lock;
+}
+
+#endif
+
+long long CompiledExpressionCache::getNumHits() {
+    return numHits;
+}
+
+long long CompiledExpressionCache::getNumMisses() {
+    return numMisses;
+}
+
+void CompiledExpressionCache::clear() {
+#ifdef LEPTON_USE_JIT
+    lock_guard<mutex> guard(getCacheLock());
+    getCache().clear();
+#endif
+    numHits = 0;
+    numMisses = 0;
+}
+
+string CompiledExpressionCache::createKey(const string& type, const vector<Operation*>& operation, const vector<vector<int> >& arguments,
+            const vector<int>& target, const vector<int>& results, const set<string>& variableNames, const map<string, int>& variableIndices) {
+    // The generated code depends on the location of each variable in the workspace, and on the sequence of
+    // operations.  Operations that are evaluated by calling back into Lepton (such as custom functions) are
+    // invoked through a pointer supplied at run time, so only their names and argument counts matter.
+
+    stringstream key;
+    key << setprecision(17) << type << ';';
+    for (const string& name : variableNames)
+        key << variableIndices.find(name)->second << ',';
+    key << ';';
+    for (int result : results)
+        key << result << ',';
+    key << ';';
+    for (int step = 0; step < (int) operation.size(); step++) {
+        const Operation& op = *operation[step];
+        key << op.getId() << ' ' << op.getName() << ' ' << op.getNumArguments() << ' ';
+        if (op.getId() == Operation::CONSTANT)
+            key << dynamic_cast<const Operation::Constant&>(op).getValue();
+        else if (op.getId() == Operation::ADD_CONSTANT)
+            key << dynamic_cast<const Operation::AddConstant&>(op).getValue();
+        else if (op.getId() == Operation::MULTIPLY_CONSTANT)
+            key << dynamic_cast<const Operation::MultiplyConstant&>(op).getValue();
+        else if (op.getId() == Operation::POWER_CONSTANT)
+            key << dynamic_cast<const Operation::PowerConstant&>(op).getValue();
+        key << ' ' << target[step] << ':';
+        for (int arg : arguments[step])
+            key << arg << ',';
+        key << ';';
+    }
+    return key.str();
+}
+
+#ifdef LEPTON_USE_JIT
+map<string, weak_ptr<CompiledExpressionCache::Entry> >& CompiledExpressionCache::getCache() {
+    static map<string, weak_ptr<Entry> > cache;
+    return cache;
+}
+
+shared_ptr<CompiledExpressionCache::Entry> CompiledExpressionCache::findEntry(const string& key) {
+    lock_guard<mutex> guard(getCacheLock());
+    map<string, weak_ptr<Entry> >::iterator entry = getCache().find(key);
+    shared_ptr<Entry> code;
+    if (entry != getCache().end())
+        code = entry->second.lock();
+    if (!code) {
+        numMisses++;
+        return shared_ptr<Entry>();
+    }
+    numHits++;
+    return code;
+}
+
+shared_ptr<CompiledExpressionCache::Entry> CompiledExpressionCache::addEntry(const string& key, shared_ptr<Entry> entry) {
+    lock_guard<mutex> guard(getCacheLock());
+    map<string, weak_ptr<Entry> >& cache = getCache();
+    shared_ptr<Entry> existing = cache[key].lock();
+    if (existing)
+        return existing;
+    cache[key] = entry;
+
+    // Remove the keys of code that is no longer used by any expression.  Generating code is far more
+    // expensive than this, so it costs little to do it on every miss.
+
+    for (map<string, weak_ptr<Entry> >::iterator iter = cache.begin(); iter != cache.end(); ) {
+        if (iter->second.expired())
+            iter = cache.erase(iter);
+        else
+            ++iter;
+    }
+    return entry;
+}
+#endif
@@ -33,6 +33,8 @@
 #include "lepton/Operation.h"
 #include "lepton/ParsedExpression.h"
 #include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <utility>
 
 using namespace Lepton;
@@ -45,20 +47,39 @@ CompiledVectorExpression::CompiledVectorExpression() : jitCode(NULL) {
 }
 
 CompiledVectorExpression::CompiledVectorExpression(const ParsedExpression& expression, int width) : jitCode(NULL), width(width) {
+    compileExpressions(vector<ParsedExpression>(1, expression));
+}
+
+CompiledVectorExpression::CompiledVectorExpression(const vector<ParsedExpression>& expressions, int width) : jitCode(NULL), width(width) {
+    if (expressions.size() == 0)
+        throw Exception("CompiledVectorExpression: At least one expression must be specified");
+    compileExpressions(expressions);
+}
+
+void CompiledVectorExpression::compileExpressions(const vector<ParsedExpression>& expressions) {
     const vector<int> allowedWidths = getAllowedWidths();
     if (find(allowedWidths.begin(), allowedWidths.end(), width) == allowedWidths.end())
         throw Exception("Unsupported width for vector expression: "+to_string(width));
-    ParsedExpression expr = expression.optimize(); // Just in case it wasn't already optimized.
+
+    // All expressions share a single list of temporaries, so any subexpression that appears
+    // in more than one of them is only evaluated once.
+
     vector<pair<ExpressionTreeNode, int> > temps;
     int workspaceSize = 0;
-    compileExpression(expr.getRootNode(), temps, workspaceSize);
+    for (const ParsedExpression& expression : expressions) {
+        ParsedExpression expr = expression.optimize(); // Just in case it wasn't already optimized.
+        compileExpression(expr.getRootNode(), temps, workspaceSize);
+        resultIndices.push_back(temps[findTempIndex(expr.getRootNode(), temps)].second);
+    }
     workspace.resize(workspaceSize*width);
+    results.resize(resultIndices.size()*width);
     int maxArguments = 1;
     for (int i = 0; i < (int) operation.size(); i++)
         if (operation[i]->getNumArguments() > maxArguments)
             maxArguments = operation[i]->getNumArguments();
     argValues.resize(maxArguments);
 #ifdef LEPTON_USE_JIT
+    createSplineTables();
     generateJitCode();
 #endif
 }
@@ -77,6 +98,8 @@ CompiledVectorExpression& CompiledVectorExpression::operator=(const CompiledVect
     arguments = expression.arguments;
     width = expression.width;
     target = expression.target;
+    resultIndices = expression.resultIndices;
+    results.resize(expression.results.size());
     variableIndices = expression.variableIndices;
     variableNames = expression.variableNames;
     workspace.resize(expression.workspace.size());
@@ -84,6 +107,9 @@ CompiledVectorExpression& CompiledVectorExpression::operator=(const CompiledVect
     operation.resize(expression.operation.size());
     for (int i = 0; i < (int) operation.size(); i++)
         operation[i] = expression.operation[i]->clone();
+#ifdef LEPTON_USE_JIT
+    splineTables = expression.splineTables;
+#endif
     setVariableLocations(variablePointers);
     return *this;
 }
@@ -186,10 +212,14 @@ void CompiledVectorExpression::setVariableLocations(map<string, float*>& variabl
     }
 }
 
+int CompiledVectorExpression::getNumResults() const {
+    return resultIndices.size();
+}
+
 const float* CompiledVectorExpression::evaluate() const {
     if (jitCode) {
-        jitCode();
-        return &workspace[workspace.size()-width];
+        jitCode(&jitBindings[0]);
+        return &results[0];
     }
     for (int i = 0; i < variablesToCopy.size(); i++)
         for (int j = 0; j < width; j++)
@@ -213,7 +243,10 @@ const float* CompiledVectorExpression::evaluate() const {
             }
         }
     }
-    return &workspace[workspace.size()-width];
+    for (int i = 0; i < (int) resultIndices.size(); i++)
+        for (int j = 0; j < width; j++)
+            results[i*width+j] = workspace[resultIndices[i]*width+j];
+    return &results[0];
 }
 
 #ifdef LEPTON_USE_JIT
@@ -223,6 +256,137 @@ static double evaluateOperation(Operation* op, double* args) {
     return op->evaluate(args, dummyVariables);
 }
 
+/**
+ * The coefficients of a function that is a cubic polynomial in each argument within every cell of a uniform grid.
+ * The generated code reads the pointer and the parameters, so their layout must not change.
+ */
+struct CompiledVectorExpression::SplineTable {
+    enum {MinParameter = 0, ScaleParameter = 1, NumCellsParameter = 2, InvNumCellsParameter = 3, MaxCellParameter = 4};
+    const float* coefficients;
+    float parameters[5][3];
+    std::vector<float> coefficientStorage;
+    int dimensions;
+    bool periodic;
+};
+
+static const int SplineParametersOffset = sizeof(void*);
+
+// Tables larger than this are evaluated by calling the function instead.  It also guarantees that
+// offsets into the table can be computed exactly in single precision.
+
+static const long long MaxSplineCoefficients = 1<<22;
+
+void CompiledVectorExpression::createSplineTables() {
+    splineTables.clear();
+    splineTables.resize(operation.size());
+#if !defined(__ARM__) && !defined(__ARM64__)
+    // Every occurrence of a function (including its derivatives) can share the same table.
+
+    map<string, shared_ptr<SplineTable> > tables;
+    for (int step = 0; step < (int) operation.size(); step++) {
+        if (operation[step]->getId() != Operation::CUSTOM)
+            continue;
+        const Operation::Custom& op = dynamic_cast<const Operation::Custom&>(*operation[step]);
+        if (tables.find(op.getName()) == tables.end())
+            tables[op.getName()] = createSplineTable(op.getFunction());
+        splineTables[step] = tables[op.getName()];
+    }
+#endif
+}
+
+shared_ptr<CompiledVectorExpression::SplineTable> CompiledVectorExpression::createSplineTable(const CustomFunction& function) {
+    vector<double> min, max;
+    vector<int> numCells;
+    bool periodic;
+    if (!function.getPiecewiseCubicGrid(min, max, numCells, periodic))
+        return shared_ptr<SplineTable>();
+    int dimensions = function.getNumArguments();
+    if (dimensions < 1 || dimensions > 3 || min.size() != dimensions || max.size() != dimensions || numCells.size() != dimensions)
+        return shared_ptr<SplineTable>();
+    long long totalCells = 1;
+    for (int axis = 0; axis < dimensions; axis++) {
+        if (numCells[axis] < 1 || !(max[axis] > min[axis]))
+            return shared_ptr<SplineTable>();
+        totalCells *= numCells[axis];
+    }
+    int numCoefficients = 1<<(2*dimensions);
+    if (totalCells*numCoefficients > MaxSplineCoefficients)
+        return shared_ptr<SplineTable>();
+    shared_ptr<SplineTable> table = make_shared<SplineTable>();
+    table->dimensions = dimensions;
+    table->periodic = periodic;
+    for (int axis = 0; axis < 3; axis++) {
+        int cells = (axis < dimensions ? numCells[axis] : 1);
+        table->parameters[SplineTable::MinParameter][axis] = (axis < dimensions ? min[axis] : 0.0);
+        table->parameters[SplineTable::ScaleParameter][axis] = (axis < dimensions ? cells/(max[axis]-min[axis]) : 1.0);
+        table->parameters[SplineTable::NumCellsParameter][axis] = cells;
+        table->parameters[SplineTable::InvNumCellsParameter][axis] = 1.0/cells;
+        table->parameters[SplineTable::MaxCellParameter][axis] = cells-1;
+    }
+
+    // Sample the function at four points along each axis inside every cell, and solve for the coefficients
+    // of the polynomial in the fractional position within the cell.  This is done separately along each axis.
+
+    const double points[] = {0.125, 0.375, 0.625, 0.875};
+    double matrix[4][8];
+    for (int i = 0; i < 4; i++)
+        for (int j = 0; j < 4; j++) {
+            matrix[i][j] = pow(points[i], j);
+            matrix[i][j+4] = (i == j ? 1.0 : 0.0);
+        }
+    for (int i = 0; i < 4; i++) {
+        int pivot = i;
+        for (int j = i+1; j < 4; j++)
+            if (fabs(matrix[j][i]) > fabs(matrix[pivot][i]))
+                pivot = j;
+        for (int k = 0; k < 8; k++)
+            swap(matrix[i][k], matrix[pivot][k]);
+        double scale = 1.0/matrix[i][i];
+        for (int k = 0; k < 8; k++)
+            matrix[i][k] *= scale;
+        for (int j = 0; j < 4; j++)
+            if (j != i) {
+                double factor = matrix[j][i];
+                for (int k = 0; k < 8; k++)
+                    matrix[j][k] -= factor*matrix[i][k];
+            }
+    }
+    table->coefficientStorage.resize(totalCells*numCoefficients);
+    vector<double> samples(numCoefficients), args(dimensions);
+    for (long long cell = 0; cell < totalCells; cell++) {
+        long long index = cell;
+        vector<int> cellIndex(dimensions);
+        for (int axis = 0; axis < dimensions; axis++) {
+            cellIndex[axis] = index%numCells[axis];
+            index /= numCells[axis];
+        }
+        for (int i = 0; i < numCoefficients; i++) {
+            for (int axis = 0; axis < dimensions; axis++)
+                args[axis] = min[axis] + (cellIndex[axis]+points[(i>>(2*axis))&3])*(max[axis]-min[axis])/numCells[axis];
+            samples[i] = function.evaluate(args.data());
+        }
+        for (int axis = 0; axis < dimensions; axis++) {
+            int stride = 1<<(2*axis);
+            for (int i = 0; i < numCoefficients; i++) {
+                if (((i>>(2*axis))&3) != 0)
+                    continue;
+                double transformed[4];
+                for (int j = 0; j < 4; j++) {
+                    transformed[j] = 0.0;
+                    for (int k = 0; k < 4; k++)
+                        transformed[j] += matrix[j][k+4]*samples[i+k*stride];
+                }
+                for (int j = 0; j < 4; j++)
+                    samples[i+j*stride] = transformed[j];
+            }
+        }
+        for (int i = 0; i < numCoefficients; i++)
+            table->coefficientStorage[cell*numCoefficients+i] = (float) samples[i];
+    }
+    table->coefficients = table->coefficientStorage.data();
+    return table;
+}
+
 void CompiledVectorExpression::findPowerGroups(vector<vector<int> >& groups, vector<vector<int> >& groupPowers, vector<int>& stepGroup) {
     // Identify every step that raises an argument to an integer power.
 
@@ -265,18 +429,55 @@ void CompiledVectorExpression::findPowerGroups(vector<vector<int> >& groups, vec
     }
 }
 
+void CompiledVectorExpression::generateJitCode() {
+    // Identical expressions produce identical code, so look for it in the cache before generating it.
+
+    // Functions evaluated from spline tables get their own code.
+
+    string type = "vector"+to_string(width);
+    for (int step = 0; step < (int) operation.size(); step++)
+        if (splineTables[step]) {
+            type += " spline"+to_string(step)+":"+to_string(splineTables[step]->dimensions)+(splineTables[step]->periodic ? "p" : "n");
+            for (int order : dynamic_cast<Operation::Custom*>(operation[step])->getDerivOrder())
+                type += ","+to_string(order);
+        }
+    string key = CompiledExpressionCache::createKey(type, operation, arguments, target, resultIndices, variableNames, variableIndices);
+    jitEntry = CompiledExpressionCache::findEntry(key);
+    if (!jitEntry) {
+        shared_ptr<CompiledExpressionCache::Entry> entry = make_shared<CompiledExpressionCache::Entry>();
+        compileJitCode(*entry);
+        jitEntry = CompiledExpressionCache::addEntry(key, entry);
+    }
+    constants = jitEntry->vectorConstants;
+    jitCode = (void (*)(void**)) jitEntry->function;
+
+    // Record the locations of all data used by the code.
+
+    jitBindings.resize(CompiledExpressionCache::FirstVariableBinding+variableNames.size()+operation.size());
+    jitBindings[CompiledExpressionCache::ArgumentsBinding] = &argValues[0];
+    jitBindings[CompiledExpressionCache::ConstantsBinding] = (constants.size() > 0 ? &constants[0] : NULL);
+    jitBindings[CompiledExpressionCache::ResultBinding] = &results[0];
+    int binding = CompiledExpressionCache::FirstVariableBinding;
+    for (const string& name : variableNames)
+        jitBindings[binding++] = getVariablePointer(name);
+    for (int step = 0; step < (int) operation.size(); step++)
+        jitBindings[binding++] = (splineTables[step] ? (void*) splineTables[step].get() : (void*) operation[step]);
+}
+
 #if defined(__ARM__) || defined(__ARM64__)
 
-void CompiledVectorExpression::generateJitCode() {
+void CompiledVectorExpression::compileJitCode(CompiledExpressionCache::Entry& entry) {
     CodeHolder code;
-    code.init(runtime.environment());
+    code.init(entry.runtime.environment());
     a64::Compiler c(&code);
-    c.addFunc(FuncSignatureT<void>());
+    FuncNode* funcNode = c.addFunc(FuncSignatureT<void, void**>());
+    arm::Gp bindingsPointer = c.newIntPtr();
+    funcNode->setArg(0, bindingsPointer);
     vector<arm::Vec> workspaceVar(workspace.size()/width);
     for (int i = 0; i < (int) workspaceVar.size(); i++)
         workspaceVar[i] = c.newVecQ();
     arm::Gp argsPointer = c.newIntPtr();
-    c.mov(argsPointer, imm(&argValues[0]));
+    c.ldr(argsPointer, arm::ptr(bindingsPointer, sizeof(void*)*CompiledExpressionCache::ArgumentsBinding));
     vector<vector<int> > groups, groupPowers;
     vector<int> stepGroup;
     findPowerGroups(groups, groupPowers, stepGroup);
@@ -284,14 +485,16 @@ void CompiledVectorExpression::generateJitCode() {
     // Load the arguments into variables.
 
     arm::Gp variablePointer = c.newIntPtr();
+    int variableBinding = CompiledExpressionCache::FirstVariableBinding;
     for (set<string>::const_iterator iter = variableNames.begin(); iter != variableNames.end(); ++iter) {
         map<string, int>::iterator index = variableIndices.find(*iter);
-        c.mov(variablePointer, imm(getVariablePointer(index->first)));
+        c.ldr(variablePointer, arm::ptr(bindingsPointer, sizeof(void*)*variableBinding++));
         c.ldr(workspaceVar[index->second].s4(), arm::ptr(variablePointer, 0));
     }
 
     // Make a list of all constants that will be needed for evaluation.
 
+    constants.clear();
     vector<int> operationConstantIndex(operation.size(), -1);
     for (int step = 0; step < (int) operation.size(); step++) {
         // Find the constant value (if any) used by this operation.
@@ -335,9 +538,11 @@ void CompiledVectorExpression::generateJitCode() {
 
     vector<arm::Vec> constantVar(constants.size());
     if (constants.size() > 0) {
+        arm::Gp constantsBase = c.newIntPtr();
         arm::Gp constantsPointer = c.newIntPtr();
+        c.ldr(constantsBase, arm::ptr(bindingsPointer, sizeof(void*)*CompiledExpressionCache::ConstantsBinding));
         for (int i = 0; i < (int) constants.size(); i++) {
-            c.mov(constantsPointer, imm(&constants[i]));
+            c.add(constantsPointer, constantsBase, imm(4*i));
             constantVar[i] = c.newVecQ();
             c.ld1r(constantVar[i].s4(), arm::ptr(constantsPointer));
         }
@@ -521,10 +726,12 @@ void CompiledVectorExpression::generateJitCode() {
                     }
                     arm::Gp fn = c.newIntPtr();
                     c.mov(fn, imm((void*) evaluateOperation));
+                    arm::Gp operationPointer = c.newIntPtr();
+                    c.ldr(operationPointer, arm::ptr(bindingsPointer, sizeof(void*)*(CompiledExpressionCache::FirstVariableBinding+variableNames.size()+step)));
                     InvokeNode* invoke;
                     c.invoke(&invoke, fn, FuncSignatureT<double, Operation*, double*>());
-                    invoke->setArg(0, imm(&op));
-                    invoke->setArg(1, imm(&argValues[0]));
+                    invoke->setArg(0, operationPointer);
+                    invoke->setArg(1, argsPointer);
                     invoke->setRet(0, doubleResultReg);
                     c.fcvt(argReg, doubleResultReg);
                     c.ins(workspaceVar[target[step]].s(element), argReg.s(0));
@@ -532,11 +739,13 @@ void CompiledVectorExpression::generateJitCode() {
         }
     }
     arm::Gp resultPointer = c.newIntPtr();
-    c.mov(resultPointer, imm(&workspace[workspace.size()-width]));
-    c.str(workspaceVar.back().s4(), arm::ptr(resultPointer, 0));
+    c.ldr(resultPointer, arm::ptr(bindingsPointer, sizeof(void*)*CompiledExpressionCache::ResultBinding));
+    for (int i = 0; i < (int) resultIndices.size(); i++)
+        c.str(workspaceVar[resultIndices[i]].s4(), arm::ptr(resultPointer, 4*width*i));
     c.endFunc();
     c.finalize();
-    runtime.add(&jitCode, &code);
+    entry.runtime.add(&entry.function, &code);
+    entry.vectorConstants = constants;
 }
 
 void CompiledVectorExpression::generateSingleArgCall(a64::Compiler& c, arm::Vec& dest, arm::Vec& arg, float (*function)(float)) {
@@ -573,30 +782,87 @@ void CompiledVectorExpression::generateTwoArgCall(a64::Compiler& c, arm::Vec& de
 }
 #else
 
-void CompiledVectorExpression::generateJitCode() {
+// Constants for the inline approximations to exp(), log(), sin(), and cos().  These follow
+// the Cephes single precision algorithms, which are also used in sse_mathfun.h.
+
+static float floatFromBits(int bits) {
+    float value;
+    memcpy(&value, &bits, sizeof(float));
+    return value;
+}
+
+static const float EXP_HI = 88.3762626647949f;
+static const float EXP_LO = -88.3762626647949f;
+static const float LOG2EF = 1.44269504088896341f;
+static const float EXP_C1 = 0.693359375f;
+static const float EXP_C2 = -2.12194440e-4f;
+static const float EXP_P[] = {1.9875691500e-4f, 1.3981999507e-3f, 8.3334519073e-3f, 4.1665795894e-2f, 1.6666665459e-1f, 5.0000001201e-1f};
+static const float SQRTHF = 0.707106781186547524f;
+static const float LOG_P[] = {7.0376836292e-2f, -1.1514610310e-1f, 1.1676998740e-1f, -1.2420140846e-1f, 1.4249322787e-1f,
+                              -1.6668057665e-1f, 2.0000714765e-1f, -2.4999993993e-1f, 3.3333331174e-1f};
+static const float LOG_Q1 = -2.12194440e-4f;
+static const float LOG_Q2 = 0.693359375f;
+static const float FOPI = 1.27323954473516f;
+static const float DP1 = -0.78515625f;
+static const float DP2 = -2.4187564849853515625e-4f;
+static const float DP3 = -3.77489497744594108e-8f;
+static const float SINCOF_P[] = {-1.9515295891e-4f, 8.3321608736e-3f, -1.6666654611e-1f};
+static const float COSCOF_P[] = {2.443315711809948e-5f, -1.388731625493765e-3f, 4.166664568298827e-2f};
+
+// Constants for the inline approximations to erf() and erfc().  erfc() uses the Chebyshev fit from Numerical
+// Recipes, which has a fractional error below 1.2e-7.  erf() of small arguments uses its Taylor series instead,
+// since computing 1-erfc(x) would lose the relative precision.
+
+static const float ERFC_P[] = {-1.26551223f, 1.00002368f, 0.37409196f, 0.09678418f, -0.18628806f,
+                               0.27886807f, -1.13520398f, 1.48851587f, -0.82215223f, 0.17087277f};
+static const float ERF_S[] = {1.1283791670955126f, -0.3761263890318375f, 0.1128379167095513f, -0.02686617064513125f,
+                              0.005223977625442188f, -0.0008548327023450852f, 0.00012055332981789664f};
+
+static vector<float> getMathConstants() {
+    vector<float> values = {EXP_HI, EXP_LO, LOG2EF, EXP_C1, EXP_C2, SQRTHF, LOG_Q1, LOG_Q2, FOPI, DP1, DP2, DP3,
+                            0.0f, 0.125f, 0.25f, 0.5f, 1.0f, 2.0f, 4.0f, 8.0f, 126.0f, 127.0f, 8388608.0f, 1.0f/8388608.0f,
+                            floatFromBits(0x00800000), floatFromBits(0x7f800000), floatFromBits(0x807fffff),
+                            floatFromBits(0x7fffffff), floatFromBits(0x80000000), floatFromBits(0xff800000), floatFromBits(0x7fc00000)};
+    values.insert(values.end(), EXP_P, EXP_P+6);
+    values.insert(values.end(), LOG_P, LOG_P+9);
+    values.insert(values.end(), SINCOF_P, SINCOF_P+3);
+    values.insert(values.end(), COSCOF_P, COSCOF_P+3);
+    return values;
+}
+
+static vector<float> getErfConstants() {
+    vector<float> values(ERFC_P, ERFC_P+10);
+    values.insert(values.end(), ERF_S, ERF_S+7);
+    return values;
+}
+
+void CompiledVectorExpression::compileJitCode(CompiledExpressionCache::Entry& entry) {
     const CpuInfo& cpu = CpuInfo::host();
     if (!cpu.hasFeature(CpuFeatures::X86::kAVX))
         return;
     CodeHolder code;
-    code.init(runtime.environment());
+    code.init(entry.runtime.environment());
     x86::Compiler c(&code);
-    FuncNode* funcNode = c.addFunc(FuncSignatureT<void>());
+    FuncNode* funcNode = c.addFunc(FuncSignatureT<void, void**>());
     funcNode->frame().setAvxEnabled();
+    x86::Gp bindingsPointer = c.newIntPtr();
+    funcNode->setArg(0, bindingsPointer);
     vector<x86::Ymm> workspaceVar(workspace.size()/width);
     for (int i = 0; i < (int) workspaceVar.size(); i++)
         workspaceVar[i] = c.newYmmPs();
     x86::Gp argsPointer = c.newIntPtr();
-    c.mov(argsPointer, imm(&argValues[0]));
+    c.mov(argsPointer, x86::ptr(bindingsPointer, sizeof(void*)*CompiledExpressionCache::ArgumentsBinding));
     vector<vector<int> > groups, groupPowers;
     vector<int> stepGroup;
     findPowerGroups(groups, groupPowers, stepGroup);
 
     // Load the arguments into variables.
 
+    int variableBinding = CompiledExpressionCache::FirstVariableBinding;
     for (set<string>::const_iterator iter = variableNames.begin(); iter != variableNames.end(); ++iter) {
         map<string, int>::iterator index = variableIndices.find(*iter);
         x86::Gp variablePointer = c.newIntPtr();
-        c.mov(variablePointer, imm(getVariablePointer(index->first)));
+        c.mov(variablePointer, x86::ptr(bindingsPointer, sizeof(void*)*variableBinding++));
         if (width == 4)
             c.vmovdqu(workspaceVar[index->second].xmm(), x86::ptr(variablePointer, 0, 0));
         else
@@ -605,6 +871,7 @@ void CompiledVectorExpression::generateJitCode() {
 
     // Make a list of all constants that will be needed for evaluation.
 
+    constants.clear();
     vector<int> operationConstantIndex(operation.size(), -1);
     for (int step = 0; step < (int) operation.size(); step++) {
         // Find the constant value (if any) used by this operation.
@@ -648,12 +915,35 @@ void CompiledVectorExpression::generateJitCode() {
         }
     }
 
+    // Functions that are evaluated inline need additional constants.
+
+    for (int step = 0; step < (int) operation.size(); step++) {
+        int id = operation[step]->getId();
+        if (id == Operation::EXP || id == Operation::LOG || id == Operation::SIN || id == Operation::COS || id == Operation::ERF || id == Operation::ERFC) {
+            for (float value : getMathConstants())
+                findConstant(value);
+            break;
+        }
+    }
+    for (int step = 0; step < (int) operation.size(); step++) {
+        int id = operation[step]->getId();
+        if (id == Operation::ERF || id == Operation::ERFC) {
+            for (float value : getErfConstants())
+                findConstant(value);
+            break;
+        }
+    }
+    for (int step = 0; step < (int) operation.size(); step++)
+        if (splineTables[step])
+            for (float value : {0.0f, 1.0f, 2.0f, 3.0f, 6.0f, (float) (1<<(2*splineTables[step]->dimensions)), floatFromBits(0xffffffff)})
+                findConstant(value);
+
     // Load constants into variables.
 
     vector<x86::Ymm> constantVar(constants.size());
     if (constants.size() > 0) {
         x86::Gp constantsPointer = c.newIntPtr();
-        c.mov(constantsPointer, imm(&constants[0]));
+        c.mov(constantsPointer, x86::ptr(bindingsPointer, sizeof(void*)*CompiledExpressionCache::ConstantsBinding));
         for (int i = 0; i < (int) constants.size(); i++) {
             constantVar[i] = c.newYmmPs();
             c.vbroadcastss(constantVar[i], x86::ptr(constantsPointer, 4*i, 0));
@@ -748,16 +1038,22 @@ void CompiledVectorExpression::generateJitCode() {
                 c.vsqrtps(workspaceVar[target[step]], workspaceVar[args[0]]);
                 break;
             case Operation::EXP:
-                generateSingleArgCall(c, workspaceVar[target[step]], workspaceVar[args[0]], expf);
+                generateExp(c, workspaceVar[target[step]], workspaceVar[args[0]], constantVar);
                 break;
             case Operation::LOG:
-                generateSingleArgCall(c, workspaceVar[target[step]], workspaceVar[args[0]], logf);
+                generateLog(c, workspaceVar[target[step]], workspaceVar[args[0]], constantVar);
                 break;
             case Operation::SIN:
-                generateSingleArgCall(c, workspaceVar[target[step]], workspaceVar[args[0]], sinf);
+                generateSinCos(c, workspaceVar[target[step]], workspaceVar[args[0]], constantVar, false);
                 break;
             case Operation::COS:
-                generateSingleArgCall(c, workspaceVar[target[step]], workspaceVar[args[0]], cosf);
+                generateSinCos(c, workspaceVar[target[step]], workspaceVar[args[0]], constantVar, true);
+                break;
+            case Operation::ERF:
+                generateErf(c, workspaceVar[target[step]], workspaceVar[args[0]], constantVar, false);
+                break;
+            case Operation::ERFC:
+                generateErf(c, workspaceVar[target[step]], workspaceVar[args[0]], constantVar, true);
                 break;
             case Operation::TAN:
                 generateSingleArgCall(c, workspaceVar[target[step]], workspaceVar[args[0]], tanf);
@@ -810,6 +1106,9 @@ void CompiledVectorExpression::generateJitCode() {
                 c.vmulps(workspaceVar[target[step]], workspaceVar[args[0]], constantVar[operationConstantIndex[step]]);
                 break;
             case Operation::POWER_CONSTANT:
+                // Non-integer powers call powf().  Computing them as exp(p*log(x)) magnifies the error in log(x)
+                // by p, so it cannot match powf() over the full range of arguments.
+
                 generateTwoArgCall(c, workspaceVar[target[step]], workspaceVar[args[0]], constantVar[operationConstantIndex[step]], powf);
                 break;
             case Operation::MIN:
@@ -835,6 +1134,17 @@ void CompiledVectorExpression::generateJitCode() {
                 c.vblendvps(workspaceVar[target[step]], workspaceVar[args[1]], workspaceVar[args[2]], mask);
                 break;
             }
+            case Operation::CUSTOM:
+                if (splineTables[step]) {
+                    x86::Gp table = c.newIntPtr();
+                    c.mov(table, x86::ptr(bindingsPointer, sizeof(void*)*(CompiledExpressionCache::FirstVariableBinding+variableNames.size()+step)));
+                    vector<x86::Ymm> splineArgs;
+                    for (int arg : args)
+                        splineArgs.push_back(workspaceVar[arg]);
+                    generateSpline(c, workspaceVar[target[step]], table, *splineTables[step], dynamic_cast<Operation::Custom&>(op).getDerivOrder(), splineArgs, constantVar);
+                    break;
+                }
+                // Functions without a spline table are evaluated with evaluateOperation().
             default:
                 // Just invoke evaluateOperation().
 
@@ -851,10 +1161,12 @@ void CompiledVectorExpression::generateJitCode() {
                     }
                     x86::Gp fn = c.newIntPtr();
                     c.mov(fn, imm((void*) evaluateOperation));
+                    x86::Gp operationPointer = c.newIntPtr();
+                    c.mov(operationPointer, x86::ptr(bindingsPointer, sizeof(void*)*(CompiledExpressionCache::FirstVariableBinding+variableNames.size()+step)));
                     InvokeNode* invoke;
                     c.invoke(&invoke, fn, FuncSignatureT<double, Operation*, double*>());
-                    invoke->setArg(0, imm(&op));
-                    invoke->setArg(1, imm(&argValues[0]));
+                    invoke->setArg(0, operationPointer);
+                    invoke->setArg(1, argsPointer);
                     invoke->setRet(0, doubleResultReg);
                     c.vcvtsd2ss(argReg.xmm(), argReg.xmm(), doubleResultReg.xmm());
                     if (element > 3)
@@ -866,14 +1178,17 @@ void CompiledVectorExpression::generateJitCode() {
         }
     }
     x86::Gp resultPointer = c.newIntPtr();
-    c.mov(resultPointer, imm(&workspace[workspace.size()-width]));
-    if (width == 4)
-        c.vmovdqu(x86::ptr(resultPointer, 0, 0), workspaceVar.back().xmm());
-    else
-        c.vmovdqu(x86::ptr(resultPointer, 0, 0), workspaceVar.back());
+    c.mov(resultPointer, x86::ptr(bindingsPointer, sizeof(void*)*CompiledExpressionCache::ResultBinding));
+    for (int i = 0; i < (int) resultIndices.size(); i++) {
+        if (width == 4)
+            c.vmovdqu(x86::ptr(resultPointer, 4*width*i, 0), workspaceVar[resultIndices[i]].xmm());
+        else
+            c.vmovdqu(x86::ptr(resultPointer, 4*width*i, 0), workspaceVar[resultIndices[i]]);
+    }
     c.endFunc();
     c.finalize();
-    runtime.add(&jitCode, &code);
+    entry.runtime.add(&entry.function, &code);
+    entry.vectorConstants = constants;
 }
 
 void CompiledVectorExpression::generateSingleArgCall(x86::Compiler& c, x86::Ymm& dest, x86::Ymm& arg, float (*function)(float)) {
@@ -929,5 +1244,390 @@ void CompiledVectorExpression::generateTwoArgCall(x86::Compiler& c, x86::Ymm& de
         c.vblendps(dest, dest, d, 1<<element);
     }
 }
+
+int CompiledVectorExpression::findConstant(float value) {
+    // Compare bit patterns, since the masks used by the math functions include NaNs and -0.
+
+    for (int i = 0; i < (int) constants.size(); i++)
+        if (memcmp(&value, &constants[i], sizeof(float)) == 0)
+            return i;
+    constants.push_back(value);
+    return constants.size()-1;
+}
+
+void CompiledVectorExpression::generateExp(x86::Compiler& c, x86::Ymm& dest, x86::Ymm& arg, vector<x86::Ymm>& constantVar) {
+    // Reduce the argument to x = arg - n*log(2), then evaluate a polynomial for exp(x) and
+    // multiply by 2^n.  All steps use only AVX instructions, so 2^n is built by converting
+    // (n+127)*2^23 to an integer, which gives the bit pattern of the result.
+
+    x86::Ymm x = c.newYmmPs();
+    x86::Ymm fx = c.newYmmPs();
+    x86::Ymm y = c.newYmmPs();
+    x86::Ymm z = c.newYmmPs();
+    c.vminps(x, constantVar[findConstant(EXP_HI)], arg);
+    c.vmaxps(x, constantVar[findConstant(EXP_LO)], x);
+    c.vmulps(fx, x, constantVar[findConstant(LOG2EF)]);
+    c.vaddps(fx, fx, constantVar[findConstant(0.5f)]);
+    c.vroundps(fx, fx, imm(1));
+    c.vmulps(z, fx, constantVar[findConstant(EXP_C1)]);
+    c.vsubps(x, x, z);
+    c.vmulps(z, fx, constantVar[findConstant(EXP_C2)]);
+    c.vsubps(x, x, z);
+    c.vmulps(y, x, constantVar[findConstant(EXP_P[0])]);
+    for (int i = 1; i < 6; i++) {
+        c.vaddps(y, y, constantVar[findConstant(EXP_P[i])]);
+        c.vmulps(y, y, x);
+    }
+    c.vmulps(y, y, x);
+    c.vaddps(y, y, x);
+    c.vaddps(y, y, constantVar[findConstant(1.0f)]);
+    c.vaddps(fx, fx, constantVar[findConstant(127.0f)]);
+    c.vmulps(fx, fx, constantVar[findConstant(8388608.0f)]);
+    c.vcvttps2dq(fx, fx);
+    c.vmulps(y, y, fx);
+
+    // Arguments too large to represent the result give infinity.
+
+    c.vcmpps(z, arg, constantVar[findConstant(EXP_HI)], imm(30)); // Comparison mode is _CMP_GT_OQ = 30
+    c.vblendvps(dest, y, constantVar[findConstant(floatFromBits(0x7f800000))], z);
+}
+
+void CompiledVectorExpression::generateLog(x86::Compiler& c, x86::Ymm& dest, x86::Ymm& arg, vector<x86::Ymm>& constantVar) {
+    // Split the argument into an exponent and a mantissa in [sqrt(1/2), sqrt(2)), then
+    // evaluate a polynomial for the log of the mantissa.
+
+    x86::Ymm x = c.newYmmPs();
+    x86::Ymm e = c.newYmmPs();
+    x86::Ymm y = c.newYmmPs();
+    x86::Ymm z = c.newYmmPs();
+    x86::Ymm mask = c.newYmmPs();
+    c.vmaxps(x, constantVar[findConstant(floatFromBits(0x00800000))], arg);
+    c.vandps(e, x, constantVar[findConstant(floatFromBits(0x7f800000))]);
+    c.vcvtdq2ps(e, e);
+    c.vmulps(e, e, constantVar[findConstant(1.0f/8388608.0f)]);
+    c.vsubps(e, e, constantVar[findConstant(126.0f)]);
+    c.vandps(x, x, constantVar[findConstant(floatFromBits(0x807fffff))]);
+    c.vorps(x, x, constantVar[findConstant(0.5f)]);
+    c.vcmpps(mask, x, constantVar[findConstant(SQRTHF)], imm(17)); // Comparison mode is _CMP_LT_OQ = 17
+    c.vandps(y, x, mask);
+    c.vsubps(x, x, constantVar[findConstant(1.0f)]);
+    c.vandps(mask, mask, constantVar[findConstant(1.0f)]);
+    c.vsubps(e, e, mask);
+    c.vaddps(x, x, y);
+    c.vmulps(z, x, x);
+    c.vmulps(y, x, constantVar[findConstant(LOG_P[0])]);
+    for (int i = 1; i < 9; i++) {
+        c.vaddps(y, y, constantVar[findConstant(LOG_P[i])]);
+        c.vmulps(y, y, x);
+    }
+    c.vmulps(y, y, z);
+    c.vmulps(mask, e, constantVar[findConstant(LOG_Q1)]);
+    c.vaddps(y, y, mask);
+    c.vmulps(mask, z, constantVar[findConstant(0.5f)]);
+    c.vsubps(y, y, mask);
+    c.vaddps(x, x, y);
+    c.vmulps(mask, e, constantVar[findConstant(LOG_Q2)]);
+    c.vaddps(x, x, mask);
+
+    // Handle special cases: negative or NaN arguments give NaN, zero gives -infinity, and
+    // infinity gives infinity.
+
+    c.vcmpps(mask, arg, constantVar[findConstant(floatFromBits(0x7f800000))], imm(0)); // Comparison mode is _CMP_EQ_OQ = 0
+    c.vblendvps(x, x, arg, mask);
+    c.vcmpps(mask, arg, constantVar[findConstant(0.0f)], imm(0)); // Comparison mode is _CMP_EQ_OQ = 0
+    c.vblendvps(x, x, constantVar[findConstant(floatFromBits(0xff800000))], mask);
+    c.vcmpps(mask, arg, constantVar[findConstant(0.0f)], imm(25)); // Comparison mode is _CMP_NGE_UQ = 25
+    c.vblendvps(dest, x, constantVar[findConstant(floatFromBits(0x7fc00000))], mask);
+}
+
+void CompiledVectorExpression::generateSinCos(x86::Compiler& c, x86::Ymm& dest, x86::Ymm& arg, vector<x86::Ymm>& constantVar, bool cosine) {
+    // Reduce the argument to the range [-pi/4, pi/4] by subtracting j*pi/4, where j is even.
+    // The octant flags that Cephes extracts from the bits of j are computed here with
+    // floating point operations, since AVX lacks 256 bit integer instructions.
+
+    x86::Ymm x = c.newYmmPs();
+    x86::Ymm y = c.newYmmPs();
+    x86::Ymm j = c.newYmmPs();
+    x86::Ymm sign = c.newYmmPs();
+    x86::Ymm mask = c.newYmmPs();
+    x86::Ymm z = c.newYmmPs();
+    x86::Ymm t = c.newYmmPs();
+    c.vandps(x, arg, constantVar[findConstant(floatFromBits(0x7fffffff))]);
+    c.vmulps(y, x, constantVar[findConstant(FOPI)]);
+    c.vroundps(y, y, imm(1));
+    c.vaddps(y, y, constantVar[findConstant(1.0f)]);
+    c.vmulps(y, y, constantVar[findConstant(0.5f)]);
+    c.vroundps(y, y, imm(1));
+    c.vaddps(y, y, y);
+    if (cosine)
+        c.vsubps(j, y, constantVar[findConstant(2.0f)]);
+    else
+        c.vmovaps(j, y);
+
+    // The sign is flipped when bit 2 of j is set (or clear, for cosine).
+
+    c.vmulps(t, j, constantVar[findConstant(0.125f)]);
+    c.vroundps(t, t, imm(1));
+    c.vmulps(t, t, constantVar[findConstant(8.0f)]);
+    c.vsubps(t, j, t);
+    c.vcmpps(mask, t, constantVar[findConstant(4.0f)], imm(29)); // Comparison mode is _CMP_GE_OQ = 29
+    if (cosine)
+        c.vandnps(sign, mask, constantVar[findConstant(floatFromBits(0x80000000))]);
+    else {
+        c.vandps(sign, arg, constantVar[findConstant(floatFromBits(0x80000000))]);
+        c.vandps(mask, mask, constantVar[findConstant(floatFromBits(0x80000000))]);
+        c.vxorps(sign, sign, mask);
+    }
+
+    // Evaluate both polynomials.
+
+    c.vmulps(t, y, constantVar[findConstant(DP1)]);
+    c.vaddps(x, x, t);
+    c.vmulps(t, y, constantVar[findConstant(DP2)]);
+    c.vaddps(x, x, t);
+    c.vmulps(t, y, constantVar[findConstant(DP3)]);
+    c.vaddps(x, x, t);
+    c.vmulps(z, x, x);
+    c.vmulps(y, z, constantVar[findConstant(COSCOF_P[0])]);
+    c.vaddps(y, y, constantVar[findConstant(COSCOF_P[1])]);
+    c.vmulps(y, y, z);
+    c.vaddps(y, y, constantVar[findConstant(COSCOF_P[2])]);
+    c.vmulps(y, y, z);
+    c.vmulps(y, y, z);
+    c.vmulps(t, z, constantVar[findConstant(0.5f)]);
+    c.vsubps(y, y, t);
+    c.vaddps(y, y, constantVar[findConstant(1.0f)]);
+    c.vmulps(t, z, constantVar[findConstant(SINCOF_P[0])]);
+    c.vaddps(t, t, constantVar[findConstant(SINCOF_P[1])]);
+    c.vmulps(t, t, z);
+    c.vaddps(t, t, constantVar[findConstant(SINCOF_P[2])]);
+    c.vmulps(t, t, z);
+    c.vmulps(t, t, x);
+    c.vaddps(t, t, x);
+
+    // Select the cosine polynomial when bit 1 of j is set, then apply the sign.
+
+    c.vmulps(mask, j, constantVar[findConstant(0.25f)]);
+    c.vroundps(mask, mask, imm(1));
+    c.vmulps(mask, mask, constantVar[findConstant(4.0f)]);
+    c.vsubps(mask, j, mask);
+    c.vcmpps(mask, mask, constantVar[findConstant(2.0f)], imm(29)); // Comparison mode is _CMP_GE_OQ = 29
+    c.vblendvps(y, t, y, mask);
+    c.vxorps(dest, y, sign);
+}
+
+void CompiledVectorExpression::generateErf(x86::Compiler& c, x86::Ymm& dest, x86::Ymm& arg, vector<x86::Ymm>& constantVar, bool complement) {
+    // Compute erfc(|x|) = t*exp(-x^2+P(t)), where t = 1/(1+|x|/2), then use the symmetries
+    // erfc(-x) = 2-erfc(x) and erf(x) = sign(x)*(1-erfc(|x|)).
+
+    x86::Ymm z = c.newYmmPs();
+    x86::Ymm t = c.newYmmPs();
+    x86::Ymm y = c.newYmmPs();
+    x86::Ymm e = c.newYmmPs();
+    x86::Ymm mask = c.newYmmPs();
+    c.vandps(z, arg, constantVar[findConstant(floatFromBits(0x7fffffff))]);
+    c.vmulps(t, z, constantVar[findConstant(0.5f)]);
+    c.vaddps(t, t, constantVar[findConstant(1.0f)]);
+    c.vdivps(t, constantVar[findConstant(1.0f)], t);
+    c.vmulps(y, t, constantVar[findConstant(ERFC_P[9])]);
+    for (int i = 8; i > 0; i--) {
+        c.vaddps(y, y, constantVar[findConstant(ERFC_P[i])]);
+        c.vmulps(y, y, t);
+    }
+    c.vaddps(y, y, constantVar[findConstant(ERFC_P[0])]);
+    c.vmulps(e, z, z);
+    c.vsubps(y, y, e);
+    generateExp(c, e, y, constantVar);
+    c.vmulps(e, e, t);
+    if (complement) {
+        c.vsubps(y, constantVar[findConstant(2.0f)], e);
+        c.vcmpps(mask, arg, constantVar[findConstant(0.0f)], imm(17)); // Comparison mode is _CMP_LT_OQ = 17
+        c.vblendvps(dest, e, y, mask);
+        return;
+    }
+    c.vsubps(e, constantVar[findConstant(1.0f)], e);
+    c.vandps(y, arg, constantVar[findConstant(floatFromBits(0x80000000))]);
+    c.vxorps(e, e, y);
+
+    // Below 0.5, sum the Taylor series instead.
+
+    c.vmulps(t, arg, arg);
+    c.vmulps(y, t, constantVar[findConstant(ERF_S[6])]);
+    for (int i = 5; i > 0; i--) {
+        c.vaddps(y, y, constantVar[findConstant(ERF_S[i])]);
+        c.vmulps(y, y, t);
+    }
+    c.vaddps(y, y, constantVar[findConstant(ERF_S[0])]);
+    c.vmulps(y, y, arg);
+    c.vcmpps(mask, z, constantVar[findConstant(0.5f)], imm(17)); // Comparison mode is _CMP_LT_OQ = 17
+    c.vblendvps(dest, e, y, mask);
+}
+
+void CompiledVectorExpression::generateSpline(x86::Compiler& c, x86::Ymm& dest, x86::Gp& table, const SplineTable& spline, const vector<int>& derivOrder,
+                                              const vector<x86::Ymm>& args, vector<x86::Ymm>& constantVar) {
+    int dimensions = spline.dimensions;
+    int numCoefficients = 1<<(2*dimensions);
+    x86::Ymm zero = constantVar[findConstant(0.0f)];
+    auto parameter = [&] (int type, int axis) {
+        return x86::ptr(table, SplineParametersOffset+4*(3*type+axis), 4);
+    };
+
+    // Find the cell containing the point and the fractional position within it along each axis.  The
+    // index of the cell is accumulated in single precision, which is exact for any table we accept.
+
+    vector<x86::Ymm> fraction(dimensions), scale(dimensions);
+    x86::Ymm cellIndex = c.newYmmPs();
+    x86::Ymm inRange = c.newYmmPs();
+    for (int axis = dimensions-1; axis >= 0; axis--) {
+        x86::Ymm position = c.newYmmPs();
+        x86::Ymm cell = c.newYmmPs();
+        x86::Ymm numCells = c.newYmmPs();
+        x86::Ymm temp = c.newYmmPs();
+        fraction[axis] = c.newYmmPs();
+        scale[axis] = c.newYmmPs();
+        c.vbroadcastss(temp, parameter(SplineTable::MinParameter, axis));
+        c.vsubps(position, args[axis], temp);
+        c.vbroadcastss(scale[axis], parameter(SplineTable::ScaleParameter, axis));
+        c.vmulps(position, position, scale[axis]);
+        c.vbroadcastss(numCells, parameter(SplineTable::NumCellsParameter, axis));
+        if (spline.periodic) {
+            c.vbroadcastss(temp, parameter(SplineTable::InvNumCellsParameter, axis));
+            c.vmulps(temp, position, temp);
+            c.vroundps(temp, temp, imm(1));
+            c.vmulps(temp, temp, numCells);
+            c.vsubps(position, position, temp);
+        }
+        else {
+            x86::Ymm mask = c.newYmmPs();
+            c.vcmpps(temp, position, zero, imm(13)); // Comparison mode is _CMP_GE_OS = 13
+            c.vcmpps(mask, position, numCells, imm(2)); // Comparison mode is _CMP_LE_OS = 2
+            c.vandps(temp, temp, mask);
+            if (axis == dimensions-1)
+                c.vmovaps(inRange, temp);
+            else
+                c.vandps(inRange, inRange, temp);
+        }
+
+        // Clamping also maps NaNs to a valid cell, so the table is never read out of bounds.
+
+        c.vroundps(cell, position, imm(1));
+        c.vmaxps(cell, cell, zero);
+        c.vbroadcastss(temp, parameter(SplineTable::MaxCellParameter, axis));
+        c.vminps(cell, cell, temp);
+        c.vsubps(fraction[axis], position, cell);
+        if (axis == dimensions-1)
+            c.vmovaps(cellIndex, cell);
+        else {
+            c.vmulps(cellIndex, cellIndex, numCells);
+            c.vaddps(cellIndex, cellIndex, cell);
+        }
+    }
+    x86::Ymm offset = c.newYmm();
+    c.vmulps(cellIndex, cellIndex, constantVar[findConstant((float) numCoefficients)]);
+    c.vcvttps2dq(offset, cellIndex);
+    x86::Gp coefficients = c.newIntPtr();
+    c.mov(coefficients, x86::ptr(table, 0));
+
+    // Compute the weight of each power of the fractional position.  After differentiating n times,
+    // the weight of t^i becomes i!/(i-n)! * t^(i-n) * scale^n.
+
+    vector<vector<x86::Ymm> > weight(dimensions, vector<x86::Ymm>(4));
+    vector<vector<bool> > hasWeight(dimensions, vector<bool>(4, false));
+    for (int axis = 0; axis < dimensions; axis++) {
+        vector<x86::Ymm> power(4);
+        power[0] = constantVar[findConstant(1.0f)];
+        power[1] = fraction[axis];
+        power[2] = c.newYmmPs();
+        power[3] = c.newYmmPs();
+        c.vmulps(power[2], fraction[axis], fraction[axis]);
+        c.vmulps(power[3], power[2], fraction[axis]);
+        int order = derivOrder[axis];
+        x86::Ymm scalePower = scale[axis];
+        for (int i = 1; i < order && i < 4; i++) {
+            x86::Ymm product = c.newYmmPs();
+            c.vmulps(product, scalePower, scale[axis]);
+            scalePower = product;
+        }
+        for (int i = order; i < 4; i++) {
+            int factor = 1;
+            for (int j = i-order+1; j <= i; j++)
+                factor *= j;
+            hasWeight[axis][i] = true;
+            if (order == 0)
+                weight[axis][i] = power[i];
+            else {
+                weight[axis][i] = c.newYmmPs();
+                c.vmulps(weight[axis][i], power[i-order], scalePower);
+                if (factor != 1)
+                    c.vmulps(weight[axis][i], weight[axis][i], constantVar[findConstant((float) factor)]);
+            }
+        }
+    }
+
+    // Load the coefficients for the cell and sum the polynomial.  Use gather instructions if they are
+    // available.  Otherwise, load the coefficients for each element separately.
+
+    const CpuInfo& cpu = CpuInfo::host();
+    bool useGather = cpu.hasFeature(CpuFeatures::X86::kAVX2);
+    vector<x86::Gp> elementOffset(width);
+    x86::Mem coefficientStorage;
+    if (!useGather) {
+        x86::Mem offsetStorage = c.newStack(32, 32);
+        coefficientStorage = c.newStack(32, 32);
+        c.vmovdqu(offsetStorage, offset);
+        for (int element = 0; element < width; element++) {
+            elementOffset[element] = c.newIntPtr();
+            x86::Mem elementAddress = offsetStorage.cloneAdjusted(4*element);
+            elementAddress.setSize(4);
+            c.movsxd(elementOffset[element], elementAddress);
+        }
+    }
+    bool hasTerm = false;
+    for (int i = 0; i < numCoefficients; i++) {
+        bool isZero = false;
+        for (int axis = 0; axis < dimensions; axis++)
+            if (!hasWeight[axis][(i>>(2*axis))&3])
+                isZero = true;
+        if (isZero)
+            continue;
+        x86::Ymm coefficient = c.newYmmPs();
+        if (useGather) {
+            x86::Ymm mask = c.newYmm();
+            c.vmovdqu(mask, constantVar[findConstant(floatFromBits(0xffffffff))]);
+            if (width == 4)
+                c.vgatherdps(coefficient.xmm(), x86::ptr(coefficients, offset.xmm(), 2, 4*i), mask.xmm());
+            else
+                c.vgatherdps(coefficient, x86::ptr(coefficients, offset, 2, 4*i), mask);
+        }
+        else {
+            x86::Xmm value = c.newXmmSs();
+            for (int element = 0; element < width; element++) {
+                c.vmovss(value, x86::ptr(coefficients, elementOffset[element], 2, 4*i, 4));
+                x86::Mem elementAddress = coefficientStorage.cloneAdjusted(4*element);
+                elementAddress.setSize(4);
+                c.vmovss(elementAddress, value);
+            }
+            c.vmovups(coefficient, coefficientStorage);
+        }
+        x86::Ymm termWeight = weight[0][i&3];
+        if (dimensions > 1) {
+            termWeight = c.newYmmPs();
+            c.vmulps(termWeight, weight[0][i&3], weight[1][(i>>2)&3]);
+            if (dimensions > 2)
+                c.vmulps(termWeight, termWeight, weight[2][(i>>4)&3]);
+        }
+        if (hasTerm) {
+            c.vmulps(coefficient, coefficient, termWeight);
+            c.vaddps(dest, dest, coefficient);
+        }
+        else
+            c.vmulps(dest, coefficient, termWeight);
+        hasTerm = true;
+    }
+    if (!hasTerm)
+        c.vmovdqu(dest, zero);
+    if (!spline.periodic)
+        c.vandps(dest, dest, inRange);
+}
 #endif
 #endif
@@ -167,6 +167,20 @@ public:
      * @param positions  on exit, this contains the particle positions
      */
     virtual void getPositions(ContextImpl& context, std::vector<Vec3>& positions) = 0;
+    /**
+     * Get the positions of a subset of particles.  The default implementation retrieves the positions
+     * of all particles and selects the requested ones.  Platforms should override it to copy only
+     * the requested particles.
+     *
+     * @param indices    the indices of the particles to get
+     * @param positions  on exit, positions[i] contains the position of particle indices[i]
+     */
+    virtual void getPositions(ContextImpl& context, const std::vector<int>& indices, std::vector<Vec3>& positions) {
+        getPositions(context, allParticleData);
+        positions.resize(indices.size());
+        for (int i = 0; i < indices.size(); i++)
+            positions[i] = allParticleData[indices[i]];
+    }
     /**
      * Set the positions of all particles.
      *
@@ -179,6 +193,20 @@ public:
      * @param velocities  on exit, this contains the particle velocities
      */
     virtual void getVelocities(ContextImpl& context, std::vector<Vec3>& velocities) = 0;
+    /**
+     * Get the velocities of a subset of particles.  The default implementation retrieves the velocities
+     * of all particles and selects the requested ones.  Platforms should override it to copy only
+     * the requested particles.
+     *
+     * @param indices     the indices of the particles to get
+     * @param velocities  on exit, velocities[i] contains the velocity of particle indices[i]
+     */
+    virtual void getVelocities(ContextImpl& context, const std::vector<int>& indices, std::vector<Vec3>& velocities) {
+        getVelocities(context, allParticleData);
+        velocities.resize(indices.size());
+        for (int i = 0; i < indices.size(); i++)
+            velocities[i] = allParticleData[indices[i]];
+    }
     /**
      * Set the velocities of all particles.
      *
@@ -200,6 +228,20 @@ public:
      * @param forces  on exit, this contains the forces
      */
     virtual void getForces(ContextImpl& context, std::vector<Vec3>& forces) = 0;
+    /**
+     * Get the current forces on a subset of particles.  The default implementation retrieves the forces
+     * on all particles and selects the requested ones.  Platforms should override it to copy only
+     * the requested particles.
+     *
+     * @param indices  the indices of the particles to get
+     * @param forces   on exit, forces[i] contains the force on particle indices[i]
+     */
+    virtual void getForces(ContextImpl& context, const std::vector<int>& indices, std::vector<Vec3>& forces) {
+        getForces(context, allParticleData);
+        forces.resize(indices.size());
+        for (int i = 0; i < indices.size(); i++)
+            forces[i] = allParticleData[indices[i]];
+    }
     /**
      * Get the current derivatives of the energy with respect to context parameters.
      *
@@ -234,6 +276,10 @@ public:
      * @param stream    an input stream the checkpoint data should be read from
      */
     virtual void loadCheckpoint(ContextImpl& context, std::istream& stream) = 0;
+private:
+    // The default implementations of the subset methods retrieve data for every particle into this
+    // buffer, which is kept so repeated calls do not need to allocate it again.
+    std::vector<Vec3> allParticleData;
 };
 
 /**
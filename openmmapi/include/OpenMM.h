@@ -34,6 +34,7 @@
 
 #include "openmm/AndersenThermostat.h"
 #include "openmm/BrownianIntegrator.h"
+#include "openmm/CheckpointWriter.h"
 #include "openmm/CMAPTorsionForce.h"
 #include "openmm/CMMotionRemover.h"
 #include "openmm/CompoundIntegrator.h"
@@ -71,6 +72,7 @@
 #include "openmm/State.h"
 #include "openmm/System.h"
 #include "openmm/TabulatedFunction.h"
+#include "openmm/TrajectoryWriter.h"
 #include "openmm/Units.h"
 #include "openmm/VariableLangevinIntegrator.h"
 #include "openmm/VariableVerletIntegrator.h"
@@ -80,6 +82,7 @@
 #include "openmm/NoseHooverChain.h"
 #include "openmm/VirtualSite.h"
 #include "openmm/Platform.h"
+#include "openmm/serialization/BinarySerializer.h"
 #include "openmm/serialization/XmlSerializer.h"
 #include "openmm/ATMForce.h"
 
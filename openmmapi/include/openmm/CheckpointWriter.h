@@ -0,0 +1,147 @@
+#ifndef OPENMM_CHECKPOINTWRITER_H_
+#define OPENMM_CHECKPOINTWRITER_H_
+
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "Context.h"
+#include "internal/windowsExport.h"
+#include <iosfwd>
+#include <memory>
+#include <string>
+
+namespace OpenMM {
+
+/**
+ * A CheckpointWriter creates checkpoints of a Context without making the simulation wait
+ * while they are written.  writeCheckpoint() captures the state of the Context in memory,
+ * which is fast, and then returns.  Encoding the checkpoint and writing it to the output
+ * stream happen on a background thread, so you can continue simulating in the meantime.
+ * Checkpoints are always written in the order they were created.  Because the stream is
+ * written asynchronously, you must not access it (or close it) until waitForCompletion()
+ * has returned.
+ *
+ * The writer can optionally create delta checkpoints.  If fullCheckpointInterval is greater
+ * than 1, only every fullCheckpointInterval'th checkpoint is a full checkpoint.  The others
+ * record only how they differ from the most recent full checkpoint.  How much smaller that makes
+ * them depends on how much the state has changed: low order bits of positions and velocities
+ * cannot be compressed, so the savings are largest when checkpoints are close together.  Full checkpoints are identical to ones created by
+ * Context::createCheckpoint() and can be loaded with Context::loadCheckpoint().  To load a
+ * delta checkpoint, call loadCheckpoint() on this class, passing both the delta checkpoint
+ * and the full checkpoint it was created relative to.
+ *
+ * By default deltas are lossless: loading a delta checkpoint restores exactly the same state as
+ * loading the full checkpoint it was derived from would have.  If you specify a tolerance greater
+ * than 0, delta checkpoints are instead quantized.  They record positions and velocities as integer
+ * multiples of the tolerance relative to the full checkpoint, which makes them much smaller, along
+ * with the time, step count, periodic box vectors, and parameters.  Positions and velocities are
+ * restored to within the tolerance.  Everything else, such as the state of random number generators
+ * and integrator variables, is restored from the full checkpoint, so continuing from a quantized
+ * delta checkpoint does not reproduce the original trajectory.
+ */
+class OPENMM_EXPORT CheckpointWriter {
+public:
+    /**
+     * Create a CheckpointWriter.
+     *
+     * @param context                 the Context to create checkpoints of
+     * @param fullCheckpointInterval  every fullCheckpointInterval'th checkpoint is a full checkpoint,
+     *                                and the others are delta checkpoints.  If this is 1 (the default),
+     *                                every checkpoint is a full checkpoint.
+     * @param tolerance               the maximum error in positions (in nm) and velocities (in nm/ps)
+     *                                stored in delta checkpoints.  If this is 0 (the default), delta
+     *                                checkpoints are lossless.
+     */
+    explicit CheckpointWriter(Context& context, int fullCheckpointInterval=1, double tolerance=0.0);
+    /**
+     * The destructor waits for all pending checkpoints to be written.
+     */
+    ~CheckpointWriter();
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+    /**
+     * Get the interval at which full checkpoints are written.
+     */
+    int getFullCheckpointInterval() const {
+        return fullCheckpointInterval;
+    }
+    /**
+     * Get the maximum error in positions and velocities stored in delta checkpoints.  If this is 0,
+     * delta checkpoints are lossless.
+     */
+    double getTolerance() const {
+        return tolerance;
+    }
+    /**
+     * Capture a checkpoint of the Context and begin writing it to a stream in the background.
+     * The stream must remain valid, and must not be accessed by other code, until
+     * waitForCompletion() has been called.
+     *
+     * @param stream    an output stream the checkpoint data should be written to
+     * @return true if a full checkpoint is being written, false if it is a delta checkpoint
+     */
+    bool writeCheckpoint(std::ostream& stream);
+    /**
+     * Capture a checkpoint of the Context and begin writing it to a file in the background.  The
+     * file is created or overwritten, and is closed once the checkpoint has been written.
+     *
+     * @param filename  the path of the file to write the checkpoint to
+     * @return true if a full checkpoint is being written, false if it is a delta checkpoint
+     */
+    bool writeCheckpoint(const std::string& filename);
+    /**
+     * Block until all checkpoints that have been started with writeCheckpoint() have been written
+     * and flushed.  If an error occurred while writing any of them, this throws an exception.
+     */
+    void waitForCompletion();
+    /**
+     * Load a delta checkpoint that was created by a CheckpointWriter.
+     *
+     * @param context          the Context to load the checkpoint into
+     * @param fullCheckpoint   an input stream containing the full checkpoint the delta checkpoint was
+     *                         created relative to
+     * @param deltaCheckpoint  an input stream containing the delta checkpoint
+     */
+    static void loadCheckpoint(Context& context, std::istream& fullCheckpoint, std::istream& deltaCheckpoint);
+private:
+    class WriterData;
+    bool startCheckpoint(std::ostream* stream, const std::string& filename);
+    Context& context;
+    int fullCheckpointInterval, checkpointsSinceFull;
+    double tolerance;
+    std::shared_ptr<const std::string> reference;
+    std::shared_ptr<const State> referenceState;
+    WriterData* data;
+};
+
+} // namespace OpenMM
+
+#endif /*OPENMM_CHECKPOINTWRITER_H_*/
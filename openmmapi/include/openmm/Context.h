@@ -125,6 +125,38 @@ public:
      * and energies.  Group i will be included if (groups&(1<<i)) != 0.  The default value includes all groups.
      */
     State getState(int types, bool enforcePeriodicBox=false, int groups=0xFFFFFFFF) const;
+    /**
+     * Get the positions of particles, storing them in a vector you provide.  Unlike getState(), this
+     * does not create a State, and if the vector already has enough capacity no memory is allocated.
+     * This makes it a cheaper way to retrieve positions frequently, especially when you only need
+     * them for some of the particles.  Positions are returned exactly as stored in the Context,
+     * without translating molecules into the periodic box.
+     *
+     * @param positions  on exit, this contains the particle positions
+     * @param indices    the indices of the particles to get.  If this is empty (the default), all
+     *                   particles are returned.  Otherwise positions[i] is the position of particle indices[i].
+     */
+    void getPositions(std::vector<Vec3>& positions, const std::vector<int>& indices=std::vector<int>()) const;
+    /**
+     * Get the velocities of particles, storing them in a vector you provide.  This is a cheaper
+     * alternative to getState() for retrieving velocities frequently.  See getPositions() for details.
+     *
+     * @param velocities  on exit, this contains the particle velocities
+     * @param indices     the indices of the particles to get.  If this is empty (the default), all
+     *                    particles are returned.  Otherwise velocities[i] is the velocity of particle indices[i].
+     */
+    void getVelocities(std::vector<Vec3>& velocities, const std::vector<int>& indices=std::vector<int>()) const;
+    /**
+     * Compute the forces on particles and store them in a vector you provide.  This is a cheaper
+     * alternative to getState() for retrieving forces frequently.  See getPositions() for details.
+     *
+     * @param forces   on exit, this contains the forces on the particles
+     * @param indices  the indices of the particles to get.  If this is empty (the default), all
+     *                 particles are returned.  Otherwise forces[i] is the force on particle indices[i].
+     * @param groups   a set of bit flags for which force groups to include when computing forces.
+     *                 Group i will be included if (groups&(1<<i)) != 0.  The default value includes all groups.
+     */
+    void getForces(std::vector<Vec3>& forces, const std::vector<int>& indices=std::vector<int>(), int groups=0xFFFFFFFF) const;
     /**
      * Copy information from a State object into this Context.  This restores the Context to
      * approximately the same state it was in when the State was created.  If the State does not include
@@ -289,6 +321,7 @@ private:
     friend class Force;
     friend class ForceImpl;
     friend class Platform;
+    friend class TrajectoryWriter;
     Context(const System& system, Integrator& integrator, ContextImpl& linked);
     ContextImpl& getImpl();
     const ContextImpl& getImpl() const;
@@ -728,7 +728,7 @@ private:
     std::string kineticEnergy;
     mutable bool globalsAreCurrent;
     int randomNumberSeed;
-    bool forcesAreValid, keNeedsForce;
+    bool forcesAreValid, keNeedsForce, updatesContextStateEveryStep;
     Kernel kernel;
 };
 
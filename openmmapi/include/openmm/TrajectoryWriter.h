@@ -0,0 +1,142 @@
+#ifndef OPENMM_TRAJECTORYWRITER_H_
+#define OPENMM_TRAJECTORYWRITER_H_
+
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "Context.h"
+#include "internal/windowsExport.h"
+#include <string>
+#include <vector>
+
+namespace OpenMM {
+
+class ContextImpl;
+
+/**
+ * A TrajectoryWriter records the trajectory of a simulation to a DCD or XTC file.  It attaches
+ * itself to a Context and captures a frame every time the step count reaches a multiple of the
+ * interval, while Integrator::step() is running.  Capturing a frame only copies the positions and
+ * periodic box vectors into a buffer.  The frames are encoded and written to disk on a background
+ * thread, so writing frames frequently does not hold up the simulation.
+ *
+ * Frames are stored in a ring buffer with a fixed number of slots.  If frames are produced faster
+ * than they can be written and the buffer fills up, the simulation waits until a slot becomes free.
+ * Frames are never dropped.
+ *
+ * Integrators notify the writer at the start of each time step, so the frame for a step is captured
+ * at the start of the following one.  Call flush() after the last call to Integrator::step() to
+ * capture the final frame and wait for everything to be written.  The destructor does this too, but
+ * it cannot report errors.  The first frame is the first multiple of the interval after the step
+ * count at the time the TrajectoryWriter was created.
+ *
+ * The file format matches what DCDReporter and XTCReporter produce in the Python application layer.
+ * The Context must not be deleted before the TrajectoryWriter.
+ */
+class OPENMM_EXPORT TrajectoryWriter {
+public:
+    /**
+     * This is an enumeration of the file formats that can be written.
+     */
+    enum Format {
+        /**
+         * The CHARMM variant of the DCD format, with little endian byte ordering.
+         */
+        DCD = 0,
+        /**
+         * The compressed GROMACS XTC format.
+         */
+        XTC = 1
+    };
+    /**
+     * Create a TrajectoryWriter and attach it to a Context.
+     *
+     * @param context     the Context whose trajectory should be written
+     * @param filename    the file to write.  If it already exists, it is overwritten.
+     * @param format      the format of the file
+     * @param interval    the interval (in time steps) at which to write frames
+     * @param particles   the indices of the particles to write.  If this is empty (the default),
+     *                    all particles are written.
+     * @param bufferSize  the number of frames the ring buffer can hold
+     */
+    TrajectoryWriter(Context& context, const std::string& filename, Format format, int interval,
+                     const std::vector<int>& particles=std::vector<int>(), int bufferSize=16);
+    /**
+     * The destructor detaches from the Context, captures the final frame if it is due, and waits for
+     * all frames to be written.
+     */
+    ~TrajectoryWriter();
+    TrajectoryWriter(const TrajectoryWriter&) = delete;
+    TrajectoryWriter& operator=(const TrajectoryWriter&) = delete;
+    /**
+     * Get the format of the file being written.
+     */
+    Format getFormat() const {
+        return format;
+    }
+    /**
+     * Get the interval (in time steps) at which frames are written.
+     */
+    int getInterval() const {
+        return interval;
+    }
+    /**
+     * Get the number of frames that have been captured so far.  Some of them may not have been written
+     * to the file yet.
+     */
+    int getNumFrames() const {
+        return numFrames;
+    }
+    /**
+     * Capture the frame for the current step if it is due and has not been captured yet, then block
+     * until all captured frames have been written to the file.  If an error occurred while writing
+     * any of them, this throws an exception.
+     */
+    void flush();
+private:
+    class Frame;
+    class WriterData;
+    static void* threadBody(void* args);
+    void captureFrame(ContextImpl& context, long long step);
+    void writeFrame(const Frame& frame);
+    void writeDcdHeader(const Frame& frame);
+    Context& context;
+    std::string filename;
+    Format format;
+    int interval, numFrames, listenerId;
+    long long lastStep;
+    std::vector<int> particles;
+    WriterData* data;
+};
+
+} // namespace OpenMM
+
+#endif /*OPENMM_TRAJECTORYWRITER_H_*/
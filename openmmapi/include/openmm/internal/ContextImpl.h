@@ -35,6 +35,7 @@
 #include "openmm/Kernel.h"
 #include "openmm/Platform.h"
 #include "openmm/Vec3.h"
+#include <functional>
 #include <iosfwd>
 #include <map>
 #include <vector>
@@ -106,6 +107,13 @@ public:
      * @param positions  on exit, this contains the particle positions
      */
     void getPositions(std::vector<Vec3>& positions);
+    /**
+     * Get the positions of a subset of particles.
+     *
+     * @param indices  the indices of the particles to get
+     * @param positions  on exit, positions[i] contains the position of particle indices[i]
+     */
+    void getPositions(const std::vector<int>& indices, std::vector<Vec3>& positions);
     /**
      * Set the positions of all particles.
      *
@@ -118,6 +126,13 @@ public:
      * @param velocities  on exit, this contains the particle velocities
      */
     void getVelocities(std::vector<Vec3>& velocities);
+    /**
+     * Get the velocities of a subset of particles.
+     *
+     * @param indices  the indices of the particles to get
+     * @param velocities  on exit, velocities[i] contains the velocity of particle indices[i]
+     */
+    void getVelocities(const std::vector<int>& indices, std::vector<Vec3>& velocities);
     /**
      * Set the velocities of all particles.
      *
@@ -130,6 +145,13 @@ public:
      * @param forces  on exit, this contains the forces
      */
     void getForces(std::vector<Vec3>& forces);
+    /**
+     * Get the current forces on a subset of particles.
+     *
+     * @param indices  the indices of the particles to get
+     * @param forces   on exit, forces[i] contains the force on particle indices[i]
+     */
+    void getForces(const std::vector<int>& indices, std::vector<Vec3>& forces);
     /**
      * Get the set of all adjustable parameters and their values
      */
@@ -226,13 +248,35 @@ public:
      */
     void computeShiftedVelocities(double timeShift, std::vector<Vec3>& velocities);
     /**
-     * This should be called at the start of each time step.  It calls updateContextState() on each
-     * ForceImpl in the system, allowing them to modify the values of state variables.
+     * This should be called at the start of each time step.  It calls notifyStepListeners(), then calls
+     * updateContextState() on each ForceImpl in the system, allowing them to modify the values of state
+     * variables.
      * 
      * @return true if the state was modified in any way that would cause the forces on particles
      * to change, false otherwise
      */
     bool updateContextState();
+    /**
+     * Add a function that should be called by notifyStepListeners().  Integrators call that at the start
+     * of every time step, so this provides a way to observe the simulation while Integrator::step() runs.
+     * The function is passed this ContextImpl.  Step listeners are kept when the Context is reinitialized.
+     *
+     * @param listener   the function to call
+     * @return an identifier that can be passed to removeStepListener()
+     */
+    int addStepListener(std::function<void (ContextImpl&)> listener);
+    /**
+     * Remove a function that was added with addStepListener().
+     *
+     * @param id    the identifier that was returned by addStepListener()
+     */
+    void removeStepListener(int id);
+    /**
+     * Call every function that was added with addStepListener().  updateContextState() calls this, so most
+     * Integrators do not need to call it directly.  An Integrator that does not call updateContextState() on
+     * every time step should call this instead.
+     */
+    void notifyStepListeners();
     /**
      * Get the list of ForceImpls belonging to this ContextImpl.
      */
@@ -303,9 +347,10 @@ private:
     Integrator& integrator;
     std::vector<ForceImpl*> forceImpls;
     std::map<std::string, double> parameters;
+    std::map<int, std::function<void (ContextImpl&)> > stepListeners;
     mutable std::vector<std::vector<int> > molecules;
     bool hasInitializedForces, hasSetPositions, integratorIsDeleted;
-    int lastForceGroups;
+    int lastForceGroups, nextStepListenerId;
     Platform* platform;
     Kernel initializeForcesKernel, updateStateDataKernel, applyConstraintsKernel, virtualSitesKernel;
     void* platformData;
@@ -34,7 +34,10 @@
 
 #define NOMINMAX
 #include "windowsExport.h"
+#include <atomic>
+#include <exception>
 #include <functional>
+#include <memory>
 #include <pthread.h>
 #include <vector>
 
@@ -49,11 +52,34 @@ namespace OpenMM {
  * next syncThreads(), and the final call waits until they exit from the Task's execute() method.
  * After calling waitForThreads() to block at a synchronization point, the parent thread should
  * call resumeThreads() to instruct the worker threads to resume.
+ *
+ * Alternatively, work can be divided into many smaller tasks that are scheduled dynamically.
+ * Call addTask() to add tasks, optionally specifying other tasks they depend on, then call
+ * executeTasks() to run them.  Each worker thread has its own queue of tasks, and threads that
+ * run out of work steal tasks from the queues of other threads.  Running tasks may add further
+ * tasks, and may wait for them to finish with waitForTask().  parallelFor() provides a simple
+ * way of processing a range of indices in chunks that are balanced between threads this way.
+ * startTasks() begins running tasks in the background, so the parent thread can do other work
+ * while they execute.  Any later call to execute() or executeTasks() first waits for them to finish.
+ *
+ * If a task throws an exception, the worker thread catches it and the next call to waitForThreads()
+ * (which executeTasks() calls internally) rethrows it on the parent thread.  If several tasks throw,
+ * only the first exception is kept.  Other tasks still run to completion, so the pool remains usable
+ * afterward.  A Task that calls syncThreads() must not throw before its last synchronization point,
+ * since the other threads would then be left waiting at it.
+ *
+ * Threads that run out of tasks spin briefly looking for more work, then sleep until a task is
+ * added or finishes.
  */
 class OPENMM_EXPORT ThreadPool {
 public:
     class Task;
     class ThreadData;
+    class TaskInfo;
+    /**
+     * A TaskHandle identifies a task that was added with addTask().
+     */
+    typedef std::shared_ptr<TaskInfo> TaskHandle;
     /**
      * Create a ThreadPool.
      *
@@ -82,21 +108,77 @@ public:
     /**
      * This is called by the master thread to wait until all threads have completed the Task.  Alternatively,
      * if the threads call syncThreads(), this blocks until all threads have reached the synchronization point.
+     * If a thread threw an exception since the last call, it is rethrown here.
      */
     void waitForThreads();
     /**
      * Instruct the threads to resume running after blocking at a synchronization point.
      */
     void resumeThreads();
+    /**
+     * Add a task to be executed by the work stealing scheduler.  This may be called either by the
+     * parent thread before calling executeTasks(), or by a task that is already running.  In the
+     * latter case, the new task is placed in the queue of the thread that added it.
+     *
+     * @param task          the function to execute.  It is passed the ThreadPool and the index of
+     *                      the thread executing it.
+     * @param dependencies  tasks that must finish before this one is allowed to start
+     * @return a handle that can be used to refer to the new task
+     */
+    TaskHandle addTask(std::function<void (ThreadPool&, int)> task, const std::vector<TaskHandle>& dependencies=std::vector<TaskHandle>());
+    /**
+     * This is called by the parent thread to execute all tasks that have been added with addTask(),
+     * including any further tasks they add.  It blocks until all of them have finished.  If any task
+     * threw an exception, it is rethrown once they have.
+     */
+    void executeTasks();
+    /**
+     * This is called by the parent thread to begin executing the tasks that have been added with
+     * addTask() without waiting for them to finish.  Tasks added while they are running are normally
+     * picked up by the running threads as well, but that is not guaranteed.  Call executeTasks() to
+     * make sure all tasks have finished.
+     */
+    void startTasks();
+    /**
+     * This is called from inside a running task to block until another task has finished.  While
+     * waiting, the calling thread executes other tasks.
+     */
+    void waitForTask(const TaskHandle& task);
+    /**
+     * Process a range of indices in parallel.  The range is recursively split in half, and the pieces
+     * are added as tasks, so threads that finish early can steal work from ones that are still busy.
+     * This may be called either by the parent thread or from inside a running task.  It returns once
+     * the entire range has been processed.
+     *
+     * @param numItems   the number of indices to process
+     * @param chunkSize  the maximum number of indices to pass to a single invocation of the function
+     * @param task       the function to execute.  It is passed the ThreadPool, the index of the thread
+     *                   executing it, and the first and last (exclusive) indices to process.
+     */
+    void parallelFor(int numItems, int chunkSize, std::function<void (ThreadPool&, int, int, int)> task);
 private:
+    typedef std::function<void (ThreadPool&, int, int, int)> RangeFunction;
+    void addRangeTask(std::shared_ptr<RangeFunction> body, std::shared_ptr<std::atomic<int> > remaining, int chunkSize, int start, int end);
+    int getCurrentThreadIndex() const;
+    void pushTask(const TaskHandle& task, int threadIndex);
+    bool runNextTask(int threadIndex);
+    void runTasks(int threadIndex);
+    void finishRunningTasks();
+    void waitForWork(int threadIndex, const std::function<bool ()>& isDone);
+    void notifyWaitingThreads();
+    void recordException(std::exception_ptr exception);
     bool isDeleted;
-    int numThreads, waitCount;
+    int numThreads, waitCount, activeThreads;
     std::vector<pthread_t> thread;
     std::vector<ThreadData*> threadData;
-    pthread_cond_t startCondition, endCondition;
+    pthread_cond_t startCondition, endCondition, workCondition;
     pthread_mutex_t lock;
     Task* currentTask;
     std::function<void (ThreadPool& pool, int)> currentFunction;
+    std::atomic<int> outstandingTasks, workEvents, sleepingThreads;
+    std::exception_ptr pendingException;
+    int nextQueue;
+    bool tasksRunning;
 };
 
 /**
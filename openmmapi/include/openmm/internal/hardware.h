@@ -126,6 +126,65 @@ static int getNumProcessors() {
 #endif
 #endif
 
+/**
+ * Query CPUID for a leaf that has subleaves, such as leaf 7.  The cpuid() function
+ * above leaves ECX undefined, which gives the wrong answer for those leaves.  Also
+ * read the XCR0 register, which tells which register states the OS saves.
+ */
+#ifdef WIN32
+static void cpuidSubleaf(int cpuInfo[4], int infoType, int subleaf) {
+    __cpuidex(cpuInfo, infoType, subleaf);
+}
+
+static long long getXcr0() {
+    return (long long) _xgetbv(0);
+}
+#else
+#if !defined(__ANDROID__) && !defined(__PNACL__) && !defined(__PPC__) \
+    && !defined(__ARM__) && !defined(__ARM64__) && !defined(__LOONGARCH64__)
+    static void cpuidSubleaf(int cpuInfo[4], int infoType, int subleaf) {
+    #ifdef __LP64__
+        __asm__ __volatile__ (
+            "cpuid":
+            "=a" (cpuInfo[0]),
+            "=b" (cpuInfo[1]),
+            "=c" (cpuInfo[2]),
+            "=d" (cpuInfo[3]) :
+            "a" (infoType),
+            "c" (subleaf)
+        );
+    #else
+        __asm__ __volatile__ (
+            "pushl %%ebx\n"
+            "cpuid\n"
+            "movl %%ebx, %1\n"
+            "popl %%ebx\n" :
+            "=a" (cpuInfo[0]),
+            "=r" (cpuInfo[1]),
+            "=c" (cpuInfo[2]),
+            "=d" (cpuInfo[3]) :
+            "a" (infoType),
+            "c" (subleaf)
+        );
+    #endif
+    }
+
+    static long long getXcr0() {
+        unsigned int eax, edx;
+        __asm__ __volatile__ ("xgetbv" : "=a" (eax), "=d" (edx) : "c" (0));
+        return ((long long) edx << 32) | eax;
+    }
+#else
+    static void cpuidSubleaf(int cpuInfo[4], int infoType, int subleaf) {
+        cpuInfo[0] = cpuInfo[1] = cpuInfo[2] = cpuInfo[3] = 0;
+    }
+
+    static long long getXcr0() {
+        return 0;
+    }
+#endif
+#endif
+
 /**
  * Get whether this is an x86 CPU that supports AVX.
  */
@@ -139,11 +198,38 @@ static bool isAvxSupported() {
     return false;
 }
 
+/**
+ * Get whether this is an x86 CPU that supports AVX-512 (the foundation instructions),
+ * and the operating system saves the full 512 bit register state.
+ */
+static bool isAvx512Supported() {
+    int cpuInfo[4];
+    cpuid(cpuInfo, 0);
+    if (cpuInfo[0] < 7)
+        return false;
+    cpuid(cpuInfo, 1);
+    bool osxsave = ((cpuInfo[2] & ((int) 1 << 27)) != 0);
+    bool fma = ((cpuInfo[2] & ((int) 1 << 12)) != 0);
+    if (!osxsave || !fma)
+        return false;
+
+    // XCR0 must enable the SSE, AVX, opmask, and upper ZMM register states.
+
+    if ((getXcr0() & 0xE6) != 0xE6)
+        return false;
+    cpuidSubleaf(cpuInfo, 7, 0);
+    bool avx2 = ((cpuInfo[1] & ((int) 1 << 5)) != 0);
+    bool avx512f = ((cpuInfo[1] & ((int) 1 << 16)) != 0);
+    return (avx2 && avx512f);
+}
+
 /**
  * Get the maximum supported size for vectors in multiples of four bytes.  This
  * is the number of int or float values that can be contained in a vector.
  */
 static int getVectorWidth() {
+    if (isAvx512Supported())
+        return 16;
     if (isAvxSupported())
         return 8;
     return 4;
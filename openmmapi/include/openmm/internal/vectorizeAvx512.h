@@ -0,0 +1,380 @@
+#ifndef OPENMM_VECTORIZEAVX512_H_
+#define OPENMM_VECTORIZEAVX512_H_
+
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "vectorizeAvx.h"
+#include <immintrin.h>
+
+// This file defines classes and functions to simplify vectorizing code with AVX-512.
+// Only the AVX-512 foundation instructions are used.  Unlike the narrower vector types,
+// comparisons produce a mask16 that lives in an opmask register, and blending is done
+// with masked moves.
+
+class ivec16;
+
+/**
+ * A sixteen element mask, one bit per element.
+ */
+class mask16 {
+public:
+    __mmask16 val;
+
+    mask16() = default;
+    mask16(__mmask16 v) : val(v) {}
+    operator __mmask16() const {
+        return val;
+    }
+    mask16 operator&(mask16 other) const {
+        return _mm512_kand(val, other.val);
+    }
+    mask16 operator|(mask16 other) const {
+        return _mm512_kor(val, other.val);
+    }
+};
+
+/**
+ * A sixteen element vector of floats.
+ */
+class fvec16 {
+public:
+    __m512 val;
+
+    fvec16() = default;
+    fvec16(float v) : val(_mm512_set1_ps(v)) {}
+    fvec16(__m512 v) : val(v) {}
+    fvec16(const float* v) : val(_mm512_loadu_ps(v)) {}
+
+    /** Create a vector by gathering individual indexes of data from a table. Element i of the vector will
+     * be loaded from table[idx[i]].
+     * @param table The table from which to do a lookup.
+     * @param indexes The indexes to gather.
+     */
+    fvec16(const float* table, const int32_t idx[16])
+        : val(_mm512_i32gather_ps(_mm512_loadu_si512(idx), table, 4)) {}
+
+    operator __m512() const {
+        return val;
+    }
+    fvec8 lowerVec() const {
+        return _mm512_castps512_ps256(val);
+    }
+    fvec8 upperVec() const {
+        return _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(val), 1));
+    }
+    void store(float* v) const {
+        _mm512_storeu_ps(v, val);
+    }
+    fvec16 operator+(fvec16 other) const {
+        return _mm512_add_ps(val, other);
+    }
+    fvec16 operator-(fvec16 other) const {
+        return _mm512_sub_ps(val, other);
+    }
+    fvec16 operator*(fvec16 other) const {
+        return _mm512_mul_ps(val, other);
+    }
+    fvec16 operator/(fvec16 other) const {
+        return _mm512_div_ps(val, other);
+    }
+    void operator+=(fvec16 other) {
+        val = _mm512_add_ps(val, other);
+    }
+    void operator-=(fvec16 other) {
+        val = _mm512_sub_ps(val, other);
+    }
+    void operator*=(fvec16 other) {
+        val = _mm512_mul_ps(val, other);
+    }
+    void operator/=(fvec16 other) {
+        val = _mm512_div_ps(val, other);
+    }
+    fvec16 operator-() const {
+        return _mm512_sub_ps(_mm512_setzero_ps(), val);
+    }
+    fvec16 operator&(fvec16 other) const {
+        return _mm512_castsi512_ps(_mm512_and_si512(_mm512_castps_si512(val), _mm512_castps_si512(other)));
+    }
+    fvec16 operator|(fvec16 other) const {
+        return _mm512_castsi512_ps(_mm512_or_si512(_mm512_castps_si512(val), _mm512_castps_si512(other)));
+    }
+    mask16 operator==(fvec16 other) const {
+        return _mm512_cmp_ps_mask(val, other, _CMP_EQ_OQ);
+    }
+    mask16 operator!=(fvec16 other) const {
+        return _mm512_cmp_ps_mask(val, other, _CMP_NEQ_OQ);
+    }
+    mask16 operator>(fvec16 other) const {
+        return _mm512_cmp_ps_mask(val, other, _CMP_GT_OQ);
+    }
+    mask16 operator<(fvec16 other) const {
+        return _mm512_cmp_ps_mask(val, other, _CMP_LT_OQ);
+    }
+    mask16 operator>=(fvec16 other) const {
+        return _mm512_cmp_ps_mask(val, other, _CMP_GE_OQ);
+    }
+    mask16 operator<=(fvec16 other) const {
+        return _mm512_cmp_ps_mask(val, other, _CMP_LE_OQ);
+    }
+    operator ivec16() const;
+
+    /**
+     * Convert an integer bitmask into a mask which can be used by the blend function.
+     * Bit i of the bitmask corresponds to element i.
+     */
+    static mask16 expandBitsToMask(int bitmask);
+};
+
+/**
+ * A sixteen element vector of ints.
+ */
+class ivec16 {
+public:
+    __m512i val;
+
+    ivec16() {}
+    ivec16(int v) : val(_mm512_set1_epi32(v)) {}
+    ivec16(__m512i v) : val(v) {}
+    ivec16(const int* v) : val(_mm512_loadu_si512(v)) {}
+    operator __m512i() const {
+        return val;
+    }
+    ivec8 lowerVec() const {
+        return _mm512_castsi512_si256(val);
+    }
+    ivec8 upperVec() const {
+        return _mm512_extracti64x4_epi64(val, 1);
+    }
+    void store(int* v) const {
+        _mm512_storeu_si512(v, val);
+    }
+    ivec16 operator&(ivec16 other) const {
+        return _mm512_and_si512(val, other.val);
+    }
+    ivec16 operator|(ivec16 other) const {
+        return _mm512_or_si512(val, other.val);
+    }
+    operator fvec16() const;
+};
+
+// Conversion operators.
+
+inline fvec16::operator ivec16() const {
+    return _mm512_cvttps_epi32(val);
+}
+
+inline ivec16::operator fvec16() const {
+    return _mm512_cvtepi32_ps(val);
+}
+
+inline mask16 fvec16::expandBitsToMask(int bitmask) {
+    return (__mmask16) bitmask;
+}
+
+// Functions that operate on fvec16s.
+
+static inline fvec16 floor(fvec16 v) {
+    return fvec16(_mm512_roundscale_ps(v.val, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC));
+}
+
+static inline fvec16 ceil(fvec16 v) {
+    return fvec16(_mm512_roundscale_ps(v.val, _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC));
+}
+
+static inline fvec16 round(fvec16 v) {
+    return fvec16(_mm512_roundscale_ps(v.val, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+}
+
+static inline fvec16 min(fvec16 v1, fvec16 v2) {
+    return fvec16(_mm512_min_ps(v1.val, v2.val));
+}
+
+static inline fvec16 max(fvec16 v1, fvec16 v2) {
+    return fvec16(_mm512_max_ps(v1.val, v2.val));
+}
+
+static inline fvec16 abs(fvec16 v) {
+    return fvec16(_mm512_castsi512_ps(_mm512_and_si512(_mm512_castps_si512(v.val), _mm512_set1_epi32(0x7FFFFFFF))));
+}
+
+static inline fvec16 sqrt(fvec16 v) {
+    return fvec16(_mm512_sqrt_ps(v.val));
+}
+
+static inline fvec16 rsqrt(fvec16 v) {
+    // Initial estimate of rsqrt(), accurate to 14 bits.
+
+    fvec16 y(_mm512_rsqrt14_ps(v.val));
+
+    // Perform an iteration of Newton refinement.
+
+    fvec16 x2 = v*0.5f;
+    y *= fvec16(1.5f)-x2*y*y;
+    return y;
+}
+
+static inline float reduceAdd(fvec16 v) {
+    return _mm512_reduce_add_ps(v.val);
+}
+
+/**
+ * Split a vector into its four 128 bit lanes.
+ */
+static inline void splitLanes(fvec16 v, fvec4& out1, fvec4& out2, fvec4& out3, fvec4& out4) {
+    out1 = _mm512_castps512_ps128(v.val);
+    out2 = _mm512_extractf32x4_ps(v.val, 1);
+    out3 = _mm512_extractf32x4_ps(v.val, 2);
+    out4 = _mm512_extractf32x4_ps(v.val, 3);
+}
+
+/**
+ * Combine four 128 bit lanes into a single vector.
+ */
+static inline fvec16 joinLanes(fvec4 in1, fvec4 in2, fvec4 in3, fvec4 in4) {
+    __m512 result = _mm512_castps128_ps512(in1);
+    result = _mm512_insertf32x4(result, in2, 1);
+    result = _mm512_insertf32x4(result, in3, 2);
+    result = _mm512_insertf32x4(result, in4, 3);
+    return result;
+}
+
+/** Given a vec4[16] input array, generate 4 vec16 outputs. The first output contains all the first elements
+ * the second output the second elements, and so on.
+ */
+static inline void transpose(const fvec4 in[16], fvec16& out1, fvec16& out2, fvec16& out3, fvec16& out4) {
+    fvec4 t[16];
+    for (int i = 0; i < 16; i++)
+        t[i] = in[i];
+    _MM_TRANSPOSE4_PS(t[0], t[1], t[2], t[3]);
+    _MM_TRANSPOSE4_PS(t[4], t[5], t[6], t[7]);
+    _MM_TRANSPOSE4_PS(t[8], t[9], t[10], t[11]);
+    _MM_TRANSPOSE4_PS(t[12], t[13], t[14], t[15]);
+    out1 = joinLanes(t[0], t[4], t[8], t[12]);
+    out2 = joinLanes(t[1], t[5], t[9], t[13]);
+    out3 = joinLanes(t[2], t[6], t[10], t[14]);
+    out4 = joinLanes(t[3], t[7], t[11], t[15]);
+}
+
+/**
+ * Given 4 input vectors of 16 elements, transpose them to form 16 output vectors of 4 elements.
+ */
+static inline void transpose(fvec16 in1, fvec16 in2, fvec16 in3, fvec16 in4, fvec4 out[16]) {
+    splitLanes(in1, out[0], out[4], out[8], out[12]);
+    splitLanes(in2, out[1], out[5], out[9], out[13]);
+    splitLanes(in3, out[2], out[6], out[10], out[14]);
+    splitLanes(in4, out[3], out[7], out[11], out[15]);
+    _MM_TRANSPOSE4_PS(out[0], out[1], out[2], out[3]);
+    _MM_TRANSPOSE4_PS(out[4], out[5], out[6], out[7]);
+    _MM_TRANSPOSE4_PS(out[8], out[9], out[10], out[11]);
+    _MM_TRANSPOSE4_PS(out[12], out[13], out[14], out[15]);
+}
+
+// Functions that operate on ivec16s and masks.
+
+static inline bool any(ivec16 v) {
+    return _mm512_test_epi32_mask(v.val, v.val) != 0;
+}
+
+static inline bool any(mask16 m) {
+    return m.val != 0;
+}
+
+// Mathematical operators involving a scalar and a vector.
+
+static inline fvec16 operator+(float v1, fvec16 v2) {
+    return fvec16(v1)+v2;
+}
+
+static inline fvec16 operator-(float v1, fvec16 v2) {
+    return fvec16(v1)-v2;
+}
+
+static inline fvec16 operator*(float v1, fvec16 v2) {
+    return fvec16(v1)*v2;
+}
+
+static inline fvec16 operator/(float v1, fvec16 v2) {
+    return fvec16(v1)/v2;
+}
+
+// Operations for blending fvec16s with a mask.  Elements whose mask bit is set are taken from v2.
+
+static inline fvec16 blend(fvec16 v1, fvec16 v2, mask16 mask) {
+    return fvec16(_mm512_mask_blend_ps(mask.val, v1.val, v2.val));
+}
+
+static inline fvec16 blendZero(fvec16 v, mask16 mask) {
+    return fvec16(_mm512_maskz_mov_ps(mask.val, v.val));
+}
+
+/**
+ * Blending a mask with another mask just intersects them.  This allows code written for the
+ * narrower vector types, where masks are themselves vectors, to work unchanged.
+ */
+static inline mask16 blendZero(mask16 v, mask16 mask) {
+    return v & mask;
+}
+
+/**
+ * Given a table of floating-point values and a set of indexes, perform a gather read into a pair
+ * of vectors. The first result vector contains the values at the given indexes, and the second
+ * result vector contains the values from each respective index+1.
+ */
+static inline void gatherVecPair(const float* table, ivec16 index, fvec16& out0, fvec16& out1) {
+    // Each pair of values is loaded as a single 64 bit element.  This takes two gathers of
+    // eight pairs each.
+
+    const double* tableAsDbl = (const double*) table;
+    const auto lowerGather = _mm512_castpd_ps(_mm512_i32gather_pd(index.lowerVec(), tableAsDbl, 4));
+    const auto upperGather = _mm512_castpd_ps(_mm512_i32gather_pd(index.upperVec(), tableAsDbl, 4));
+
+    // Each gather holds interleaved first and second values.  Pull out the even elements of
+    // both to form the first output and the odd elements to form the second.
+
+    const auto evenIndex = _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30);
+    const auto oddIndex = _mm512_setr_epi32(1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31);
+    out0 = fvec16(_mm512_permutex2var_ps(lowerGather, evenIndex, upperGather));
+    out1 = fvec16(_mm512_permutex2var_ps(lowerGather, oddIndex, upperGather));
+}
+
+/**
+ * Given 3 vectors of floating-point data, reduce them to a single 3-element position
+ * value by adding all the elements in each vector.  The fourth element of the result
+ * is undefined.
+ */
+static inline fvec4 reduceToVec3(fvec16 x, fvec16 y, fvec16 z) {
+    // Fold the upper half onto the lower half, then let the AVX version finish the job.
+
+    return reduceToVec3(x.lowerVec()+x.upperVec(), y.lowerVec()+y.upperVec(), z.lowerVec()+z.upperVec());
+}
+
+#endif /*OPENMM_VECTORIZEAVX512_H_*/
@@ -0,0 +1,503 @@
+
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "openmm/CheckpointWriter.h"
+#include "openmm/OpenMMException.h"
+#include "openmm/internal/ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <vector>
+
+using namespace OpenMM;
+using namespace std;
+
+static const char* DELTA_MAGIC = "OpenMM Delta Checkpoint\n";
+static const int DELTA_VERSION = 2;
+static const int QUANTIZED_DELTA_VERSION = 3;
+
+/**
+ * Literal runs in a delta are ended by this many consecutive zero bytes.  Shorter runs of zeros
+ * cost less to store inline than to start a new zero run.
+ */
+static const size_t MIN_ZERO_RUN = 3;
+
+/**
+ * The difference is transposed into byte planes separately for each block of this many bytes.
+ */
+static const size_t BLOCK_SIZE = 4096;
+
+class CheckpointWriter::WriterData {
+public:
+    WriterData() : threads(1) {
+    }
+    ThreadPool threads;
+    ThreadPool::TaskHandle lastTask;
+    exception_ptr error;
+};
+
+static uint64_t computeChecksum(const string& data) {
+    // 64 bit FNV-1a hash.
+
+    uint64_t hash = 14695981039346656037ULL;
+    for (char c : data) {
+        hash ^= (unsigned char) c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static void writeUint64(ostream& stream, uint64_t value) {
+    stream.write((char*) &value, sizeof(uint64_t));
+}
+
+static uint64_t readUint64(istream& stream) {
+    uint64_t value;
+    stream.read((char*) &value, sizeof(uint64_t));
+    if (!stream)
+        throw OpenMMException("CheckpointWriter: Unexpected end of delta checkpoint");
+    return value;
+}
+
+static void writeDouble(ostream& stream, double value) {
+    stream.write((char*) &value, sizeof(double));
+}
+
+static double readDouble(istream& stream) {
+    double value;
+    stream.read((char*) &value, sizeof(double));
+    if (!stream)
+        throw OpenMMException("CheckpointWriter: Unexpected end of delta checkpoint");
+    return value;
+}
+
+/**
+ * Find where byte i of a block ends up when the 8 byte words starting at offset are transposed into
+ * byte planes.  Bytes before the first word and after the last one are not moved.
+ */
+static size_t getTransposedIndex(size_t i, size_t size, size_t offset) {
+    size_t numWords = (size > offset ? (size-offset)/8 : 0);
+    if (i < offset || i >= offset+8*numWords)
+        return i;
+    size_t j = i-offset;
+    return offset+(j%8)*numWords+j/8;
+}
+
+/**
+ * Estimate how many bytes writeDelta() will use to encode a block.
+ */
+static size_t estimateEncodedSize(const char* data, size_t size) {
+    size_t encodedSize = 0, zeros = 0;
+    bool inLiteral = false;
+    for (size_t i = 0; i < size; i++) {
+        if (data[i] == 0) {
+            zeros++;
+            continue;
+        }
+        if (!inLiteral || zeros >= MIN_ZERO_RUN)
+            encodedSize += 2;
+        else
+            encodedSize += zeros;
+        encodedSize++;
+        inLiteral = true;
+        zeros = 0;
+    }
+    return encodedSize;
+}
+
+/**
+ * XOR a checkpoint against the reference and transpose the result into byte planes.  Most of the
+ * checkpoint consists of doubles, and for values that have changed only slightly, the sign,
+ * exponent, and leading mantissa bytes are unchanged.  Grouping corresponding bytes together turns
+ * them into long runs of zeros.
+ *
+ * This only works if the words being transposed line up with the doubles.  The checkpoint format
+ * depends on the Platform, and the arrays of doubles are not generally 8 byte aligned, nor are different
+ * arrays aligned the same way.  Each block is therefore transposed starting at whichever offset
+ * gives the most compact encoding, and the offsets are returned in blockOffsets.
+ */
+static vector<char> computeDifference(const string& checkpoint, const string& reference, vector<char>& blockOffsets) {
+    size_t size = checkpoint.size();
+    vector<char> xorData(size), diff(size), transposed(BLOCK_SIZE);
+    for (size_t i = 0; i < size; i++)
+        xorData[i] = (i < reference.size() ? checkpoint[i]^reference[i] : checkpoint[i]);
+    blockOffsets.clear();
+    for (size_t start = 0; start < size; start += BLOCK_SIZE) {
+        size_t blockSize = min(BLOCK_SIZE, size-start);
+        const char* block = &xorData[start];
+        size_t bestSize = 0, bestOffset = 0;
+        for (size_t offset = 0; offset < 8; offset++) {
+            for (size_t i = 0; i < blockSize; i++)
+                transposed[getTransposedIndex(i, blockSize, offset)] = block[i];
+            size_t encodedSize = estimateEncodedSize(transposed.data(), blockSize);
+            if (offset == 0 || encodedSize < bestSize) {
+                bestSize = encodedSize;
+                bestOffset = offset;
+            }
+        }
+        for (size_t i = 0; i < blockSize; i++)
+            diff[start+getTransposedIndex(i, blockSize, bestOffset)] = block[i];
+        blockOffsets.push_back((char) bestOffset);
+    }
+    return diff;
+}
+
+static string applyDifference(const vector<char>& diff, const vector<char>& blockOffsets, const string& reference) {
+    size_t size = diff.size();
+    string checkpoint(size, 0);
+    for (size_t start = 0; start < size; start += BLOCK_SIZE) {
+        size_t blockSize = min(BLOCK_SIZE, size-start);
+        int offset = blockOffsets[start/BLOCK_SIZE];
+        for (size_t i = 0; i < blockSize; i++) {
+            char c = diff[start+getTransposedIndex(i, blockSize, offset)];
+            if (start+i < reference.size())
+                c ^= reference[start+i];
+            checkpoint[start+i] = c;
+        }
+    }
+    return checkpoint;
+}
+
+/**
+ * Run lengths are stored as variable length integers, seven bits per byte, so short runs take a
+ * single byte.
+ */
+static void writeLength(ostream& stream, uint64_t value) {
+    while (value >= 128) {
+        stream.put((char) ((value&127) | 128));
+        value >>= 7;
+    }
+    stream.put((char) value);
+}
+
+static uint64_t readLength(istream& stream) {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int c = stream.get();
+        if (c == EOF)
+            throw OpenMMException("CheckpointWriter: Unexpected end of delta checkpoint");
+        value |= ((uint64_t) (c&127)) << shift;
+        if ((c&128) == 0)
+            return value;
+    }
+    throw OpenMMException("CheckpointWriter: Delta checkpoint is corrupt");
+}
+
+static void writeDeltaHeader(ostream& stream, int version, const string& reference) {
+    stream.write(DELTA_MAGIC, strlen(DELTA_MAGIC));
+    stream.write((char*) &version, sizeof(int));
+    writeUint64(stream, reference.size());
+    writeUint64(stream, computeChecksum(reference));
+}
+
+/**
+ * Read the header of a delta checkpoint, check that it was created relative to the reference, and
+ * return the format version.
+ */
+static int readDeltaHeader(istream& stream, const string& reference) {
+    size_t magicLength = strlen(DELTA_MAGIC);
+    string magic(magicLength, ' ');
+    stream.read(&magic[0], magicLength);
+    if (!stream || magic != DELTA_MAGIC)
+        throw OpenMMException("CheckpointWriter: Not a delta checkpoint");
+    int version;
+    stream.read((char*) &version, sizeof(int));
+    if (!stream || (version != DELTA_VERSION && version != QUANTIZED_DELTA_VERSION))
+        throw OpenMMException("CheckpointWriter: Unsupported delta checkpoint version");
+    uint64_t referenceSize = readUint64(stream);
+    uint64_t referenceChecksum = readUint64(stream);
+    if (referenceSize != reference.size() || referenceChecksum != computeChecksum(reference))
+        throw OpenMMException("CheckpointWriter: The full checkpoint is not the one the delta checkpoint was created relative to");
+    return version;
+}
+
+static void writeDelta(ostream& stream, const string& checkpoint, const string& reference) {
+    writeDeltaHeader(stream, DELTA_VERSION, reference);
+    writeUint64(stream, checkpoint.size());
+    vector<char> blockOffsets;
+    vector<char> diff = computeDifference(checkpoint, reference, blockOffsets);
+    stream.write(blockOffsets.data(), blockOffsets.size());
+
+    // Run length encode the difference as a series of (zero run, literal run) pairs.
+
+    size_t size = diff.size();
+    size_t pos = 0;
+    while (pos < size) {
+        size_t start = pos;
+        while (pos < size && diff[pos] == 0)
+            pos++;
+        writeLength(stream, pos-start);
+        start = pos;
+        size_t zeros = 0;
+        while (pos < size) {
+            if (diff[pos] == 0) {
+                if (++zeros == MIN_ZERO_RUN) {
+                    pos -= MIN_ZERO_RUN-1;
+                    break;
+                }
+            }
+            else
+                zeros = 0;
+            pos++;
+        }
+        writeLength(stream, pos-start);
+        stream.write(diff.data()+start, pos-start);
+    }
+}
+
+/**
+ * Read the body of a lossless delta checkpoint, which follows the header, and reconstruct the checkpoint.
+ */
+static string readDelta(istream& stream, const string& reference) {
+    uint64_t size = readUint64(stream);
+    vector<char> blockOffsets((size+BLOCK_SIZE-1)/BLOCK_SIZE);
+    stream.read(blockOffsets.data(), blockOffsets.size());
+    if (!stream)
+        throw OpenMMException("CheckpointWriter: Unexpected end of delta checkpoint");
+    for (char offset : blockOffsets)
+        if (offset < 0 || offset >= 8)
+            throw OpenMMException("CheckpointWriter: Delta checkpoint is corrupt");
+    vector<char> diff(size, 0);
+    size_t pos = 0;
+    while (pos < size) {
+        uint64_t zeros = readLength(stream);
+        uint64_t literals = readLength(stream);
+        if (zeros > size-pos || literals > size-pos-zeros)
+            throw OpenMMException("CheckpointWriter: Delta checkpoint is corrupt");
+        pos += zeros;
+        stream.read(diff.data()+pos, literals);
+        if (!stream)
+            throw OpenMMException("CheckpointWriter: Unexpected end of delta checkpoint");
+        pos += literals;
+    }
+    return applyDifference(diff, blockOffsets, reference);
+}
+
+/**
+ * Write a quantized delta checkpoint.  Each coordinate of each position and velocity is stored as the
+ * number of multiples of the tolerance by which it differs from the reference, zigzag encoded so small
+ * negative numbers also take few bytes.
+ */
+static void writeQuantizedDelta(ostream& stream, const State& state, const State& referenceState, const string& reference, double tolerance) {
+    writeDeltaHeader(stream, QUANTIZED_DELTA_VERSION, reference);
+    writeDouble(stream, tolerance);
+    writeDouble(stream, state.getTime());
+    writeUint64(stream, (uint64_t) state.getStepCount());
+    Vec3 box[3];
+    state.getPeriodicBoxVectors(box[0], box[1], box[2]);
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+            writeDouble(stream, box[i][j]);
+    writeLength(stream, state.getParameters().size());
+    for (auto& param : state.getParameters()) {
+        writeLength(stream, param.first.size());
+        stream.write(param.first.data(), param.first.size());
+        writeDouble(stream, param.second);
+    }
+    writeLength(stream, state.getPositions().size());
+    for (int type = 0; type < 2; type++) {
+        const vector<Vec3>& values = (type == 0 ? state.getPositions() : state.getVelocities());
+        const vector<Vec3>& referenceValues = (type == 0 ? referenceState.getPositions() : referenceState.getVelocities());
+        for (int i = 0; i < values.size(); i++)
+            for (int j = 0; j < 3; j++) {
+                double steps = (values[i][j]-referenceValues[i][j])/tolerance;
+                if (!(fabs(steps) < 4e18))
+                    throw OpenMMException("CheckpointWriter: A position or velocity cannot be quantized with the requested tolerance");
+                int64_t q = llround(steps);
+                writeLength(stream, ((uint64_t) q << 1) ^ (uint64_t) (q >> 63));
+            }
+    }
+}
+
+/**
+ * Read the body of a quantized delta checkpoint and apply it to a Context that has had the full
+ * checkpoint loaded into it.
+ */
+static void readQuantizedDelta(istream& stream, Context& context) {
+    double tolerance = readDouble(stream);
+    double time = readDouble(stream);
+    long long stepCount = (long long) readUint64(stream);
+    Vec3 box[3];
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+            box[i][j] = readDouble(stream);
+    uint64_t numParameters = readLength(stream);
+    vector<pair<string, double> > parameters;
+    for (uint64_t i = 0; i < numParameters; i++) {
+        uint64_t length = readLength(stream);
+        if (length > 1024)
+            throw OpenMMException("CheckpointWriter: Delta checkpoint is corrupt");
+        string name(length, ' ');
+        stream.read(&name[0], length);
+        double value = readDouble(stream);
+        parameters.push_back(make_pair(name, value));
+    }
+    State referenceState = context.getState(State::Positions | State::Velocities);
+    uint64_t numParticles = readLength(stream);
+    if (numParticles != referenceState.getPositions().size())
+        throw OpenMMException("CheckpointWriter: Delta checkpoint has the wrong number of particles");
+    vector<Vec3> positions = referenceState.getPositions(), velocities = referenceState.getVelocities();
+    for (int type = 0; type < 2; type++) {
+        vector<Vec3>& values = (type == 0 ? positions : velocities);
+        for (int i = 0; i < values.size(); i++)
+            for (int j = 0; j < 3; j++) {
+                uint64_t z = readLength(stream);
+                int64_t q = (int64_t) (z >> 1) ^ -(int64_t) (z & 1);
+                values[i][j] += q*tolerance;
+            }
+    }
+    context.setPeriodicBoxVectors(box[0], box[1], box[2]);
+    context.setPositions(positions);
+    context.setVelocities(velocities);
+    for (auto& param : parameters)
+        context.setParameter(param.first, param.second);
+    context.setTime(time);
+    context.setStepCount(stepCount);
+}
+
+CheckpointWriter::CheckpointWriter(Context& context, int fullCheckpointInterval, double tolerance) : context(context),
+        fullCheckpointInterval(fullCheckpointInterval), checkpointsSinceFull(0), tolerance(tolerance), data(new WriterData()) {
+    if (fullCheckpointInterval < 1) {
+        delete data;
+        throw OpenMMException("CheckpointWriter: fullCheckpointInterval must be at least 1");
+    }
+    if (tolerance < 0) {
+        delete data;
+        throw OpenMMException("CheckpointWriter: tolerance cannot be negative");
+    }
+}
+
+CheckpointWriter::~CheckpointWriter() {
+    data->threads.executeTasks();
+    delete data;
+}
+
+bool CheckpointWriter::writeCheckpoint(ostream& stream) {
+    return startCheckpoint(&stream, "");
+}
+
+bool CheckpointWriter::writeCheckpoint(const string& filename) {
+    return startCheckpoint(NULL, filename);
+}
+
+bool CheckpointWriter::startCheckpoint(ostream* stream, const string& filename) {
+    // Capture the checkpoint in memory.  This is the only part that has to happen before the
+    // simulation can continue.  Quantized deltas only need the positions and velocities.
+
+    bool full = (reference == nullptr || checkpointsSinceFull+1 >= fullCheckpointInterval);
+    bool quantized = (!full && tolerance > 0);
+    shared_ptr<const string> checkpoint;
+    shared_ptr<const State> state;
+    if (quantized)
+        state = make_shared<const State>(context.getState(State::Positions | State::Velocities | State::Parameters));
+    else {
+        stringstream buffer(ios_base::out | ios_base::binary);
+        context.createCheckpoint(buffer);
+        checkpoint = make_shared<const string>(buffer.str());
+    }
+    if (full) {
+        if (fullCheckpointInterval > 1) {
+            reference = checkpoint;
+            if (tolerance > 0)
+                referenceState = make_shared<const State>(context.getState(State::Positions | State::Velocities));
+        }
+        checkpointsSinceFull = 0;
+    }
+    else
+        checkpointsSinceFull++;
+
+    // Encode and write it in the background.  Each write depends on the previous one, so
+    // checkpoints always reach their streams in order.
+
+    shared_ptr<const string> base = (full ? nullptr : reference);
+    shared_ptr<const State> baseState = referenceState;
+    double tolerance = this->tolerance;
+    WriterData* data = this->data;
+    vector<ThreadPool::TaskHandle> dependencies;
+    if (data->lastTask != nullptr)
+        dependencies.push_back(data->lastTask);
+    data->lastTask = data->threads.addTask([stream, filename, checkpoint, state, base, baseState, tolerance, data] (ThreadPool& threads, int threadIndex) {
+        try {
+            ofstream file;
+            ostream* out = stream;
+            if (out == NULL) {
+                file.open(filename, ios_base::out | ios_base::binary);
+                if (!file)
+                    throw OpenMMException("CheckpointWriter: Could not open file "+filename);
+                out = &file;
+            }
+            if (base == nullptr)
+                out->write(checkpoint->data(), checkpoint->size());
+            else if (state != nullptr)
+                writeQuantizedDelta(*out, *state, *baseState, *base, tolerance);
+            else
+                writeDelta(*out, *checkpoint, *base);
+            out->flush();
+            if (!*out)
+                throw OpenMMException("CheckpointWriter: Error writing checkpoint");
+        }
+        catch (...) {
+            if (data->error == nullptr)
+                data->error = current_exception();
+        }
+    }, dependencies);
+    data->threads.startTasks();
+    return full;
+}
+
+void CheckpointWriter::waitForCompletion() {
+    data->threads.executeTasks();
+    data->lastTask = nullptr;
+    if (data->error != nullptr) {
+        exception_ptr error = data->error;
+        data->error = nullptr;
+        rethrow_exception(error);
+    }
+}
+
+void CheckpointWriter::loadCheckpoint(Context& context, istream& fullCheckpoint, istream& deltaCheckpoint) {
+    string reference((istreambuf_iterator<char>(fullCheckpoint)), istreambuf_iterator<char>());
+    if (readDeltaHeader(deltaCheckpoint, reference) == DELTA_VERSION) {
+        stringstream checkpoint(readDelta(deltaCheckpoint, reference), ios_base::in | ios_base::binary);
+        context.loadCheckpoint(checkpoint);
+    }
+    else {
+        stringstream checkpoint(reference, ios_base::in | ios_base::binary);
+        context.loadCheckpoint(checkpoint);
+        readQuantizedDelta(deltaCheckpoint, context);
+    }
+}
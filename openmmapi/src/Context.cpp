@@ -153,6 +153,28 @@ State Context::getState(int types, bool enforcePeriodicBox, int groups) const {
     return builder.getState();
 }
 
+void Context::getPositions(vector<Vec3>& positions, const vector<int>& indices) const {
+    if (indices.empty())
+        impl->getPositions(positions);
+    else
+        impl->getPositions(indices, positions);
+}
+
+void Context::getVelocities(vector<Vec3>& velocities, const vector<int>& indices) const {
+    if (indices.empty())
+        impl->getVelocities(velocities);
+    else
+        impl->getVelocities(indices, velocities);
+}
+
+void Context::getForces(vector<Vec3>& forces, const vector<int>& indices, int groups) const {
+    impl->calcForcesAndEnergy(true, false, groups);
+    if (indices.empty())
+        impl->getForces(forces);
+    else
+        impl->getForces(indices, forces);
+}
+
 void Context::setState(const State& state) {
     setTime(state.getTime());
     setStepCount(state.getStepCount());
@@ -253,9 +275,13 @@ void Context::reinitialize(bool preserveState) {
     if (preserveState)
         createCheckpoint(checkpoint);
     bool hasSetPositions = impl->hasSetPositions;
+    map<int, function<void (ContextImpl&)> > stepListeners = impl->stepListeners;
+    int nextStepListenerId = impl->nextStepListenerId;
     integrator.cleanup();
     delete impl;
     impl = new ContextImpl(*this, system, integrator, &platform, properties);
+    impl->stepListeners = stepListeners;
+    impl->nextStepListenerId = nextStepListenerId;
     impl->initialize();
     if (preserveState) {
         loadCheckpoint(checkpoint);
@@ -52,10 +52,16 @@ using namespace OpenMM;
 using namespace std;
 const static char CHECKPOINT_MAGIC_BYTES[] = "OpenMM Binary Checkpoint\n";
 
+static void checkParticleIndices(const System& system, const vector<int>& indices) {
+    int numParticles = system.getNumParticles();
+    for (int index : indices)
+        if (index < 0 || index >= numParticles)
+            throw OpenMMException("Illegal particle index: "+to_string(index));
+}
 
 ContextImpl::ContextImpl(Context& owner, const System& system, Integrator& integrator, Platform* platform, const map<string, string>& properties, ContextImpl* originalContext) :
         owner(owner), system(system), integrator(integrator), hasInitializedForces(false), hasSetPositions(false), integratorIsDeleted(false),
-        lastForceGroups(-1), platform(platform), platformData(NULL) {
+        lastForceGroups(-1), nextStepListenerId(0), platform(platform), platformData(NULL) {
     int numParticles = system.getNumParticles();
     if (numParticles == 0)
         throw OpenMMException("Cannot create a Context for a System with no particles");
@@ -229,6 +235,11 @@ void ContextImpl::getPositions(std::vector<Vec3>& positions) {
     updateStateDataKernel.getAs<UpdateStateDataKernel>().getPositions(*this, positions);
 }
 
+void ContextImpl::getPositions(const vector<int>& indices, vector<Vec3>& positions) {
+    checkParticleIndices(system, indices);
+    updateStateDataKernel.getAs<UpdateStateDataKernel>().getPositions(*this, indices, positions);
+}
+
 void ContextImpl::setPositions(const std::vector<Vec3>& positions) {
     hasSetPositions = true;
     updateStateDataKernel.getAs<UpdateStateDataKernel>().setPositions(*this, positions);
@@ -239,6 +250,11 @@ void ContextImpl::getVelocities(std::vector<Vec3>& velocities) {
     updateStateDataKernel.getAs<UpdateStateDataKernel>().getVelocities(*this, velocities);
 }
 
+void ContextImpl::getVelocities(const vector<int>& indices, vector<Vec3>& velocities) {
+    checkParticleIndices(system, indices);
+    updateStateDataKernel.getAs<UpdateStateDataKernel>().getVelocities(*this, indices, velocities);
+}
+
 void ContextImpl::setVelocities(const std::vector<Vec3>& velocities) {
     updateStateDataKernel.getAs<UpdateStateDataKernel>().setVelocities(*this, velocities);
     integrator.stateChanged(State::Velocities);
@@ -248,6 +264,11 @@ void ContextImpl::getForces(std::vector<Vec3>& forces) {
     updateStateDataKernel.getAs<UpdateStateDataKernel>().getForces(*this, forces);
 }
 
+void ContextImpl::getForces(const vector<int>& indices, vector<Vec3>& forces) {
+    checkParticleIndices(system, indices);
+    updateStateDataKernel.getAs<UpdateStateDataKernel>().getForces(*this, indices, forces);
+}
+
 const std::map<std::string, double>& ContextImpl::getParameters() const {
     return parameters;
 }
@@ -329,12 +350,28 @@ void ContextImpl::computeShiftedVelocities(double timeShift, std::vector<Vec3>&
 }
 
 bool ContextImpl::updateContextState() {
+    notifyStepListeners();
     bool forcesInvalid = false;
     for (auto force : forceImpls)
         force->updateContextState(*this, forcesInvalid);
     return forcesInvalid;
 }
 
+int ContextImpl::addStepListener(function<void (ContextImpl&)> listener) {
+    int id = nextStepListenerId++;
+    stepListeners[id] = listener;
+    return id;
+}
+
+void ContextImpl::removeStepListener(int id) {
+    stepListeners.erase(id);
+}
+
+void ContextImpl::notifyStepListeners() {
+    for (auto& listener : stepListeners)
+        listener.second(*this);
+}
+
 const vector<ForceImpl*>& ContextImpl::getForceImpls() const {
     return forceImpls;
 }
@@ -44,7 +44,7 @@
 using namespace OpenMM;
 using namespace std;
 
-CustomIntegrator::CustomIntegrator(double stepSize) : globalsAreCurrent(true), forcesAreValid(false) {
+CustomIntegrator::CustomIntegrator(double stepSize) : globalsAreCurrent(true), forcesAreValid(false), updatesContextStateEveryStep(false) {
     setStepSize(stepSize);
     setConstraintTolerance(1e-5);
     setRandomNumberSeed(0);
@@ -79,6 +79,19 @@ void CustomIntegrator::initialize(ContextImpl& contextRef) {
         if (computations[i].type == ComputeGlobal && globalTargets.find(computations[i].variable) == globalTargets.end())
             throw OpenMMException("Unknown global variable: "+computations[i].variable);
     }
+
+    // If there is no UpdateContextState step outside of all blocks, step listeners must be notified separately.
+
+    updatesContextStateEveryStep = false;
+    int blockDepth = 0;
+    for (auto& computation : computations) {
+        if (computation.type == IfBlockStart || computation.type == WhileBlockStart)
+            blockDepth++;
+        else if (computation.type == BlockEnd)
+            blockDepth--;
+        else if (computation.type == UpdateContextState && blockDepth == 0)
+            updatesContextStateEveryStep = true;
+    }
     context = &contextRef;
     owner = &contextRef.getOwner();
     kernel = context->getPlatform().createKernel(IntegrateCustomStepKernel::Name(), contextRef);
@@ -144,6 +157,8 @@ void CustomIntegrator::step(int steps) {
         throw OpenMMException("This Integrator is not bound to a context!");  
     globalsAreCurrent = false;
     for (int i = 0; i < steps; ++i) {
+        if (!updatesContextStateEveryStep)
+            context->notifyStepListeners();
         kernel.getAs<IntegrateCustomStepKernel>().execute(*context, *this, forcesAreValid);
     }
 }
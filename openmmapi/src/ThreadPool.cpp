@@ -30,31 +30,72 @@
  * -------------------------------------------------------------------------- */
 
 #include "openmm/internal/ThreadPool.h"
+#include "openmm/OpenMMException.h"
 #include "openmm/internal/hardware.h"
+#include <algorithm>
+#include <deque>
+#include <thread>
 
 using namespace std;
 
 namespace OpenMM {
 
+/**
+ * The number of times an idle thread looks for work, yielding in between, before it goes to sleep.
+ */
+static const int MaxIdleSpins = 1000;
+
+class ThreadPool::TaskInfo {
+public:
+    TaskInfo(function<void (ThreadPool&, int)> task) : task(task), remainingDependencies(1), finished(false) {
+        pthread_mutex_init(&lock, NULL);
+    }
+    ~TaskInfo() {
+        pthread_mutex_destroy(&lock);
+    }
+    function<void (ThreadPool&, int)> task;
+    atomic<int> remainingDependencies;
+    atomic<bool> finished;
+    vector<TaskHandle> dependents;
+    pthread_mutex_t lock;
+};
+
 class ThreadPool::ThreadData {
 public:
     ThreadData(ThreadPool& owner, int index) : owner(owner), index(index), isDeleted(false) {
+        pthread_mutex_init(&queueLock, NULL);
+    }
+    ~ThreadData() {
+        pthread_mutex_destroy(&queueLock);
     }
     void executeTask() {
-        if (owner.currentTask != NULL)
-            owner.currentTask->execute(owner, index);
-        else
-            owner.currentFunction(owner, index);
+        try {
+            if (owner.currentTask != NULL)
+                owner.currentTask->execute(owner, index);
+            else
+                owner.currentFunction(owner, index);
+        }
+        catch (...) {
+            owner.recordException(current_exception());
+        }
     }
     ThreadPool& owner;
     int index;
     bool isDeleted;
     Task* currentTask;
     function<void (ThreadPool& pool, int)> currentFunction;
+    deque<TaskHandle> queue;
+    pthread_mutex_t queueLock;
 };
 
+/**
+ * The ThreadData for the worker thread this is called from, or NULL if it is not a worker thread.
+ */
+static thread_local ThreadPool::ThreadData* currentThreadData = NULL;
+
 static void* threadBody(void* args) {
     ThreadPool::ThreadData& data = *reinterpret_cast<ThreadPool::ThreadData*>(args);
+    currentThreadData = &data;
     while (true) {
         // Wait for the signal to start running.
         
@@ -67,12 +108,13 @@ static void* threadBody(void* args) {
     return 0;
 }
 
-ThreadPool::ThreadPool(int numThreads) : currentTask(NULL) {
+ThreadPool::ThreadPool(int numThreads) : currentTask(NULL), activeThreads(0), outstandingTasks(0), workEvents(0), sleepingThreads(0), nextQueue(0), tasksRunning(false) {
     if (numThreads <= 0)
         numThreads = getNumProcessors();
     this->numThreads = numThreads;
     pthread_cond_init(&startCondition, NULL);
     pthread_cond_init(&endCondition, NULL);
+    pthread_cond_init(&workCondition, NULL);
     pthread_mutex_init(&lock, NULL);
     thread.resize(numThreads);
     pthread_mutex_lock(&lock);
@@ -89,6 +131,12 @@ ThreadPool::ThreadPool(int numThreads) : currentTask(NULL) {
 }
 
 ThreadPool::~ThreadPool() {
+    try {
+        finishRunningTasks();
+    }
+    catch (...) {
+        // Nobody is left to report it to.
+    }
     for (auto data : threadData)
         data->isDeleted = true;
     pthread_mutex_lock(&lock);
@@ -99,6 +147,7 @@ ThreadPool::~ThreadPool() {
     pthread_mutex_destroy(&lock);
     pthread_cond_destroy(&startCondition);
     pthread_cond_destroy(&endCondition);
+    pthread_cond_destroy(&workCondition);
 }
 
 int ThreadPool::getNumThreads() const {
@@ -106,11 +155,13 @@ int ThreadPool::getNumThreads() const {
 }
 
 void ThreadPool::execute(Task& task) {
+    finishRunningTasks();
     currentTask = &task;
     resumeThreads();
 }
 
 void ThreadPool::execute(function<void (ThreadPool&, int)> task) {
+    finishRunningTasks();
     currentTask = NULL;
     currentFunction = task;
     resumeThreads();
@@ -128,7 +179,11 @@ void ThreadPool::waitForThreads() {
     pthread_mutex_lock(&lock);
     while (waitCount < numThreads)
         pthread_cond_wait(&endCondition, &lock);
+    exception_ptr exception = pendingException;
+    pendingException = nullptr;
     pthread_mutex_unlock(&lock);
+    if (exception)
+        rethrow_exception(exception);
 }
 
 void ThreadPool::resumeThreads() {
@@ -138,4 +193,229 @@ void ThreadPool::resumeThreads() {
     pthread_mutex_unlock(&lock);
 }
 
+
+ThreadPool::TaskHandle ThreadPool::addTask(function<void (ThreadPool&, int)> task, const vector<TaskHandle>& dependencies) {
+    TaskHandle handle = make_shared<TaskInfo>(task);
+    outstandingTasks++;
+    for (const TaskHandle& dependency : dependencies) {
+        pthread_mutex_lock(&dependency->lock);
+        if (!dependency->finished) {
+            handle->remainingDependencies++;
+            dependency->dependents.push_back(handle);
+        }
+        pthread_mutex_unlock(&dependency->lock);
+    }
+
+    // remainingDependencies started at 1 so the task could not be queued by a dependency finishing
+    // while we were still adding it.  Remove that extra count now.
+
+    if (--handle->remainingDependencies == 0)
+        pushTask(handle, getCurrentThreadIndex());
+    return handle;
+}
+
+void ThreadPool::executeTasks() {
+    finishRunningTasks();
+    if (outstandingTasks == 0)
+        return;
+    activeThreads = numThreads;
+    execute([&] (ThreadPool& threads, int threadIndex) { runTasks(threadIndex); });
+    waitForThreads();
+}
+
+void ThreadPool::startTasks() {
+    if (tasksRunning) {
+        // If any thread is still running tasks, it will pick up the new ones.  A thread only stops after
+        // seeing no outstanding tasks while holding the lock, so it cannot miss tasks that were added
+        // before this check.  Only restart the threads if all of them have stopped.  execute() waits for
+        // them to finish returning from runTasks().
+
+        pthread_mutex_lock(&lock);
+        bool finished = (activeThreads == 0);
+        pthread_mutex_unlock(&lock);
+        if (!finished)
+            return;
+    }
+    if (outstandingTasks == 0)
+        return;
+    activeThreads = numThreads;
+    execute([&] (ThreadPool& threads, int threadIndex) { runTasks(threadIndex); });
+    tasksRunning = true;
+}
+
+void ThreadPool::finishRunningTasks() {
+    if (tasksRunning) {
+        tasksRunning = false;
+        waitForThreads();
+    }
+}
+
+void ThreadPool::waitForTask(const TaskHandle& task) {
+    int threadIndex = getCurrentThreadIndex();
+    if (threadIndex == -1)
+        throw OpenMMException("ThreadPool: waitForTask() may only be called from inside a running task");
+    waitForWork(threadIndex, [&] () { return (bool) task->finished; });
+}
+
+void ThreadPool::parallelFor(int numItems, int chunkSize, function<void (ThreadPool&, int, int, int)> task) {
+    if (numItems <= 0)
+        return;
+    auto remaining = make_shared<atomic<int> >(numItems);
+    auto body = make_shared<RangeFunction>(task);
+    addRangeTask(body, remaining, max(1, chunkSize), 0, numItems);
+    int threadIndex = getCurrentThreadIndex();
+    if (threadIndex == -1)
+        executeTasks();
+    else
+        waitForWork(threadIndex, [&] () { return *remaining == 0; });
+}
+
+void ThreadPool::addRangeTask(shared_ptr<RangeFunction> body, shared_ptr<atomic<int> > remaining, int chunkSize, int start, int end) {
+    addTask([=] (ThreadPool& threads, int threadIndex) {
+        // Repeatedly split off the upper half of the range as a new task until what is left is no
+        // larger than chunkSize.  Idle threads steal from the other end of the queue, so they take
+        // the largest pieces first.
+
+        int last = end;
+        while (last-start > chunkSize) {
+            int middle = start+(last-start)/2;
+            threads.addRangeTask(body, remaining, chunkSize, middle, last);
+            last = middle;
+        }
+        try {
+            (*body)(threads, threadIndex, start, last);
+        }
+        catch (...) {
+            // Count the range as processed so parallelFor() does not wait for it forever.
+
+            *remaining -= last-start;
+            throw;
+        }
+        *remaining -= last-start;
+    });
+}
+
+void ThreadPool::runTasks(int threadIndex) {
+    while (true) {
+        waitForWork(threadIndex, [&] () { return outstandingTasks == 0; });
+
+        // Check again while holding the lock before stopping.  Otherwise startTasks() could add a task
+        // and see this thread as still running just before it stopped, and nothing would run the task.
+
+        pthread_mutex_lock(&lock);
+        bool done = (outstandingTasks == 0);
+        if (done)
+            activeThreads--;
+        pthread_mutex_unlock(&lock);
+        if (done)
+            return;
+    }
+}
+
+int ThreadPool::getCurrentThreadIndex() const {
+    if (currentThreadData != NULL && &currentThreadData->owner == this)
+        return currentThreadData->index;
+    return -1;
+}
+
+void ThreadPool::pushTask(const TaskHandle& task, int threadIndex) {
+    if (threadIndex == -1)
+        threadIndex = (nextQueue++)%numThreads;
+    ThreadData& data = *threadData[threadIndex];
+    pthread_mutex_lock(&data.queueLock);
+    data.queue.push_back(task);
+    pthread_mutex_unlock(&data.queueLock);
+    notifyWaitingThreads();
+}
+
+bool ThreadPool::runNextTask(int threadIndex) {
+    // Take the most recently added task from this thread's own queue.  If it is empty, try to steal
+    // the oldest task from another thread.
+
+    TaskHandle task;
+    for (int i = 0; i < numThreads && !task; i++) {
+        ThreadData& data = *threadData[(threadIndex+i)%numThreads];
+        pthread_mutex_lock(&data.queueLock);
+        if (data.queue.size() > 0) {
+            if (i == 0) {
+                task = data.queue.back();
+                data.queue.pop_back();
+            }
+            else {
+                task = data.queue.front();
+                data.queue.pop_front();
+            }
+        }
+        pthread_mutex_unlock(&data.queueLock);
+    }
+    if (!task)
+        return false;
+    try {
+        task->task(*this, threadIndex);
+    }
+    catch (...) {
+        recordException(current_exception());
+    }
+
+    // Mark it as finished and queue any tasks that were waiting for it.
+
+    pthread_mutex_lock(&task->lock);
+    task->finished = true;
+    vector<TaskHandle> dependents;
+    dependents.swap(task->dependents);
+    pthread_mutex_unlock(&task->lock);
+    for (const TaskHandle& dependent : dependents)
+        if (--dependent->remainingDependencies == 0)
+            pushTask(dependent, threadIndex);
+    outstandingTasks--;
+    notifyWaitingThreads();
+    return true;
+}
+
+void ThreadPool::waitForWork(int threadIndex, const function<bool ()>& isDone) {
+    int idleSpins = 0;
+    while (!isDone()) {
+        // Record the event count before looking for a task.  Anything that could give this thread
+        // something to do, or make isDone() true, increments it afterward, so the thread cannot go
+        // to sleep having missed it.
+
+        int events = workEvents;
+        if (runNextTask(threadIndex)) {
+            idleSpins = 0;
+            continue;
+        }
+        if (++idleSpins < MaxIdleSpins) {
+            this_thread::yield();
+            continue;
+        }
+        pthread_mutex_lock(&lock);
+        sleepingThreads++;
+        while (workEvents == events)
+            pthread_cond_wait(&workCondition, &lock);
+        sleepingThreads--;
+        pthread_mutex_unlock(&lock);
+        idleSpins = 0;
+    }
+}
+
+void ThreadPool::notifyWaitingThreads() {
+    // A sleeping thread increments sleepingThreads before checking workEvents, and we increment
+    // workEvents before checking sleepingThreads, so at least one of us sees the other's change.
+    // Only take the lock when a thread might actually be asleep.
+
+    workEvents++;
+    if (sleepingThreads > 0) {
+        pthread_mutex_lock(&lock);
+        pthread_cond_broadcast(&workCondition);
+        pthread_mutex_unlock(&lock);
+    }
+}
+
+void ThreadPool::recordException(exception_ptr exception) {
+    pthread_mutex_lock(&lock);
+    if (!pendingException)
+        pendingException = exception;
+    pthread_mutex_unlock(&lock);
+}
+
 } // namespace OpenMM
@@ -0,0 +1,384 @@
+
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "openmm/TrajectoryWriter.h"
+#include "openmm/Integrator.h"
+#include "openmm/OpenMMException.h"
+#include "openmm/System.h"
+#include "openmm/internal/ContextImpl.h"
+#include "xdrfile.h"
+#include "xdrfile_xtc.h"
+#include <pthread.h>
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <exception>
+
+using namespace OpenMM;
+using namespace std;
+
+/**
+ * The DCD format measures time in AKMA units.
+ */
+static const double AKMA_TIME_UNIT = 0.04888821;
+
+/**
+ * The precision (in inverse nm) used for XTC files, matching XTCReporter.
+ */
+static const float XTC_PRECISION = 1000.0f;
+
+class TrajectoryWriter::Frame {
+public:
+    vector<Vec3> positions;
+    Vec3 boxVectors[3];
+    double time;
+    long long step;
+};
+
+class TrajectoryWriter::WriterData {
+public:
+    WriterData(TrajectoryWriter& owner, int bufferSize) : owner(owner), frames(bufferSize), firstFrame(0), numBuffered(0),
+            finished(false), dcdFile(NULL), xtcFile(NULL), framesWritten(0) {
+        pthread_mutex_init(&lock, NULL);
+        pthread_cond_init(&condition, NULL);
+    }
+    ~WriterData() {
+        pthread_mutex_destroy(&lock);
+        pthread_cond_destroy(&condition);
+    }
+    TrajectoryWriter& owner;
+    vector<Frame> frames;
+    int firstFrame, numBuffered;
+    bool finished;
+    exception_ptr error;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t condition;
+
+    // These fields are only accessed by the writer thread.
+
+    FILE* dcdFile;
+    XDRFILE* xtcFile;
+    bool periodic;
+    int framesWritten, dcdFirstStep, dcdInterval;
+    float dcdTimeStep;
+    vector<char> buffer;
+    vector<float> coords;
+};
+
+static void appendInt(vector<char>& buffer, int value) {
+    uint32_t bits = (uint32_t) value;
+    for (int i = 0; i < 4; i++)
+        buffer.push_back((char) ((bits>>(8*i))&0xFF));
+}
+
+static void appendFloat(vector<char>& buffer, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    appendInt(buffer, (int) bits);
+}
+
+static void appendDouble(vector<char>& buffer, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    for (int i = 0; i < 8; i++)
+        buffer.push_back((char) ((bits>>(8*i))&0xFF));
+}
+
+static void appendString(vector<char>& buffer, const string& value, int length) {
+    for (int i = 0; i < length; i++)
+        buffer.push_back(i < value.size() ? value[i] : ' ');
+}
+
+static void writeBuffer(FILE* file, vector<char>& buffer) {
+    if (fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size())
+        throw OpenMMException("TrajectoryWriter: Error writing to file");
+    buffer.clear();
+}
+
+void* TrajectoryWriter::threadBody(void* args) {
+    WriterData& data = *reinterpret_cast<WriterData*>(args);
+    pthread_mutex_lock(&data.lock);
+    while (true) {
+        while (data.numBuffered == 0 && !data.finished)
+            pthread_cond_wait(&data.condition, &data.lock);
+        if (data.numBuffered == 0)
+            break;
+        const Frame& frame = data.frames[data.firstFrame];
+        bool failed = (data.error != nullptr);
+        pthread_mutex_unlock(&data.lock);
+
+        // Encode and write the frame without holding the lock, so more frames can be captured meanwhile.
+
+        exception_ptr error;
+        if (!failed) {
+            try {
+                data.owner.writeFrame(frame);
+            }
+            catch (...) {
+                error = current_exception();
+            }
+        }
+        pthread_mutex_lock(&data.lock);
+        if (error != nullptr)
+            data.error = error;
+        data.firstFrame = (data.firstFrame+1)%data.frames.size();
+        data.numBuffered--;
+        pthread_cond_broadcast(&data.condition);
+    }
+    pthread_mutex_unlock(&data.lock);
+    return 0;
+}
+
+TrajectoryWriter::TrajectoryWriter(Context& context, const string& filename, Format format, int interval, const vector<int>& particles, int bufferSize) :
+        context(context), filename(filename), format(format), interval(interval), numFrames(0), particles(particles), data(NULL) {
+    const System& system = context.getSystem();
+    if (interval < 1)
+        throw OpenMMException("TrajectoryWriter: interval must be at least 1");
+    if (bufferSize < 1)
+        throw OpenMMException("TrajectoryWriter: bufferSize must be at least 1");
+    if (format != DCD && format != XTC)
+        throw OpenMMException("TrajectoryWriter: Unknown file format");
+    for (int index : particles)
+        if (index < 0 || index >= system.getNumParticles())
+            throw OpenMMException("TrajectoryWriter: Illegal particle index: "+to_string(index));
+    int numParticles = (particles.empty() ? system.getNumParticles() : particles.size());
+    data = new WriterData(*this, bufferSize);
+    for (Frame& frame : data->frames)
+        frame.positions.resize(numParticles);
+    data->periodic = system.usesPeriodicBoundaryConditions();
+    data->dcdInterval = interval;
+    data->dcdTimeStep = (float) (context.getIntegrator().getStepSize()/AKMA_TIME_UNIT);
+    if (format == DCD)
+        data->dcdFile = fopen(filename.c_str(), "wb");
+    else
+        data->xtcFile = xdrfile_open(filename.c_str(), "w");
+    if (data->dcdFile == NULL && data->xtcFile == NULL) {
+        delete data;
+        throw OpenMMException("TrajectoryWriter: Could not open file "+filename);
+    }
+    pthread_create(&data->thread, NULL, threadBody, data);
+    ContextImpl& impl = context.getImpl();
+    lastStep = impl.getStepCount();
+    listenerId = impl.addStepListener([this] (ContextImpl& impl) {
+        long long step = impl.getStepCount();
+        if (step%this->interval == 0 && step != lastStep)
+            captureFrame(impl, step);
+    });
+}
+
+TrajectoryWriter::~TrajectoryWriter() {
+    ContextImpl& impl = context.getImpl();
+    impl.removeStepListener(listenerId);
+    try {
+        long long step = impl.getStepCount();
+        if (step%interval == 0 && step != lastStep)
+            captureFrame(impl, step);
+    }
+    catch (...) {
+        // Errors cannot be reported from a destructor.
+    }
+    pthread_mutex_lock(&data->lock);
+    data->finished = true;
+    pthread_cond_broadcast(&data->condition);
+    pthread_mutex_unlock(&data->lock);
+    pthread_join(data->thread, NULL);
+    if (data->dcdFile != NULL)
+        fclose(data->dcdFile);
+    if (data->xtcFile != NULL)
+        xdrfile_close(data->xtcFile);
+    delete data;
+}
+
+void TrajectoryWriter::flush() {
+    ContextImpl& impl = context.getImpl();
+    long long step = impl.getStepCount();
+    if (step%interval == 0 && step != lastStep)
+        captureFrame(impl, step);
+    pthread_mutex_lock(&data->lock);
+    while (data->numBuffered > 0)
+        pthread_cond_wait(&data->condition, &data->lock);
+    exception_ptr error = data->error;
+    data->error = nullptr;
+    pthread_mutex_unlock(&data->lock);
+    if (error != nullptr)
+        rethrow_exception(error);
+}
+
+void TrajectoryWriter::captureFrame(ContextImpl& impl, long long step) {
+    // Wait for a free slot in the ring buffer.  Only the writer thread ever touches the slot at
+    // firstFrame, so the new frame can be filled in without holding the lock.
+
+    pthread_mutex_lock(&data->lock);
+    while (data->numBuffered == (int) data->frames.size())
+        pthread_cond_wait(&data->condition, &data->lock);
+    Frame& frame = data->frames[(data->firstFrame+data->numBuffered)%data->frames.size()];
+    pthread_mutex_unlock(&data->lock);
+    if (particles.empty())
+        impl.getPositions(frame.positions);
+    else
+        impl.getPositions(particles, frame.positions);
+    impl.getPeriodicBoxVectors(frame.boxVectors[0], frame.boxVectors[1], frame.boxVectors[2]);
+    frame.time = impl.getTime();
+    frame.step = step;
+    lastStep = step;
+    numFrames++;
+    pthread_mutex_lock(&data->lock);
+    data->numBuffered++;
+    pthread_cond_broadcast(&data->condition);
+    pthread_mutex_unlock(&data->lock);
+}
+
+void TrajectoryWriter::writeDcdHeader(const Frame& frame) {
+    // This matches the header written by DCDFile in the Python application layer.
+
+    vector<char>& buffer = data->buffer;
+    long long firstStep = frame.step-interval;
+    if (data->dcdInterval > 1 && frame.step > INT_MAX) {
+        // The first step is already out of range for a 32 bit integer.  Describe the trajectory as a
+        // smaller number of larger steps, as writeFrame() does when later frames go out of range.
+
+        firstStep /= data->dcdInterval;
+        data->dcdTimeStep *= data->dcdInterval;
+        data->dcdInterval = 1;
+    }
+    data->dcdFirstStep = (int) min(firstStep, (long long) INT_MAX);
+    appendInt(buffer, 84);
+    appendString(buffer, "CORD", 4);
+    appendInt(buffer, 0);
+    appendInt(buffer, data->dcdFirstStep);
+    appendInt(buffer, data->dcdInterval);
+    for (int i = 0; i < 6; i++)
+        appendInt(buffer, 0);
+    appendFloat(buffer, data->dcdTimeStep);
+    appendInt(buffer, data->periodic ? 1 : 0);
+    for (int i = 0; i < 8; i++)
+        appendInt(buffer, 0);
+    appendInt(buffer, 24);
+    appendInt(buffer, 84);
+    appendInt(buffer, 164);
+    appendInt(buffer, 2);
+    string created = "Created by OpenMM";
+    created.resize(80, '\0');
+    buffer.insert(buffer.end(), created.begin(), created.end());
+    time_t now = time(NULL);
+    string date = asctime(localtime(&now));
+    if (!date.empty() && date[date.size()-1] == '\n')
+        date.resize(date.size()-1);
+    date = "Created "+date;
+    date.resize(80, '\0');
+    buffer.insert(buffer.end(), date.begin(), date.end());
+    appendInt(buffer, 164);
+    appendInt(buffer, 4);
+    appendInt(buffer, frame.positions.size());
+    appendInt(buffer, 4);
+    writeBuffer(data->dcdFile, buffer);
+}
+
+void TrajectoryWriter::writeFrame(const Frame& frame) {
+    int numParticles = frame.positions.size();
+    const Vec3* box = frame.boxVectors;
+    if (format == XTC) {
+        vector<float>& coords = data->coords;
+        coords.resize(3*numParticles);
+        for (int i = 0; i < numParticles; i++)
+            for (int j = 0; j < 3; j++)
+                coords[3*i+j] = (float) frame.positions[i][j];
+        matrix boxMatrix;
+        for (int i = 0; i < 3; i++)
+            for (int j = 0; j < 3; j++)
+                boxMatrix[i][j] = (data->periodic ? (float) box[i][j] : 0.0f);
+        if (write_xtc(data->xtcFile, numParticles, (int) min(frame.step, (long long) INT_MAX), (float) frame.time, boxMatrix, (rvec*) coords.data(), XTC_PRECISION) != exdrOK)
+            throw OpenMMException("TrajectoryWriter: Error writing to file "+filename);
+        data->framesWritten++;
+        return;
+    }
+    FILE* file = data->dcdFile;
+    vector<char>& buffer = data->buffer;
+    if (data->framesWritten == 0)
+        writeDcdHeader(frame);
+    data->framesWritten++;
+    if (data->dcdInterval > 1 && data->dcdFirstStep+(long long) data->framesWritten*data->dcdInterval > (1LL<<31)) {
+        // This will exceed the range of a 32 bit integer.  Rewrite the header to describe a smaller
+        // number of larger steps, so the total length of the trajectory remains correct.
+
+        data->dcdFirstStep /= data->dcdInterval;
+        data->dcdTimeStep *= data->dcdInterval;
+        data->dcdInterval = 1;
+        appendInt(buffer, data->dcdFirstStep);
+        appendInt(buffer, data->dcdInterval);
+        fseek(file, 12, SEEK_SET);
+        writeBuffer(file, buffer);
+        appendFloat(buffer, data->dcdTimeStep);
+        fseek(file, 44, SEEK_SET);
+        writeBuffer(file, buffer);
+    }
+
+    // Update the frame count and last step in the header.
+
+    appendInt(buffer, data->framesWritten);
+    fseek(file, 8, SEEK_SET);
+    writeBuffer(file, buffer);
+    appendInt(buffer, (int) min(data->dcdFirstStep+(long long) data->framesWritten*data->dcdInterval, (long long) INT_MAX));
+    fseek(file, 20, SEEK_SET);
+    writeBuffer(file, buffer);
+    fseek(file, 0, SEEK_END);
+
+    // Write the frame.
+
+    if (data->periodic) {
+        double a = sqrt(box[0].dot(box[0]));
+        double b = sqrt(box[1].dot(box[1]));
+        double c = sqrt(box[2].dot(box[2]));
+        appendInt(buffer, 48);
+        appendDouble(buffer, 10*a);
+        appendDouble(buffer, box[0].dot(box[1])/(a*b));
+        appendDouble(buffer, 10*b);
+        appendDouble(buffer, box[2].dot(box[0])/(c*a));
+        appendDouble(buffer, box[1].dot(box[2])/(b*c));
+        appendDouble(buffer, 10*c);
+        appendInt(buffer, 48);
+    }
+    for (int j = 0; j < 3; j++) {
+        appendInt(buffer, 4*numParticles);
+        for (int i = 0; i < numParticles; i++)
+            appendFloat(buffer, (float) (10*frame.positions[i][j]));
+        appendInt(buffer, 4*numParticles);
+    }
+    writeBuffer(file, buffer);
+    if (fflush(file) != 0)
+        throw OpenMMException("TrajectoryWriter: Error writing to file "+filename);
+}
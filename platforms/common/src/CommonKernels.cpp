@@ -214,6 +214,68 @@ void CommonUpdateStateDataKernel::getPositions(ContextImpl& context, vector<Vec3
     cc.getThreadPool().waitForThreads();
 }
 
+const vector<int>& CommonUpdateStateDataKernel::getSortedIndex(const vector<int>& indices) {
+    const vector<int>& order = cc.getAtomIndex();
+    bool valid = (sortedIndex.size() == order.size());
+    for (int i = 0; valid && i < indices.size(); i++)
+        valid = (order[sortedIndex[indices[i]]] == indices[i]);
+    if (!valid) {
+        sortedIndex.resize(order.size());
+        for (int i = 0; i < order.size(); i++)
+            sortedIndex[order[i]] = i;
+    }
+    return sortedIndex;
+}
+
+void CommonUpdateStateDataKernel::getPositions(ContextImpl& context, const vector<int>& indices, vector<Vec3>& positions) {
+    ContextSelector selector(cc);
+    const vector<int>& sorted = getSortedIndex(indices);
+    Vec3 boxVectors[3];
+    cc.getPeriodicBoxVectors(boxVectors[0], boxVectors[1], boxVectors[2]);
+    int numIndices = indices.size();
+    positions.resize(numIndices);
+    auto setPosition = [&] (int i, int atom, double x, double y, double z) {
+        mm_int4 offset = cc.getPosCellOffsets()[atom];
+        positions[i] = Vec3(x, y, z)-boxVectors[0]*offset.x-boxVectors[1]*offset.y-boxVectors[2]*offset.z;
+    };
+    if (cc.getPrecision() == PrecisionLevel::Double) {
+        mm_double4* posq = (mm_double4*) cc.getPinnedBuffer();
+        cc.getPosq().download(posq);
+        for (int i = 0; i < numIndices; i++) {
+            int atom = sorted[indices[i]];
+            setPosition(i, atom, posq[atom].x, posq[atom].y, posq[atom].z);
+        }
+    }
+    else if (cc.getPrecision() == PrecisionLevel::Mixed) {
+        mm_float4* posq = (mm_float4*) cc.getPinnedBuffer();
+        cc.getPosq().download(posq, false);
+        vector<mm_float4> posCorrection;
+        cc.getPosqCorrection().download(posCorrection);
+        for (int i = 0; i < numIndices; i++) {
+            int atom = sorted[indices[i]];
+            mm_float4 pos1 = posq[atom];
+            mm_float4 pos2 = posCorrection[atom];
+            setPosition(i, atom, (double) pos1.x+(double) pos2.x, (double) pos1.y+(double) pos2.y, (double) pos1.z+(double) pos2.z);
+        }
+    }
+    else if (cc.getPrecision() == PrecisionLevel::Single) {
+        mm_float4* posq = (mm_float4*) cc.getPinnedBuffer();
+        cc.getPosq().download(posq);
+        for (int i = 0; i < numIndices; i++) {
+            int atom = sorted[indices[i]];
+            setPosition(i, atom, posq[atom].x, posq[atom].y, posq[atom].z);
+        }
+    }
+    else if (cc.getPrecision() == PrecisionLevel::F16) {
+        mm_half4* posq = (mm_half4*) cc.getPinnedBuffer();
+        cc.getPosq().download(posq);
+        for (int i = 0; i < numIndices; i++) {
+            int atom = sorted[indices[i]];
+            setPosition(i, atom, posq[atom].x, posq[atom].y, posq[atom].z);
+        }
+    }
+}
+
 void CommonUpdateStateDataKernel::setPositions(ContextImpl& context, const vector<Vec3>& positions) {
     ContextSelector selector(cc);
     const vector<int>& order = cc.getAtomIndex();
@@ -312,6 +374,38 @@ void CommonUpdateStateDataKernel::getVelocities(ContextImpl& context, vector<Vec
     
 }
 
+void CommonUpdateStateDataKernel::getVelocities(ContextImpl& context, const vector<int>& indices, vector<Vec3>& velocities) {
+    ContextSelector selector(cc);
+    const vector<int>& sorted = getSortedIndex(indices);
+    int numIndices = indices.size();
+    velocities.resize(numIndices);
+    if ((cc.getPrecision() == PrecisionLevel::Double)
+	     || (cc.getPrecision() == PrecisionLevel::Mixed)){
+        mm_double4* velm = (mm_double4*) cc.getPinnedBuffer();
+        cc.getVelm().download(velm);
+        for (int i = 0; i < numIndices; i++) {
+            mm_double4 vel = velm[sorted[indices[i]]];
+            velocities[i] = Vec3(vel.x, vel.y, vel.z);
+        }
+    }
+    else if(cc.getPrecision() == PrecisionLevel::Single) {
+        mm_float4* velm = (mm_float4*) cc.getPinnedBuffer();
+        cc.getVelm().download(velm);
+        for (int i = 0; i < numIndices; i++) {
+            mm_float4 vel = velm[sorted[indices[i]]];
+            velocities[i] = Vec3(vel.x, vel.y, vel.z);
+        }
+    }
+    else if(cc.getPrecision() == PrecisionLevel::F16) {
+        mm_half4* velm = (mm_half4*) cc.getPinnedBuffer();
+        cc.getVelm().download(velm);
+        for (int i = 0; i < numIndices; i++) {
+            mm_half4 vel = velm[sorted[indices[i]]];
+            velocities[i] = Vec3(vel.x, vel.y, vel.z);
+        }
+    }
+}
+
 void CommonUpdateStateDataKernel::setVelocities(ContextImpl& context, const vector<Vec3>& velocities) {
     ContextSelector selector(cc);
     const vector<int>& order = cc.getAtomIndex();
@@ -378,6 +472,21 @@ void CommonUpdateStateDataKernel::getForces(ContextImpl& context, vector<Vec3>&
         forces[order[i]] = Vec3(scale*force[i], scale*force[i+paddedNumParticles], scale*force[i+paddedNumParticles*2]);
 }
 
+void CommonUpdateStateDataKernel::getForces(ContextImpl& context, const vector<int>& indices, vector<Vec3>& forces) {
+    ContextSelector selector(cc);
+    long long* force = (long long*) cc.getPinnedBuffer();
+    cc.getLongForceBuffer().download(force);
+    const vector<int>& sorted = getSortedIndex(indices);
+    int paddedNumParticles = cc.getPaddedNumAtoms();
+    int numIndices = indices.size();
+    forces.resize(numIndices);
+    double scale = 1.0/(double) 0x100000000LL;
+    for (int i = 0; i < numIndices; i++) {
+        int atom = sorted[indices[i]];
+        forces[i] = Vec3(scale*force[atom], scale*force[atom+paddedNumParticles], scale*force[atom+paddedNumParticles*2]);
+    }
+}
+
 void CommonUpdateStateDataKernel::getEnergyParameterDerivatives(ContextImpl& context, map<string, double>& derivs) {
     ContextSelector selector(cc);
     const vector<string>& paramDerivNames = cc.getEnergyParamDerivNames();
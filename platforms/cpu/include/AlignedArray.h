@@ -32,6 +32,9 @@
  * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
  * -------------------------------------------------------------------------- */
 
+#include "openmm/OpenMMException.h"
+#include <cstdlib>
+
 namespace OpenMM {
 
 /**
@@ -55,7 +58,7 @@ public:
     }
     ~AlignedArray() {
         if (baseData != 0)
-            delete[] baseData;
+            free(baseData);
     }
     /**
      * Get the number of elements in the array.
@@ -70,9 +73,19 @@ public:
         if (dataSize == size)
             return;
         if (baseData != 0)
-            delete[] baseData;
+            free(baseData);
         allocate(size);
     }
+    /**
+     * Change the size of the array and set all elements to zero.  The memory is obtained with calloc(), so
+     * for a large array the operating system does not commit physical memory to a page until something
+     * is written to it.
+     */
+    void resizeZeroed(int size) {
+        if (baseData != 0)
+            free(baseData);
+        allocate(size, true);
+    }
     /**
      * Get a reference to an element of the array.
      */
@@ -86,9 +99,14 @@ public:
         return data[i];
     }
 private:
-    void allocate(int size) {
+    void allocate(int size, bool zero=false) {
+        baseData = (char*) (zero ? calloc(size*sizeof(T)+16, 1) : malloc(size*sizeof(T)+16));
+        if (baseData == 0) {
+            dataSize = 0;
+            data = 0;
+            throw OpenMMException("AlignedArray: Failed to allocate memory");
+        }
         dataSize = size;
-        baseData = new char[size*sizeof(T)+16];
         char* offsetData = baseData+15;
         offsetData -= (long long)offsetData&0xF;
         data = (T*) offsetData;
@@ -57,10 +57,25 @@ public:
     void calculateForce(std::vector<OpenMM::Vec3>& atomCoordinates, std::vector<std::vector<double> >& parameters, std::vector<OpenMM::Vec3>& forces, 
             double* totalEnergy, ReferenceBondIxn& referenceBondIxn);
     /**
-     * This routine contains the code executed by each thread.
+     * Compute the forces from one of the sets of bonds that initialize() created.  This is executed
+     * as a task by whichever thread is free.
      */
-    void threadComputeForce(ThreadPool& threads, int threadIndex, std::vector<OpenMM::Vec3>& atomCoordinates, std::vector<std::vector<double> >& parameters,
+    void threadComputeForce(ThreadPool& threads, int bondSet, std::vector<OpenMM::Vec3>& atomCoordinates, std::vector<std::vector<double> >& parameters,
             std::vector<OpenMM::Vec3>& forces, double* totalEnergy, ReferenceBondIxn& referenceBondIxn);
+    /**
+     * Get the bonds that initialize() assigned to each thread.  No two threads share an atom, so
+     * the bonds for different threads may be processed in parallel.
+     */
+    const std::vector<std::vector<int> >& getThreadBonds() const {
+        return threadBonds;
+    }
+    /**
+     * Get the bonds that could not be assigned to any single thread.  These must be processed
+     * after all threads have finished.
+     */
+    const std::vector<int>& getExtraBonds() const {
+        return extraBonds;
+    }
 private:
     bool canAssignBond(int bond, int thread, std::vector<int>& atomThread);
     void assignBond(int bond, int thread, std::vector<int>& atomThread, std::vector<int>& bondThread, std::vector<std::set<int> >& atomBonds, std::list<int>& candidateBonds);
@@ -0,0 +1,109 @@
+#ifndef OPENMM_CPUCCMA_H_
+#define OPENMM_CPUCCMA_H_
+
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "ReferenceCCMAAlgorithm.h"
+#include "windowsExportCpu.h"
+#include "openmm/internal/ThreadPool.h"
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace OpenMM {
+
+/**
+ * This class applies CCMA in parallel.  Constraints are divided into clusters that share no atoms with each other.
+ * Since the inverse constraint matrix never couples two different clusters, each one can be updated independently.
+ * The clusters are grouped into blocks, and the blocks are processed by multiple threads.  All blocks perform the
+ * same number of iterations, so the results are identical to ReferenceCCMAAlgorithm.
+ * 
+ * This works well for systems whose constraints form many small clusters, such as when only bonds involving hydrogen
+ * are constrained.  If most constraints belong to a single cluster, use CpuLINCS instead.
+ */
+class OPENMM_EXPORT_CPU CpuCCMA : public ReferenceConstraintAlgorithm {
+public:
+    CpuCCMA(const ReferenceCCMAAlgorithm& ccma, ThreadPool& threads);
+
+    /**
+     * Apply the constraint algorithm.
+     * 
+     * @param atomCoordinates  the original atom coordinates
+     * @param atomCoordinatesP the new atom coordinates
+     * @param inverseMasses    1/mass
+     * @param tolerance        the constraint tolerance
+     */
+    void apply(std::vector<OpenMM::Vec3>& atomCoordinates, std::vector<OpenMM::Vec3>& atomCoordinatesP, std::vector<double>& inverseMasses, double tolerance);
+
+    /**
+     * Apply the constraint algorithm to velocities.
+     * 
+     * @param atomCoordinates  the atom coordinates
+     * @param atomCoordinatesP the velocities to modify
+     * @param inverseMasses    1/mass
+     * @param tolerance        the constraint tolerance
+     */
+    void applyToVelocities(std::vector<OpenMM::Vec3>& atomCoordinates, std::vector<OpenMM::Vec3>& velocities, std::vector<double>& inverseMasses, double tolerance);
+
+    /**
+     * Get the number of blocks the constraints have been divided into.
+     */
+    int getNumBlocks() const {
+        return blocks.size();
+    }
+private:
+    /**
+     * A set of clusters that is processed by a single thread.  The matrix uses indices within the block.
+     */
+    class ConstraintBlock {
+    public:
+        std::vector<std::pair<int, int> > atomIndices;
+        std::vector<double> distance;
+        std::vector<std::vector<std::pair<int, double> > > matrix;
+        std::vector<Vec3> r_ij;
+        std::vector<double> d_ij2, reducedMasses, constraintDelta, tempDelta;
+        bool hasInitializedMasses;
+    };
+    void executeOnBlocks(std::function<void (ConstraintBlock&, int)> task);
+    void initializeBlock(ConstraintBlock& block, std::vector<OpenMM::Vec3>& atomCoordinates, std::vector<double>& inverseMasses);
+    bool computeBlockDeltas(ConstraintBlock& block, std::vector<OpenMM::Vec3>& atomCoordinatesP, bool constrainingVelocities, double tolerance);
+    void updateBlock(ConstraintBlock& block, std::vector<OpenMM::Vec3>& atomCoordinatesP, std::vector<double>& inverseMasses);
+    void applyConstraints(std::vector<OpenMM::Vec3>& atomCoordinates, std::vector<OpenMM::Vec3>& atomCoordinatesP,
+            std::vector<double>& inverseMasses, bool constrainingVelocities, double tolerance);
+    std::vector<ConstraintBlock> blocks;
+    ThreadPool& threads;
+    int maxIterations;
+};
+
+} // namespace OpenMM
+
+#endif /*OPENMM_CPUCCMA_H_*/
@@ -0,0 +1,155 @@
+#ifndef OPENMM_CPUCUSTOMCOMPOUNDBONDFORCE_H_
+#define OPENMM_CPUCUSTOMCOMPOUNDBONDFORCE_H_
+
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+
+#include "CpuBondForce.h"
+#include "openmm/Vec3.h"
+#include "openmm/internal/ThreadPool.h"
+#include "lepton/CompiledVectorExpression.h"
+#include "lepton/ExpressionTreeNode.h"
+#include "lepton/ParsedExpression.h"
+#include <map>
+#include <string>
+#include <vector>
+
+namespace OpenMM {
+
+/**
+ * This class computes the interactions of a CustomCompoundBondForce on the CPU.  It also computes
+ * the interactions between groups for CustomCentroidBondForce, with the group centers playing the
+ * role of particles.
+ *
+ * The bonds are divided between threads with CpuBondForce, so no two threads ever apply forces
+ * to the same particle.  Each thread collects its bonds into blocks and evaluates the energy and all
+ * its derivatives for a full block at once with a CompiledVectorExpression.  Distances, angles, and
+ * dihedrals are computed in double precision before evaluating the expression, and their derivatives
+ * are converted to forces afterward.
+ */
+class CpuCustomCompoundBondForce {
+public:
+    /**
+     * Create a CpuCustomCompoundBondForce.
+     *
+     * @param numParticles          the number of particles (or groups) bonds may involve
+     * @param bondParticles         bondParticles[i] contains the indices of the particles in bond i
+     * @param energyExpression      the expression for the energy of a bond, as created by prepareExpression() on
+     *                              CustomCompoundBondForceImpl or CustomCentroidBondForceImpl
+     * @param bondParameterNames    the names of the per-bond parameters
+     * @param energyParamDerivNames the names of parameters to compute energy derivatives with respect to
+     * @param threads               the ThreadPool to use for computing forces
+     */
+    CpuCustomCompoundBondForce(int numParticles, const std::vector<std::vector<int> >& bondParticles, const Lepton::ParsedExpression& energyExpression,
+            const std::vector<std::string>& bondParameterNames, const std::vector<std::string>& energyParamDerivNames, ThreadPool& threads);
+    ~CpuCustomCompoundBondForce();
+    /**
+     * Set the force to use periodic boundary conditions.
+     *
+     * @param periodicBoxVectors    the vectors defining the periodic box
+     */
+    void setPeriodic(Vec3* periodicBoxVectors);
+    /**
+     * Get the particles in each bond.
+     */
+    const std::vector<std::vector<int> >& getBondParticles() const {
+        return bondParticles;
+    }
+    /**
+     * Calculate the interaction.
+     *
+     * @param positions          the positions of all particles
+     * @param bondParameters     bondParameters[i][j] is the value of parameter j for bond i
+     * @param globalParameters   the values of global parameters
+     * @param forces             the forces are added to this
+     * @param totalEnergy        if not NULL, the energy is added to this
+     * @param energyParamDerivs  the derivatives of the energy with respect to parameters are added to this
+     */
+    void calculateIxn(std::vector<Vec3>& positions, std::vector<std::vector<double> >& bondParameters, const std::map<std::string, double>& globalParameters,
+            std::vector<Vec3>& forces, double* totalEnergy, double* energyParamDerivs);
+private:
+    class ThreadData;
+    /**
+     * A distance, angle, or dihedral the energy depends on.  The indices refer to the particles
+     * within a bond.
+     */
+    struct TermInfo {
+        enum TermType {Distance = 0, Angle = 1, Dihedral = 2};
+        std::string name;
+        TermType type;
+        std::vector<int> particles;
+    };
+    /**
+     * A particle coordinate the energy depends on directly.
+     */
+    struct CoordinateInfo {
+        std::string name;
+        int particle, component;
+    };
+    /**
+     * Replace calls to point functions whose arguments are particle coordinates with variables
+     * for the corresponding terms.
+     */
+    Lepton::ExpressionTreeNode replacePointFunctions(const Lepton::ExpressionTreeNode& node, std::map<std::string, int>& termIndex);
+    /**
+     * Compute a set of bonds.
+     */
+    void computeBonds(const std::vector<int>& bonds, ThreadData& data);
+    /**
+     * Compute the variables for one bond and store them in a lane of the current block.
+     */
+    void addBondToBlock(int bond, ThreadData& data);
+    /**
+     * Evaluate the expressions for the current block and apply the resulting forces and energy.
+     */
+    void computeBlock(ThreadData& data);
+    void computeDelta(int particle1, int particle2, double* delta) const;
+    ThreadPool& threads;
+    CpuBondForce partition;
+    bool usePeriodic;
+    Vec3 periodicBoxVectors[3];
+    std::vector<std::vector<int> > bondParticles;
+    std::vector<std::string> bondParamNames;
+    std::vector<TermInfo> terms;
+    std::vector<CoordinateInfo> coordinates;
+    int numParamDerivs;
+    std::vector<ThreadData*> threadData;
+    // The following variables are used to make information accessible to the individual threads.
+    std::vector<Vec3>* positions;
+    std::vector<Vec3>* forces;
+    std::vector<double>* bondParameters;
+    bool includeEnergy;
+};
+
+} // namespace OpenMM
+
+#endif /*OPENMM_CPUCUSTOMCOMPOUNDBONDFORCE_H_*/
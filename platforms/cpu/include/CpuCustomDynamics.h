@@ -0,0 +1,81 @@
+/* Portions copyright (c) 2026 Stanford University and Simbios.
+ * Authors: Peter Eastman
+ * Contributors: 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CPU_CUSTOM_DYNAMICS_H__
+#define __CPU_CUSTOM_DYNAMICS_H__
+
+#include "ReferenceCustomDynamics.h"
+#include "CpuRandom.h"
+#include "openmm/internal/ThreadPool.h"
+
+namespace OpenMM {
+
+/**
+ * This class executes a CustomIntegrator using multiple threads.  Consecutive ComputePerDof steps, optionally
+ * followed by a ComputeSum step, are executed in a single pass over the degrees of freedom, so the per-DOF
+ * data is only loaded from memory once for the whole sequence.  The degrees of freedom are processed in chunks
+ * of a fixed size.  Each chunk draws its random numbers in double precision from its own stream, whichever thread
+ * processes it, so random numbers are generated in parallel and the results do not depend on the number of threads.
+ */
+class CpuCustomDynamics : public ReferenceCustomDynamics {
+public:
+    /**
+     * Constructor.
+     *
+     * @param numberOfAtoms  number of atoms
+     * @param integrator     the integrator definition to use
+     * @param threads        thread pool for parallelizing computation
+     * @param random         random number generator
+     */
+    CpuCustomDynamics(int numberOfAtoms, const OpenMM::CustomIntegrator& integrator, OpenMM::ThreadPool& threads, OpenMM::CpuRandom& random);
+
+    /**
+     * Destructor.
+     */
+    ~CpuCustomDynamics();
+
+protected:
+    void computePerDofSteps(const std::vector<int>& steps, int numberOfAtoms, std::vector<OpenMM::Vec3>& atomCoordinates,
+                  std::vector<OpenMM::Vec3>& velocities, const std::vector<std::vector<OpenMM::Vec3>*>& stepForces, const std::vector<double>& stepEnergy,
+                  std::vector<double>& masses, std::map<std::string, double>& globals, std::vector<std::vector<OpenMM::Vec3> >& perDof);
+
+    bool canFuseSteps() const {
+        return true;
+    }
+
+private:
+    class ThreadData;
+    void createThreadData();
+    OpenMM::ThreadPool& threads;
+    OpenMM::CpuRandom& random;
+    OpenMM::CpuRandom chunkRandom;
+    std::vector<ThreadData*> threadData;
+    std::vector<double> chunkSum;
+    std::vector<bool> stepUsesUniform, stepUsesGaussian;
+    std::map<std::string, double> globalValues;
+};
+
+} // namespace OpenMM
+
+#endif // __CPU_CUSTOM_DYNAMICS_H__
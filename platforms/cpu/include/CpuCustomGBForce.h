@@ -47,7 +47,7 @@ private:
     const CpuNeighborList* neighborList;
     float periodicBoxSize[3];
     float cutoffDistance, cutoffDistance2;
-    int numValues, numParams;
+    int numValues, numParams, numParamDerivs;
     const std::vector<std::set<int> > exclusions;
     std::vector<CustomGBForce::ComputationType> valueTypes;
     std::vector<CustomGBForce::ComputationType> energyTypes;
@@ -183,21 +183,28 @@ public:
 
     /**
      * Construct a new CpuCustomGBForce.
+     *
+     * Each computed value and each energy term is compiled into a single expression that also computes the
+     * derivatives needed along with it, so subexpressions they share are only evaluated once.  The results of
+     * each one appear in the following order.
+     *
+     * Computed values: the value, then its derivatives with respect to each of the numParamDerivs parameters.
+     *
+     * Energy terms: the energy, then its derivatives with respect to r (particle pair terms only) and each
+     * computed value (for particle pair terms, the first and second particle's value alternate), then its
+     * gradient with respect to x, y, and z (single particle terms only), then its derivatives with respect to
+     * each of the numParamDerivs parameters.
      */
 
      CpuCustomGBForce(int numAtoms, const std::vector<std::set<int> >& exclusions,
                         const std::vector<Lepton::CompiledExpression>& valueExpressions,
                         const std::vector<std::vector<Lepton::CompiledExpression> >& valueDerivExpressions,
                         const std::vector<std::vector<Lepton::CompiledExpression> >& valueGradientExpressions,
-                        const std::vector<std::vector<Lepton::CompiledExpression> >& valueParamDerivExpressions,
                         const std::vector<std::string>& valueNames,
                         const std::vector<CustomGBForce::ComputationType>& valueTypes,
                         const std::vector<Lepton::CompiledExpression>& energyExpressions,
-                        const std::vector<std::vector<Lepton::CompiledExpression> >& energyDerivExpressions,
-                        const std::vector<std::vector<Lepton::CompiledExpression> >& energyGradientExpressions,
-                        const std::vector<std::vector<Lepton::CompiledExpression> >& energyParamDerivExpressions,
                         const std::vector<CustomGBForce::ComputationType>& energyTypes,
-                        const std::vector<std::string>& parameterNames, ThreadPool& threads);
+                        int numParamDerivs, const std::vector<std::string>& parameterNames, ThreadPool& threads);
 
      ~CpuCustomGBForce();
 
@@ -242,23 +249,16 @@ public:
                const std::vector<Lepton::CompiledExpression>& valueExpressions,
                const std::vector<std::vector<Lepton::CompiledExpression> >& valueDerivExpressions,
                const std::vector<std::vector<Lepton::CompiledExpression> >& valueGradientExpressions,
-               const std::vector<std::vector<Lepton::CompiledExpression> >& valueParamDerivExpressions,
                const std::vector<std::string>& valueNames,
                const std::vector<Lepton::CompiledExpression>& energyExpressions,
-               const std::vector<std::vector<Lepton::CompiledExpression> >& energyDerivExpressions,
-               const std::vector<std::vector<Lepton::CompiledExpression> >& energyGradientExpressions,
-               const std::vector<std::vector<Lepton::CompiledExpression> >& energyParamDerivExpressions,
-               const std::vector<std::string>& parameterNames);
+               int numParamDerivs, const std::vector<std::string>& parameterNames);
     CompiledExpressionSet expressionSet;
     std::vector<Lepton::CompiledExpression> valueExpressions;
     std::vector<std::vector<Lepton::CompiledExpression> > valueDerivExpressions;
     std::vector<std::vector<Lepton::CompiledExpression> > valueGradientExpressions;
-    std::vector<std::vector<Lepton::CompiledExpression> > valueParamDerivExpressions;
     std::vector<double> value;
     std::vector<Lepton::CompiledExpression> energyExpressions;
-    std::vector<std::vector<Lepton::CompiledExpression> > energyDerivExpressions;
-    std::vector<std::vector<Lepton::CompiledExpression> > energyGradientExpressions;
-    std::vector<std::vector<Lepton::CompiledExpression> > energyParamDerivExpressions;
+    std::vector<double> expressionResult;
     std::vector<double> param;
     std::vector<double> particleParam;
     std::vector<double> particleValue;
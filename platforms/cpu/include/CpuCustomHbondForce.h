@@ -0,0 +1,168 @@
+#ifndef OPENMM_CPUCUSTOMHBONDFORCE_H_
+#define OPENMM_CPUCUSTOMHBONDFORCE_H_
+
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+
+#include "AlignedArray.h"
+#include "openmm/CustomHbondForce.h"
+#include "openmm/Vec3.h"
+#include "openmm/internal/ThreadPool.h"
+#include "lepton/CompiledVectorExpression.h"
+#include <atomic>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace OpenMM {
+
+/**
+ * This class computes the interactions of a CustomHbondForce on the CPU.  When a cutoff
+ * is used, the primary acceptor atoms are sorted into a grid of cells at least as wide as
+ * the cutoff, so each donor only needs to consider the acceptors in its own and neighboring
+ * cells.  Donors are divided dynamically between threads.  Each thread collects the pairs
+ * it needs to compute into blocks and evaluates the energy and all its derivatives for a
+ * full block at once with a CompiledVectorExpression.
+ */
+class CpuCustomHbondForce {
+public:
+    /**
+     * Create a CpuCustomHbondForce.
+     *
+     * @param force      the CustomHbondForce to compute
+     * @param threads    the ThreadPool to use for computing forces
+     */
+    CpuCustomHbondForce(const CustomHbondForce& force, ThreadPool& threads);
+    ~CpuCustomHbondForce();
+    /**
+     * Set the force to use a cutoff.
+     *
+     * @param distance    the cutoff distance
+     */
+    void setUseCutoff(double distance);
+    /**
+     * Set the force to use periodic boundary conditions.  This requires that a cutoff has
+     * also been set, and the smallest side of the periodic box is at least twice the cutoff
+     * distance.
+     *
+     * @param periodicBoxVectors    the vectors defining the periodic box
+     */
+    void setPeriodic(Vec3* periodicBoxVectors);
+    /**
+     * Get the atoms in each donor group.
+     */
+    const std::vector<std::vector<int> >& getDonorAtoms() const {
+        return donorAtoms;
+    }
+    /**
+     * Get the atoms in each acceptor group.
+     */
+    const std::vector<std::vector<int> >& getAcceptorAtoms() const {
+        return acceptorAtoms;
+    }
+    /**
+     * Calculate the interaction.
+     *
+     * @param posq                atom coordinates in float format
+     * @param donorParameters     donorParameters[i][j] is the value of parameter j for donor i
+     * @param acceptorParameters  acceptorParameters[i][j] is the value of parameter j for acceptor i
+     * @param globalParameters    the values of global parameters
+     * @param threadForce         the collection of arrays for each thread to add forces to
+     * @param includeForces       whether to compute forces
+     * @param includeEnergy       whether to compute energy
+     * @param energy              the energy is added to this
+     */
+    void calculateIxn(AlignedArray<float>& posq, std::vector<std::vector<double> >& donorParameters, std::vector<std::vector<double> >& acceptorParameters,
+            const std::map<std::string, double>& globalParameters, std::vector<AlignedArray<float> >& threadForce,
+            bool includeForces, bool includeEnergy, double& energy);
+private:
+    class ThreadData;
+    /**
+     * A distance, angle, or dihedral the energy depends on.  The atom indices refer to
+     * the six atoms of a pair in the order a1, a2, a3, d1, d2, d3.
+     */
+    struct TermInfo {
+        enum TermType {Distance = 0, Angle = 1, Dihedral = 2};
+        std::string name;
+        TermType type;
+        std::vector<int> atoms;
+    };
+    void threadComputeForce(ThreadPool& threads, int threadIndex);
+    /**
+     * Sort the primary acceptor atoms into cells.
+     */
+    void buildCellList();
+    /**
+     * Get the position of an atom in units of cells along each axis of the grid.
+     */
+    void getCellCoordinates(int atom, double* coords) const;
+    /**
+     * Find the cells along one axis that may contain acceptors within the cutoff of a donor.
+     */
+    void findCellRange(int axis, double coordinate, int& first, int& last) const;
+    /**
+     * Compute the variables for one donor-acceptor pair and store them in a lane of the current block.
+     */
+    void addPairToBlock(int donor, int acceptor, ThreadData& data);
+    /**
+     * Evaluate the expressions for the current block and accumulate the resulting forces and energy.
+     */
+    void computeBlock(ThreadData& data);
+    void computeDelta(int atom1, int atom2, double* delta) const;
+    static double computeAngle(const double* vec1, const double* vec2);
+    ThreadPool& threads;
+    bool useCutoff, usePeriodic, useCellList;
+    double cutoffDistance;
+    Vec3 periodicBoxVectors[3];
+    std::vector<std::vector<int> > donorAtoms, acceptorAtoms;
+    std::vector<std::set<int> > exclusions;
+    std::vector<std::string> donorParamNames, acceptorParamNames;
+    std::vector<TermInfo> terms;
+    std::vector<ThreadData*> threadData;
+    int numCells[3];
+    double cellOrigin[3], cellWidth[3];
+    std::vector<int> cellStart, cellAcceptors, acceptorCell;
+    // The following variables are used to make information accessible to the individual threads.
+    float* posq;
+    std::vector<double>* donorParameters;
+    std::vector<double>* acceptorParameters;
+    const std::map<std::string, double>* globalParameters;
+    std::vector<AlignedArray<float> >* threadForce;
+    int numParticles;
+    bool includeForces, includeEnergy;
+    std::atomic<int> atomicCounter;
+};
+
+} // namespace OpenMM
+
+#endif /*OPENMM_CPUCUSTOMHBONDFORCE_H_*/
@@ -26,6 +26,7 @@
 #define OPENMM_CPU_CUSTOM_NONBONDED_FORCE_H__
 
 #include "AlignedArray.h"
+#include "CpuForceRegions.h"
 #include "CpuNeighborList.h"
 #include "openmm/internal/CompiledExpressionSet.h"
 #include "openmm/internal/ThreadPool.h"
@@ -106,6 +107,55 @@ public:
 
       void setPeriodic(Vec3* periodicBoxVectors);
 
+      /**---------------------------------------------------------------------------------------
+
+         Set the object used to record which atoms each thread adds forces to.  If this is
+         NULL (the default), nothing is recorded.
+
+         --------------------------------------------------------------------------------------- */
+
+      void setForceRegions(CpuForceRegions* regions);
+
+      /**---------------------------------------------------------------------------------------
+
+         Set whether the interaction may be looked up from precomputed tables instead of evaluating
+         the expression.  Tables are only used if the energy depends on nothing but r, global
+         parameters, and per-particle parameters, there are few enough distinct combinations of
+         per-particle parameters, and the tables agree with the expression.
+
+         @param use            whether to use tables when possible
+
+         --------------------------------------------------------------------------------------- */
+
+      void setUseTables(bool use);
+
+      /**---------------------------------------------------------------------------------------
+
+         Get whether the most recent call to calculatePairIxn() looked up interactions from tables.
+
+         --------------------------------------------------------------------------------------- */
+
+      bool getUsedTables() const;
+
+      /**---------------------------------------------------------------------------------------
+
+         Get the maximum number of distinct combinations of per-particle parameters for which
+         tables can be built.
+
+         --------------------------------------------------------------------------------------- */
+
+      static int getMaxTableTypes();
+
+      /**---------------------------------------------------------------------------------------
+
+         Notify the force that the per-particle parameters, or the order of the particles, have
+         changed since the last call to calculatePairIxn().  Types are only assigned to particles
+         again after this is called.
+
+         --------------------------------------------------------------------------------------- */
+
+      void invalidateParticleTypes();
+
       /**---------------------------------------------------------------------------------------
 
          Calculate custom pair ixn
@@ -133,6 +183,7 @@ protected:
     bool triclinic;
     bool useInteractionGroups;
     const CpuNeighborList* neighborList;
+    CpuForceRegions* forceRegions;
     float recipBoxSize[3];
     Vec3 periodicBoxVectors[3];
     AlignedArray<fvec4> periodicBoxVec4;
@@ -153,6 +204,33 @@ protected:
     std::vector<AlignedArray<float> >* threadForce;
     bool includeForce, includeEnergy;
     std::atomic<int> atomicCounter;
+    // The following variables are used for looking up interactions from tables.  Particles with identical
+    // parameters have the same type, and the table for each pair of types holds the coefficients of cubic
+    // polynomials for the energy and dE/dr on each interval.
+    bool useTables, canUseTables, hasTables, tablesUpToDate, typesUpToDate, typesFit;
+    int numTableIntervals;
+    float tableMin, tableScale;
+    double tableCutoff;
+    std::vector<int> atomTypes, pairTables;
+    std::vector<std::vector<double> > typeParameters;
+    std::map<std::vector<double>, int> typeIndex;
+    std::map<std::string, double> tableGlobalParameters;
+    std::vector<float> tableCoefficients;
+    Lepton::CompiledExpression tableExpression;
+    double tableR;
+    std::vector<double> tableParticleParams;
+
+    /**
+     * Assign types to particles and rebuild the tables if necessary.  This sets hasTables to indicate
+     * whether the tables can be used for the current step.
+     */
+    void updateTables();
+
+    /**
+     * Build the tables with a specified number of intervals, and check their accuracy.  Returns false
+     * if they are not accurate enough.
+     */
+    bool createTables(int numIntervals);
 
     /**
      * This routine contains the code executed by each thread.
@@ -193,19 +271,35 @@ protected:
 
 class CpuCustomNonbondedForce::ThreadData {
 public:
-    ThreadData(const Lepton::CompiledExpression& energyExpression, const Lepton::CompiledVectorExpression& energyVecExpression,
-            const Lepton::CompiledExpression& forceExpression, const Lepton::CompiledVectorExpression& forceVecExpression, const std::vector<std::string>& parameterNames,
-            const std::vector<Lepton::CompiledExpression> energyParamDerivExpressions, const std::vector<std::string>& computedValueNames,
-            const std::vector<Lepton::CompiledExpression> computedValueExpressions, std::vector<std::vector<double> >& atomComputedValues);
-    Lepton::CompiledExpression energyExpression, forceExpression;
-    Lepton::CompiledVectorExpression energyVecExpression, forceVecExpression;
-    std::vector<Lepton::CompiledExpression> computedValueExpressions, energyParamDerivExpressions;
+    ThreadData(const Lepton::CompiledExpression& interactionExpression, const Lepton::CompiledVectorExpression& forceVecExpression,
+            const Lepton::CompiledVectorExpression& forceEnergyVecExpression, const std::vector<std::string>& parameterNames, int numParamDerivs,
+            const std::vector<std::string>& computedValueNames, const std::vector<Lepton::CompiledExpression> computedValueExpressions,
+            std::vector<std::vector<double> >& atomComputedValues);
+    /**
+     * Evaluate a vectorized expression for a full block of interactions.  When the block is wider
+     * than the widest vector Lepton can compile, there is one expression for each piece of the block.
+     *
+     * @param expressions    the expressions to evaluate, one for each piece of the block
+     * @param result         workspace for assembling the pieces
+     * @return a pointer to the values for the block.  If the expressions compute several results, the
+     * values for each one follow the values for the previous one.
+     */
+    const float* evaluateVecExpressions(std::vector<Lepton::CompiledVectorExpression>& expressions, std::vector<float>& result);
+    /**
+     * Computes the force, the energy, and the derivatives of the energy with respect to parameters
+     * in a single evaluation, so subexpressions they have in common are only computed once.
+     */
+    Lepton::CompiledExpression interactionExpression;
+    std::vector<Lepton::CompiledVectorExpression> forceVecExpressions, forceEnergyVecExpressions;
+    std::vector<Lepton::CompiledExpression> computedValueExpressions;
     CompiledExpressionSet expressionSet;
-    std::vector<double> particleParam, computedValues;
-    std::vector<float> rvec, vecParticle1Params, vecParticle2Params, vecParticle1Values, vecParticle2Values;
+    std::vector<double> particleParam, computedValues, interactionResult;
+    std::vector<float> rvec, vecParticle1Params, vecParticle2Params, vecParticle1Values, vecParticle2Values, forceVecResult, forceEnergyVecResult;
     double r;
     std::vector<double> energyParamDerivs; 
     std::vector<std::vector<double> >& atomComputedValues;
+    // If spatial force accumulation is used, the tiles of this thread's force buffer that are written to are marked in this.
+    char* writtenTiles;
 };
 
 /**
@@ -59,6 +59,12 @@ protected:
      */
     template <int PERIODIC_TYPE>
     void getDeltaR(const fvec4& posI, const FVEC& x, const FVEC& y, const FVEC& z, FVEC& dx, FVEC& dy, FVEC& dz, FVEC& r2, const fvec4& boxSize, const fvec4& invBoxSize) const;
+
+    /**
+     * Look up the interactions between an atom and the atoms in a block from the tables.  This returns false
+     * if any of them is closer than the start of the tables, in which case the expression must be evaluated.
+     */
+    bool lookUpInteraction(int atomType, const int* blockAtomType, int exclusions, const FVEC& r, FVEC& dEdR, FVEC& energy, bool computeEnergy) const;
 };
 
 template<typename FVEC, int BLOCK_SIZE>
@@ -124,8 +130,11 @@ void CpuCustomNonbondedForceFvec<FVEC, BLOCK_SIZE>::calculateBlockIxnImpl(Thread
     FVEC blockAtomX, blockAtomY, blockAtomZ, blockAtomCharge;
     int numParams = paramNames.size();
     int numComputed = computedValueNames.size();
+    int blockAtomType[BLOCK_SIZE];
     for (int i = 0; i < BLOCK_SIZE; i++) {
         blockAtomPosq[i] = fvec4(posq+4*blockAtom[i]);
+        if (hasTables)
+            blockAtomType[i] = atomTypes[blockAtom[i]];
         if (PERIODIC_TYPE == PeriodicPerAtom)
             blockAtomPosq[i] -= floor((blockAtomPosq[i]-blockCenter)*invBoxSize+0.5f)*boxSize;
         for (int j = 0; j < numParams; j++)
@@ -142,18 +151,9 @@ void CpuCustomNonbondedForceFvec<FVEC, BLOCK_SIZE>::calculateBlockIxnImpl(Thread
     CpuNeighborList::NeighborIterator neighbors = neighborList->getNeighborIterator(blockIndex);
     FVEC partialEnergy = {};
     while (neighbors.next()) {
-        // Load the next neighbor.
-
-        int atom = neighbors.getNeighbor();
-        for (int j = 0; j < numParams; j++)
-            for (int k = 0; k < BLOCK_SIZE; k++)
-                data.vecParticle2Params[j*BLOCK_SIZE+k] = atomParameters[atom][j];
-        for (int j = 0; j < numComputed; j++)
-            for (int k = 0; k < BLOCK_SIZE; k++)
-                data.vecParticle2Values[j*BLOCK_SIZE+k] = atomComputedValues[j][atom];
-
         // Compute the distances to the block atoms.
 
+        int atom = neighbors.getNeighbor();
         FVEC dx, dy, dz, r2;
         fvec4 atomPos(posq+4*atom);
         if (PERIODIC_TYPE == PeriodicPerAtom)
@@ -169,11 +169,25 @@ void CpuCustomNonbondedForceFvec<FVEC, BLOCK_SIZE>::calculateBlockIxnImpl(Thread
 
         const auto inverseR = rsqrt(r2);
         const auto r = r2*inverseR;
-        r.store(data.rvec.data());
-        FVEC dEdR(data.forceVecExpression.evaluate());
-        FVEC energy;
-        if (includeEnergy || useSwitch)
-            energy = FVEC(data.energyVecExpression.evaluate());
+        FVEC dEdR, energy;
+        if (!hasTables || !lookUpInteraction(atomTypes[atom], blockAtomType, neighbors.getExclusions(), r, dEdR, energy, includeEnergy || useSwitch)) {
+            // Load the parameters of the neighbor and evaluate the expression.
+
+            for (int j = 0; j < numParams; j++)
+                for (int k = 0; k < BLOCK_SIZE; k++)
+                    data.vecParticle2Params[j*BLOCK_SIZE+k] = atomParameters[atom][j];
+            for (int j = 0; j < numComputed; j++)
+                for (int k = 0; k < BLOCK_SIZE; k++)
+                    data.vecParticle2Values[j*BLOCK_SIZE+k] = atomComputedValues[j][atom];
+            r.store(data.rvec.data());
+            if (includeEnergy || useSwitch) {
+                const float* values = data.evaluateVecExpressions(data.forceEnergyVecExpressions, data.forceEnergyVecResult);
+                dEdR = FVEC(values);
+                energy = FVEC(values+BLOCK_SIZE);
+            }
+            else
+                dEdR = FVEC(data.evaluateVecExpressions(data.forceVecExpressions, data.forceVecResult));
+        }
         if (useSwitch) {
             const auto t = blendZero((r-switchingDistance)*invSwitchingInterval, r>switchingDistance);
             const auto switchValue = 1+t*t*t*(-10.0f+t*(15.0f-t*6.0f));
@@ -199,6 +213,8 @@ void CpuCustomNonbondedForceFvec<FVEC, BLOCK_SIZE>::calculateBlockIxnImpl(Thread
         float* const atomForce = forces+4*atom;
         const fvec4 newAtomForce = fvec4(atomForce) + reduceToVec3(fx, fy, fz);
         newAtomForce.store(atomForce);
+        if (data.writtenTiles != NULL)
+            data.writtenTiles[atom/CpuForceRegions::TileSize] = 1;
     }
     if (includeEnergy)
         totalEnergy += reduceAdd(partialEnergy);
@@ -209,6 +225,9 @@ void CpuCustomNonbondedForceFvec<FVEC, BLOCK_SIZE>::calculateBlockIxnImpl(Thread
     transpose(blockAtomForceX, blockAtomForceY, blockAtomForceZ, 0.0f, f);
     for (int j = 0; j < BLOCK_SIZE; j++)
         (fvec4(forces+4*blockAtom[j])+f[j]).store(forces+4*blockAtom[j]);
+    if (data.writtenTiles != NULL)
+        for (int j = 0; j < BLOCK_SIZE; j++)
+            data.writtenTiles[blockAtom[j]/CpuForceRegions::TileSize] = 1;
 }
 
 template<typename FVEC, int BLOCK_SIZE>
@@ -236,6 +255,34 @@ void CpuCustomNonbondedForceFvec<FVEC, BLOCK_SIZE>::getDeltaR(const fvec4& posI,
     r2 = dx*dx + dy*dy + dz*dz;
 }
 
+template<typename FVEC, int BLOCK_SIZE>
+bool CpuCustomNonbondedForceFvec<FVEC, BLOCK_SIZE>::lookUpInteraction(int atomType, const int* blockAtomType, int exclusions, const FVEC& r, FVEC& dEdR, FVEC& energy, bool computeEnergy) const {
+    // Find the interval containing each distance and load its coefficients.  Excluded pairs may be at
+    // any distance (including 0 or NaN for an atom with itself), so clamp them to the table.
+
+    float rValues[BLOCK_SIZE], t[BLOCK_SIZE], coeff[8][BLOCK_SIZE];
+    r.store(rValues);
+    const int* pairRow = &pairTables[atomType*typeParameters.size()];
+    for (int k = 0; k < BLOCK_SIZE; k++) {
+        float x = (rValues[k]-tableMin)*tableScale;
+        if (!(x >= 0.0f)) {
+            if ((exclusions & (1<<k)) == 0)
+                return false;
+            x = 0.0f;
+        }
+        int interval = std::min((int) std::min(x, (float) numTableIntervals), numTableIntervals-1);
+        t[k] = x-interval;
+        const float* c = &tableCoefficients[8*((size_t) pairRow[blockAtomType[k]]*numTableIntervals+interval)];
+        for (int j = 0; j < 8; j++)
+            coeff[j][k] = c[j];
+    }
+    const FVEC tv(t);
+    if (computeEnergy)
+        energy = FVEC(coeff[0])+tv*(FVEC(coeff[1])+tv*(FVEC(coeff[2])+tv*FVEC(coeff[3])));
+    dEdR = FVEC(coeff[4])+tv*(FVEC(coeff[5])+tv*(FVEC(coeff[6])+tv*FVEC(coeff[7])));
+    return true;
+}
+
 } // namespace OpenMM
 
 #endif // OPENMM_CPU_CUSTOM_NONBONDED_FORCE_FVEC_H__
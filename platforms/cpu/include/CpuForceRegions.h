@@ -0,0 +1,113 @@
+#ifndef OPENMM_CPUFORCEREGIONS_H_
+#define OPENMM_CPUFORCEREGIONS_H_
+
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "AlignedArray.h"
+#include "windowsExportCpu.h"
+#include <vector>
+
+namespace OpenMM {
+
+/**
+ * This class records which parts of each thread's force buffer have been written to
+ * during a force evaluation.  Atoms are grouped into tiles of TileSize consecutive
+ * indices, and a flag is kept for every tile of every thread's buffer.  Zeroing the
+ * buffers and summing them at the end of the evaluation then only needs to touch the
+ * tiles a thread actually wrote: the atoms of the neighbor list blocks it processed,
+ * plus the halo of neighbors they interacted with.
+ *
+ * Every piece of code that adds forces to a thread's buffer must mark what it wrote.
+ * The nonbonded kernels do this as they compute each block, marking an atom only when
+ * they actually add a force to it.  Code that cannot easily tell which atoms it touched
+ * should call markAll().
+ *
+ * The force buffers must start out zeroed and be allocated with AlignedArray::resizeZeroed().
+ * Since a tile is only ever written to after it has been marked, the operating system only
+ * commits physical memory for the pages of each buffer that a thread has actually used.
+ */
+class OPENMM_EXPORT_CPU CpuForceRegions {
+public:
+    /**
+     * The number of consecutive atoms in each tile.
+     */
+    static const int TileSize = 32;
+    CpuForceRegions(int numParticles, int numThreads);
+    /**
+     * Get the number of tiles the atoms are divided into.
+     */
+    int getNumTiles() const {
+        return numTiles;
+    }
+    /**
+     * Get whether a thread has written to any atom in a tile.
+     */
+    bool isWritten(int threadIndex, int tile) const {
+        return written[threadIndex][tile] != 0;
+    }
+    /**
+     * Record that a thread has written to the force on an atom.
+     */
+    void markAtom(int threadIndex, int atom) {
+        written[threadIndex][atom/TileSize] = 1;
+    }
+    /**
+     * Get the flags for a thread's buffer, so a kernel can mark tiles directly while it computes forces.
+     * Writing to the force on atom i should set element i/TileSize to 1.
+     */
+    char* getWrittenTiles(int threadIndex) {
+        return &written[threadIndex][0];
+    }
+    /**
+     * Record that a thread may have written to the force on any atom.
+     */
+    void markAll(int threadIndex);
+    /**
+     * Record that every thread may have written to the force on any atom.
+     */
+    void markAll();
+    /**
+     * Zero the parts of a thread's force buffer that have been written to, and reset
+     * its flags.
+     *
+     * @param threadIndex   the thread whose buffer to clear
+     * @param forces        the thread's force buffer
+     */
+    void clear(int threadIndex, AlignedArray<float>& forces);
+private:
+    int numParticles, numTiles;
+    std::vector<std::vector<char> > written;
+};
+
+} // namespace OpenMM
+
+#endif // OPENMM_CPUFORCEREGIONS_H_
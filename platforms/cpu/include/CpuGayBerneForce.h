@@ -89,6 +89,7 @@ private:
     std::vector<std::vector<Vec3> > threadTorque;
     // The following variables are used to make information accessible to the individual threads.
     Vec3 const* positions;
+    int const* atomOrder;
     std::vector<AlignedArray<float> >* threadForce;
     Vec3* boxVectors;
     std::atomic<int> atomicCounter;
@@ -33,15 +33,24 @@
  * -------------------------------------------------------------------------- */
 
 #include "CpuBondForce.h"
+#include "CpuCustomCompoundBondForce.h"
 #include "CpuCustomGBForce.h"
+#include "CpuCustomHbondForce.h"
 #include "CpuCustomManyParticleForce.h"
 #include "CpuCustomNonbondedForce.h"
 #include "CpuGayBerneForce.h"
 #include "CpuGBSAOBCForce.h"
+#include "CpuBrownianDynamics.h"
+#include "CpuCustomDynamics.h"
 #include "CpuLangevinMiddleDynamics.h"
 #include "CpuNeighborList.h"
 #include "CpuNonbondedForce.h"
+#include "CpuNoseHooverDynamics.h"
 #include "CpuPlatform.h"
+#include "CpuVariableStochasticDynamics.h"
+#include "CpuVariableVerletDynamics.h"
+#include "CpuVerletDynamics.h"
+#include "CpuVectorBondForce.h"
 #include "openmm/kernels.h"
 #include "openmm/System.h"
 #include "openmm/internal/CustomNonbondedForceImpl.h"
@@ -90,9 +99,60 @@ public:
      */
     double finishComputation(ContextImpl& context, bool includeForce, bool includeEnergy, int groups, bool& valid);
 private:
+    /**
+     * Choose the size of the neighbor list buffer based on the current temperature.
+     */
+    double estimateBufferSize(ContextImpl& context);
+    /**
+     * Add the forces on an atom from a set of thread force buffers.
+     */
+    void sumThreadForces(int atom, const std::vector<int>& threadIndices, Vec3& force);
     CpuPlatform::PlatformData& data;
     Kernel referenceKernel;
-    std::vector<Vec3> lastPositions;
+    std::vector<Vec3> lastPositions, lastPrunePositions;
+};
+
+/**
+ * This kernel is invoked by HarmonicBondForce to calculate the forces acting on the system and the energy of the system.
+ */
+class CpuCalcHarmonicBondForceKernel : public CalcHarmonicBondForceKernel {
+public:
+    CpuCalcHarmonicBondForceKernel(std::string name, const Platform& platform, CpuPlatform::PlatformData& data) :
+            CalcHarmonicBondForceKernel(name, platform), data(data), bondForce(NULL), usePeriodic(false), energy(0.0) {
+    }
+    ~CpuCalcHarmonicBondForceKernel();
+    /**
+     * Initialize the kernel.
+     * 
+     * @param system     the System this kernel will be applied to
+     * @param force      the HarmonicBondForce this kernel will be used for
+     */
+    void initialize(const System& system, const HarmonicBondForce& force);
+    /**
+     * Execute the kernel to calculate the forces and/or energy.
+     *
+     * @param context        the context in which to execute this kernel
+     * @param includeForces  true if forces should be calculated
+     * @param includeEnergy  true if the energy should be calculated
+     * @return the potential energy due to the force
+     */
+    double execute(ContextImpl& context, bool includeForces, bool includeEnergy);
+    /**
+     * Copy changed parameters over to a context.
+     *
+     * @param context    the context to copy parameters to
+     * @param force      the HarmonicBondForce to copy the parameters from
+     */
+    void copyParametersToContext(ContextImpl& context, const HarmonicBondForce& force);
+private:
+    CpuPlatform::PlatformData& data;
+    int numBonds;
+    std::vector<std::vector<int> > bondIndexArray;
+    std::vector<std::vector<double> > bondParamArray;
+    CpuVectorBondForce* bondForce;
+    bool usePeriodic;
+    int forceBufferIndex;
+    double energy;
 };
 
 /**
@@ -101,8 +161,9 @@ private:
 class CpuCalcHarmonicAngleForceKernel : public CalcHarmonicAngleForceKernel {
 public:
     CpuCalcHarmonicAngleForceKernel(std::string name, const Platform& platform, CpuPlatform::PlatformData& data) :
-            CalcHarmonicAngleForceKernel(name, platform), data(data), usePeriodic(false) {
+            CalcHarmonicAngleForceKernel(name, platform), data(data), bondForce(NULL), usePeriodic(false), energy(0.0) {
     }
+    ~CpuCalcHarmonicAngleForceKernel();
     /**
      * Initialize the kernel.
      * 
@@ -131,8 +192,10 @@ private:
     int numAngles;
     std::vector<std::vector<int> > angleIndexArray;
     std::vector<std::vector<double> > angleParamArray;
-    CpuBondForce bondForce;
+    CpuVectorBondForce* bondForce;
     bool usePeriodic;
+    int forceBufferIndex;
+    double energy;
 };
 
 /**
@@ -141,8 +204,9 @@ private:
 class CpuCalcPeriodicTorsionForceKernel : public CalcPeriodicTorsionForceKernel {
 public:
     CpuCalcPeriodicTorsionForceKernel(std::string name, const Platform& platform, CpuPlatform::PlatformData& data) :
-            CalcPeriodicTorsionForceKernel(name, platform), data(data), usePeriodic(false) {
+            CalcPeriodicTorsionForceKernel(name, platform), data(data), bondForce(NULL), usePeriodic(false), energy(0.0) {
     }
+    ~CpuCalcPeriodicTorsionForceKernel();
     /**
      * Initialize the kernel.
      * 
@@ -171,8 +235,10 @@ private:
     int numTorsions;
     std::vector<std::vector<int> > torsionIndexArray;
     std::vector<std::vector<double> > torsionParamArray;
-    CpuBondForce bondForce;
+    CpuVectorBondForce* bondForce;
     bool usePeriodic;
+    int forceBufferIndex;
+    double energy;
 };
 
 /**
@@ -181,8 +247,9 @@ private:
 class CpuCalcRBTorsionForceKernel : public CalcRBTorsionForceKernel {
 public:
     CpuCalcRBTorsionForceKernel(std::string name, const Platform& platform, CpuPlatform::PlatformData& data) :
-            CalcRBTorsionForceKernel(name, platform), data(data), usePeriodic(false) {
+            CalcRBTorsionForceKernel(name, platform), data(data), bondForce(NULL), usePeriodic(false), energy(0.0) {
     }
+    ~CpuCalcRBTorsionForceKernel();
     /**
      * Initialize the kernel.
      * 
@@ -211,8 +278,10 @@ private:
     int numTorsions;
     std::vector<std::vector<int> > torsionIndexArray;
     std::vector<std::vector<double> > torsionParamArray;
-    CpuBondForce bondForce;
+    CpuVectorBondForce* bondForce;
     bool usePeriodic;
+    int forceBufferIndex;
+    double energy;
 };
 
 /**
@@ -269,16 +338,17 @@ private:
     class PmeIO;
     void computeParameters(ContextImpl& context, bool offsetsOnly);
     CpuPlatform::PlatformData& data;
-    int numParticles, num14, chargePosqIndex, ljPosqIndex;
+    int numParticles, num14, chargePosqIndex, ljPosqIndex, orderedParamsVersion;
     std::vector<std::vector<int> > bonded14IndexArray;
     std::vector<std::vector<double> > bonded14ParamArray;
     double nonbondedCutoff, switchingDistance, rfDielectric, ewaldAlpha, ewaldDispersionAlpha, ewaldSelfEnergy, dispersionCoefficient;
     int kmax[3], gridSize[3], dispersionGridSize[3];
     bool useSwitchingFunction, exceptionsArePeriodic, useOptimizedPme, hasInitializedPme, hasInitializedDispersionPme, hasParticleOffsets, hasExceptionOffsets;
-    std::vector<std::set<int> > exclusions;
-    std::vector<std::pair<float, float> > particleParams;
-    std::vector<float> C6params;
+    std::vector<std::set<int> > exclusions, orderedExclusions;
+    std::vector<std::pair<float, float> > particleParams, orderedParticleParams;
+    std::vector<float> C6params, orderedC6params;
     std::vector<float> charges;
+    std::vector<Vec3> orderedPositions, orderedForces;
     std::vector<std::array<double, 3> > baseParticleParams, baseExceptionParams;
     std::vector<std::vector<std::tuple<double, double, double, int> > > particleParamOffsets, exceptionParamOffsets;
     std::vector<std::string> paramNames;
@@ -322,8 +392,8 @@ public:
 private:
     void createInteraction(const CustomNonbondedForce& force);
     CpuPlatform::PlatformData& data;
-    int numParticles;
-    std::vector<std::vector<double> > particleParamArray;
+    int numParticles, orderedParamsVersion;
+    std::vector<std::vector<double> > particleParamArray, orderedParamArray;
     double nonbondedCutoff, switchingDistance, periodicBoxSize[3], longRangeCoefficient;
     bool useSwitchingFunction, hasInitializedLongRangeCorrection;
     CustomNonbondedForce* forceCopy;
@@ -344,7 +414,7 @@ private:
 class CpuCalcGBSAOBCForceKernel : public CalcGBSAOBCForceKernel {
 public:
     CpuCalcGBSAOBCForceKernel(std::string name, const Platform& platform, CpuPlatform::PlatformData& data) : CalcGBSAOBCForceKernel(name, platform),
-            data(data) {
+            data(data), orderedParamsVersion(-1) {
     }
     ~CpuCalcGBSAOBCForceKernel();
     /**
@@ -372,8 +442,8 @@ public:
     void copyParametersToContext(ContextImpl& context, const GBSAOBCForce& force);
 private:
     CpuPlatform::PlatformData& data;
-    int posqIndex;
-    std::vector<std::pair<float, float> > particleParams;
+    int posqIndex, orderedParamsVersion;
+    std::vector<std::pair<float, float> > particleParams, orderedParticleParams;
     std::vector<float> charges;
     CpuGBSAOBCForce obc;
 };
@@ -470,6 +540,146 @@ private:
     NonbondedMethod nonbondedMethod;
 };
 
+/**
+ * This kernel is invoked by CustomHbondForce to calculate the forces acting on the system.
+ */
+class CpuCalcCustomHbondForceKernel : public CalcCustomHbondForceKernel {
+public:
+    CpuCalcCustomHbondForceKernel(std::string name, const Platform& platform, CpuPlatform::PlatformData& data) : CalcCustomHbondForceKernel(name, platform),
+            data(data), ixn(NULL) {
+    }
+    ~CpuCalcCustomHbondForceKernel();
+    /**
+     * Initialize the kernel.
+     *
+     * @param system     the System this kernel will be applied to
+     * @param force      the CustomHbondForce this kernel will be used for
+     */
+    void initialize(const System& system, const CustomHbondForce& force);
+    /**
+     * Execute the kernel to calculate the forces and/or energy.
+     *
+     * @param context        the context in which to execute this kernel
+     * @param includeForces  true if forces should be calculated
+     * @param includeEnergy  true if the energy should be calculated
+     * @return the potential energy due to the force
+     */
+    double execute(ContextImpl& context, bool includeForces, bool includeEnergy);
+    /**
+     * Copy changed parameters over to a context.
+     *
+     * @param context    the context to copy parameters to
+     * @param force      the CustomHbondForce to copy the parameters from
+     */
+    void copyParametersToContext(ContextImpl& context, const CustomHbondForce& force);
+private:
+    CpuPlatform::PlatformData& data;
+    int numDonors, numAcceptors;
+    double cutoffDistance;
+    std::vector<std::vector<double> > donorParamArray;
+    std::vector<std::vector<double> > acceptorParamArray;
+    CpuCustomHbondForce* ixn;
+    std::vector<std::string> globalParameterNames;
+    std::map<std::string, int> tabulatedFunctionUpdateCount;
+    NonbondedMethod nonbondedMethod;
+};
+
+/**
+ * This kernel is invoked by CustomCompoundBondForce to calculate the forces acting on the system.
+ */
+class CpuCalcCustomCompoundBondForceKernel : public CalcCustomCompoundBondForceKernel {
+public:
+    CpuCalcCustomCompoundBondForceKernel(std::string name, const Platform& platform, CpuPlatform::PlatformData& data) : CalcCustomCompoundBondForceKernel(name, platform),
+            data(data), ixn(NULL) {
+    }
+    ~CpuCalcCustomCompoundBondForceKernel();
+    /**
+     * Initialize the kernel.
+     *
+     * @param system     the System this kernel will be applied to
+     * @param force      the CustomCompoundBondForce this kernel will be used for
+     */
+    void initialize(const System& system, const CustomCompoundBondForce& force);
+    /**
+     * Execute the kernel to calculate the forces and/or energy.
+     *
+     * @param context        the context in which to execute this kernel
+     * @param includeForces  true if forces should be calculated
+     * @param includeEnergy  true if the energy should be calculated
+     * @return the potential energy due to the force
+     */
+    double execute(ContextImpl& context, bool includeForces, bool includeEnergy);
+    /**
+     * Copy changed parameters over to a context.
+     *
+     * @param context    the context to copy parameters to
+     * @param force      the CustomCompoundBondForce to copy the parameters from
+     */
+    void copyParametersToContext(ContextImpl& context, const CustomCompoundBondForce& force);
+private:
+    void createInteraction(const CustomCompoundBondForce& force);
+    CpuPlatform::PlatformData& data;
+    int numBonds, numParticles;
+    std::vector<std::vector<int> > bondParticles;
+    std::vector<std::vector<double> > bondParamArray;
+    CpuCustomCompoundBondForce* ixn;
+    std::vector<std::string> globalParameterNames, energyParamDerivNames;
+    std::map<std::string, int> tabulatedFunctionUpdateCount;
+    bool usePeriodic;
+    Vec3* boxVectors;
+};
+
+/**
+ * This kernel is invoked by CustomCentroidBondForce to calculate the forces acting on the system.
+ */
+class CpuCalcCustomCentroidBondForceKernel : public CalcCustomCentroidBondForceKernel {
+public:
+    CpuCalcCustomCentroidBondForceKernel(std::string name, const Platform& platform, CpuPlatform::PlatformData& data) : CalcCustomCentroidBondForceKernel(name, platform),
+            data(data), ixn(NULL) {
+    }
+    ~CpuCalcCustomCentroidBondForceKernel();
+    /**
+     * Initialize the kernel.
+     *
+     * @param system     the System this kernel will be applied to
+     * @param force      the CustomCentroidBondForce this kernel will be used for
+     */
+    void initialize(const System& system, const CustomCentroidBondForce& force);
+    /**
+     * Execute the kernel to calculate the forces and/or energy.
+     *
+     * @param context        the context in which to execute this kernel
+     * @param includeForces  true if forces should be calculated
+     * @param includeEnergy  true if the energy should be calculated
+     * @return the potential energy due to the force
+     */
+    double execute(ContextImpl& context, bool includeForces, bool includeEnergy);
+    /**
+     * Copy changed parameters over to a context.
+     *
+     * @param context    the context to copy parameters to
+     * @param force      the CustomCentroidBondForce to copy the parameters from
+     */
+    void copyParametersToContext(ContextImpl& context, const CustomCentroidBondForce& force);
+private:
+    void createInteraction(const CustomCentroidBondForce& force);
+    CpuPlatform::PlatformData& data;
+    int numBonds, numGroups;
+    std::vector<std::vector<int> > bondGroups;
+    std::vector<std::vector<int> > groupAtoms;
+    std::vector<std::vector<double> > normalizedWeights;
+    std::vector<std::vector<double> > bondParamArray;
+    // For each atom, the groups it belongs to and its weight in each one.
+    std::vector<std::vector<std::pair<int, double> > > atomGroups;
+    std::vector<int> atomsInGroups;
+    std::vector<Vec3> groupCenters, groupForces;
+    CpuCustomCompoundBondForce* ixn;
+    std::vector<std::string> globalParameterNames, energyParamDerivNames;
+    std::map<std::string, int> tabulatedFunctionUpdateCount;
+    bool usePeriodic;
+    Vec3* boxVectors;
+};
+
 /**
  * This kernel is invoked by GayBerneForce to calculate the forces acting on the system.
  */
@@ -543,6 +753,332 @@ private:
     double prevTemp, prevFriction, prevStepSize;
 };
 
+/**
+ * This kernel is invoked by VerletIntegrator to take one time step.
+ */
+class CpuIntegrateVerletStepKernel : public IntegrateVerletStepKernel {
+public:
+    CpuIntegrateVerletStepKernel(std::string name, const Platform& platform, CpuPlatform::PlatformData& data) : IntegrateVerletStepKernel(name, platform),
+            data(data), dynamics(0) {
+    }
+    ~CpuIntegrateVerletStepKernel();
+    /**
+     * Initialize the kernel, setting up the particle masses.
+     * 
+     * @param system     the System this kernel will be applied to
+     * @param integrator the VerletIntegrator this kernel will be used for
+     */
+    void initialize(const System& system, const VerletIntegrator& integrator);
+    /**
+     * Execute the kernel.
+     * 
+     * @param context    the context in which to execute this kernel
+     * @param integrator the VerletIntegrator this kernel is being used for
+     */
+    void execute(ContextImpl& context, const VerletIntegrator& integrator);
+    /**
+     * Compute the kinetic energy.
+     * 
+     * @param context    the context in which to execute this kernel
+     * @param integrator the VerletIntegrator this kernel is being used for
+     */
+    double computeKineticEnergy(ContextImpl& context, const VerletIntegrator& integrator);
+private:
+    CpuPlatform::PlatformData& data;
+    CpuVerletDynamics* dynamics;
+    std::vector<double> masses;
+    double prevStepSize;
+};
+
+/**
+ * This kernel is invoked by NoseHooverIntegrator to take one time step.  The particle updates are
+ * parallelized, while the thermostat chains are handled by a Reference platform kernel.
+ */
+class CpuIntegrateNoseHooverStepKernel : public IntegrateNoseHooverStepKernel {
+public:
+    CpuIntegrateNoseHooverStepKernel(std::string name, const Platform& platform, CpuPlatform::PlatformData& data, ContextImpl& context);
+    ~CpuIntegrateNoseHooverStepKernel();
+    /**
+     * Initialize the kernel.
+     * 
+     * @param system     the System this kernel will be applied to
+     * @param integrator the NoseHooverIntegrator this kernel will be used for
+     */
+    void initialize(const System& system, const NoseHooverIntegrator& integrator);
+    /**
+     * Execute the kernel.
+     * 
+     * @param context    the context in which to execute this kernel
+     * @param integrator the NoseHooverIntegrator this kernel is being used for
+     * @param forcesAreValid a reference to the parent integrator's boolean for keeping
+     *                       track of the validity of the current forces.
+     */
+    void execute(ContextImpl& context, const NoseHooverIntegrator& integrator, bool &forcesAreValid);
+    /**
+     * Compute the kinetic energy.
+     * 
+     * @param context    the context in which to execute this kernel
+     * @param integrator the NoseHooverIntegrator this kernel is being used for
+     */
+    double computeKineticEnergy(ContextImpl& context, const NoseHooverIntegrator& integrator);
+    /**
+     * Execute the kernel that propagates the Nose Hoover chain and determines the velocity scale factor.
+     * 
+     * @param context  the context in which to execute this kernel
+     * @param noseHooverChain the object describing the chain to be propagated.
+     * @param kineticEnergy the {center of mass, relative} kineticEnergies of the particles being thermostated by this chain.
+     * @param timeStep the time step used by the integrator.
+     * @return the velocity scale factor to apply to the particles associated with this heat bath.
+     */
+    std::pair<double, double> propagateChain(ContextImpl& context, const NoseHooverChain &noseHooverChain, std::pair<double, double> kineticEnergy, double timeStep);
+    /**
+     * Execute the kernal that computes the total (kinetic + potential) heat bath energy.
+     *
+     * @param context the context in which to execute this kernel
+     * @param noseHooverChain the chain whose energy is to be determined.
+     * @return the total heat bath energy.
+     */
+    double computeHeatBathEnergy(ContextImpl& context, const NoseHooverChain &noseHooverChain);
+    /**
+     * Execute the kernel that computes the kinetic energy for a subset of atoms,
+     * or the relative kinetic energy of Drude particles with respect to their parent atoms
+     *
+     * @param context the context in which to execute this kernel
+     * @param noseHooverChain the chain whose energy is to be determined.
+     * @param downloadValue whether the computed value should be downloaded and returned.
+     */
+    std::pair<double, double> computeMaskedKineticEnergy(ContextImpl& context, const NoseHooverChain &noseHooverChain, bool downloadValue);
+    /**
+     * Execute the kernel that scales the velocities of particles associated with a nose hoover chain
+     *
+     * @param context the context in which to execute this kernel
+     * @param noseHooverChain the chain whose energy is to be determined.
+     * @param scaleFactor the {absolute, relative} multiplicative factor by which velocities are scaled.
+     */
+    void scaleVelocities(ContextImpl& context, const NoseHooverChain &noseHooverChain, std::pair<double, double> scaleFactor);
+    /**
+     * Write the chain states to a checkpoint.
+     */
+    void createCheckpoint(ContextImpl& context, std::ostream& stream) const;
+    /**
+     * Load the chain states from a checkpoint.
+     */
+    void loadCheckpoint(ContextImpl& context, std::istream& stream);
+    /**
+     * Get the internal states of all chains.
+     * 
+     * @param context       the context for which to get the states
+     * @param positions     element [i][j] contains the position of bead j for chain i
+     * @param velocities    element [i][j] contains the velocity of bead j for chain i
+     */
+    void getChainStates(ContextImpl& context, std::vector<std::vector<double> >& positions, std::vector<std::vector<double> >& velocities) const;
+    /**
+     * Set the internal states of all chains.
+     * 
+     * @param context       the context for which to get the states
+     * @param positions     element [i][j] contains the position of bead j for chain i
+     * @param velocities    element [i][j] contains the velocity of bead j for chain i
+     */
+    void setChainStates(ContextImpl& context, const std::vector<std::vector<double> >& positions, const std::vector<std::vector<double> >& velocities);
+private:
+    CpuPlatform::PlatformData& data;
+    Kernel referenceKernel;
+    CpuNoseHooverDynamics* dynamics;
+    std::vector<double> masses;
+    double prevStepSize;
+};
+
+/**
+ * This kernel is invoked by BrownianIntegrator to take one time step.
+ */
+class CpuIntegrateBrownianStepKernel : public IntegrateBrownianStepKernel {
+public:
+    CpuIntegrateBrownianStepKernel(std::string name, const Platform& platform, CpuPlatform::PlatformData& data) : IntegrateBrownianStepKernel(name, platform),
+            data(data), dynamics(0) {
+    }
+    ~CpuIntegrateBrownianStepKernel();
+    /**
+     * Initialize the kernel, setting up the particle masses.
+     * 
+     * @param system     the System this kernel will be applied to
+     * @param integrator the BrownianIntegrator this kernel will be used for
+     */
+    void initialize(const System& system, const BrownianIntegrator& integrator);
+    /**
+     * Execute the kernel.
+     * 
+     * @param context    the context in which to execute this kernel
+     * @param integrator the BrownianIntegrator this kernel is being used for
+     */
+    void execute(ContextImpl& context, const BrownianIntegrator& integrator);
+    /**
+     * Compute the kinetic energy.
+     * 
+     * @param context    the context in which to execute this kernel
+     * @param integrator the BrownianIntegrator this kernel is being used for
+     */
+    double computeKineticEnergy(ContextImpl& context, const BrownianIntegrator& integrator);
+private:
+    CpuPlatform::PlatformData& data;
+    CpuBrownianDynamics* dynamics;
+    std::vector<double> masses;
+    double prevTemp, prevFriction, prevStepSize;
+};
+
+/**
+ * This kernel is invoked by VariableLangevinIntegrator to take one time step.
+ */
+class CpuIntegrateVariableLangevinStepKernel : public IntegrateVariableLangevinStepKernel {
+public:
+    CpuIntegrateVariableLangevinStepKernel(std::string name, const Platform& platform, CpuPlatform::PlatformData& data) : IntegrateVariableLangevinStepKernel(name, platform),
+            data(data), dynamics(0) {
+    }
+    ~CpuIntegrateVariableLangevinStepKernel();
+    /**
+     * Initialize the kernel, setting up the particle masses.
+     *
+     * @param system     the System this kernel will be applied to
+     * @param integrator the VariableLangevinIntegrator this kernel will be used for
+     */
+    void initialize(const System& system, const VariableLangevinIntegrator& integrator);
+    /**
+     * Execute the kernel.
+     *
+     * @param context    the context in which to execute this kernel
+     * @param integrator the VariableLangevinIntegrator this kernel is being used for
+     * @param maxTime    the maximum time beyond which the simulation should not be advanced
+     * @return the size of the step that was taken
+     */
+    double execute(ContextImpl& context, const VariableLangevinIntegrator& integrator, double maxTime);
+    /**
+     * Compute the kinetic energy.
+     * 
+     * @param context    the context in which to execute this kernel
+     * @param integrator the VariableLangevinIntegrator this kernel is being used for
+     */
+    double computeKineticEnergy(ContextImpl& context, const VariableLangevinIntegrator& integrator);
+private:
+    CpuPlatform::PlatformData& data;
+    CpuVariableStochasticDynamics* dynamics;
+    std::vector<double> masses;
+    double prevTemp, prevFriction, prevErrorTol;
+};
+
+/**
+ * This kernel is invoked by VariableVerletIntegrator to take one time step.
+ */
+class CpuIntegrateVariableVerletStepKernel : public IntegrateVariableVerletStepKernel {
+public:
+    CpuIntegrateVariableVerletStepKernel(std::string name, const Platform& platform, CpuPlatform::PlatformData& data) : IntegrateVariableVerletStepKernel(name, platform),
+            data(data), dynamics(0) {
+    }
+    ~CpuIntegrateVariableVerletStepKernel();
+    /**
+     * Initialize the kernel, setting up the particle masses.
+     *
+     * @param system     the System this kernel will be applied to
+     * @param integrator the VariableVerletIntegrator this kernel will be used for
+     */
+    void initialize(const System& system, const VariableVerletIntegrator& integrator);
+    /**
+     * Execute the kernel.
+     *
+     * @param context    the context in which to execute this kernel
+     * @param integrator the VariableVerletIntegrator this kernel is being used for
+     * @param maxTime    the maximum time beyond which the simulation should not be advanced
+     * @return the size of the step that was taken
+     */
+    double execute(ContextImpl& context, const VariableVerletIntegrator& integrator, double maxTime);
+    /**
+     * Compute the kinetic energy.
+     * 
+     * @param context    the context in which to execute this kernel
+     * @param integrator the VariableVerletIntegrator this kernel is being used for
+     */
+    double computeKineticEnergy(ContextImpl& context, const VariableVerletIntegrator& integrator);
+private:
+    CpuPlatform::PlatformData& data;
+    CpuVariableVerletDynamics* dynamics;
+    std::vector<double> masses;
+    double prevErrorTol;
+};
+
+
+/**
+ * This kernel is invoked by CustomIntegrator to take one time step.
+ */
+class CpuIntegrateCustomStepKernel : public IntegrateCustomStepKernel {
+public:
+    CpuIntegrateCustomStepKernel(std::string name, const Platform& platform, CpuPlatform::PlatformData& data) : IntegrateCustomStepKernel(name, platform),
+            data(data), dynamics(0) {
+    }
+    ~CpuIntegrateCustomStepKernel();
+    /**
+     * Initialize the kernel.
+     * 
+     * @param system     the System this kernel will be applied to
+     * @param integrator the CustomIntegrator this kernel will be used for
+     */
+    void initialize(const System& system, const CustomIntegrator& integrator);
+    /**
+     * Execute the kernel.
+     * 
+     * @param context    the context in which to execute this kernel
+     * @param integrator the CustomIntegrator this kernel is being used for
+     * @param forcesAreValid if the context has been modified since the last time step, this will be
+     *                       false to show that cached forces are invalid and must be recalculated.
+     *                       On exit, this should specify whether the cached forces are valid at the
+     *                       end of the step.
+     */
+    void execute(ContextImpl& context, CustomIntegrator& integrator, bool& forcesAreValid);
+    /**
+     * Compute the kinetic energy.
+     * 
+     * @param context    the context in which to execute this kernel
+     * @param integrator the CustomIntegrator this kernel is being used for
+     * @param forcesAreValid if the context has been modified since the last time step, this will be
+     *                       false to show that cached forces are invalid and must be recalculated.
+     *                       On exit, this should specify whether the cached forces are valid at the
+     *                       end of the step.
+     */
+    double computeKineticEnergy(ContextImpl& context, CustomIntegrator& integrator, bool& forcesAreValid);
+    /**
+     * Get the values of all global variables.
+     *
+     * @param context   the context in which to execute this kernel
+     * @param values    on exit, this contains the values
+     */
+    void getGlobalVariables(ContextImpl& context, std::vector<double>& values) const;
+    /**
+     * Set the values of all global variables.
+     *
+     * @param context   the context in which to execute this kernel
+     * @param values    a vector containing the values
+     */
+    void setGlobalVariables(ContextImpl& context, const std::vector<double>& values);
+    /**
+     * Get the values of a per-DOF variable.
+     *
+     * @param context   the context in which to execute this kernel
+     * @param variable  the index of the variable to get
+     * @param values    on exit, this contains the values
+     */
+    void getPerDofVariable(ContextImpl& context, int variable, std::vector<Vec3>& values) const;
+    /**
+     * Set the values of a per-DOF variable.
+     *
+     * @param context   the context in which to execute this kernel
+     * @param variable  the index of the variable to get
+     * @param values    a vector containing the values
+     */
+    void setPerDofVariable(ContextImpl& context, int variable, const std::vector<Vec3>& values);
+private:
+    CpuPlatform::PlatformData& data;
+    CpuCustomDynamics* dynamics;
+    std::vector<double> masses, globalValues;
+    std::vector<std::vector<OpenMM::Vec3> > perDofValues; 
+};
+
 } // namespace OpenMM
 
 #endif /*OPENMM_CPUKERNELS_H_*/
@@ -0,0 +1,130 @@
+#ifndef OPENMM_CPULINCS_H_
+#define OPENMM_CPULINCS_H_
+
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "ReferenceCCMAAlgorithm.h"
+#include "windowsExportCpu.h"
+#include "openmm/internal/ThreadPool.h"
+#include <functional>
+#include <vector>
+
+namespace OpenMM {
+
+/**
+ * This class applies constraints with a parallel version of LINCS, similar to P-LINCS.  Each iteration
+ * approximates the inverse of the constraint coupling matrix with a truncated series expansion, so the
+ * work for every constraint and every atom is independent and can be divided between threads no matter
+ * how the constraints are connected.  The constraints are divided into blocks the same way as in CpuCCMA,
+ * keeping each cluster of coupled constraints together unless it is larger than a block, and the blocks
+ * are processed by multiple threads.  Unlike the original algorithm, it does not perform a fixed number
+ * of iterations.  It keeps applying corrections until every constraint satisfies the same tolerance test
+ * used by ReferenceCCMAAlgorithm.
+ * 
+ * This is most useful when a large fraction of the constraints are connected to each other, as happens
+ * when all bonds in a protein are constrained.  The series expansion converges slowly for tightly coupled
+ * constraints, such as when angles are constrained, so CpuCCMA should be used in that case.
+ */
+class OPENMM_EXPORT_CPU CpuLINCS : public ReferenceConstraintAlgorithm {
+public:
+    /**
+     * Create a CpuLINCS object.
+     * 
+     * @param ccma            the constraints to apply are taken from this object
+     * @param threads         the thread pool to use
+     * @param expansionOrder  the number of terms to use in the series expansion of the inverse matrix
+     */
+    CpuLINCS(const ReferenceCCMAAlgorithm& ccma, ThreadPool& threads, int expansionOrder=4);
+
+    /**
+     * Apply the constraint algorithm.
+     * 
+     * @param atomCoordinates  the original atom coordinates
+     * @param atomCoordinatesP the new atom coordinates
+     * @param inverseMasses    1/mass
+     * @param tolerance        the constraint tolerance
+     */
+    void apply(std::vector<OpenMM::Vec3>& atomCoordinates, std::vector<OpenMM::Vec3>& atomCoordinatesP, std::vector<double>& inverseMasses, double tolerance);
+
+    /**
+     * Apply the constraint algorithm to velocities.
+     * 
+     * @param atomCoordinates  the atom coordinates
+     * @param atomCoordinatesP the velocities to modify
+     * @param inverseMasses    1/mass
+     * @param tolerance        the constraint tolerance
+     */
+    void applyToVelocities(std::vector<OpenMM::Vec3>& atomCoordinates, std::vector<OpenMM::Vec3>& velocities, std::vector<double>& inverseMasses, double tolerance);
+
+    /**
+     * Get the number of blocks the constraints have been divided into.
+     */
+    int getNumBlocks() const {
+        return blocks.size();
+    }
+private:
+    /**
+     * A set of constraints that is processed by a single thread, along with the constrained atoms it updates.
+     * Atoms are identified by their index in constrainedAtoms.
+     */
+    class ConstraintBlock {
+    public:
+        std::vector<int> constraints, atoms;
+    };
+    void executeOnBlocks(std::function<void (ConstraintBlock&, int)> task);
+    /**
+     * Get whether every block reported that its constraints have converged.
+     */
+    bool allBlocksConverged() const;
+    /**
+     * Compute the constraint directions and the coupling coefficients from the atom positions.
+     */
+    void computeCoupling(std::vector<OpenMM::Vec3>& atomCoordinates, std::vector<double>& inverseMasses);
+    /**
+     * Solve for the constraint corrections given the current contents of rhs and solution, and
+     * apply them to the atoms.
+     */
+    void solve(std::vector<OpenMM::Vec3>& atomCoordinatesP, std::vector<double>& inverseMasses);
+    ThreadPool& threads;
+    int numConstraints, expansionOrder, maxIterations;
+    std::vector<int> atom1, atom2, constrainedAtoms;
+    std::vector<int> atomConstraintStart, atomConstraintIndex, couplingStart, couplingIndex, couplingAtom;
+    std::vector<double> distance, atomConstraintSign, couplingSign;
+    std::vector<Vec3> direction;
+    std::vector<double> scale, couplingCoefficient, rhs, tempRhs, solution;
+    std::vector<ConstraintBlock> blocks;
+    std::vector<char> blockConverged;
+};
+
+} // namespace OpenMM
+
+#endif /*OPENMM_CPULINCS_H_*/
@@ -84,18 +84,71 @@ public:
     using BlockExclusionMask = int16_t;
 
     const std::vector<BlockExclusionMask>& getBlockExclusions(int blockIndex) const;
+    /**
+     * Set whether the neighbor list will be pruned.  If so, computeNeighborList() keeps a copy of the full list
+     * so that pruneNeighborList() can later be used to remove pairs that are too far apart to interact.
+     */
+    void setUsePruning(bool use);
+    /**
+     * Remove pairs that are further apart than a specified distance, based on the current positions of atoms.
+     * The pruned list is always derived from the full list built by the most recent call to computeNeighborList(),
+     * so pairs that were removed by an earlier call are restored if they have moved closer together.  It is the
+     * caller's responsibility to call this again before any pair not in the pruned list can come within the
+     * interaction cutoff.  This has no effect unless setUsePruning(true) was called before the list was built.
+     *
+     * @param atomLocations       the current positions of the atoms
+     * @param periodicBoxVectors  the current periodic box vectors
+     * @param maxDistance         pairs further apart than this are removed from the list
+     * @param threads             used for parallelization
+     */
+    void pruneNeighborList(const AlignedArray<float>& atomLocations, const Vec3* periodicBoxVectors, float maxDistance, ThreadPool& threads);
+    /**
+     * Set whether computeNeighborList() and pruneNeighborList() should also build a cluster pair list.  In that
+     * form, the neighbors of each block are whole blocks (clusters) rather than individual atoms, so a kernel can
+     * load a neighboring cluster with contiguous vector loads and compute all blockSize*blockSize interactions
+     * of the pair at once.  The atom based list is still built, since other kernels use it.
+     */
+    void setUseClusterPairs(bool use);
+    /**
+     * Get whether a cluster pair list is available.  This is never the case for dense neighbor lists.
+     */
+    bool usesClusterPairs() const;
+    /**
+     * Get the clusters that are neighbors of a block, in increasing order.  The atoms of cluster j are
+     * getSortedAtoms()[blockSize*j] through getSortedAtoms()[blockSize*(j+1)-1].  Only clusters with index less
+     * than or equal to the block's own index are included.
+     */
+    const std::vector<int>& getBlockClusters(int blockIndex) const;
+    /**
+     * Get the exclusions for the clusters that are neighbors of a block.  This contains blockSize elements for
+     * each cluster returned by getBlockClusters().  Element blockSize*i+k marks which atoms in cluster i are
+     * excluded from interacting with atom k of the block.  This includes every atom of the cluster that is not
+     * in the atom based list for the block, so each pair is computed by exactly one of the two lists.
+     */
+    const std::vector<BlockExclusionMask>& getBlockClusterExclusions(int blockIndex) const;
 
     /**
-     * This routine contains the code executed by each thread.
+     * Compute the positions of atoms along the Hilbert curve.  This is executed by each thread.
+     */
+    void threadComputeHilbertBins(ThreadPool& threads, int threadIndex);
+    /**
+     * Find the neighbors of a range of blocks.  This is executed by the worker threads.
      */
-    void threadComputeNeighborList(ThreadPool& threads, int threadIndex);
-    void runThread(int index);
+    void threadComputeBlockNeighbors(int startBlock, int endBlock);
 private:
+    void pruneBlockNeighbors(int blockIndex);
+    void buildBlockClusters(int blockIndex, std::vector<int>& clusterSlot);
+    void buildClusterPairs(ThreadPool& threads);
     int blockSize;
     std::vector<int> sortedAtoms;
     std::vector<float> sortedPositions;
     std::vector<std::vector<int> > blockNeighbors, blockExclusionIndices;
     std::vector<std::vector<BlockExclusionMask> > blockExclusions;
+    std::vector<std::vector<int> > fullBlockNeighbors;
+    std::vector<std::vector<BlockExclusionMask> > fullBlockExclusions;
+    std::vector<int> atomSortedIndex;
+    std::vector<std::vector<int> > blockClusters;
+    std::vector<std::vector<BlockExclusionMask> > blockClusterExclusions;
     // The following variables are used to make information accessible to the individual threads.
     float minx, maxx, miny, maxy, minz, maxz;
     std::vector<std::pair<int, int> > atomBins;
@@ -104,9 +157,8 @@ private:
     const float* atomLocations;
     Vec3 periodicBoxVectors[3];
     int numAtoms;
-    bool usePeriodic, dense;
+    bool usePeriodic, dense, pruning, clusterPairs;
     float maxDistance;
-    std::atomic<int> atomicCounter;
 };
 
 class OPENMM_EXPORT_CPU CpuNeighborList::NeighborIterator {
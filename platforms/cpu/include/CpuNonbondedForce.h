@@ -26,6 +26,7 @@
 #define OPENMM_CPU_NONBONDED_FORCE_H__
 
 #include "AlignedArray.h"
+#include "CpuForceRegions.h"
 #include "CpuNeighborList.h"
 #include "ReferencePairIxn.h"
 #include "openmm/internal/ThreadPool.h"
@@ -134,6 +135,15 @@ class CpuNonbondedForce {
 
       void setPeriodicExceptions(bool periodic);
 
+      /**---------------------------------------------------------------------------------------
+
+         Set the object used to record which atoms each thread adds forces to.  If this is
+         NULL (the default), nothing is recorded.
+
+         --------------------------------------------------------------------------------------- */
+
+      void setForceRegions(CpuForceRegions* regions);
+
       /**---------------------------------------------------------------------------------------
       
          Calculate Ewald ixn
@@ -146,6 +156,7 @@ class CpuNonbondedForce {
          @param exclusions       atom exclusion indices
                                  exclusions[atomIndex] contains the list of exclusions for that atom
          @param forces           force array (forces added)
+         @param writtenTiles     if not NULL, the tiles of the force array that are written to are marked in this
          @param totalEnergy      total energy
             
          --------------------------------------------------------------------------------------- */
@@ -165,6 +176,7 @@ class CpuNonbondedForce {
          @param exclusions       atom exclusion indices
                                  exclusions[atomIndex] contains the list of exclusions for that atom
          @param forces           force array (forces added)
+         @param writtenTiles     if not NULL, the tiles of the force array that are written to are marked in this
          @param totalEnergy      total energy
          @param threads          the thread pool to use
       
@@ -174,9 +186,18 @@ class CpuNonbondedForce {
             const std::vector<float>& C6params, const std::vector<std::set<int> >& exclusions, std::vector<AlignedArray<float> >& threadForce, double* totalEnergy, ThreadPool& threads);
 
     /**
-     * This routine contains the code executed by each thread.
+     * Compute the interactions for a range of neighbor list blocks.  This is executed by the worker threads.
+     */
+    void threadComputeBlocks(ThreadPool& threads, int threadIndex, int startBlock, int endBlock);
+    /**
+     * Subtract off the reciprocal space interactions of excluded pairs for a range of atoms.  This is
+     * executed by the worker threads.
+     */
+    void threadComputeExclusions(ThreadPool& threads, int threadIndex, int startAtom, int endAtom);
+    /**
+     * Pack the data for a range of blocks into clusterData.  This is executed by the worker threads.
      */
-    void threadComputeDirect(ThreadPool& threads, int threadIndex);
+    void threadPackClusters(int startBlock, int endBlock);
 
 protected:
         bool cutoff;
@@ -187,6 +208,7 @@ protected:
         bool ljpme, pme;
         bool tableIsValid, expTableIsValid;
         const CpuNeighborList* neighborList;
+        CpuForceRegions* forceRegions;
         float recipBoxSize[3];
         Vec3 periodicBoxVectors[3];
         AlignedArray<fvec4> periodicBoxVec4;
@@ -208,9 +230,12 @@ protected:
         std::set<int> const* exclusions;
         std::vector<AlignedArray<float> >* threadForce;
         bool includeEnergy;
+        // When the neighbor list contains cluster pairs, the positions, charges, and parameters of the atoms are
+        // packed here, CLUSTER_VALUES arrays of blockSize elements for each block of sorted atoms.
+        AlignedArray<float> clusterData;
+        static const int CLUSTER_VALUES;
         float inverseRcut6;
         float inverseRcut6Expterm;
-        std::atomic<int> atomicCounter, atomicCounter2;
 
         static const float TWO_OVER_SQRT_PI;
         static const int NUM_TABLE_POINTS;
@@ -221,11 +246,12 @@ protected:
       
          @param blockIndex       the index of the atom block
          @param forces           force array (forces added)
+         @param writtenTiles     if not NULL, the tiles of the force array that are written to are marked in this
          @param totalEnergy      total energy
             
          --------------------------------------------------------------------------------------- */
           
-      virtual void calculateBlockIxn(int blockIndex, float* forces, double* totalEnergy, const fvec4& boxSize, const fvec4& invBoxSize) = 0;
+      virtual void calculateBlockIxn(int blockIndex, float* forces, char* writtenTiles, double* totalEnergy, const fvec4& boxSize, const fvec4& invBoxSize) = 0;
             
       /**---------------------------------------------------------------------------------------
       
@@ -233,11 +259,12 @@ protected:
       
          @param blockIndex       the index of the atom block
          @param forces           force array (forces added)
+         @param writtenTiles     if not NULL, the tiles of the force array that are written to are marked in this
          @param totalEnergy      total energy
             
          --------------------------------------------------------------------------------------- */
           
-      virtual void calculateBlockEwaldIxn(int blockIndex, float* forces, double* totalEnergy, const fvec4& boxSize, const fvec4& invBoxSize) = 0;
+      virtual void calculateBlockEwaldIxn(int blockIndex, float* forces, char* writtenTiles, double* totalEnergy, const fvec4& boxSize, const fvec4& invBoxSize) = 0;
 
       /**
        * Compute the displacement and squared distance between two points, optionally using
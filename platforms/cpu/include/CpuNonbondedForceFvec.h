@@ -62,12 +62,13 @@ protected:
       They internally call into the generic handler function below.
       @param blockIndex       the index of the atom block
       @param forces           force array (forces added)
+      @param writtenTiles     if not NULL, the tiles of the force array that are written to are marked in this
       @param totalEnergy      total energy
       --------------------------------------------------------------------------------------- 
       @{
       */
-    void calculateBlockIxn(int blockIndex, float* forces, double* totalEnergy, const fvec4& boxSize, const fvec4& invBoxSize);
-    void calculateBlockEwaldIxn(int blockIndex, float* forces, double* totalEnergy, const fvec4& boxSize, const fvec4& invBoxSize);
+    void calculateBlockIxn(int blockIndex, float* forces, char* writtenTiles, double* totalEnergy, const fvec4& boxSize, const fvec4& invBoxSize);
+    void calculateBlockEwaldIxn(int blockIndex, float* forces, char* writtenTiles, double* totalEnergy, const fvec4& boxSize, const fvec4& invBoxSize);
     /** @} */
 
     /**---------------------------------------------------------------------------------------
@@ -75,7 +76,7 @@ protected:
       with an extra template parameter to choose whether to use Ewald processing or not.
       --------------------------------------------------------------------------------------- */
     template<BlockType BLOCK_TYPE>
-    void calculateBlockIxnHandler(int blockIndex, float* forces, double* totalEnergy, const fvec4& boxSize, const fvec4& invBoxSize);
+    void calculateBlockIxnHandler(int blockIndex, float* forces, char* writtenTiles, double* totalEnergy, const fvec4& boxSize, const fvec4& invBoxSize);
 
     /**
     * Templatized implementation of calculateBlockIxn. It can handle both Ewald and non-ewald interactions
@@ -83,7 +84,16 @@ protected:
     * floating-point SIMD type is also templated to allow any suitable type to be used.
     */
     template <int PERIODIC_TYPE, BlockType BLOCK_TYPE>
-    void calculateBlockIxnImpl(int blockIndex, float* forces, double* totalEnergy, const fvec4& boxSize, const fvec4& invBoxSize, const fvec4& blockCenter);
+    void calculateBlockIxnImpl(int blockIndex, float* forces, char* writtenTiles, double* totalEnergy, const fvec4& boxSize, const fvec4& invBoxSize, const fvec4& blockCenter);
+
+    /**
+     * Alternate implementation of calculateBlockIxn that is used when the neighbor list contains cluster pairs.
+     * Each SIMD lane holds one atom of the neighboring cluster, and the loop runs over the atoms of the block,
+     * so the cluster is loaded from clusterData with contiguous vector loads and its forces are reduced only
+     * once for the whole pair of clusters.
+     */
+    template <int PERIODIC_TYPE, BlockType BLOCK_TYPE>
+    void calculateClusterIxnImpl(int blockIndex, float* forces, char* writtenTiles, double* totalEnergy, const fvec4& boxSize, const fvec4& invBoxSize, const fvec4& blockCenter);
 
     /**
      * Compute the displacement and squared distance between a collection of points, optionally using
@@ -122,18 +132,18 @@ CpuNonbondedForceFvec<FVEC>::approximateFunctionFromTable(const std::vector<floa
 }
 
 template<typename FVEC>
-void CpuNonbondedForceFvec<FVEC>::calculateBlockIxn(int blockIndex, float* forces, double* totalEnergy, const fvec4& boxSize, const fvec4& invBoxSize) {
-    calculateBlockIxnHandler<BlockType::NON_EWALD>(blockIndex, forces, totalEnergy, boxSize, invBoxSize);
+void CpuNonbondedForceFvec<FVEC>::calculateBlockIxn(int blockIndex, float* forces, char* writtenTiles, double* totalEnergy, const fvec4& boxSize, const fvec4& invBoxSize) {
+    calculateBlockIxnHandler<BlockType::NON_EWALD>(blockIndex, forces, writtenTiles, totalEnergy, boxSize, invBoxSize);
 }
 
 template<typename FVEC>
-void CpuNonbondedForceFvec<FVEC>::calculateBlockEwaldIxn(int blockIndex, float* forces, double* totalEnergy, const fvec4& boxSize, const fvec4& invBoxSize) {
-    calculateBlockIxnHandler<BlockType::EWALD>(blockIndex, forces, totalEnergy, boxSize, invBoxSize);
+void CpuNonbondedForceFvec<FVEC>::calculateBlockEwaldIxn(int blockIndex, float* forces, char* writtenTiles, double* totalEnergy, const fvec4& boxSize, const fvec4& invBoxSize) {
+    calculateBlockIxnHandler<BlockType::EWALD>(blockIndex, forces, writtenTiles, totalEnergy, boxSize, invBoxSize);
 }
 
 template<typename FVEC>
 template<BlockType BLOCK_TYPE>
-void CpuNonbondedForceFvec<FVEC>::calculateBlockIxnHandler(int blockIndex, float* forces, double* totalEnergy, const fvec4& boxSize, const fvec4& invBoxSize) {
+void CpuNonbondedForceFvec<FVEC>::calculateBlockIxnHandler(int blockIndex, float* forces, char* writtenTiles, double* totalEnergy, const fvec4& boxSize, const fvec4& invBoxSize) {
     // Determine whether we need to apply periodic boundary conditions.
 
     PeriodicType periodicType;
@@ -174,21 +184,31 @@ void CpuNonbondedForceFvec<FVEC>::calculateBlockIxnHandler(int blockIndex, float
     }
     
     // Call the appropriate version depending on what calculation is required for periodic boundary conditions.
-    if (!cutoff)
-        calculateBlockIxnImpl<NoCutoff, BLOCK_TYPE>(blockIndex, forces, totalEnergy, boxSize, invBoxSize, blockCenter);
+    if (cutoff && neighborList->usesClusterPairs()) {
+        if (periodicType == NoPeriodic)
+            calculateClusterIxnImpl<NoPeriodic, BLOCK_TYPE>(blockIndex, forces, writtenTiles, totalEnergy, boxSize, invBoxSize, blockCenter);
+        else if (periodicType == PeriodicPerAtom)
+            calculateClusterIxnImpl<PeriodicPerAtom, BLOCK_TYPE>(blockIndex, forces, writtenTiles, totalEnergy, boxSize, invBoxSize, blockCenter);
+        else if (periodicType == PeriodicPerInteraction)
+            calculateClusterIxnImpl<PeriodicPerInteraction, BLOCK_TYPE>(blockIndex, forces, writtenTiles, totalEnergy, boxSize, invBoxSize, blockCenter);
+        else if (periodicType == PeriodicTriclinic)
+            calculateClusterIxnImpl<PeriodicTriclinic, BLOCK_TYPE>(blockIndex, forces, writtenTiles, totalEnergy, boxSize, invBoxSize, blockCenter);
+    }
+    else if (!cutoff)
+        calculateBlockIxnImpl<NoCutoff, BLOCK_TYPE>(blockIndex, forces, writtenTiles, totalEnergy, boxSize, invBoxSize, blockCenter);
     else if (periodicType == NoPeriodic)
-        calculateBlockIxnImpl<NoPeriodic, BLOCK_TYPE>(blockIndex, forces, totalEnergy, boxSize, invBoxSize, blockCenter);
+        calculateBlockIxnImpl<NoPeriodic, BLOCK_TYPE>(blockIndex, forces, writtenTiles, totalEnergy, boxSize, invBoxSize, blockCenter);
     else if (periodicType == PeriodicPerAtom)
-        calculateBlockIxnImpl<PeriodicPerAtom, BLOCK_TYPE>(blockIndex, forces, totalEnergy, boxSize, invBoxSize, blockCenter);
+        calculateBlockIxnImpl<PeriodicPerAtom, BLOCK_TYPE>(blockIndex, forces, writtenTiles, totalEnergy, boxSize, invBoxSize, blockCenter);
     else if (periodicType == PeriodicPerInteraction)
-        calculateBlockIxnImpl<PeriodicPerInteraction, BLOCK_TYPE>(blockIndex, forces, totalEnergy, boxSize, invBoxSize, blockCenter);
+        calculateBlockIxnImpl<PeriodicPerInteraction, BLOCK_TYPE>(blockIndex, forces, writtenTiles, totalEnergy, boxSize, invBoxSize, blockCenter);
     else if (periodicType == PeriodicTriclinic)
-        calculateBlockIxnImpl<PeriodicTriclinic, BLOCK_TYPE>(blockIndex, forces, totalEnergy, boxSize, invBoxSize, blockCenter);
+        calculateBlockIxnImpl<PeriodicTriclinic, BLOCK_TYPE>(blockIndex, forces, writtenTiles, totalEnergy, boxSize, invBoxSize, blockCenter);
 }
 
 template<typename FVEC>
 template <int PERIODIC_TYPE, BlockType BLOCK_TYPE>
-void CpuNonbondedForceFvec<FVEC>::calculateBlockIxnImpl(int blockIndex, float* forces, double* totalEnergy, const fvec4& boxSize, const fvec4& invBoxSize, const fvec4& blockCenter) {
+void CpuNonbondedForceFvec<FVEC>::calculateBlockIxnImpl(int blockIndex, float* forces, char* writtenTiles, double* totalEnergy, const fvec4& boxSize, const fvec4& invBoxSize, const fvec4& blockCenter) {
     // Load the positions and parameters of the atoms in the block.
 
     const int32_t* blockAtom = &neighborList->getSortedAtoms()[blockSize*blockIndex];
@@ -315,6 +335,8 @@ void CpuNonbondedForceFvec<FVEC>::calculateBlockIxnImpl(int blockIndex, float* f
         float* const atomForce = forces+4*atom;
         const fvec4 newAtomForce = fvec4(atomForce) - reduceToVec3(fx, fy, fz);
         newAtomForce.store(atomForce);
+        if (writtenTiles != NULL)
+            writtenTiles[atom/CpuForceRegions::TileSize] = 1;
     }
     
     if (totalEnergy)
@@ -325,6 +347,151 @@ void CpuNonbondedForceFvec<FVEC>::calculateBlockIxnImpl(int blockIndex, float* f
     transpose(blockAtomForceX, blockAtomForceY, blockAtomForceZ, 0.0f, f);
     for (int j = 0; j < blockSize; j++)
         (fvec4(forces+4*blockAtom[j])+f[j]).store(forces+4*blockAtom[j]);
+    if (writtenTiles != NULL)
+        for (int j = 0; j < blockSize; j++)
+            writtenTiles[blockAtom[j]/CpuForceRegions::TileSize] = 1;
+}
+
+template<typename FVEC>
+template <int PERIODIC_TYPE, BlockType BLOCK_TYPE>
+void CpuNonbondedForceFvec<FVEC>::calculateClusterIxnImpl(int blockIndex, float* forces, char* writtenTiles, double* totalEnergy, const fvec4& boxSize, const fvec4& invBoxSize, const fvec4& blockCenter) {
+    // Load the positions and parameters of the atoms in the block.  Each one is used in turn as a scalar
+    // interacting with all the atoms of a neighboring cluster.
+
+    const int32_t* blockAtom = &neighborList->getSortedAtoms()[blockSize*blockIndex];
+    fvec4 blockAtomPos[blockSize];
+    float blockAtomCharge[blockSize], blockAtomSigma[blockSize], blockAtomEpsilon[blockSize], blockAtomC6[blockSize];
+    FVEC blockAtomForceX[blockSize], blockAtomForceY[blockSize], blockAtomForceZ[blockSize];
+    for (int i = 0; i < blockSize; i++) {
+        blockAtomPos[i] = fvec4(posq+4*blockAtom[i]);
+        if (PERIODIC_TYPE == PeriodicPerAtom)
+            blockAtomPos[i] -= floor((blockAtomPos[i]-blockCenter)*invBoxSize+0.5f)*boxSize;
+        blockAtomCharge[i] = ONE_4PI_EPS0*posq[4*blockAtom[i]+3];
+        blockAtomSigma[i] = atomParameters[blockAtom[i]].first;
+        blockAtomEpsilon[i] = atomParameters[blockAtom[i]].second;
+        blockAtomC6[i] = C6params[blockAtom[i]];
+        blockAtomForceX[i] = 0.0f;
+        blockAtomForceY[i] = 0.0f;
+        blockAtomForceZ[i] = 0.0f;
+    }
+    const float invSwitchingInterval = 1/(cutoffDistance-switchingDistance);
+    const FVEC cutoffDistanceSquared = cutoffDistance * cutoffDistance;
+    const CpuNeighborList::BlockExclusionMask allExcluded = (CpuNeighborList::BlockExclusionMask) ((1<<blockSize)-1);
+
+    // Loop over neighboring clusters.
+
+    const std::vector<int>& clusters = neighborList->getBlockClusters(blockIndex);
+    const std::vector<CpuNeighborList::BlockExclusionMask>& clusterExclusions = neighborList->getBlockClusterExclusions(blockIndex);
+    FVEC partialEnergy = {};
+    for (int c = 0; c < (int) clusters.size(); c++) {
+        const float* data = &clusterData[CLUSTER_VALUES*blockSize*clusters[c]];
+        FVEC clusterX(data), clusterY(data+blockSize), clusterZ(data+2*blockSize);
+        const FVEC clusterCharge(data+3*blockSize), clusterSigma(data+4*blockSize), clusterEpsilon(data+5*blockSize);
+        const FVEC clusterC6 = (BLOCK_TYPE == BlockType::EWALD) ? FVEC(data+6*blockSize) : FVEC();
+        if (PERIODIC_TYPE == PeriodicPerAtom) {
+            clusterX -= floor((clusterX-blockCenter[0])*invBoxSize[0]+0.5f)*boxSize[0];
+            clusterY -= floor((clusterY-blockCenter[1])*invBoxSize[1]+0.5f)*boxSize[1];
+            clusterZ -= floor((clusterZ-blockCenter[2])*invBoxSize[2]+0.5f)*boxSize[2];
+        }
+        const CpuNeighborList::BlockExclusionMask* exclusions = &clusterExclusions[blockSize*c];
+        FVEC clusterForceX(0.0f), clusterForceY(0.0f), clusterForceZ(0.0f);
+        for (int i = 0; i < blockSize; i++) {
+            if ((exclusions[i] & allExcluded) == allExcluded)
+                continue;
+
+            // Compute the distances from this block atom to the cluster atoms.
+
+            FVEC dx, dy, dz, r2;
+            getDeltaR<PERIODIC_TYPE>(blockAtomPos[i], clusterX, clusterY, clusterZ, dx, dy, dz, r2, boxSize, invBoxSize);
+            auto include = blendZero(r2 < cutoffDistanceSquared, FVEC::expandBitsToMask(~exclusions[i]));
+            if (!any(include))
+                continue;
+
+            // Compute the interactions.
+            const auto inverseR = rsqrt(r2);
+            const auto r = r2*inverseR;
+            FVEC energy, dEdR;
+            if (blockAtomEpsilon[i] != 0.0f) {
+                const auto sig = clusterSigma+blockAtomSigma[i];
+                const auto sig2 = (inverseR*sig)*(inverseR*sig);
+                const auto sig6 = sig2*sig2*sig2;
+                const auto eps = clusterEpsilon*blockAtomEpsilon[i];
+                const auto epsSig6 = eps*sig6;
+                dEdR = epsSig6*(12.0f*sig6 - 6.0f);
+                energy = epsSig6*(sig6-1.0f);
+                if (useSwitch) {
+                    const auto t = blendZero((r-switchingDistance)*invSwitchingInterval, r>switchingDistance);
+                    const auto switchValue = 1+t*t*t*(-10.0f+t*(15.0f-t*6.0f));
+                    const auto switchDeriv = t*t*(-30.0f+t*(60.0f-t*30.0f))*invSwitchingInterval;
+                    dEdR = switchValue*dEdR - energy*switchDeriv*r;
+                    energy *= switchValue;
+                }
+                if (BLOCK_TYPE == BlockType::EWALD && ljpme) {
+                    const auto C6ij = clusterC6*blockAtomC6[i];
+                    const auto inverseR2 = inverseR*inverseR;
+                    const auto mysig2 = sig*sig;
+                    const auto mysig6 = mysig2*mysig2*mysig2;
+                    const auto emult = C6ij*inverseR2*inverseR2*inverseR2*approximateFunctionFromTable(exptermsTable, r, FVEC(exptermsDXInv));
+                    const auto potentialShift = eps*(1.0f-mysig6*inverseRcut6)*mysig6*inverseRcut6 - C6ij*inverseRcut6Expterm;
+                    dEdR += 6.0f*C6ij*inverseR2*inverseR2*inverseR2*approximateFunctionFromTable(dExptermsTable, r, FVEC(exptermsDXInv));
+                    energy += emult + potentialShift;
+                }
+            }
+            else {
+                energy = 0.0f;
+                dEdR = 0.0f;
+            }
+            const auto chargeProd = clusterCharge*blockAtomCharge[i];
+            if (BLOCK_TYPE == BlockType::EWALD)
+                dEdR += chargeProd*inverseR*approximateFunctionFromTable(ewaldScaleTable, r, FVEC(ewaldDXInv));
+            else
+                dEdR += chargeProd*(inverseR-2.0f*krf*r2);
+            dEdR *= inverseR*inverseR;
+
+            // Accumulate energies.
+            if (totalEnergy) {
+                if (BLOCK_TYPE == BlockType::EWALD)
+                    energy += chargeProd*inverseR*approximateFunctionFromTable(erfcTable, alphaEwald*r, FVEC(erfcDXInv));
+                else
+                    energy += chargeProd*(inverseR+krf*r2-crf);
+                partialEnergy += blendZero(energy, include);
+            }
+
+            // Accumulate forces.
+            dEdR = blendZero(dEdR, include);
+            const auto fx = dx*dEdR;
+            const auto fy = dy*dEdR;
+            const auto fz = dz*dEdR;
+            clusterForceX += fx;
+            clusterForceY += fy;
+            clusterForceZ += fz;
+            blockAtomForceX[i] -= fx;
+            blockAtomForceY[i] -= fy;
+            blockAtomForceZ[i] -= fz;
+        }
+
+        // Record the forces on the cluster atoms.
+        const int32_t* clusterAtom = &neighborList->getSortedAtoms()[blockSize*clusters[c]];
+        fvec4 f[blockSize];
+        transpose(clusterForceX, clusterForceY, clusterForceZ, 0.0f, f);
+        for (int j = 0; j < blockSize; j++)
+            (fvec4(forces+4*clusterAtom[j])+f[j]).store(forces+4*clusterAtom[j]);
+        if (writtenTiles != NULL)
+            for (int j = 0; j < blockSize; j++)
+                writtenTiles[clusterAtom[j]/CpuForceRegions::TileSize] = 1;
+    }
+
+    if (totalEnergy)
+        *totalEnergy += reduceAdd(partialEnergy);
+
+    // Record the forces on the block atoms.
+    for (int i = 0; i < blockSize; i++) {
+        const fvec4 f = reduceToVec3(blockAtomForceX[i], blockAtomForceY[i], blockAtomForceZ[i]);
+        (fvec4(forces+4*blockAtom[i])+f).store(forces+4*blockAtom[i]);
+    }
+    if (writtenTiles != NULL)
+        for (int i = 0; i < blockSize; i++)
+            writtenTiles[blockAtom[i]/CpuForceRegions::TileSize] = 1;
 }
 
 template<typename FVEC>
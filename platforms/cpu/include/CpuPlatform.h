@@ -33,6 +33,7 @@
  * -------------------------------------------------------------------------- */
 
 #include "AlignedArray.h"
+#include "CpuForceRegions.h"
 #include "CpuRandom.h"
 #include "CpuNeighborList.h"
 #include "ReferencePlatform.h"
@@ -77,6 +78,98 @@ public:
         static const std::string key = "DeterministicForces";
         return key;
     }
+    /**
+     * This is the name of the parameter for selecting spatially decomposed force accumulation.  When this
+     * is "true", the platform keeps track of which atoms each thread adds forces to, so that clearing and
+     * summing the per-thread force buffers only touches those atoms.  This reduces memory traffic when
+     * there are many threads and many atoms, but has a small bookkeeping cost for smaller systems.
+     */
+    static const std::string& CpuSpatialForceAccumulation() {
+        static const std::string key = "SpatialForceAccumulation";
+        return key;
+    }
+    /**
+     * This is the name of the parameter for selecting whether to reorder particles.  When this is "true",
+     * the platform stores positions, forces, and the per-particle parameters of nonbonded and implicit solvent
+     * forces internally in the order of a space filling curve, so that atoms that are close in space are also
+     * close in memory.  The order is updated whenever the neighbor list is rebuilt.  Velocities are only touched
+     * by the integrators, which process particles independently and in sequence, so they stay in the order of
+     * the System.  This is invisible outside the platform: positions, velocities, and forces are still reported
+     * in the order of the System.
+     */
+    static const std::string& CpuParticleReordering() {
+        static const std::string key = "ParticleReordering";
+        return key;
+    }
+    /**
+     * This is the name of the parameter for selecting whether independent forces may be computed concurrently.
+     * When this is "true" (the default), bonded forces are computed by the worker threads in the background while
+     * the forces that follow them are being computed, so their tasks are interleaved with the direct space
+     * nonbonded tasks.  The reciprocal space part of PME is computed at the same time as the direct space part.
+     * The bonded forces and energies are identical either way, and everything else differs by no more than the
+     * usual rounding differences between runs.  On steps that compute the energy, each bonded force waits for its
+     * own tasks to finish, so bonded forces only overlap with other forces on steps that compute forces alone.
+     */
+    static const std::string& CpuConcurrentForces() {
+        static const std::string key = "ConcurrentForces";
+        return key;
+    }
+    /**
+     * This is the name of the parameter for selecting whether the neighbor list should be pruned.  When this is
+     * "true", the full neighbor list is rebuilt less often, and in between pairs that are too far apart to
+     * interact are periodically pruned from it, so the nonbonded kernels only loop over pairs that are close
+     * to the cutoff.
+     */
+    static const std::string& CpuNeighborListPruning() {
+        static const std::string key = "NeighborListPruning";
+        return key;
+    }
+    /**
+     * This is the name of the parameter for choosing the neighbor list buffer automatically.  If it is 0 (the
+     * default), a fixed buffer is used.  Otherwise, each time the neighbor list is rebuilt the buffer is estimated
+     * from the instantaneous temperature, the particle masses, and the step size.  It is made just large enough
+     * that the expected number of particles moving far enough to force another rebuild within a target number
+     * of steps is no larger than this value.  The neighbor list is always rebuilt when it needs to be, so this
+     * affects only performance, not accuracy.
+     */
+    static const std::string& CpuVerletBufferTolerance() {
+        static const std::string key = "VerletBufferTolerance";
+        return key;
+    }
+    /**
+     * This is the name of the parameter for selecting the algorithm used for constraints that are not handled
+     * by SETTLE.  Allowed values are "CCMA" (the default) and "LINCS".  CCMA divides the constraints into clusters
+     * that share no atoms and processes different clusters on different threads.  LINCS divides the work for
+     * every constraint between threads, which scales better when most constraints are connected to each other,
+     * but converges slowly if angles are constrained.  Both iterate until every constraint is satisfied to
+     * within the requested tolerance.
+     */
+    static const std::string& CpuConstraintAlgorithm() {
+        static const std::string key = "ConstraintAlgorithm";
+        return key;
+    }
+    /**
+     * This is the name of the parameter for selecting whether CustomNonbondedForce may use tabulated interactions.
+     * When this is "true", if the energy depends only on r, global parameters, and per-particle parameters that take
+     * a small number of distinct combinations of values, cubic spline tables of the energy and force are built for
+     * every pair of combinations, and the inner loop looks up the interaction instead of evaluating the expression.
+     * Tables are only used if they reproduce the expression to within single precision accuracy at every point checked.
+     */
+    static const std::string& CpuTabulatedNonbonded() {
+        static const std::string key = "TabulatedNonbonded";
+        return key;
+    }
+    /**
+     * This is the name of the parameter for selecting whether NonbondedForce should use a cluster pair neighbor
+     * list.  When this is "true", the neighbors of each block of atoms are grouped into whole blocks, and the
+     * kernel computes all interactions between a pair of blocks at once, loading the neighboring block with
+     * contiguous vector loads and reducing its forces once per pair instead of once per neighbor atom.  The
+     * default is "true".  Setting it to "false" uses a list of individual neighbor atoms for each block instead.
+     */
+    static const std::string& CpuClusterPairList() {
+        static const std::string key = "ClusterPairList";
+        return key;
+    }
     /**
      * We cannot use the standard mechanism for platform data, because that is already used by the superclass.
      * Instead, we maintain a table of ContextImpls to PlatformDatas.
@@ -89,7 +182,10 @@ private:
 
 class CpuPlatform::PlatformData {
 public:
-    PlatformData(int numParticles, int numThreads, bool deterministicForces);
+    PlatformData(int numParticles, int numThreads, bool deterministicForces, bool spatialForceAccumulation=false, bool particleReordering=false,
+            bool concurrentForces=false, bool neighborListPruning=false, double verletBufferTolerance=0.0,
+            const std::string& constraintAlgorithm="CCMA", bool tabulatedNonbonded=false,
+            bool clusterPairList=false);
     ~PlatformData();
     /**
      * Request that a neighbor list be built and maintained.
@@ -105,18 +201,95 @@ public:
      */
     void requestNeighborList(double cutoffDistance, double padding, bool useExclusions, const std::vector<std::set<int> >& exclusionList);
     int requestPosqIndex();
+    /**
+     * Record that forces may have been added to any atom in any thread's force buffer.  This
+     * should be called after executing code that writes to threadForce without marking the
+     * atoms it wrote in forceRegions.
+     */
+    void markAllThreadForces();
+    /**
+     * Sort the particles along a space filling curve based on their current positions.  This updates
+     * atomOrder and permutes posq to match.  It has no effect unless particle reordering is enabled.
+     */
+    void reorderParticles();
+    /**
+     * Permute an array of per-particle values from the order of the System to the order used for posq.
+     */
+    template <class T>
+    void reorderParticleArray(const std::vector<T>& values, std::vector<T>& result) const {
+        result.resize(values.size());
+        for (int i = 0; i < (int) values.size(); i++)
+            result[i] = values[atomOrder[i]];
+    }
+    /**
+     * Convert a list of exclusions from the order of the System to the order used for posq.
+     */
+    void reorderExclusions(const std::vector<std::set<int> >& exclusionList, std::vector<std::set<int> >& result) const;
+    /**
+     * Some kernels need to see particles in the order of the System.  When particle reordering is enabled,
+     * they should call this first.  It copies posq to unorderedPosq in the System order.  The kernel should
+     * then add its forces to unorderedForce, and call endUnorderedComputation() when it is finished.
+     */
+    void beginUnorderedComputation();
+    /**
+     * Add the forces that were accumulated in unorderedForce to threadForce, and clear unorderedForce.
+     */
+    void endUnorderedComputation();
+    /**
+     * Kernels that can run concurrently with other forces call this once when they are initialized.  It allocates
+     * a force buffer for the kernel and returns its index, which should be passed to beginConcurrentForce().
+     */
+    int addConcurrentForce();
+    /**
+     * Kernels that can run concurrently with other forces call this before adding their tasks to the ThreadPool.
+     * They should add their forces to the buffer returned by this method and record their energy themselves.
+     * Every kernel has its own buffer, so their tasks do not need to depend on each other.  The buffers are added
+     * to the total force in the order the kernels were initialized, so the result does not depend on how the
+     * tasks are scheduled.
+     *
+     * @param index   the index that was returned by addConcurrentForce()
+     * @return the buffer to add the kernel's forces to
+     */
+    std::vector<Vec3>& beginConcurrentForce(int index);
+    /**
+     * This is called after adding the tasks for a concurrent kernel.  If concurrent forces are enabled, the worker
+     * threads begin executing the tasks in the background.  Otherwise, or if wait is true, this blocks until they
+     * have finished.
+     *
+     * @param task    a task that finishes once the kernel's forces and energy have been computed
+     * @param wait    if true, block until the task has finished so the kernel can return its energy
+     */
+    void endConcurrentForce(const ThreadPool::TaskHandle& task, bool wait=false);
+    /**
+     * Wait for all concurrent kernels to finish and add their forces to an array.
+     *
+     * @param forces   the forces from the concurrent kernels are added to this
+     */
+    void finishConcurrentForces(std::vector<Vec3>& forces);
+    /**
+     * Wait for any tasks left over from a force evaluation that was interrupted by an exception, and clear
+     * the buffers they wrote to.
+     */
+    void discardConcurrentForces();
     AlignedArray<float> posq;
     std::vector<AlignedArray<float> > threadForce;
+    CpuForceRegions* forceRegions;
     ThreadPool threads;
     bool isPeriodic;
     CpuRandom random;
     std::map<std::string, std::string> propertyValues;
     int numParticles;
     CpuNeighborList* neighborList;
-    double cutoff, paddedCutoff;
-    bool anyExclusions, deterministicForces;
-    int currentPosqIndex, nextPosqIndex;
-    std::vector<std::set<int> > exclusions;
+    double cutoff, paddedCutoff, requestedPadding, verletBufferTolerance;
+    bool anyExclusions, deterministicForces, particleReordering, concurrentForces, neighborListPruning;
+    bool tabulatedNonbonded, clusterPairList;
+    int currentPosqIndex, nextPosqIndex, atomOrderVersion;
+    std::vector<std::set<int> > exclusions, orderedExclusions;
+    std::vector<int> atomOrder, inverseAtomOrder;
+    AlignedArray<float> unorderedPosq;
+    std::vector<AlignedArray<float> > unorderedForce;
+    std::vector<std::vector<Vec3> > concurrentForceBuffers;
+    std::vector<bool> concurrentForceUsed;
 };
 
 } // namespace OpenMM
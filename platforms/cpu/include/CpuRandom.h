@@ -47,13 +47,16 @@ public:
     ~CpuRandom();
     void initialize(int seed, int numThreads);
     float getGaussianRandom(int threadIndex);
-    float getUniformRandom(int threadIndex);
+    double getGaussianRandomDouble(int threadIndex);
+    double getUniformRandom(int threadIndex);
 private:
     bool hasInitialized;
     int randomSeed;
     std::vector<OpenMM_SFMT::SFMT*> threadRandom;
     std::vector<float> nextGaussian;
     std::vector<int> nextGaussianIsValid;
+    std::vector<double> nextGaussianDouble;
+    std::vector<int> nextGaussianDoubleIsValid;
 };
 
 } // namespace OpenMM
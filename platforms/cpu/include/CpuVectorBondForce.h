@@ -0,0 +1,174 @@
+#ifndef OPENMM_CPUVECTORBONDFORCE_H_
+#define OPENMM_CPUVECTORBONDFORCE_H_
+
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "CpuBondForce.h"
+#include "windowsExportCpu.h"
+#include "openmm/Vec3.h"
+#include "openmm/internal/ThreadPool.h"
+#include <cmath>
+#include <vector>
+
+namespace OpenMM {
+
+/**
+ * This class computes bonded interactions with SIMD instructions.  The bonds are
+ * divided between threads exactly as in CpuBondForce, but the atom indices and
+ * parameters for each thread's bonds are stored in packed structure-of-arrays form
+ * so that a full vector of bonds can be processed at once.
+ *
+ * Use createCpuVectorBondForce() to create an instance that uses the widest vector
+ * type supported by the processor.
+ */
+class OPENMM_EXPORT_CPU CpuVectorBondForce {
+public:
+    /**
+     * The types of interactions this class can compute.  The parameters for each bond
+     * are given in the same order as for the corresponding ReferenceBondIxn:
+     *
+     * HarmonicBond: length, k
+     * HarmonicAngle: angle, k
+     * PeriodicTorsion: k, phase, periodicity
+     * RBTorsion: c0, c1, c2, c3, c4, c5
+     */
+    enum BondType {
+        HarmonicBond = 0,
+        HarmonicAngle = 1,
+        PeriodicTorsion = 2,
+        RBTorsion = 3
+    };
+    CpuVectorBondForce(BondType type, int blockSize);
+    virtual ~CpuVectorBondForce();
+    /**
+     * Get the number of atoms in each bond for a type of interaction.
+     */
+    static int getNumAtomsPerBond(BondType type);
+    /**
+     * Get the number of parameters for each bond for a type of interaction.
+     */
+    static int getNumParameters(BondType type);
+    /**
+     * Analyze the set of bonds and decide which to compute with each thread.
+     *
+     * @param numAtoms    the number of atoms in the system
+     * @param bondAtoms   bondAtoms[i] contains the indices of the atoms in bond i
+     * @param threads     the ThreadPool to use for computing forces
+     */
+    void initialize(int numAtoms, std::vector<std::vector<int> >& bondAtoms, ThreadPool& threads);
+    /**
+     * Set the parameters for all bonds.  This must be called at least once after initialize()
+     * and again whenever the parameters change.
+     *
+     * @param parameters  parameters[i] contains the parameters for bond i
+     */
+    void setParameters(const std::vector<std::vector<double> >& parameters);
+    /**
+     * Compute the forces from all bonds.
+     *
+     * @param atomCoordinates  the positions of all atoms
+     * @param forces           the forces are added to this
+     * @param totalEnergy      if not NULL, the energy is added to this
+     * @param boxVectors       the periodic box vectors, or NULL if periodic boundary conditions should not be applied
+     */
+    void calculateForce(const std::vector<Vec3>& atomCoordinates, std::vector<Vec3>& forces, double* totalEnergy, const Vec3* boxVectors);
+    /**
+     * Add tasks to the ThreadPool that compute the forces from all bonds, but do not wait for them
+     * to run.  The arguments are the same as for calculateForce().  The coordinates, forces, and energy
+     * must remain valid until the tasks have finished.
+     *
+     * @param dependencies     tasks that must finish before any of the forces are computed
+     * @return a task that finishes once all forces and the energy have been computed
+     */
+    ThreadPool::TaskHandle addForceTasks(const std::vector<Vec3>& atomCoordinates, std::vector<Vec3>& forces, double* totalEnergy,
+            const Vec3* boxVectors, const std::vector<ThreadPool::TaskHandle>& dependencies=std::vector<ThreadPool::TaskHandle>());
+protected:
+    /**
+     * The atom indices and parameters for a set of bonds, stored in structure-of-arrays form.
+     * Each array is padded to a multiple of the block size.  Padding elements repeat the atoms
+     * of the first bond and have all parameters set to 0, so they produce no force or energy.
+     *
+     * The parameters are stored in the form the kernels use them, which is the same as the
+     * order listed for BondType except for periodic torsions.  Those store k, cos(phase),
+     * sin(phase), and periodicity, so the kernel never needs to evaluate a trig function.
+     */
+    struct BondBlock {
+        int numBonds, maxPeriodicity;
+        std::vector<int> bondIndex;
+        std::vector<std::vector<int> > atoms;
+        std::vector<std::vector<float> > params;
+    };
+    /**
+     * Compute the interactions for a set of bonds.  This is implemented by subclasses for
+     * a particular vector type.
+     *
+     * @param bonds            the set of bonds to compute
+     * @param atomCoordinates  the positions of all atoms
+     * @param forces           the forces are added to this
+     * @param totalEnergy      if not NULL, the energy is added to this
+     * @param boxVectors       the periodic box vectors, or NULL if periodic boundary conditions should not be applied
+     */
+    virtual void calculateBlockIxn(const BondBlock& bonds, const std::vector<Vec3>& atomCoordinates, std::vector<Vec3>& forces,
+            double* totalEnergy, const Vec3* boxVectors) = 0;
+    /**
+     * Compute the displacement from atom1 to atom2, applying periodic boundary conditions if boxVectors is not NULL.
+     */
+    static Vec3 getDeltaR(const Vec3& atom1, const Vec3& atom2, const Vec3* boxVectors) {
+        Vec3 delta = atom2-atom1;
+        if (boxVectors != NULL) {
+            delta -= boxVectors[2]*floor(delta[2]/boxVectors[2][2]+0.5);
+            delta -= boxVectors[1]*floor(delta[1]/boxVectors[1][1]+0.5);
+            delta -= boxVectors[0]*floor(delta[0]/boxVectors[0][0]+0.5);
+        }
+        return delta;
+    }
+    BondType type;
+    int blockSize, numAtomsPerBond, numParams, numPackedParams;
+private:
+    void packBonds(const std::vector<int>& bonds, std::vector<std::vector<int> >& bondAtoms, BondBlock& block);
+    void copyParameters(const std::vector<std::vector<double> >& parameters, BondBlock& block);
+    ThreadPool* threads;
+    CpuBondForce partition;
+    std::vector<BondBlock> threadBlocks;
+    BondBlock extraBlock;
+    std::vector<double> blockEnergy;
+    Vec3 periodicBoxVectors[3];
+};
+
+/**
+ * Create a CpuVectorBondForce that uses the widest vector type supported by the processor.
+ */
+OPENMM_EXPORT_CPU CpuVectorBondForce* createCpuVectorBondForce(CpuVectorBondForce::BondType type);
+
+} // namespace OpenMM
+
+#endif /*OPENMM_CPUVECTORBONDFORCE_H_*/
@@ -0,0 +1,297 @@
+#ifndef OPENMM_CPUVECTORBONDFORCEFVEC_H_
+#define OPENMM_CPUVECTORBONDFORCEFVEC_H_
+
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "CpuVectorBondForce.h"
+#include "openmm/internal/vectorize.h"
+#include <algorithm>
+
+namespace OpenMM {
+
+/**
+ * Generic SIMD implementation of CpuVectorBondForce.  The templating allows the same code
+ * to be reused for any sort of SIMD type.  Displacements between atoms are computed in double
+ * precision so that large coordinates do not lose accuracy.  Everything after that is done
+ * in single precision, processing one vector of bonds at a time.
+ *
+ * Angles are computed as atan2(|a x b|, a.b) rather than acos(), which stays accurate for
+ * nearly linear angles.  Torsions never compute the dihedral angle itself.  Periodic torsions
+ * build cos(n*phi) and sin(n*phi) from cos(phi) and sin(phi) with the angle addition formulas,
+ * and Ryckaert-Bellemans torsions only need cos(psi) and sin(psi).
+ */
+template <typename FVEC>
+class CpuVectorBondForceFvec : public CpuVectorBondForce {
+public:
+    static constexpr int blockSize = sizeof(FVEC)/sizeof(float);
+    CpuVectorBondForceFvec(BondType type) : CpuVectorBondForce(type, blockSize) {
+    }
+protected:
+    void calculateBlockIxn(const BondBlock& bonds, const std::vector<Vec3>& atomCoordinates, std::vector<Vec3>& forces,
+            double* totalEnergy, const Vec3* boxVectors);
+private:
+    void calculateHarmonicBondIxn(const BondBlock& bonds, int start, const std::vector<Vec3>& atomCoordinates, std::vector<Vec3>& forces,
+            double* totalEnergy, const Vec3* boxVectors);
+    void calculateHarmonicAngleIxn(const BondBlock& bonds, int start, const std::vector<Vec3>& atomCoordinates, std::vector<Vec3>& forces,
+            double* totalEnergy, const Vec3* boxVectors);
+    void calculateTorsionIxn(const BondBlock& bonds, int start, const std::vector<Vec3>& atomCoordinates, std::vector<Vec3>& forces,
+            double* totalEnergy, const Vec3* boxVectors);
+    /**
+     * Compute the displacement from atom1 to atom2 for every bond in a block.
+     */
+    void getDeltaR(const BondBlock& bonds, int start, int atom1, int atom2, const std::vector<Vec3>& atomCoordinates,
+            const Vec3* boxVectors, FVEC& dx, FVEC& dy, FVEC& dz) const;
+    /**
+     * Load one parameter for every bond in a block.
+     */
+    FVEC loadParameter(const BondBlock& bonds, int start, int index) const {
+        return FVEC(&bonds.params[index][start]);
+    }
+    /**
+     * Add a force to one atom of every bond in a block.  Padding elements are skipped.
+     */
+    void addForces(const BondBlock& bonds, int start, int atom, const FVEC& fx, const FVEC& fy, const FVEC& fz, std::vector<Vec3>& forces) const;
+    /**
+     * Add the energy of every bond in a block to the total.  Padding elements are skipped.
+     */
+    void addEnergy(const BondBlock& bonds, int start, const FVEC& energy, double* totalEnergy) const;
+    static void crossProduct(const FVEC& ax, const FVEC& ay, const FVEC& az, const FVEC& bx, const FVEC& by, const FVEC& bz, FVEC& cx, FVEC& cy, FVEC& cz) {
+        cx = ay*bz-az*by;
+        cy = az*bx-ax*bz;
+        cz = ax*by-ay*bx;
+    }
+    /**
+     * Compute atan2(y, x) for y >= 0, giving a result between 0 and pi.  The argument of the
+     * polynomial is reduced to [0, tan(pi/8)], where it is accurate to about one ulp.
+     */
+    static FVEC atan2Positive(const FVEC& y, const FVEC& x) {
+        FVEC absx = abs(x);
+        FVEC numerator = min(y, absx);
+        FVEC denominator = max(y, absx);
+        FVEC t = blendZero(numerator/denominator, denominator > 0.0f);
+        auto reduce = t > 0.41421356f;
+        t = blend(t, (t-1.0f)/(t+1.0f), reduce);
+        FVEC z = t*t;
+        FVEC angle = ((((8.05374449538e-2f*z - 1.38776856032e-1f)*z + 1.99777106478e-1f)*z - 3.33329491539e-1f)*z)*t + t;
+        angle = blend(angle, angle+0.78539816f, reduce);
+        angle = blend(angle, 1.57079633f-angle, y > absx);
+        return blend(angle, 3.14159265f-angle, x < 0.0f);
+    }
+};
+
+template <typename FVEC>
+void CpuVectorBondForceFvec<FVEC>::calculateBlockIxn(const BondBlock& bonds, const std::vector<Vec3>& atomCoordinates, std::vector<Vec3>& forces,
+            double* totalEnergy, const Vec3* boxVectors) {
+    for (int start = 0; start < bonds.numBonds; start += blockSize) {
+        if (type == HarmonicBond)
+            calculateHarmonicBondIxn(bonds, start, atomCoordinates, forces, totalEnergy, boxVectors);
+        else if (type == HarmonicAngle)
+            calculateHarmonicAngleIxn(bonds, start, atomCoordinates, forces, totalEnergy, boxVectors);
+        else
+            calculateTorsionIxn(bonds, start, atomCoordinates, forces, totalEnergy, boxVectors);
+    }
+}
+
+template <typename FVEC>
+void CpuVectorBondForceFvec<FVEC>::calculateHarmonicBondIxn(const BondBlock& bonds, int start, const std::vector<Vec3>& atomCoordinates, std::vector<Vec3>& forces,
+            double* totalEnergy, const Vec3* boxVectors) {
+    FVEC dx, dy, dz;
+    getDeltaR(bonds, start, 0, 1, atomCoordinates, boxVectors, dx, dy, dz);
+    FVEC length = loadParameter(bonds, start, 0);
+    FVEC k = loadParameter(bonds, start, 1);
+    FVEC r = sqrt(dx*dx + dy*dy + dz*dz);
+    FVEC deltaIdeal = r-length;
+    FVEC dEdR = blendZero(k*deltaIdeal/r, r > 0.0f);
+    FVEC fx = dEdR*dx;
+    FVEC fy = dEdR*dy;
+    FVEC fz = dEdR*dz;
+    addForces(bonds, start, 0, fx, fy, fz, forces);
+    addForces(bonds, start, 1, -fx, -fy, -fz, forces);
+    if (totalEnergy != NULL)
+        addEnergy(bonds, start, 0.5f*k*deltaIdeal*deltaIdeal, totalEnergy);
+}
+
+template <typename FVEC>
+void CpuVectorBondForceFvec<FVEC>::calculateHarmonicAngleIxn(const BondBlock& bonds, int start, const std::vector<Vec3>& atomCoordinates, std::vector<Vec3>& forces,
+            double* totalEnergy, const Vec3* boxVectors) {
+    FVEC d0x, d0y, d0z, d1x, d1y, d1z, px, py, pz;
+    getDeltaR(bonds, start, 0, 1, atomCoordinates, boxVectors, d0x, d0y, d0z);
+    getDeltaR(bonds, start, 2, 1, atomCoordinates, boxVectors, d1x, d1y, d1z);
+    crossProduct(d0x, d0y, d0z, d1x, d1y, d1z, px, py, pz);
+    FVEC normP = sqrt(px*px + py*py + pz*pz);
+    FVEC rp = max(normP, 1.0e-6f);
+    FVEC r2_0 = d0x*d0x + d0y*d0y + d0z*d0z;
+    FVEC r2_1 = d1x*d1x + d1y*d1y + d1z*d1z;
+    FVEC angle = atan2Positive(normP, d0x*d1x + d0y*d1y + d0z*d1z);
+    FVEC idealAngle = loadParameter(bonds, start, 0);
+    FVEC k = loadParameter(bonds, start, 1);
+    FVEC deltaIdeal = angle-idealAngle;
+    FVEC dEdR = k*deltaIdeal;
+    FVEC f0x, f0y, f0z, f2x, f2y, f2z;
+    crossProduct(d0x, d0y, d0z, px, py, pz, f0x, f0y, f0z);
+    crossProduct(d1x, d1y, d1z, px, py, pz, f2x, f2y, f2z);
+    FVEC scale0 = dEdR/(r2_0*rp);
+    FVEC scale2 = -dEdR/(r2_1*rp);
+    f0x *= scale0;
+    f0y *= scale0;
+    f0z *= scale0;
+    f2x *= scale2;
+    f2y *= scale2;
+    f2z *= scale2;
+    addForces(bonds, start, 0, f0x, f0y, f0z, forces);
+    addForces(bonds, start, 1, -(f0x+f2x), -(f0y+f2y), -(f0z+f2z), forces);
+    addForces(bonds, start, 2, f2x, f2y, f2z, forces);
+    if (totalEnergy != NULL)
+        addEnergy(bonds, start, 0.5f*k*deltaIdeal*deltaIdeal, totalEnergy);
+}
+
+template <typename FVEC>
+void CpuVectorBondForceFvec<FVEC>::calculateTorsionIxn(const BondBlock& bonds, int start, const std::vector<Vec3>& atomCoordinates, std::vector<Vec3>& forces,
+            double* totalEnergy, const Vec3* boxVectors) {
+    // Compute the sine and cosine of the dihedral angle.
+
+    FVEC d0x, d0y, d0z, d1x, d1y, d1z, d2x, d2y, d2z;
+    getDeltaR(bonds, start, 1, 0, atomCoordinates, boxVectors, d0x, d0y, d0z);
+    getDeltaR(bonds, start, 1, 2, atomCoordinates, boxVectors, d1x, d1y, d1z);
+    getDeltaR(bonds, start, 3, 2, atomCoordinates, boxVectors, d2x, d2y, d2z);
+    FVEC c0x, c0y, c0z, c1x, c1y, c1z, sx, sy, sz;
+    crossProduct(d0x, d0y, d0z, d1x, d1y, d1z, c0x, c0y, c0z);
+    crossProduct(d1x, d1y, d1z, d2x, d2y, d2z, c1x, c1y, c1z);
+    crossProduct(c0x, c0y, c0z, c1x, c1y, c1z, sx, sy, sz);
+    FVEC normCross1 = c0x*c0x + c0y*c0y + c0z*c0z;
+    FVEC normCross2 = c1x*c1x + c1y*c1y + c1z*c1z;
+    FVEC invNorm = 1.0f/sqrt(normCross1*normCross2);
+    FVEC cosPhi = (c0x*c1x + c0y*c1y + c0z*c1z)*invNorm;
+    FVEC sinPhi = sqrt(sx*sx + sy*sy + sz*sz)*invNorm;
+    sinPhi = blend(sinPhi, -sinPhi, d0x*c1x + d0y*c1y + d0z*c1z < 0.0f);
+
+    // Compute the energy and its derivative with respect to the angle.
+
+    FVEC energy, dEdAngle;
+    if (type == PeriodicTorsion) {
+        FVEC k = loadParameter(bonds, start, 0);
+        FVEC cosPhase = loadParameter(bonds, start, 1);
+        FVEC sinPhase = loadParameter(bonds, start, 2);
+        FVEC periodicity = loadParameter(bonds, start, 3);
+        FVEC cosN = 1.0f, sinN = 0.0f, cosM = 1.0f, sinM = 0.0f;
+        for (int m = 1; m <= bonds.maxPeriodicity; m++) {
+            FVEC nextCos = cosM*cosPhi - sinM*sinPhi;
+            sinM = sinM*cosPhi + cosM*sinPhi;
+            cosM = nextCos;
+            auto select = abs(periodicity-(float) m) < 0.5f;
+            cosN = blend(cosN, cosM, select);
+            sinN = blend(sinN, sinM, select);
+        }
+        FVEC cosDelta = cosN*cosPhase + sinN*sinPhase;
+        FVEC sinDelta = sinN*cosPhase - cosN*sinPhase;
+        dEdAngle = -k*periodicity*sinDelta;
+        energy = k*(1.0f+cosDelta);
+    }
+    else {
+        // Use the polymer convention, psi = phi - pi.
+
+        FVEC cosPsi = min(max(-cosPhi, -1.0f), 1.0f);
+        FVEC sinPsi = -sinPhi;
+        energy = loadParameter(bonds, start, 0);
+        dEdAngle = 0.0f;
+        FVEC cosFactor = 1.0f;
+        for (int j = 1; j < 6; j++) {
+            FVEC c = loadParameter(bonds, start, j);
+            dEdAngle -= (float) j*c*cosFactor;
+            cosFactor *= cosPsi;
+            energy += cosFactor*c;
+        }
+        dEdAngle *= sinPsi;
+    }
+
+    // Compute the forces.
+
+    FVEC r2_1 = d1x*d1x + d1y*d1y + d1z*d1z;
+    FVEC normBC = sqrt(r2_1);
+    FVEC scale0 = (-dEdAngle*normBC)/normCross1;
+    FVEC scale3 = (dEdAngle*normBC)/normCross2;
+    FVEC f0x = c0x*scale0, f0y = c0y*scale0, f0z = c0z*scale0;
+    FVEC f3x = c1x*scale3, f3y = c1y*scale3, f3z = c1z*scale3;
+    FVEC dot0 = (d0x*d1x + d0y*d1y + d0z*d1z)/r2_1;
+    FVEC dot2 = (d2x*d1x + d2y*d1y + d2z*d1z)/r2_1;
+    FVEC sx2 = f0x*dot0 - f3x*dot2;
+    FVEC sy2 = f0y*dot0 - f3y*dot2;
+    FVEC sz2 = f0z*dot0 - f3z*dot2;
+    addForces(bonds, start, 0, f0x, f0y, f0z, forces);
+    addForces(bonds, start, 1, sx2-f0x, sy2-f0y, sz2-f0z, forces);
+    addForces(bonds, start, 2, -(f3x+sx2), -(f3y+sy2), -(f3z+sz2), forces);
+    addForces(bonds, start, 3, f3x, f3y, f3z, forces);
+    if (totalEnergy != NULL)
+        addEnergy(bonds, start, energy, totalEnergy);
+}
+
+template <typename FVEC>
+void CpuVectorBondForceFvec<FVEC>::getDeltaR(const BondBlock& bonds, int start, int atom1, int atom2, const std::vector<Vec3>& atomCoordinates,
+            const Vec3* boxVectors, FVEC& dx, FVEC& dy, FVEC& dz) const {
+    float x[blockSize], y[blockSize], z[blockSize];
+    const int* atoms1 = &bonds.atoms[atom1][start];
+    const int* atoms2 = &bonds.atoms[atom2][start];
+    for (int i = 0; i < blockSize; i++) {
+        Vec3 delta = CpuVectorBondForce::getDeltaR(atomCoordinates[atoms1[i]], atomCoordinates[atoms2[i]], boxVectors);
+        x[i] = (float) delta[0];
+        y[i] = (float) delta[1];
+        z[i] = (float) delta[2];
+    }
+    dx = FVEC(x);
+    dy = FVEC(y);
+    dz = FVEC(z);
+}
+
+template <typename FVEC>
+void CpuVectorBondForceFvec<FVEC>::addForces(const BondBlock& bonds, int start, int atom, const FVEC& fx, const FVEC& fy, const FVEC& fz, std::vector<Vec3>& forces) const {
+    float x[blockSize], y[blockSize], z[blockSize];
+    fx.store(x);
+    fy.store(y);
+    fz.store(z);
+    const int* atoms = &bonds.atoms[atom][start];
+    int count = std::min(blockSize, bonds.numBonds-start);
+    for (int i = 0; i < count; i++)
+        forces[atoms[i]] += Vec3(x[i], y[i], z[i]);
+}
+
+template <typename FVEC>
+void CpuVectorBondForceFvec<FVEC>::addEnergy(const BondBlock& bonds, int start, const FVEC& energy, double* totalEnergy) const {
+    float values[blockSize];
+    energy.store(values);
+    int count = std::min(blockSize, bonds.numBonds-start);
+    for (int i = 0; i < count; i++)
+        *totalEnergy += values[i];
+}
+
+} // namespace OpenMM
+
+#endif /*OPENMM_CPUVECTORBONDFORCEFVEC_H_*/
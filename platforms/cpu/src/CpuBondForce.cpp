@@ -166,14 +166,17 @@ void CpuBondForce::assignBond(int bond, int thread, vector<int>& atomThread, vec
 
 void CpuBondForce::calculateForce(vector<Vec3>& atomCoordinates, vector<vector<double> >& parameters, vector<Vec3>& forces, 
         double* totalEnergy, ReferenceBondIxn& referenceBondIxn) {
-    // Have the worker threads compute their forces.
+    // Submit one task for each set of bonds.  No two sets share any atoms, so they can be processed in any
+    // order by whichever threads are free.
     
-    vector<double> threadEnergy(threads->getNumThreads(), 0);
-    threads->execute([&] (ThreadPool& threads, int threadIndex) {
-        double* energy = (totalEnergy == NULL ? NULL : &threadEnergy[threadIndex]);
-        threadComputeForce(threads, threadIndex, atomCoordinates, parameters, forces, energy, referenceBondIxn);
-    });
-    threads->waitForThreads();
+    int numSets = threadBonds.size();
+    vector<double> threadEnergy(numSets, 0);
+    for (int i = 0; i < numSets; i++)
+        threads->addTask([&, i] (ThreadPool& threads, int threadIndex) {
+            double* energy = (totalEnergy == NULL ? NULL : &threadEnergy[i]);
+            threadComputeForce(threads, i, atomCoordinates, parameters, forces, energy, referenceBondIxn);
+        });
+    threads->executeTasks();
     
     // Compute any "extra" bonds.
     
@@ -185,13 +188,13 @@ void CpuBondForce::calculateForce(vector<Vec3>& atomCoordinates, vector<vector<d
     // Compute the total energy.
     
     if (totalEnergy != NULL)
-        for (int i = 0; i < threads->getNumThreads(); i++)
+        for (int i = 0; i < numSets; i++)
             *totalEnergy += threadEnergy[i];
 }
 
-void CpuBondForce::threadComputeForce(ThreadPool& threads, int threadIndex, vector<Vec3>& atomCoordinates, vector<vector<double> >& parameters, vector<Vec3>& forces, 
+void CpuBondForce::threadComputeForce(ThreadPool& threads, int bondSet, vector<Vec3>& atomCoordinates, vector<vector<double> >& parameters, vector<Vec3>& forces, 
             double* totalEnergy, ReferenceBondIxn& referenceBondIxn) {
-    vector<int>& bonds = threadBonds[threadIndex];
+    vector<int>& bonds = threadBonds[bondSet];
     int numBonds = bonds.size();
     for (int i = 0; i < numBonds; i++) {
         int bond = bonds[i];
@@ -0,0 +1,247 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "CpuCCMA.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <map>
+
+using namespace OpenMM;
+using namespace std;
+
+CpuCCMA::CpuCCMA(const ReferenceCCMAAlgorithm& ccma, ThreadPool& threads) : threads(threads) {
+    maxIterations = ccma.getMaximumNumberOfIterations();
+    int numConstraints = ccma.getNumberOfConstraints();
+    vector<int> atom1(numConstraints), atom2(numConstraints);
+    vector<double> distance(numConstraints);
+    int numAtoms = 0;
+    for (int i = 0; i < numConstraints; i++) {
+        ccma.getConstraintParameters(i, atom1[i], atom2[i], distance[i]);
+        numAtoms = max(numAtoms, max(atom1[i], atom2[i])+1);
+    }
+
+    // Identify clusters of constraints that are connected by shared atoms.
+
+    vector<int> atomRoot(numAtoms);
+    for (int i = 0; i < numAtoms; i++)
+        atomRoot[i] = i;
+    auto findRoot = [&] (int atom) {
+        while (atomRoot[atom] != atom) {
+            atomRoot[atom] = atomRoot[atomRoot[atom]];
+            atom = atomRoot[atom];
+        }
+        return atom;
+    };
+    for (int i = 0; i < numConstraints; i++) {
+        int root1 = findRoot(atom1[i]);
+        int root2 = findRoot(atom2[i]);
+        if (root1 != root2)
+            atomRoot[max(root1, root2)] = min(root1, root2);
+    }
+    map<int, int> clusterIndex;
+    vector<vector<int> > clusterConstraints;
+    for (int i = 0; i < numConstraints; i++) {
+        int root = findRoot(atom1[i]);
+        if (clusterIndex.find(root) == clusterIndex.end()) {
+            clusterIndex[root] = clusterConstraints.size();
+            clusterConstraints.push_back(vector<int>());
+        }
+        clusterConstraints[clusterIndex[root]].push_back(i);
+    }
+
+    // Group the clusters into blocks of similar size.  Using more blocks than threads helps
+    // with load balancing, since clusters vary in how expensive they are to process.
+
+    int numBlocks = 10*threads.getNumThreads();
+    int targetSize = max(1, (numConstraints+numBlocks-1)/numBlocks);
+    vector<vector<int> > blockConstraints(1);
+    for (auto& cluster : clusterConstraints) {
+        if (blockConstraints.back().size() >= targetSize)
+            blockConstraints.push_back(vector<int>());
+        blockConstraints.back().insert(blockConstraints.back().end(), cluster.begin(), cluster.end());
+    }
+
+    // Build the blocks.  The inverse matrix never couples different clusters, so each block
+    // only needs the rows for its own constraints.
+
+    const vector<vector<pair<int, double> > >& matrix = ccma.getMatrix();
+    vector<int> constraintBlock(numConstraints), localIndex(numConstraints);
+    for (int i = 0; i < blockConstraints.size(); i++)
+        for (int j = 0; j < blockConstraints[i].size(); j++) {
+            constraintBlock[blockConstraints[i][j]] = i;
+            localIndex[blockConstraints[i][j]] = j;
+        }
+    blocks.resize(numConstraints == 0 ? 0 : blockConstraints.size());
+    for (int i = 0; i < blocks.size(); i++) {
+        ConstraintBlock& block = blocks[i];
+        int blockSize = blockConstraints[i].size();
+        block.atomIndices.resize(blockSize);
+        block.distance.resize(blockSize);
+        block.r_ij.resize(blockSize);
+        block.d_ij2.resize(blockSize);
+        block.reducedMasses.resize(blockSize);
+        block.constraintDelta.resize(blockSize);
+        block.tempDelta.resize(blockSize);
+        block.hasInitializedMasses = false;
+        if (matrix.size() > 0)
+            block.matrix.resize(blockSize);
+        for (int j = 0; j < blockSize; j++) {
+            int index = blockConstraints[i][j];
+            block.atomIndices[j] = make_pair(atom1[index], atom2[index]);
+            block.distance[j] = distance[index];
+            if (matrix.size() > 0)
+                for (auto& element : matrix[index])
+                    if (constraintBlock[element.first] == i)
+                        block.matrix[j].push_back(make_pair(localIndex[element.first], element.second));
+        }
+    }
+}
+
+void CpuCCMA::apply(vector<OpenMM::Vec3>& atomCoordinates, vector<OpenMM::Vec3>& atomCoordinatesP, vector<double>& inverseMasses, double tolerance) {
+    applyConstraints(atomCoordinates, atomCoordinatesP, inverseMasses, false, tolerance);
+}
+
+void CpuCCMA::applyToVelocities(vector<OpenMM::Vec3>& atomCoordinates, vector<OpenMM::Vec3>& velocities, vector<double>& inverseMasses, double tolerance) {
+    applyConstraints(atomCoordinates, velocities, inverseMasses, true, tolerance);
+}
+
+void CpuCCMA::applyConstraints(vector<OpenMM::Vec3>& atomCoordinates, vector<OpenMM::Vec3>& atomCoordinatesP,
+            vector<double>& inverseMasses, bool constrainingVelocities, double tolerance) {
+    // Every block performs the same number of iterations, stopping once all constraints in all blocks have
+    // converged.  That makes the result identical to ReferenceCCMAAlgorithm.
+
+    int numBlocks = blocks.size();
+    vector<char> blockConverged(numBlocks);
+    executeOnBlocks([&] (ConstraintBlock& block, int index) {
+        initializeBlock(block, atomCoordinates, inverseMasses);
+    });
+    for (int iteration = 0; iteration < maxIterations; iteration++) {
+        executeOnBlocks([&] (ConstraintBlock& block, int index) {
+            blockConverged[index] = computeBlockDeltas(block, atomCoordinatesP, constrainingVelocities, tolerance);
+        });
+        bool converged = true;
+        for (char c : blockConverged)
+            converged &= (c != 0);
+        if (converged)
+            break;
+        executeOnBlocks([&] (ConstraintBlock& block, int index) {
+            updateBlock(block, atomCoordinatesP, inverseMasses);
+        });
+    }
+}
+
+void CpuCCMA::executeOnBlocks(function<void (ConstraintBlock&, int)> task) {
+    atomic<int> atomicCounter;
+    atomicCounter = 0;
+    threads.execute([&] (ThreadPool& threads, int threadIndex) {
+        while (true) {
+            int index = atomicCounter++;
+            if (index >= blocks.size())
+                break;
+            task(blocks[index], index);
+        }
+    });
+    threads.waitForThreads();
+}
+
+void CpuCCMA::initializeBlock(ConstraintBlock& block, vector<OpenMM::Vec3>& atomCoordinates, vector<double>& inverseMasses) {
+    int numConstraints = block.atomIndices.size();
+
+    // Calculate reduced masses on the first pass.
+
+    if (!block.hasInitializedMasses) {
+        block.hasInitializedMasses = true;
+        for (int i = 0; i < numConstraints; i++) {
+            int atomI = block.atomIndices[i].first;
+            int atomJ = block.atomIndices[i].second;
+            block.reducedMasses[i] = 0.5/(inverseMasses[atomI] + inverseMasses[atomJ]);
+        }
+    }
+
+    // Compute the constraint vectors.
+
+    for (int i = 0; i < numConstraints; i++) {
+        int atomI = block.atomIndices[i].first;
+        int atomJ = block.atomIndices[i].second;
+        block.r_ij[i] = atomCoordinates[atomI] - atomCoordinates[atomJ];
+        block.d_ij2[i] = block.r_ij[i].dot(block.r_ij[i]);
+    }
+}
+
+bool CpuCCMA::computeBlockDeltas(ConstraintBlock& block, vector<OpenMM::Vec3>& atomCoordinatesP, bool constrainingVelocities, double tolerance) {
+    int numConstraints = block.atomIndices.size();
+    double lowerTol = 1-2*tolerance+tolerance*tolerance;
+    double upperTol = 1+2*tolerance+tolerance*tolerance;
+    int numberConverged = 0;
+    for (int i = 0; i < numConstraints; i++) {
+        int atomI = block.atomIndices[i].first;
+        int atomJ = block.atomIndices[i].second;
+        Vec3 rp_ij = atomCoordinatesP[atomI] - atomCoordinatesP[atomJ];
+        if (constrainingVelocities) {
+            double rrpr = rp_ij.dot(block.r_ij[i]);
+            block.constraintDelta[i] = -2*block.reducedMasses[i]*rrpr/block.d_ij2[i];
+            if (fabs(block.constraintDelta[i]) <= tolerance)
+                numberConverged++;
+        }
+        else {
+            double rp2 = rp_ij.dot(rp_ij);
+            double dist2 = block.distance[i]*block.distance[i];
+            double diff = dist2 - rp2;
+            double rrpr = rp_ij.dot(block.r_ij[i]);
+            block.constraintDelta[i] = block.reducedMasses[i]*diff/rrpr;
+            if (rp2 >= lowerTol*dist2 && rp2 <= upperTol*dist2)
+                numberConverged++;
+        }
+    }
+    return (numberConverged == numConstraints);
+}
+
+void CpuCCMA::updateBlock(ConstraintBlock& block, vector<OpenMM::Vec3>& atomCoordinatesP, vector<double>& inverseMasses) {
+    int numConstraints = block.atomIndices.size();
+    if (block.matrix.size() > 0) {
+        for (int i = 0; i < numConstraints; i++) {
+            double sum = 0.0;
+            for (auto& element : block.matrix[i])
+                sum += element.second*block.constraintDelta[element.first];
+            block.tempDelta[i] = sum;
+        }
+        block.constraintDelta.swap(block.tempDelta);
+    }
+    for (int i = 0; i < numConstraints; i++) {
+        int atomI = block.atomIndices[i].first;
+        int atomJ = block.atomIndices[i].second;
+        Vec3 dr = block.r_ij[i]*block.constraintDelta[i];
+        atomCoordinatesP[atomI] += dr*inverseMasses[atomI];
+        atomCoordinatesP[atomJ] -= dr*inverseMasses[atomJ];
+    }
+}
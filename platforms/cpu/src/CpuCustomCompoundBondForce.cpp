@@ -0,0 +1,379 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+
+#include "CpuCustomCompoundBondForce.h"
+#include "ReferenceBondIxn.h"
+#include "ReferenceForce.h"
+#include "SimTKOpenMMUtilities.h"
+#include "lepton/Operation.h"
+#include <cstdlib>
+#include <sstream>
+
+using namespace OpenMM;
+using namespace std;
+using Lepton::ExpressionTreeNode;
+using Lepton::Operation;
+
+// The number of values stored for each term of each bond in a block: three displacement vectors (each
+// with its squared length and length) and two cross products, which is what a dihedral needs.
+
+static const int GeometrySize = 21;
+
+class CpuCustomCompoundBondForce::ThreadData {
+public:
+    ThreadData(const Lepton::CompiledVectorExpression& expression, const vector<TermInfo>& terms, const vector<CoordinateInfo>& coordinates,
+            const vector<string>& bondParamNames, int numParamDerivs);
+    Lepton::CompiledVectorExpression expression;
+    int width, numInBlock;
+    vector<float> termValues, coordinateValues, bondParams;
+    vector<int> blockBonds;
+    vector<double> termGeometry;
+    vector<double> energyParamDerivs;
+    double energy;
+};
+
+CpuCustomCompoundBondForce::ThreadData::ThreadData(const Lepton::CompiledVectorExpression& expression, const vector<TermInfo>& terms,
+            const vector<CoordinateInfo>& coordinates, const vector<string>& bondParamNames, int numParamDerivs) :
+            expression(expression), numInBlock(0), energyParamDerivs(numParamDerivs), energy(0) {
+    width = expression.getWidth();
+    termValues.resize(terms.size()*width, 0.0f);
+    coordinateValues.resize(coordinates.size()*width, 0.0f);
+    bondParams.resize(bondParamNames.size()*width, 0.0f);
+    blockBonds.resize(width);
+    termGeometry.resize(terms.size()*width*GeometrySize);
+    map<string, float*> variableLocations;
+    for (int i = 0; i < terms.size(); i++)
+        variableLocations[terms[i].name] = &termValues[i*width];
+    for (int i = 0; i < coordinates.size(); i++)
+        variableLocations[coordinates[i].name] = &coordinateValues[i*width];
+    for (int i = 0; i < bondParamNames.size(); i++)
+        variableLocations[bondParamNames[i]] = &bondParams[i*width];
+    this->expression.setVariableLocations(variableLocations);
+}
+
+static void findVariables(const ExpressionTreeNode& node, set<string>& variables) {
+    if (node.getOperation().getId() == Operation::VARIABLE)
+        variables.insert(node.getOperation().getName());
+    for (auto& child : node.getChildren())
+        findVariables(child, variables);
+}
+
+CpuCustomCompoundBondForce::CpuCustomCompoundBondForce(int numParticles, const vector<vector<int> >& bondParticles, const Lepton::ParsedExpression& energyExpression,
+            const vector<string>& bondParameterNames, const vector<string>& energyParamDerivNames, ThreadPool& threads) : threads(threads), usePeriodic(false),
+            bondParticles(bondParticles), bondParamNames(bondParameterNames), numParamDerivs(energyParamDerivNames.size()) {
+    // Replace distances, angles, and dihedrals with variables, and identify which coordinates
+    // are used directly.
+
+    map<string, int> termIndex;
+    Lepton::ParsedExpression expression(replacePointFunctions(energyExpression.getRootNode(), termIndex));
+    set<string> variables;
+    findVariables(expression.getRootNode(), variables);
+    int numParticlesPerBond = (bondParticles.size() == 0 ? 0 : bondParticles[0].size());
+    for (int i = 0; i < numParticlesPerBond; i++)
+        for (int j = 0; j < 3; j++) {
+            string name = string(1, "xyz"[j])+to_string(i+1);
+            if (variables.find(name) != variables.end())
+                coordinates.push_back({name, i, j});
+        }
+
+    // A single vector expression computes the energy together with all its derivatives, so they
+    // can share subexpressions.
+
+    vector<Lepton::ParsedExpression> expressions = {expression};
+    for (auto& term : terms)
+        expressions.push_back(expression.differentiate(term.name).optimize());
+    for (auto& coordinate : coordinates)
+        expressions.push_back(expression.differentiate(coordinate.name).optimize());
+    for (auto& param : energyParamDerivNames)
+        expressions.push_back(expression.differentiate(param).optimize());
+    int width = Lepton::CompiledVectorExpression::getAllowedWidths().back();
+    Lepton::CompiledVectorExpression vecExpression(expressions, width);
+    for (int i = 0; i < threads.getNumThreads(); i++)
+        threadData.push_back(new ThreadData(vecExpression, terms, coordinates, bondParamNames, numParamDerivs));
+    partition.initialize(numParticles, this->bondParticles.size(), numParticlesPerBond, this->bondParticles, threads);
+}
+
+CpuCustomCompoundBondForce::~CpuCustomCompoundBondForce() {
+    for (auto data : threadData)
+        delete data;
+}
+
+ExpressionTreeNode CpuCustomCompoundBondForce::replacePointFunctions(const ExpressionTreeNode& node, map<string, int>& termIndex) {
+    const Operation& op = node.getOperation();
+    if (op.getId() == Operation::CUSTOM) {
+        int numPoints = 0;
+        TermInfo::TermType type;
+        if (op.getName() == "pointdistance") {
+            numPoints = 2;
+            type = TermInfo::Distance;
+        }
+        else if (op.getName() == "pointangle") {
+            numPoints = 3;
+            type = TermInfo::Angle;
+        }
+        else if (op.getName() == "pointdihedral") {
+            numPoints = 4;
+            type = TermInfo::Dihedral;
+        }
+
+        // Identify the particles.  Every argument must be a coordinate of the appropriate particle.
+
+        vector<int> particles;
+        bool valid = (numPoints > 0 && node.getChildren().size() == 3*numPoints);
+        for (int i = 0; i < numPoints && valid; i++) {
+            for (int j = 0; j < 3 && valid; j++) {
+                const Operation& arg = node.getChildren()[3*i+j].getOperation();
+                const string& name = arg.getName();
+                valid = (arg.getId() == Operation::VARIABLE && name.size() > 1 && name[0] == "xyz"[j]);
+                if (valid) {
+                    char* end;
+                    int particle = strtol(name.c_str()+1, &end, 10)-1;
+                    valid = (*end == 0 && particle >= 0 && (j == 0 || particle == particles[i]));
+                    if (j == 0)
+                        particles.push_back(particle);
+                }
+            }
+        }
+        if (valid) {
+            stringstream name;
+            name << op.getName() << '(';
+            for (int i = 0; i < numPoints; i++)
+                name << (i == 0 ? "" : ",") << particles[i];
+            name << ')';
+            if (termIndex.find(name.str()) == termIndex.end()) {
+                termIndex[name.str()] = terms.size();
+                terms.push_back({name.str(), type, particles});
+            }
+            return ExpressionTreeNode(new Operation::Variable(name.str()));
+        }
+    }
+    vector<ExpressionTreeNode> children;
+    for (auto& child : node.getChildren())
+        children.push_back(replacePointFunctions(child, termIndex));
+    return ExpressionTreeNode(op.clone(), children);
+}
+
+void CpuCustomCompoundBondForce::setPeriodic(Vec3* periodicBoxVectors) {
+    usePeriodic = true;
+    this->periodicBoxVectors[0] = periodicBoxVectors[0];
+    this->periodicBoxVectors[1] = periodicBoxVectors[1];
+    this->periodicBoxVectors[2] = periodicBoxVectors[2];
+}
+
+void CpuCustomCompoundBondForce::calculateIxn(vector<Vec3>& positions, vector<vector<double> >& bondParameters, const map<string, double>& globalParameters,
+            vector<Vec3>& forces, double* totalEnergy, double* energyParamDerivs) {
+    // Record the parameters for the threads.
+
+    this->positions = &positions;
+    this->forces = &forces;
+    this->bondParameters = bondParameters.data();
+    includeEnergy = (totalEnergy != NULL);
+
+    // Each thread computes the bonds assigned to it, and then the remaining bonds are computed
+    // on the main thread.
+
+    const vector<vector<int> >& threadBonds = partition.getThreadBonds();
+    threads.execute([&] (ThreadPool& threads, int threadIndex) {
+        ThreadData& data = *threadData[threadIndex];
+        data.energy = 0;
+        for (int i = 0; i < numParamDerivs; i++)
+            data.energyParamDerivs[i] = 0;
+        const set<string>& variables = data.expression.getVariables();
+        for (auto& param : globalParameters) {
+            if (variables.find(param.first) != variables.end()) {
+                float* p = data.expression.getVariablePointer(param.first);
+                for (int i = 0; i < data.width; i++)
+                    p[i] = param.second;
+            }
+        }
+        if (threadIndex < threadBonds.size())
+            computeBonds(threadBonds[threadIndex], data);
+    });
+    threads.waitForThreads();
+    computeBonds(partition.getExtraBonds(), *threadData[0]);
+
+    // Combine the energies and derivatives from all the threads.
+
+    for (auto data : threadData) {
+        if (totalEnergy != NULL)
+            *totalEnergy += data->energy;
+        for (int i = 0; i < numParamDerivs; i++)
+            energyParamDerivs[i] += data->energyParamDerivs[i];
+    }
+}
+
+void CpuCustomCompoundBondForce::computeBonds(const vector<int>& bonds, ThreadData& data) {
+    for (int bond : bonds) {
+        addBondToBlock(bond, data);
+        if (data.numInBlock == data.width)
+            computeBlock(data);
+    }
+    if (data.numInBlock > 0)
+        computeBlock(data);
+}
+
+void CpuCustomCompoundBondForce::addBondToBlock(int bond, ThreadData& data) {
+    int lane = data.numInBlock++;
+    int width = data.width;
+    data.blockBonds[lane] = bond;
+    const vector<int>& particles = bondParticles[bond];
+    for (int i = 0; i < bondParamNames.size(); i++)
+        data.bondParams[i*width+lane] = (float) bondParameters[bond][i];
+    for (int i = 0; i < coordinates.size(); i++)
+        data.coordinateValues[i*width+lane] = (float) (*positions)[particles[coordinates[i].particle]][coordinates[i].component];
+
+    // Compute all of the distances, angles, and dihedrals.
+
+    int numTerms = terms.size();
+    for (int i = 0; i < numTerms; i++) {
+        const TermInfo& term = terms[i];
+        double* geometry = &data.termGeometry[(lane*numTerms+i)*GeometrySize];
+        double* delta1 = geometry;
+        double* delta2 = geometry+ReferenceForce::LastDeltaRIndex;
+        double* delta3 = geometry+2*ReferenceForce::LastDeltaRIndex;
+        double value;
+        if (term.type == TermInfo::Distance) {
+            computeDelta(particles[term.particles[0]], particles[term.particles[1]], delta1);
+            value = delta1[ReferenceForce::RIndex];
+        }
+        else if (term.type == TermInfo::Angle) {
+            computeDelta(particles[term.particles[0]], particles[term.particles[1]], delta1);
+            computeDelta(particles[term.particles[2]], particles[term.particles[1]], delta2);
+            value = ReferenceBondIxn::getAngleBetweenTwoVectors(delta1, delta2, NULL, 1);
+        }
+        else {
+            computeDelta(particles[term.particles[1]], particles[term.particles[0]], delta1);
+            computeDelta(particles[term.particles[1]], particles[term.particles[2]], delta2);
+            computeDelta(particles[term.particles[3]], particles[term.particles[2]], delta3);
+            double* crossProduct[] = {geometry+3*ReferenceForce::LastDeltaRIndex, geometry+3*ReferenceForce::LastDeltaRIndex+3};
+            double dotDihedral, signOfDihedral;
+            value = ReferenceBondIxn::getDihedralAngleBetweenThreeVectors(delta1, delta2, delta3, crossProduct, &dotDihedral, delta1, &signOfDihedral, 1);
+        }
+        data.termValues[i*width+lane] = (float) value;
+    }
+}
+
+void CpuCustomCompoundBondForce::computeBlock(ThreadData& data) {
+    const float* results = data.expression.evaluate();
+    int width = data.width;
+    int numTerms = terms.size();
+    int numCoordinates = coordinates.size();
+    vector<Vec3>& f = *forces;
+    for (int lane = 0; lane < data.numInBlock; lane++) {
+        if (includeEnergy)
+            data.energy += results[lane];
+        const vector<int>& particles = bondParticles[data.blockBonds[lane]];
+        for (int i = 0; i < numTerms; i++) {
+            const TermInfo& term = terms[i];
+            double* geometry = &data.termGeometry[(lane*numTerms+i)*GeometrySize];
+            double* delta1 = geometry;
+            double* delta2 = geometry+ReferenceForce::LastDeltaRIndex;
+            double* delta3 = geometry+2*ReferenceForce::LastDeltaRIndex;
+            double dEdTerm = results[(i+1)*width+lane];
+            if (term.type == TermInfo::Distance) {
+                // Apply forces based on a distance.
+
+                if (delta1[ReferenceForce::RIndex] == 0.0)
+                    continue;
+                double dEdR = dEdTerm/delta1[ReferenceForce::RIndex];
+                Vec3 force = Vec3(delta1[0], delta1[1], delta1[2])*(-dEdR);
+                f[particles[term.particles[0]]] -= force;
+                f[particles[term.particles[1]]] += force;
+            }
+            else if (term.type == TermInfo::Angle) {
+                // Apply forces based on an angle.
+
+                double thetaCross[ReferenceForce::LastDeltaRIndex];
+                SimTKOpenMMUtilities::crossProductVector3(delta1, delta2, thetaCross);
+                double lengthThetaCross = sqrt(DOT3(thetaCross, thetaCross));
+                if (lengthThetaCross < 1.0e-06)
+                    lengthThetaCross = 1.0e-06;
+                double termA = dEdTerm/(delta1[ReferenceForce::R2Index]*lengthThetaCross);
+                double termC = -dEdTerm/(delta2[ReferenceForce::R2Index]*lengthThetaCross);
+                double deltaCrossP[3][3];
+                SimTKOpenMMUtilities::crossProductVector3(delta1, thetaCross, deltaCrossP[0]);
+                SimTKOpenMMUtilities::crossProductVector3(delta2, thetaCross, deltaCrossP[2]);
+                for (int j = 0; j < 3; j++) {
+                    deltaCrossP[0][j] *= termA;
+                    deltaCrossP[2][j] *= termC;
+                    deltaCrossP[1][j] = -(deltaCrossP[0][j]+deltaCrossP[2][j]);
+                }
+                for (int k = 0; k < 3; k++)
+                    f[particles[term.particles[k]]] += Vec3(deltaCrossP[k][0], deltaCrossP[k][1], deltaCrossP[k][2]);
+            }
+            else {
+                // Apply forces based on a dihedral.
+
+                double* cross1 = geometry+3*ReferenceForce::LastDeltaRIndex;
+                double* cross2 = cross1+3;
+                double internalF[4][3];
+                double forceFactors[4];
+                double normCross1 = DOT3(cross1, cross1);
+                double normBC = delta2[ReferenceForce::RIndex];
+                forceFactors[0] = (-dEdTerm*normBC)/normCross1;
+                double normCross2 = DOT3(cross2, cross2);
+                forceFactors[3] = (dEdTerm*normBC)/normCross2;
+                forceFactors[1] = DOT3(delta1, delta2)/delta2[ReferenceForce::R2Index];
+                forceFactors[2] = DOT3(delta3, delta2)/delta2[ReferenceForce::R2Index];
+                for (int j = 0; j < 3; j++) {
+                    internalF[0][j] = forceFactors[0]*cross1[j];
+                    internalF[3][j] = forceFactors[3]*cross2[j];
+                    double s = forceFactors[1]*internalF[0][j] - forceFactors[2]*internalF[3][j];
+                    internalF[1][j] = internalF[0][j] - s;
+                    internalF[2][j] = internalF[3][j] + s;
+                }
+                f[particles[term.particles[0]]] += Vec3(internalF[0][0], internalF[0][1], internalF[0][2]);
+                f[particles[term.particles[1]]] -= Vec3(internalF[1][0], internalF[1][1], internalF[1][2]);
+                f[particles[term.particles[2]]] -= Vec3(internalF[2][0], internalF[2][1], internalF[2][2]);
+                f[particles[term.particles[3]]] += Vec3(internalF[3][0], internalF[3][1], internalF[3][2]);
+            }
+        }
+
+        // Apply forces based on coordinates that appear directly in the expression.
+
+        for (int i = 0; i < numCoordinates; i++)
+            f[particles[coordinates[i].particle]][coordinates[i].component] -= results[(numTerms+i+1)*width+lane];
+
+        // Add the derivatives with respect to parameters.
+
+        for (int i = 0; i < numParamDerivs; i++)
+            data.energyParamDerivs[i] += results[(numTerms+numCoordinates+i+1)*width+lane];
+    }
+    data.numInBlock = 0;
+}
+
+void CpuCustomCompoundBondForce::computeDelta(int particle1, int particle2, double* delta) const {
+    if (usePeriodic)
+        ReferenceForce::getDeltaRPeriodic((*positions)[particle1], (*positions)[particle2], periodicBoxVectors, delta);
+    else
+        ReferenceForce::getDeltaR((*positions)[particle1], (*positions)[particle2], delta);
+}
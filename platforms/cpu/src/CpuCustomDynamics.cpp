@@ -0,0 +1,186 @@
+/* Portions copyright (c) 2026 Stanford University and Simbios.
+ * Authors: Peter Eastman
+ * Contributors: 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "CpuCustomDynamics.h"
+#include <algorithm>
+#include <atomic>
+#include <sstream>
+
+using namespace OpenMM;
+using namespace std;
+
+/**
+ * This holds the variables and compiled expressions used by a single thread.
+ */
+class CpuCustomDynamics::ThreadData {
+public:
+    double x, v, m, f, energy, gaussian, uniform;
+    vector<double> perDof;
+    vector<Lepton::CompiledExpression> expressions;
+};
+
+CpuCustomDynamics::CpuCustomDynamics(int numberOfAtoms, const CustomIntegrator& integrator, ThreadPool& threads, CpuRandom& random) :
+           ReferenceCustomDynamics(numberOfAtoms, integrator), threads(threads), random(random) {
+}
+
+CpuCustomDynamics::~CpuCustomDynamics() {
+    for (auto data : threadData)
+        delete data;
+}
+
+void CpuCustomDynamics::createThreadData() {
+    // Each thread gets its own copy of every per-DOF expression.  Per-DOF variables are read from the
+    // thread's own storage, and everything else from globalValues, which is shared by all threads.
+
+    int numSteps = stepType.size();
+    stepUsesUniform.resize(numSteps, false);
+    stepUsesGaussian.resize(numSteps, false);
+    for (int step = 0; step < numSteps; step++) {
+        if ((stepType[step] != CustomIntegrator::ComputePerDof && stepType[step] != CustomIntegrator::ComputeSum) || stepVectorExpressions[step].size() > 0)
+            continue;
+        const set<string>& variables = stepExpressions[step][0].getVariables();
+        stepUsesUniform[step] = (variables.find("uniform") != variables.end());
+        stepUsesGaussian[step] = (variables.find("gaussian") != variables.end());
+    }
+    for (int i = 0; i < threads.getNumThreads(); i++) {
+        ThreadData* data = new ThreadData();
+        threadData.push_back(data);
+        data->perDof.resize(integrator.getNumPerDofVariables());
+        map<string, double*> variableLocations;
+        variableLocations["x"] = &data->x;
+        variableLocations["v"] = &data->v;
+        variableLocations["m"] = &data->m;
+        variableLocations["f"] = &data->f;
+        variableLocations["energy"] = &data->energy;
+        variableLocations["gaussian"] = &data->gaussian;
+        variableLocations["uniform"] = &data->uniform;
+        for (int j = 0; j < integrator.getNumPerDofVariables(); j++)
+            variableLocations[integrator.getPerDofVariableName(j)] = &data->perDof[j];
+        for (int j = 0; j < 32; j++) {
+            stringstream fname;
+            fname << "f" << j;
+            variableLocations[fname.str()] = &data->f;
+            stringstream ename;
+            ename << "energy" << j;
+            variableLocations[ename.str()] = &data->energy;
+        }
+        data->expressions.resize(numSteps);
+        for (int step = 0; step < numSteps; step++) {
+            if ((stepType[step] != CustomIntegrator::ComputePerDof && stepType[step] != CustomIntegrator::ComputeSum) || stepVectorExpressions[step].size() > 0)
+                continue;
+            data->expressions[step] = stepExpressions[step][0];
+            map<string, double*> locations = variableLocations;
+            for (const string& name : data->expressions[step].getVariables())
+                if (locations.find(name) == locations.end())
+                    locations[name] = &globalValues[name];
+            data->expressions[step].setVariableLocations(locations);
+        }
+    }
+}
+
+void CpuCustomDynamics::computePerDofSteps(const vector<int>& steps, int numberOfAtoms, vector<Vec3>& atomCoordinates, vector<Vec3>& velocities,
+              const vector<vector<Vec3>*>& stepForces, const vector<double>& stepEnergy, vector<double>& masses,
+              map<string, double>& globals, vector<vector<Vec3> >& perDof) {
+    if (stepVectorExpressions[steps[0]].size() > 0) {
+        // Vector expressions are rare enough that we just let the reference implementation handle them.
+
+        ReferenceCustomDynamics::computePerDofSteps(steps, numberOfAtoms, atomCoordinates, velocities, stepForces, stepEnergy, masses, globals, perDof);
+        return;
+    }
+    const int chunkSize = 64;
+    int numChunks = (numberOfAtoms+chunkSize-1)/chunkSize;
+    if (threadData.size() == 0) {
+        createThreadData();
+        chunkRandom.initialize(1+(int) (random.getUniformRandom(0)*2147483646), numChunks);
+    }
+    for (auto& value : globalValues) {
+        auto global = globals.find(value.first);
+        value.second = (global == globals.end() ? 0.0 : global->second);
+    }
+
+    // Record where each step stores its results.  A ComputeSum step can only appear at the end.
+
+    int numSteps = steps.size();
+    bool endsWithSum = (stepType[steps.back()] == CustomIntegrator::ComputeSum);
+    vector<vector<Vec3>*> results(numSteps);
+    for (int k = 0; k < numSteps; k++)
+        results[k] = (stepType[steps[k]] == CustomIntegrator::ComputeSum ? NULL : getPerDofResults(steps[k], atomCoordinates, velocities, perDof));
+
+    // Loop over degrees of freedom, executing every step for each one.  Threads take fixed size chunks of
+    // atoms.  Each chunk draws random numbers from its own stream and records its own partial sum, so neither
+    // depends on which thread processes it.
+
+    int numPerDof = perDof.size();
+    chunkSum.resize(numChunks);
+    atomic<int> nextChunk(0);
+    threads.execute([&] (ThreadPool& threads, int threadIndex) {
+        ThreadData& data = *threadData[threadIndex];
+        while (true) {
+            int chunk = nextChunk++;
+            if (chunk >= numChunks)
+                break;
+            int start = chunk*chunkSize;
+            int end = min(start+chunkSize, numberOfAtoms);
+            double sum = 0.0;
+            for (int i = start; i < end; i++) {
+                if (masses[i] == 0.0)
+                    continue;
+                data.m = masses[i];
+                for (int j = 0; j < 3; j++) {
+                    for (int k = 0; k < numSteps; k++) {
+                        int step = steps[k];
+                        data.x = atomCoordinates[i][j];
+                        data.v = velocities[i][j];
+                        data.f = (*stepForces[k])[i][j];
+                        data.energy = stepEnergy[k];
+                        if (stepUsesUniform[step])
+                            data.uniform = chunkRandom.getUniformRandom(chunk);
+                        if (stepUsesGaussian[step])
+                            data.gaussian = chunkRandom.getGaussianRandomDouble(chunk);
+                        for (int p = 0; p < numPerDof; p++)
+                            data.perDof[p] = perDof[p][i][j];
+                        double value = data.expressions[step].evaluate();
+                        if (results[k] == NULL)
+                            sum += value;
+                        else
+                            (*results[k])[i][j] = value;
+                    }
+                }
+            }
+            chunkSum[chunk] = sum;
+        }
+    });
+    threads.waitForThreads();
+
+    // Add up the partial sums in a fixed order, so the result does not depend on timing or the number of threads.
+
+    if (endsWithSum) {
+        double sum = 0.0;
+        for (int i = 0; i < numChunks; i++)
+            sum += chunkSum[i];
+        int step = steps.back();
+        globals[stepVariable[step]] = sum;
+        expressionSet.setVariable(stepVariableIndex[step], sum);
+    }
+}
@@ -22,6 +22,7 @@
  * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#include <algorithm>
 #include <string.h>
 #include <sstream>
 
@@ -36,16 +37,11 @@ CpuCustomGBForce::ThreadData::ThreadData(int numAtoms, int numThreads, int threa
                       const vector<Lepton::CompiledExpression>& valueExpressions,
                       const vector<vector<Lepton::CompiledExpression> >& valueDerivExpressions,
                       const vector<vector<Lepton::CompiledExpression> >& valueGradientExpressions,
-                      const vector<vector<Lepton::CompiledExpression> >& valueParamDerivExpressions,
                       const vector<string>& valueNames,
                       const vector<Lepton::CompiledExpression>& energyExpressions,
-                      const vector<vector<Lepton::CompiledExpression> >& energyDerivExpressions,
-                      const vector<vector<Lepton::CompiledExpression> >& energyGradientExpressions,
-                      const vector<vector<Lepton::CompiledExpression> >& energyParamDerivExpressions,
-                      const vector<string>& parameterNames) :
+                      int numParamDerivs, const vector<string>& parameterNames) :
             valueExpressions(valueExpressions), valueDerivExpressions(valueDerivExpressions), valueGradientExpressions(valueGradientExpressions),
-            valueParamDerivExpressions(valueParamDerivExpressions), energyExpressions(energyExpressions), energyDerivExpressions(energyDerivExpressions),
-            energyGradientExpressions(energyGradientExpressions), energyParamDerivExpressions(energyParamDerivExpressions) {
+            energyExpressions(energyExpressions) {
     firstAtom = (threadIndex*(long long) numAtoms)/numThreads;
     lastAtom = ((threadIndex+1)*(long long) numAtoms)/numThreads;
     map<string, double*> variableLocations;
@@ -73,9 +69,11 @@ CpuCustomGBForce::ThreadData::ThreadData(int numAtoms, int numThreads, int threa
             variableLocations[name.str()] = &particleValue[2*i+j];
         }
     }
+    int maxResults = 0;
     for (auto& expression : this->valueExpressions) {
         expression.setVariableLocations(variableLocations);
         expressionSet.registerExpression(expression);
+        maxResults = max(maxResults, expression.getNumResults());
     }
     for (auto& expressions : this->valueDerivExpressions)
         for (auto& expression : expressions) {
@@ -87,30 +85,12 @@ CpuCustomGBForce::ThreadData::ThreadData(int numAtoms, int numThreads, int threa
             expression.setVariableLocations(variableLocations);
             expressionSet.registerExpression(expression);
         }
-    for (auto& expressions : this->valueParamDerivExpressions)
-        for (auto& expression : expressions) {
-            expression.setVariableLocations(variableLocations);
-            expressionSet.registerExpression(expression);
-        }
     for (auto& expression : this->energyExpressions) {
         expression.setVariableLocations(variableLocations);
         expressionSet.registerExpression(expression);
+        maxResults = max(maxResults, expression.getNumResults());
     }
-    for (auto& expressions : this->energyDerivExpressions)
-        for (auto& expression : expressions) {
-            expression.setVariableLocations(variableLocations);
-            expressionSet.registerExpression(expression);
-        }
-    for (auto& expressions : this->energyGradientExpressions)
-        for (auto& expression : expressions) {
-            expression.setVariableLocations(variableLocations);
-            expressionSet.registerExpression(expression);
-        }
-    for (auto& expressions : this->energyParamDerivExpressions)
-        for (auto& expression : expressions) {
-            expression.setVariableLocations(variableLocations);
-            expressionSet.registerExpression(expression);
-        }
+    expressionResult.resize(maxResults);
     value0.resize(numAtoms);
     dEdV.resize(valueNames.size());
     for (auto& v : dEdV)
@@ -120,28 +100,24 @@ CpuCustomGBForce::ThreadData::ThreadData(int numAtoms, int numThreads, int threa
     dVdZ.resize(valueDerivExpressions.size());
     dVdR1.resize(valueDerivExpressions.size());
     dVdR2.resize(valueDerivExpressions.size());
-    dValue0dParam.resize(valueParamDerivExpressions[0].size(), vector<float>(numAtoms));
-    energyParamDerivs.resize(valueParamDerivExpressions[0].size());
+    dValue0dParam.resize(numParamDerivs, vector<float>(numAtoms));
+    energyParamDerivs.resize(numParamDerivs);
 }
 
 CpuCustomGBForce::CpuCustomGBForce(int numAtoms, const std::vector<std::set<int> >& exclusions,
                      const vector<Lepton::CompiledExpression>& valueExpressions,
                      const vector<vector<Lepton::CompiledExpression> >& valueDerivExpressions,
                      const vector<vector<Lepton::CompiledExpression> >& valueGradientExpressions,
-                     const vector<vector<Lepton::CompiledExpression> >& valueParamDerivExpressions,
                      const vector<string>& valueNames,
                      const vector<CustomGBForce::ComputationType>& valueTypes,
                      const vector<Lepton::CompiledExpression>& energyExpressions,
-                     const vector<vector<Lepton::CompiledExpression> >& energyDerivExpressions,
-                     const vector<vector<Lepton::CompiledExpression> >& energyGradientExpressions,
-                     const vector<vector<Lepton::CompiledExpression> >& energyParamDerivExpressions,
                      const vector<CustomGBForce::ComputationType>& energyTypes,
-                     const vector<string>& parameterNames, ThreadPool& threads) :
+                     int numParamDerivs, const vector<string>& parameterNames, ThreadPool& threads) :
             exclusions(exclusions), cutoff(false), periodic(false), valueTypes(valueTypes), energyTypes(energyTypes), numValues(valueNames.size()),
-            numParams(parameterNames.size()), threads(threads) {
+            numParams(parameterNames.size()), numParamDerivs(numParamDerivs), threads(threads) {
     for (int i = 0; i < threads.getNumThreads(); i++)
         threadData.push_back(new ThreadData(numAtoms, threads.getNumThreads(), i, valueExpressions, valueDerivExpressions, valueGradientExpressions,
-                valueParamDerivExpressions, valueNames, energyExpressions, energyDerivExpressions, energyGradientExpressions, energyParamDerivExpressions, parameterNames));
+                valueNames, energyExpressions, numParamDerivs, parameterNames));
     values.resize(numValues);
     dEdV.resize(numValues);
     for (int i = 0; i < (int) values.size(); i++) {
@@ -150,7 +126,7 @@ CpuCustomGBForce::CpuCustomGBForce(int numAtoms, const std::vector<std::set<int>
     }
     dValuedParam.resize(numValues);
     for (int i = 0; i < numValues; i++)
-        dValuedParam[i].resize(valueParamDerivExpressions[0].size(), vector<float>(numAtoms));
+        dValuedParam[i].resize(numParamDerivs, vector<float>(numAtoms));
 }
 
 CpuCustomGBForce::~CpuCustomGBForce() {
@@ -297,16 +273,18 @@ void CpuCustomGBForce::threadComputeForce(ThreadPool& threads, int threadIndex)
             data.param[j] = atomParameters[atom][j];
         for (int i = 1; i < numValues; i++) {
             data.value[i-1] = values[i-1][atom];
-            values[i][atom] = (float) data.valueExpressions[i].evaluate();
+            double* result = data.expressionResult.data();
+            data.valueExpressions[i].evaluate(result);
+            values[i][atom] = (float) result[0];
 
             // Calculate derivatives with respect to parameters.
 
             if (hasParamDerivs) {
-                for (int j = 0; j < data.valueParamDerivExpressions[i].size(); j++)
-                    dValuedParam[i][j][atom] = data.valueParamDerivExpressions[i][j].evaluate();
+                for (int j = 0; j < numParamDerivs; j++)
+                    dValuedParam[i][j][atom] = result[j+1];
                 for (int j = 0; j < i; j++) {
                     float dVdV = data.valueDerivExpressions[i][j].evaluate();
-                    for (int k = 0; k < data.valueParamDerivExpressions[i].size(); k++)
+                    for (int k = 0; k < numParamDerivs; k++)
                         dValuedParam[i][k][atom] += dVdV*dValuedParam[j][k][atom];
                 }
             }
@@ -413,12 +391,14 @@ void CpuCustomGBForce::calculateOnePairValue(int index, int atom1, int atom2, Th
         data.particleValue[i*2] = values[i][atom1];
         data.particleValue[i*2+1] = values[i][atom2];
     }
-    valueArray[atom1] += (float) data.valueExpressions[index].evaluate();
+    double* result = data.expressionResult.data();
+    data.valueExpressions[index].evaluate(result);
+    valueArray[atom1] += (float) result[0];
     
     // Calculate derivatives with respect to parameters.
     
-    for (int i = 0; i < data.valueParamDerivExpressions[index].size(); i++)
-        data.dValue0dParam[i][atom1] += data.valueParamDerivExpressions[index][i].evaluate();
+    for (int i = 0; i < numParamDerivs; i++)
+        data.dValue0dParam[i][atom1] += result[i+1];
 }
 
 void CpuCustomGBForce::calculateSingleParticleEnergyTerm(int index, ThreadData& data, int numAtoms, float* posq,
@@ -431,18 +411,20 @@ void CpuCustomGBForce::calculateSingleParticleEnergyTerm(int index, ThreadData&
             data.param[j] = atomParameters[i][j];
         for (int j = 0; j < (int) values.size(); j++)
             data.value[j] = values[j][i];
+        double* result = data.expressionResult.data();
+        data.energyExpressions[index].evaluate(result);
         if (includeEnergy)
-            totalEnergy += (float) data.energyExpressions[index].evaluate();
-        for (int j = 0; j < (int) values.size(); j++)
-            data.dEdV[j][i] += (float) data.energyDerivExpressions[index][j].evaluate();
-        forces[4*i+0] -= (float) data.energyGradientExpressions[index][0].evaluate();
-        forces[4*i+1] -= (float) data.energyGradientExpressions[index][1].evaluate();
-        forces[4*i+2] -= (float) data.energyGradientExpressions[index][2].evaluate();
+            totalEnergy += (float) result[0];
+        for (int j = 0; j < numValues; j++)
+            data.dEdV[j][i] += (float) result[j+1];
+        forces[4*i+0] -= (float) result[numValues+1];
+        forces[4*i+1] -= (float) result[numValues+2];
+        forces[4*i+2] -= (float) result[numValues+3];
         
         // Compute derivatives with respect to parameters.
         
-        for (int k = 0; k < data.energyParamDerivExpressions[index].size(); k++)
-            data.energyParamDerivs[k] += data.energyParamDerivExpressions[index][k].evaluate();
+        for (int k = 0; k < numParamDerivs; k++)
+            data.energyParamDerivs[k] += result[numValues+4+k];
     }
 }
 
@@ -515,22 +497,24 @@ void CpuCustomGBForce::calculateOnePairEnergyTerm(int index, int atom1, int atom
 
     // Evaluate the energy and its derivatives.
 
+    double* terms = data.expressionResult.data();
+    data.energyExpressions[index].evaluate(terms);
     if (includeEnergy)
-        totalEnergy += (float) data.energyExpressions[index].evaluate();
-    float dEdR = (float) data.energyDerivExpressions[index][0].evaluate();
+        totalEnergy += (float) terms[0];
+    float dEdR = (float) terms[1];
     dEdR *= 1/r;
     fvec4 result = deltaR*dEdR;
     (fvec4(forces+4*atom1)-result).store(forces+4*atom1);
     (fvec4(forces+4*atom2)+result).store(forces+4*atom2);
-    for (int i = 0; i < (int) values.size(); i++) {
-        data.dEdV[i][atom1] += (float) data.energyDerivExpressions[index][2*i+1].evaluate();
-        data.dEdV[i][atom2] += (float) data.energyDerivExpressions[index][2*i+2].evaluate();
+    for (int i = 0; i < numValues; i++) {
+        data.dEdV[i][atom1] += (float) terms[2*i+2];
+        data.dEdV[i][atom2] += (float) terms[2*i+3];
     }
         
     // Compute derivatives with respect to parameters.
 
-    for (int i = 0; i < data.energyParamDerivExpressions[index].size(); i++)
-        data.energyParamDerivs[i] += data.energyParamDerivExpressions[index][i].evaluate();
+    for (int i = 0; i < numParamDerivs; i++)
+        data.energyParamDerivs[i] += terms[2*numValues+2+i];
 }
 
 void CpuCustomGBForce::calculateChainRuleForces(ThreadData& data, int numAtoms, float* posq, vector<double>* atomParameters,
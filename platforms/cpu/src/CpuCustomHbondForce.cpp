@@ -0,0 +1,560 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "CpuCustomHbondForce.h"
+#include "ReferenceBondIxn.h"
+#include "ReferenceForce.h"
+#include "ReferenceTabulatedFunction.h"
+#include "SimTKOpenMMUtilities.h"
+#include "openmm/internal/CustomHbondForceImpl.h"
+#include "lepton/CustomFunction.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace OpenMM;
+using namespace std;
+
+// The number of values stored for each term of each pair in a block: three displacement vectors (each
+// with its squared length and length) and two cross products, which is what a dihedral needs.
+
+static const int GeometrySize = 21;
+
+// The largest number of cells along any axis of the grid.
+
+static const int MaxCellsPerAxis = 1000;
+
+class CpuCustomHbondForce::ThreadData {
+public:
+    ThreadData(const Lepton::CompiledVectorExpression& expression, const vector<TermInfo>& terms, const vector<string>& donorParamNames,
+            const vector<string>& acceptorParamNames);
+    Lepton::CompiledVectorExpression expression;
+    int width, numInBlock;
+    vector<float> termValues, donorParams, acceptorParams;
+    vector<int> blockAtoms;
+    vector<double> termGeometry;
+    vector<double> atomForce;
+    vector<int> atomsWithForce;
+    double energy;
+    /**
+     * Get the location where forces on an atom should be accumulated.
+     */
+    double* getForce(int atom) {
+        double* f = &atomForce[4*atom];
+        if (f[3] == 0.0) {
+            f[3] = 1.0;
+            atomsWithForce.push_back(atom);
+        }
+        return f;
+    }
+};
+
+CpuCustomHbondForce::ThreadData::ThreadData(const Lepton::CompiledVectorExpression& expression, const vector<TermInfo>& terms,
+            const vector<string>& donorParamNames, const vector<string>& acceptorParamNames) : expression(expression), numInBlock(0), energy(0) {
+    width = expression.getWidth();
+    termValues.resize(terms.size()*width, 0.0f);
+    donorParams.resize(donorParamNames.size()*width, 0.0f);
+    acceptorParams.resize(acceptorParamNames.size()*width, 0.0f);
+    blockAtoms.resize(6*width);
+    termGeometry.resize(terms.size()*width*GeometrySize);
+    map<string, float*> variableLocations;
+    for (int i = 0; i < terms.size(); i++)
+        variableLocations[terms[i].name] = &termValues[i*width];
+    for (int i = 0; i < donorParamNames.size(); i++)
+        variableLocations[donorParamNames[i]] = &donorParams[i*width];
+    for (int i = 0; i < acceptorParamNames.size(); i++)
+        variableLocations[acceptorParamNames[i]] = &acceptorParams[i*width];
+    this->expression.setVariableLocations(variableLocations);
+}
+
+CpuCustomHbondForce::CpuCustomHbondForce(const CustomHbondForce& force, ThreadPool& threads) : threads(threads), useCutoff(false),
+            usePeriodic(false), useCellList(false) {
+    // Record the donors, acceptors, and exclusions.
+
+    int numDonors = force.getNumDonors();
+    int numAcceptors = force.getNumAcceptors();
+    vector<double> parameters;
+    donorAtoms.resize(numDonors);
+    for (int i = 0; i < numDonors; i++) {
+        int d1, d2, d3;
+        force.getDonorParameters(i, d1, d2, d3, parameters);
+        donorAtoms[i] = {d1, d2, d3};
+    }
+    acceptorAtoms.resize(numAcceptors);
+    for (int i = 0; i < numAcceptors; i++) {
+        int a1, a2, a3;
+        force.getAcceptorParameters(i, a1, a2, a3, parameters);
+        acceptorAtoms[i] = {a1, a2, a3};
+    }
+    exclusions.resize(numDonors);
+    for (int i = 0; i < force.getNumExclusions(); i++) {
+        int donor, acceptor;
+        force.getExclusionParticles(i, donor, acceptor);
+        exclusions[donor].insert(acceptor);
+    }
+    for (int i = 0; i < force.getNumPerDonorParameters(); i++)
+        donorParamNames.push_back(force.getPerDonorParameterName(i));
+    for (int i = 0; i < force.getNumPerAcceptorParameters(); i++)
+        acceptorParamNames.push_back(force.getPerAcceptorParameterName(i));
+
+    // Create custom functions for the tabulated functions.
+
+    map<string, Lepton::CustomFunction*> functions;
+    for (int i = 0; i < force.getNumTabulatedFunctions(); i++)
+        functions[force.getTabulatedFunctionName(i)] = createReferenceTabulatedFunction(force.getTabulatedFunction(i));
+
+    // Parse the expression.  A single vector expression computes the energy together with its derivative
+    // with respect to every distance, angle, and dihedral, so they can share subexpressions.
+
+    map<string, vector<int> > distances;
+    map<string, vector<int> > angles;
+    map<string, vector<int> > dihedrals;
+    Lepton::ParsedExpression energyExpression = CustomHbondForceImpl::prepareExpression(force, functions, distances, angles, dihedrals);
+    for (auto& term : distances)
+        terms.push_back({term.first, TermInfo::Distance, term.second});
+    for (auto& term : angles)
+        terms.push_back({term.first, TermInfo::Angle, term.second});
+    for (auto& term : dihedrals)
+        terms.push_back({term.first, TermInfo::Dihedral, term.second});
+    vector<Lepton::ParsedExpression> expressions = {energyExpression};
+    for (auto& term : terms)
+        expressions.push_back(energyExpression.differentiate(term.name).optimize());
+    int width = Lepton::CompiledVectorExpression::getAllowedWidths().back();
+    Lepton::CompiledVectorExpression expression(expressions, width);
+    for (int i = 0; i < threads.getNumThreads(); i++)
+        threadData.push_back(new ThreadData(expression, terms, donorParamNames, acceptorParamNames));
+    if (force.getNonbondedMethod() != CustomHbondForce::NoCutoff)
+        setUseCutoff(force.getCutoffDistance());
+
+    // Delete the custom functions.
+
+    for (auto& function : functions)
+        delete function.second;
+}
+
+CpuCustomHbondForce::~CpuCustomHbondForce() {
+    for (auto data : threadData)
+        delete data;
+}
+
+void CpuCustomHbondForce::setUseCutoff(double distance) {
+    useCutoff = true;
+    cutoffDistance = distance;
+}
+
+void CpuCustomHbondForce::setPeriodic(Vec3* periodicBoxVectors) {
+    assert(useCutoff);
+    assert(periodicBoxVectors[0][0] >= 2.0*cutoffDistance);
+    assert(periodicBoxVectors[1][1] >= 2.0*cutoffDistance);
+    assert(periodicBoxVectors[2][2] >= 2.0*cutoffDistance);
+    usePeriodic = true;
+    this->periodicBoxVectors[0] = periodicBoxVectors[0];
+    this->periodicBoxVectors[1] = periodicBoxVectors[1];
+    this->periodicBoxVectors[2] = periodicBoxVectors[2];
+}
+
+void CpuCustomHbondForce::calculateIxn(AlignedArray<float>& posq, vector<vector<double> >& donorParameters, vector<vector<double> >& acceptorParameters,
+            const map<string, double>& globalParameters, vector<AlignedArray<float> >& threadForce, bool includeForces, bool includeEnergy, double& energy) {
+    // Record the parameters for the threads.
+
+    this->posq = &posq[0];
+    this->donorParameters = donorParameters.data();
+    this->acceptorParameters = acceptorParameters.data();
+    this->globalParameters = &globalParameters;
+    this->threadForce = &threadForce;
+    this->includeForces = includeForces;
+    this->includeEnergy = includeEnergy;
+    numParticles = posq.size()/4;
+    atomicCounter = 0;
+    useCellList = false;
+    if (useCutoff)
+        buildCellList();
+
+    // Signal the threads to start running and wait for them to finish.
+
+    threads.execute([&] (ThreadPool& threads, int threadIndex) { threadComputeForce(threads, threadIndex); });
+    threads.waitForThreads();
+
+    // Combine the energies from all the threads.
+
+    if (includeEnergy) {
+        int numThreads = threads.getNumThreads();
+        for (int i = 0; i < numThreads; i++)
+            energy += threadData[i]->energy;
+    }
+}
+
+void CpuCustomHbondForce::threadComputeForce(ThreadPool& threads, int threadIndex) {
+    float* forces = &(*threadForce)[threadIndex][0];
+    ThreadData& data = *threadData[threadIndex];
+    data.energy = 0;
+    data.numInBlock = 0;
+    if (data.atomForce.size() < 4*(size_t) numParticles)
+        data.atomForce.resize(4*(size_t) numParticles, 0.0);
+    const set<string>& variables = data.expression.getVariables();
+    for (auto& param : *globalParameters) {
+        if (variables.find(param.first) != variables.end()) {
+            float* p = data.expression.getVariablePointer(param.first);
+            for (int i = 0; i < data.width; i++)
+                p[i] = param.second;
+        }
+    }
+    int numDonors = donorAtoms.size();
+    int numAcceptors = acceptorAtoms.size();
+    while (true) {
+        int donor = atomicCounter++;
+        if (donor >= numDonors)
+            break;
+        int d1 = donorAtoms[donor][0];
+        const set<int>& excluded = exclusions[donor];
+        auto processPair = [&] (int acceptor) {
+            if (excluded.find(acceptor) != excluded.end())
+                return;
+            if (useCutoff) {
+                double delta[ReferenceForce::LastDeltaRIndex];
+                computeDelta(acceptorAtoms[acceptor][0], d1, delta);
+                if (delta[ReferenceForce::RIndex] >= cutoffDistance)
+                    return;
+            }
+            addPairToBlock(donor, acceptor, data);
+            if (data.numInBlock == data.width)
+                computeBlock(data);
+        };
+        if (useCellList) {
+            // Only check acceptors in the cells next to the one containing the donor.
+
+            double coords[3];
+            getCellCoordinates(d1, coords);
+            int first[3], last[3];
+            for (int i = 0; i < 3; i++)
+                findCellRange(i, coords[i], first[i], last[i]);
+            for (int x = first[0]; x <= last[0]; x++) {
+                int cellX = (x+numCells[0])%numCells[0];
+                for (int y = first[1]; y <= last[1]; y++) {
+                    int cellY = (y+numCells[1])%numCells[1];
+                    for (int z = first[2]; z <= last[2]; z++) {
+                        int cell = (cellX*numCells[1]+cellY)*numCells[2] + (z+numCells[2])%numCells[2];
+                        for (int i = cellStart[cell]; i < cellStart[cell+1]; i++)
+                            processPair(cellAcceptors[i]);
+                    }
+                }
+            }
+        }
+        else {
+            for (int acceptor = 0; acceptor < numAcceptors; acceptor++)
+                processPair(acceptor);
+        }
+    }
+    if (data.numInBlock > 0)
+        computeBlock(data);
+
+    // Forces are summed in double precision, since a donor can interact with many acceptors.
+    // Add them to this thread's force buffer.
+
+    for (int atom : data.atomsWithForce) {
+        double* f = &data.atomForce[4*atom];
+        for (int j = 0; j < 3; j++)
+            forces[4*atom+j] += (float) f[j];
+        for (int j = 0; j < 4; j++)
+            f[j] = 0.0;
+    }
+    data.atomsWithForce.clear();
+}
+
+void CpuCustomHbondForce::buildCellList() {
+    // Decide how many cells to use along each axis.  Every cell must be at least as wide as the cutoff.
+    // For a periodic box, the cells divide the box in fractional coordinates, and the relevant width
+    // is the distance between opposite faces of the box.
+
+    int numAcceptors = acceptorAtoms.size();
+    double width[3];
+    if (usePeriodic) {
+        double volume = periodicBoxVectors[0][0]*periodicBoxVectors[1][1]*periodicBoxVectors[2][2];
+        for (int i = 0; i < 3; i++) {
+            Vec3 normal = periodicBoxVectors[(i+1)%3].cross(periodicBoxVectors[(i+2)%3]);
+            width[i] = volume/sqrt(normal.dot(normal));
+        }
+    }
+    else {
+        double maxPos[3];
+        for (int i = 0; i < 3; i++) {
+            cellOrigin[i] = numeric_limits<double>::max();
+            maxPos[i] = -numeric_limits<double>::max();
+        }
+        for (int acceptor = 0; acceptor < numAcceptors; acceptor++) {
+            const float* pos = &posq[4*acceptorAtoms[acceptor][0]];
+            for (int i = 0; i < 3; i++) {
+                cellOrigin[i] = min(cellOrigin[i], (double) pos[i]);
+                maxPos[i] = max(maxPos[i], (double) pos[i]);
+            }
+        }
+        for (int i = 0; i < 3; i++)
+            width[i] = max(0.0, maxPos[i]-cellOrigin[i]);
+    }
+    for (int i = 0; i < 3; i++)
+        numCells[i] = (int) max(1.0, min((double) MaxCellsPerAxis, floor(width[i]/cutoffDistance)));
+
+    // Keep the number of cells from being much larger than the number of acceptors.
+
+    int maxCells = max(27, 2*numAcceptors);
+    while (numCells[0]*numCells[1]*numCells[2] > maxCells) {
+        int axis = (numCells[0] >= numCells[1] ? (numCells[0] >= numCells[2] ? 0 : 2) : (numCells[1] >= numCells[2] ? 1 : 2));
+        numCells[axis] /= 2;
+    }
+
+    // With periodic boundary conditions, the neighboring cells on the two sides of a cell are only
+    // distinct if there are at least three of them.
+
+    for (int i = 0; i < 3; i++) {
+        if (usePeriodic && numCells[i] < 3)
+            numCells[i] = 1;
+        cellWidth[i] = width[i]/numCells[i];
+    }
+    int totalCells = numCells[0]*numCells[1]*numCells[2];
+    if (totalCells == 1)
+        return;
+    useCellList = true;
+
+    // Sort the acceptors by cell.
+
+    acceptorCell.resize(numAcceptors);
+    cellStart.resize(totalCells+1);
+    for (int i = 0; i <= totalCells; i++)
+        cellStart[i] = 0;
+    for (int acceptor = 0; acceptor < numAcceptors; acceptor++) {
+        double coords[3];
+        getCellCoordinates(acceptorAtoms[acceptor][0], coords);
+        int index[3];
+        for (int i = 0; i < 3; i++)
+            index[i] = min(numCells[i]-1, max(0, (int) coords[i]));
+        int cell = (index[0]*numCells[1]+index[1])*numCells[2]+index[2];
+        acceptorCell[acceptor] = cell;
+        cellStart[cell+1]++;
+    }
+    for (int i = 0; i < totalCells; i++)
+        cellStart[i+1] += cellStart[i];
+    cellAcceptors.resize(numAcceptors);
+    vector<int> cellEnd(cellStart.begin(), cellStart.end()-1);
+    for (int acceptor = 0; acceptor < numAcceptors; acceptor++)
+        cellAcceptors[cellEnd[acceptorCell[acceptor]]++] = acceptor;
+}
+
+void CpuCustomHbondForce::getCellCoordinates(int atom, double* coords) const {
+    const float* pos = &posq[4*atom];
+    if (usePeriodic) {
+        // Convert to fractional coordinates.  The box vectors are in reduced form, so this only
+        // requires back substitution.
+
+        double s[3];
+        s[2] = pos[2]/periodicBoxVectors[2][2];
+        s[1] = (pos[1]-s[2]*periodicBoxVectors[2][1])/periodicBoxVectors[1][1];
+        s[0] = (pos[0]-s[2]*periodicBoxVectors[2][0]-s[1]*periodicBoxVectors[1][0])/periodicBoxVectors[0][0];
+        for (int i = 0; i < 3; i++)
+            coords[i] = (s[i]-floor(s[i]))*numCells[i];
+    }
+    else {
+        for (int i = 0; i < 3; i++)
+            coords[i] = (numCells[i] == 1 ? 0.0 : (pos[i]-cellOrigin[i])/cellWidth[i]);
+    }
+}
+
+void CpuCustomHbondForce::findCellRange(int axis, double coordinate, int& first, int& last) const {
+    int n = numCells[axis];
+    if (n == 1) {
+        first = 0;
+        last = 0;
+    }
+    else if (usePeriodic) {
+        int cell = min(n-1, (int) coordinate);
+        first = cell-1;
+        last = cell+1;
+    }
+    else {
+        // The donor may be outside the range spanned by the acceptors, in which case the range may be empty.
+
+        int cell = (int) max(-2.0, min((double) n+1, floor(coordinate)));
+        first = max(0, cell-1);
+        last = min(n-1, cell+1);
+    }
+}
+
+void CpuCustomHbondForce::addPairToBlock(int donor, int acceptor, ThreadData& data) {
+    int lane = data.numInBlock++;
+    int width = data.width;
+    int* atoms = &data.blockAtoms[6*lane];
+    for (int i = 0; i < 3; i++) {
+        atoms[i] = acceptorAtoms[acceptor][i];
+        atoms[i+3] = donorAtoms[donor][i];
+    }
+    for (int i = 0; i < donorParamNames.size(); i++)
+        data.donorParams[i*width+lane] = (float) donorParameters[donor][i];
+    for (int i = 0; i < acceptorParamNames.size(); i++)
+        data.acceptorParams[i*width+lane] = (float) acceptorParameters[acceptor][i];
+
+    // Compute all of the variables the energy can depend on.
+
+    int numTerms = terms.size();
+    for (int i = 0; i < numTerms; i++) {
+        const TermInfo& term = terms[i];
+        double* geometry = &data.termGeometry[(lane*numTerms+i)*GeometrySize];
+        double* delta1 = geometry;
+        double* delta2 = geometry+ReferenceForce::LastDeltaRIndex;
+        double* delta3 = geometry+2*ReferenceForce::LastDeltaRIndex;
+        double value;
+        if (term.type == TermInfo::Distance) {
+            computeDelta(atoms[term.atoms[0]], atoms[term.atoms[1]], delta1);
+            value = delta1[ReferenceForce::RIndex];
+        }
+        else if (term.type == TermInfo::Angle) {
+            computeDelta(atoms[term.atoms[0]], atoms[term.atoms[1]], delta1);
+            computeDelta(atoms[term.atoms[2]], atoms[term.atoms[1]], delta2);
+            value = computeAngle(delta1, delta2);
+        }
+        else {
+            computeDelta(atoms[term.atoms[1]], atoms[term.atoms[0]], delta1);
+            computeDelta(atoms[term.atoms[1]], atoms[term.atoms[2]], delta2);
+            computeDelta(atoms[term.atoms[3]], atoms[term.atoms[2]], delta3);
+            double* crossProduct[] = {geometry+3*ReferenceForce::LastDeltaRIndex, geometry+3*ReferenceForce::LastDeltaRIndex+3};
+            double dotDihedral, signOfDihedral;
+            value = ReferenceBondIxn::getDihedralAngleBetweenThreeVectors(delta1, delta2, delta3, crossProduct, &dotDihedral, delta1, &signOfDihedral, 1);
+        }
+        data.termValues[i*width+lane] = (float) value;
+    }
+}
+
+void CpuCustomHbondForce::computeBlock(ThreadData& data) {
+    const float* results = data.expression.evaluate();
+    int width = data.width;
+    int numTerms = terms.size();
+    for (int lane = 0; lane < data.numInBlock; lane++) {
+        if (includeEnergy)
+            data.energy += results[lane];
+        if (!includeForces)
+            continue;
+        const int* atoms = &data.blockAtoms[6*lane];
+        for (int i = 0; i < numTerms; i++) {
+            const TermInfo& term = terms[i];
+            double* geometry = &data.termGeometry[(lane*numTerms+i)*GeometrySize];
+            double* delta1 = geometry;
+            double* delta2 = geometry+ReferenceForce::LastDeltaRIndex;
+            double* delta3 = geometry+2*ReferenceForce::LastDeltaRIndex;
+            double dEdTerm = results[(i+1)*width+lane];
+            if (term.type == TermInfo::Distance) {
+                // Apply forces based on a distance.
+
+                double dEdR = dEdTerm/delta1[ReferenceForce::RIndex];
+                double* f1 = data.getForce(atoms[term.atoms[0]]);
+                double* f2 = data.getForce(atoms[term.atoms[1]]);
+                for (int j = 0; j < 3; j++) {
+                    double force = -dEdR*delta1[j];
+                    f1[j] -= force;
+                    f2[j] += force;
+                }
+            }
+            else if (term.type == TermInfo::Angle) {
+                // Apply forces based on an angle.
+
+                double thetaCross[ReferenceForce::LastDeltaRIndex];
+                SimTKOpenMMUtilities::crossProductVector3(delta1, delta2, thetaCross);
+                double lengthThetaCross = sqrt(DOT3(thetaCross, thetaCross));
+                if (lengthThetaCross < 1.0e-06)
+                    lengthThetaCross = 1.0e-06;
+                double termA = dEdTerm/(delta1[ReferenceForce::R2Index]*lengthThetaCross);
+                double termC = -dEdTerm/(delta2[ReferenceForce::R2Index]*lengthThetaCross);
+                double deltaCrossP[3][3];
+                SimTKOpenMMUtilities::crossProductVector3(delta1, thetaCross, deltaCrossP[0]);
+                SimTKOpenMMUtilities::crossProductVector3(delta2, thetaCross, deltaCrossP[2]);
+                for (int j = 0; j < 3; j++) {
+                    deltaCrossP[0][j] *= termA;
+                    deltaCrossP[2][j] *= termC;
+                    deltaCrossP[1][j] = -(deltaCrossP[0][j]+deltaCrossP[2][j]);
+                }
+                for (int k = 0; k < 3; k++) {
+                    double* f = data.getForce(atoms[term.atoms[k]]);
+                    for (int j = 0; j < 3; j++)
+                        f[j] += deltaCrossP[k][j];
+                }
+            }
+            else {
+                // Apply forces based on a dihedral.
+
+                double* cross1 = geometry+3*ReferenceForce::LastDeltaRIndex;
+                double* cross2 = cross1+3;
+                double internalF[4][3];
+                double forceFactors[4];
+                double normCross1 = DOT3(cross1, cross1);
+                double normBC = delta2[ReferenceForce::RIndex];
+                forceFactors[0] = (-dEdTerm*normBC)/normCross1;
+                double normCross2 = DOT3(cross2, cross2);
+                forceFactors[3] = (dEdTerm*normBC)/normCross2;
+                forceFactors[1] = DOT3(delta1, delta2)/delta2[ReferenceForce::R2Index];
+                forceFactors[2] = DOT3(delta3, delta2)/delta2[ReferenceForce::R2Index];
+                for (int j = 0; j < 3; j++) {
+                    internalF[0][j] = forceFactors[0]*cross1[j];
+                    internalF[3][j] = forceFactors[3]*cross2[j];
+                    double s = forceFactors[1]*internalF[0][j] - forceFactors[2]*internalF[3][j];
+                    internalF[1][j] = internalF[0][j] - s;
+                    internalF[2][j] = internalF[3][j] + s;
+                }
+                double* f1 = data.getForce(atoms[term.atoms[0]]);
+                double* f2 = data.getForce(atoms[term.atoms[1]]);
+                double* f3 = data.getForce(atoms[term.atoms[2]]);
+                double* f4 = data.getForce(atoms[term.atoms[3]]);
+                for (int j = 0; j < 3; j++) {
+                    f1[j] += internalF[0][j];
+                    f2[j] -= internalF[1][j];
+                    f3[j] -= internalF[2][j];
+                    f4[j] += internalF[3][j];
+                }
+            }
+        }
+    }
+    data.numInBlock = 0;
+}
+
+void CpuCustomHbondForce::computeDelta(int atom1, int atom2, double* delta) const {
+    Vec3 pos1(posq[4*atom1], posq[4*atom1+1], posq[4*atom1+2]);
+    Vec3 pos2(posq[4*atom2], posq[4*atom2+1], posq[4*atom2+2]);
+    if (usePeriodic)
+        ReferenceForce::getDeltaRPeriodic(pos1, pos2, periodicBoxVectors, delta);
+    else
+        ReferenceForce::getDeltaR(pos1, pos2, delta);
+}
+
+double CpuCustomHbondForce::computeAngle(const double* vec1, const double* vec2) {
+    double dot = DOT3(vec1, vec2);
+    double cosine = dot/sqrt((vec1[ReferenceForce::R2Index]*vec2[ReferenceForce::R2Index]));
+    if (cosine >= 1)
+        return 0;
+    if (cosine <= -1)
+        return M_PI;
+    return acos(cosine);
+}
@@ -24,20 +24,42 @@
 
 #include "CpuCustomNonbondedForce.h"
 #include "openmm/internal/hardware.h"
+#include <algorithm>
 #include <cmath>
 
 using namespace OpenMM;
 using namespace Lepton;
 using namespace std;
 
-CpuCustomNonbondedForce::ThreadData::ThreadData(const CompiledExpression& energyExpression, const CompiledVectorExpression& energyVecExpression,
-            const CompiledExpression& forceExpression, const CompiledVectorExpression& forceVecExpression,
-            const vector<string>& parameterNames, const std::vector<CompiledExpression> energyParamDerivExpressions,
+// The maximum number of floats in all the tables together.  If they cannot be made accurate enough
+// within this size, the expression is evaluated instead.
+static const long long MaxTableSize = 1<<24;
+
+// The tables cover distances from this fraction of the cutoff up to the cutoff.  Closer pairs are evaluated
+// with the expression.
+static const double TableStartFraction = 0.1;
+
+static const int MinTableIntervals = 1024;
+static const double TableTolerance = 1e-5;
+
+// Tables are only built for as many distinct combinations of per-particle parameters as fit in MaxTableSize
+// at the lowest resolution.  Each pair of types needs 8 floats per interval.
+
+static int computeMaxTableTypes() {
+    int numTypes = 0;
+    while (8LL*(numTypes+1)*(numTypes+2)/2*MinTableIntervals <= MaxTableSize)
+        numTypes++;
+    return numTypes;
+}
+
+static const int MaxTableTypes = computeMaxTableTypes();
+
+CpuCustomNonbondedForce::ThreadData::ThreadData(const CompiledExpression& interactionExpression, const CompiledVectorExpression& forceVecExpression,
+            const CompiledVectorExpression& forceEnergyVecExpression, const vector<string>& parameterNames, int numParamDerivs,
             const vector<string>& computedValueNames, const vector<CompiledExpression> computedValueExpressions,
             vector<vector<double> >& atomComputedValues) :
-            energyExpression(energyExpression), energyVecExpression(energyVecExpression), forceExpression(forceExpression),
-            forceVecExpression(forceVecExpression), energyParamDerivExpressions(energyParamDerivExpressions),
-            computedValueExpressions(computedValueExpressions), atomComputedValues(atomComputedValues) {
+            interactionExpression(interactionExpression), computedValueExpressions(computedValueExpressions), atomComputedValues(atomComputedValues),
+            writtenTiles(NULL) {
     // Prepare for passing variables to expressions.
 
     map<string, double*> variableLocations;
@@ -52,36 +74,42 @@ CpuCustomNonbondedForce::ThreadData::ThreadData(const CompiledExpression& energy
         variableLocations[computedValueNames[i]+"1"] = &computedValues[i*2];
         variableLocations[computedValueNames[i]+"2"] = &computedValues[i*2+1];
     }
-    energyParamDerivs.resize(energyParamDerivExpressions.size());
-    this->energyExpression.setVariableLocations(variableLocations);
-    this->forceExpression.setVariableLocations(variableLocations);
-    expressionSet.registerExpression(this->energyExpression);
-    expressionSet.registerExpression(this->forceExpression);
-    for (auto& expression : this->energyParamDerivExpressions) {
-        expression.setVariableLocations(variableLocations);
-        expressionSet.registerExpression(expression);
-    }
+    energyParamDerivs.resize(numParamDerivs);
+    interactionResult.resize(interactionExpression.getNumResults());
+    this->interactionExpression.setVariableLocations(variableLocations);
+    expressionSet.registerExpression(this->interactionExpression);
 
-    // Prepare for passing variables to vectorized expressions.
+    // Prepare for passing variables to vectorized expressions.  If a block is wider than the
+    // vector expressions, each one covers a different piece of the block.
 
-    map<string, float*> vecVariableLocations;
     int blockSize = getVectorWidth();
+    int width = forceVecExpression.getWidth();
     rvec.resize(blockSize);
     vecParticle1Params.resize(blockSize*parameterNames.size());
     vecParticle2Params.resize(blockSize*parameterNames.size());
     vecParticle1Values.resize(blockSize*computedValueNames.size());
     vecParticle2Values.resize(blockSize*computedValueNames.size());
-    vecVariableLocations["r"] = rvec.data();
-    for (int i = 0; i < parameterNames.size(); i++) {
-        vecVariableLocations[parameterNames[i]+"1"] = &vecParticle1Params[i*blockSize];
-        vecVariableLocations[parameterNames[i]+"2"] = &vecParticle2Params[i*blockSize];
+    if (blockSize > width) {
+        forceVecResult.resize(blockSize);
+        forceEnergyVecResult.resize(2*blockSize);
     }
-    for (int i = 0; i < computedValueNames.size(); i++) {
-        vecVariableLocations[computedValueNames[i]+"1"] = &vecParticle1Values[i*blockSize];
-        vecVariableLocations[computedValueNames[i]+"2"] = &vecParticle2Values[i*blockSize];
+    forceVecExpressions.resize(blockSize/width, forceVecExpression);
+    forceEnergyVecExpressions.resize(blockSize/width, forceEnergyVecExpression);
+    for (int piece = 0; piece < blockSize/width; piece++) {
+        int offset = piece*width;
+        map<string, float*> vecVariableLocations;
+        vecVariableLocations["r"] = &rvec[offset];
+        for (int i = 0; i < parameterNames.size(); i++) {
+            vecVariableLocations[parameterNames[i]+"1"] = &vecParticle1Params[i*blockSize+offset];
+            vecVariableLocations[parameterNames[i]+"2"] = &vecParticle2Params[i*blockSize+offset];
+        }
+        for (int i = 0; i < computedValueNames.size(); i++) {
+            vecVariableLocations[computedValueNames[i]+"1"] = &vecParticle1Values[i*blockSize+offset];
+            vecVariableLocations[computedValueNames[i]+"2"] = &vecParticle2Values[i*blockSize+offset];
+        }
+        forceVecExpressions[piece].setVariableLocations(vecVariableLocations);
+        forceEnergyVecExpressions[piece].setVariableLocations(vecVariableLocations);
     }
-    this->energyVecExpression.setVariableLocations(vecVariableLocations);
-    this->forceVecExpression.setVariableLocations(vecVariableLocations);
 
     // Prepare for passing variables to the computed value expressions.
 
@@ -94,8 +122,24 @@ CpuCustomNonbondedForce::ThreadData::ThreadData(const CompiledExpression& energy
     }
 }
 
+const float* CpuCustomNonbondedForce::ThreadData::evaluateVecExpressions(vector<CompiledVectorExpression>& expressions, vector<float>& result) {
+    if (expressions.size() == 1)
+        return expressions[0].evaluate();
+    int width = expressions[0].getWidth();
+    int numResults = expressions[0].getNumResults();
+    int blockSize = width*expressions.size();
+    for (int i = 0; i < expressions.size(); i++) {
+        const float* values = expressions[i].evaluate();
+        for (int k = 0; k < numResults; k++)
+            for (int j = 0; j < width; j++)
+                result[k*blockSize+i*width+j] = values[k*width+j];
+    }
+    return result.data();
+}
+
 CpuCustomNonbondedForce::CpuCustomNonbondedForce(ThreadPool& threads, const CpuNeighborList& neighbors) : cutoff(false), useSwitch(false),
-        periodic(false), useInteractionGroups(false), threads(threads), neighborList(&neighbors) {
+        periodic(false), useInteractionGroups(false), threads(threads), neighborList(&neighbors), forceRegions(NULL), useTables(false),
+        canUseTables(false), hasTables(false), tablesUpToDate(false), typesUpToDate(false), typesFit(false), numTableIntervals(0), tableCutoff(0.0) {
 }
 
 void CpuCustomNonbondedForce::initialize(const ParsedExpression& energyExpression,
@@ -105,18 +149,42 @@ void CpuCustomNonbondedForce::initialize(const ParsedExpression& energyExpressio
     this->paramNames = parameterNames;
     this->exclusions = exclusions;
     this->computedValueNames = computedValueNames;
-    CompiledExpression compiledEnergyExpression = energyExpression.createCompiledExpression();
-    CompiledExpression compiledForceExpression = forceExpression.createCompiledExpression();
-    CompiledVectorExpression energyVecExpression = energyExpression.createCompiledVectorExpression(getVectorWidth());
-    CompiledVectorExpression forceVecExpression = forceExpression.createCompiledVectorExpression(getVectorWidth());
-    vector<CompiledExpression> compiledDerivExpressions, compiledValueExpressions;
+    vector<ParsedExpression> forceEnergyExpressions = {forceExpression, energyExpression};
+    vector<ParsedExpression> interactionExpressions = forceEnergyExpressions;
     for (auto& exp : energyParamDerivExpressions)
-        compiledDerivExpressions.push_back(exp.createCompiledExpression());
+        interactionExpressions.push_back(exp);
+    CompiledExpression compiledInteractionExpression(interactionExpressions);
+    int width = getVectorWidth();
+    const vector<int>& allowedWidths = CompiledVectorExpression::getAllowedWidths();
+    while (find(allowedWidths.begin(), allowedWidths.end(), width) == allowedWidths.end())
+        width /= 2;
+    CompiledVectorExpression forceVecExpression = forceExpression.createCompiledVectorExpression(width);
+    CompiledVectorExpression forceEnergyVecExpression(forceEnergyExpressions, width);
+    vector<CompiledExpression> compiledValueExpressions;
     for (auto& exp : computedValueExpressions)
         compiledValueExpressions.push_back(exp.createCompiledExpression());
     for (int i = 0; i < threads.getNumThreads(); i++)
-        threadData.push_back(new ThreadData(compiledEnergyExpression, energyVecExpression, compiledForceExpression, forceVecExpression, parameterNames,
-                compiledDerivExpressions, computedValueNames, compiledValueExpressions, atomComputedValues));
+        threadData.push_back(new ThreadData(compiledInteractionExpression, forceVecExpression, forceEnergyVecExpression, parameterNames,
+                energyParamDerivExpressions.size(), computedValueNames, compiledValueExpressions, atomComputedValues));
+
+    // Interactions can only be tabulated if they depend on nothing but r, per-particle parameters, and global parameters.
+    // The table expression also computes the second derivative, so dE/dr can be interpolated as accurately as the energy.
+
+    canUseTables = (computedValueNames.size() == 0 && energyParamDerivExpressions.size() == 0);
+    if (canUseTables) {
+        tableExpression = CompiledExpression(vector<ParsedExpression>({energyExpression, forceExpression, forceExpression.differentiate("r").optimize()}));
+        map<string, double*> variableLocations;
+        variableLocations["r"] = &tableR;
+        tableParticleParams.resize(2*parameterNames.size());
+        for (int i = 0; i < parameterNames.size(); i++) {
+            variableLocations[parameterNames[i]+"1"] = &tableParticleParams[i*2];
+            variableLocations[parameterNames[i]+"2"] = &tableParticleParams[i*2+1];
+        }
+        for (const string& name : tableExpression.getVariables())
+            if (variableLocations.find(name) == variableLocations.end())
+                tableGlobalParameters[name] = NAN;
+        tableExpression.setVariableLocations(variableLocations);
+    }
 }
 
 CpuCustomNonbondedForce::~CpuCustomNonbondedForce() {
@@ -172,6 +240,194 @@ void CpuCustomNonbondedForce::setPeriodic(Vec3* periodicBoxVectors) {
                  periodicBoxVectors[2][0] != 0.0 || periodicBoxVectors[2][1] != 0.0);
 }
 
+void CpuCustomNonbondedForce::setForceRegions(CpuForceRegions* regions) {
+    forceRegions = regions;
+}
+
+void CpuCustomNonbondedForce::setUseTables(bool use) {
+    useTables = use;
+}
+
+bool CpuCustomNonbondedForce::getUsedTables() const {
+    return hasTables;
+}
+
+int CpuCustomNonbondedForce::getMaxTableTypes() {
+    return MaxTableTypes;
+}
+
+void CpuCustomNonbondedForce::invalidateParticleTypes() {
+    typesUpToDate = false;
+}
+
+void CpuCustomNonbondedForce::updateTables() {
+    hasTables = false;
+    if (!useTables || !canUseTables || !cutoff || useInteractionGroups)
+        return;
+
+    // The tables must be rebuilt if the cutoff or a global parameter used by the expression has changed.
+
+    for (auto& param : tableGlobalParameters) {
+        double value = globalParameters->at(param.first);
+        if (value != param.second) {
+            param.second = value;
+            tablesUpToDate = false;
+        }
+    }
+    if (cutoffDistance != tableCutoff) {
+        tableCutoff = cutoffDistance;
+        tablesUpToDate = false;
+    }
+
+    // Assign a type to every particle.  This only needs to be done when the parameters or the particle order have
+    // changed.  Types are kept from one assignment to the next, so changing parameters only requires rebuilding the
+    // tables if it creates a new combination.  If there are too many types, try again from scratch in case some are
+    // no longer used.  A failed assignment leaves behind types that may not be used, so the next one starts from
+    // scratch too.
+
+    auto assignTypes = [&] () {
+        atomTypes.resize(numberOfAtoms, -1);
+        for (int i = 0; i < numberOfAtoms; i++) {
+            int type = atomTypes[i];
+            if (type != -1 && typeParameters[type] == atomParameters[i])
+                continue;
+            auto found = typeIndex.find(atomParameters[i]);
+            if (found != typeIndex.end())
+                type = found->second;
+            else {
+                if (typeParameters.size() == MaxTableTypes)
+                    return false;
+                type = typeParameters.size();
+                typeIndex[atomParameters[i]] = type;
+                typeParameters.push_back(atomParameters[i]);
+                tablesUpToDate = false;
+            }
+            atomTypes[i] = type;
+        }
+        return true;
+    };
+    auto clearTypes = [&] () {
+        atomTypes.clear();
+        typeParameters.clear();
+        typeIndex.clear();
+        tablesUpToDate = false;
+    };
+    if (!typesUpToDate) {
+        typesUpToDate = true;
+        if (!typesFit)
+            clearTypes();
+        typesFit = assignTypes();
+        if (!typesFit) {
+            clearTypes();
+            typesFit = assignTypes();
+        }
+    }
+    if (!typesFit)
+        return;
+
+    // Build the tables, increasing the resolution until they are accurate enough or too large.
+
+    if (!tablesUpToDate) {
+        tablesUpToDate = true;
+        numTableIntervals = 0;
+        int numTypes = typeParameters.size();
+        long long numPairs = numTypes*(numTypes+1)/2;
+        for (int intervals = MinTableIntervals; 8*numPairs*intervals <= MaxTableSize; intervals *= 2)
+            if (createTables(intervals)) {
+                numTableIntervals = intervals;
+                break;
+            }
+        if (numTableIntervals == 0) {
+            tableCoefficients.clear();
+            tableCoefficients.shrink_to_fit();
+        }
+    }
+    hasTables = (numTableIntervals > 0);
+}
+
+bool CpuCustomNonbondedForce::createTables(int numIntervals) {
+    for (auto& param : tableGlobalParameters)
+        tableExpression.getVariableReference(param.first) = param.second;
+    int numTypes = typeParameters.size();
+    int numParams = paramNames.size();
+    int numPairs = numTypes*(numTypes+1)/2;
+    double minR = TableStartFraction*cutoffDistance;
+    double spacing = (cutoffDistance-minR)/numIntervals;
+    tableMin = (float) minR;
+    tableScale = (float) (1.0/spacing);
+    tableCoefficients.resize(8*(size_t) numPairs*numIntervals);
+    pairTables.resize(numTypes*numTypes);
+    vector<double> energy(numIntervals+1), force(numIntervals+1), forceDeriv(numIntervals+1);
+    double values[3];
+    int pair = 0;
+    for (int type1 = 0; type1 < numTypes; type1++)
+        for (int type2 = type1; type2 < numTypes; type2++) {
+            pairTables[type1*numTypes+type2] = pair;
+            pairTables[type2*numTypes+type1] = pair;
+            auto setParticleTypes = [&] (int first, int second) {
+                for (int i = 0; i < numParams; i++) {
+                    tableParticleParams[i*2] = typeParameters[first][i];
+                    tableParticleParams[i*2+1] = typeParameters[second][i];
+                }
+            };
+
+            // Evaluate the energy and its derivatives at the ends of every interval, and fit a cubic Hermite
+            // polynomial on each one to the energy and to dE/dr.
+
+            setParticleTypes(type1, type2);
+            for (int i = 0; i <= numIntervals; i++) {
+                tableR = minR+i*spacing;
+                tableExpression.evaluate(values);
+                if (!isfinite(values[0]) || !isfinite(values[1]) || !isfinite(values[2]))
+                    return false;
+                energy[i] = values[0];
+                force[i] = values[1];
+                forceDeriv[i] = values[2];
+            }
+            float* coeff = &tableCoefficients[8*(size_t) pair*numIntervals];
+            auto fitHermite = [&] (const vector<double>& y, const vector<double>& deriv, int i, float* c) {
+                double d0 = spacing*deriv[i], d1 = spacing*deriv[i+1];
+                c[0] = (float) y[i];
+                c[1] = (float) d0;
+                c[2] = (float) (3*(y[i+1]-y[i])-2*d0-d1);
+                c[3] = (float) (2*(y[i]-y[i+1])+d0+d1);
+            };
+            for (int i = 0; i < numIntervals; i++) {
+                fitHermite(energy, force, i, &coeff[8*i]);
+                fitHermite(force, forceDeriv, i, &coeff[8*i+4]);
+            }
+
+            // Check the tables at the middle of every interval, where the error is largest, using the
+            // particles in both orders in case the expression is not symmetric.
+
+            double energyScale = 0.0, forceScale = 0.0;
+            for (int i = numIntervals/2; i <= numIntervals; i++) {
+                energyScale = max(energyScale, fabs(energy[i]));
+                forceScale = max(forceScale, fabs(force[i]));
+            }
+            for (int order = 0; order < 2; order++) {
+                if (order == 0)
+                    setParticleTypes(type1, type2);
+                else if (type1 != type2)
+                    setParticleTypes(type2, type1);
+                else
+                    break;
+                for (int i = 0; i < numIntervals; i++) {
+                    tableR = minR+(i+0.5)*spacing;
+                    tableExpression.evaluate(values);
+                    const float* c = &coeff[8*i];
+                    float tableEnergy = c[0]+0.5f*(c[1]+0.5f*(c[2]+0.5f*c[3]));
+                    float tableForce = c[4]+0.5f*(c[5]+0.5f*(c[6]+0.5f*c[7]));
+                    if (!(fabs(tableEnergy-values[0]) <= TableTolerance*(fabs(values[0])+energyScale)) ||
+                            !(fabs(tableForce-values[1]) <= TableTolerance*(fabs(values[1])+forceScale)))
+                        return false;
+                }
+            }
+            pair++;
+        }
+    return true;
+}
+
 
 void CpuCustomNonbondedForce::calculatePairIxn(int numberOfAtoms, float* posq, vector<Vec3>& atomCoordinates, vector<vector<double> >& atomParameters,
                                                const map<string, double>& globalParameters, vector<AlignedArray<float> >& threadForce,
@@ -189,6 +445,7 @@ void CpuCustomNonbondedForce::calculatePairIxn(int numberOfAtoms, float* posq, v
     threadEnergy.resize(threads.getNumThreads());
     atomComputedValues.resize(computedValueNames.size(), vector<double>(numberOfAtoms));
     atomicCounter = 0;
+    updateTables();
     
     // Signal the threads to start running and wait for them to finish.
     
@@ -215,25 +472,27 @@ void CpuCustomNonbondedForce::calculatePairIxn(int numberOfAtoms, float* posq, v
 
 void CpuCustomNonbondedForce::threadComputeForce(ThreadPool& threads, int threadIndex) {
     int numThreads = threads.getNumThreads();
-    int blockSize = getVectorWidth();
     ThreadData& data = *threadData[threadIndex];
     for (auto& param : *globalParameters) {
         data.expressionSet.setVariable(data.expressionSet.getVariableIndex(param.first), param.second);
-        try {
-            float* p = data.energyVecExpression.getVariablePointer(param.first);
-            for (int i = 0; i < blockSize; i++)
-                p[i] = param.second;
-        }
-        catch (...) {
-            // The expression doesn't use this parameter.
-        }
-        try {
-            float* p = data.forceVecExpression.getVariablePointer(param.first);
-            for (int i = 0; i < blockSize; i++)
-                p[i] = param.second;
-        }
-        catch (...) {
-            // The expression doesn't use this parameter.
+        for (int j = 0; j < data.forceVecExpressions.size(); j++) {
+            int width = data.forceVecExpressions[j].getWidth();
+            try {
+                float* p = data.forceEnergyVecExpressions[j].getVariablePointer(param.first);
+                for (int i = 0; i < width; i++)
+                    p[i] = param.second;
+            }
+            catch (...) {
+                // The expression doesn't use this parameter.
+            }
+            try {
+                float* p = data.forceVecExpressions[j].getVariablePointer(param.first);
+                for (int i = 0; i < width; i++)
+                    p[i] = param.second;
+            }
+            catch (...) {
+                // The expression doesn't use this parameter.
+            }
         }
     }
 
@@ -257,6 +516,7 @@ void CpuCustomNonbondedForce::threadComputeForce(ThreadPool& threads, int thread
     threadEnergy[threadIndex] = 0;
     double& energy = threadEnergy[threadIndex];
     float* forces = &(*threadForce)[threadIndex][0];
+    data.writtenTiles = (forceRegions == NULL ? NULL : forceRegions->getWrittenTiles(threadIndex));
     for (auto& deriv : data.energyParamDerivs)
         deriv = 0.0;
     fvec4 boxSize(periodicBoxVectors[0][0], periodicBoxVectors[1][1], periodicBoxVectors[2][2], 0);
@@ -332,10 +592,14 @@ void CpuCustomNonbondedForce::calculateOneIxn(int ii, int jj, ThreadData& data,
 
     // accumulate forces
 
-    double dEdR = (includeForce ? data.forceExpression.evaluate()/r : 0.0);
+    // Compute the force, energy, and parameter derivatives together.
+
+    double* values = data.interactionResult.data();
+    data.interactionExpression.evaluate(values);
+    double dEdR = (includeForce ? values[0]/r : 0.0);
     double energy = 0.0;
     if (includeEnergy || (useSwitch && r > switchingDistance))
-        energy = data.energyExpression.evaluate();
+        energy = values[1];
     double switchValue = 1.0;
     if (useSwitch) {
         if (r > switchingDistance) {
@@ -349,6 +613,10 @@ void CpuCustomNonbondedForce::calculateOneIxn(int ii, int jj, ThreadData& data,
     fvec4 result = deltaR*dEdR;
     (fvec4(forces+4*ii)+result).store(forces+4*ii);
     (fvec4(forces+4*jj)-result).store(forces+4*jj);
+    if (data.writtenTiles != NULL) {
+        data.writtenTiles[ii/CpuForceRegions::TileSize] = 1;
+        data.writtenTiles[jj/CpuForceRegions::TileSize] = 1;
+    }
 
     // accumulate energies
 
@@ -356,8 +624,8 @@ void CpuCustomNonbondedForce::calculateOneIxn(int ii, int jj, ThreadData& data,
     
     // Accumulate energy derivatives.
 
-    for (int i = 0; i < data.energyParamDerivExpressions.size(); i++)
-        data.energyParamDerivs[i] += switchValue*data.energyParamDerivExpressions[i].evaluate();
+    for (int i = 0; i < data.energyParamDerivs.size(); i++)
+        data.energyParamDerivs[i] += switchValue*values[i+2];
 }
 
 void CpuCustomNonbondedForce::getDeltaR(const fvec4& posI, const fvec4& posJ, fvec4& deltaR, float& r2, const fvec4& boxSize, const fvec4& invBoxSize) const {
@@ -29,9 +29,12 @@ using namespace OpenMM;
 
 CpuCustomNonbondedForce* createCpuCustomNonbondedForceVec4(ThreadPool& threads, const CpuNeighborList& neighbors);
 CpuCustomNonbondedForce* createCpuCustomNonbondedForceAvx(ThreadPool& threads, const CpuNeighborList& neighbors);
+CpuCustomNonbondedForce* createCpuCustomNonbondedForceAvx512(ThreadPool& threads, const CpuNeighborList& neighbors);
 
 CpuCustomNonbondedForce* OpenMM::createCpuCustomNonbondedForce(ThreadPool& threads, const CpuNeighborList& neighbors) {
-    if (isAvxSupported())
+    if (isAvx512Supported())
+        return createCpuCustomNonbondedForceAvx512(threads, neighbors);
+    else if (isAvxSupported())
         return createCpuCustomNonbondedForceAvx(threads, neighbors);
     else
         return createCpuCustomNonbondedForceVec4(threads, neighbors);
@@ -0,0 +1,67 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "CpuForceRegions.h"
+#include "openmm/internal/vectorize.h"
+#include <algorithm>
+
+using namespace OpenMM;
+using namespace std;
+
+CpuForceRegions::CpuForceRegions(int numParticles, int numThreads) : numParticles(numParticles) {
+    numTiles = (numParticles+TileSize-1)/TileSize;
+
+    // The buffers start out zeroed, so nothing needs to be cleared before the first evaluation.
+
+    written.resize(numThreads, vector<char>(numTiles, 0));
+}
+
+void CpuForceRegions::markAll(int threadIndex) {
+    fill(written[threadIndex].begin(), written[threadIndex].end(), 1);
+}
+
+void CpuForceRegions::markAll() {
+    for (int i = 0; i < written.size(); i++)
+        markAll(i);
+}
+
+void CpuForceRegions::clear(int threadIndex, AlignedArray<float>& forces) {
+    vector<char>& flags = written[threadIndex];
+    fvec4 zero(0.0f);
+    for (int tile = 0; tile < numTiles; tile++) {
+        if (flags[tile]) {
+            int end = min((tile+1)*TileSize, numParticles);
+            for (int i = tile*TileSize; i < end; i++)
+                zero.store(&forces[4*i]);
+            flags[tile] = 0;
+        }
+    }
+}
@@ -121,6 +121,7 @@ double CpuGayBerneForce::calculateForce(const vector<Vec3>& positions, std::vect
     ThreadPool& threads = data.threads;
     int numThreads = threads.getNumThreads();
     this->positions = &positions[0];
+    this->atomOrder = (data.particleReordering ? &data.atomOrder[0] : NULL);
     this->threadForce = &threadForce;
     this->boxVectors = boxVectors;
     threadEnergy.resize(numThreads);
@@ -191,12 +192,14 @@ void CpuGayBerneForce::threadComputeForce(ThreadPool& threads, int threadIndex,
             const vector<int>& neighbors = neighborList->getBlockNeighbors(blockIndex);
             const auto& exclusions = neighborList->getBlockExclusions(blockIndex);
             for (int i = 0; i < (int) neighbors.size(); i++) {
-                int first = neighbors[i];
+                // If particles are being reordered, the neighbor list refers to them by their position in posq.
+
+                int first = (atomOrder == NULL ? neighbors[i] : atomOrder[neighbors[i]]);
                 if (particles[first].sqrtEpsilon == 0.0f)
                     continue;
                 for (int k = 0; k < blockSize; k++) {
                     if ((exclusions[i] & (1<<k)) == 0) {
-                        int second = blockAtom[k];
+                        int second = (atomOrder == NULL ? blockAtom[k] : atomOrder[blockAtom[k]]);
                         if (particles[second].sqrtEpsilon == 0.0f)
                             continue;
                         double sigma = particles[first].sigmaOver2+particles[second].sigmaOver2;
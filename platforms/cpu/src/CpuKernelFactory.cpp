@@ -41,6 +41,22 @@ KernelImpl* CpuKernelFactory::createKernelImpl(std::string name, const Platform&
     CpuPlatform::PlatformData& data = CpuPlatform::getPlatformData(context);
     if (name == CalcForcesAndEnergyKernel::Name())
         return new CpuCalcForcesAndEnergyKernel(name, platform, data, context);
+    if (name == IntegrateLangevinMiddleStepKernel::Name())
+        return new CpuIntegrateLangevinMiddleStepKernel(name, platform, data);
+    if (name == IntegrateVerletStepKernel::Name())
+        return new CpuIntegrateVerletStepKernel(name, platform, data);
+    if (name == IntegrateNoseHooverStepKernel::Name())
+        return new CpuIntegrateNoseHooverStepKernel(name, platform, data, context);
+    if (name == IntegrateBrownianStepKernel::Name())
+        return new CpuIntegrateBrownianStepKernel(name, platform, data);
+    if (name == IntegrateVariableLangevinStepKernel::Name())
+        return new CpuIntegrateVariableLangevinStepKernel(name, platform, data);
+    if (name == IntegrateVariableVerletStepKernel::Name())
+        return new CpuIntegrateVariableVerletStepKernel(name, platform, data);
+    if (name == IntegrateCustomStepKernel::Name())
+        return new CpuIntegrateCustomStepKernel(name, platform, data);
+    if (name == CalcHarmonicBondForceKernel::Name())
+        return new CpuCalcHarmonicBondForceKernel(name, platform, data);
     if (name == CalcHarmonicAngleForceKernel::Name())
         return new CpuCalcHarmonicAngleForceKernel(name, platform, data);
     if (name == CalcPeriodicTorsionForceKernel::Name())
@@ -53,13 +69,17 @@ KernelImpl* CpuKernelFactory::createKernelImpl(std::string name, const Platform&
         return new CpuCalcCustomNonbondedForceKernel(name, platform, data);
     if (name == CalcCustomManyParticleForceKernel::Name())
         return new CpuCalcCustomManyParticleForceKernel(name, platform, data);
+    if (name == CalcCustomHbondForceKernel::Name())
+        return new CpuCalcCustomHbondForceKernel(name, platform, data);
+    if (name == CalcCustomCompoundBondForceKernel::Name())
+        return new CpuCalcCustomCompoundBondForceKernel(name, platform, data);
+    if (name == CalcCustomCentroidBondForceKernel::Name())
+        return new CpuCalcCustomCentroidBondForceKernel(name, platform, data);
     if (name == CalcGBSAOBCForceKernel::Name())
         return new CpuCalcGBSAOBCForceKernel(name, platform, data);
     if (name == CalcCustomGBForceKernel::Name())
         return new CpuCalcCustomGBForceKernel(name, platform, data);
     if (name == CalcGayBerneForceKernel::Name())
         return new CpuCalcGayBerneForceKernel(name, platform, data);
-    if (name == IntegrateLangevinMiddleStepKernel::Name())
-        return new CpuIntegrateLangevinMiddleStepKernel(name, platform, data);
     throw OpenMMException((std::string("Tried to create kernel with illegal kernel name '") + name + "'").c_str());
 }
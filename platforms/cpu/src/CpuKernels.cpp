@@ -30,19 +30,20 @@
  * -------------------------------------------------------------------------- */
 
 #include "CpuKernels.h"
-#include "ReferenceAngleBondIxn.h"
 #include "ReferenceBondForce.h"
 #include "ReferenceConstraints.h"
 #include "ReferenceKernelFactory.h"
 #include "ReferenceKernels.h"
 #include "ReferenceLJCoulomb14.h"
-#include "ReferenceProperDihedralBond.h"
-#include "ReferenceRbDihedralBond.h"
+#include "ReferencePointFunctions.h"
 #include "ReferenceTabulatedFunction.h"
+#include "SimTKOpenMMUtilities.h"
 #include "openmm/Context.h"
 #include "openmm/OpenMMException.h"
 #include "openmm/Vec3.h"
 #include "openmm/internal/ContextImpl.h"
+#include "openmm/internal/CustomCentroidBondForceImpl.h"
+#include "openmm/internal/CustomCompoundBondForceImpl.h"
 #include "openmm/internal/NonbondedForceImpl.h"
 #include "openmm/internal/vectorize.h"
 #include "lepton/CompiledExpression.h"
@@ -153,8 +154,14 @@ static void copyChargesToPosq(ContextImpl& context, const vector<float>& charges
         return;
     data.currentPosqIndex = index;
     AlignedArray<float>& posq = data.posq;
-    for (int i = 0; i < charges.size(); i++)
-        posq[4*i+3] = charges[i];
+    if (data.particleReordering) {
+        for (int i = 0; i < charges.size(); i++)
+            posq[4*i+3] = charges[data.atomOrder[i]];
+    }
+    else {
+        for (int i = 0; i < charges.size(); i++)
+            posq[4*i+3] = charges[i];
+    }
 }
 
 CpuCalcForcesAndEnergyKernel::CpuCalcForcesAndEnergyKernel(std::string name, const Platform& platform, CpuPlatform::PlatformData& data, ContextImpl& context) :
@@ -168,10 +175,16 @@ CpuCalcForcesAndEnergyKernel::CpuCalcForcesAndEnergyKernel(std::string name, con
 void CpuCalcForcesAndEnergyKernel::initialize(const System& system) {
     referenceKernel.getAs<ReferenceCalcForcesAndEnergyKernel>().initialize(system);
     lastPositions.resize(system.getNumParticles(), Vec3(1e10, 1e10, 1e10));
+    lastPrunePositions.resize(system.getNumParticles(), Vec3(1e10, 1e10, 1e10));
 }
 
 void CpuCalcForcesAndEnergyKernel::beginComputation(ContextImpl& context, bool includeForce, bool includeEnergy, int groups) {
     referenceKernel.getAs<ReferenceCalcForcesAndEnergyKernel>().beginComputation(context, includeForce, includeEnergy, groups);
+
+    // If a previous evaluation was interrupted by an exception, let any tasks it left queued finish, then
+    // forget about them.
+
+    data.discardConcurrentForces();
     
     // Convert positions to single precision and clear the forces.
 
@@ -181,6 +194,7 @@ void CpuCalcForcesAndEnergyKernel::beginComputation(ContextImpl& context, bool i
         // Convert the positions to single precision and apply periodic boundary conditions
 
         AlignedArray<float>& posq = data.posq;
+        const vector<int>& atomOrder = data.atomOrder;
         vector<Vec3>& posData = extractPositions(context);
         Vec3* boxVectors = extractBoxVectors(context);
         double boxSize[3] = {boxVectors[0][0], boxVectors[1][1], boxVectors[2][2]};
@@ -193,7 +207,7 @@ void CpuCalcForcesAndEnergyKernel::beginComputation(ContextImpl& context, bool i
         if (data.isPeriodic) {
             if (triclinic) {
                 for (int i = start; i < end; i++) {
-                    Vec3 pos = posData[i];
+                    Vec3 pos = posData[atomOrder[i]];
                     pos -= boxVectors[2]*floor(pos[2]*invBoxSize[2]);
                     pos -= boxVectors[1]*floor(pos[1]*invBoxSize[1]);
                     pos -= boxVectors[0]*floor(pos[0]*invBoxSize[0]);
@@ -205,7 +219,7 @@ void CpuCalcForcesAndEnergyKernel::beginComputation(ContextImpl& context, bool i
             else {
                 for (int i = start; i < end; i++) {
                     for (int j = 0; j < 3; j++) {
-                        double x = posData[i][j];
+                        double x = posData[atomOrder[i]][j];
                         double base = floor(x*invBoxSize[j])*boxSize[j];
                         posq[4*i+j] = (float) (x-base);
                     }
@@ -214,9 +228,9 @@ void CpuCalcForcesAndEnergyKernel::beginComputation(ContextImpl& context, bool i
         }
         else
             for (int i = start; i < end; i++) {
-                posq[4*i] = (float) posData[i][0];
-                posq[4*i+1] = (float) posData[i][1];
-                posq[4*i+2] = (float) posData[i][2];
+                posq[4*i] = (float) posData[atomOrder[i]][0];
+                posq[4*i+1] = (float) posData[atomOrder[i]][1];
+                posq[4*i+2] = (float) posData[atomOrder[i]][2];
             }
         
         // Check for invalid positions.
@@ -227,9 +241,13 @@ void CpuCalcForcesAndEnergyKernel::beginComputation(ContextImpl& context, bool i
 
         // Clear the forces.
 
-        fvec4 zero(0.0f);
-        for (int j = 0; j < numParticles; j++)
-            zero.store(&data.threadForce[threadIndex][j*4]);
+        if (data.forceRegions != NULL)
+            data.forceRegions->clear(threadIndex, data.threadForce[threadIndex]);
+        else {
+            fvec4 zero(0.0f);
+            for (int j = 0; j < numParticles; j++)
+                zero.store(&data.threadForce[threadIndex][j*4]);
+        }
     });
     data.threads.waitForThreads();
     if (!positionsValid)
@@ -278,13 +296,110 @@ void CpuCalcForcesAndEnergyKernel::beginComputation(ContextImpl& context, bool i
                 }
         }
         if (needRecompute) {
-            data.neighborList->computeNeighborList(numParticles, data.posq, data.exclusions, extractBoxVectors(context), data.isPeriodic, data.paddedCutoff, data.threads);
+            if (data.verletBufferTolerance > 0.0)
+                data.paddedCutoff = data.cutoff+estimateBufferSize(context);
+            data.reorderParticles();
+            const vector<set<int> >& exclusions = (data.particleReordering ? data.orderedExclusions : data.exclusions);
+            data.neighborList->computeNeighborList(numParticles, data.posq, exclusions, extractBoxVectors(context), data.isPeriodic, data.paddedCutoff, data.threads);
             lastPositions = posData;
         }
+        if (data.neighborListPruning) {
+            // Prune pairs that are beyond the cutoff plus a small margin.  The pruned list remains valid until
+            // some particle moves more than half the margin.
+
+            double margin = 0.2*(data.paddedCutoff-data.cutoff);
+            bool needPrune = needRecompute;
+            double pruneCutoff2 = 0.25*margin*margin;
+            for (int i = 0; i < numParticles && !needPrune; i++) {
+                Vec3 delta = posData[i]-lastPrunePositions[i];
+                if (delta.dot(delta) > pruneCutoff2)
+                    needPrune = true;
+            }
+            if (needPrune) {
+                data.neighborList->pruneNeighborList(data.posq, extractBoxVectors(context), data.cutoff+margin, data.threads);
+                lastPrunePositions = posData;
+            }
+        }
+    }
+}
+
+double CpuCalcForcesAndEnergyKernel::estimateBufferSize(ContextImpl& context) {
+    // Compute the instantaneous temperature.
+
+    const System& system = context.getSystem();
+    int numParticles = system.getNumParticles();
+    vector<Vec3>& velData = extractVelocities(context);
+    double kineticEnergy = 0.0;
+    int dof = 0;
+    for (int i = 0; i < numParticles; i++) {
+        double mass = system.getParticleMass(i);
+        if (mass != 0.0) {
+            kineticEnergy += 0.5*mass*velData[i].dot(velData[i]);
+            dof += 3;
+        }
+    }
+    for (int i = 0; i < system.getNumConstraints(); i++) {
+        int p1, p2;
+        double distance;
+        system.getConstraintParameters(i, p1, p2, distance);
+        if (system.getParticleMass(p1) != 0.0 || system.getParticleMass(p2) != 0.0)
+            dof--;
+    }
+    double stepSize = context.getIntegrator().getStepSize();
+    if (dof <= 0 || kineticEnergy == 0.0 || stepSize <= 0.0)
+        return data.requestedPadding;
+    double kT = 2.0*kineticEnergy/dof;
+
+    // Over the target interval, a particle moves a distance of about |v|*t, where each component of v is
+    // normally distributed with variance kT/m.  Find the smallest buffer for which the expected number of
+    // particles moving more than half the buffer is within the tolerance.  With pruning, the inner list
+    // absorbs the cost of a larger buffer, so a longer interval is used.
+
+    const int targetSteps = (data.neighborListPruning ? 100 : 20);
+    double time = targetSteps*stepSize;
+    vector<double> width;
+    for (int i = 0; i < numParticles; i++) {
+        double mass = system.getParticleMass(i);
+        if (mass != 0.0)
+            width.push_back(sqrt(kT/mass)*time);
+    }
+    auto expectedMoved = [&] (double buffer) {
+        double sum = 0.0;
+        for (double w : width) {
+            double x = 0.5*buffer/w;
+            sum += erfc(x*sqrt(0.5)) + sqrt(2.0/M_PI)*x*exp(-0.5*x*x);
+        }
+        return sum;
+    };
+    double minBuffer = 0.05*data.cutoff, maxBuffer = data.cutoff;
+    if (expectedMoved(minBuffer) <= data.verletBufferTolerance)
+        return minBuffer;
+    if (expectedMoved(maxBuffer) > data.verletBufferTolerance)
+        return maxBuffer;
+    for (int i = 0; i < 30; i++) {
+        double buffer = 0.5*(minBuffer+maxBuffer);
+        if (expectedMoved(buffer) > data.verletBufferTolerance)
+            minBuffer = buffer;
+        else
+            maxBuffer = buffer;
     }
+    return maxBuffer;
+}
+
+void CpuCalcForcesAndEnergyKernel::sumThreadForces(int atom, const vector<int>& threadIndices, Vec3& force) {
+    fvec4 f(0.0f);
+    for (int j : threadIndices)
+        f += fvec4(&data.threadForce[j][4*atom]);
+    force[0] += f[0];
+    force[1] += f[1];
+    force[2] += f[2];
 }
 
 double CpuCalcForcesAndEnergyKernel::finishComputation(ContextImpl& context, bool includeForce, bool includeEnergy, int groups, bool& valid) {
+    // Wait for any forces that were being computed in the background.
+
+    data.finishConcurrentForces(extractForces(context));
+
     // Sum the forces from all the threads.
     
     data.threads.execute([&] (ThreadPool& threads, int threadIndex) {
@@ -292,20 +407,101 @@ double CpuCalcForcesAndEnergyKernel::finishComputation(ContextImpl& context, boo
         
         int numParticles = context.getSystem().getNumParticles();
         int numThreads = threads.getNumThreads();
-        int start = threadIndex*numParticles/numThreads;
-        int end = (threadIndex+1)*numParticles/numThreads;
         vector<Vec3>& forceData = extractForces(context);
-        for (int i = start; i < end; i++) {
-            fvec4 f(0.0f);
-            for (int j = 0; j < numThreads; j++)
-                f += fvec4(&data.threadForce[j][4*i]);
-            forceData[i][0] += f[0];
-            forceData[i][1] += f[1];
-            forceData[i][2] += f[2];
+        const vector<int>& atomOrder = data.atomOrder;
+        if (data.forceRegions != NULL) {
+            // Only read the tiles of each buffer that were actually written to.
+
+            const CpuForceRegions& regions = *data.forceRegions;
+            int numTiles = regions.getNumTiles();
+            int startTile = threadIndex*numTiles/numThreads;
+            int endTile = (threadIndex+1)*numTiles/numThreads;
+            vector<int> writers;
+            for (int tile = startTile; tile < endTile; tile++) {
+                writers.clear();
+                for (int j = 0; j < numThreads; j++)
+                    if (regions.isWritten(j, tile))
+                        writers.push_back(j);
+                if (writers.size() == 0)
+                    continue;
+                int start = tile*CpuForceRegions::TileSize;
+                int end = min(start+CpuForceRegions::TileSize, numParticles);
+                for (int i = start; i < end; i++)
+                    sumThreadForces(i, writers, forceData[atomOrder[i]]);
+            }
+            return;
         }
+        vector<int> allThreads(numThreads);
+        for (int j = 0; j < numThreads; j++)
+            allThreads[j] = j;
+        int start = threadIndex*numParticles/numThreads;
+        int end = (threadIndex+1)*numParticles/numThreads;
+        for (int i = start; i < end; i++)
+            sumThreadForces(i, allThreads, forceData[atomOrder[i]]);
     });
     data.threads.waitForThreads();
-    return referenceKernel.getAs<ReferenceCalcForcesAndEnergyKernel>().finishComputation(context, includeForce, includeEnergy, groups, valid);
+    double energy = referenceKernel.getAs<ReferenceCalcForcesAndEnergyKernel>().finishComputation(context, includeForce, includeEnergy, groups, valid);
+    return energy;
+}
+
+CpuCalcHarmonicBondForceKernel::~CpuCalcHarmonicBondForceKernel() {
+    if (bondForce != NULL)
+        delete bondForce;
+}
+
+void CpuCalcHarmonicBondForceKernel::initialize(const System& system, const HarmonicBondForce& force) {
+    numBonds = force.getNumBonds();
+    bondIndexArray.resize(numBonds, vector<int>(2));
+    bondParamArray.resize(numBonds, vector<double>(2));
+    for (int i = 0; i < numBonds; ++i) {
+        int particle1, particle2;
+        double length, k;
+        force.getBondParameters(i, particle1, particle2, length, k);
+        bondIndexArray[i][0] = particle1;
+        bondIndexArray[i][1] = particle2;
+        bondParamArray[i][0] = length;
+        bondParamArray[i][1] = k;
+    }
+    bondForce = createCpuVectorBondForce(CpuVectorBondForce::HarmonicBond);
+    bondForce->initialize(system.getNumParticles(), bondIndexArray, data.threads);
+    forceBufferIndex = data.addConcurrentForce();
+    bondForce->setParameters(bondParamArray);
+    usePeriodic = force.usesPeriodicBoundaryConditions();
+}
+
+double CpuCalcHarmonicBondForceKernel::execute(ContextImpl& context, bool includeForces, bool includeEnergy) {
+    // The forces are computed in the background and added to the total in CpuCalcForcesAndEnergyKernel::finishComputation().
+    // If the energy was requested, wait for it so it can be returned.
+
+    vector<Vec3>& posData = extractPositions(context);
+    vector<Vec3>& forceBuffer = data.beginConcurrentForce(forceBufferIndex);
+    energy = 0.0;
+    ThreadPool::TaskHandle task = bondForce->addForceTasks(posData, forceBuffer, includeEnergy ? &energy : NULL, usePeriodic ? extractBoxVectors(context) : NULL);
+    data.endConcurrentForce(task, includeEnergy);
+    return energy;
+}
+
+void CpuCalcHarmonicBondForceKernel::copyParametersToContext(ContextImpl& context, const HarmonicBondForce& force) {
+    if (numBonds != force.getNumBonds())
+        throw OpenMMException("updateParametersInContext: The number of bonds has changed");
+
+    // Record the values.
+
+    for (int i = 0; i < numBonds; ++i) {
+        int particle1, particle2;
+        double length, k;
+        force.getBondParameters(i, particle1, particle2, length, k);
+        if (particle1 != bondIndexArray[i][0] || particle2 != bondIndexArray[i][1])
+            throw OpenMMException("updateParametersInContext: The set of particles in a bond has changed");
+        bondParamArray[i][0] = length;
+        bondParamArray[i][1] = k;
+    }
+    bondForce->setParameters(bondParamArray);
+}
+
+CpuCalcHarmonicAngleForceKernel::~CpuCalcHarmonicAngleForceKernel() {
+    if (bondForce != NULL)
+        delete bondForce;
 }
 
 void CpuCalcHarmonicAngleForceKernel::initialize(const System& system, const HarmonicAngleForce& force) {
@@ -322,18 +518,22 @@ void CpuCalcHarmonicAngleForceKernel::initialize(const System& system, const Har
         angleParamArray[i][0] = angle;
         angleParamArray[i][1] = k;
     }
-    bondForce.initialize(system.getNumParticles(), numAngles, 3, angleIndexArray, data.threads);
+    bondForce = createCpuVectorBondForce(CpuVectorBondForce::HarmonicAngle);
+    bondForce->initialize(system.getNumParticles(), angleIndexArray, data.threads);
+    forceBufferIndex = data.addConcurrentForce();
+    bondForce->setParameters(angleParamArray);
     usePeriodic = force.usesPeriodicBoundaryConditions();
 }
 
 double CpuCalcHarmonicAngleForceKernel::execute(ContextImpl& context, bool includeForces, bool includeEnergy) {
+    // The forces are computed in the background and added to the total in CpuCalcForcesAndEnergyKernel::finishComputation().
+    // If the energy was requested, wait for it so it can be returned.
+
     vector<Vec3>& posData = extractPositions(context);
-    vector<Vec3>& forceData = extractForces(context);
-    double energy = 0;
-    ReferenceAngleBondIxn angleBond;
-    if (usePeriodic)
-        angleBond.setPeriodic(extractBoxVectors(context));
-    bondForce.calculateForce(posData, angleParamArray, forceData, includeEnergy ? &energy : NULL, angleBond);
+    vector<Vec3>& forceBuffer = data.beginConcurrentForce(forceBufferIndex);
+    energy = 0.0;
+    ThreadPool::TaskHandle task = bondForce->addForceTasks(posData, forceBuffer, includeEnergy ? &energy : NULL, usePeriodic ? extractBoxVectors(context) : NULL);
+    data.endConcurrentForce(task, includeEnergy);
     return energy;
 }
 
@@ -352,6 +552,12 @@ void CpuCalcHarmonicAngleForceKernel::copyParametersToContext(ContextImpl& conte
         angleParamArray[i][0] = angle;
         angleParamArray[i][1] = k;
     }
+    bondForce->setParameters(angleParamArray);
+}
+
+CpuCalcPeriodicTorsionForceKernel::~CpuCalcPeriodicTorsionForceKernel() {
+    if (bondForce != NULL)
+        delete bondForce;
 }
 
 void CpuCalcPeriodicTorsionForceKernel::initialize(const System& system, const PeriodicTorsionForce& force) {
@@ -370,18 +576,22 @@ void CpuCalcPeriodicTorsionForceKernel::initialize(const System& system, const P
         torsionParamArray[i][1] = phase;
         torsionParamArray[i][2] = periodicity;
     }
-    bondForce.initialize(system.getNumParticles(), numTorsions, 4, torsionIndexArray, data.threads);
+    bondForce = createCpuVectorBondForce(CpuVectorBondForce::PeriodicTorsion);
+    bondForce->initialize(system.getNumParticles(), torsionIndexArray, data.threads);
+    forceBufferIndex = data.addConcurrentForce();
+    bondForce->setParameters(torsionParamArray);
     usePeriodic = force.usesPeriodicBoundaryConditions();
 }
 
 double CpuCalcPeriodicTorsionForceKernel::execute(ContextImpl& context, bool includeForces, bool includeEnergy) {
+    // The forces are computed in the background and added to the total in CpuCalcForcesAndEnergyKernel::finishComputation().
+    // If the energy was requested, wait for it so it can be returned.
+
     vector<Vec3>& posData = extractPositions(context);
-    vector<Vec3>& forceData = extractForces(context);
-    double energy = 0;
-    ReferenceProperDihedralBond periodicTorsionBond;
-    if (usePeriodic)
-        periodicTorsionBond.setPeriodic(extractBoxVectors(context));
-    bondForce.calculateForce(posData, torsionParamArray, forceData, includeEnergy ? &energy : NULL, periodicTorsionBond);
+    vector<Vec3>& forceBuffer = data.beginConcurrentForce(forceBufferIndex);
+    energy = 0.0;
+    ThreadPool::TaskHandle task = bondForce->addForceTasks(posData, forceBuffer, includeEnergy ? &energy : NULL, usePeriodic ? extractBoxVectors(context) : NULL);
+    data.endConcurrentForce(task, includeEnergy);
     return energy;
 }
 
@@ -401,6 +611,12 @@ void CpuCalcPeriodicTorsionForceKernel::copyParametersToContext(ContextImpl& con
         torsionParamArray[i][1] = phase;
         torsionParamArray[i][2] = periodicity;
     }
+    bondForce->setParameters(torsionParamArray);
+}
+
+CpuCalcRBTorsionForceKernel::~CpuCalcRBTorsionForceKernel() {
+    if (bondForce != NULL)
+        delete bondForce;
 }
 
 void CpuCalcRBTorsionForceKernel::initialize(const System& system, const RBTorsionForce& force) {
@@ -422,18 +638,22 @@ void CpuCalcRBTorsionForceKernel::initialize(const System& system, const RBTorsi
         torsionParamArray[i][4] = c4;
         torsionParamArray[i][5] = c5;
     }
-    bondForce.initialize(system.getNumParticles(), numTorsions, 4, torsionIndexArray, data.threads);
+    bondForce = createCpuVectorBondForce(CpuVectorBondForce::RBTorsion);
+    bondForce->initialize(system.getNumParticles(), torsionIndexArray, data.threads);
+    forceBufferIndex = data.addConcurrentForce();
+    bondForce->setParameters(torsionParamArray);
     usePeriodic = force.usesPeriodicBoundaryConditions();
 }
 
 double CpuCalcRBTorsionForceKernel::execute(ContextImpl& context, bool includeForces, bool includeEnergy) {
+    // The forces are computed in the background and added to the total in CpuCalcForcesAndEnergyKernel::finishComputation().
+    // If the energy was requested, wait for it so it can be returned.
+
     vector<Vec3>& posData = extractPositions(context);
-    vector<Vec3>& forceData = extractForces(context);
-    double energy = 0;
-    ReferenceRbDihedralBond rbTorsionBond;
-    if (usePeriodic)
-        rbTorsionBond.setPeriodic(extractBoxVectors(context));
-    bondForce.calculateForce(posData, torsionParamArray, forceData, includeEnergy ? &energy : NULL, rbTorsionBond);
+    vector<Vec3>& forceBuffer = data.beginConcurrentForce(forceBufferIndex);
+    energy = 0.0;
+    ThreadPool::TaskHandle task = bondForce->addForceTasks(posData, forceBuffer, includeEnergy ? &energy : NULL, usePeriodic ? extractBoxVectors(context) : NULL);
+    data.endConcurrentForce(task, includeEnergy);
     return energy;
 }
 
@@ -456,6 +676,7 @@ void CpuCalcRBTorsionForceKernel::copyParametersToContext(ContextImpl& context,
         torsionParamArray[i][4] = c4;
         torsionParamArray[i][5] = c5;
     }
+    bondForce->setParameters(torsionParamArray);
 }
 
 class CpuCalcNonbondedForceKernel::PmeIO : public CalcPmeReciprocalForceKernel::IO {
@@ -481,7 +702,7 @@ private:
 CpuNonbondedForce* createCpuNonbondedForceVec(const CpuNeighborList& neighbors);
 
 CpuCalcNonbondedForceKernel::CpuCalcNonbondedForceKernel(string name, const Platform& platform, CpuPlatform::PlatformData& data) : CalcNonbondedForceKernel(name, platform),
-        data(data), hasInitializedPme(false), hasInitializedDispersionPme(false), nonbonded(NULL) {
+        data(data), orderedParamsVersion(-1), hasInitializedPme(false), hasInitializedDispersionPme(false), nonbonded(NULL) {
 }
 
 CpuCalcNonbondedForceKernel::~CpuCalcNonbondedForceKernel() {
@@ -622,6 +843,7 @@ void CpuCalcNonbondedForceKernel::initialize(const System& system, const Nonbond
         dispersionCoefficient = 0.0;
     data.isPeriodic |= (nonbondedMethod == CutoffPeriodic || nonbondedMethod == Ewald || nonbondedMethod == PME || nonbondedMethod == LJPME);
     nonbonded = createCpuNonbondedForceVec(*data.neighborList);
+    nonbonded->setForceRegions(data.forceRegions);
 }
 
 double CpuCalcNonbondedForceKernel::execute(ContextImpl& context, bool includeForces, bool includeEnergy, bool includeDirect, bool includeReciprocal) {
@@ -686,24 +908,77 @@ double CpuCalcNonbondedForceKernel::execute(ContextImpl& context, bool includeFo
         nonbonded->setUsePME(ewaldAlpha, gridSize);
         nonbonded->setUseLJPME(ewaldDispersionAlpha, dispersionGridSize);
     }
-    double nonbondedEnergy = 0;
+
+    // If particles are being reordered, the per-particle values need to be in the same order as posq.
+
+    vector<Vec3>* positions = &posData;
+    vector<pair<float, float> >* params = &particleParams;
+    vector<float>* c6 = &C6params;
+    vector<set<int> >* excl = &exclusions;
+    if (data.particleReordering) {
+        if (orderedParamsVersion != data.atomOrderVersion) {
+            data.reorderParticleArray(particleParams, orderedParticleParams);
+            data.reorderParticleArray(C6params, orderedC6params);
+            data.reorderExclusions(exclusions, orderedExclusions);
+            orderedParamsVersion = data.atomOrderVersion;
+        }
+        if (ewald || pme || ljpme) {
+            data.reorderParticleArray(posData, orderedPositions);
+            positions = &orderedPositions;
+        }
+        params = &orderedParticleParams;
+        c6 = &orderedC6params;
+        excl = &orderedExclusions;
+    }
+    // The reciprocal space part does not depend on the direct space part, so if concurrent forces are enabled,
+    // compute both at once.  The optimized PME kernel runs on its own threads in the background, while the
+    // standard implementation is queued as a task that runs alongside the direct space tasks.  Either way it
+    // writes to a different buffer than the direct space part, and the energies are added in the same order.
+
+    double nonbondedEnergy = 0, reciprocalEnergy = 0;
+    bool concurrentReciprocal = (includeReciprocal && includeDirect && data.concurrentForces);
+    PmeIO io(&posq[0], &data.threadForce[0][0], numParticles);
+    Vec3 periodicBoxVectors[3] = {boxVectors[0], boxVectors[1], boxVectors[2]};
+    auto computeReciprocal = [&] (ThreadPool& threads, int threadIndex) {
+        if (data.particleReordering) {
+            orderedForces.assign(numParticles, Vec3());
+            nonbonded->calculateReciprocalIxn(numParticles, &posq[0], *positions, *params, *c6, *excl, orderedForces, includeEnergy ? &reciprocalEnergy : NULL);
+            for (int i = 0; i < numParticles; i++)
+                forceData[data.atomOrder[i]] += orderedForces[i];
+        }
+        else
+            nonbonded->calculateReciprocalIxn(numParticles, &posq[0], posData, particleParams, C6params, exclusions, forceData, includeEnergy ? &reciprocalEnergy : NULL);
+    };
+    if (concurrentReciprocal) {
+        if (useOptimizedPme)
+            optimizedPme.getAs<CalcPmeReciprocalForceKernel>().beginComputation(io, periodicBoxVectors, includeEnergy);
+        else
+            data.threads.addTask(computeReciprocal);
+    }
     if (includeDirect)
-        nonbonded->calculateDirectIxn(numParticles, &posq[0], posData, particleParams, C6params, exclusions, data.threadForce, includeEnergy ? &nonbondedEnergy : NULL, data.threads);
+        nonbonded->calculateDirectIxn(numParticles, &posq[0], *positions, *params, *c6, *excl, data.threadForce, includeEnergy ? &nonbondedEnergy : NULL, data.threads);
     if (includeReciprocal) {
         if (useOptimizedPme) {
-            PmeIO io(&posq[0], &data.threadForce[0][0], numParticles);
-            Vec3 periodicBoxVectors[3] = {boxVectors[0], boxVectors[1], boxVectors[2]};
-            optimizedPme.getAs<CalcPmeReciprocalForceKernel>().beginComputation(io, periodicBoxVectors, includeEnergy);
-            nonbondedEnergy += optimizedPme.getAs<CalcPmeReciprocalForceKernel>().finishComputation(io);
+            if (data.forceRegions != NULL)
+                data.forceRegions->markAll(0);
+            if (!concurrentReciprocal)
+                optimizedPme.getAs<CalcPmeReciprocalForceKernel>().beginComputation(io, periodicBoxVectors, includeEnergy);
+            reciprocalEnergy += optimizedPme.getAs<CalcPmeReciprocalForceKernel>().finishComputation(io);
             if (nonbondedMethod == LJPME) {
+                // The dispersion term needs the C6 parameters in posq, so it cannot start until everything that
+                // reads the charges has finished.
+
                 copyChargesToPosq(context, C6params, ljPosqIndex);
                 optimizedDispersionPme.getAs<CalcDispersionPmeReciprocalForceKernel>().beginComputation(io, periodicBoxVectors, includeEnergy);
-                nonbondedEnergy += optimizedDispersionPme.getAs<CalcDispersionPmeReciprocalForceKernel>().finishComputation(io);
+                reciprocalEnergy += optimizedDispersionPme.getAs<CalcDispersionPmeReciprocalForceKernel>().finishComputation(io);
             }
         }
+        else if (concurrentReciprocal)
+            data.threads.executeTasks();
         else
-            nonbonded->calculateReciprocalIxn(numParticles, &posq[0], posData, particleParams, C6params, exclusions, forceData, includeEnergy ? &nonbondedEnergy : NULL);
+            computeReciprocal(data.threads, -1);
     }
+    nonbondedEnergy += reciprocalEnergy;
     energy += nonbondedEnergy;
     if (includeDirect) {
         ReferenceLJCoulomb14 nonbonded14;
@@ -829,6 +1104,7 @@ void CpuCalcNonbondedForceKernel::computeParameters(ContextImpl& context, bool o
             ewaldSelfEnergy = 0.0;
         chargePosqIndex = data.requestPosqIndex();
         ljPosqIndex = data.requestPosqIndex();
+        orderedParamsVersion = -1;
     }
 
     // Compute exception parameters.
@@ -852,7 +1128,7 @@ void CpuCalcNonbondedForceKernel::computeParameters(ContextImpl& context, bool o
 }
 
 CpuCalcCustomNonbondedForceKernel::CpuCalcCustomNonbondedForceKernel(string name, const Platform& platform, CpuPlatform::PlatformData& data) :
-            CalcCustomNonbondedForceKernel(name, platform), data(data), forceCopy(NULL), nonbonded(NULL) {
+            CalcCustomNonbondedForceKernel(name, platform), data(data), orderedParamsVersion(-1), forceCopy(NULL), nonbonded(NULL) {
 }
 
 CpuCalcCustomNonbondedForceKernel::~CpuCalcCustomNonbondedForceKernel() {
@@ -981,6 +1257,8 @@ void CpuCalcCustomNonbondedForceKernel::createInteraction(const CustomNonbondedF
             computedValueNames, computedValueExpressions);
     if (interactionGroups.size() > 0)
         nonbonded->setInteractionGroups(interactionGroups);
+    nonbonded->setForceRegions(data.forceRegions);
+    nonbonded->setUseTables(data.tabulatedNonbonded);
 }
 
 double CpuCalcCustomNonbondedForceKernel::execute(ContextImpl& context, bool includeForces, bool includeEnergy) {
@@ -1007,7 +1285,23 @@ double CpuCalcCustomNonbondedForceKernel::execute(ContextImpl& context, bool inc
     if (useSwitchingFunction)
         nonbonded->setUseSwitchingFunction(switchingDistance);
     vector<double> energyParamDerivValues(energyParamDerivNames.size()+1, 0.0);
-    nonbonded->calculatePairIxn(numParticles, &data.posq[0], posData, particleParamArray, globalParamValues, data.threadForce, includeForces, includeEnergy, energy, &energyParamDerivValues[0]);
+    if (!data.particleReordering)
+        nonbonded->calculatePairIxn(numParticles, &data.posq[0], posData, particleParamArray, globalParamValues, data.threadForce, includeForces, includeEnergy, energy, &energyParamDerivValues[0]);
+    else if (interactionGroups.size() > 0) {
+        // Interaction groups are specified by atom index, so work in the original order.
+
+        data.beginUnorderedComputation();
+        nonbonded->calculatePairIxn(numParticles, &data.unorderedPosq[0], posData, particleParamArray, globalParamValues, data.unorderedForce, includeForces, includeEnergy, energy, &energyParamDerivValues[0]);
+        data.endUnorderedComputation();
+    }
+    else {
+        if (orderedParamsVersion != data.atomOrderVersion) {
+            data.reorderParticleArray(particleParamArray, orderedParamArray);
+            orderedParamsVersion = data.atomOrderVersion;
+            nonbonded->invalidateParticleTypes();
+        }
+        nonbonded->calculatePairIxn(numParticles, &data.posq[0], posData, orderedParamArray, globalParamValues, data.threadForce, includeForces, includeEnergy, energy, &energyParamDerivValues[0]);
+    }
     map<string, double>& energyParamDerivs = extractEnergyParameterDerivatives(context);
     for (int i = 0; i < energyParamDerivNames.size(); i++)
         energyParamDerivs[energyParamDerivNames[i]] += energyParamDerivValues[i];
@@ -1042,6 +1336,8 @@ void CpuCalcCustomNonbondedForceKernel::copyParametersToContext(ContextImpl& con
         for (int j = 0; j < numParameters; j++)
             particleParamArray[i][j] = parameters[j];
     }
+    orderedParamsVersion = -1;
+    nonbonded->invalidateParticleTypes();
     
     // If necessary, recompute the long range correction.
     
@@ -1100,8 +1396,14 @@ double CpuCalcGBSAOBCForceKernel::execute(ContextImpl& context, bool includeForc
         float floatBoxSize[3] = {(float) boxSize[0], (float) boxSize[1], (float) boxSize[2]};
         obc.setPeriodic(floatBoxSize);
     }
+    if (data.particleReordering && orderedParamsVersion != data.atomOrderVersion) {
+        data.reorderParticleArray(particleParams, orderedParticleParams);
+        obc.setParticleParameters(orderedParticleParams);
+        orderedParamsVersion = data.atomOrderVersion;
+    }
     double energy = 0.0;
     obc.computeForce(data.posq, data.threadForce, includeEnergy ? &energy : NULL, data.threads);
+    data.markAllThreadForces();
     return energy;
 }
 
@@ -1121,6 +1423,7 @@ void CpuCalcGBSAOBCForceKernel::copyParametersToContext(ContextImpl& context, co
         particleParams[i] = make_pair((float) radius, (float) (scalingFactor*radius));
     }
     obc.setParticleParameters(particleParams);
+    orderedParamsVersion = -1;
 }
 
 CpuCalcCustomGBForceKernel::~CpuCalcCustomGBForceKernel() {
@@ -1194,7 +1497,6 @@ void CpuCalcCustomGBForceKernel::createInteraction(const CustomGBForce& force) {
     energyParamDerivNames.clear();
     vector<vector<Lepton::CompiledExpression> > valueDerivExpressions(force.getNumComputedValues());
     vector<vector<Lepton::CompiledExpression> > valueGradientExpressions(force.getNumComputedValues());
-    vector<vector<Lepton::CompiledExpression> > valueParamDerivExpressions(force.getNumComputedValues());
     vector<Lepton::CompiledExpression> valueExpressions;
     vector<Lepton::CompiledExpression> energyExpressions;
     set<string> particleVariables, pairVariables;
@@ -1214,7 +1516,7 @@ void CpuCalcCustomGBForceKernel::createInteraction(const CustomGBForce& force) {
         CustomGBForce::ComputationType type;
         force.getComputedValueParameters(i, name, expression, type);
         Lepton::ParsedExpression ex = Lepton::Parser::parse(expression, functions).optimize();
-        valueExpressions.push_back(ex.createCompiledExpression());
+        vector<Lepton::ParsedExpression> valueTerms(1, ex);
         valueTypes.push_back(type);
         valueNames.push_back(name);
         if (i == 0) {
@@ -1232,53 +1534,52 @@ void CpuCalcCustomGBForceKernel::createInteraction(const CustomGBForce& force) {
         for (int j = 0; j < force.getNumEnergyParameterDerivatives(); j++) {
             string param = force.getEnergyParameterDerivativeName(j);
             energyParamDerivNames.push_back(param);
-            valueParamDerivExpressions[i].push_back(ex.differentiate(param).createCompiledExpression());
+            valueTerms.push_back(ex.differentiate(param));
         }
+        valueExpressions.push_back(Lepton::CompiledExpression(valueTerms));
         particleVariables.insert(name);
         pairVariables.insert(name+"1");
         pairVariables.insert(name+"2");
     }
 
-    // Parse the expressions for energy terms.
+    // Parse the expressions for energy terms.  Each one is compiled together with all its derivatives,
+    // in the order expected by CpuCustomGBForce.
 
     energyTypes.clear();
-    vector<vector<Lepton::CompiledExpression> > energyDerivExpressions(force.getNumEnergyTerms());
-    vector<vector<Lepton::CompiledExpression> > energyGradientExpressions(force.getNumEnergyTerms());
-    vector<vector<Lepton::CompiledExpression> > energyParamDerivExpressions(force.getNumEnergyTerms());
     for (int i = 0; i < force.getNumEnergyTerms(); i++) {
         string expression;
         CustomGBForce::ComputationType type;
         force.getEnergyTermParameters(i, expression, type);
         Lepton::ParsedExpression ex = Lepton::Parser::parse(expression, functions).optimize();
-        energyExpressions.push_back(ex.createCompiledExpression());
+        vector<Lepton::ParsedExpression> energyTerms(1, ex);
         energyTypes.push_back(type);
-        if (type != CustomGBForce::SingleParticle)
-            energyDerivExpressions[i].push_back(ex.differentiate("r").createCompiledExpression());
-        for (int j = 0; j < force.getNumComputedValues(); j++) {
-            if (type == CustomGBForce::SingleParticle) {
-                energyDerivExpressions[i].push_back(ex.differentiate(valueNames[j]).createCompiledExpression());
-                energyGradientExpressions[i].push_back(ex.differentiate("x").createCompiledExpression());
-                energyGradientExpressions[i].push_back(ex.differentiate("y").createCompiledExpression());
-                energyGradientExpressions[i].push_back(ex.differentiate("z").createCompiledExpression());
-                validateVariables(ex.getRootNode(), particleVariables);
-            }
-            else {
-                energyDerivExpressions[i].push_back(ex.differentiate(valueNames[j]+"1").createCompiledExpression());
-                energyDerivExpressions[i].push_back(ex.differentiate(valueNames[j]+"2").createCompiledExpression());
-                validateVariables(ex.getRootNode(), pairVariables);
+        if (type == CustomGBForce::SingleParticle) {
+            for (int j = 0; j < force.getNumComputedValues(); j++)
+                energyTerms.push_back(ex.differentiate(valueNames[j]));
+            energyTerms.push_back(ex.differentiate("x"));
+            energyTerms.push_back(ex.differentiate("y"));
+            energyTerms.push_back(ex.differentiate("z"));
+            validateVariables(ex.getRootNode(), particleVariables);
+        }
+        else {
+            energyTerms.push_back(ex.differentiate("r"));
+            for (int j = 0; j < force.getNumComputedValues(); j++) {
+                energyTerms.push_back(ex.differentiate(valueNames[j]+"1"));
+                energyTerms.push_back(ex.differentiate(valueNames[j]+"2"));
             }
+            validateVariables(ex.getRootNode(), pairVariables);
         }
         for (int j = 0; j < force.getNumEnergyParameterDerivatives(); j++)
-            energyParamDerivExpressions[i].push_back(ex.differentiate(force.getEnergyParameterDerivativeName(j)).createCompiledExpression());
+            energyTerms.push_back(ex.differentiate(force.getEnergyParameterDerivativeName(j)));
+        energyExpressions.push_back(Lepton::CompiledExpression(energyTerms));
     }
 
     // Delete the custom functions.
 
     for (auto& function : functions)
         delete function.second;
-    ixn = new CpuCustomGBForce(numParticles, exclusions, valueExpressions, valueDerivExpressions, valueGradientExpressions, valueParamDerivExpressions,
-        valueNames, valueTypes, energyExpressions, energyDerivExpressions, energyGradientExpressions, energyParamDerivExpressions, energyTypes,
-        particleParameterNames, data.threads);
+    ixn = new CpuCustomGBForce(numParticles, exclusions, valueExpressions, valueDerivExpressions, valueGradientExpressions,
+        valueNames, valueTypes, energyExpressions, energyTypes, force.getNumEnergyParameterDerivatives(), particleParameterNames, data.threads);
 }
 
 double CpuCalcCustomGBForceKernel::execute(ContextImpl& context, bool includeForces, bool includeEnergy) {
@@ -1287,16 +1588,23 @@ double CpuCalcCustomGBForceKernel::execute(ContextImpl& context, bool includeFor
     Vec3* boxVectors = extractBoxVectors(context);
     if (data.isPeriodic)
         ixn->setPeriodic(extractBoxSize(context));
+    if (data.particleReordering)
+        data.beginUnorderedComputation();
+    AlignedArray<float>& posq = (data.particleReordering ? data.unorderedPosq : data.posq);
+    vector<AlignedArray<float> >& threadForce = (data.particleReordering ? data.unorderedForce : data.threadForce);
     if (nonbondedMethod != NoCutoff) {
         vector<set<int> > noExclusions(numParticles);
-        neighborList->computeNeighborList(numParticles, data.posq, noExclusions, boxVectors, data.isPeriodic, nonbondedCutoff, data.threads);
+        neighborList->computeNeighborList(numParticles, posq, noExclusions, boxVectors, data.isPeriodic, nonbondedCutoff, data.threads);
         ixn->setUseCutoff(nonbondedCutoff, *neighborList);
     }
     map<string, double> globalParameters;
     for (auto& name : globalParameterNames)
         globalParameters[name] = context.getParameter(name);
     vector<double> energyParamDerivValues(energyParamDerivNames.size()+1, 0.0);
-    ixn->calculateIxn(numParticles, &data.posq[0], particleParamArray, globalParameters, data.threadForce, includeForces, includeEnergy, energy, &energyParamDerivValues[0]);
+    ixn->calculateIxn(numParticles, &posq[0], particleParamArray, globalParameters, threadForce, includeForces, includeEnergy, energy, &energyParamDerivValues[0]);
+    if (data.particleReordering)
+        data.endUnorderedComputation();
+    data.markAllThreadForces();
     map<string, double>& energyParamDerivs = extractEnergyParameterDerivatives(context);
     for (int i = 0; i < energyParamDerivNames.size(); i++)
         energyParamDerivs[energyParamDerivNames[i]] += energyParamDerivValues[i];
@@ -1378,7 +1686,14 @@ double CpuCalcCustomManyParticleForceKernel::execute(ContextImpl& context, bool
         ixn->setPeriodic(boxVectors);
     }
     double energy = 0;
-    ixn->calculateIxn(data.posq, particleParamArray, globalParameters, data.threadForce, includeForces, includeEnergy, energy);
+    if (data.particleReordering) {
+        data.beginUnorderedComputation();
+        ixn->calculateIxn(data.unorderedPosq, particleParamArray, globalParameters, data.unorderedForce, includeForces, includeEnergy, energy);
+        data.endUnorderedComputation();
+    }
+    else
+        ixn->calculateIxn(data.posq, particleParamArray, globalParameters, data.threadForce, includeForces, includeEnergy, energy);
+    data.markAllThreadForces();
     return energy;
 }
 
@@ -1415,67 +1730,806 @@ void CpuCalcCustomManyParticleForceKernel::copyParametersToContext(ContextImpl&
     }
 }
 
-CpuCalcGayBerneForceKernel::~CpuCalcGayBerneForceKernel() {
+CpuCalcCustomHbondForceKernel::~CpuCalcCustomHbondForceKernel() {
     if (ixn != NULL)
         delete ixn;
 }
 
-void CpuCalcGayBerneForceKernel::initialize(const System& system, const GayBerneForce& force) {
-    ixn = new CpuGayBerneForce(force);
-    data.isPeriodic |= (force.getNonbondedMethod() == GayBerneForce::CutoffPeriodic);
-    if (force.getNonbondedMethod() != GayBerneForce::NoCutoff) {
-        double cutoff = force.getCutoffDistance();
-        data.requestNeighborList(cutoff, 0.1*cutoff, true, ixn->getExclusions());
+void CpuCalcCustomHbondForceKernel::initialize(const System& system, const CustomHbondForce& force) {
+
+    // Build the arrays.
+
+    numDonors = force.getNumDonors();
+    numAcceptors = force.getNumAcceptors();
+    donorParamArray.resize(numDonors);
+    for (int i = 0; i < numDonors; i++) {
+        int d1, d2, d3;
+        force.getDonorParameters(i, d1, d2, d3, donorParamArray[i]);
     }
+    acceptorParamArray.resize(numAcceptors);
+    for (int i = 0; i < numAcceptors; i++) {
+        int a1, a2, a3;
+        force.getAcceptorParameters(i, a1, a2, a3, acceptorParamArray[i]);
+    }
+    for (int i = 0; i < force.getNumGlobalParameters(); i++)
+        globalParameterNames.push_back(force.getGlobalParameterName(i));
+
+    // Record the tabulated function update counts for future reference.
+
+    for (int i = 0; i < force.getNumTabulatedFunctions(); i++)
+        tabulatedFunctionUpdateCount[force.getTabulatedFunctionName(i)] = force.getTabulatedFunction(i).getUpdateCount();
+
+    // Create the interaction.
+
+    ixn = new CpuCustomHbondForce(force, data.threads);
+    nonbondedMethod = CalcCustomHbondForceKernel::NonbondedMethod(force.getNonbondedMethod());
+    cutoffDistance = force.getCutoffDistance();
+    data.isPeriodic |= (nonbondedMethod == CutoffPeriodic);
 }
 
-double CpuCalcGayBerneForceKernel::execute(ContextImpl& context, bool includeForces, bool includeEnergy) {
-    return ixn->calculateForce(extractPositions(context), extractForces(context), data.threadForce, extractBoxVectors(context), data);
+double CpuCalcCustomHbondForceKernel::execute(ContextImpl& context, bool includeForces, bool includeEnergy) {
+    map<string, double> globalParameters;
+    for (auto& name : globalParameterNames)
+        globalParameters[name] = context.getParameter(name);
+    if (nonbondedMethod == CutoffPeriodic) {
+        Vec3* boxVectors = extractBoxVectors(context);
+        double minAllowedSize = 2*cutoffDistance;
+        if (boxVectors[0][0] < minAllowedSize || boxVectors[1][1] < minAllowedSize || boxVectors[2][2] < minAllowedSize)
+            throw OpenMMException("The periodic box size has decreased to less than twice the nonbonded cutoff.");
+        ixn->setPeriodic(boxVectors);
+    }
+    double energy = 0;
+    if (data.particleReordering) {
+        data.beginUnorderedComputation();
+        ixn->calculateIxn(data.unorderedPosq, donorParamArray, acceptorParamArray, globalParameters, data.unorderedForce, includeForces, includeEnergy, energy);
+        data.endUnorderedComputation();
+    }
+    else
+        ixn->calculateIxn(data.posq, donorParamArray, acceptorParamArray, globalParameters, data.threadForce, includeForces, includeEnergy, energy);
+    data.markAllThreadForces();
+    return energy;
 }
 
-void CpuCalcGayBerneForceKernel::copyParametersToContext(ContextImpl& context, const GayBerneForce& force) {
-    delete ixn;
-    ixn = NULL;
-    ixn = new CpuGayBerneForce(force);
+void CpuCalcCustomHbondForceKernel::copyParametersToContext(ContextImpl& context, const CustomHbondForce& force) {
+    if (numDonors != force.getNumDonors())
+        throw OpenMMException("updateParametersInContext: The number of donors has changed");
+    if (numAcceptors != force.getNumAcceptors())
+        throw OpenMMException("updateParametersInContext: The number of acceptors has changed");
+
+    // Record the values.
+
+    vector<double> parameters;
+    int numDonorParameters = force.getNumPerDonorParameters();
+    const vector<vector<int> >& donorAtoms = ixn->getDonorAtoms();
+    for (int i = 0; i < numDonors; i++) {
+        int d1, d2, d3;
+        force.getDonorParameters(i, d1, d2, d3, parameters);
+        if (d1 != donorAtoms[i][0] || d2 != donorAtoms[i][1] || d3 != donorAtoms[i][2])
+            throw OpenMMException("updateParametersInContext: The set of particles in a donor group has changed");
+        for (int j = 0; j < numDonorParameters; j++)
+            donorParamArray[i][j] = parameters[j];
+    }
+    int numAcceptorParameters = force.getNumPerAcceptorParameters();
+    const vector<vector<int> >& acceptorAtoms = ixn->getAcceptorAtoms();
+    for (int i = 0; i < numAcceptors; i++) {
+        int a1, a2, a3;
+        force.getAcceptorParameters(i, a1, a2, a3, parameters);
+        if (a1 != acceptorAtoms[i][0] || a2 != acceptorAtoms[i][1] || a3 != acceptorAtoms[i][2])
+            throw OpenMMException("updateParametersInContext: The set of particles in an acceptor group has changed");
+        for (int j = 0; j < numAcceptorParameters; j++)
+            acceptorParamArray[i][j] = parameters[j];
+    }
+
+    // See if any tabulated functions have changed.
+
+    bool changed = false;
+    for (int i = 0; i < force.getNumTabulatedFunctions(); i++) {
+        string name = force.getTabulatedFunctionName(i);
+        if (force.getTabulatedFunction(i).getUpdateCount() != tabulatedFunctionUpdateCount[name]) {
+            tabulatedFunctionUpdateCount[name] = force.getTabulatedFunction(i).getUpdateCount();
+            changed = true;
+        }
+    }
+    if (changed) {
+        delete ixn;
+        ixn = NULL;
+        ixn = new CpuCustomHbondForce(force, data.threads);
+    }
 }
 
-CpuIntegrateLangevinMiddleStepKernel::~CpuIntegrateLangevinMiddleStepKernel() {
-    if (dynamics)
-        delete dynamics;
+CpuCalcCustomCompoundBondForceKernel::~CpuCalcCustomCompoundBondForceKernel() {
+    if (ixn != NULL)
+        delete ixn;
 }
 
-void CpuIntegrateLangevinMiddleStepKernel::initialize(const System& system, const LangevinMiddleIntegrator& integrator) {
-    int numParticles = system.getNumParticles();
-    masses.resize(numParticles);
-    for (int i = 0; i < numParticles; ++i)
-        masses[i] = system.getParticleMass(i);
-    data.random.initialize(integrator.getRandomNumberSeed(), data.threads.getNumThreads());
+void CpuCalcCustomCompoundBondForceKernel::initialize(const System& system, const CustomCompoundBondForce& force) {
+    usePeriodic = force.usesPeriodicBoundaryConditions();
+    numParticles = system.getNumParticles();
+
+    // Build the arrays.
+
+    numBonds = force.getNumBonds();
+    bondParticles.resize(numBonds);
+    bondParamArray.resize(numBonds);
+    for (int i = 0; i < numBonds; ++i)
+        force.getBondParameters(i, bondParticles[i], bondParamArray[i]);
+    for (int i = 0; i < force.getNumGlobalParameters(); i++)
+        globalParameterNames.push_back(force.getGlobalParameterName(i));
+    for (int i = 0; i < force.getNumEnergyParameterDerivatives(); i++)
+        energyParamDerivNames.push_back(force.getEnergyParameterDerivativeName(i));
+
+    // Record the tabulated function update counts for future reference.
+
+    for (int i = 0; i < force.getNumTabulatedFunctions(); i++)
+        tabulatedFunctionUpdateCount[force.getTabulatedFunctionName(i)] = force.getTabulatedFunction(i).getUpdateCount();
+
+    // Create the interaction.
+
+    createInteraction(force);
 }
 
-void CpuIntegrateLangevinMiddleStepKernel::execute(ContextImpl& context, const LangevinMiddleIntegrator& integrator) {
-    double temperature = integrator.getTemperature();
-    double friction = integrator.getFriction();
-    double stepSize = integrator.getStepSize();
+void CpuCalcCustomCompoundBondForceKernel::createInteraction(const CustomCompoundBondForce& force) {
+    // Create custom functions for the tabulated functions.
+
+    map<string, Lepton::CustomFunction*> functions;
+    for (int i = 0; i < force.getNumTabulatedFunctions(); i++)
+        functions[force.getTabulatedFunctionName(i)] = createReferenceTabulatedFunction(force.getTabulatedFunction(i));
+
+    // Create implementations of point functions.  These are only used for calls the interaction
+    // cannot convert to distances, angles, or dihedrals between particles.
+
+    functions["pointdistance"] = new ReferencePointDistanceFunction(usePeriodic, &boxVectors);
+    functions["pointangle"] = new ReferencePointAngleFunction(usePeriodic, &boxVectors);
+    functions["pointdihedral"] = new ReferencePointDihedralFunction(usePeriodic, &boxVectors);
+
+    // Parse the expression and create the object used to calculate the interaction.
+
+    Lepton::ParsedExpression energyExpression = CustomCompoundBondForceImpl::prepareExpression(force, functions);
+    vector<string> bondParameterNames;
+    for (int i = 0; i < force.getNumPerBondParameters(); i++)
+        bondParameterNames.push_back(force.getPerBondParameterName(i));
+    ixn = new CpuCustomCompoundBondForce(numParticles, bondParticles, energyExpression, bondParameterNames, energyParamDerivNames, data.threads);
+
+    // Delete the custom functions.
+
+    for (auto& function : functions)
+        delete function.second;
+}
+
+double CpuCalcCustomCompoundBondForceKernel::execute(ContextImpl& context, bool includeForces, bool includeEnergy) {
     vector<Vec3>& posData = extractPositions(context);
-    vector<Vec3>& velData = extractVelocities(context);
-    if (dynamics == 0 || temperature != prevTemp || friction != prevFriction || stepSize != prevStepSize) {
-        // Recreate the computation objects with the new parameters.
-        
-        if (dynamics)
-            delete dynamics;
-        dynamics = new CpuLangevinMiddleDynamics(context.getSystem().getNumParticles(), stepSize, friction, temperature, data.threads, data.random);
-        dynamics->setReferenceConstraintAlgorithm(&extractConstraints(context));
-        dynamics->setVirtualSites(extractVirtualSites(context));
-        prevTemp = temperature;
-        prevFriction = friction;
-        prevStepSize = stepSize;
+    vector<Vec3>& forceData = extractForces(context);
+    double energy = 0;
+    map<string, double> globalParameters;
+    for (auto& name : globalParameterNames)
+        globalParameters[name] = context.getParameter(name);
+    if (usePeriodic) {
+        boxVectors = extractBoxVectors(context);
+        ixn->setPeriodic(boxVectors);
     }
-    dynamics->update(context, posData, velData, masses, integrator.getConstraintTolerance());
-    ReferencePlatform::PlatformData* refData = reinterpret_cast<ReferencePlatform::PlatformData*>(context.getPlatformData());
-    refData->time += stepSize;
-    refData->stepCount++;
+    vector<double> energyParamDerivValues(energyParamDerivNames.size()+1, 0.0);
+    ixn->calculateIxn(posData, bondParamArray, globalParameters, forceData, includeEnergy ? &energy : NULL, &energyParamDerivValues[0]);
+    map<string, double>& energyParamDerivs = extractEnergyParameterDerivatives(context);
+    for (int i = 0; i < energyParamDerivNames.size(); i++)
+        energyParamDerivs[energyParamDerivNames[i]] += energyParamDerivValues[i];
+    return energy;
 }
 
-double CpuIntegrateLangevinMiddleStepKernel::computeKineticEnergy(ContextImpl& context, const LangevinMiddleIntegrator& integrator) {
-    return computeShiftedKineticEnergy(context, masses, 0.0);
+void CpuCalcCustomCompoundBondForceKernel::copyParametersToContext(ContextImpl& context, const CustomCompoundBondForce& force) {
+    if (numBonds != force.getNumBonds())
+        throw OpenMMException("updateParametersInContext: The number of bonds has changed");
+
+    // Record the values.
+
+    int numParameters = force.getNumPerBondParameters();
+    const vector<vector<int> >& bondAtoms = ixn->getBondParticles();
+    vector<int> particles;
+    vector<double> params;
+    for (int i = 0; i < numBonds; ++i) {
+        force.getBondParameters(i, particles, params);
+        for (int j = 0; j < particles.size(); j++)
+            if (particles[j] != bondAtoms[i][j])
+                throw OpenMMException("updateParametersInContext: The set of particles in a bond has changed");
+        for (int j = 0; j < numParameters; j++)
+            bondParamArray[i][j] = params[j];
+    }
+
+    // See if any tabulated functions have changed.
+
+    bool changed = false;
+    for (int i = 0; i < force.getNumTabulatedFunctions(); i++) {
+        string name = force.getTabulatedFunctionName(i);
+        if (force.getTabulatedFunction(i).getUpdateCount() != tabulatedFunctionUpdateCount[name]) {
+            tabulatedFunctionUpdateCount[name] = force.getTabulatedFunction(i).getUpdateCount();
+            changed = true;
+        }
+    }
+    if (changed) {
+        delete ixn;
+        ixn = NULL;
+        createInteraction(force);
+    }
+}
+
+CpuCalcCustomCentroidBondForceKernel::~CpuCalcCustomCentroidBondForceKernel() {
+    if (ixn != NULL)
+        delete ixn;
+}
+
+void CpuCalcCustomCentroidBondForceKernel::initialize(const System& system, const CustomCentroidBondForce& force) {
+    usePeriodic = force.usesPeriodicBoundaryConditions();
+
+    // Build the arrays.
+
+    numGroups = force.getNumGroups();
+    groupAtoms.resize(numGroups);
+    vector<double> ignored;
+    for (int i = 0; i < numGroups; i++)
+        force.getGroupParameters(i, groupAtoms[i], ignored);
+    CustomCentroidBondForceImpl::computeNormalizedWeights(force, system, normalizedWeights);
+    numBonds = force.getNumBonds();
+    bondGroups.resize(numBonds);
+    bondParamArray.resize(numBonds);
+    for (int i = 0; i < numBonds; ++i)
+        force.getBondParameters(i, bondGroups[i], bondParamArray[i]);
+    for (int i = 0; i < force.getNumGlobalParameters(); i++)
+        globalParameterNames.push_back(force.getGlobalParameterName(i));
+    for (int i = 0; i < force.getNumEnergyParameterDerivatives(); i++)
+        energyParamDerivNames.push_back(force.getEnergyParameterDerivativeName(i));
+    groupCenters.resize(numGroups);
+    groupForces.resize(numGroups);
+
+    // Record which groups each atom belongs to, so forces can be applied to atoms in parallel.
+
+    atomGroups.resize(system.getNumParticles());
+    for (int i = 0; i < numGroups; i++)
+        for (int j = 0; j < groupAtoms[i].size(); j++)
+            atomGroups[groupAtoms[i][j]].push_back(make_pair(i, normalizedWeights[i][j]));
+    for (int i = 0; i < atomGroups.size(); i++)
+        if (atomGroups[i].size() > 0)
+            atomsInGroups.push_back(i);
+
+    // Record the tabulated function update counts for future reference.
+
+    for (int i = 0; i < force.getNumTabulatedFunctions(); i++)
+        tabulatedFunctionUpdateCount[force.getTabulatedFunctionName(i)] = force.getTabulatedFunction(i).getUpdateCount();
+
+    // Create the interaction.
+
+    createInteraction(force);
+}
+
+void CpuCalcCustomCentroidBondForceKernel::createInteraction(const CustomCentroidBondForce& force) {
+    // Create custom functions for the tabulated functions.
+
+    map<string, Lepton::CustomFunction*> functions;
+    for (int i = 0; i < force.getNumTabulatedFunctions(); i++)
+        functions[force.getTabulatedFunctionName(i)] = createReferenceTabulatedFunction(force.getTabulatedFunction(i));
+
+    // Create implementations of point functions.
+
+    functions["pointdistance"] = new ReferencePointDistanceFunction(usePeriodic, &boxVectors);
+    functions["pointangle"] = new ReferencePointAngleFunction(usePeriodic, &boxVectors);
+    functions["pointdihedral"] = new ReferencePointDihedralFunction(usePeriodic, &boxVectors);
+
+    // Parse the expression and create the object used to calculate the interaction.  The group
+    // centers play the role of particles.
+
+    Lepton::ParsedExpression energyExpression = CustomCentroidBondForceImpl::prepareExpression(force, functions);
+    vector<string> bondParameterNames;
+    for (int i = 0; i < force.getNumPerBondParameters(); i++)
+        bondParameterNames.push_back(force.getPerBondParameterName(i));
+    ixn = new CpuCustomCompoundBondForce(numGroups, bondGroups, energyExpression, bondParameterNames, energyParamDerivNames, data.threads);
+
+    // Delete the custom functions.
+
+    for (auto& function : functions)
+        delete function.second;
+}
+
+double CpuCalcCustomCentroidBondForceKernel::execute(ContextImpl& context, bool includeForces, bool includeEnergy) {
+    vector<Vec3>& posData = extractPositions(context);
+    vector<Vec3>& forceData = extractForces(context);
+    double energy = 0;
+    map<string, double> globalParameters;
+    for (auto& name : globalParameterNames)
+        globalParameters[name] = context.getParameter(name);
+    if (usePeriodic) {
+        boxVectors = extractBoxVectors(context);
+        ixn->setPeriodic(boxVectors);
+    }
+
+    // Compute the center of each group.
+
+    int numThreads = data.threads.getNumThreads();
+    data.threads.execute([&] (ThreadPool& threads, int threadIndex) {
+        int start = threadIndex*numGroups/numThreads;
+        int end = (threadIndex+1)*numGroups/numThreads;
+        for (int group = start; group < end; group++) {
+            Vec3 center;
+            for (int i = 0; i < groupAtoms[group].size(); i++)
+                center += posData[groupAtoms[group][i]]*normalizedWeights[group][i];
+            groupCenters[group] = center;
+            groupForces[group] = Vec3();
+        }
+    });
+    data.threads.waitForThreads();
+
+    // Compute the forces on groups.
+
+    vector<double> energyParamDerivValues(energyParamDerivNames.size()+1, 0.0);
+    ixn->calculateIxn(groupCenters, bondParamArray, globalParameters, groupForces, includeEnergy ? &energy : NULL, &energyParamDerivValues[0]);
+    map<string, double>& energyParamDerivs = extractEnergyParameterDerivatives(context);
+    for (int i = 0; i < energyParamDerivNames.size(); i++)
+        energyParamDerivs[energyParamDerivNames[i]] += energyParamDerivValues[i];
+
+    // Apply the forces to the individual atoms.
+
+    int numAtoms = atomsInGroups.size();
+    data.threads.execute([&] (ThreadPool& threads, int threadIndex) {
+        int start = threadIndex*numAtoms/numThreads;
+        int end = (threadIndex+1)*numAtoms/numThreads;
+        for (int i = start; i < end; i++) {
+            int atom = atomsInGroups[i];
+            for (auto& group : atomGroups[atom])
+                forceData[atom] += groupForces[group.first]*group.second;
+        }
+    });
+    data.threads.waitForThreads();
+    return energy;
+}
+
+void CpuCalcCustomCentroidBondForceKernel::copyParametersToContext(ContextImpl& context, const CustomCentroidBondForce& force) {
+    if (numBonds != force.getNumBonds())
+        throw OpenMMException("updateParametersInContext: The number of bonds has changed");
+
+    // Record the values.
+
+    int numParameters = force.getNumPerBondParameters();
+    const vector<vector<int> >& bondGroups = ixn->getBondParticles();
+    vector<int> groups;
+    vector<double> params;
+    for (int i = 0; i < numBonds; ++i) {
+        force.getBondParameters(i, groups, params);
+        for (int j = 0; j < groups.size(); j++)
+            if (groups[j] != bondGroups[i][j])
+                throw OpenMMException("updateParametersInContext: The set of groups in a bond has changed");
+        for (int j = 0; j < numParameters; j++)
+            bondParamArray[i][j] = params[j];
+    }
+
+    // See if any tabulated functions have changed.
+
+    bool changed = false;
+    for (int i = 0; i < force.getNumTabulatedFunctions(); i++) {
+        string name = force.getTabulatedFunctionName(i);
+        if (force.getTabulatedFunction(i).getUpdateCount() != tabulatedFunctionUpdateCount[name]) {
+            tabulatedFunctionUpdateCount[name] = force.getTabulatedFunction(i).getUpdateCount();
+            changed = true;
+        }
+    }
+    if (changed) {
+        delete ixn;
+        ixn = NULL;
+        createInteraction(force);
+    }
+}
+
+CpuCalcGayBerneForceKernel::~CpuCalcGayBerneForceKernel() {
+    if (ixn != NULL)
+        delete ixn;
+}
+
+void CpuCalcGayBerneForceKernel::initialize(const System& system, const GayBerneForce& force) {
+    ixn = new CpuGayBerneForce(force);
+    data.isPeriodic |= (force.getNonbondedMethod() == GayBerneForce::CutoffPeriodic);
+    if (force.getNonbondedMethod() != GayBerneForce::NoCutoff) {
+        double cutoff = force.getCutoffDistance();
+        data.requestNeighborList(cutoff, 0.1*cutoff, true, ixn->getExclusions());
+    }
+}
+
+double CpuCalcGayBerneForceKernel::execute(ContextImpl& context, bool includeForces, bool includeEnergy) {
+    double energy;
+    if (data.particleReordering) {
+        data.beginUnorderedComputation();
+        energy = ixn->calculateForce(extractPositions(context), extractForces(context), data.unorderedForce, extractBoxVectors(context), data);
+        data.endUnorderedComputation();
+    }
+    else
+        energy = ixn->calculateForce(extractPositions(context), extractForces(context), data.threadForce, extractBoxVectors(context), data);
+    data.markAllThreadForces();
+    return energy;
+}
+
+void CpuCalcGayBerneForceKernel::copyParametersToContext(ContextImpl& context, const GayBerneForce& force) {
+    delete ixn;
+    ixn = NULL;
+    ixn = new CpuGayBerneForce(force);
+}
+
+CpuIntegrateLangevinMiddleStepKernel::~CpuIntegrateLangevinMiddleStepKernel() {
+    if (dynamics)
+        delete dynamics;
+}
+
+void CpuIntegrateLangevinMiddleStepKernel::initialize(const System& system, const LangevinMiddleIntegrator& integrator) {
+    int numParticles = system.getNumParticles();
+    masses.resize(numParticles);
+    for (int i = 0; i < numParticles; ++i)
+        masses[i] = system.getParticleMass(i);
+    data.random.initialize(integrator.getRandomNumberSeed(), data.threads.getNumThreads());
+}
+
+void CpuIntegrateLangevinMiddleStepKernel::execute(ContextImpl& context, const LangevinMiddleIntegrator& integrator) {
+    double temperature = integrator.getTemperature();
+    double friction = integrator.getFriction();
+    double stepSize = integrator.getStepSize();
+    vector<Vec3>& posData = extractPositions(context);
+    vector<Vec3>& velData = extractVelocities(context);
+    if (dynamics == 0 || temperature != prevTemp || friction != prevFriction || stepSize != prevStepSize) {
+        // Recreate the computation objects with the new parameters.
+        
+        if (dynamics)
+            delete dynamics;
+        dynamics = new CpuLangevinMiddleDynamics(context.getSystem().getNumParticles(), stepSize, friction, temperature, data.threads, data.random);
+        dynamics->setReferenceConstraintAlgorithm(&extractConstraints(context));
+        dynamics->setVirtualSites(extractVirtualSites(context));
+        prevTemp = temperature;
+        prevFriction = friction;
+        prevStepSize = stepSize;
+    }
+    dynamics->update(context, posData, velData, masses, integrator.getConstraintTolerance());
+    ReferencePlatform::PlatformData* refData = reinterpret_cast<ReferencePlatform::PlatformData*>(context.getPlatformData());
+    refData->time += stepSize;
+    refData->stepCount++;
+}
+
+double CpuIntegrateLangevinMiddleStepKernel::computeKineticEnergy(ContextImpl& context, const LangevinMiddleIntegrator& integrator) {
+    return computeShiftedKineticEnergy(context, masses, 0.0);
+}
+
+CpuIntegrateVerletStepKernel::~CpuIntegrateVerletStepKernel() {
+    if (dynamics)
+        delete dynamics;
+}
+
+void CpuIntegrateVerletStepKernel::initialize(const System& system, const VerletIntegrator& integrator) {
+    int numParticles = system.getNumParticles();
+    masses.resize(numParticles);
+    for (int i = 0; i < numParticles; ++i)
+        masses[i] = system.getParticleMass(i);
+}
+
+void CpuIntegrateVerletStepKernel::execute(ContextImpl& context, const VerletIntegrator& integrator) {
+    double stepSize = integrator.getStepSize();
+    vector<Vec3>& posData = extractPositions(context);
+    vector<Vec3>& velData = extractVelocities(context);
+    vector<Vec3>& forceData = extractForces(context);
+    if (dynamics == 0 || stepSize != prevStepSize) {
+        // Recreate the computation objects with the new parameters.
+        
+        if (dynamics)
+            delete dynamics;
+        dynamics = new CpuVerletDynamics(context.getSystem().getNumParticles(), stepSize, data.threads);
+        dynamics->setReferenceConstraintAlgorithm(&extractConstraints(context));
+        dynamics->setVirtualSites(extractVirtualSites(context));
+        prevStepSize = stepSize;
+    }
+    dynamics->update(context.getSystem(), posData, velData, forceData, masses, integrator.getConstraintTolerance());
+    ReferencePlatform::PlatformData* refData = reinterpret_cast<ReferencePlatform::PlatformData*>(context.getPlatformData());
+    refData->time += stepSize;
+    refData->stepCount++;
+}
+
+double CpuIntegrateVerletStepKernel::computeKineticEnergy(ContextImpl& context, const VerletIntegrator& integrator) {
+    return computeShiftedKineticEnergy(context, masses, 0.5*integrator.getStepSize());
+}
+
+CpuIntegrateNoseHooverStepKernel::CpuIntegrateNoseHooverStepKernel(std::string name, const Platform& platform, CpuPlatform::PlatformData& data, ContextImpl& context) :
+        IntegrateNoseHooverStepKernel(name, platform), data(data), dynamics(0) {
+    // Create a Reference platform version of this kernel to handle the thermostat chains.
+
+    ReferenceKernelFactory referenceFactory;
+    referenceKernel = Kernel(referenceFactory.createKernelImpl(name, platform, context));
+}
+
+CpuIntegrateNoseHooverStepKernel::~CpuIntegrateNoseHooverStepKernel() {
+    if (dynamics)
+        delete dynamics;
+}
+
+void CpuIntegrateNoseHooverStepKernel::initialize(const System& system, const NoseHooverIntegrator& integrator) {
+    referenceKernel.getAs<IntegrateNoseHooverStepKernel>().initialize(system, integrator);
+    int numParticles = system.getNumParticles();
+    masses.resize(numParticles);
+    for (int i = 0; i < numParticles; ++i)
+        masses[i] = system.getParticleMass(i);
+}
+
+void CpuIntegrateNoseHooverStepKernel::execute(ContextImpl& context, const NoseHooverIntegrator& integrator, bool &forcesAreValid) {
+    double stepSize = integrator.getStepSize();
+    vector<Vec3>& posData = extractPositions(context);
+    vector<Vec3>& velData = extractVelocities(context);
+    vector<Vec3>& forceData = extractForces(context);
+    if (dynamics == 0 || stepSize != prevStepSize) {
+        // Recreate the computation objects with the new parameters.
+
+        if (dynamics)
+            delete dynamics;
+        dynamics = new CpuNoseHooverDynamics(context.getSystem().getNumParticles(), stepSize, data.threads);
+        dynamics->setReferenceConstraintAlgorithm(&extractConstraints(context));
+        dynamics->setVirtualSites(extractVirtualSites(context));
+        prevStepSize = stepSize;
+    }
+    dynamics->step1(context, context.getSystem(), posData, velData, forceData, masses, integrator.getConstraintTolerance(), forcesAreValid,
+                     integrator.getAllThermostatedIndividualParticles(), integrator.getAllThermostatedPairs(), integrator.getMaximumPairDistance());
+    int numChains = integrator.getNumThermostats();
+    for (int chain = 0; chain < numChains; ++chain) {
+        const auto& thermostatChain = integrator.getThermostat(chain);
+        pair<double, double> KEs = computeMaskedKineticEnergy(context, thermostatChain, true);
+        pair<double, double> scaleFactors = propagateChain(context, thermostatChain, KEs, stepSize);
+        scaleVelocities(context, thermostatChain, scaleFactors);
+    }
+    dynamics->step2(context, context.getSystem(), posData, velData, forceData, masses, integrator.getConstraintTolerance(), forcesAreValid,
+                     integrator.getAllThermostatedIndividualParticles(), integrator.getAllThermostatedPairs(), integrator.getMaximumPairDistance());
+    ReferencePlatform::PlatformData* refData = reinterpret_cast<ReferencePlatform::PlatformData*>(context.getPlatformData());
+    refData->time += stepSize;
+    refData->stepCount++;
+}
+
+double CpuIntegrateNoseHooverStepKernel::computeKineticEnergy(ContextImpl& context, const NoseHooverIntegrator& integrator) {
+    return computeShiftedKineticEnergy(context, masses, 0);
+}
+
+pair<double, double> CpuIntegrateNoseHooverStepKernel::propagateChain(ContextImpl& context, const NoseHooverChain &noseHooverChain, pair<double, double> kineticEnergy, double timeStep) {
+    return referenceKernel.getAs<IntegrateNoseHooverStepKernel>().propagateChain(context, noseHooverChain, kineticEnergy, timeStep);
+}
+
+double CpuIntegrateNoseHooverStepKernel::computeHeatBathEnergy(ContextImpl& context, const NoseHooverChain &noseHooverChain) {
+    return referenceKernel.getAs<IntegrateNoseHooverStepKernel>().computeHeatBathEnergy(context, noseHooverChain);
+}
+
+pair<double, double> CpuIntegrateNoseHooverStepKernel::computeMaskedKineticEnergy(ContextImpl& context, const NoseHooverChain &noseHooverChain, bool downloadValue) {
+    return referenceKernel.getAs<IntegrateNoseHooverStepKernel>().computeMaskedKineticEnergy(context, noseHooverChain, downloadValue);
+}
+
+void CpuIntegrateNoseHooverStepKernel::scaleVelocities(ContextImpl& context, const NoseHooverChain &noseHooverChain, pair<double, double> scaleFactor) {
+    referenceKernel.getAs<IntegrateNoseHooverStepKernel>().scaleVelocities(context, noseHooverChain, scaleFactor);
+}
+
+void CpuIntegrateNoseHooverStepKernel::createCheckpoint(ContextImpl& context, ostream& stream) const {
+    referenceKernel.getAs<IntegrateNoseHooverStepKernel>().createCheckpoint(context, stream);
+}
+
+void CpuIntegrateNoseHooverStepKernel::loadCheckpoint(ContextImpl& context, istream& stream) {
+    referenceKernel.getAs<IntegrateNoseHooverStepKernel>().loadCheckpoint(context, stream);
+}
+
+void CpuIntegrateNoseHooverStepKernel::getChainStates(ContextImpl& context, vector<vector<double> >& positions, vector<vector<double> >& velocities) const {
+    referenceKernel.getAs<IntegrateNoseHooverStepKernel>().getChainStates(context, positions, velocities);
+}
+
+void CpuIntegrateNoseHooverStepKernel::setChainStates(ContextImpl& context, const vector<vector<double> >& positions, const vector<vector<double> >& velocities) {
+    referenceKernel.getAs<IntegrateNoseHooverStepKernel>().setChainStates(context, positions, velocities);
+}
+
+CpuIntegrateBrownianStepKernel::~CpuIntegrateBrownianStepKernel() {
+    if (dynamics)
+        delete dynamics;
+}
+
+void CpuIntegrateBrownianStepKernel::initialize(const System& system, const BrownianIntegrator& integrator) {
+    int numParticles = system.getNumParticles();
+    masses.resize(numParticles);
+    for (int i = 0; i < numParticles; ++i)
+        masses[i] = system.getParticleMass(i);
+    data.random.initialize(integrator.getRandomNumberSeed(), data.threads.getNumThreads());
+}
+
+void CpuIntegrateBrownianStepKernel::execute(ContextImpl& context, const BrownianIntegrator& integrator) {
+    double temperature = integrator.getTemperature();
+    double friction = integrator.getFriction();
+    double stepSize = integrator.getStepSize();
+    vector<Vec3>& posData = extractPositions(context);
+    vector<Vec3>& velData = extractVelocities(context);
+    vector<Vec3>& forceData = extractForces(context);
+    if (dynamics == 0 || temperature != prevTemp || friction != prevFriction || stepSize != prevStepSize) {
+        // Recreate the computation objects with the new parameters.
+        
+        if (dynamics)
+            delete dynamics;
+        dynamics = new CpuBrownianDynamics(context.getSystem().getNumParticles(), stepSize, friction, temperature, data.threads, data.random);
+        dynamics->setReferenceConstraintAlgorithm(&extractConstraints(context));
+        dynamics->setVirtualSites(extractVirtualSites(context));
+        prevTemp = temperature;
+        prevFriction = friction;
+        prevStepSize = stepSize;
+    }
+    dynamics->update(context.getSystem(), posData, velData, forceData, masses, integrator.getConstraintTolerance());
+    ReferencePlatform::PlatformData* refData = reinterpret_cast<ReferencePlatform::PlatformData*>(context.getPlatformData());
+    refData->time += stepSize;
+    refData->stepCount++;
+}
+
+double CpuIntegrateBrownianStepKernel::computeKineticEnergy(ContextImpl& context, const BrownianIntegrator& integrator) {
+    return computeShiftedKineticEnergy(context, masses, 0);
+}
+
+CpuIntegrateVariableLangevinStepKernel::~CpuIntegrateVariableLangevinStepKernel() {
+    if (dynamics)
+        delete dynamics;
+}
+
+void CpuIntegrateVariableLangevinStepKernel::initialize(const System& system, const VariableLangevinIntegrator& integrator) {
+    int numParticles = system.getNumParticles();
+    masses.resize(numParticles);
+    for (int i = 0; i < numParticles; ++i)
+        masses[i] = system.getParticleMass(i);
+    data.random.initialize(integrator.getRandomNumberSeed(), data.threads.getNumThreads());
+}
+
+double CpuIntegrateVariableLangevinStepKernel::execute(ContextImpl& context, const VariableLangevinIntegrator& integrator, double maxTime) {
+    double temperature = integrator.getTemperature();
+    double friction = integrator.getFriction();
+    double errorTol = integrator.getErrorTolerance();
+    vector<Vec3>& posData = extractPositions(context);
+    vector<Vec3>& velData = extractVelocities(context);
+    vector<Vec3>& forceData = extractForces(context);
+    if (dynamics == 0 || temperature != prevTemp || friction != prevFriction || errorTol != prevErrorTol) {
+        // Recreate the computation objects with the new parameters.
+
+        if (dynamics)
+            delete dynamics;
+        dynamics = new CpuVariableStochasticDynamics(context.getSystem().getNumParticles(), friction, temperature, errorTol, data.threads, data.random);
+        dynamics->setReferenceConstraintAlgorithm(&extractConstraints(context));
+        dynamics->setVirtualSites(extractVirtualSites(context));
+        prevTemp = temperature;
+        prevFriction = friction;
+        prevErrorTol = errorTol;
+    }
+    ReferencePlatform::PlatformData* refData = reinterpret_cast<ReferencePlatform::PlatformData*>(context.getPlatformData());
+    double maxStepSize = maxTime-refData->time;
+    if (integrator.getMaximumStepSize() > 0)
+        maxStepSize = min(integrator.getMaximumStepSize(), maxStepSize);
+    dynamics->update(context.getSystem(), posData, velData, forceData, masses, maxStepSize, integrator.getConstraintTolerance());
+    refData->time += dynamics->getDeltaT();
+    if (dynamics->getDeltaT() == maxStepSize)
+        refData->time = maxTime; // Avoid round-off error
+    refData->stepCount++;
+    return dynamics->getDeltaT();
+}
+
+double CpuIntegrateVariableLangevinStepKernel::computeKineticEnergy(ContextImpl& context, const VariableLangevinIntegrator& integrator) {
+    return computeShiftedKineticEnergy(context, masses, 0.5*integrator.getStepSize());
+}
+
+CpuIntegrateVariableVerletStepKernel::~CpuIntegrateVariableVerletStepKernel() {
+    if (dynamics)
+        delete dynamics;
+}
+
+void CpuIntegrateVariableVerletStepKernel::initialize(const System& system, const VariableVerletIntegrator& integrator) {
+    int numParticles = system.getNumParticles();
+    masses.resize(numParticles);
+    for (int i = 0; i < numParticles; ++i)
+        masses[i] = system.getParticleMass(i);
+}
+
+double CpuIntegrateVariableVerletStepKernel::execute(ContextImpl& context, const VariableVerletIntegrator& integrator, double maxTime) {
+    double errorTol = integrator.getErrorTolerance();
+    vector<Vec3>& posData = extractPositions(context);
+    vector<Vec3>& velData = extractVelocities(context);
+    vector<Vec3>& forceData = extractForces(context);
+    if (dynamics == 0 || errorTol != prevErrorTol) {
+        // Recreate the computation objects with the new parameters.
+
+        if (dynamics)
+            delete dynamics;
+        dynamics = new CpuVariableVerletDynamics(context.getSystem().getNumParticles(), errorTol, data.threads);
+        dynamics->setReferenceConstraintAlgorithm(&extractConstraints(context));
+        dynamics->setVirtualSites(extractVirtualSites(context));
+        prevErrorTol = errorTol;
+    }
+    ReferencePlatform::PlatformData* refData = reinterpret_cast<ReferencePlatform::PlatformData*>(context.getPlatformData());
+    double maxStepSize = maxTime-refData->time;
+    if (integrator.getMaximumStepSize() > 0)
+        maxStepSize = min(integrator.getMaximumStepSize(), maxStepSize);
+    dynamics->update(context.getSystem(), posData, velData, forceData, masses, maxStepSize, integrator.getConstraintTolerance());
+    refData->time += dynamics->getDeltaT();
+    if (dynamics->getDeltaT() == maxStepSize)
+        refData->time = maxTime; // Avoid round-off error
+    refData->stepCount++;
+    return dynamics->getDeltaT();
+}
+
+double CpuIntegrateVariableVerletStepKernel::computeKineticEnergy(ContextImpl& context, const VariableVerletIntegrator& integrator) {
+    return computeShiftedKineticEnergy(context, masses, 0.5*integrator.getStepSize());
+}
+
+CpuIntegrateCustomStepKernel::~CpuIntegrateCustomStepKernel() {
+    if (dynamics)
+        delete dynamics;
+}
+
+void CpuIntegrateCustomStepKernel::initialize(const System& system, const CustomIntegrator& integrator) {
+    int numParticles = system.getNumParticles();
+    masses.resize(numParticles);
+    for (int i = 0; i < numParticles; ++i)
+        masses[i] = system.getParticleMass(i);
+    perDofValues.resize(integrator.getNumPerDofVariables());
+    for (auto& values : perDofValues)
+        values.resize(numParticles);
+
+    // Create the computation objects.  Global computations use the same random number generator as
+    // the Reference platform, while per-DOF computations use a separate generator for each thread.
+
+    dynamics = new CpuCustomDynamics(system.getNumParticles(), integrator, data.threads, data.random);
+    SimTKOpenMMUtilities::setRandomNumberSeed((unsigned int) integrator.getRandomNumberSeed());
+    data.random.initialize(integrator.getRandomNumberSeed(), data.threads.getNumThreads());
+}
+
+void CpuIntegrateCustomStepKernel::execute(ContextImpl& context, CustomIntegrator& integrator, bool& forcesAreValid) {
+    vector<Vec3>& posData = extractPositions(context);
+    vector<Vec3>& velData = extractVelocities(context);
+    vector<Vec3>& forceData = extractForces(context);
+    
+    // Record global variables.
+    
+    map<string, double> globals;
+    globals["dt"] = integrator.getStepSize();
+    for (int i = 0; i < integrator.getNumGlobalVariables(); i++)
+        globals[integrator.getGlobalVariableName(i)] = globalValues[i];
+    
+    // Execute the step.
+    
+    dynamics->setReferenceConstraintAlgorithm(&extractConstraints(context));
+    dynamics->setVirtualSites(extractVirtualSites(context));
+    dynamics->update(context, context.getSystem().getNumParticles(), posData, velData, forceData, masses, globals, perDofValues, forcesAreValid, integrator.getConstraintTolerance());
+    
+    // Record changed global variables.
+    
+    integrator.setStepSize(globals["dt"]);
+    for (int i = 0; i < (int) globalValues.size(); i++)
+        globalValues[i] = globals[integrator.getGlobalVariableName(i)];
+    ReferencePlatform::PlatformData* refData = reinterpret_cast<ReferencePlatform::PlatformData*>(context.getPlatformData());
+    refData->time += dynamics->getDeltaT();
+    refData->stepCount++;
+}
+
+double CpuIntegrateCustomStepKernel::computeKineticEnergy(ContextImpl& context, CustomIntegrator& integrator, bool& forcesAreValid) {
+    vector<Vec3>& posData = extractPositions(context);
+    vector<Vec3>& velData = extractVelocities(context);
+    vector<Vec3>& forceData = extractForces(context);
+    
+    // Record global variables.
+    
+    map<string, double> globals;
+    globals["dt"] = integrator.getStepSize();
+    for (int i = 0; i < integrator.getNumGlobalVariables(); i++)
+        globals[integrator.getGlobalVariableName(i)] = globalValues[i];
+    
+    // Compute the kinetic energy.
+    
+    return dynamics->computeKineticEnergy(context, context.getSystem().getNumParticles(), posData, velData, forceData, masses, globals, perDofValues, forcesAreValid);
+}
+
+void CpuIntegrateCustomStepKernel::getGlobalVariables(ContextImpl& context, vector<double>& values) const {
+    values = globalValues;
+}
+
+void CpuIntegrateCustomStepKernel::setGlobalVariables(ContextImpl& context, const vector<double>& values) {
+    globalValues = values;
+}
+
+void CpuIntegrateCustomStepKernel::getPerDofVariable(ContextImpl& context, int variable, vector<Vec3>& values) const {
+    values.resize(perDofValues[variable].size());
+    for (int i = 0; i < (int) values.size(); i++)
+        values[i] = perDofValues[variable][i];
+}
+
+void CpuIntegrateCustomStepKernel::setPerDofVariable(ContextImpl& context, int variable, const vector<Vec3>& values) {
+    perDofValues[variable].resize(values.size());
+    for (int i = 0; i < (int) values.size(); i++)
+        perDofValues[variable][i] = values[i];
 }
@@ -0,0 +1,289 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "CpuLINCS.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <map>
+
+using namespace OpenMM;
+using namespace std;
+
+CpuLINCS::CpuLINCS(const ReferenceCCMAAlgorithm& ccma, ThreadPool& threads, int expansionOrder) : threads(threads), expansionOrder(expansionOrder) {
+    maxIterations = ccma.getMaximumNumberOfIterations();
+    numConstraints = ccma.getNumberOfConstraints();
+    atom1.resize(numConstraints);
+    atom2.resize(numConstraints);
+    distance.resize(numConstraints);
+    int numAtoms = 0;
+    for (int i = 0; i < numConstraints; i++) {
+        ccma.getConstraintParameters(i, atom1[i], atom2[i], distance[i]);
+        numAtoms = max(numAtoms, max(atom1[i], atom2[i])+1);
+    }
+
+    // Record which constraints each atom is involved in.  The sign is +1 for the first atom of
+    // a constraint and -1 for the second one.
+
+    vector<vector<pair<int, double> > > atomConstraints(numAtoms);
+    for (int i = 0; i < numConstraints; i++) {
+        atomConstraints[atom1[i]].push_back(make_pair(i, 1.0));
+        atomConstraints[atom2[i]].push_back(make_pair(i, -1.0));
+    }
+    vector<int> atomIndex(numAtoms, -1);
+    for (int i = 0; i < numAtoms; i++) {
+        if (atomConstraints[i].size() == 0)
+            continue;
+        atomIndex[i] = constrainedAtoms.size();
+        constrainedAtoms.push_back(i);
+        atomConstraintStart.push_back(atomConstraintIndex.size());
+        for (auto& c : atomConstraints[i]) {
+            atomConstraintIndex.push_back(c.first);
+            atomConstraintSign.push_back(c.second);
+        }
+    }
+    atomConstraintStart.push_back(atomConstraintIndex.size());
+
+    // Record the coupling between constraints that share an atom.
+
+    for (int i = 0; i < numConstraints; i++) {
+        couplingStart.push_back(couplingIndex.size());
+        for (int atom : {atom1[i], atom2[i]}) {
+            double sign = (atom == atom1[i] ? 1.0 : -1.0);
+            for (auto& c : atomConstraints[atom]) {
+                if (c.first != i) {
+                    couplingIndex.push_back(c.first);
+                    couplingAtom.push_back(atom);
+                    couplingSign.push_back(sign*c.second);
+                }
+            }
+        }
+    }
+    couplingStart.push_back(couplingIndex.size());
+
+    // Identify clusters of constraints that are connected by shared atoms, the same way CpuCCMA does.
+
+    vector<int> atomRoot(numAtoms);
+    for (int i = 0; i < numAtoms; i++)
+        atomRoot[i] = i;
+    auto findRoot = [&] (int atom) {
+        while (atomRoot[atom] != atom) {
+            atomRoot[atom] = atomRoot[atomRoot[atom]];
+            atom = atomRoot[atom];
+        }
+        return atom;
+    };
+    for (int i = 0; i < numConstraints; i++) {
+        int root1 = findRoot(atom1[i]);
+        int root2 = findRoot(atom2[i]);
+        if (root1 != root2)
+            atomRoot[max(root1, root2)] = min(root1, root2);
+    }
+    map<int, int> clusterIndex;
+    vector<vector<int> > clusterConstraints;
+    for (int i = 0; i < numConstraints; i++) {
+        int root = findRoot(atom1[i]);
+        if (clusterIndex.find(root) == clusterIndex.end()) {
+            clusterIndex[root] = clusterConstraints.size();
+            clusterConstraints.push_back(vector<int>());
+        }
+        clusterConstraints[clusterIndex[root]].push_back(i);
+    }
+
+    // Divide the work into blocks.  Small clusters are kept whole, so most coupled constraints are
+    // processed by the same thread.  A cluster larger than a block is split between several of them.
+    // Each constrained atom is updated by the block containing the first constraint it is involved in.
+
+    int numBlocks = 10*threads.getNumThreads();
+    int targetSize = max(1, (numConstraints+numBlocks-1)/numBlocks);
+    vector<int> constraintBlock(numConstraints);
+    if (numConstraints > 0)
+        blocks.resize(1);
+    for (auto& cluster : clusterConstraints)
+        for (int i = 0; i < cluster.size(); i++) {
+            if (blocks.back().constraints.size() >= targetSize && (i == 0 || cluster.size() > targetSize))
+                blocks.push_back(ConstraintBlock());
+            blocks.back().constraints.push_back(cluster[i]);
+            constraintBlock[cluster[i]] = blocks.size()-1;
+        }
+    for (int i = 0; i < constrainedAtoms.size(); i++)
+        blocks[constraintBlock[atomConstraintIndex[atomConstraintStart[i]]]].atoms.push_back(i);
+    direction.resize(numConstraints);
+    scale.resize(numConstraints);
+    rhs.resize(numConstraints);
+    tempRhs.resize(numConstraints);
+    solution.resize(numConstraints);
+    couplingCoefficient.resize(couplingIndex.size());
+    blockConverged.resize(blocks.size());
+}
+
+void CpuLINCS::executeOnBlocks(function<void (ConstraintBlock&, int)> task) {
+    atomic<int> atomicCounter;
+    atomicCounter = 0;
+    threads.execute([&] (ThreadPool& threads, int threadIndex) {
+        while (true) {
+            int index = atomicCounter++;
+            if (index >= blocks.size())
+                break;
+            task(blocks[index], index);
+        }
+    });
+    threads.waitForThreads();
+}
+
+bool CpuLINCS::allBlocksConverged() const {
+    bool converged = true;
+    for (char c : blockConverged)
+        converged &= (c != 0);
+    return converged;
+}
+
+void CpuLINCS::computeCoupling(vector<OpenMM::Vec3>& atomCoordinates, vector<double>& inverseMasses) {
+    executeOnBlocks([&] (ConstraintBlock& block, int index) {
+        for (int i : block.constraints) {
+            Vec3 delta = atomCoordinates[atom1[i]]-atomCoordinates[atom2[i]];
+            direction[i] = delta/sqrt(delta.dot(delta));
+            scale[i] = 1.0/sqrt(inverseMasses[atom1[i]]+inverseMasses[atom2[i]]);
+        }
+    });
+    executeOnBlocks([&] (ConstraintBlock& block, int index) {
+        for (int i : block.constraints)
+            for (int j = couplingStart[i]; j < couplingStart[i+1]; j++) {
+                int k = couplingIndex[j];
+                couplingCoefficient[j] = -couplingSign[j]*inverseMasses[couplingAtom[j]]*scale[i]*scale[k]*direction[i].dot(direction[k]);
+            }
+    });
+}
+
+void CpuLINCS::solve(vector<OpenMM::Vec3>& atomCoordinatesP, vector<double>& inverseMasses) {
+    // Multiply by the series expansion of the inverse matrix, (I-A)^-1 = I + A + A^2 + ...
+
+    for (int order = 0; order < expansionOrder; order++) {
+        executeOnBlocks([&] (ConstraintBlock& block, int index) {
+            for (int i : block.constraints) {
+                double sum = 0.0;
+                for (int j = couplingStart[i]; j < couplingStart[i+1]; j++)
+                    sum += couplingCoefficient[j]*rhs[couplingIndex[j]];
+                tempRhs[i] = sum;
+                solution[i] += sum;
+            }
+        });
+        rhs.swap(tempRhs);
+    }
+
+    // Update the atoms.  Each atom belongs to exactly one block, so no two threads write to the same one.
+
+    executeOnBlocks([&] (ConstraintBlock& block, int index) {
+        for (int i : block.atoms) {
+            int atom = constrainedAtoms[i];
+            if (inverseMasses[atom] == 0.0)
+                continue;
+            Vec3 delta;
+            for (int j = atomConstraintStart[i]; j < atomConstraintStart[i+1]; j++) {
+                int c = atomConstraintIndex[j];
+                delta += direction[c]*(atomConstraintSign[j]*scale[c]*solution[c]);
+            }
+            atomCoordinatesP[atom] -= delta*inverseMasses[atom];
+        }
+    });
+}
+
+void CpuLINCS::apply(vector<OpenMM::Vec3>& atomCoordinates, vector<OpenMM::Vec3>& atomCoordinatesP, vector<double>& inverseMasses, double tolerance) {
+    if (numConstraints == 0)
+        return;
+    computeCoupling(atomCoordinates, inverseMasses);
+
+    // Project out the components of the displacements along the original constraint directions.
+
+    executeOnBlocks([&] (ConstraintBlock& block, int index) {
+        for (int i : block.constraints) {
+            rhs[i] = scale[i]*(direction[i].dot(atomCoordinatesP[atom1[i]]-atomCoordinatesP[atom2[i]])-distance[i]);
+            solution[i] = rhs[i];
+        }
+    });
+    solve(atomCoordinatesP, inverseMasses);
+
+    // Correct for rotational lengthening until every constraint is within the tolerance.  As in CpuCCMA, each
+    // block records whether its constraints have converged, and all blocks stop together.  If they have not
+    // converged after the maximum number of iterations, the constraints are left as they are, just as
+    // ReferenceCCMAAlgorithm does.
+
+    double lowerTol = 1-2*tolerance+tolerance*tolerance;
+    double upperTol = 1+2*tolerance+tolerance*tolerance;
+    for (int iteration = 0; iteration < maxIterations; iteration++) {
+        executeOnBlocks([&] (ConstraintBlock& block, int index) {
+            int numberConverged = 0;
+            for (int i : block.constraints) {
+                Vec3 delta = atomCoordinatesP[atom1[i]]-atomCoordinatesP[atom2[i]];
+                double rp2 = delta.dot(delta);
+                double dist2 = distance[i]*distance[i];
+                if (rp2 >= lowerTol*dist2 && rp2 <= upperTol*dist2)
+                    numberConverged++;
+                double p2 = 2*dist2-rp2;
+                rhs[i] = scale[i]*(distance[i]-(p2 > 0.0 ? sqrt(p2) : 0.0));
+                solution[i] = rhs[i];
+            }
+            blockConverged[index] = (numberConverged == block.constraints.size());
+        });
+        if (allBlocksConverged())
+            break;
+        solve(atomCoordinatesP, inverseMasses);
+    }
+}
+
+void CpuLINCS::applyToVelocities(vector<OpenMM::Vec3>& atomCoordinates, vector<OpenMM::Vec3>& velocities, vector<double>& inverseMasses, double tolerance) {
+    if (numConstraints == 0)
+        return;
+    computeCoupling(atomCoordinates, inverseMasses);
+
+    // Remove the relative velocity along each constraint, iterating until the same criterion
+    // used by ReferenceCCMAAlgorithm is satisfied.
+
+    for (int iteration = 0; iteration < maxIterations; iteration++) {
+        executeOnBlocks([&] (ConstraintBlock& block, int index) {
+            int numberConverged = 0;
+            for (int i : block.constraints) {
+                Vec3 r_ij = atomCoordinates[atom1[i]]-atomCoordinates[atom2[i]];
+                Vec3 v_ij = velocities[atom1[i]]-velocities[atom2[i]];
+                double rrpr = v_ij.dot(r_ij);
+                double delta = rrpr*scale[i]*scale[i]/r_ij.dot(r_ij);
+                if (fabs(delta) <= tolerance)
+                    numberConverged++;
+                rhs[i] = scale[i]*direction[i].dot(v_ij);
+                solution[i] = rhs[i];
+            }
+            blockConverged[index] = (numberConverged == block.constraints.size());
+        });
+        if (allBlocksConverged())
+            break;
+        solve(velocities, inverseMasses);
+    }
+}
@@ -410,7 +410,7 @@ private:
     vector<vector<vector<pair<float, int> > > > bins;
 };
 
-CpuNeighborList::CpuNeighborList(int blockSize) : blockSize(blockSize) {
+CpuNeighborList::CpuNeighborList(int blockSize) : blockSize(blockSize), dense(false), pruning(false), clusterPairs(false) {
 }
 
 void CpuNeighborList::computeNeighborList(int numAtoms, const AlignedArray<float>& atomLocations, const vector<set<int> >& exclusions,
@@ -452,7 +452,7 @@ void CpuNeighborList::computeNeighborList(int numAtoms, const AlignedArray<float
     // Sort the atoms based on a Hilbert curve.
     
     atomBins.resize(numAtoms);
-    threads.execute([&] (ThreadPool& threads, int threadIndex) { threadComputeNeighborList(threads, threadIndex); });
+    threads.execute([&] (ThreadPool& threads, int threadIndex) { threadComputeHilbertBins(threads, threadIndex); });
     threads.waitForThreads();
     sort(atomBins.begin(), atomBins.end());
 
@@ -476,11 +476,12 @@ void CpuNeighborList::computeNeighborList(int numAtoms, const AlignedArray<float
     voxels.sortItems();
     this->voxels = &voxels;
 
-    // Signal the threads to start running and wait for them to finish.
+    // Find the neighbors of each block.  The cost of a block depends on the local density, so the blocks are
+    // processed in chunks that are balanced dynamically between threads.
     
-    atomicCounter = 0;
-    threads.resumeThreads();
-    threads.waitForThreads();
+    threads.parallelFor(numBlocks, max(1, numBlocks/(10*threads.getNumThreads())), [&] (ThreadPool& threads, int threadIndex, int start, int end) {
+        threadComputeBlockNeighbors(start, end);
+    });
     
     // Add padding atoms to fill up the last block.
     
@@ -493,6 +494,15 @@ void CpuNeighborList::computeNeighborList(int numAtoms, const AlignedArray<float
         for (int i = 0; i < (int) exc.size(); i++)
             exc[i] |= mask;
     }
+
+    // Save a copy of the full list for pruning.
+
+    if (pruning) {
+        fullBlockNeighbors = blockNeighbors;
+        fullBlockExclusions = blockExclusions;
+    }
+    if (clusterPairs)
+        buildClusterPairs(threads);
 }
 
 void CpuNeighborList::createDenseNeighborList(int numAtoms, const vector<set<int> >& exclusions) {
@@ -568,6 +578,93 @@ const std::vector<CpuNeighborList::BlockExclusionMask>& CpuNeighborList::getBloc
     
 }
 
+void CpuNeighborList::setUsePruning(bool use) {
+    pruning = use;
+}
+
+void CpuNeighborList::pruneNeighborList(const AlignedArray<float>& atomLocations, const Vec3* periodicBoxVectors, float maxDistance, ThreadPool& threads) {
+    if (dense || !pruning)
+        return;
+    this->atomLocations = &atomLocations[0];
+    this->periodicBoxVectors[0] = periodicBoxVectors[0];
+    this->periodicBoxVectors[1] = periodicBoxVectors[1];
+    this->periodicBoxVectors[2] = periodicBoxVectors[2];
+    this->maxDistance = maxDistance;
+    int numBlocks = getNumBlocks();
+    threads.parallelFor(numBlocks, max(1, numBlocks/(10*threads.getNumThreads())), [&] (ThreadPool& threads, int threadIndex, int start, int end) {
+        for (int i = start; i < end; i++)
+            pruneBlockNeighbors(i);
+    });
+    if (clusterPairs)
+        buildClusterPairs(threads);
+}
+
+void CpuNeighborList::setUseClusterPairs(bool use) {
+    clusterPairs = use;
+}
+
+bool CpuNeighborList::usesClusterPairs() const {
+    return clusterPairs && !dense;
+}
+
+const vector<int>& CpuNeighborList::getBlockClusters(int blockIndex) const {
+    return blockClusters[blockIndex];
+}
+
+const vector<CpuNeighborList::BlockExclusionMask>& CpuNeighborList::getBlockClusterExclusions(int blockIndex) const {
+    return blockClusterExclusions[blockIndex];
+}
+
+void CpuNeighborList::buildClusterPairs(ThreadPool& threads) {
+    // Every neighbor of a block has a lower sorted index than the end of the block, so regrouping the atom
+    // list by the block each neighbor belongs to gives the cluster list directly.
+
+    int numBlocks = getNumBlocks();
+    atomSortedIndex.resize(numAtoms);
+    for (int i = 0; i < numAtoms; i++)
+        atomSortedIndex[sortedAtoms[i]] = i;
+    blockClusters.resize(numBlocks);
+    blockClusterExclusions.resize(numBlocks);
+    threads.parallelFor(numBlocks, max(1, numBlocks/(10*threads.getNumThreads())), [&] (ThreadPool& threads, int threadIndex, int start, int end) {
+        vector<int> clusterSlot(numBlocks, -1);
+        for (int i = start; i < end; i++)
+            buildBlockClusters(i, clusterSlot);
+    });
+}
+
+void CpuNeighborList::buildBlockClusters(int blockIndex, vector<int>& clusterSlot) {
+    const vector<int>& neighbors = blockNeighbors[blockIndex];
+    const vector<BlockExclusionMask>& exclusions = blockExclusions[blockIndex];
+    vector<int>& clusters = blockClusters[blockIndex];
+    vector<BlockExclusionMask>& clusterExclusions = blockClusterExclusions[blockIndex];
+    clusters.clear();
+    for (int neighbor : neighbors) {
+        int cluster = atomSortedIndex[neighbor]/blockSize;
+        if (clusterSlot[cluster] == -1) {
+            clusterSlot[cluster] = 0;
+            clusters.push_back(cluster);
+        }
+    }
+    sort(clusters.begin(), clusters.end());
+    for (int i = 0; i < (int) clusters.size(); i++)
+        clusterSlot[clusters[i]] = i;
+
+    // Start with every pair excluded, then clear the bits for the pairs in the atom list.
+
+    const BlockExclusionMask allExcluded = (BlockExclusionMask) ((1<<blockSize)-1);
+    clusterExclusions.assign(blockSize*clusters.size(), allExcluded);
+    for (int k = 0; k < (int) neighbors.size(); k++) {
+        int sortedIndex = atomSortedIndex[neighbors[k]];
+        int slot = clusterSlot[sortedIndex/blockSize];
+        BlockExclusionMask atomBit = (BlockExclusionMask) (1<<(sortedIndex%blockSize));
+        for (int j = 0; j < blockSize; j++)
+            if (((exclusions[k]>>j) & 1) == 0)
+                clusterExclusions[blockSize*slot+j] &= ~atomBit;
+    }
+    for (int cluster : clusters)
+        clusterSlot[cluster] = -1;
+}
+
 CpuNeighborList::NeighborIterator CpuNeighborList::getNeighborIterator(int blockIndex) const {
     if (dense)
         return NeighborIterator(blockIndex*blockSize, numAtoms, blockExclusionIndices[blockIndex], blockExclusions[blockIndex]);
@@ -575,7 +672,7 @@ CpuNeighborList::NeighborIterator CpuNeighborList::getNeighborIterator(int block
         return NeighborIterator(blockNeighbors[blockIndex], blockExclusions[blockIndex]);
 }
 
-void CpuNeighborList::threadComputeNeighborList(ThreadPool& threads, int threadIndex) {
+void CpuNeighborList::threadComputeHilbertBins(ThreadPool& threads, int threadIndex) {
     // Compute the positions of atoms along the Hilbert curve.
 
     float binWidth = max(max(maxx-minx, maxy-miny), maxz-minz)/255.0f;
@@ -590,19 +687,13 @@ void CpuNeighborList::threadComputeNeighborList(ThreadPool& threads, int threadI
         int bin = (int) hilbert_c2i(3, 8, coords);
         atomBins[i] = pair<int, int>(bin, i);
     }
-    threads.syncThreads();
-
-    // Compute this thread's subset of neighbors.
+}
 
-    int numBlocks = blockNeighbors.size();
+void CpuNeighborList::threadComputeBlockNeighbors(int startBlock, int endBlock) {
     vector<int> blockAtoms;
     vector<float> blockAtomX(blockSize), blockAtomY(blockSize), blockAtomZ(blockSize);
     vector<VoxelIndex> atomVoxelIndex;
-    while (true) {
-        int i = atomicCounter++;
-        if (i >= numBlocks)
-            break;
-
+    for (int i = startBlock; i < endBlock; i++) {
         // Find the atoms in this block and compute their bounding box.
         
         int firstIndex = blockSize*i;
@@ -656,6 +747,52 @@ void CpuNeighborList::threadComputeNeighborList(ThreadPool& threads, int threadI
     }
 }
 
+void CpuNeighborList::pruneBlockNeighbors(int blockIndex) {
+    const int* blockAtoms = &sortedAtoms[blockSize*blockIndex];
+    fvec4 boxSize(periodicBoxVectors[0][0], periodicBoxVectors[1][1], periodicBoxVectors[2][2], 0);
+    fvec4 invBoxSize(1/periodicBoxVectors[0][0], 1/periodicBoxVectors[1][1], 1/periodicBoxVectors[2][2], 0);
+    fvec4 periodicBoxVec4[3];
+    for (int j = 0; j < 3; j++)
+        periodicBoxVec4[j] = fvec4(periodicBoxVectors[j][0], periodicBoxVectors[j][1], periodicBoxVectors[j][2], 0);
+    bool triclinic = (periodicBoxVectors[0][1] != 0.0 || periodicBoxVectors[0][2] != 0.0 ||
+                      periodicBoxVectors[1][0] != 0.0 || periodicBoxVectors[1][2] != 0.0 ||
+                      periodicBoxVectors[2][0] != 0.0 || periodicBoxVectors[2][1] != 0.0);
+    float maxDistanceSquared = maxDistance*maxDistance;
+
+    // Keep each neighbor that is within the cutoff of at least one atom in the block it is not excluded from.
+
+    const vector<int>& fullNeighbors = fullBlockNeighbors[blockIndex];
+    const vector<BlockExclusionMask>& fullExclusions = fullBlockExclusions[blockIndex];
+    vector<int>& neighbors = blockNeighbors[blockIndex];
+    vector<BlockExclusionMask>& exclusions = blockExclusions[blockIndex];
+    neighbors.clear();
+    exclusions.clear();
+    for (int k = 0; k < (int) fullNeighbors.size(); k++) {
+        fvec4 atomPos(&atomLocations[4*fullNeighbors[k]]);
+        BlockExclusionMask mask = fullExclusions[k];
+        bool include = false;
+        for (int j = 0; j < blockSize && !include; j++) {
+            if ((mask>>j) & 1)
+                continue;
+            fvec4 delta = atomPos-fvec4(&atomLocations[4*blockAtoms[j]]);
+            if (usePeriodic) {
+                if (triclinic) {
+                    delta -= periodicBoxVec4[2]*floorf(delta[2]*invBoxSize[2]+0.5f);
+                    delta -= periodicBoxVec4[1]*floorf(delta[1]*invBoxSize[1]+0.5f);
+                    delta -= periodicBoxVec4[0]*floorf(delta[0]*invBoxSize[0]+0.5f);
+                }
+                else
+                    delta -= round(delta*invBoxSize)*boxSize;
+            }
+            include = (dot3(delta, delta) < maxDistanceSquared);
+        }
+        if (include) {
+            neighbors.push_back(fullNeighbors[k]);
+            exclusions.push_back(mask);
+        }
+    }
+}
+
 CpuNeighborList::NeighborIterator::NeighborIterator(const vector<int>& neighbors, const vector<BlockExclusionMask>& exclusions) :
         dense(false), neighbors(&neighbors), exclusions(&exclusions), currentIndex(-1) {
 }
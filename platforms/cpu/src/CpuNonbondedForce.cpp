@@ -40,6 +40,7 @@ using namespace OpenMM;
 
 const float CpuNonbondedForce::TWO_OVER_SQRT_PI = (float) (2/sqrt(PI_M));
 const int CpuNonbondedForce::NUM_TABLE_POINTS = 2048;
+const int CpuNonbondedForce::CLUSTER_VALUES = 7;
 
 /**---------------------------------------------------------------------------------------
 
@@ -47,7 +48,7 @@ const int CpuNonbondedForce::NUM_TABLE_POINTS = 2048;
 
    --------------------------------------------------------------------------------------- */
 
-CpuNonbondedForce::CpuNonbondedForce(const CpuNeighborList& neighbors) : neighborList(&neighbors), cutoff(false), useSwitch(false), periodic(false),
+CpuNonbondedForce::CpuNonbondedForce(const CpuNeighborList& neighbors) : neighborList(&neighbors), forceRegions(NULL), cutoff(false), useSwitch(false), periodic(false),
         periodicExceptions(false), ewald(false), pme(false), ljpme(false), tableIsValid(false), expTableIsValid(false), cutoffDistance(0.0f),
         alphaDispersionEwald(0.0f), alphaEwald(0.0f) {
 }
@@ -205,6 +206,10 @@ void CpuNonbondedForce::setPeriodicExceptions(bool periodic) {
     periodicExceptions = periodic;
 }
 
+void CpuNonbondedForce::setForceRegions(CpuForceRegions* regions) {
+    forceRegions = regions;
+}
+
 void CpuNonbondedForce::tabulateEwaldScaleFactor() {
     if (tableIsValid)
         return;
@@ -389,104 +394,122 @@ void CpuNonbondedForce::calculateDirectIxn(int numberOfAtoms, float* posq, const
     this->exclusions = &exclusions[0];
     this->threadForce = &threadForce;
     includeEnergy = (totalEnergy != NULL);
-    threadEnergy.resize(threads.getNumThreads());
-    atomicCounter = 0;
-    atomicCounter2 = 0;
+    int numThreads = threads.getNumThreads();
+    threadEnergy.assign(numThreads, 0.0);
+    int numBlocks = neighborList->getNumBlocks();
+    if (cutoff && neighborList->usesClusterPairs()) {
+        int blockSize = neighborList->getBlockSize();
+        if (clusterData.size() != CLUSTER_VALUES*blockSize*numBlocks)
+            clusterData.resize(CLUSTER_VALUES*blockSize*numBlocks);
+        threads.parallelFor(numBlocks, max(1, numBlocks/(10*numThreads)), [&] (ThreadPool& threads, int threadIndex, int start, int end) {
+            threadPackClusters(start, end);
+        });
+    }
     
-    // Signal the threads to start running and wait for them to finish.
+    // Process the neighbor list blocks in chunks that are balanced dynamically between threads.
     
-    threads.execute([&] (ThreadPool& threads, int threadIndex) { threadComputeDirect(threads, threadIndex); });
-    threads.waitForThreads();
+    threads.parallelFor(numBlocks, max(1, numBlocks/(10*numThreads)), [&] (ThreadPool& threads, int threadIndex, int start, int end) {
+        threadComputeBlocks(threads, threadIndex, start, end);
+    });
+
+    // Now subtract off the exclusions, since they were implicitly included in the reciprocal space sum.
+
+    if (ewald || pme || ljpme)
+        threads.parallelFor(numberOfAtoms, max(1, numberOfAtoms/(10*numThreads)), [&] (ThreadPool& threads, int threadIndex, int start, int end) {
+            threadComputeExclusions(threads, threadIndex, start, end);
+        });
     
     // Combine the energies from all the threads.
     
     if (totalEnergy != NULL) {
         double directEnergy = 0;
-        int numThreads = threads.getNumThreads();
         for (int i = 0; i < numThreads; i++)
             directEnergy += threadEnergy[i];
         *totalEnergy += directEnergy;
     }
 }
 
-void CpuNonbondedForce::threadComputeDirect(ThreadPool& threads, int threadIndex) {
-    // Compute this thread's subset of interactions.
-
-    int numThreads = threads.getNumThreads();
-    threadEnergy[threadIndex] = 0;
+void CpuNonbondedForce::threadComputeBlocks(ThreadPool& threads, int threadIndex, int startBlock, int endBlock) {
     double* energyPtr = (includeEnergy ? &threadEnergy[threadIndex] : NULL);
     float* forces = &(*threadForce)[threadIndex][0];
+    char* writtenTiles = (forceRegions == NULL ? NULL : forceRegions->getWrittenTiles(threadIndex));
     fvec4 boxSize(periodicBoxVectors[0][0], periodicBoxVectors[1][1], periodicBoxVectors[2][2], 0);
     fvec4 invBoxSize(recipBoxSize[0], recipBoxSize[1], recipBoxSize[2], 0);
-    if (ewald || pme || ljpme) {
-        // Compute the interactions from the neighbor list.
-        while (true) {
-            int nextBlock = atomicCounter++;
-            if (nextBlock >= neighborList->getNumBlocks())
-                break;
-            calculateBlockEwaldIxn(nextBlock, forces, energyPtr, boxSize, invBoxSize);
+    for (int block = startBlock; block < endBlock; block++) {
+        if (ewald || pme || ljpme)
+            calculateBlockEwaldIxn(block, forces, writtenTiles, energyPtr, boxSize, invBoxSize);
+        else
+            calculateBlockIxn(block, forces, writtenTiles, energyPtr, boxSize, invBoxSize);
+    }
+}
+
+void CpuNonbondedForce::threadPackClusters(int startBlock, int endBlock) {
+    int blockSize = neighborList->getBlockSize();
+    const vector<int32_t>& sortedAtoms = neighborList->getSortedAtoms();
+    for (int block = startBlock; block < endBlock; block++) {
+        float* data = &clusterData[CLUSTER_VALUES*blockSize*block];
+        for (int i = 0; i < blockSize; i++) {
+            int atom = sortedAtoms[blockSize*block+i];
+            data[i] = posq[4*atom];
+            data[blockSize+i] = posq[4*atom+1];
+            data[2*blockSize+i] = posq[4*atom+2];
+            data[3*blockSize+i] = posq[4*atom+3];
+            data[4*blockSize+i] = atomParameters[atom].first;
+            data[5*blockSize+i] = atomParameters[atom].second;
+            data[6*blockSize+i] = C6params[atom];
         }
+    }
+}
 
-        // Now subtract off the exclusions, since they were implicitly included in the reciprocal space sum.
-
-        const int groupSize = max(1, numberOfAtoms/(10*numThreads));
-        while (true) {
-            int start = atomicCounter2.fetch_add(groupSize);
-            if (start >= numberOfAtoms)
-                break;
-            int end = min(start+groupSize, numberOfAtoms);
-            for (int i = start; i < end; i++) {
-                fvec4 posI((float) atomCoordinates[i][0], (float) atomCoordinates[i][1], (float) atomCoordinates[i][2], 0.0f);
-                float scaledChargeI = (float) (ONE_4PI_EPS0*posq[4*i+3]);
-                for (int excluded : exclusions[i]) {
-                    if (excluded > i) {
-                        int j = excluded;
-                        fvec4 deltaR;
-                        fvec4 posJ((float) atomCoordinates[j][0], (float) atomCoordinates[j][1], (float) atomCoordinates[j][2], 0.0f);
-                        float r2;
-                        getDeltaR(posJ, posI, deltaR, r2, periodicExceptions, boxSize, invBoxSize);
-                        float r = sqrtf(r2);
-                        float alphaR = alphaEwald*r;
-                        float erfAlphaR = erf(alphaR);
-                        if (erfAlphaR > 1e-6f) {
-                            float inverseR = 1/r;
-                            float chargeProdOverR = scaledChargeI*posq[4*j+3]*inverseR;
-                            float dEdR = chargeProdOverR*inverseR*inverseR;
-                            dEdR = dEdR * (erfAlphaR-TWO_OVER_SQRT_PI*alphaR*(float)exp(-alphaR*alphaR));
-                            fvec4 result = deltaR*dEdR;
-                            (fvec4(forces+4*i)-result).store(forces+4*i);
-                            (fvec4(forces+4*j)+result).store(forces+4*j);
-                            if (includeEnergy)
-                                threadEnergy[threadIndex] -= chargeProdOverR*erfAlphaR;
-                        }
-                        else if (includeEnergy)
-                            threadEnergy[threadIndex] -= alphaEwald*TWO_OVER_SQRT_PI*scaledChargeI*posq[4*j+3];
-                        if (ljpme) {
-                            float C6ij = C6params[i]*C6params[j];
-                            float inverseR2 = 1.0f/r2;
-                            float emult = C6ij*inverseR2*inverseR2*inverseR2*exptermsApprox(r);
-                            if(includeEnergy)
-                                threadEnergy[threadIndex] += emult;
-                            float dEdR = -6.0f*C6ij*inverseR2*inverseR2*inverseR2*inverseR2*dExptermsApprox(r);
-                            fvec4 result = deltaR*dEdR;
-                            (fvec4(forces+4*i)-result).store(forces+4*i);
-                            (fvec4(forces+4*j)+result).store(forces+4*j);
-                        }
-                    }
+void CpuNonbondedForce::threadComputeExclusions(ThreadPool& threads, int threadIndex, int startAtom, int endAtom) {
+    float* forces = &(*threadForce)[threadIndex][0];
+    fvec4 boxSize(periodicBoxVectors[0][0], periodicBoxVectors[1][1], periodicBoxVectors[2][2], 0);
+    fvec4 invBoxSize(recipBoxSize[0], recipBoxSize[1], recipBoxSize[2], 0);
+    for (int i = startAtom; i < endAtom; i++) {
+        if (forceRegions != NULL) {
+            forceRegions->markAtom(threadIndex, i);
+            for (int excluded : exclusions[i])
+                forceRegions->markAtom(threadIndex, excluded);
+        }
+        fvec4 posI((float) atomCoordinates[i][0], (float) atomCoordinates[i][1], (float) atomCoordinates[i][2], 0.0f);
+        float scaledChargeI = (float) (ONE_4PI_EPS0*posq[4*i+3]);
+        for (int excluded : exclusions[i]) {
+            if (excluded > i) {
+                int j = excluded;
+                fvec4 deltaR;
+                fvec4 posJ((float) atomCoordinates[j][0], (float) atomCoordinates[j][1], (float) atomCoordinates[j][2], 0.0f);
+                float r2;
+                getDeltaR(posJ, posI, deltaR, r2, periodicExceptions, boxSize, invBoxSize);
+                float r = sqrtf(r2);
+                float alphaR = alphaEwald*r;
+                float erfAlphaR = erf(alphaR);
+                if (erfAlphaR > 1e-6f) {
+                    float inverseR = 1/r;
+                    float chargeProdOverR = scaledChargeI*posq[4*j+3]*inverseR;
+                    float dEdR = chargeProdOverR*inverseR*inverseR;
+                    dEdR = dEdR * (erfAlphaR-TWO_OVER_SQRT_PI*alphaR*(float)exp(-alphaR*alphaR));
+                    fvec4 result = deltaR*dEdR;
+                    (fvec4(forces+4*i)-result).store(forces+4*i);
+                    (fvec4(forces+4*j)+result).store(forces+4*j);
+                    if (includeEnergy)
+                        threadEnergy[threadIndex] -= chargeProdOverR*erfAlphaR;
+                }
+                else if (includeEnergy)
+                    threadEnergy[threadIndex] -= alphaEwald*TWO_OVER_SQRT_PI*scaledChargeI*posq[4*j+3];
+                if (ljpme) {
+                    float C6ij = C6params[i]*C6params[j];
+                    float inverseR2 = 1.0f/r2;
+                    float emult = C6ij*inverseR2*inverseR2*inverseR2*exptermsApprox(r);
+                    if(includeEnergy)
+                        threadEnergy[threadIndex] += emult;
+                    float dEdR = -6.0f*C6ij*inverseR2*inverseR2*inverseR2*inverseR2*dExptermsApprox(r);
+                    fvec4 result = deltaR*dEdR;
+                    (fvec4(forces+4*i)-result).store(forces+4*i);
+                    (fvec4(forces+4*j)+result).store(forces+4*j);
                 }
             }
         }
     }
-    else {
-        // Compute the interactions from the neighbor list.
-
-        while (true) {
-            int nextBlock = atomicCounter++;
-            if (nextBlock >= neighborList->getNumBlocks())
-                break;
-            calculateBlockIxn(nextBlock, forces, energyPtr, boxSize, invBoxSize);
-        }
-    }
 }
 
 void CpuNonbondedForce::getDeltaR(const fvec4& posI, const fvec4& posJ, fvec4& deltaR, float& r2, bool periodic, const fvec4& boxSize, const fvec4& invBoxSize) const {
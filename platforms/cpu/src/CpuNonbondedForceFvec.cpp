@@ -31,13 +31,18 @@ using namespace OpenMM;
 CpuNonbondedForce* createCpuNonbondedForceVec4(const CpuNeighborList& neighbors);
 CpuNonbondedForce* createCpuNonbondedForceAvx(const CpuNeighborList& neighbors);
 CpuNonbondedForce* createCpuNonbondedForceAvx2(const CpuNeighborList& neighbors);
+CpuNonbondedForce* createCpuNonbondedForceAvx512(const CpuNeighborList& neighbors);
 
 bool isAvx2Supported();
 
 #include <iostream>
 
 CpuNonbondedForce* createCpuNonbondedForceVec(const CpuNeighborList& neighbors) {
-    if (isAvx2Supported())
+    // The choice must agree with getVectorWidth(), which sets the neighbor list block size.
+
+    if (isAvx512Supported())
+        return createCpuNonbondedForceAvx512(neighbors);
+    else if (isAvx2Supported())
         return createCpuNonbondedForceAvx2(neighbors);
     else if (isAvxSupported())
         return createCpuNonbondedForceAvx(neighbors);
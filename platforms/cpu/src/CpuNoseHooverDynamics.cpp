@@ -0,0 +1,171 @@
+/* Portions copyright (c) 2026 Stanford University and Simbios.
+ * Authors: Peter Eastman
+ * Contributors: 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "CpuNoseHooverDynamics.h"
+
+using namespace OpenMM;
+using namespace std;
+
+CpuNoseHooverDynamics::CpuNoseHooverDynamics(int numberOfAtoms, double deltaT, ThreadPool& threads) :
+           ReferenceNoseHooverDynamics(numberOfAtoms, deltaT), threads(threads) {
+}
+
+CpuNoseHooverDynamics::~CpuNoseHooverDynamics() {
+}
+
+void CpuNoseHooverDynamics::updatePart1(vector<Vec3>& velocities, vector<Vec3>& forces, vector<double>& masses, vector<double>& inverseMasses,
+                                        const vector<int>& allAtoms, const vector<tuple<int, int, double>>& allPairs) {
+    // Record the parameters for the threads.
+
+    this->velocities = &velocities[0];
+    this->forces = &forces[0];
+    this->masses = &masses[0];
+    this->inverseMasses = &inverseMasses[0];
+    this->atomList = &allAtoms;
+    this->pairList = &allPairs;
+
+    // Signal the threads to start running and wait for them to finish.
+
+    threads.execute([&] (ThreadPool& threads, int threadIndex) { threadUpdate1(threadIndex); });
+    threads.waitForThreads();
+}
+
+void CpuNoseHooverDynamics::updatePart2(int numberOfAtoms, vector<Vec3>& atomCoordinates, vector<Vec3>& velocities,
+                                        vector<double>& inverseMasses, vector<Vec3>& xPrime) {
+    // Record the parameters for the threads.
+
+    this->atomCoordinates = &atomCoordinates[0];
+    this->velocities = &velocities[0];
+    this->inverseMasses = &inverseMasses[0];
+    this->xPrime = &xPrime[0];
+
+    // Signal the threads to start running and wait for them to finish.
+
+    threads.execute([&] (ThreadPool& threads, int threadIndex) { threadUpdate2(threadIndex); });
+    threads.waitForThreads();
+}
+
+void CpuNoseHooverDynamics::updatePart3(int numberOfAtoms, vector<Vec3>& velocities, vector<double>& inverseMasses, vector<Vec3>& xPrime) {
+    // Record the parameters for the threads.
+
+    this->velocities = &velocities[0];
+    this->inverseMasses = &inverseMasses[0];
+    this->xPrime = &xPrime[0];
+
+    // Signal the threads to start running and wait for them to finish.
+
+    threads.execute([&] (ThreadPool& threads, int threadIndex) { threadUpdate3(threadIndex); });
+    threads.waitForThreads();
+}
+
+void CpuNoseHooverDynamics::updatePart4(int numberOfAtoms, vector<Vec3>& atomCoordinates, vector<Vec3>& velocities,
+                                        vector<double>& inverseMasses, vector<Vec3>& xPrime) {
+    // Record the parameters for the threads.
+
+    this->atomCoordinates = &atomCoordinates[0];
+    this->velocities = &velocities[0];
+    this->inverseMasses = &inverseMasses[0];
+    this->xPrime = &xPrime[0];
+
+    // Signal the threads to start running and wait for them to finish.
+
+    threads.execute([&] (ThreadPool& threads, int threadIndex) { threadUpdate4(threadIndex); });
+    threads.waitForThreads();
+}
+
+void CpuNoseHooverDynamics::threadUpdate1(int threadIndex) {
+    const double dt = getDeltaT();
+    int numThreads = threads.getNumThreads();
+
+    // Regular atoms.  Each particle appears at most once in the atom and pair lists, so threads
+    // never write to the same particle.
+
+    int numAtoms = atomList->size();
+    int start = threadIndex*numAtoms/numThreads;
+    int end = (threadIndex+1)*numAtoms/numThreads;
+    for (int i = start; i < end; i++) {
+        int atom = (*atomList)[i];
+        if (masses[atom] != 0.0)
+            velocities[atom] += inverseMasses[atom]*forces[atom]*dt;
+    }
+
+    // Connected particles.
+
+    int numPairs = pairList->size();
+    start = threadIndex*numPairs/numThreads;
+    end = (threadIndex+1)*numPairs/numThreads;
+    for (int i = start; i < end; i++) {
+        int atom1 = get<0>((*pairList)[i]);
+        int atom2 = get<1>((*pairList)[i]);
+        double m1 = masses[atom1];
+        double m2 = masses[atom2];
+        double mass1fract = m1 / (m1 + m2);
+        double mass2fract = m2 / (m1 + m2);
+        double invRedMass = (m1 * m2 != 0.0) ? (m1 + m2)/(m1 * m2) : 0.0;
+        double invTotMass = (m1 + m2 != 0.0) ? 1.0 /(m1 + m2) : 0.0;
+        Vec3 comVel = velocities[atom1]*mass1fract + velocities[atom2]*mass2fract;
+        Vec3 relVel = velocities[atom2] - velocities[atom1];
+        Vec3 comForce = forces[atom1] + forces[atom2];
+        Vec3 relForce = mass1fract*forces[atom2] - mass2fract*forces[atom1];
+        comVel += comForce * dt * invTotMass;
+        relVel += relForce * dt * invRedMass;
+        if (m1 != 0.0)
+            velocities[atom1] = comVel - relVel*mass2fract;
+        if (m2 != 0.0)
+            velocities[atom2] = comVel + relVel*mass1fract;
+    }
+}
+
+void CpuNoseHooverDynamics::threadUpdate2(int threadIndex) {
+    const double halfdt = 0.5*getDeltaT();
+    int start = threadIndex*numberOfAtoms/threads.getNumThreads();
+    int end = (threadIndex+1)*numberOfAtoms/threads.getNumThreads();
+
+    for (int i = start; i < end; i++)
+        if (inverseMasses[i] != 0.0)
+            xPrime[i] = atomCoordinates[i] + velocities[i]*halfdt;
+}
+
+void CpuNoseHooverDynamics::threadUpdate3(int threadIndex) {
+    const double halfdt = 0.5*getDeltaT();
+    int start = threadIndex*numberOfAtoms/threads.getNumThreads();
+    int end = (threadIndex+1)*numberOfAtoms/threads.getNumThreads();
+
+    for (int i = start; i < end; i++)
+        if (inverseMasses[i] != 0.0) {
+            xPrime[i] += velocities[i]*halfdt;
+            oldx[i] = xPrime[i];
+        }
+}
+
+void CpuNoseHooverDynamics::threadUpdate4(int threadIndex) {
+    int start = threadIndex*numberOfAtoms/threads.getNumThreads();
+    int end = (threadIndex+1)*numberOfAtoms/threads.getNumThreads();
+
+    for (int i = start; i < end; i++)
+        if (inverseMasses[i] != 0.0) {
+            velocities[i] += (xPrime[i]-oldx[i])/getDeltaT();
+            atomCoordinates[i] = xPrime[i];
+        }
+}
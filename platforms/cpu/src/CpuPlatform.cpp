@@ -33,10 +33,13 @@
 #include "CpuKernelFactory.h"
 #include "CpuKernels.h"
 #include "CpuSETTLE.h"
+#include "CpuCCMA.h"
+#include "CpuLINCS.h"
 #include "ReferenceConstraints.h"
 #include "openmm/OpenMMException.h"
 #include "openmm/internal/hardware.h"
 #include "openmm/internal/vectorize.h"
+#include "hilbert.h"
 #include <algorithm>
 #include <sstream>
 #include <stdlib.h>
@@ -64,18 +67,36 @@ CpuPlatform::CpuPlatform() {
     deprecatedPropertyReplacements["CpuThreads"] = CpuThreads();
     CpuKernelFactory* factory = new CpuKernelFactory();
     registerKernelFactory(CalcForcesAndEnergyKernel::Name(), factory);
+    registerKernelFactory(CalcHarmonicBondForceKernel::Name(), factory);
     registerKernelFactory(CalcHarmonicAngleForceKernel::Name(), factory);
     registerKernelFactory(CalcPeriodicTorsionForceKernel::Name(), factory);
     registerKernelFactory(CalcRBTorsionForceKernel::Name(), factory);
     registerKernelFactory(CalcNonbondedForceKernel::Name(), factory);
     registerKernelFactory(CalcCustomNonbondedForceKernel::Name(), factory);
     registerKernelFactory(CalcCustomManyParticleForceKernel::Name(), factory);
+    registerKernelFactory(CalcCustomHbondForceKernel::Name(), factory);
+    registerKernelFactory(CalcCustomCompoundBondForceKernel::Name(), factory);
+    registerKernelFactory(CalcCustomCentroidBondForceKernel::Name(), factory);
     registerKernelFactory(CalcGBSAOBCForceKernel::Name(), factory);
     registerKernelFactory(CalcCustomGBForceKernel::Name(), factory);
     registerKernelFactory(CalcGayBerneForceKernel::Name(), factory);
     registerKernelFactory(IntegrateLangevinMiddleStepKernel::Name(), factory);
+    registerKernelFactory(IntegrateVerletStepKernel::Name(), factory);
+    registerKernelFactory(IntegrateNoseHooverStepKernel::Name(), factory);
+    registerKernelFactory(IntegrateBrownianStepKernel::Name(), factory);
+    registerKernelFactory(IntegrateVariableLangevinStepKernel::Name(), factory);
+    registerKernelFactory(IntegrateVariableVerletStepKernel::Name(), factory);
+    registerKernelFactory(IntegrateCustomStepKernel::Name(), factory);
     platformProperties.push_back(CpuThreads());
     platformProperties.push_back(CpuDeterministicForces());
+    platformProperties.push_back(CpuSpatialForceAccumulation());
+    platformProperties.push_back(CpuParticleReordering());
+    platformProperties.push_back(CpuConcurrentForces());
+    platformProperties.push_back(CpuNeighborListPruning());
+    platformProperties.push_back(CpuVerletBufferTolerance());
+    platformProperties.push_back(CpuConstraintAlgorithm());
+    platformProperties.push_back(CpuTabulatedNonbonded());
+    platformProperties.push_back(CpuClusterPairList());
     int threads = getNumProcessors();
     char* threadsEnv = getenv("OPENMM_CPU_THREADS");
     if (threadsEnv != NULL)
@@ -84,6 +105,14 @@ CpuPlatform::CpuPlatform() {
     defaultThreads << threads;
     setPropertyDefaultValue(CpuThreads(), defaultThreads.str());
     setPropertyDefaultValue(CpuDeterministicForces(), "false");
+    setPropertyDefaultValue(CpuSpatialForceAccumulation(), "false");
+    setPropertyDefaultValue(CpuParticleReordering(), "false");
+    setPropertyDefaultValue(CpuConcurrentForces(), "true");
+    setPropertyDefaultValue(CpuNeighborListPruning(), "false");
+    setPropertyDefaultValue(CpuVerletBufferTolerance(), "0");
+    setPropertyDefaultValue(CpuConstraintAlgorithm(), "CCMA");
+    setPropertyDefaultValue(CpuTabulatedNonbonded(), "false");
+    setPropertyDefaultValue(CpuClusterPairList(), "true");
 }
 
 const string& CpuPlatform::getPropertyValue(const Context& context, const string& property) const {
@@ -116,11 +145,47 @@ void CpuPlatform::contextCreated(ContextImpl& context, const map<string, string>
             getPropertyDefaultValue(CpuThreads()) : properties.find(CpuThreads())->second);
     string deterministicForcesValue = (properties.find(CpuDeterministicForces()) == properties.end() ?
             getPropertyDefaultValue(CpuDeterministicForces()) : properties.find(CpuDeterministicForces())->second);
+    string spatialForcesValue = (properties.find(CpuSpatialForceAccumulation()) == properties.end() ?
+            getPropertyDefaultValue(CpuSpatialForceAccumulation()) : properties.find(CpuSpatialForceAccumulation())->second);
+    string reorderingValue = (properties.find(CpuParticleReordering()) == properties.end() ?
+            getPropertyDefaultValue(CpuParticleReordering()) : properties.find(CpuParticleReordering())->second);
+    string concurrentValue = (properties.find(CpuConcurrentForces()) == properties.end() ?
+            getPropertyDefaultValue(CpuConcurrentForces()) : properties.find(CpuConcurrentForces())->second);
+    string pruningValue = (properties.find(CpuNeighborListPruning()) == properties.end() ?
+            getPropertyDefaultValue(CpuNeighborListPruning()) : properties.find(CpuNeighborListPruning())->second);
+    const string& toleranceValue = (properties.find(CpuVerletBufferTolerance()) == properties.end() ?
+            getPropertyDefaultValue(CpuVerletBufferTolerance()) : properties.find(CpuVerletBufferTolerance())->second);
+    string constraintValue = (properties.find(CpuConstraintAlgorithm()) == properties.end() ?
+            getPropertyDefaultValue(CpuConstraintAlgorithm()) : properties.find(CpuConstraintAlgorithm())->second);
+    string tabulatedValue = (properties.find(CpuTabulatedNonbonded()) == properties.end() ?
+            getPropertyDefaultValue(CpuTabulatedNonbonded()) : properties.find(CpuTabulatedNonbonded())->second);
+    string clusterPairValue = (properties.find(CpuClusterPairList()) == properties.end() ?
+            getPropertyDefaultValue(CpuClusterPairList()) : properties.find(CpuClusterPairList())->second);
     int numThreads;
     stringstream(threadsPropValue) >> numThreads;
     transform(deterministicForcesValue.begin(), deterministicForcesValue.end(), deterministicForcesValue.begin(), ::tolower);
     bool deterministicForces = (deterministicForcesValue == "true");
-    PlatformData* data = new PlatformData(context.getSystem().getNumParticles(), numThreads, deterministicForces);
+    transform(spatialForcesValue.begin(), spatialForcesValue.end(), spatialForcesValue.begin(), ::tolower);
+    bool spatialForces = (spatialForcesValue == "true");
+    transform(reorderingValue.begin(), reorderingValue.end(), reorderingValue.begin(), ::tolower);
+    bool reordering = (reorderingValue == "true");
+    transform(concurrentValue.begin(), concurrentValue.end(), concurrentValue.begin(), ::tolower);
+    bool concurrent = (concurrentValue == "true");
+    transform(pruningValue.begin(), pruningValue.end(), pruningValue.begin(), ::tolower);
+    bool pruning = (pruningValue == "true");
+    double tolerance;
+    stringstream(toleranceValue) >> tolerance;
+    if (tolerance < 0.0)
+        throw OpenMMException("VerletBufferTolerance cannot be negative");
+    transform(constraintValue.begin(), constraintValue.end(), constraintValue.begin(), ::toupper);
+    if (constraintValue != "CCMA" && constraintValue != "LINCS")
+        throw OpenMMException("Illegal value for ConstraintAlgorithm: "+constraintValue);
+    transform(tabulatedValue.begin(), tabulatedValue.end(), tabulatedValue.begin(), ::tolower);
+    bool tabulated = (tabulatedValue == "true");
+    transform(clusterPairValue.begin(), clusterPairValue.end(), clusterPairValue.begin(), ::tolower);
+    bool clusterPairs = (clusterPairValue == "true");
+    PlatformData* data = new PlatformData(context.getSystem().getNumParticles(), numThreads, deterministicForces, spatialForces, reordering, concurrent,
+            pruning, tolerance, constraintValue, tabulated, clusterPairs);
     contextData[&context] = data;
     ReferenceConstraints& constraints = *(ReferenceConstraints*) reinterpret_cast<ReferencePlatform::PlatformData*>(context.getPlatformData())->constraints;
     if (constraints.settle != NULL) {
@@ -128,6 +193,16 @@ void CpuPlatform::contextCreated(ContextImpl& context, const map<string, string>
         delete constraints.settle;
         constraints.settle = parallelSettle;
     }
+    if (constraints.ccma != NULL) {
+        const ReferenceCCMAAlgorithm& ccma = *(ReferenceCCMAAlgorithm*) constraints.ccma;
+        ReferenceConstraintAlgorithm* parallelConstraints;
+        if (constraintValue == "LINCS")
+            parallelConstraints = new CpuLINCS(ccma, data->threads);
+        else
+            parallelConstraints = new CpuCCMA(ccma, data->threads);
+        delete constraints.ccma;
+        constraints.ccma = parallelConstraints;
+    }
 }
 
 void CpuPlatform::contextDestroyed(ContextImpl& context) const {
@@ -146,28 +221,59 @@ const CpuPlatform::PlatformData& CpuPlatform::getPlatformData(const ContextImpl&
     return *contextData[&context];
 }
 
-CpuPlatform::PlatformData::PlatformData(int numParticles, int numThreads, bool deterministicForces) : posq(4*numParticles), threads(numThreads),
-        deterministicForces(deterministicForces), numParticles(numParticles), neighborList(NULL), cutoff(0.0), paddedCutoff(0.0), anyExclusions(false),
-        currentPosqIndex(-1), nextPosqIndex(0) {
+CpuPlatform::PlatformData::PlatformData(int numParticles, int numThreads, bool deterministicForces, bool spatialForceAccumulation, bool particleReordering,
+            bool concurrentForces, bool neighborListPruning, double verletBufferTolerance,
+            const string& constraintAlgorithm, bool tabulatedNonbonded, bool clusterPairList) :
+        posq(4*numParticles), forceRegions(NULL), threads(numThreads), deterministicForces(deterministicForces), particleReordering(particleReordering),
+        concurrentForces(concurrentForces),
+        neighborListPruning(neighborListPruning), numParticles(numParticles), neighborList(NULL), cutoff(0.0), paddedCutoff(0.0), requestedPadding(0.0),
+        verletBufferTolerance(verletBufferTolerance),
+        tabulatedNonbonded(tabulatedNonbonded), clusterPairList(clusterPairList), anyExclusions(false), currentPosqIndex(-1), nextPosqIndex(0), atomOrderVersion(0), atomOrder(numParticles),
+        inverseAtomOrder(numParticles) {
     numThreads = threads.getNumThreads();
     threadForce.resize(numThreads);
-    for (int i = 0; i < numThreads; i++)
-        threadForce[i].resize(4*numParticles);
+    if (spatialForceAccumulation) {
+        // Each thread only writes to a small part of its buffer, so let the operating system allocate the
+        // memory lazily as it gets used.
+
+        for (int i = 0; i < numThreads; i++)
+            threadForce[i].resizeZeroed(4*numParticles);
+        forceRegions = new CpuForceRegions(numParticles, numThreads);
+    }
+    else
+        for (int i = 0; i < numThreads; i++)
+            threadForce[i].resize(4*numParticles);
+    for (int i = 0; i < numParticles; i++)
+        atomOrder[i] = inverseAtomOrder[i] = i;
     isPeriodic = false;
     stringstream threadsProperty;
     threadsProperty << numThreads;
     propertyValues[CpuThreads()] = threadsProperty.str();
     propertyValues[CpuDeterministicForces()] = deterministicForces ? "true" : "false";
+    propertyValues[CpuSpatialForceAccumulation()] = spatialForceAccumulation ? "true" : "false";
+    propertyValues[CpuParticleReordering()] = particleReordering ? "true" : "false";
+    propertyValues[CpuConcurrentForces()] = concurrentForces ? "true" : "false";
+    propertyValues[CpuNeighborListPruning()] = neighborListPruning ? "true" : "false";
+    stringstream toleranceProperty;
+    toleranceProperty << verletBufferTolerance;
+    propertyValues[CpuVerletBufferTolerance()] = toleranceProperty.str();
+    propertyValues[CpuConstraintAlgorithm()] = constraintAlgorithm;
+    propertyValues[CpuTabulatedNonbonded()] = tabulatedNonbonded ? "true" : "false";
+    propertyValues[CpuClusterPairList()] = clusterPairList ? "true" : "false";
 }
 
 CpuPlatform::PlatformData::~PlatformData() {
     if (neighborList != NULL)
         delete neighborList;
+    if (forceRegions != NULL)
+        delete forceRegions;
 }
 
 void CpuPlatform::PlatformData::requestNeighborList(double cutoffDistance, double padding, bool useExclusions, const vector<set<int> >& exclusionList) {
     if (neighborList == NULL) {
         neighborList = new CpuNeighborList(getVectorWidth());
+        neighborList->setUsePruning(neighborListPruning);
+        neighborList->setUseClusterPairs(clusterPairList);
         if (cutoffDistance == 0.0)
             neighborList->createDenseNeighborList(numParticles, exclusionList);
     }
@@ -177,6 +283,7 @@ void CpuPlatform::PlatformData::requestNeighborList(double cutoffDistance, doubl
         cutoff = cutoffDistance;
     if (cutoffDistance+padding > paddedCutoff)
         paddedCutoff = cutoffDistance+padding;
+    requestedPadding = paddedCutoff-cutoff;
     if (useExclusions) {
         if (anyExclusions && exclusions != exclusionList)
             throw OpenMMException("All Forces must have identical exclusions");
@@ -191,4 +298,158 @@ void CpuPlatform::PlatformData::requestNeighborList(double cutoffDistance, doubl
 
 int CpuPlatform::PlatformData::requestPosqIndex() {
     return nextPosqIndex++;
-}
\ No newline at end of file
+}
+
+void CpuPlatform::PlatformData::markAllThreadForces() {
+    if (forceRegions != NULL)
+        forceRegions->markAll();
+}
+
+void CpuPlatform::PlatformData::reorderParticles() {
+    if (!particleReordering || numParticles == 0)
+        return;
+
+    // Sort the atoms along a Hilbert curve.  This uses the same binning as CpuNeighborList, and ties are
+    // broken by atom index, so the neighbor list will find the atoms already in sorted order.
+
+    fvec4 minPos(&posq[0]);
+    fvec4 maxPos = minPos;
+    for (int i = 1; i < numParticles; i++) {
+        fvec4 pos(&posq[4*i]);
+        minPos = min(minPos, pos);
+        maxPos = max(maxPos, pos);
+    }
+    float binWidth = max(max(maxPos[0]-minPos[0], maxPos[1]-minPos[1]), maxPos[2]-minPos[2])/255.0f;
+
+    // If every particle is at the same position (or a coordinate is not finite), there is nothing to sort, so
+    // keep the current order.
+    if (binWidth > 0.0f) {
+        float invBinWidth = 1.0f/binWidth;
+        vector<pair<int, int> > atomBins(numParticles);
+        bitmask_t coords[3];
+        for (int i = 0; i < numParticles; i++) {
+            const float* pos = &posq[4*i];
+            coords[0] = (bitmask_t) ((pos[0]-minPos[0])*invBinWidth);
+            coords[1] = (bitmask_t) ((pos[1]-minPos[1])*invBinWidth);
+            coords[2] = (bitmask_t) ((pos[2]-minPos[2])*invBinWidth);
+            atomBins[i] = make_pair((int) hilbert_c2i(3, 8, coords), atomOrder[i]);
+        }
+        sort(atomBins.begin(), atomBins.end());
+
+        // Permute posq into the new order.
+
+        AlignedArray<float> oldPosq(4*numParticles);
+        for (int i = 0; i < 4*numParticles; i++)
+            oldPosq[i] = posq[i];
+        for (int i = 0; i < numParticles; i++) {
+            int atom = atomBins[i].second;
+            fvec4(&oldPosq[4*inverseAtomOrder[atom]]).store(&posq[4*i]);
+        }
+        for (int i = 0; i < numParticles; i++) {
+            atomOrder[i] = atomBins[i].second;
+            inverseAtomOrder[atomOrder[i]] = i;
+        }
+    }
+    reorderExclusions(exclusions, orderedExclusions);
+    atomOrderVersion++;
+}
+
+void CpuPlatform::PlatformData::reorderExclusions(const vector<set<int> >& exclusionList, vector<set<int> >& result) const {
+    result.resize(exclusionList.size());
+    for (int i = 0; i < (int) exclusionList.size(); i++) {
+        result[i].clear();
+        for (int j : exclusionList[atomOrder[i]])
+            result[i].insert(inverseAtomOrder[j]);
+    }
+}
+
+void CpuPlatform::PlatformData::beginUnorderedComputation() {
+    int numThreads = threads.getNumThreads();
+    if (unorderedPosq.size() != 4*numParticles) {
+        unorderedPosq.resize(4*numParticles);
+        unorderedForce.resize(numThreads);
+        for (int i = 0; i < numThreads; i++) {
+            unorderedForce[i].resize(4*numParticles);
+            for (int j = 0; j < 4*numParticles; j++)
+                unorderedForce[i][j] = 0.0f;
+        }
+    }
+    threads.execute([&] (ThreadPool& threads, int threadIndex) {
+        int start = threadIndex*numParticles/numThreads;
+        int end = (threadIndex+1)*numParticles/numThreads;
+        for (int i = start; i < end; i++)
+            fvec4(&posq[4*i]).store(&unorderedPosq[4*atomOrder[i]]);
+    });
+    threads.waitForThreads();
+}
+
+void CpuPlatform::PlatformData::endUnorderedComputation() {
+    // Each thread adds its own buffer, so no synchronization is needed.
+
+    threads.execute([&] (ThreadPool& threads, int threadIndex) {
+        float* source = &unorderedForce[threadIndex][0];
+        float* dest = &threadForce[threadIndex][0];
+        fvec4 zero(0.0f);
+        for (int i = 0; i < numParticles; i++) {
+            float* f = &dest[4*inverseAtomOrder[i]];
+            (fvec4(f)+fvec4(&source[4*i])).store(f);
+            zero.store(&source[4*i]);
+        }
+    });
+    threads.waitForThreads();
+    markAllThreadForces();
+}
+
+int CpuPlatform::PlatformData::addConcurrentForce() {
+    concurrentForceBuffers.push_back(vector<Vec3>(numParticles));
+    concurrentForceUsed.push_back(false);
+    return concurrentForceBuffers.size()-1;
+}
+
+vector<Vec3>& CpuPlatform::PlatformData::beginConcurrentForce(int index) {
+    // The buffers are cleared as they are added to the total, so they are ready to use.
+
+    concurrentForceUsed[index] = true;
+    return concurrentForceBuffers[index];
+}
+
+void CpuPlatform::PlatformData::endConcurrentForce(const ThreadPool::TaskHandle& task, bool wait) {
+    if (concurrentForces && !wait)
+        threads.startTasks();
+    else
+        threads.executeTasks();
+}
+
+void CpuPlatform::PlatformData::finishConcurrentForces(vector<Vec3>& forces) {
+    threads.executeTasks();
+    vector<Vec3*> buffers;
+    for (int i = 0; i < concurrentForceBuffers.size(); i++)
+        if (concurrentForceUsed[i]) {
+            buffers.push_back(&concurrentForceBuffers[i][0]);
+            concurrentForceUsed[i] = false;
+        }
+    if (buffers.size() == 0)
+        return;
+    threads.parallelFor(numParticles, max(1, numParticles/(10*threads.getNumThreads())), [&] (ThreadPool& threads, int threadIndex, int start, int end) {
+        for (int i = start; i < end; i++)
+            for (Vec3* buffer : buffers) {
+                forces[i] += buffer[i];
+                buffer[i] = Vec3();
+            }
+    });
+}
+
+void CpuPlatform::PlatformData::discardConcurrentForces() {
+    try {
+        threads.executeTasks();
+    }
+    catch (...) {
+        // The evaluation that added the tasks already failed, so there is nothing more to report.
+    }
+    for (int i = 0; i < concurrentForceBuffers.size(); i++)
+        if (concurrentForceUsed[i]) {
+            for (Vec3& f : concurrentForceBuffers[i])
+                f = Vec3();
+            concurrentForceUsed[i] = false;
+        }
+}
@@ -49,6 +49,8 @@ void CpuRandom::initialize(int seed, int numThreads) {
     threadRandom.resize(numThreads);
     nextGaussian.resize(numThreads);
     nextGaussianIsValid.resize(numThreads, false);
+    nextGaussianDouble.resize(numThreads);
+    nextGaussianDoubleIsValid.resize(numThreads, false);
 
     /* Use a quick and dirty RNG to pick seeds for the real random number generator.
      * A random seed of 0 means pick a unique seed
@@ -84,6 +86,23 @@ float CpuRandom::getGaussianRandom(int threadIndex) {
     return x*multiplier;
 }
 
-float CpuRandom::getUniformRandom(int threadIndex) {
+double CpuRandom::getGaussianRandomDouble(int threadIndex) {
+    if (nextGaussianDoubleIsValid[threadIndex]) {
+        nextGaussianDoubleIsValid[threadIndex] = false;
+        return nextGaussianDouble[threadIndex];
+    }
+    double x, y, r2;
+    do {
+        x = 2.0*genrand_real2(*threadRandom[threadIndex])-1.0;
+        y = 2.0*genrand_real2(*threadRandom[threadIndex])-1.0;
+        r2 = x*x + y*y;
+    } while (r2 >= 1.0 || r2 == 0.0);
+    double multiplier = sqrt((-2.0*log(r2))/r2);
+    nextGaussianDouble[threadIndex] = y*multiplier;
+    nextGaussianDoubleIsValid[threadIndex] = true;
+    return x*multiplier;
+}
+
+double CpuRandom::getUniformRandom(int threadIndex) {
     return genrand_real2(*threadRandom[threadIndex]);
 }
@@ -0,0 +1,128 @@
+/* Portions copyright (c) 2026 Stanford University and Simbios.
+ * Authors: Peter Eastman
+ * Contributors: 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "CpuVariableVerletDynamics.h"
+
+using namespace OpenMM;
+using namespace std;
+
+CpuVariableVerletDynamics::CpuVariableVerletDynamics(int numberOfAtoms, double accuracy, ThreadPool& threads) :
+           ReferenceVariableVerletDynamics(numberOfAtoms, accuracy), threads(threads) {
+    threadError.resize(threads.getNumThreads());
+}
+
+CpuVariableVerletDynamics::~CpuVariableVerletDynamics() {
+}
+
+double CpuVariableVerletDynamics::computeForceError(int numberOfAtoms, vector<Vec3>& forces, vector<double>& inverseMasses) {
+    // Record the parameters for the threads.
+
+    this->numberOfAtoms = numberOfAtoms;
+    this->forces = &forces[0];
+    this->inverseMasses = &inverseMasses[0];
+
+    // Signal the threads to start running and wait for them to finish.
+
+    threads.execute([&] (ThreadPool& threads, int threadIndex) { threadComputeError(threadIndex); });
+    threads.waitForThreads();
+
+    // Combine the results from the threads in a fixed order so the result is deterministic.
+
+    double error = 0.0;
+    for (double e : threadError)
+        error += e;
+    return sqrt(error/(numberOfAtoms*3));
+}
+
+void CpuVariableVerletDynamics::updatePart1(int numberOfAtoms, vector<Vec3>& atomCoordinates, vector<Vec3>& velocities,
+                                            vector<Vec3>& forces, vector<double>& inverseMasses, vector<Vec3>& xPrime, double vstep) {
+    // Record the parameters for the threads.
+
+    this->numberOfAtoms = numberOfAtoms;
+    this->vstep = vstep;
+    this->atomCoordinates = &atomCoordinates[0];
+    this->velocities = &velocities[0];
+    this->forces = &forces[0];
+    this->inverseMasses = &inverseMasses[0];
+    this->xPrime = &xPrime[0];
+
+    // Signal the threads to start running and wait for them to finish.
+
+    threads.execute([&] (ThreadPool& threads, int threadIndex) { threadUpdate1(threadIndex); });
+    threads.waitForThreads();
+}
+
+void CpuVariableVerletDynamics::updatePart2(int numberOfAtoms, vector<Vec3>& atomCoordinates, vector<Vec3>& velocities,
+                                            vector<double>& inverseMasses, vector<Vec3>& xPrime) {
+    // Record the parameters for the threads.
+
+    this->numberOfAtoms = numberOfAtoms;
+    this->atomCoordinates = &atomCoordinates[0];
+    this->velocities = &velocities[0];
+    this->inverseMasses = &inverseMasses[0];
+    this->xPrime = &xPrime[0];
+
+    // Signal the threads to start running and wait for them to finish.
+
+    threads.execute([&] (ThreadPool& threads, int threadIndex) { threadUpdate2(threadIndex); });
+    threads.waitForThreads();
+}
+
+void CpuVariableVerletDynamics::threadComputeError(int threadIndex) {
+    int start = threadIndex*numberOfAtoms/threads.getNumThreads();
+    int end = (threadIndex+1)*numberOfAtoms/threads.getNumThreads();
+    double error = 0.0;
+    for (int i = start; i < end; i++)
+        for (int j = 0; j < 3; j++) {
+            double xerror = inverseMasses[i]*forces[i][j];
+            error += xerror*xerror;
+        }
+    threadError[threadIndex] = error;
+}
+
+void CpuVariableVerletDynamics::threadUpdate1(int threadIndex) {
+    const double dt = getDeltaT();
+    int start = threadIndex*numberOfAtoms/threads.getNumThreads();
+    int end = (threadIndex+1)*numberOfAtoms/threads.getNumThreads();
+
+    for (int i = start; i < end; i++)
+        if (inverseMasses[i] != 0.0)
+            for (int j = 0; j < 3; j++) {
+                double vPrime = velocities[i][j] + inverseMasses[i]*forces[i][j]*vstep;
+                xPrime[i][j] = atomCoordinates[i][j] + vPrime*dt;
+            }
+}
+
+void CpuVariableVerletDynamics::threadUpdate2(int threadIndex) {
+    const double velocityScale = 1.0/getDeltaT();
+    int start = threadIndex*numberOfAtoms/threads.getNumThreads();
+    int end = (threadIndex+1)*numberOfAtoms/threads.getNumThreads();
+
+    for (int i = start; i < end; i++)
+        if (inverseMasses[i] != 0.0)
+            for (int j = 0; j < 3; j++) {
+                velocities[i][j] = velocityScale*(xPrime[i][j] - atomCoordinates[i][j]);
+                atomCoordinates[i][j] = xPrime[i][j];
+            }
+}
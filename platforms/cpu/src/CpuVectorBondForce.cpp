@@ -0,0 +1,182 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "CpuVectorBondForce.h"
+#include "openmm/OpenMMException.h"
+#include "openmm/internal/hardware.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace OpenMM;
+using namespace std;
+
+CpuVectorBondForce* createCpuVectorBondForceVec4(CpuVectorBondForce::BondType type);
+CpuVectorBondForce* createCpuVectorBondForceAvx(CpuVectorBondForce::BondType type);
+CpuVectorBondForce* createCpuVectorBondForceAvx512(CpuVectorBondForce::BondType type);
+
+CpuVectorBondForce* OpenMM::createCpuVectorBondForce(CpuVectorBondForce::BondType type) {
+    if (isAvx512Supported())
+        return createCpuVectorBondForceAvx512(type);
+    if (isAvxSupported())
+        return createCpuVectorBondForceAvx(type);
+    else
+        return createCpuVectorBondForceVec4(type);
+}
+
+CpuVectorBondForce::CpuVectorBondForce(BondType type, int blockSize) : type(type), blockSize(blockSize), threads(NULL) {
+    numAtomsPerBond = getNumAtomsPerBond(type);
+    numParams = getNumParameters(type);
+    numPackedParams = (type == PeriodicTorsion ? 4 : numParams);
+}
+
+CpuVectorBondForce::~CpuVectorBondForce() {
+}
+
+int CpuVectorBondForce::getNumAtomsPerBond(BondType type) {
+    switch (type) {
+        case HarmonicBond:
+            return 2;
+        case HarmonicAngle:
+            return 3;
+        case PeriodicTorsion:
+        case RBTorsion:
+            return 4;
+    }
+    throw OpenMMException("CpuVectorBondForce: Unknown bond type");
+}
+
+int CpuVectorBondForce::getNumParameters(BondType type) {
+    switch (type) {
+        case HarmonicBond:
+        case HarmonicAngle:
+            return 2;
+        case PeriodicTorsion:
+            return 3;
+        case RBTorsion:
+            return 6;
+    }
+    throw OpenMMException("CpuVectorBondForce: Unknown bond type");
+}
+
+void CpuVectorBondForce::initialize(int numAtoms, vector<vector<int> >& bondAtoms, ThreadPool& threads) {
+    this->threads = &threads;
+    int numBonds = bondAtoms.size();
+    for (int i = 0; i < numBonds; i++)
+        if (bondAtoms[i].size() != (size_t) numAtomsPerBond)
+            throw OpenMMException("CpuVectorBondForce: Wrong number of atoms in bond");
+    partition.initialize(numAtoms, numBonds, numAtomsPerBond, bondAtoms, threads);
+    const vector<vector<int> >& threadBonds = partition.getThreadBonds();
+    threadBlocks.resize(threadBonds.size());
+    for (int i = 0; i < threadBonds.size(); i++)
+        packBonds(threadBonds[i], bondAtoms, threadBlocks[i]);
+    packBonds(partition.getExtraBonds(), bondAtoms, extraBlock);
+}
+
+void CpuVectorBondForce::packBonds(const vector<int>& bonds, vector<vector<int> >& bondAtoms, BondBlock& block) {
+    block.numBonds = bonds.size();
+    block.bondIndex = bonds;
+    int paddedSize = blockSize*((block.numBonds+blockSize-1)/blockSize);
+    block.atoms.resize(numAtomsPerBond);
+    block.maxPeriodicity = 0;
+    block.params.resize(numPackedParams);
+    for (int j = 0; j < numAtomsPerBond; j++) {
+        block.atoms[j].resize(paddedSize);
+        for (int i = 0; i < paddedSize; i++)
+            block.atoms[j][i] = bondAtoms[bonds[i < block.numBonds ? i : 0]][j];
+    }
+    for (int j = 0; j < numPackedParams; j++)
+        block.params[j].resize(paddedSize, 0.0f);
+}
+
+void CpuVectorBondForce::setParameters(const vector<vector<double> >& parameters) {
+    for (BondBlock& block : threadBlocks)
+        copyParameters(parameters, block);
+    copyParameters(parameters, extraBlock);
+}
+
+void CpuVectorBondForce::copyParameters(const vector<vector<double> >& parameters, BondBlock& block) {
+    if (type == PeriodicTorsion) {
+        block.maxPeriodicity = 0;
+        for (int i = 0; i < block.numBonds; i++) {
+            const vector<double>& params = parameters[block.bondIndex[i]];
+            int periodicity = (int) params[2];
+            block.params[0][i] = (float) params[0];
+            block.params[1][i] = (float) cos(params[1]);
+            block.params[2][i] = (float) sin(params[1]);
+            block.params[3][i] = (float) periodicity;
+            block.maxPeriodicity = max(block.maxPeriodicity, periodicity);
+        }
+    }
+    else {
+        for (int i = 0; i < block.numBonds; i++)
+            for (int j = 0; j < numParams; j++)
+                block.params[j][i] = (float) parameters[block.bondIndex[i]][j];
+    }
+}
+
+void CpuVectorBondForce::calculateForce(const vector<Vec3>& atomCoordinates, vector<Vec3>& forces, double* totalEnergy, const Vec3* boxVectors) {
+    addForceTasks(atomCoordinates, forces, totalEnergy, boxVectors, vector<ThreadPool::TaskHandle>());
+    threads->executeTasks();
+}
+
+ThreadPool::TaskHandle CpuVectorBondForce::addForceTasks(const vector<Vec3>& atomCoordinates, vector<Vec3>& forces, double* totalEnergy,
+            const Vec3* boxVectors, const vector<ThreadPool::TaskHandle>& dependencies) {
+    // The tasks may run after the caller returns, so keep a copy of the box vectors.
+
+    const Vec3* box = NULL;
+    if (boxVectors != NULL) {
+        for (int i = 0; i < 3; i++)
+            periodicBoxVectors[i] = boxVectors[i];
+        box = periodicBoxVectors;
+    }
+
+    // Add one task for each block.  No two blocks share any atoms, so they can be processed in any
+    // order by whichever threads are free.
+
+    int numBlocks = threadBlocks.size();
+    blockEnergy.assign(numBlocks, 0.0);
+    vector<ThreadPool::TaskHandle> blockTasks = dependencies;
+    for (int i = 0; i < numBlocks; i++)
+        blockTasks.push_back(threads->addTask([this, i, totalEnergy, box, &atomCoordinates, &forces] (ThreadPool& threads, int threadIndex) {
+            double* energy = (totalEnergy == NULL ? NULL : &blockEnergy[i]);
+            calculateBlockIxn(threadBlocks[i], atomCoordinates, forces, energy, box);
+        }, dependencies));
+
+    // Once all of them have finished, compute any "extra" bonds and the total energy.
+
+    return threads->addTask([this, totalEnergy, box, &atomCoordinates, &forces] (ThreadPool& threads, int threadIndex) {
+        if (extraBlock.numBonds > 0)
+            calculateBlockIxn(extraBlock, atomCoordinates, forces, totalEnergy, box);
+        if (totalEnergy != NULL)
+            for (double energy : blockEnergy)
+                *totalEnergy += energy;
+    }, blockTasks);
+}
@@ -0,0 +1,72 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "openmm/internal/AssertionUtilities.h"
+#include "openmm/Context.h"
+#include "openmm/System.h"
+#include "openmm/VerletIntegrator.h"
+#include "ReferencePlatform.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * Check that the CPU platform computes the same energy, forces, and energy parameter derivatives
+ * as the Reference platform for a System.  After the first comparison, update() is called to
+ * change the parameters in both Contexts, and they are compared again.
+ *
+ * @param system            the System to compute
+ * @param positions         the positions of the particles
+ * @param derivativeNames   the global parameters whose energy derivatives should be compared
+ * @param update            called with the Reference and CPU Contexts to change parameters between comparisons
+ * @param forceTolerance    the tolerance for comparing forces
+ */
+void compareToReference(const OpenMM::System& system, const std::vector<OpenMM::Vec3>& positions, const std::vector<std::string>& derivativeNames,
+        std::function<void(OpenMM::Context&, OpenMM::Context&)> update, double forceTolerance=1e-4) {
+    OpenMM::VerletIntegrator integrator1(0.01);
+    OpenMM::VerletIntegrator integrator2(0.01);
+    OpenMM::ReferencePlatform reference;
+    OpenMM::Context context1(system, integrator1, reference);
+    OpenMM::Context context2(system, integrator2, platform);
+    context1.setPositions(positions);
+    context2.setPositions(positions);
+    for (int iteration = 0; iteration < 2; iteration++) {
+        OpenMM::State state1 = context1.getState(OpenMM::State::Forces | OpenMM::State::Energy | OpenMM::State::ParameterDerivatives);
+        OpenMM::State state2 = context2.getState(OpenMM::State::Forces | OpenMM::State::Energy | OpenMM::State::ParameterDerivatives);
+        ASSERT_EQUAL_TOL(state1.getPotentialEnergy(), state2.getPotentialEnergy(), 1e-5);
+        for (const std::string& name : derivativeNames)
+            ASSERT_EQUAL_TOL(state1.getEnergyParameterDerivatives().at(name), state2.getEnergyParameterDerivatives().at(name), 1e-5);
+        for (int i = 0; i < system.getNumParticles(); i++)
+            ASSERT_EQUAL_VEC(state1.getForces()[i], state2.getForces()[i], forceTolerance);
+        if (iteration == 0)
+            update(context1, context2);
+    }
+}
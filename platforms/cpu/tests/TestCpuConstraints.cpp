@@ -0,0 +1,209 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "CpuTests.h"
+#include "ReferencePlatform.h"
+#include "openmm/internal/AssertionUtilities.h"
+#include "openmm/Context.h"
+#include "openmm/HarmonicAngleForce.h"
+#include "openmm/HarmonicBondForce.h"
+#include "openmm/OpenMMException.h"
+#include "openmm/System.h"
+#include "openmm/VerletIntegrator.h"
+#include "sfmt/SFMT.h"
+#include <iostream>
+#include <vector>
+
+using namespace OpenMM;
+using namespace std;
+
+/**
+ * Build a System of chains, each with a backbone of heavy atoms and hydrogens bonded to them.  If
+ * allBonds is true every bond is constrained, so each chain forms a single connected cluster.
+ * Otherwise only bonds to hydrogen are constrained.
+ */
+void buildChains(System& system, vector<Vec3>& positions, vector<Vec3>& velocities, int numChains, int chainLength, bool allBonds) {
+    HarmonicBondForce* bonds = new HarmonicBondForce();
+    HarmonicAngleForce* angles = new HarmonicAngleForce();
+    system.addForce(bonds);
+    system.addForce(angles);
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    for (int chain = 0; chain < numChains; chain++) {
+        int previous = -1;
+        for (int i = 0; i < chainLength; i++) {
+            int heavy = system.addParticle(12.0);
+            int hydrogen1 = system.addParticle(1.0);
+            int hydrogen2 = system.addParticle(1.0);
+            Vec3 center(0.15*i, 0.1*(i%2), 0.5*chain);
+            positions.push_back(center);
+            positions.push_back(center+Vec3(0, 0.1, 0));
+            positions.push_back(center+Vec3(0, -0.03333, 0.09428));
+            for (int j = 0; j < 3; j++)
+                velocities.push_back(Vec3(genrand_real2(sfmt)-0.5, genrand_real2(sfmt)-0.5, genrand_real2(sfmt)-0.5));
+            system.addConstraint(heavy, hydrogen1, 0.1);
+            system.addConstraint(heavy, hydrogen2, 0.1);
+            angles->addAngle(hydrogen1, heavy, hydrogen2, 1.91, 300.0);
+            if (previous != -1) {
+                double length = sqrt((positions[heavy]-positions[previous]).dot(positions[heavy]-positions[previous]));
+                if (allBonds)
+                    system.addConstraint(previous, heavy, length);
+                else
+                    bonds->addBond(previous, heavy, length, 1e5);
+                angles->addAngle(previous, heavy, hydrogen1, 1.91, 300.0);
+            }
+            previous = heavy;
+        }
+    }
+}
+
+void checkConstraints(const System& system, const State& state, double tolerance, bool checkVelocities) {
+    const vector<Vec3>& pos = state.getPositions();
+    for (int i = 0; i < system.getNumConstraints(); i++) {
+        int particle1, particle2;
+        double distance;
+        system.getConstraintParameters(i, particle1, particle2, distance);
+        Vec3 delta = pos[particle1]-pos[particle2];
+        double dist = sqrt(delta.dot(delta));
+        ASSERT_EQUAL_TOL(distance, dist, tolerance);
+        if (checkVelocities) {
+            const vector<Vec3>& vel = state.getVelocities();
+            double invMassSum = 1.0/system.getParticleMass(particle1)+1.0/system.getParticleMass(particle2);
+            ASSERT(fabs(delta.dot(vel[particle1]-vel[particle2])/(invMassSum*dist*dist)) <= tolerance);
+        }
+    }
+}
+
+void testConstraintAlgorithm(const string& algorithm, bool allBonds) {
+    // Simulate a system with several threads and make sure the constraints stay satisfied and the
+    // trajectory stays close to the Reference platform.
+
+    System system;
+    vector<Vec3> positions, velocities;
+    buildChains(system, positions, velocities, 8, 10, allBonds);
+    const double tolerance = 1e-6;
+    VerletIntegrator integrator(0.001);
+    integrator.setConstraintTolerance(tolerance);
+    map<string, string> properties;
+    properties[CpuPlatform::CpuThreads()] = "4";
+    properties[CpuPlatform::CpuConstraintAlgorithm()] = algorithm;
+    Context context(system, integrator, platform, properties);
+    ASSERT_EQUAL(algorithm, platform.getPropertyValue(context, CpuPlatform::CpuConstraintAlgorithm()));
+    context.setPositions(positions);
+    context.setVelocities(velocities);
+    context.applyConstraints(tolerance);
+    context.applyVelocityConstraints(tolerance);
+    checkConstraints(system, context.getState(State::Positions | State::Velocities), tolerance, true);
+    VerletIntegrator referenceIntegrator(0.001);
+    referenceIntegrator.setConstraintTolerance(tolerance);
+    ReferencePlatform reference;
+    Context referenceContext(system, referenceIntegrator, reference);
+    referenceContext.setPositions(positions);
+    referenceContext.setVelocities(velocities);
+    referenceContext.applyConstraints(tolerance);
+    referenceContext.applyVelocityConstraints(tolerance);
+    for (int i = 0; i < 20; i++) {
+        integrator.step(5);
+        referenceIntegrator.step(5);
+        checkConstraints(system, context.getState(State::Positions), tolerance, false);
+    }
+    context.applyVelocityConstraints(tolerance);
+    State state = context.getState(State::Positions | State::Velocities);
+    checkConstraints(system, state, tolerance, true);
+    State referenceState = referenceContext.getState(State::Positions);
+    for (int i = 0; i < system.getNumParticles(); i++)
+        ASSERT_EQUAL_VEC(referenceState.getPositions()[i], state.getPositions()[i], 1e-4);
+}
+
+void testThreadIndependence(const string& algorithm) {
+    // The result should not depend on how the constraints are divided between threads.
+
+    System system;
+    vector<Vec3> positions, velocities;
+    buildChains(system, positions, velocities, 8, 10, true);
+    for (Vec3& pos : positions)
+        pos += Vec3(0.01*sin(100*pos[0]), 0.01*sin(100*pos[1]), 0.01*sin(100*pos[2]));
+    vector<State> states;
+    for (string threads : {"1", "3", "4"}) {
+        VerletIntegrator integrator(0.001);
+        map<string, string> properties;
+        properties[CpuPlatform::CpuThreads()] = threads;
+        properties[CpuPlatform::CpuConstraintAlgorithm()] = algorithm;
+        Context context(system, integrator, platform, properties);
+        context.setPositions(positions);
+        context.setVelocities(velocities);
+        context.applyConstraints(1e-6);
+        context.applyVelocityConstraints(1e-6);
+        states.push_back(context.getState(State::Positions | State::Velocities));
+    }
+    for (int i = 1; i < states.size(); i++)
+        for (int j = 0; j < system.getNumParticles(); j++) {
+            ASSERT_EQUAL_VEC(states[0].getPositions()[j], states[i].getPositions()[j], 0.0);
+            ASSERT_EQUAL_VEC(states[0].getVelocities()[j], states[i].getVelocities()[j], 0.0);
+        }
+}
+
+void testInvalidAlgorithm() {
+    System system;
+    system.addParticle(1.0);
+    system.addParticle(1.0);
+    system.addConstraint(0, 1, 0.1);
+    VerletIntegrator integrator(0.001);
+    map<string, string> properties;
+    properties[CpuPlatform::CpuConstraintAlgorithm()] = "SHAKE";
+    bool threwException = false;
+    try {
+        Context context(system, integrator, platform, properties);
+    }
+    catch (const OpenMMException& ex) {
+        threwException = true;
+    }
+    ASSERT(threwException);
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        initializeTests(argc, argv);
+        testConstraintAlgorithm("CCMA", false);
+        testConstraintAlgorithm("CCMA", true);
+        testConstraintAlgorithm("LINCS", false);
+        testConstraintAlgorithm("LINCS", true);
+        testThreadIndependence("CCMA");
+        testThreadIndependence("LINCS");
+        testInvalidAlgorithm();
+    }
+    catch(const exception& e) {
+        cout << "exception: " << e.what() << endl;
+        return 1;
+    }
+    cout << "Done" << endl;
+    return 0;
+}
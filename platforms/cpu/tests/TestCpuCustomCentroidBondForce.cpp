@@ -0,0 +1,98 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "CpuTests.h"
+#include "TestCustomCentroidBondForce.h"
+#include "CpuReferenceComparison.h"
+#include <algorithm>
+
+void testCompareToReference(bool periodic) {
+    // Create a large number of overlapping groups and bonds between them, and check that the CPU
+    // platform agrees with the reference platform.
+
+    const int numParticles = 600;
+    const int numGroups = 300;
+    const int numBonds = 500;
+    Vec3 a(4.1, 0, 0), b(0.5, 3.9, 0), c(-0.6, 0.8, 4.2);
+    System system;
+    system.setDefaultPeriodicBoxVectors(a, b, c);
+    CustomCentroidBondForce* force = new CustomCentroidBondForce(3, "k*(distance(g1,g2)-r0)^2 + 0.5*k*(angle(g1,g2,g3)-theta0)^2 + 0.1*scale*(x1+y3)");
+    force->addPerBondParameter("k");
+    force->addPerBondParameter("r0");
+    force->addPerBondParameter("theta0");
+    force->addGlobalParameter("scale", 1.0);
+    force->addEnergyParameterDerivative("scale");
+    force->setUsesPeriodicBoundaryConditions(periodic);
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    vector<Vec3> positions;
+    for (int i = 0; i < numParticles; i++) {
+        system.addParticle(1.0+genrand_real2(sfmt));
+        positions.push_back(a*genrand_real2(sfmt) + b*genrand_real2(sfmt) + c*genrand_real2(sfmt));
+    }
+    for (int i = 0; i < numGroups; i++) {
+        // Each group contains nearby particles, and most particles are in more than one group.
+
+        int first = (int) (genrand_real2(sfmt)*(numParticles-5));
+        force->addGroup({first, first+2, first+5});
+    }
+    for (int i = 0; i < numBonds; i++) {
+        vector<int> groups;
+        while (groups.size() < 3) {
+            int g = (int) (genrand_real2(sfmt)*numGroups);
+            if (find(groups.begin(), groups.end(), g) == groups.end())
+                groups.push_back(g);
+        }
+        force->addBond(groups, {1.0+genrand_real2(sfmt), 0.5+genrand_real2(sfmt), 1.0+genrand_real2(sfmt)});
+    }
+    system.addForce(force);
+
+    // After the first comparison, change the parameters and make sure it is still correct.
+
+    compareToReference(system, positions, {"scale"}, [&] (Context& context1, Context& context2) {
+        context1.setParameter("scale", 2.0);
+        context2.setParameter("scale", 2.0);
+        for (int i = 0; i < numBonds; i++) {
+            vector<int> groups;
+            vector<double> parameters;
+            force->getBondParameters(i, groups, parameters);
+            parameters[1] += 0.2;
+            force->setBondParameters(i, groups, parameters);
+        }
+        force->updateParametersInContext(context1);
+        force->updateParametersInContext(context2);
+    });
+}
+
+void runPlatformTests() {
+    testCompareToReference(false);
+    testCompareToReference(true);
+}
@@ -0,0 +1,92 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "CpuTests.h"
+#include "TestCustomCompoundBondForce.h"
+#include "CpuReferenceComparison.h"
+#include <algorithm>
+
+void testCompareToReference(bool periodic) {
+    // Create a large number of bonds that share particles, and check that the CPU platform agrees
+    // with the reference platform.
+
+    const int numParticles = 500;
+    const int numBonds = 1000;
+    Vec3 a(4.1, 0, 0), b(0.5, 3.9, 0), c(-0.6, 0.8, 4.2);
+    System system;
+    system.setDefaultPeriodicBoxVectors(a, b, c);
+    CustomCompoundBondForce* force = new CustomCompoundBondForce(4, "k*(distance(p1,p2)-r0)^2 + 0.5*k*(angle(p1,p2,p3)-theta0)^2 + (1+cos(2*dihedral(p1,p2,p3,p4)-phase)) + 0.1*scale*(x1+y4*z2)");
+    force->addPerBondParameter("k");
+    force->addPerBondParameter("r0");
+    force->addPerBondParameter("theta0");
+    force->addGlobalParameter("phase", 0.3);
+    force->addGlobalParameter("scale", 1.0);
+    force->addEnergyParameterDerivative("scale");
+    force->setUsesPeriodicBoundaryConditions(periodic);
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    vector<Vec3> positions;
+    for (int i = 0; i < numParticles; i++) {
+        system.addParticle(1.0);
+        positions.push_back(a*genrand_real2(sfmt) + b*genrand_real2(sfmt) + c*genrand_real2(sfmt));
+    }
+    for (int i = 0; i < numBonds; i++) {
+        vector<int> particles;
+        while (particles.size() < 4) {
+            int p = (int) (genrand_real2(sfmt)*numParticles);
+            if (find(particles.begin(), particles.end(), p) == particles.end())
+                particles.push_back(p);
+        }
+        force->addBond(particles, {1.0+genrand_real2(sfmt), 0.5+genrand_real2(sfmt), 1.0+genrand_real2(sfmt)});
+    }
+    system.addForce(force);
+
+    // After the first comparison, change the parameters and make sure it is still correct.
+
+    compareToReference(system, positions, {"scale"}, [&] (Context& context1, Context& context2) {
+        context1.setParameter("phase", 1.1);
+        context2.setParameter("phase", 1.1);
+        for (int i = 0; i < numBonds; i++) {
+            vector<int> particles;
+            vector<double> parameters;
+            force->getBondParameters(i, particles, parameters);
+            parameters[0] *= 1.5;
+            force->setBondParameters(i, particles, parameters);
+        }
+        force->updateParametersInContext(context1);
+        force->updateParametersInContext(context2);
+    });
+}
+
+void runPlatformTests() {
+    testCompareToReference(false);
+    testCompareToReference(true);
+}
@@ -0,0 +1,83 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "CpuTests.h"
+#include "TestCustomHbondForce.h"
+#include "CpuReferenceComparison.h"
+
+void testCompareToReference(CustomHbondForce::NonbondedMethod method) {
+    // Create a triclinic box full of three atom donor and acceptor groups, and check that the
+    // CPU platform agrees with the reference platform.
+
+    const int numGroups = 300;
+    const double cutoff = 1.0;
+    Vec3 a(3.2, 0, 0), b(0.6, 3.1, 0), c(-0.5, 0.7, 3.3);
+    System system;
+    system.setDefaultPeriodicBoxVectors(a, b, c);
+    CustomHbondForce* force = new CustomHbondForce("k*exp(-(distance(d1,a1)-r0)^2)*cos(angle(d2,d1,a1))^2*(1+cos(dihedral(a3,a2,a1,d1)-phase))");
+    force->addPerDonorParameter("k");
+    force->addPerAcceptorParameter("r0");
+    force->addGlobalParameter("phase", 0.3);
+    force->setNonbondedMethod(method);
+    force->setCutoffDistance(cutoff);
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    vector<Vec3> positions;
+    for (int i = 0; i < numGroups; i++) {
+        Vec3 center = a*genrand_real2(sfmt) + b*genrand_real2(sfmt) + c*genrand_real2(sfmt);
+        for (int j = 0; j < 3; j++) {
+            system.addParticle(1.0);
+            positions.push_back(center + Vec3(genrand_real2(sfmt), genrand_real2(sfmt), genrand_real2(sfmt))*0.2);
+        }
+        if (i%2 == 0)
+            force->addDonor(3*i, 3*i+1, 3*i+2, {1.0+genrand_real2(sfmt)});
+        else
+            force->addAcceptor(3*i, 3*i+1, 3*i+2, {0.3+0.2*genrand_real2(sfmt)});
+    }
+    for (int i = 0; i < force->getNumDonors(); i += 3)
+        force->addExclusion(i, i);
+    system.addForce(force);
+
+    // After the first comparison, change the global parameter and make sure it is still correct.
+    // Positions are single precision on the CPU platform, and some of the random groups are close
+    // to linear, so individual forces are only compared to a looser tolerance.
+
+    compareToReference(system, positions, {}, [&] (Context& context1, Context& context2) {
+        context1.setParameter("phase", 1.1);
+        context2.setParameter("phase", 1.1);
+    }, 1e-3);
+}
+
+void runPlatformTests() {
+    testCompareToReference(CustomHbondForce::NoCutoff);
+    testCompareToReference(CustomHbondForce::CutoffNonPeriodic);
+    testCompareToReference(CustomHbondForce::CutoffPeriodic);
+}
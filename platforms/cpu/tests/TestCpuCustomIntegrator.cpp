@@ -0,0 +1,143 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "CpuTests.h"
+#include "TestCustomIntegrator.h"
+#include "ReferencePlatform.h"
+#include "openmm/CustomExternalForce.h"
+
+void testParallelSteps() {
+    // Run an integrator whose consecutive per-DOF steps get executed together on several threads,
+    // and make sure the trajectory and the computed sums match the Reference platform.
+
+    const int numParticles = 100;
+    System system;
+    CustomExternalForce* force = new CustomExternalForce("x^2+2*y^2+3*z^2");
+    system.addForce(force);
+    vector<Vec3> positions(numParticles), velocities(numParticles);
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    for (int i = 0; i < numParticles; i++) {
+        system.addParticle(i%10 == 9 ? 0.0 : 1.0+0.1*(i%4));
+        force->addParticle(i);
+        positions[i] = Vec3(genrand_real2(sfmt), genrand_real2(sfmt), genrand_real2(sfmt));
+        velocities[i] = Vec3(genrand_real2(sfmt)-0.5, genrand_real2(sfmt)-0.5, genrand_real2(sfmt)-0.5);
+    }
+    for (int i = 0; i < numParticles-1; i += 3)
+        if (system.getParticleMass(i) != 0.0 && system.getParticleMass(i+1) != 0.0)
+            system.addConstraint(i, i+1, sqrt((positions[i]-positions[i+1]).dot(positions[i]-positions[i+1])));
+    CustomIntegrator referenceIntegrator(0.002), integrator(0.002);
+    for (CustomIntegrator* i : {&referenceIntegrator, &integrator}) {
+        i->setConstraintTolerance(1e-8);
+        i->addPerDofVariable("x1", 0);
+        i->addPerDofVariable("a", 0);
+        i->addGlobalVariable("ke", 0);
+        i->addGlobalVariable("scale", 1.0);
+        i->addComputePerDof("a", "f/m");
+        i->addComputePerDof("v", "v+0.5*dt*a");
+        i->addComputePerDof("x", "x+dt*v*scale");
+        i->addComputePerDof("x1", "x");
+        i->addConstrainPositions();
+        i->addComputePerDof("v", "v+0.5*dt*f/m+(x-x1)/dt");
+        i->addComputeSum("ke", "0.5*m*v*v");
+        i->addConstrainVelocities();
+        i->addComputeGlobal("scale", "1-0.001*step(ke-1000)");
+    }
+    ReferencePlatform reference;
+    Context referenceContext(system, referenceIntegrator, reference);
+    map<string, string> properties;
+    properties[CpuPlatform::CpuThreads()] = "4";
+    Context context(system, integrator, platform, properties);
+    for (Context* c : {&referenceContext, &context}) {
+        c->setPositions(positions);
+        c->setVelocities(velocities);
+    }
+    referenceIntegrator.step(50);
+    integrator.step(50);
+    State referenceState = referenceContext.getState(State::Positions | State::Velocities);
+    State state = context.getState(State::Positions | State::Velocities);
+    for (int i = 0; i < numParticles; i++) {
+        ASSERT_EQUAL_VEC(referenceState.getPositions()[i], state.getPositions()[i], 1e-8);
+        ASSERT_EQUAL_VEC(referenceState.getVelocities()[i], state.getVelocities()[i], 1e-8);
+    }
+    ASSERT_EQUAL_TOL(referenceIntegrator.getGlobalVariableByName("ke"), integrator.getGlobalVariableByName("ke"), 1e-8);
+    vector<Vec3> referenceX1, x1;
+    referenceIntegrator.getPerDofVariableByName("x1", referenceX1);
+    integrator.getPerDofVariableByName("x1", x1);
+    for (int i = 0; i < numParticles; i++)
+        ASSERT_EQUAL_VEC(referenceX1[i], x1[i], 1e-8);
+}
+
+void testThreadIndependence() {
+    // A stochastic integrator should produce identical results regardless of the number of threads.
+
+    const int numParticles = 300;
+    System system;
+    CustomExternalForce* force = new CustomExternalForce("x^2+2*y^2+3*z^2");
+    system.addForce(force);
+    vector<Vec3> positions(numParticles);
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    for (int i = 0; i < numParticles; i++) {
+        system.addParticle(1.0+0.1*(i%4));
+        force->addParticle(i);
+        positions[i] = Vec3(genrand_real2(sfmt), genrand_real2(sfmt), genrand_real2(sfmt));
+    }
+    vector<State> states;
+    vector<double> sums;
+    for (string threads : {"1", "3", "4"}) {
+        CustomIntegrator integrator(0.002);
+        integrator.setRandomNumberSeed(5);
+        integrator.addGlobalVariable("ke", 0);
+        integrator.addComputePerDof("v", "0.9*v+0.1*gaussian+0.01*(uniform-0.5)+dt*f/m");
+        integrator.addComputePerDof("x", "x+dt*v");
+        integrator.addComputeSum("ke", "0.5*m*v*v");
+        map<string, string> properties;
+        properties[CpuPlatform::CpuThreads()] = threads;
+        Context context(system, integrator, platform, properties);
+        context.setPositions(positions);
+        integrator.step(10);
+        states.push_back(context.getState(State::Positions | State::Velocities));
+        sums.push_back(integrator.getGlobalVariableByName("ke"));
+    }
+    for (int i = 1; i < states.size(); i++) {
+        ASSERT_EQUAL(sums[0], sums[i]);
+        for (int j = 0; j < numParticles; j++) {
+            ASSERT_EQUAL_VEC(states[0].getPositions()[j], states[i].getPositions()[j], 0.0);
+            ASSERT_EQUAL_VEC(states[0].getVelocities()[j], states[i].getVelocities()[j], 0.0);
+        }
+    }
+}
+
+void runPlatformTests() {
+    testParallelSteps();
+    testThreadIndependence();
+}
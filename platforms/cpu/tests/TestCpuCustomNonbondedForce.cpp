@@ -31,6 +31,194 @@
 
 #include "CpuTests.h"
 #include "TestCustomNonbondedForce.h"
+#include "AlignedArray.h"
+#include "CpuCustomNonbondedForce.h"
+#include "CpuNeighborList.h"
+#include "openmm/internal/hardware.h"
+#include "openmm/internal/ThreadPool.h"
+#include "lepton/Parser.h"
+#include <map>
+#include <string>
+
+void compareTabulatedForces(Context& context1, Context& context2, const vector<Vec3>& positions) {
+    context1.setPositions(positions);
+    context2.setPositions(positions);
+    State state1 = context1.getState(State::Forces | State::Energy);
+    State state2 = context2.getState(State::Forces | State::Energy);
+    for (int i = 0; i < positions.size(); i++)
+        ASSERT_EQUAL_VEC(state1.getForces()[i], state2.getForces()[i], 1e-4);
+    ASSERT_EQUAL_TOL(state1.getPotentialEnergy(), state2.getPotentialEnergy(), 1e-5);
+}
+
+void testTabulatedInteraction() {
+    // Compute an interaction that depends on atom types and charges with and without tables, and
+    // check that they agree.
+
+    const int gridSize = 8;
+    const double spacing = 0.3;
+    const double boxSize = gridSize*spacing;
+    System system;
+    system.setDefaultPeriodicBoxVectors(Vec3(boxSize, 0, 0), Vec3(0, boxSize, 0), Vec3(0, 0, boxSize));
+    CustomNonbondedForce* force = new CustomNonbondedForce("scale*(eps*((sigma/r)^12-2*(sigma/r)^6)+q1*q2/r); sigma=sig(type1, type2); eps=ep(type1, type2)");
+    force->addPerParticleParameter("type");
+    force->addPerParticleParameter("q");
+    force->addGlobalParameter("scale", 1.0);
+    vector<double> sig = {0.1, 0.12, 0.14, 0.12, 0.15, 0.13, 0.14, 0.13, 0.11};
+    vector<double> ep = {1.0, 0.5, 0.8, 0.5, 2.0, 1.2, 0.8, 1.2, 0.3};
+    force->addTabulatedFunction("sig", new Discrete2DFunction(3, 3, sig));
+    force->addTabulatedFunction("ep", new Discrete2DFunction(3, 3, ep));
+    force->setNonbondedMethod(CustomNonbondedForce::CutoffPeriodic);
+    force->setCutoffDistance(1.0);
+    force->setUseSwitchingFunction(true);
+    force->setSwitchingDistance(0.9);
+    system.addForce(force);
+    vector<Vec3> positions;
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    for (int i = 0; i < gridSize; i++)
+        for (int j = 0; j < gridSize; j++)
+            for (int k = 0; k < gridSize; k++) {
+                int index = system.addParticle(1.0);
+                force->addParticle({(double) (index%3), index%2 == 0 ? 0.5 : -0.5});
+                positions.push_back(Vec3(i+0.3*genrand_real2(sfmt), j+0.3*genrand_real2(sfmt), k+0.3*genrand_real2(sfmt))*spacing);
+            }
+
+    // Put one pair closer than the start of the tables.
+
+    positions[1] = positions[0]+Vec3(0.08, 0, 0);
+    VerletIntegrator integrator1(0.001);
+    VerletIntegrator integrator2(0.001);
+    map<string, string> properties;
+    properties[CpuPlatform::CpuThreads()] = "3";
+    Context context1(system, integrator1, platform, properties);
+    properties[CpuPlatform::CpuTabulatedNonbonded()] = "true";
+    Context context2(system, integrator2, platform, properties);
+    ASSERT_EQUAL("false", platform.getPropertyValue(context1, CpuPlatform::CpuTabulatedNonbonded()));
+    ASSERT_EQUAL("true", platform.getPropertyValue(context2, CpuPlatform::CpuTabulatedNonbonded()));
+    compareTabulatedForces(context1, context2, positions);
+
+    // Changing a global parameter or adding a new combination of parameters requires new tables.
+
+    context1.setParameter("scale", 0.7);
+    context2.setParameter("scale", 0.7);
+    compareTabulatedForces(context1, context2, positions);
+    force->setParticleParameters(5, {1.0, 0.2});
+    force->updateParametersInContext(context1);
+    force->updateParametersInContext(context2);
+    compareTabulatedForces(context1, context2, positions);
+
+    // If every particle has different parameters, there are too many combinations to tabulate.
+
+    for (int i = 0; i < system.getNumParticles(); i++)
+        force->setParticleParameters(i, {(double) (i%3), genrand_real2(sfmt)-0.5});
+    force->updateParametersInContext(context1);
+    force->updateParametersInContext(context2);
+    compareTabulatedForces(context1, context2, positions);
+}
+
+void testTableSelection() {
+    // Check directly that tables are used when there are few types of particles, that computing falls back
+    // to evaluating the expression when there are too many, and that the two agree.
+
+    const int numParticles = 200;
+    const double boxSize = 3.0;
+    const double cutoff = 1.0;
+    ThreadPool threads(2);
+    CpuNeighborList neighborList(getVectorWidth());
+    Vec3 boxVectors[3] = {Vec3(boxSize, 0, 0), Vec3(0, boxSize, 0), Vec3(0, 0, boxSize)};
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    AlignedArray<float> posq(4*numParticles);
+    vector<Vec3> positions(numParticles);
+    for (int i = 0; i < numParticles; i++) {
+        positions[i] = Vec3(genrand_real2(sfmt), genrand_real2(sfmt), genrand_real2(sfmt))*boxSize;
+        for (int j = 0; j < 3; j++)
+            posq[4*i+j] = (float) positions[i][j];
+        posq[4*i+3] = 0.0f;
+    }
+    vector<set<int> > exclusions(numParticles);
+    for (int i = 0; i < numParticles; i++)
+        exclusions[i].insert(i);
+    neighborList.computeNeighborList(numParticles, posq, exclusions, boxVectors, true, cutoff, threads);
+    Lepton::ParsedExpression energyExpression = Lepton::Parser::parse("a1*a2*exp(-r)").optimize();
+    Lepton::ParsedExpression forceExpression = energyExpression.differentiate("r");
+    vector<string> parameterNames = {"a"};
+    map<string, double> globals;
+    auto createForce = [&] (bool useTables) {
+        CpuCustomNonbondedForce* force = createCpuCustomNonbondedForce(threads, neighborList);
+        force->initialize(energyExpression, forceExpression, parameterNames, exclusions, {}, {}, {});
+        force->setUseCutoff(cutoff);
+        force->setPeriodic(boxVectors);
+        force->setUseTables(useTables);
+        return force;
+    };
+    CpuCustomNonbondedForce* tabulated = createForce(true);
+    CpuCustomNonbondedForce* direct = createForce(false);
+    auto compute = [&] (CpuCustomNonbondedForce* force, vector<vector<double> >& params, vector<Vec3>& forces) {
+        vector<AlignedArray<float> > threadForce(threads.getNumThreads());
+        for (auto& f : threadForce) {
+            f.resize(4*numParticles);
+            for (int i = 0; i < 4*numParticles; i++)
+                f[i] = 0.0f;
+        }
+        double energy = 0.0;
+        force->calculatePairIxn(numParticles, &posq[0], positions, params, globals, threadForce, true, true, energy, NULL);
+        forces.assign(numParticles, Vec3());
+        for (auto& f : threadForce)
+            for (int i = 0; i < numParticles; i++)
+                forces[i] += Vec3(f[4*i], f[4*i+1], f[4*i+2]);
+        return energy;
+    };
+    auto compare = [&] (vector<vector<double> >& params, bool expectTables) {
+        vector<Vec3> forces1, forces2;
+        double energy1 = compute(tabulated, params, forces1);
+        ASSERT_EQUAL(expectTables, tabulated->getUsedTables());
+        double energy2 = compute(direct, params, forces2);
+        ASSERT(!direct->getUsedTables());
+        for (int i = 0; i < numParticles; i++)
+            ASSERT_EQUAL_VEC(forces2[i], forces1[i], 1e-4);
+        ASSERT_EQUAL_TOL(energy2, energy1, 1e-5);
+    };
+
+    // Four types of particles can be tabulated.
+
+    vector<vector<double> > params(numParticles);
+    for (int i = 0; i < numParticles; i++)
+        params[i] = {0.5+0.1*(i%4)};
+    compare(params, true);
+
+    // The largest allowed number of types can be tabulated, but one more is too many combinations.
+
+    int maxTypes = CpuCustomNonbondedForce::getMaxTableTypes();
+    ASSERT(maxTypes > 4 && maxTypes < numParticles);
+    for (int i = 0; i < numParticles; i++)
+        params[i] = {0.5+0.01*(i%maxTypes)};
+    tabulated->invalidateParticleTypes();
+    direct->invalidateParticleTypes();
+    compare(params, true);
+    for (int i = 0; i < numParticles; i++)
+        params[i] = {0.5+0.01*(i%(maxTypes+1))};
+    tabulated->invalidateParticleTypes();
+    direct->invalidateParticleTypes();
+    compare(params, false);
+    for (int i = 0; i < numParticles; i++)
+        params[i] = {0.5+0.01*i};
+    tabulated->invalidateParticleTypes();
+    direct->invalidateParticleTypes();
+    compare(params, false);
+
+    // Going back to a few types should use tables again.
+
+    for (int i = 0; i < numParticles; i++)
+        params[i] = {0.5+0.1*(i%4)};
+    tabulated->invalidateParticleTypes();
+    direct->invalidateParticleTypes();
+    compare(params, true);
+    delete tabulated;
+    delete direct;
+}
 
 void runPlatformTests() {
+    testTabulatedInteraction();
+    testTableSelection();
 }
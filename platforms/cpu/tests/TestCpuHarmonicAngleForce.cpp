@@ -31,6 +31,7 @@
 
 #include "CpuTests.h"
 #include "TestHarmonicAngleForce.h"
+#include "sfmt/SFMT.h"
 
 void testParallelComputation() {
     System system;
@@ -58,6 +59,52 @@ void testParallelComputation() {
         ASSERT_EQUAL_VEC(state1.getForces()[i], state2.getForces()[i], 1e-5);
 }
 
+void testCompareToReference() {
+    // Compare randomly placed atoms in a periodic box to the reference platform.  The angle is computed
+    // with atan2(), so even nearly linear angles should match to single precision.
+
+    System system;
+    const int numParticles = 500;
+    const double boxSize = 3.0;
+    system.setDefaultPeriodicBoxVectors(Vec3(boxSize, 0, 0), Vec3(0, boxSize, 0), Vec3(0, 0, boxSize));
+    for (int i = 0; i < numParticles; i++)
+        system.addParticle(1.0);
+    HarmonicAngleForce* force = new HarmonicAngleForce();
+    for (int i = 2; i < numParticles; i++)
+        force->addAngle(i-2, i-1, i, 0.5+0.005*i, 1.0+0.1*i);
+    force->setUsesPeriodicBoundaryConditions(true);
+    system.addForce(force);
+    vector<Vec3> positions(numParticles);
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    for (int i = 0; i < numParticles; i++)
+        positions[i] = Vec3(genrand_real2(sfmt), genrand_real2(sfmt), genrand_real2(sfmt))*boxSize;
+
+    // Make a few of the angles nearly linear.
+
+    for (int i = 10; i < numParticles; i += 50)
+        positions[i] = positions[i-1]*2.0-positions[i-2]+Vec3(1e-4, 0, 0);
+    VerletIntegrator integrator1(0.01);
+    ReferencePlatform reference;
+    Context context1(system, integrator1, reference);
+    context1.setPositions(positions);
+    State state1 = context1.getState(State::Forces | State::Energy);
+    VerletIntegrator integrator2(0.01);
+    Context context2(system, integrator2, platform);
+    context2.setPositions(positions);
+    State state2 = context2.getState(State::Forces | State::Energy);
+    ASSERT_EQUAL_TOL(state1.getPotentialEnergy(), state2.getPotentialEnergy(), 1e-6);
+
+    // For a nearly linear angle, the plane of the angle is defined by a cross product of nearly parallel
+    // vectors, so the directions of the forces are only accurate to about 1e-4.
+
+    for (int i = 0; i < numParticles; i++) {
+        bool nearlyLinear = (i%50 >= 8 && i%50 <= 10);
+        ASSERT_EQUAL_VEC(state1.getForces()[i], state2.getForces()[i], nearlyLinear ? 1e-3 : 1e-5);
+    }
+}
+
 void runPlatformTests() {
     testParallelComputation();
+    testCompareToReference();
 }
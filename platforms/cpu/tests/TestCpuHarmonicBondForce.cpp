@@ -0,0 +1,133 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "CpuTests.h"
+#include "TestHarmonicBondForce.h"
+#include "openmm/CustomExternalForce.h"
+#include "openmm/HarmonicAngleForce.h"
+#include "openmm/PeriodicTorsionForce.h"
+#include "sfmt/SFMT.h"
+
+void testParallelComputation() {
+    System system;
+    const int numParticles = 200;
+    for (int i = 0; i < numParticles; i++)
+        system.addParticle(1.0);
+    HarmonicBondForce* force = new HarmonicBondForce();
+    for (int i = 1; i < numParticles; i++)
+        force->addBond(i-1, i, 1.1, i);
+    for (int i = 3; i < numParticles; i += 5)
+        force->addBond(i-3, i, 2.0, 0.5*i);
+    system.addForce(force);
+    vector<Vec3> positions(numParticles);
+    for (int i = 0; i < numParticles; i++)
+        positions[i] = Vec3(i, i%2, 0.1*(i%3));
+    VerletIntegrator integrator1(0.01);
+    ReferencePlatform reference;
+    Context context1(system, integrator1, reference);
+    context1.setPositions(positions);
+    State state1 = context1.getState(State::Forces | State::Energy);
+    VerletIntegrator integrator2(0.01);
+    Context context2(system, integrator2, platform);
+    context2.setPositions(positions);
+    State state2 = context2.getState(State::Forces | State::Energy);
+    ASSERT_EQUAL_TOL(state1.getPotentialEnergy(), state2.getPotentialEnergy(), 1e-5);
+    for (int i = 0; i < numParticles; i++)
+        ASSERT_EQUAL_VEC(state1.getForces()[i], state2.getForces()[i], 1e-5);
+}
+
+void testConcurrentForces() {
+    // Compute several bonded forces along with a force that runs on the main thread, with and without
+    // computing them concurrently.  The results should be identical.
+
+    System system;
+    const int numParticles = 300;
+    for (int i = 0; i < numParticles; i++)
+        system.addParticle(1.0);
+    HarmonicBondForce* bonds = new HarmonicBondForce();
+    HarmonicAngleForce* angles = new HarmonicAngleForce();
+    PeriodicTorsionForce* torsions = new PeriodicTorsionForce();
+    for (int i = 3; i < numParticles; i++) {
+        bonds->addBond(i-1, i, 1.1, i);
+        angles->addAngle(i-2, i-1, i, 2.0, 0.5*i);
+        torsions->addTorsion(i-3, i-2, i-1, i, 2, 0.5, 1.5);
+    }
+    CustomExternalForce* external = new CustomExternalForce("0.3*(x^2+y^2+z^2)");
+    for (int i = 0; i < numParticles; i += 2)
+        external->addParticle(i);
+    torsions->setForceGroup(1);
+    system.addForce(bonds);
+    system.addForce(external);
+    system.addForce(angles);
+    system.addForce(torsions);
+    vector<Vec3> positions(numParticles);
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    for (int i = 0; i < numParticles; i++)
+        positions[i] = Vec3(i, i%2, 0.1*(i%3))+Vec3(genrand_real2(sfmt), genrand_real2(sfmt), genrand_real2(sfmt))*0.2;
+    map<string, string> properties;
+    properties[CpuPlatform::CpuThreads()] = "4";
+    properties[CpuPlatform::CpuConcurrentForces()] = "false";
+    VerletIntegrator integrator1(0.001);
+    Context context1(system, integrator1, platform, properties);
+    properties[CpuPlatform::CpuConcurrentForces()] = "true";
+    VerletIntegrator integrator2(0.001);
+    Context context2(system, integrator2, platform, properties);
+    ASSERT_EQUAL("false", platform.getPropertyValue(context1, CpuPlatform::CpuConcurrentForces()));
+    ASSERT_EQUAL("true", platform.getPropertyValue(context2, CpuPlatform::CpuConcurrentForces()));
+    context1.setPositions(positions);
+    context2.setPositions(positions);
+    double groupEnergy[3];
+    for (int groups : {-1, 1, 2}) {
+        State state1 = context1.getState(State::Forces | State::Energy, false, groups);
+        State state2 = context2.getState(State::Forces | State::Energy, false, groups);
+        ASSERT_EQUAL(state1.getPotentialEnergy(), state2.getPotentialEnergy());
+        for (int i = 0; i < numParticles; i++)
+            ASSERT_EQUAL_VEC(state1.getForces()[i], state2.getForces()[i], 0.0);
+        groupEnergy[groups == -1 ? 0 : groups] = state2.getPotentialEnergy();
+    }
+    ASSERT_EQUAL_TOL(groupEnergy[0], groupEnergy[1]+groupEnergy[2], 1e-10);
+
+    // Make sure they also agree after taking some steps.
+
+    integrator1.step(10);
+    integrator2.step(10);
+    State state1 = context1.getState(State::Positions | State::Energy);
+    State state2 = context2.getState(State::Positions | State::Energy);
+    ASSERT_EQUAL(state1.getPotentialEnergy(), state2.getPotentialEnergy());
+    for (int i = 0; i < numParticles; i++)
+        ASSERT_EQUAL_VEC(state1.getPositions()[i], state2.getPositions()[i], 0.0);
+}
+
+void runPlatformTests() {
+    testParallelComputation();
+    testConcurrentForces();
+}
@@ -31,7 +31,369 @@
 
 #include "CpuTests.h"
 #include "TestNonbondedForce.h"
+#include "openmm/CustomNonbondedForce.h"
+#include "openmm/GBSAOBCForce.h"
+#include "openmm/HarmonicAngleForce.h"
+#include <map>
+#include <string>
+
+void testSpatialForceAccumulation() {
+    // Build a system with several kinds of forces, and check that tracking which atoms each
+    // thread writes to gives the same forces as clearing and summing every buffer.
+
+    const int gridSize = 12;
+    const double spacing = 0.3;
+    const double boxSize = gridSize*spacing;
+    System system;
+    system.setDefaultPeriodicBoxVectors(Vec3(boxSize, 0, 0), Vec3(0, boxSize, 0), Vec3(0, 0, boxSize));
+    NonbondedForce* nonbonded = new NonbondedForce();
+    nonbonded->setNonbondedMethod(NonbondedForce::PME);
+    nonbonded->setCutoffDistance(1.0);
+    system.addForce(nonbonded);
+    CustomNonbondedForce* custom = new CustomNonbondedForce("a*exp(-r)");
+    custom->addGlobalParameter("a", 0.5);
+    custom->setNonbondedMethod(CustomNonbondedForce::CutoffPeriodic);
+    custom->setCutoffDistance(1.0);
+    system.addForce(custom);
+    HarmonicBondForce* bonds = new HarmonicBondForce();
+    system.addForce(bonds);
+    vector<Vec3> positions;
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    for (int i = 0; i < gridSize; i++)
+        for (int j = 0; j < gridSize; j++)
+            for (int k = 0; k < gridSize; k++) {
+                int index = system.addParticle(1.0);
+                nonbonded->addParticle(index%2 == 0 ? 0.5 : -0.5, 0.2, 0.5);
+                custom->addParticle();
+                positions.push_back(Vec3(i*spacing+genrand_real2(sfmt)*0.1, j*spacing+genrand_real2(sfmt)*0.1, k*spacing+genrand_real2(sfmt)*0.1));
+                if (index%2 == 1) {
+                    bonds->addBond(index-1, index, 0.3, 100.0);
+                    nonbonded->addException(index-1, index, 0.0, 1.0, 0.0);
+                    custom->addExclusion(index-1, index);
+                }
+            }
+    VerletIntegrator integrator1(0.001);
+    VerletIntegrator integrator2(0.001);
+    map<string, string> properties;
+    properties[CpuPlatform::CpuThreads()] = "4";
+    Context context1(system, integrator1, platform, properties);
+    properties[CpuPlatform::CpuSpatialForceAccumulation()] = "true";
+    Context context2(system, integrator2, platform, properties);
+    ASSERT_EQUAL("true", platform.getPropertyValue(context2, CpuPlatform::CpuSpatialForceAccumulation()));
+    context1.setPositions(positions);
+    context2.setPositions(positions);
+
+    // Take a few steps, so the buffers get cleared and reused.
+
+    for (int step = 0; step < 3; step++) {
+        State state1 = context1.getState(State::Forces | State::Energy);
+        State state2 = context2.getState(State::Forces | State::Energy);
+        for (int i = 0; i < system.getNumParticles(); i++)
+            ASSERT_EQUAL_VEC(state1.getForces()[i], state2.getForces()[i], 1e-5);
+        ASSERT_EQUAL_TOL(state1.getPotentialEnergy(), state2.getPotentialEnergy(), 1e-5);
+        integrator1.step(1);
+        context2.setPositions(context1.getState(State::Positions).getPositions());
+    }
+}
+
+void testParticleReordering() {
+    // Simulate a system with several kinds of forces, with and without reordering particles along a
+    // space filling curve, and check that the results agree.
+
+    const int gridSize = 10;
+    const double spacing = 0.3;
+    const double boxSize = gridSize*spacing;
+    System system;
+    system.setDefaultPeriodicBoxVectors(Vec3(boxSize, 0, 0), Vec3(0, boxSize, 0), Vec3(0, 0, boxSize));
+    NonbondedForce* nonbonded = new NonbondedForce();
+    nonbonded->setNonbondedMethod(NonbondedForce::PME);
+    nonbonded->setCutoffDistance(1.0);
+    system.addForce(nonbonded);
+    CustomNonbondedForce* custom = new CustomNonbondedForce("a*exp(-r)*(b1+b2)");
+    custom->addGlobalParameter("a", 0.5);
+    custom->addPerParticleParameter("b");
+    custom->setNonbondedMethod(CustomNonbondedForce::CutoffPeriodic);
+    custom->setCutoffDistance(1.0);
+    system.addForce(custom);
+    CustomNonbondedForce* grouped = new CustomNonbondedForce("0.1/r");
+    grouped->setNonbondedMethod(CustomNonbondedForce::CutoffPeriodic);
+    grouped->setCutoffDistance(1.0);
+    system.addForce(grouped);
+    GBSAOBCForce* gbsa = new GBSAOBCForce();
+    gbsa->setNonbondedMethod(GBSAOBCForce::CutoffPeriodic);
+    gbsa->setCutoffDistance(1.0);
+    system.addForce(gbsa);
+    HarmonicBondForce* bonds = new HarmonicBondForce();
+    system.addForce(bonds);
+    vector<Vec3> positions, velocities;
+    set<int> group1, group2;
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    for (int i = 0; i < gridSize; i++)
+        for (int j = 0; j < gridSize; j++)
+            for (int k = 0; k < gridSize; k++) {
+                int index = system.addParticle(10.0);
+                double charge = (index%2 == 0 ? 0.5 : -0.5);
+                nonbonded->addParticle(charge, 0.2, 0.5);
+                custom->addParticle({genrand_real2(sfmt)});
+                grouped->addParticle();
+                gbsa->addParticle(charge, 0.12+0.02*(index%3), 0.8+0.1*(index%4));
+                (index%3 == 0 ? group1 : group2).insert(index);
+                positions.push_back(Vec3(i*spacing+genrand_real2(sfmt)*0.1, j*spacing+genrand_real2(sfmt)*0.1, k*spacing+genrand_real2(sfmt)*0.1));
+                velocities.push_back(Vec3(genrand_real2(sfmt)-0.5, genrand_real2(sfmt)-0.5, genrand_real2(sfmt)-0.5));
+                if (index%2 == 1) {
+                    bonds->addBond(index-1, index, 0.3, 100.0);
+                    nonbonded->addException(index-1, index, 0.0, 1.0, 0.0);
+                    custom->addExclusion(index-1, index);
+                    grouped->addExclusion(index-1, index);
+                }
+            }
+    grouped->addInteractionGroup(group1, group2);
+    VerletIntegrator integrator1(0.001);
+    VerletIntegrator integrator2(0.001);
+    map<string, string> properties;
+    properties[CpuPlatform::CpuThreads()] = "3";
+    Context context1(system, integrator1, platform, properties);
+    properties[CpuPlatform::CpuParticleReordering()] = "true";
+    Context context2(system, integrator2, platform, properties);
+    ASSERT_EQUAL("false", platform.getPropertyValue(context1, CpuPlatform::CpuParticleReordering()));
+    ASSERT_EQUAL("true", platform.getPropertyValue(context2, CpuPlatform::CpuParticleReordering()));
+    context1.setPositions(positions);
+    context2.setPositions(positions);
+    context1.setVelocities(velocities);
+    context2.setVelocities(velocities);
+
+    // Take enough steps that the neighbor list gets rebuilt, and make sure everything is still reported
+    // in the original order.
+
+    for (int step = 0; step < 5; step++) {
+        State state1 = context1.getState(State::Positions | State::Velocities | State::Forces | State::Energy);
+        State state2 = context2.getState(State::Positions | State::Velocities | State::Forces | State::Energy);
+        for (int i = 0; i < system.getNumParticles(); i++) {
+            ASSERT_EQUAL_VEC(state1.getPositions()[i], state2.getPositions()[i], 1e-4);
+            ASSERT_EQUAL_VEC(state1.getVelocities()[i], state2.getVelocities()[i], 1e-4);
+            ASSERT_EQUAL_VEC(state1.getForces()[i], state2.getForces()[i], 1e-4);
+        }
+        ASSERT_EQUAL_TOL(state1.getPotentialEnergy(), state2.getPotentialEnergy(), 1e-5);
+        integrator1.step(10);
+        integrator2.step(10);
+    }
+}
+
+void testReorderingCoincidentParticles() {
+    // With a single particle, or all particles at the same position, the particles cannot be sorted.
+
+    for (int numParticles = 1; numParticles <= 3; numParticles += 2) {
+        System system;
+        NonbondedForce* nonbonded = new NonbondedForce();
+        nonbonded->setNonbondedMethod(NonbondedForce::CutoffNonPeriodic);
+        nonbonded->setCutoffDistance(1.0);
+        system.addForce(nonbonded);
+        for (int i = 0; i < numParticles; i++) {
+            system.addParticle(1.0);
+            nonbonded->addParticle(0.5, 0.2, 0.5);
+        }
+        for (int i = 0; i < numParticles; i++)
+            for (int j = 0; j < i; j++)
+                nonbonded->addException(i, j, 0.0, 1.0, 0.0);
+        VerletIntegrator integrator(0.001);
+        map<string, string> properties;
+        properties[CpuPlatform::CpuParticleReordering()] = "true";
+        Context context(system, integrator, platform, properties);
+        context.setPositions(vector<Vec3>(numParticles, Vec3(1, 2, 3)));
+        State state = context.getState(State::Positions | State::Forces | State::Energy);
+        ASSERT_EQUAL_TOL(0.0, state.getPotentialEnergy(), 1e-6);
+        for (int i = 0; i < numParticles; i++) {
+            ASSERT_EQUAL_VEC(Vec3(1, 2, 3), state.getPositions()[i], 1e-6);
+            ASSERT_EQUAL_VEC(Vec3(), state.getForces()[i], 1e-6);
+        }
+    }
+}
+
+void testConcurrentReciprocal() {
+    // Compute the reciprocal space part at the same time as the direct space part and the bonded forces,
+    // and check that the results agree with computing them one after another.  They are not bitwise
+    // identical, since the direct space chunks are summed in whatever order the threads happen to take them.
+
+    const int gridSize = 8;
+    const double spacing = 0.35;
+    const double boxSize = gridSize*spacing;
+    for (NonbondedForce::NonbondedMethod method : {NonbondedForce::Ewald, NonbondedForce::PME, NonbondedForce::LJPME}) {
+        for (string reordering : {"false", "true"}) {
+            System system;
+            system.setDefaultPeriodicBoxVectors(Vec3(boxSize, 0, 0), Vec3(0, boxSize, 0), Vec3(0, 0, boxSize));
+            HarmonicBondForce* bonds = new HarmonicBondForce();
+            system.addForce(bonds);
+            HarmonicAngleForce* angles = new HarmonicAngleForce();
+            system.addForce(angles);
+            NonbondedForce* nonbonded = new NonbondedForce();
+            nonbonded->setNonbondedMethod(method);
+            nonbonded->setCutoffDistance(1.0);
+            system.addForce(nonbonded);
+            vector<Vec3> positions;
+            OpenMM_SFMT::SFMT sfmt;
+            init_gen_rand(0, sfmt);
+            for (int i = 0; i < gridSize; i++)
+                for (int j = 0; j < gridSize; j++)
+                    for (int k = 0; k < gridSize; k++) {
+                        int index = system.addParticle(10.0);
+                        nonbonded->addParticle(index%2 == 0 ? 0.5 : -0.5, 0.2, 0.5);
+                        positions.push_back(Vec3(i*spacing+genrand_real2(sfmt)*0.1, j*spacing+genrand_real2(sfmt)*0.1, k*spacing+genrand_real2(sfmt)*0.1));
+                        if (k > 0) {
+                            bonds->addBond(index-1, index, spacing, 100.0);
+                            nonbonded->addException(index-1, index, 0.0, 1.0, 0.0);
+                        }
+                        if (k > 1)
+                            angles->addAngle(index-2, index-1, index, M_PI, 50.0);
+                    }
+            VerletIntegrator integrator1(0.001);
+            VerletIntegrator integrator2(0.001);
+            map<string, string> properties;
+            properties[CpuPlatform::CpuThreads()] = "4";
+            properties[CpuPlatform::CpuParticleReordering()] = reordering;
+            properties[CpuPlatform::CpuConcurrentForces()] = "false";
+            Context context1(system, integrator1, platform, properties);
+            properties[CpuPlatform::CpuConcurrentForces()] = "true";
+            Context context2(system, integrator2, platform, properties);
+            ASSERT_EQUAL("true", platform.getPropertyValue(context2, CpuPlatform::CpuConcurrentForces()));
+            context1.setPositions(positions);
+            context2.setPositions(positions);
+            for (int types : {(int) State::Forces, State::Forces | State::Energy}) {
+                State state1 = context1.getState(types);
+                State state2 = context2.getState(types);
+                if (types & State::Energy)
+                    ASSERT_EQUAL_TOL(state1.getPotentialEnergy(), state2.getPotentialEnergy(), 1e-6);
+                for (int i = 0; i < system.getNumParticles(); i++)
+                    ASSERT_EQUAL_VEC(state1.getForces()[i], state2.getForces()[i], 1e-5);
+            }
+        }
+    }
+}
+
+void testNeighborListPruning() {
+    // Simulate a system with and without pruning the neighbor list and choosing the buffer automatically, and
+    // check that the forces agree as particles move.
+
+    const int gridSize = 10;
+    const int numParticles = gridSize*gridSize*gridSize;
+    const double spacing = 0.3;
+    const double boxSize = gridSize*spacing;
+    System system;
+    system.setDefaultPeriodicBoxVectors(Vec3(boxSize, 0, 0), Vec3(0, boxSize, 0), Vec3(0, 0, boxSize));
+    NonbondedForce* nonbonded = new NonbondedForce();
+    nonbonded->setNonbondedMethod(NonbondedForce::PME);
+    nonbonded->setCutoffDistance(1.0);
+    system.addForce(nonbonded);
+    CustomNonbondedForce* custom = new CustomNonbondedForce("0.1*exp(-r)");
+    custom->setNonbondedMethod(CustomNonbondedForce::CutoffPeriodic);
+    custom->setCutoffDistance(1.0);
+    system.addForce(custom);
+    vector<Vec3> positions;
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    for (int i = 0; i < gridSize; i++)
+        for (int j = 0; j < gridSize; j++)
+            for (int k = 0; k < gridSize; k++) {
+                int index = system.addParticle(10.0);
+                nonbonded->addParticle(index%2 == 0 ? 0.2 : -0.2, 0.2, 0.5);
+                custom->addParticle();
+                positions.push_back(Vec3(i*spacing+genrand_real2(sfmt)*0.1, j*spacing+genrand_real2(sfmt)*0.1, k*spacing+genrand_real2(sfmt)*0.1));
+            }
+    VerletIntegrator integrator1(0.002);
+    VerletIntegrator integrator2(0.002);
+    map<string, string> properties;
+    properties[CpuPlatform::CpuThreads()] = "3";
+    Context context1(system, integrator1, platform, properties);
+    properties[CpuPlatform::CpuNeighborListPruning()] = "true";
+    properties[CpuPlatform::CpuVerletBufferTolerance()] = "0.01";
+    Context context2(system, integrator2, platform, properties);
+    ASSERT_EQUAL("true", platform.getPropertyValue(context2, CpuPlatform::CpuNeighborListPruning()));
+    ASSERT_EQUAL("0.01", platform.getPropertyValue(context2, CpuPlatform::CpuVerletBufferTolerance()));
+    context1.setPositions(positions);
+    context1.setVelocitiesToTemperature(300.0);
+
+    // Take enough steps that the list gets pruned and rebuilt several times.
+
+    for (int step = 0; step < 20; step++) {
+        State state1 = context1.getState(State::Positions | State::Velocities | State::Forces | State::Energy);
+        context2.setPositions(state1.getPositions());
+        context2.setVelocities(state1.getVelocities());
+        State state2 = context2.getState(State::Forces | State::Energy);
+        for (int i = 0; i < numParticles; i++)
+            ASSERT_EQUAL_VEC(state1.getForces()[i], state2.getForces()[i], 1e-4);
+        ASSERT_EQUAL_TOL(state1.getPotentialEnergy(), state2.getPotentialEnergy(), 1e-5);
+        integrator1.step(10);
+    }
+}
+
+void testClusterPairList() {
+    // Compute forces with and without cluster pairs for several nonbonded methods, and check that they agree.
+    // The number of particles is not a multiple of the block size, so the last cluster contains padding.
+
+    const int numParticles = 997;
+    const double boxSize = 3.0;
+    vector<Vec3> positions;
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    for (int i = 0; i < numParticles; i++)
+        positions.push_back(Vec3(genrand_real2(sfmt), genrand_real2(sfmt), genrand_real2(sfmt))*boxSize);
+    NonbondedForce::NonbondedMethod methods[] = {NonbondedForce::CutoffNonPeriodic, NonbondedForce::CutoffPeriodic, NonbondedForce::PME, NonbondedForce::LJPME};
+    for (int triclinic = 0; triclinic < 2; triclinic++) {
+        for (NonbondedForce::NonbondedMethod method : methods) {
+            System system;
+            if (triclinic)
+                system.setDefaultPeriodicBoxVectors(Vec3(boxSize, 0, 0), Vec3(0.3, boxSize, 0), Vec3(-0.4, 0.5, boxSize));
+            else
+                system.setDefaultPeriodicBoxVectors(Vec3(boxSize, 0, 0), Vec3(0, boxSize, 0), Vec3(0, 0, boxSize));
+            NonbondedForce* nonbonded = new NonbondedForce();
+            nonbonded->setNonbondedMethod(method);
+            nonbonded->setCutoffDistance(1.0);
+            nonbonded->setUseSwitchingFunction(true);
+            nonbonded->setSwitchingDistance(0.9);
+            system.addForce(nonbonded);
+            for (int i = 0; i < numParticles; i++) {
+                system.addParticle(1.0);
+                nonbonded->addParticle(i%2 == 0 ? 0.5 : -0.5, 0.2+0.1*genrand_real2(sfmt), i%5 == 0 ? 0.0 : 0.5);
+                if (i%3 == 2) {
+                    nonbonded->addException(i-2, i-1, 0.0, 1.0, 0.0);
+                    nonbonded->addException(i-1, i, 0.2, 0.3, 0.4);
+                }
+            }
+            VerletIntegrator integrator1(0.001);
+            map<string, string> atomProperties;
+            atomProperties[CpuPlatform::CpuThreads()] = "3";
+            atomProperties[CpuPlatform::CpuClusterPairList()] = "false";
+            Context context1(system, integrator1, platform, atomProperties);
+            ASSERT_EQUAL("false", platform.getPropertyValue(context1, CpuPlatform::CpuClusterPairList()));
+            context1.setPositions(positions);
+            State state1 = context1.getState(State::Forces | State::Energy);
+
+            // The cluster list is rebuilt after pruning, so test it both with and without.
+
+            for (string pruning : {"false", "true"}) {
+                VerletIntegrator integrator2(0.001);
+                map<string, string> properties;
+                properties[CpuPlatform::CpuThreads()] = "3";
+                properties[CpuPlatform::CpuNeighborListPruning()] = pruning;
+                Context context2(system, integrator2, platform, properties);
+                ASSERT_EQUAL("true", platform.getPropertyValue(context2, CpuPlatform::CpuClusterPairList()));
+                context2.setPositions(positions);
+                State state2 = context2.getState(State::Forces | State::Energy);
+                for (int i = 0; i < numParticles; i++)
+                    ASSERT_EQUAL_VEC(state1.getForces()[i], state2.getForces()[i], 1e-5);
+                ASSERT_EQUAL_TOL(state1.getPotentialEnergy(), state2.getPotentialEnergy(), 1e-5);
+            }
+        }
+    }
+}
 
 void runPlatformTests() {
     testHugeSystem();
+    testSpatialForceAccumulation();
+    testParticleReordering();
+    testReorderingCoincidentParticles();
+    testConcurrentReciprocal();
+    testNeighborListPruning();
+    testClusterPairList();
 }
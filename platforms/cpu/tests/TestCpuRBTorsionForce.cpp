@@ -31,6 +31,7 @@
 
 #include "CpuTests.h"
 #include "TestRBTorsionForce.h"
+#include "sfmt/SFMT.h"
 
 void testParallelComputation() {
     System system;
@@ -58,6 +59,46 @@ void testParallelComputation() {
         ASSERT_EQUAL_VEC(state1.getForces()[i], state2.getForces()[i], 1e-5);
 }
 
+void testCompareToReference() {
+    // Compare randomly placed atoms in a periodic box to the reference platform.  The torsion is computed
+    // from the sine and cosine of the dihedral, so nearly planar torsions should match to single precision.
+
+    System system;
+    const int numParticles = 500;
+    const double boxSize = 3.0;
+    system.setDefaultPeriodicBoxVectors(Vec3(boxSize, 0, 0), Vec3(0, boxSize, 0), Vec3(0, 0, boxSize));
+    for (int i = 0; i < numParticles; i++)
+        system.addParticle(1.0);
+    RBTorsionForce* force = new RBTorsionForce();
+    for (int i = 3; i < numParticles; i++)
+        force->addTorsion(i-3, i-2, i-1, i, 0.1*i, 0.5, -0.2*i, 1.0, -0.3, 0.02*i);
+    force->setUsesPeriodicBoundaryConditions(true);
+    system.addForce(force);
+    vector<Vec3> positions(numParticles);
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    for (int i = 0; i < numParticles; i++)
+        positions[i] = Vec3(genrand_real2(sfmt), genrand_real2(sfmt), genrand_real2(sfmt))*boxSize;
+
+    // Make a few of the torsions nearly planar.
+
+    for (int i = 10; i < numParticles; i += 50)
+        positions[i] = positions[i-3]+positions[i-1]-positions[i-2]+Vec3(0, 0, 1e-4);
+    VerletIntegrator integrator1(0.01);
+    ReferencePlatform reference;
+    Context context1(system, integrator1, reference);
+    context1.setPositions(positions);
+    State state1 = context1.getState(State::Forces | State::Energy);
+    VerletIntegrator integrator2(0.01);
+    Context context2(system, integrator2, platform);
+    context2.setPositions(positions);
+    State state2 = context2.getState(State::Forces | State::Energy);
+    ASSERT_EQUAL_TOL(state1.getPotentialEnergy(), state2.getPotentialEnergy(), 1e-6);
+    for (int i = 0; i < numParticles; i++)
+        ASSERT_EQUAL_VEC(state1.getForces()[i], state2.getForces()[i], 5e-5);
+}
+
 void runPlatformTests() {
     testParallelComputation();
+    testCompareToReference();
 }
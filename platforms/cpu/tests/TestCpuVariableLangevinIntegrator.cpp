@@ -0,0 +1,76 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "CpuTests.h"
+#include "TestVariableLangevinIntegrator.h"
+#include "openmm/CustomExternalForce.h"
+
+void testParallelTemperature() {
+    // Simulate a set of independent harmonic oscillators with several threads, and check that
+    // each thread's random number stream produces the correct temperature.
+
+    const int numParticles = 200;
+    const double temp = 300.0;
+    const double k = 100.0;
+    System system;
+    CustomExternalForce* force = new CustomExternalForce("0.5*k*(x^2+y^2+z^2)");
+    force->addGlobalParameter("k", k);
+    system.addForce(force);
+    vector<Vec3> positions(numParticles);
+    for (int i = 0; i < numParticles; i++) {
+        system.addParticle(1.0);
+        force->addParticle(i);
+        positions[i] = Vec3(0.1*(i%3), 0.1*(i%5), 0.1*(i%7));
+    }
+    VariableLangevinIntegrator integrator(temp, 5.0, 1e-3);
+    integrator.setRandomNumberSeed(1);
+    map<string, string> properties;
+    properties[CpuPlatform::CpuThreads()] = "4";
+    Context context(system, integrator, platform, properties);
+    context.setPositions(positions);
+
+    // Let it equilibrate, then see if the average potential energy is correct.
+
+    integrator.step(500);
+    double pe = 0.0;
+    const int samples = 200;
+    for (int i = 0; i < samples; i++) {
+        integrator.step(10);
+        pe += context.getState(State::Energy).getPotentialEnergy();
+    }
+    pe /= samples;
+    double expected = 1.5*numParticles*BOLTZ*temp;
+    ASSERT_USUALLY_EQUAL_TOL(expected, pe, 0.05);
+}
+
+void runPlatformTests() {
+    testParallelTemperature();
+}
@@ -0,0 +1,83 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "CpuTests.h"
+#include "TestVerletIntegrator.h"
+#include "ReferencePlatform.h"
+#include "openmm/CustomExternalForce.h"
+#include "sfmt/SFMT.h"
+
+void testParallelIntegration() {
+    // Integrate a constrained system with several threads and make sure the trajectory
+    // matches the Reference platform.  The force is computed in double precision by both.
+
+    const int numParticles = 100;
+    System system;
+    CustomExternalForce* force = new CustomExternalForce("x^2+2*y^2+3*z^2");
+    system.addForce(force);
+    vector<Vec3> positions(numParticles), velocities(numParticles);
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    for (int i = 0; i < numParticles; i++) {
+        system.addParticle(i%10 == 9 ? 0.0 : 1.0+0.1*(i%4));
+        force->addParticle(i);
+        positions[i] = Vec3(genrand_real2(sfmt), genrand_real2(sfmt), genrand_real2(sfmt));
+        velocities[i] = Vec3(genrand_real2(sfmt)-0.5, genrand_real2(sfmt)-0.5, genrand_real2(sfmt)-0.5);
+    }
+    for (int i = 0; i < numParticles-1; i += 3)
+        if (system.getParticleMass(i) != 0.0 && system.getParticleMass(i+1) != 0.0)
+            system.addConstraint(i, i+1, sqrt((positions[i]-positions[i+1]).dot(positions[i]-positions[i+1])));
+    VerletIntegrator referenceIntegrator(0.002);
+    referenceIntegrator.setConstraintTolerance(1e-8);
+    ReferencePlatform reference;
+    Context referenceContext(system, referenceIntegrator, reference);
+    referenceContext.setPositions(positions);
+    referenceContext.setVelocities(velocities);
+    VerletIntegrator integrator(0.002);
+    integrator.setConstraintTolerance(1e-8);
+    map<string, string> properties;
+    properties[CpuPlatform::CpuThreads()] = "4";
+    Context context(system, integrator, platform, properties);
+    context.setPositions(positions);
+    context.setVelocities(velocities);
+    referenceIntegrator.step(50);
+    integrator.step(50);
+    State referenceState = referenceContext.getState(State::Positions | State::Velocities);
+    State state = context.getState(State::Positions | State::Velocities);
+    for (int i = 0; i < numParticles; i++) {
+        ASSERT_EQUAL_VEC(referenceState.getPositions()[i], state.getPositions()[i], 1e-8);
+        ASSERT_EQUAL_VEC(referenceState.getVelocities()[i], state.getVelocities()[i], 1e-8);
+    }
+}
+
+void runPlatformTests() {
+    testParallelIntegration();
+}
@@ -26,12 +26,13 @@
 #define __ReferenceBrownianDynamics_H__
 
 #include "ReferenceDynamics.h"
+#include "openmm/internal/windowsExport.h"
 
 namespace OpenMM {
 
-class ReferenceBrownianDynamics : public ReferenceDynamics {
+class OPENMM_EXPORT ReferenceBrownianDynamics : public ReferenceDynamics {
 
-   private:
+   protected:
 
       std::vector<OpenMM::Vec3> xPrime;
       std::vector<double> inverseMasses;
@@ -85,7 +86,36 @@ class ReferenceBrownianDynamics : public ReferenceDynamics {
      
       void update(const OpenMM::System& system, std::vector<OpenMM::Vec3>& atomCoordinates,
                   std::vector<OpenMM::Vec3>& velocities, std::vector<OpenMM::Vec3>& forces, std::vector<double>& masses, double tolerance);
+
+      /**---------------------------------------------------------------------------------------
+      
+         First update: compute unconstrained positions from the forces and random noise
+      
+         @param numberOfAtoms       number of atoms
+         @param atomCoordinates     atom coordinates
+         @param forces              forces
+         @param inverseMasses       inverse atom masses
+         @param xPrime              xPrime
+      
+         --------------------------------------------------------------------------------------- */
+      
+      virtual void updatePart1(int numberOfAtoms, std::vector<OpenMM::Vec3>& atomCoordinates, std::vector<OpenMM::Vec3>& forces,
+                               std::vector<double>& inverseMasses, std::vector<OpenMM::Vec3>& xPrime);
+      
+      /**---------------------------------------------------------------------------------------
+      
+         Second update: compute velocities from the constrained positions
+      
+         @param numberOfAtoms       number of atoms
+         @param atomCoordinates     atom coordinates
+         @param velocities          velocities
+         @param inverseMasses       inverse atom masses
+         @param xPrime              xPrime
+      
+         --------------------------------------------------------------------------------------- */
       
+      virtual void updatePart2(int numberOfAtoms, std::vector<OpenMM::Vec3>& atomCoordinates, std::vector<OpenMM::Vec3>& velocities,
+                               std::vector<double>& inverseMasses, std::vector<OpenMM::Vec3>& xPrime);
 };
 
 } // namespace OpenMM
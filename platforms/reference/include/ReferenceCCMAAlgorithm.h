@@ -78,6 +78,16 @@ public:
      */
     int getNumberOfConstraints() const;
 
+    /**
+     * Get the parameters of a constraint.
+     *
+     * @param index     the index of the constraint
+     * @param atom1     the index of the first atom
+     * @param atom2     the index of the second atom
+     * @param distance  the constrained distance
+     */
+    void getConstraintParameters(int index, int& atom1, int& atom2, double& distance) const;
+
     /**
      * Get the maximum number of iterations to perform.
      */
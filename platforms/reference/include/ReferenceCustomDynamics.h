@@ -31,6 +31,7 @@
 #include "openmm/internal/CustomIntegratorUtilities.h"
 #include "openmm/internal/CompiledExpressionSet.h"
 #include "openmm/internal/VectorExpression.h"
+#include "openmm/internal/windowsExport.h"
 #include "lepton/CompiledExpression.h"
 
 #include <map>
@@ -39,8 +40,8 @@
 
 namespace OpenMM {
 
-class ReferenceCustomDynamics : public ReferenceDynamics {
-private:
+class OPENMM_EXPORT ReferenceCustomDynamics : public ReferenceDynamics {
+protected:
 
     class DerivFunction;
     const OpenMM::CustomIntegrator& integrator;
@@ -76,6 +77,39 @@ private:
     
     void recordChangedParameters(OpenMM::ContextImpl& context, std::map<std::string, double>& globals);
 
+    /**
+     * Get the array a ComputePerDof step stores its results in.
+     */
+    std::vector<OpenMM::Vec3>* getPerDofResults(int step, std::vector<OpenMM::Vec3>& atomCoordinates, std::vector<OpenMM::Vec3>& velocities,
+                  std::vector<std::vector<OpenMM::Vec3> >& perDof);
+
+    /**
+     * Execute a sequence of consecutive ComputePerDof steps, optionally ending with a ComputeSum step.  Each
+     * step only depends on the values of the same degree of freedom computed by earlier steps, so subclasses
+     * may evaluate all of them for one degree of freedom before moving on to the next.  The sequence only
+     * contains more than one step if canFuseSteps() returns true.
+     *
+     * @param steps          the indices of the steps to execute
+     * @param numberOfAtoms  number of atoms
+     * @param atomCoordinates atom coordinates
+     * @param velocities     velocities
+     * @param stepForces     the forces to use for each step
+     * @param stepEnergy     the energy to use for each step
+     * @param masses         atom masses
+     * @param globals        a map containing values of global variables
+     * @param perDof         the values of per-DOF variables
+     */
+    virtual void computePerDofSteps(const std::vector<int>& steps, int numberOfAtoms, std::vector<OpenMM::Vec3>& atomCoordinates,
+                  std::vector<OpenMM::Vec3>& velocities, const std::vector<std::vector<OpenMM::Vec3>*>& stepForces, const std::vector<double>& stepEnergy,
+                  std::vector<double>& masses, std::map<std::string, double>& globals, std::vector<std::vector<OpenMM::Vec3> >& perDof);
+
+    /**
+     * Get whether consecutive steps may be passed to computePerDofSteps() together.
+     */
+    virtual bool canFuseSteps() const {
+        return false;
+    }
+
     bool evaluateCondition(int step);
       
 public:
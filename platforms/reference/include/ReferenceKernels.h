@@ -156,6 +156,13 @@ public:
      * @param positions  on exit, this contains the particle positions
      */
     void getPositions(ContextImpl& context, std::vector<Vec3>& positions);
+    /**
+     * Get the positions of a subset of particles.
+     *
+     * @param indices    the indices of the particles to get
+     * @param positions  on exit, positions[i] contains the position of particle indices[i]
+     */
+    void getPositions(ContextImpl& context, const std::vector<int>& indices, std::vector<Vec3>& positions);
     /**
      * Set the positions of all particles.
      *
@@ -168,6 +175,13 @@ public:
      * @param velocities  on exit, this contains the particle velocities
      */
     void getVelocities(ContextImpl& context, std::vector<Vec3>& velocities);
+    /**
+     * Get the velocities of a subset of particles.
+     *
+     * @param indices     the indices of the particles to get
+     * @param velocities  on exit, velocities[i] contains the velocity of particle indices[i]
+     */
+    void getVelocities(ContextImpl& context, const std::vector<int>& indices, std::vector<Vec3>& velocities);
     /**
      * Set the velocities of all particles.
      *
@@ -189,6 +203,13 @@ public:
      * @param forces  on exit, this contains the forces
      */
     void getForces(ContextImpl& context, std::vector<Vec3>& forces);
+    /**
+     * Get the current forces on a subset of particles.
+     *
+     * @param indices  the indices of the particles to get
+     * @param forces   on exit, forces[i] contains the force on particle indices[i]
+     */
+    void getForces(ContextImpl& context, const std::vector<int>& indices, std::vector<Vec3>& forces);
     /**
      * Get the current derivatives of the energy with respect to context parameters.
      *
@@ -26,15 +26,16 @@
 #define __ReferenceNoseHooverDynamics_H__
 
 #include "ReferenceDynamics.h"
+#include "openmm/internal/windowsExport.h"
 #include <tuple>
 
 namespace OpenMM {
 
 class ContextImpl;
 
-class ReferenceNoseHooverDynamics : public ReferenceDynamics {
+class OPENMM_EXPORT ReferenceNoseHooverDynamics : public ReferenceDynamics {
 
-   private:
+   protected:
       std::vector<OpenMM::Vec3> xPrime;
       std::vector<OpenMM::Vec3> oldx;
       std::vector<double> inverseMasses;
@@ -102,7 +103,66 @@ class ReferenceNoseHooverDynamics : public ReferenceDynamics {
       void step2(OpenMM::ContextImpl &context, const OpenMM::System& system, std::vector<OpenMM::Vec3>& atomCoordinates,
                  std::vector<OpenMM::Vec3>& velocities, std::vector<OpenMM::Vec3>& forces, std::vector<double>& masses, double tolerance, bool &forcesAreValid,
                  const std::vector<int> & allAtoms, const std::vector<std::tuple<int, int, double>> & allPairs, double maxPairDistance);
+
+      /**---------------------------------------------------------------------------------------
+      
+         Advance the velocities of all thermostated particles and Drude-like pairs by one step
+      
+         @param velocities          velocities
+         @param forces              forces
+         @param masses              atom masses
+         @param inverseMasses       inverse atom masses
+         @param allAtoms            a list of all atoms not involved in a Drude-like pair
+         @param allPairs            a list of all Drude-like pairs, and their KT values, in the system
+      
+         --------------------------------------------------------------------------------------- */
+      
+      virtual void updatePart1(std::vector<OpenMM::Vec3>& velocities, std::vector<OpenMM::Vec3>& forces, std::vector<double>& masses,
+                               std::vector<double>& inverseMasses, const std::vector<int>& allAtoms, const std::vector<std::tuple<int, int, double>>& allPairs);
+      
+      /**---------------------------------------------------------------------------------------
+      
+         Advance the positions by the first half step
+      
+         @param numberOfAtoms       number of atoms
+         @param atomCoordinates     atom coordinates
+         @param velocities          velocities
+         @param inverseMasses       inverse atom masses
+         @param xPrime              xPrime
+      
+         --------------------------------------------------------------------------------------- */
+      
+      virtual void updatePart2(int numberOfAtoms, std::vector<OpenMM::Vec3>& atomCoordinates, std::vector<OpenMM::Vec3>& velocities,
+                               std::vector<double>& inverseMasses, std::vector<OpenMM::Vec3>& xPrime);
+      
+      /**---------------------------------------------------------------------------------------
+      
+         Advance the positions by the second half step
+      
+         @param numberOfAtoms       number of atoms
+         @param velocities          velocities
+         @param inverseMasses       inverse atom masses
+         @param xPrime              xPrime
+      
+         --------------------------------------------------------------------------------------- */
+      
+      virtual void updatePart3(int numberOfAtoms, std::vector<OpenMM::Vec3>& velocities, std::vector<double>& inverseMasses,
+                               std::vector<OpenMM::Vec3>& xPrime);
+      
+      /**---------------------------------------------------------------------------------------
+      
+         Apply the constraint corrections to the velocities and store the new positions
+      
+         @param numberOfAtoms       number of atoms
+         @param atomCoordinates     atom coordinates
+         @param velocities          velocities
+         @param inverseMasses       inverse atom masses
+         @param xPrime              xPrime
+      
+         --------------------------------------------------------------------------------------- */
       
+      virtual void updatePart4(int numberOfAtoms, std::vector<OpenMM::Vec3>& atomCoordinates, std::vector<OpenMM::Vec3>& velocities,
+                               std::vector<double>& inverseMasses, std::vector<OpenMM::Vec3>& xPrime);
 };
 
 } // namespace OpenMM
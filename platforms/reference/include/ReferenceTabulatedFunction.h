@@ -55,6 +55,7 @@ public:
     double evaluate(const double* arguments) const;
     double evaluateDerivative(const double* arguments, const int* derivOrder) const;
     CustomFunction* clone() const;
+    bool getPiecewiseCubicGrid(std::vector<double>& min, std::vector<double>& max, std::vector<int>& numCells, bool& periodic) const;
 private:
     ReferenceContinuous1DFunction(const ReferenceContinuous1DFunction& other);
     const Continuous1DFunction& function;
@@ -73,6 +74,7 @@ public:
     double evaluate(const double* arguments) const;
     double evaluateDerivative(const double* arguments, const int* derivOrder) const;
     CustomFunction* clone() const;
+    bool getPiecewiseCubicGrid(std::vector<double>& min, std::vector<double>& max, std::vector<int>& numCells, bool& periodic) const;
 private:
     ReferenceContinuous2DFunction(const ReferenceContinuous2DFunction& other);
     const Continuous2DFunction& function;
@@ -93,6 +95,7 @@ public:
     double evaluate(const double* arguments) const;
     double evaluateDerivative(const double* arguments, const int* derivOrder) const;
     CustomFunction* clone() const;
+    bool getPiecewiseCubicGrid(std::vector<double>& min, std::vector<double>& max, std::vector<int>& numCells, bool& periodic) const;
 private:
     ReferenceContinuous3DFunction(const ReferenceContinuous3DFunction& other);
     const Continuous3DFunction& function;
@@ -162,6 +165,7 @@ public:
     double evaluate(const double* arguments) const;
     double evaluateDerivative(const double* arguments, const int* derivOrder) const;
     CustomFunction* clone() const;
+    bool getPiecewiseCubicGrid(std::vector<double>& min, std::vector<double>& max, std::vector<int>& numCells, bool& periodic) const;
 private:
     std::shared_ptr<const CustomFunction> pointer;
 };
@@ -26,12 +26,13 @@
 #define __ReferenceVariableStochasticDynamics_H__
 
 #include "ReferenceDynamics.h"
+#include "openmm/internal/windowsExport.h"
 
 namespace OpenMM {
 
-class ReferenceVariableStochasticDynamics : public ReferenceDynamics {
+class OPENMM_EXPORT ReferenceVariableStochasticDynamics : public ReferenceDynamics {
 
-   private:
+   protected:
 
       std::vector<OpenMM::Vec3> xPrime, oldx;
       std::vector<double> inverseMasses;
@@ -103,8 +104,39 @@ class ReferenceVariableStochasticDynamics : public ReferenceDynamics {
       void update(const OpenMM::System& system, std::vector<OpenMM::Vec3>& atomCoordinates,
                   std::vector<OpenMM::Vec3>& velocities, std::vector<OpenMM::Vec3>& forces, std::vector<double>& masses, double maxStepSize, double tolerance);
 
+      /**---------------------------------------------------------------------------------------
+
+         Compute the RMS acceleration, which is used to select the step size
+
+         @param numberOfAtoms       number of atoms
+         @param forces              forces
+         @param inverseMasses       inverse atom masses
+
+         @return the error estimate
+
+         --------------------------------------------------------------------------------------- */
+
+      virtual double computeForceError(int numberOfAtoms, std::vector<OpenMM::Vec3>& forces, std::vector<double>& inverseMasses);
+
+      /**---------------------------------------------------------------------------------------
+
+         Select the size of the next step based on the current forces
+
+         @param numberOfAtoms       number of atoms
+         @param forces              forces
+         @param inverseMasses       inverse atom masses
+         @param maxStepSize         maximum time step
+
+         @return the step size to use
+
+         --------------------------------------------------------------------------------------- */
+
+      double selectStepSize(int numberOfAtoms, std::vector<OpenMM::Vec3>& forces, std::vector<double>& inverseMasses, double maxStepSize);
+
       /**---------------------------------------------------------------------------------------
             
+         First update: select the step size and advance the velocities
+
          @param numberOfAtoms       number of atoms
          @param velocities          velocities
          @param forces              forces
@@ -113,7 +145,7 @@ class ReferenceVariableStochasticDynamics : public ReferenceDynamics {
       
          --------------------------------------------------------------------------------------- */
       
-      void updatePart1(int numberOfAtoms, std::vector<OpenMM::Vec3>& velocities,  std::vector<OpenMM::Vec3>& forces, std::vector<double>& inverseMasses, double maxStepSize);
+      virtual void updatePart1(int numberOfAtoms, std::vector<OpenMM::Vec3>& velocities,  std::vector<OpenMM::Vec3>& forces, std::vector<double>& inverseMasses, double maxStepSize);
 
       /**---------------------------------------------------------------------------------------
       
@@ -127,9 +159,23 @@ class ReferenceVariableStochasticDynamics : public ReferenceDynamics {
       
          --------------------------------------------------------------------------------------- */
       
-      void updatePart2(int numberOfAtoms, std::vector<OpenMM::Vec3>& atomCoordinates, std::vector<OpenMM::Vec3>& velocities,
+      virtual void updatePart2(int numberOfAtoms, std::vector<OpenMM::Vec3>& atomCoordinates, std::vector<OpenMM::Vec3>& velocities,
                                std::vector<double>& inverseMasses, std::vector<OpenMM::Vec3>& xPrime);
+
+      /**---------------------------------------------------------------------------------------
+      
+         Third update
       
+         @param numberOfAtoms       number of atoms
+         @param atomCoordinates     atom coordinates
+         @param velocities          velocities
+         @param inverseMasses       inverse atom masses
+         @param xPrime              xPrime
+      
+         --------------------------------------------------------------------------------------- */
+      
+      virtual void updatePart3(int numberOfAtoms, std::vector<OpenMM::Vec3>& atomCoordinates, std::vector<OpenMM::Vec3>& velocities,
+                               std::vector<double>& inverseMasses, std::vector<OpenMM::Vec3>& xPrime);
 };
 
 } // namespace OpenMM
@@ -26,12 +26,13 @@
 #define __ReferenceVariableVerletDynamics_H__
 
 #include "ReferenceDynamics.h"
+#include "openmm/internal/windowsExport.h"
 
 namespace OpenMM {
 
-class ReferenceVariableVerletDynamics : public ReferenceDynamics {
+class OPENMM_EXPORT ReferenceVariableVerletDynamics : public ReferenceDynamics {
 
-   private:
+   protected:
 
       std::vector<OpenMM::Vec3> xPrime;
       std::vector<double> inverseMasses;
@@ -93,6 +94,51 @@ class ReferenceVariableVerletDynamics : public ReferenceDynamics {
       void update(const OpenMM::System& system, std::vector<OpenMM::Vec3>& atomCoordinates,
                   std::vector<OpenMM::Vec3>& velocities, std::vector<OpenMM::Vec3>& forces, std::vector<double>& masses, double maxStepSize, double tolerance);
 
+      /**---------------------------------------------------------------------------------------
+
+         Compute the RMS acceleration, which is used to select the step size
+
+         @param numberOfAtoms       number of atoms
+         @param forces              forces
+         @param inverseMasses       inverse atom masses
+
+         @return the error estimate
+
+         --------------------------------------------------------------------------------------- */
+
+      virtual double computeForceError(int numberOfAtoms, std::vector<OpenMM::Vec3>& forces, std::vector<double>& inverseMasses);
+
+      /**---------------------------------------------------------------------------------------
+
+         First update: advance the velocities and compute unconstrained positions
+
+         @param numberOfAtoms       number of atoms
+         @param atomCoordinates     atom coordinates
+         @param velocities          velocities
+         @param forces              forces
+         @param inverseMasses       inverse atom masses
+         @param xPrime              xPrime
+         @param vstep               the time interval by which to advance the velocities
+
+         --------------------------------------------------------------------------------------- */
+
+      virtual void updatePart1(int numberOfAtoms, std::vector<OpenMM::Vec3>& atomCoordinates, std::vector<OpenMM::Vec3>& velocities,
+                               std::vector<OpenMM::Vec3>& forces, std::vector<double>& inverseMasses, std::vector<OpenMM::Vec3>& xPrime, double vstep);
+
+      /**---------------------------------------------------------------------------------------
+
+         Second update: compute velocities from the constrained positions
+
+         @param numberOfAtoms       number of atoms
+         @param atomCoordinates     atom coordinates
+         @param velocities          velocities
+         @param inverseMasses       inverse atom masses
+         @param xPrime              xPrime
+
+         --------------------------------------------------------------------------------------- */
+
+      virtual void updatePart2(int numberOfAtoms, std::vector<OpenMM::Vec3>& atomCoordinates, std::vector<OpenMM::Vec3>& velocities,
+                               std::vector<double>& inverseMasses, std::vector<OpenMM::Vec3>& xPrime);
 };
 
 } // namespace OpenMM
@@ -214,6 +214,13 @@ void ReferenceUpdateStateDataKernel::getPositions(ContextImpl& context, std::vec
         positions[i] = Vec3(posData[i][0], posData[i][1], posData[i][2]);
 }
 
+void ReferenceUpdateStateDataKernel::getPositions(ContextImpl& context, const std::vector<int>& indices, std::vector<Vec3>& positions) {
+    vector<Vec3>& posData = extractPositions(context);
+    positions.resize(indices.size());
+    for (int i = 0; i < indices.size(); ++i)
+        positions[i] = posData[indices[i]];
+}
+
 void ReferenceUpdateStateDataKernel::setPositions(ContextImpl& context, const std::vector<Vec3>& positions) {
     int numParticles = context.getSystem().getNumParticles();
     vector<Vec3>& posData = extractPositions(context);
@@ -232,6 +239,13 @@ void ReferenceUpdateStateDataKernel::getVelocities(ContextImpl& context, std::ve
         velocities[i] = Vec3(velData[i][0], velData[i][1], velData[i][2]);
 }
 
+void ReferenceUpdateStateDataKernel::getVelocities(ContextImpl& context, const std::vector<int>& indices, std::vector<Vec3>& velocities) {
+    vector<Vec3>& velData = extractVelocities(context);
+    velocities.resize(indices.size());
+    for (int i = 0; i < indices.size(); ++i)
+        velocities[i] = velData[indices[i]];
+}
+
 void ReferenceUpdateStateDataKernel::setVelocities(ContextImpl& context, const std::vector<Vec3>& velocities) {
     int numParticles = context.getSystem().getNumParticles();
     vector<Vec3>& velData = extractVelocities(context);
@@ -277,6 +291,13 @@ void ReferenceUpdateStateDataKernel::getForces(ContextImpl& context, std::vector
         forces[i] = Vec3(forceData[i][0], forceData[i][1], forceData[i][2]);
 }
 
+void ReferenceUpdateStateDataKernel::getForces(ContextImpl& context, const std::vector<int>& indices, std::vector<Vec3>& forces) {
+    vector<Vec3>& forceData = extractForces(context);
+    forces.resize(indices.size());
+    for (int i = 0; i < indices.size(); ++i)
+        forces[i] = forceData[indices[i]];
+}
+
 void ReferenceUpdateStateDataKernel::getEnergyParameterDerivatives(ContextImpl& context, map<string, double>& derivs) {
     derivs = extractEnergyParameterDerivatives(context);
 }
@@ -121,6 +121,14 @@ CustomFunction* ReferenceContinuous1DFunction::clone() const {
     return new ReferenceContinuous1DFunction(*this);
 }
 
+bool ReferenceContinuous1DFunction::getPiecewiseCubicGrid(vector<double>& min, vector<double>& max, vector<int>& numCells, bool& periodic) const {
+    min = {this->min};
+    max = {this->max};
+    numCells = {(int) x.size()-1};
+    periodic = this->periodic;
+    return true;
+}
+
 ReferenceContinuous2DFunction::ReferenceContinuous2DFunction(const Continuous2DFunction& function) : function(function) {
     periodic = function.getPeriodic();
     function.getFunctionParameters(xsize, ysize, values, xmin, xmax, ymin, ymax);
@@ -176,6 +184,14 @@ CustomFunction* ReferenceContinuous2DFunction::clone() const {
     return new ReferenceContinuous2DFunction(*this);
 }
 
+bool ReferenceContinuous2DFunction::getPiecewiseCubicGrid(vector<double>& min, vector<double>& max, vector<int>& numCells, bool& periodic) const {
+    min = {xmin, ymin};
+    max = {xmax, ymax};
+    numCells = {xsize-1, ysize-1};
+    periodic = this->periodic;
+    return true;
+}
+
 ReferenceContinuous3DFunction::ReferenceContinuous3DFunction(const Continuous3DFunction& function) : function(function) {
     periodic = function.getPeriodic();
     function.getFunctionParameters(xsize, ysize, zsize, values, xmin, xmax, ymin, ymax, zmin, zmax);
@@ -243,6 +259,14 @@ CustomFunction* ReferenceContinuous3DFunction::clone() const {
     return new ReferenceContinuous3DFunction(*this);
 }
 
+bool ReferenceContinuous3DFunction::getPiecewiseCubicGrid(vector<double>& min, vector<double>& max, vector<int>& numCells, bool& periodic) const {
+    min = {xmin, ymin, zmin};
+    max = {xmax, ymax, zmax};
+    numCells = {xsize-1, ysize-1, zsize-1};
+    periodic = this->periodic;
+    return true;
+}
+
 ReferenceDiscrete1DFunction::ReferenceDiscrete1DFunction(const Discrete1DFunction& function) : function(function) {
     function.getFunctionParameters(values);
 }
@@ -333,3 +357,7 @@ double SharedFunctionWrapper::evaluateDerivative(const double* arguments, const
 CustomFunction* SharedFunctionWrapper::clone() const {
     return new SharedFunctionWrapper(pointer);
 }
+
+bool SharedFunctionWrapper::getPiecewiseCubicGrid(vector<double>& min, vector<double>& max, vector<int>& numCells, bool& periodic) const {
+    return pointer->getPiecewiseCubicGrid(min, max, numCells, periodic);
+}
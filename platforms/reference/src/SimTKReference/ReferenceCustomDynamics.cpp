@@ -279,36 +279,33 @@ void ReferenceCustomDynamics::update(ContextImpl& context, int numberOfAtoms, ve
                 expressionSet.setVariable(stepVariableIndex[step], result);
                 break;
             }
-            case CustomIntegrator::ComputePerDof: {
-                vector<Vec3>* results = NULL;
-                if (stepVariableIndex[step] == xIndex)
-                    results = &atomCoordinates;
-                else if (stepVariableIndex[step] == vIndex)
-                    results = &velocities;
-                else {
-                    for (int j = 0; j < integrator.getNumPerDofVariables(); j++)
-                        if (stepVariableIndex[step] == perDofVariableIndex[j])
-                            results = &perDof[j];
-                }
-                if (results == NULL)
-                    throw OpenMMException("Illegal per-DOF output variable: "+stepVariable[step]);
-                if (stepVectorExpressions[step].size() > 0)
-                    computePerParticle(numberOfAtoms, *results, atomCoordinates, velocities, stepForces, masses, perDof, globals, stepVectorExpressions[step][0]);
-                else
-                    computePerDof(numberOfAtoms, *results, atomCoordinates, velocities, stepForces, masses, perDof, stepExpressions[step][0]);
-                break;
-            }
+            case CustomIntegrator::ComputePerDof:
             case CustomIntegrator::ComputeSum: {
-                if (stepVectorExpressions[step].size() > 0)
-                    computePerParticle(numberOfAtoms, sumBuffer, atomCoordinates, velocities, stepForces, masses, perDof, globals, stepVectorExpressions[step][0]);
-                else
-                    computePerDof(numberOfAtoms, sumBuffer, atomCoordinates, velocities, stepForces, masses, perDof, stepExpressions[step][0]);
-                double sum = 0.0;
-                for (int j = 0; j < numberOfAtoms; j++)
-                    if (masses[j] != 0.0)
-                        sum += sumBuffer[j][0]+sumBuffer[j][1]+sumBuffer[j][2];
-                globals[stepVariable[step]] = sum;
-                expressionSet.setVariable(stepVariableIndex[step], sum);
+                // If possible, find following steps that can be executed together with this one.  They cannot
+                // need forces or energies that have not been computed yet, or that an earlier step invalidates.
+
+                vector<int> steps(1, step);
+                vector<vector<Vec3>*> perDofForces(1, &stepForces);
+                vector<double> perDofEnergy(1, energy);
+                if (canFuseSteps() && stepType[step] == CustomIntegrator::ComputePerDof && stepVectorExpressions[step].size() == 0) {
+                    for (int next = step+1; next < numSteps; next++) {
+                        if ((stepType[next] != CustomIntegrator::ComputePerDof && stepType[next] != CustomIntegrator::ComputeSum) || stepVectorExpressions[next].size() > 0)
+                            break;
+                        int nextFlags = forceGroupFlags[next];
+                        if (needsForces[next] && (stepInvalidatesForces || groupForces.find(nextFlags) == groupForces.end()))
+                            break;
+                        if (needsEnergy[next] && (stepInvalidatesForces || groupEnergy.find(nextFlags) == groupEnergy.end()))
+                            break;
+                        steps.push_back(next);
+                        perDofForces.push_back(needsForces[next] ? &groupForces[nextFlags] : &forces);
+                        perDofEnergy.push_back(needsEnergy[next] ? groupEnergy[nextFlags] : 0);
+                        stepInvalidatesForces |= invalidatesForces[next];
+                        if (stepType[next] == CustomIntegrator::ComputeSum)
+                            break;
+                    }
+                }
+                computePerDofSteps(steps, numberOfAtoms, atomCoordinates, velocities, perDofForces, perDofEnergy, masses, globals, perDof);
+                nextStep = steps.back()+1;
                 break;
             }
             case CustomIntegrator::ConstrainPositions: {
@@ -356,6 +353,46 @@ void ReferenceCustomDynamics::update(ContextImpl& context, int numberOfAtoms, ve
     recordChangedParameters(context, globals);
 }
 
+vector<Vec3>* ReferenceCustomDynamics::getPerDofResults(int step, vector<Vec3>& atomCoordinates, vector<Vec3>& velocities, vector<vector<Vec3> >& perDof) {
+    if (stepVariableIndex[step] == xIndex)
+        return &atomCoordinates;
+    if (stepVariableIndex[step] == vIndex)
+        return &velocities;
+    for (int j = 0; j < integrator.getNumPerDofVariables(); j++)
+        if (stepVariableIndex[step] == perDofVariableIndex[j])
+            return &perDof[j];
+    throw OpenMMException("Illegal per-DOF output variable: "+stepVariable[step]);
+}
+
+void ReferenceCustomDynamics::computePerDofSteps(const vector<int>& steps, int numberOfAtoms, vector<Vec3>& atomCoordinates, vector<Vec3>& velocities,
+              const vector<vector<Vec3>*>& stepForces, const vector<double>& stepEnergy, vector<double>& masses,
+              map<string, double>& globals, vector<vector<Vec3> >& perDof) {
+    for (int i = 0; i < (int) steps.size(); i++) {
+        int step = steps[i];
+        energy = stepEnergy[i];
+        vector<Vec3>& forces = *stepForces[i];
+        if (stepType[step] == CustomIntegrator::ComputePerDof) {
+            vector<Vec3>* results = getPerDofResults(step, atomCoordinates, velocities, perDof);
+            if (stepVectorExpressions[step].size() > 0)
+                computePerParticle(numberOfAtoms, *results, atomCoordinates, velocities, forces, masses, perDof, globals, stepVectorExpressions[step][0]);
+            else
+                computePerDof(numberOfAtoms, *results, atomCoordinates, velocities, forces, masses, perDof, stepExpressions[step][0]);
+        }
+        else {
+            if (stepVectorExpressions[step].size() > 0)
+                computePerParticle(numberOfAtoms, sumBuffer, atomCoordinates, velocities, forces, masses, perDof, globals, stepVectorExpressions[step][0]);
+            else
+                computePerDof(numberOfAtoms, sumBuffer, atomCoordinates, velocities, forces, masses, perDof, stepExpressions[step][0]);
+            double sum = 0.0;
+            for (int j = 0; j < numberOfAtoms; j++)
+                if (masses[j] != 0.0)
+                    sum += sumBuffer[j][0]+sumBuffer[j][1]+sumBuffer[j][2];
+            globals[stepVariable[step]] = sum;
+            expressionSet.setVariable(stepVariableIndex[step], sum);
+        }
+    }
+}
+
 void ReferenceCustomDynamics::computePerDof(int numberOfAtoms, vector<Vec3>& results, const vector<Vec3>& atomCoordinates,
               const vector<Vec3>& velocities, const vector<Vec3>& forces, const vector<double>& masses,
               const vector<vector<Vec3> >& perDof, const CompiledExpression& expression) {
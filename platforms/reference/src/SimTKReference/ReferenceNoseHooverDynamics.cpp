@@ -68,48 +68,14 @@ void ReferenceNoseHooverDynamics::step1(OpenMM::ContextImpl &context, const Open
        }
     }
 
-
-    const double halfdt = 0.5*getDeltaT();
-    // Regular atoms
-    for (const auto &atom : atomList) {
-        if (masses[atom] != 0.0) {
-            velocities[atom] += inverseMasses[atom]*forces[atom]*getDeltaT();
-        }
-    }
-    // Connected particles
-    for (const auto &pair : pairList) {
-        const auto &atom1 = std::get<0>(pair);
-        const auto &atom2 = std::get<1>(pair);
-        double m1 = masses[atom1];
-        double m2 = masses[atom2];
-        double mass1fract = m1 / (m1 + m2);
-        double mass2fract = m2 / (m1 + m2);
-        double invRedMass = (m1 * m2 != 0.0) ? (m1 + m2)/(m1 * m2) : 0.0;
-        double invTotMass = (m1 + m2 != 0.0) ? 1.0 /(m1 + m2) : 0.0;
-        Vec3 comVel = velocities[atom1]*mass1fract + velocities[atom2]*mass2fract;
-        Vec3 relVel = velocities[atom2] - velocities[atom1];
-        Vec3 comForce = forces[atom1] + forces[atom2];
-        Vec3 relForce = mass1fract*forces[atom2] - mass2fract*forces[atom1];
-        comVel += comForce * getDeltaT() * invTotMass;
-        relVel += relForce * getDeltaT() * invRedMass; 
-        if (m1 != 0.0) {
-            velocities[atom1] = comVel - relVel*mass2fract;
-        }
-        if (m2 != 0.0) {
-            velocities[atom2] = comVel + relVel*mass1fract;
-        }
-    }
+    updatePart1(velocities, forces, masses, inverseMasses, atomList, pairList);
 
     ReferenceConstraintAlgorithm* referenceConstraintAlgorithm = getReferenceConstraintAlgorithm();
     if (referenceConstraintAlgorithm) {
         referenceConstraintAlgorithm->applyToVelocities(atomCoordinates, velocities, inverseMasses, tolerance);
     }
 
-    for (int atom = 0; atom < numberOfAtoms; ++atom) {
-        if (masses[atom] != 0.0) {
-            xPrime[atom] = atomCoordinates[atom] + velocities[atom]*halfdt;
-        }
-    }
+    updatePart2(numberOfAtoms, atomCoordinates, velocities, inverseMasses, xPrime);
 }
 
 
@@ -118,24 +84,13 @@ void ReferenceNoseHooverDynamics::step2(OpenMM::ContextImpl &context, const Open
                                           vector<Vec3>& forces, vector<double>& masses, double tolerance, bool &forcesAreValid,
                                           const std::vector<int> & atomList, const std::vector<std::tuple<int, int, double>> &pairList,
                                           double maxPairDistance) {
-    const double halfdt = 0.5*getDeltaT();
-    for (int atom = 0; atom < numberOfAtoms; ++atom) {
-        if (masses[atom] != 0.0) {
-            xPrime[atom] += velocities[atom]*halfdt;
-            oldx[atom] = xPrime[atom];
-        }
-    }
+    updatePart3(numberOfAtoms, velocities, inverseMasses, xPrime);
 
     ReferenceConstraintAlgorithm* referenceConstraintAlgorithm = getReferenceConstraintAlgorithm();
     if (referenceConstraintAlgorithm)
         referenceConstraintAlgorithm->apply(atomCoordinates, xPrime, inverseMasses, tolerance);
 
-    for (int i = 0; i < numberOfAtoms; i++) {
-        if (inverseMasses[i] != 0.0) {
-            velocities[i] += (xPrime[i]-oldx[i])/getDeltaT();
-            atomCoordinates[i] = xPrime[i];
-        }
-    }
+    updatePart4(numberOfAtoms, atomCoordinates, velocities, inverseMasses, xPrime);
 
     // Apply hard wall constraints.
     if (maxPairDistance > 0) {
@@ -206,3 +161,66 @@ void ReferenceNoseHooverDynamics::step2(OpenMM::ContextImpl &context, const Open
 
     incrementTimeStep();
 }
+
+void ReferenceNoseHooverDynamics::updatePart1(vector<Vec3>& velocities, vector<Vec3>& forces, vector<double>& masses, vector<double>& inverseMasses,
+                                              const std::vector<int>& atomList, const std::vector<std::tuple<int, int, double>>& pairList) {
+    // Regular atoms
+    for (const auto &atom : atomList) {
+        if (masses[atom] != 0.0) {
+            velocities[atom] += inverseMasses[atom]*forces[atom]*getDeltaT();
+        }
+    }
+    // Connected particles
+    for (const auto &pair : pairList) {
+        const auto &atom1 = std::get<0>(pair);
+        const auto &atom2 = std::get<1>(pair);
+        double m1 = masses[atom1];
+        double m2 = masses[atom2];
+        double mass1fract = m1 / (m1 + m2);
+        double mass2fract = m2 / (m1 + m2);
+        double invRedMass = (m1 * m2 != 0.0) ? (m1 + m2)/(m1 * m2) : 0.0;
+        double invTotMass = (m1 + m2 != 0.0) ? 1.0 /(m1 + m2) : 0.0;
+        Vec3 comVel = velocities[atom1]*mass1fract + velocities[atom2]*mass2fract;
+        Vec3 relVel = velocities[atom2] - velocities[atom1];
+        Vec3 comForce = forces[atom1] + forces[atom2];
+        Vec3 relForce = mass1fract*forces[atom2] - mass2fract*forces[atom1];
+        comVel += comForce * getDeltaT() * invTotMass;
+        relVel += relForce * getDeltaT() * invRedMass; 
+        if (m1 != 0.0) {
+            velocities[atom1] = comVel - relVel*mass2fract;
+        }
+        if (m2 != 0.0) {
+            velocities[atom2] = comVel + relVel*mass1fract;
+        }
+    }
+}
+
+void ReferenceNoseHooverDynamics::updatePart2(int numberOfAtoms, vector<Vec3>& atomCoordinates, vector<Vec3>& velocities,
+                                              vector<double>& inverseMasses, vector<Vec3>& xPrime) {
+    const double halfdt = 0.5*getDeltaT();
+    for (int atom = 0; atom < numberOfAtoms; ++atom) {
+        if (inverseMasses[atom] != 0.0) {
+            xPrime[atom] = atomCoordinates[atom] + velocities[atom]*halfdt;
+        }
+    }
+}
+
+void ReferenceNoseHooverDynamics::updatePart3(int numberOfAtoms, vector<Vec3>& velocities, vector<double>& inverseMasses, vector<Vec3>& xPrime) {
+    const double halfdt = 0.5*getDeltaT();
+    for (int atom = 0; atom < numberOfAtoms; ++atom) {
+        if (inverseMasses[atom] != 0.0) {
+            xPrime[atom] += velocities[atom]*halfdt;
+            oldx[atom] = xPrime[atom];
+        }
+    }
+}
+
+void ReferenceNoseHooverDynamics::updatePart4(int numberOfAtoms, vector<Vec3>& atomCoordinates, vector<Vec3>& velocities,
+                                              vector<double>& inverseMasses, vector<Vec3>& xPrime) {
+    for (int i = 0; i < numberOfAtoms; i++) {
+        if (inverseMasses[i] != 0.0) {
+            velocities[i] += (xPrime[i]-oldx[i])/getDeltaT();
+            atomCoordinates[i] = xPrime[i];
+        }
+    }
+}
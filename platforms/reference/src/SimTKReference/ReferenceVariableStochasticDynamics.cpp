@@ -98,8 +98,7 @@ double ReferenceVariableStochasticDynamics::getFriction() const {
    return friction;
 }
 
-void ReferenceVariableStochasticDynamics::updatePart1(int numberOfAtoms, vector<Vec3>& velocities, vector<Vec3>& forces, vector<double>& inverseMasses, double maxStepSize) {
-   // Select the step size to use
+double ReferenceVariableStochasticDynamics::computeForceError(int numberOfAtoms, vector<Vec3>& forces, vector<double>& inverseMasses) {
     double error = 0;
     for (int i = 0; i < numberOfAtoms; ++i) {
         for (int j = 0; j < 3; ++j) {
@@ -107,7 +106,11 @@ void ReferenceVariableStochasticDynamics::updatePart1(int numberOfAtoms, vector<
             error += xerror*xerror;
         }
     }
-    error = sqrt(error/(numberOfAtoms*3));
+    return sqrt(error/(numberOfAtoms*3));
+}
+
+double ReferenceVariableStochasticDynamics::selectStepSize(int numberOfAtoms, vector<Vec3>& forces, vector<double>& inverseMasses, double maxStepSize) {
+    double error = computeForceError(numberOfAtoms, forces, inverseMasses);
     double dt = sqrt(getAccuracy()/error);
     if (getDeltaT() > 0.0f)
         dt = std::min(dt, getDeltaT()*2.0f); // For safety, limit how quickly dt can increase.
@@ -115,6 +118,12 @@ void ReferenceVariableStochasticDynamics::updatePart1(int numberOfAtoms, vector<
         dt = getDeltaT(); // Keeping dt constant between steps improves the behavior of the integrator.
     if (dt > maxStepSize)
         dt = maxStepSize;
+    return dt;
+}
+
+void ReferenceVariableStochasticDynamics::updatePart1(int numberOfAtoms, vector<Vec3>& velocities, vector<Vec3>& forces, vector<double>& inverseMasses, double maxStepSize) {
+   // Select the step size to use
+    double dt = selectStepSize(numberOfAtoms, forces, inverseMasses, maxStepSize);
     setDeltaT(dt);
  
     // perform first update
@@ -146,6 +155,18 @@ void ReferenceVariableStochasticDynamics::updatePart2(int numberOfAtoms, vector<
     }
 }
 
+void ReferenceVariableStochasticDynamics::updatePart3(int numberOfAtoms, vector<Vec3>& atomCoordinates,
+                                         vector<Vec3>& velocities, vector<double>& inverseMasses,
+                                         vector<Vec3>& xPrime) {
+    double invStepSize = 1.0/getDeltaT();
+    for (int i = 0; i < numberOfAtoms; i++) {
+        if (inverseMasses[i] != 0.0) {
+            velocities[i] += (xPrime[i]-oldx[i])*invStepSize;
+            atomCoordinates[i] = xPrime[i];
+        }
+    }
+}
+
 /**---------------------------------------------------------------------------------------
 
    Update -- driver routine for performing stochastic dynamics update of coordinates
@@ -189,13 +210,7 @@ void ReferenceVariableStochasticDynamics::update(const OpenMM::System& system, v
 
     // copy xPrime -> atomCoordinates
 
-    double invStepSize = 1.0/getDeltaT();
-    for (int i = 0; i < numberOfAtoms; i++) {
-        if (masses[i] != 0.0) {
-            velocities[i] += (xPrime[i]-oldx[i])*invStepSize;
-            atomCoordinates[i] = xPrime[i];
-        }
-    }
+    updatePart3(numberOfAtoms, atomCoordinates, velocities, inverseMasses, xPrime);
 
     getVirtualSites().computePositions(system, atomCoordinates);
     incrementTimeStep();
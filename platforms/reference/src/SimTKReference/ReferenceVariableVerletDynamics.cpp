@@ -111,14 +111,7 @@ void ReferenceVariableVerletDynamics::update(const OpenMM::System& system, vecto
        }
     }
 
-    double error = 0.0;
-    for (int i = 0; i < numberOfAtoms; ++i) {
-        for (int j = 0; j < 3; ++j) {
-            double xerror = inverseMasses[i]*forces[i][j];
-            error += xerror*xerror;
-        }
-    }
-    error = sqrt(error/(numberOfAtoms*3));
+    double error = computeForceError(numberOfAtoms, forces, inverseMasses);
     double newStepSize = sqrt(getAccuracy()/error);
     if (getDeltaT() > 0.0f)
         newStepSize = std::min(newStepSize, getDeltaT()*2.0f); // For safety, limit how quickly dt can increase.
@@ -128,29 +121,50 @@ void ReferenceVariableVerletDynamics::update(const OpenMM::System& system, vecto
         newStepSize = maxStepSize;
     double vstep = 0.5f*(newStepSize+getDeltaT()); // The time interval by which to advance the velocities
     setDeltaT(newStepSize);
+    updatePart1(numberOfAtoms, atomCoordinates, velocities, forces, inverseMasses, xPrime, vstep);
+    ReferenceConstraintAlgorithm* referenceConstraintAlgorithm = getReferenceConstraintAlgorithm();
+    if (referenceConstraintAlgorithm)
+        referenceConstraintAlgorithm->apply(atomCoordinates, xPrime, inverseMasses, tolerance);
+
+   // Update the positions and velocities.
+
+   updatePart2(numberOfAtoms, atomCoordinates, velocities, inverseMasses, xPrime);
+   getVirtualSites().computePositions(system, atomCoordinates);
+   incrementTimeStep();
+}
+
+
+
+double ReferenceVariableVerletDynamics::computeForceError(int numberOfAtoms, vector<Vec3>& forces, vector<double>& inverseMasses) {
+    double error = 0.0;
+    for (int i = 0; i < numberOfAtoms; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            double xerror = inverseMasses[i]*forces[i][j];
+            error += xerror*xerror;
+        }
+    }
+    return sqrt(error/(numberOfAtoms*3));
+}
+
+void ReferenceVariableVerletDynamics::updatePart1(int numberOfAtoms, vector<Vec3>& atomCoordinates, vector<Vec3>& velocities,
+                                                  vector<Vec3>& forces, vector<double>& inverseMasses, vector<Vec3>& xPrime, double vstep) {
     for (int i = 0; i < numberOfAtoms; ++i) {
-        if (masses[i] != 0.0)
+        if (inverseMasses[i] != 0.0)
             for (int j = 0; j < 3; ++j) {
                 double vPrime = velocities[i][j] + inverseMasses[i]*forces[i][j]*vstep;
                 xPrime[i][j] = atomCoordinates[i][j] + vPrime*getDeltaT();
             }
     }
-    ReferenceConstraintAlgorithm* referenceConstraintAlgorithm = getReferenceConstraintAlgorithm();
-    if (referenceConstraintAlgorithm)
-        referenceConstraintAlgorithm->apply(atomCoordinates, xPrime, inverseMasses, tolerance);
-
-   // Update the positions and velocities.
+}
 
+void ReferenceVariableVerletDynamics::updatePart2(int numberOfAtoms, vector<Vec3>& atomCoordinates, vector<Vec3>& velocities,
+                                                  vector<double>& inverseMasses, vector<Vec3>& xPrime) {
    double velocityScale = 1.0/getDeltaT();
    for (int i = 0; i < numberOfAtoms; ++i) {
-       if (masses[i] != 0.0)
+       if (inverseMasses[i] != 0.0)
            for (int j = 0; j < 3; ++j) {
                velocities[i][j] = velocityScale*(xPrime[i][j] - atomCoordinates[i][j]);
                atomCoordinates[i][j] = xPrime[i][j];
            }
    }
-   getVirtualSites().computePositions(system, atomCoordinates);
-   incrementTimeStep();
 }
-
-
@@ -56,19 +56,119 @@ static const int PME_ORDER = 5;
 bool CpuCalcDispersionPmeReciprocalForceKernel::hasInitializedThreads = false;
 int CpuCalcDispersionPmeReciprocalForceKernel::numThreads = 0;
 
+/**
+ * This class finds the grid points a particle's charge is spread over, and computes its B-spline coefficients.
+ */
+class GridMapper {
+public:
+    GridMapper(int gridx, int gridy, int gridz, const Vec3* periodicBoxVectors, const Vec3* recipBoxVectors) :
+            boxSize((float) periodicBoxVectors[0][0], (float) periodicBoxVectors[1][1], (float) periodicBoxVectors[2][2], 0),
+            invBoxSize((float) recipBoxVectors[0][0], (float) recipBoxVectors[1][1], (float) recipBoxVectors[2][2], 0),
+            recipBoxVec0((float) recipBoxVectors[0][0], (float) recipBoxVectors[0][1], (float) recipBoxVectors[0][2], 0),
+            recipBoxVec1((float) recipBoxVectors[1][0], (float) recipBoxVectors[1][1], (float) recipBoxVectors[1][2], 0),
+            recipBoxVec2((float) recipBoxVectors[2][0], (float) recipBoxVectors[2][1], (float) recipBoxVectors[2][2], 0),
+            gridSize(gridx, gridy, gridz, 0), gridSizeInt(gridx, gridy, gridz, 0) {
+    }
+    /**
+     * Find the grid point a particle's charge starts being spread at, and the fractional offset from it.
+     */
+    ivec4 findGridIndex(const float* pos, fvec4& dr) const {
+        float posInBox[4];
+        fvec4 p(pos);
+        (p-boxSize*floor(p*invBoxSize)).store(posInBox);
+        fvec4 t = posInBox[0]*recipBoxVec0 + posInBox[1]*recipBoxVec1 + posInBox[2]*recipBoxVec2;
+        t = (t-floor(t))*gridSize;
+        ivec4 ti = t;
+        dr = t-ti;
+        return ti-(gridSizeInt&ti==gridSizeInt);
+    }
+    /**
+     * Compute the B-spline coefficients for a particle.
+     */
+    static void computeSplines(const fvec4& dr, fvec4* data) {
+        fvec4 one(1);
+        fvec4 scale(1.0f/(PME_ORDER-1));
+        data[PME_ORDER-1] = 0.0f;
+        data[1] = dr;
+        data[0] = one-dr;
+        for (int j = 3; j < PME_ORDER; j++) {
+            fvec4 div(1.0f/(j-1));
+            data[j-1] = div*dr*data[j-2];
+            for (int k = 1; k < j-1; k++)
+                data[j-k-1] = div*((dr+k)*data[j-k-2]+(fvec4(j-k)-dr)*data[j-k-1]);
+            data[0] = div*(one-dr)*data[0];
+        }
+        data[PME_ORDER-1] = scale*dr*data[PME_ORDER-2];
+        for (int j = 1; j < (PME_ORDER-1); j++)
+            data[PME_ORDER-j-1] = scale*((dr+j)*data[PME_ORDER-j-2]+(fvec4(PME_ORDER-j)-dr)*data[PME_ORDER-j-1]);
+        data[0] = scale*(one-dr)*data[0];
+    }
+private:
+    fvec4 boxSize, invBoxSize, recipBoxVec0, recipBoxVec1, recipBoxVec2, gridSize;
+    ivec4 gridSizeInt;
+};
+
+/**
+ * Spread the charge of one particle onto a grid.  The grid may cover only some of the x slabs, starting at
+ * firstSlab.  If wrapX is true, the grid covers all slabs and x indices are wrapped periodically.  Otherwise,
+ * it must be large enough to hold every slab the particle touches.  This returns false if the particle's position
+ * is invalid.
+ */
+static bool spreadParticleCharge(float* posq, int particle, float* grid, int gridx, int gridy, int gridz, const GridMapper& mapper,
+        const float epsilonFactor, int firstSlab, bool wrapX) {
+    // Find the position relative to the nearest grid point and compute the B-spline coefficients.
+
+    fvec4 dr;
+    ivec4 gridIndex = mapper.findGridIndex(&posq[4*particle], dr);
+    fvec4 data[PME_ORDER];
+    GridMapper::computeSplines(dr, data);
+
+    // Spread the charges.
+
+    int gridIndexX = gridIndex[0];
+    int gridIndexY = gridIndex[1];
+    int gridIndexZ = gridIndex[2];
+    if (gridIndexX < 0)
+        return false; // This happens when a simulation blows up and coordinates become NaN.
+    int zindex[PME_ORDER];
+    for (int j = 0; j < PME_ORDER; j++) {
+        zindex[j] = gridIndexZ+j;
+        zindex[j] -= (zindex[j] >= gridz ? gridz : 0);
+    }
+    float charge = epsilonFactor*posq[4*particle+3];
+    fvec4 zdata0to3(data[0][2], data[1][2], data[2][2], data[3][2]);
+    float zdata4 = data[4][2];
+    float temp[4];
+    for (int ix = 0; ix < PME_ORDER; ix++) {
+        int xbase = gridIndexX+ix;
+        if (wrapX)
+            xbase -= (xbase >= gridx ? gridx : 0);
+        xbase = (xbase-firstSlab)*gridy*gridz;
+        float xdata = charge*data[ix][0];
+        for (int iy = 0; iy < PME_ORDER; iy++) {
+            int ybase = gridIndexY+iy;
+            ybase -= (ybase >= gridy ? gridy : 0);
+            ybase = xbase + ybase*gridz;
+            float multiplier = xdata*data[iy][1];
+            fvec4 add0to3 = zdata0to3*multiplier;
+            if (gridIndexZ+4 < gridz)
+                (fvec4(&grid[ybase+gridIndexZ])+add0to3).store(&grid[ybase+gridIndexZ]);
+            else {
+                add0to3.store(temp);
+                grid[ybase+zindex[0]] += temp[0];
+                grid[ybase+zindex[1]] += temp[1];
+                grid[ybase+zindex[2]] += temp[2];
+                grid[ybase+zindex[3]] += temp[3];
+            }
+            grid[ybase+zindex[4]] += multiplier*zdata4;
+        }
+    }
+    return true;
+}
+
 static void spreadCharge(float* posq, vector<float>& grid, int gridx, int gridy, int gridz, int numParticles, Vec3* periodicBoxVectors, Vec3* recipBoxVectors,
         atomic<int>& atomicCounter, const float epsilonFactor, int threadIndex, int numThreads, bool deterministic) {
-    float temp[4];
-    fvec4 boxSize((float) periodicBoxVectors[0][0], (float) periodicBoxVectors[1][1], (float) periodicBoxVectors[2][2], 0);
-    fvec4 invBoxSize((float) recipBoxVectors[0][0], (float) recipBoxVectors[1][1], (float) recipBoxVectors[2][2], 0);
-    fvec4 recipBoxVec0((float) recipBoxVectors[0][0], (float) recipBoxVectors[0][1], (float) recipBoxVectors[0][2], 0);
-    fvec4 recipBoxVec1((float) recipBoxVectors[1][0], (float) recipBoxVectors[1][1], (float) recipBoxVectors[1][2], 0);
-    fvec4 recipBoxVec2((float) recipBoxVectors[2][0], (float) recipBoxVectors[2][1], (float) recipBoxVectors[2][2], 0);
-    fvec4 gridSize(gridx, gridy, gridz, 0);
-    ivec4 gridSizeInt(gridx, gridy, gridz, 0);
-    fvec4 one(1);
-    fvec4 scale(1.0f/(PME_ORDER-1));
-    float posInBox[4] = {0,0,0,0};
+    GridMapper mapper(gridx, gridy, gridz, periodicBoxVectors, recipBoxVectors);
     memset(grid.data(), 0, sizeof(float)*gridx*gridy*gridz);
 
     const int groupSize = max(1, numParticles / (10 * numThreads));
@@ -81,95 +181,107 @@ static void spreadCharge(float* posq, vector<float>& grid, int gridx, int gridy,
             break;
 
         int end = min(start + groupSize, numParticles);
-        for (int i = start; i < end; ++i) {
-            // Find the position relative to the nearest grid point.
-
-            fvec4 pos(&posq[4*i]);
-            (pos-boxSize*floor(pos*invBoxSize)).store(posInBox);
-            fvec4 t = posInBox[0]*recipBoxVec0 + posInBox[1]*recipBoxVec1 + posInBox[2]*recipBoxVec2;
-            t = (t-floor(t))*gridSize;
-            ivec4 ti = t;
-            fvec4 dr = t-ti;
-            ivec4 gridIndex = ti-(gridSizeInt&ti==gridSizeInt);
-
-            // Compute the B-spline coefficients.
-
-            fvec4 data[PME_ORDER];
-            data[PME_ORDER-1] = 0.0f;
-            data[1] = dr;
-            data[0] = one-dr;
-            for (int j = 3; j < PME_ORDER; j++) {
-                fvec4 div(1.0f/(j-1));
-                data[j-1] = div*dr*data[j-2];
-                for (int k = 1; k < j-1; k++)
-                    data[j-k-1] = div*((dr+k)*data[j-k-2]+(fvec4(j-k)-dr)*data[j-k-1]);
-                data[0] = div*(one-dr)*data[0];
-            }
-            data[PME_ORDER-1] = scale*dr*data[PME_ORDER-2];
-            for (int j = 1; j < (PME_ORDER-1); j++)
-                data[PME_ORDER-j-1] = scale*((dr+j)*data[PME_ORDER-j-2]+(fvec4(PME_ORDER-j)-dr)*data[PME_ORDER-j-1]);
-            data[0] = scale*(one-dr)*data[0];
-
-            // Spread the charges.
-
-            int gridIndexX = gridIndex[0];
-            int gridIndexY = gridIndex[1];
-            int gridIndexZ = gridIndex[2];
-            if (gridIndexX < 0)
-                return; // This happens when a simulation blows up and coordinates become NaN.
-            int zindex[PME_ORDER];
-            for (int j = 0; j < PME_ORDER; j++) {
-                zindex[j] = gridIndexZ+j;
-                zindex[j] -= (zindex[j] >= gridz ? gridz : 0);
-            }
-            float charge = epsilonFactor*posq[4*i+3];
-            fvec4 zdata0to3(data[0][2], data[1][2], data[2][2], data[3][2]);
-            float zdata4 = data[4][2];
-            if (gridIndexZ+4 < gridz) {
-                for (int ix = 0; ix < PME_ORDER; ix++) {
-                    int xbase = gridIndexX+ix;
-                    xbase -= (xbase >= gridx ? gridx : 0);
-                    xbase = xbase*gridy*gridz;
-                    float xdata = charge*data[ix][0];
-                    for (int iy = 0; iy < PME_ORDER; iy++) {
-                        int ybase = gridIndexY+iy;
-                        ybase -= (ybase >= gridy ? gridy : 0);
-                        ybase = xbase + ybase*gridz;
-                        float multiplier = xdata*data[iy][1];
-                        fvec4 add0to3 = zdata0to3*multiplier;
-                        (fvec4(&grid[ybase+gridIndexZ])+add0to3).store(&grid[ybase+gridIndexZ]);
-                        grid[ybase+zindex[4]] += multiplier*zdata4;
-                    }
-                }
-            }
-            else {
-                for (int ix = 0; ix < PME_ORDER; ix++) {
-                    int xbase = gridIndexX+ix;
-                    xbase -= (xbase >= gridx ? gridx : 0);
-                    xbase = xbase*gridy*gridz;
-                    float xdata = charge*data[ix][0];
-                    for (int iy = 0; iy < PME_ORDER; iy++) {
-                        int ybase = gridIndexY+iy;
-                        ybase -= (ybase >= gridy ? gridy : 0);
-                        ybase = xbase + ybase*gridz;
-                        float multiplier = xdata*data[iy][1];
-                        fvec4 add0to3 = zdata0to3*multiplier;
-                        add0to3.store(temp);
-                        grid[ybase+zindex[0]] += temp[0];
-                        grid[ybase+zindex[1]] += temp[1];
-                        grid[ybase+zindex[2]] += temp[2];
-                        grid[ybase+zindex[3]] += temp[3];
-                        grid[ybase+zindex[4]] += multiplier*zdata4;
-                    }
-                }
-            }
-        }
+        for (int i = start; i < end; ++i)
+            if (!spreadParticleCharge(posq, i, grid.data(), gridx, gridy, gridz, mapper, epsilonFactor, 0, true))
+                return;
 
         if (deterministic)
             start += groupSize * numThreads;
     }
 }
 
+/**
+ * This class implements charge spreading with slab decomposition.  The particles are binned by the x slab their
+ * charge starts being spread at.  Each thread owns a contiguous range of slabs, and spreads the particles that
+ * start in them onto a buffer that covers its own slabs plus the PME_ORDER-1 slabs that follow them.  The buffers
+ * are then merged into the full grid, with each thread summing the contributions to its own slabs.  Every step
+ * is done in a fixed order, so the result is deterministic.
+ */
+namespace OpenMM {
+
+class CpuPmeSlabSpreader {
+public:
+    void initialize(int gridx, int gridy, int gridz, int numParticles, int numThreads) {
+        this->gridx = gridx;
+        this->gridy = gridy;
+        this->gridz = gridz;
+        this->numThreads = numThreads;
+        slabStart.resize(numThreads+1);
+        for (int i = 0; i <= numThreads; i++)
+            slabStart[i] = (i*gridx)/numThreads;
+        slabGrids.resize(numThreads);
+        for (int i = 0; i < numThreads; i++)
+            slabGrids[i].resize((getNumSlabs(i)+PME_ORDER-1)*gridy*gridz+3);
+        particleSlab.resize(numParticles);
+        sortedParticles.resize(numParticles);
+        binStart.resize(gridx+1);
+    }
+    /**
+     * Sort the particles into bins based on the slab each one starts at.  This is called by the main thread.
+     */
+    void binParticles(ThreadPool& threads, float* posq, int numParticles, Vec3* periodicBoxVectors, Vec3* recipBoxVectors) {
+        GridMapper mapper(gridx, gridy, gridz, periodicBoxVectors, recipBoxVectors);
+        threads.parallelFor(numParticles, max(1, numParticles/(10*numThreads)), [&] (ThreadPool& threads, int threadIndex, int start, int end) {
+            fvec4 dr;
+            for (int i = start; i < end; i++)
+                particleSlab[i] = mapper.findGridIndex(&posq[4*i], dr)[0];
+        });
+        fill(binStart.begin(), binStart.end(), 0);
+        for (int i = 0; i < numParticles; i++)
+            if (particleSlab[i] >= 0) // This is false when coordinates are NaN.
+                binStart[particleSlab[i]+1]++;
+        for (int i = 0; i < gridx; i++)
+            binStart[i+1] += binStart[i];
+        vector<int> binPos(binStart.begin(), binStart.end()-1);
+        for (int i = 0; i < numParticles; i++)
+            if (particleSlab[i] >= 0)
+                sortedParticles[binPos[particleSlab[i]]++] = i;
+    }
+    /**
+     * Spread the charges of the particles that start in a thread's slabs onto its buffer.
+     */
+    void spreadCharge(int threadIndex, float* posq, Vec3* periodicBoxVectors, Vec3* recipBoxVectors, const float epsilonFactor) {
+        GridMapper mapper(gridx, gridy, gridz, periodicBoxVectors, recipBoxVectors);
+        vector<float>& grid = slabGrids[threadIndex];
+        memset(grid.data(), 0, sizeof(float)*grid.size());
+        int firstSlab = slabStart[threadIndex];
+        for (int i = binStart[firstSlab]; i < binStart[slabStart[threadIndex+1]]; i++)
+            spreadParticleCharge(posq, sortedParticles[i], grid.data(), gridx, gridy, gridz, mapper, epsilonFactor, firstSlab, false);
+    }
+    /**
+     * Sum the contributions from every thread's buffer to the slabs owned by one thread, and store them in the full grid.
+     */
+    void mergeSlabs(int threadIndex, vector<float>& grid) {
+        int planeSize = gridy*gridz;
+        int vectorSize = planeSize-planeSize%4;
+        for (int x = slabStart[threadIndex]; x < slabStart[threadIndex+1]; x++) {
+            float* dest = &grid[x*planeSize];
+            memset(dest, 0, sizeof(float)*planeSize);
+            for (int j = 0; j < numThreads; j++) {
+                if (getNumSlabs(j) == 0)
+                    continue;
+                int bufferSlabs = getNumSlabs(j)+PME_ORDER-1;
+                for (int offset = (x-slabStart[j]+gridx)%gridx; offset < bufferSlabs; offset += gridx) {
+                    const float* src = &slabGrids[j][offset*planeSize];
+                    for (int k = 0; k < vectorSize; k += 4)
+                        (fvec4(&dest[k])+fvec4(&src[k])).store(&dest[k]);
+                    for (int k = vectorSize; k < planeSize; k++)
+                        dest[k] += src[k];
+                }
+            }
+        }
+    }
+private:
+    int getNumSlabs(int threadIndex) const {
+        return slabStart[threadIndex+1]-slabStart[threadIndex];
+    }
+    int gridx, gridy, gridz, numThreads;
+    vector<int> slabStart, particleSlab, sortedParticles, binStart;
+    vector<vector<float> > slabGrids;
+};
+
+} // namespace OpenMM
+
 #define FAST_ERFC 1
 static void computeReciprocalDispersionEterm(int start, int end, int gridx, int gridy, int gridz, vector<float>& recipEterm, double alpha, vector<float>* bsplineModuli, Vec3* periodicBoxVectors, Vec3* recipBoxVectors) {
     const unsigned int zsize = gridz/2+1;
@@ -320,7 +432,7 @@ static void reciprocalConvolution(int start, int end, vector<complex<float> >& g
     }
 }
 
-static void interpolateForces(float* posq, vector<float>& force, vector<float>& grid, int gridx, int gridy, int gridz, int numParticles, Vec3* periodicBoxVectors, Vec3* recipBoxVectors, atomic<int>& atomicCounter, const float epsilonFactor, int numThreads) {
+static void interpolateForces(float* posq, vector<float>& force, vector<float>& grid, int gridx, int gridy, int gridz, int start, int end, Vec3* periodicBoxVectors, Vec3* recipBoxVectors, const float epsilonFactor) {
     fvec4 boxSize((float) periodicBoxVectors[0][0], (float) periodicBoxVectors[1][1], (float) periodicBoxVectors[2][2], 0);
     fvec4 invBoxSize((float) recipBoxVectors[0][0], (float) recipBoxVectors[1][1], (float) recipBoxVectors[2][2], 0);
     fvec4 recipBoxVec0((float) recipBoxVectors[0][0], (float) recipBoxVectors[0][1], (float) recipBoxVectors[0][2], 0);
@@ -331,93 +443,84 @@ static void interpolateForces(float* posq, vector<float>& force, vector<float>&
     fvec4 one(1);
     fvec4 scale(1.0f/(PME_ORDER-1));
 
-    const int groupSize = max(1, numParticles / (10 * numThreads));
-    while (true) {
-        int start = atomicCounter.fetch_add(groupSize);
-        if (start >= numParticles)
-            break;
-
-        int end = min(start + groupSize, numParticles);
-
-        for (int i = start; i < end; i++) {
-            // Find the position relative to the nearest grid point.
-
-            fvec4 pos(&posq[4*i]);
-            float posInBox[4];
-            (pos-boxSize*floor(pos*invBoxSize)).store(posInBox);
-            fvec4 t = posInBox[0]*recipBoxVec0 + posInBox[1]*recipBoxVec1 + posInBox[2]*recipBoxVec2;
-            t = (t-floor(t))*gridSize;
-            ivec4 ti = t;
-            fvec4 dr = t-ti;
-            ivec4 gridIndex = ti-(gridSizeInt&ti==gridSizeInt);
-
-            // Compute the B-spline coefficients.
-
-            fvec4 data[PME_ORDER];
-            fvec4 ddata[PME_ORDER];
-            data[PME_ORDER-1] = 0.0f;
-            data[1] = dr;
-            data[0] = one-dr;
-            for (int j = 3; j < PME_ORDER; j++) {
-                fvec4 div(1.0f/(j-1));
-                data[j-1] = div*dr*data[j-2];
-                for (int k = 1; k < j-1; k++)
-                    data[j-k-1] = div*((dr+k)*data[j-k-2]+(fvec4(j-k)-dr)*data[j-k-1]);
-                data[0] = div*(one-dr)*data[0];
-            }
-            ddata[0] = -data[0];
-            for (int j = 1; j < PME_ORDER; j++)
-                ddata[j] = data[j-1]-data[j];
-            data[PME_ORDER-1] = scale*dr*data[PME_ORDER-2];
-            for (int j = 1; j < (PME_ORDER-1); j++)
-                data[PME_ORDER-j-1] = scale*((dr+j)*data[PME_ORDER-j-2]+(fvec4(PME_ORDER-j)-dr)*data[PME_ORDER-j-1]);
-            data[0] = scale*(one-dr)*data[0];
-
-            // Compute the force on this atom.
-
-            int gridIndexX = gridIndex[0];
-            int gridIndexY = gridIndex[1];
-            int gridIndexZ = gridIndex[2];
-            if (gridIndexX < 0)
-                return; // This happens when a simulation blows up and coordinates become NaN.
-            int zindex[PME_ORDER];
-            for (int j = 0; j < PME_ORDER; j++) {
-                zindex[j] = gridIndexZ+j;
-                zindex[j] -= (zindex[j] >= gridz ? gridz : 0);
-            }
-            fvec4 zdata[PME_ORDER];
-            for (int j = 0; j < PME_ORDER; j++)
-                zdata[j] = fvec4(data[j][2], data[j][2], ddata[j][2], 0);
-            fvec4 f = 0.0f;
-            for (int ix = 0; ix < PME_ORDER; ix++) {
-                int xbase = gridIndexX+ix;
-                xbase -= (xbase >= gridx ? gridx : 0);
-                xbase = xbase*gridy*gridz;
-                float dx = data[ix][0];
-                float ddx = ddata[ix][0];
-                fvec4 xdata(ddx, dx, dx, 0);
-
-                for (int iy = 0; iy < PME_ORDER; iy++) {
-                    int ybase = gridIndexY+iy;
-                    ybase -= (ybase >= gridy ? gridy : 0);
-                    ybase = xbase + ybase*gridz;
-                    float dy = data[iy][1];
-                    float ddy = ddata[iy][1];
-                    fvec4 xydata = xdata*fvec4(dy, ddy, dy, 0);
-
-                    for (int iz = 0; iz < PME_ORDER; iz++) {
-                        fvec4 gridValue(grid[ybase+zindex[iz]]);
-                        f = f+xydata*zdata[iz]*gridValue;
-                    }
+    for (int i = start; i < end; i++) {
+        // Find the position relative to the nearest grid point.
+
+        fvec4 pos(&posq[4*i]);
+        float posInBox[4];
+        (pos-boxSize*floor(pos*invBoxSize)).store(posInBox);
+        fvec4 t = posInBox[0]*recipBoxVec0 + posInBox[1]*recipBoxVec1 + posInBox[2]*recipBoxVec2;
+        t = (t-floor(t))*gridSize;
+        ivec4 ti = t;
+        fvec4 dr = t-ti;
+        ivec4 gridIndex = ti-(gridSizeInt&ti==gridSizeInt);
+
+        // Compute the B-spline coefficients.
+
+        fvec4 data[PME_ORDER];
+        fvec4 ddata[PME_ORDER];
+        data[PME_ORDER-1] = 0.0f;
+        data[1] = dr;
+        data[0] = one-dr;
+        for (int j = 3; j < PME_ORDER; j++) {
+            fvec4 div(1.0f/(j-1));
+            data[j-1] = div*dr*data[j-2];
+            for (int k = 1; k < j-1; k++)
+                data[j-k-1] = div*((dr+k)*data[j-k-2]+(fvec4(j-k)-dr)*data[j-k-1]);
+            data[0] = div*(one-dr)*data[0];
+        }
+        ddata[0] = -data[0];
+        for (int j = 1; j < PME_ORDER; j++)
+            ddata[j] = data[j-1]-data[j];
+        data[PME_ORDER-1] = scale*dr*data[PME_ORDER-2];
+        for (int j = 1; j < (PME_ORDER-1); j++)
+            data[PME_ORDER-j-1] = scale*((dr+j)*data[PME_ORDER-j-2]+(fvec4(PME_ORDER-j)-dr)*data[PME_ORDER-j-1]);
+        data[0] = scale*(one-dr)*data[0];
+
+        // Compute the force on this atom.
+
+        int gridIndexX = gridIndex[0];
+        int gridIndexY = gridIndex[1];
+        int gridIndexZ = gridIndex[2];
+        if (gridIndexX < 0)
+            return; // This happens when a simulation blows up and coordinates become NaN.
+        int zindex[PME_ORDER];
+        for (int j = 0; j < PME_ORDER; j++) {
+            zindex[j] = gridIndexZ+j;
+            zindex[j] -= (zindex[j] >= gridz ? gridz : 0);
+        }
+        fvec4 zdata[PME_ORDER];
+        for (int j = 0; j < PME_ORDER; j++)
+            zdata[j] = fvec4(data[j][2], data[j][2], ddata[j][2], 0);
+        fvec4 f = 0.0f;
+        for (int ix = 0; ix < PME_ORDER; ix++) {
+            int xbase = gridIndexX+ix;
+            xbase -= (xbase >= gridx ? gridx : 0);
+            xbase = xbase*gridy*gridz;
+            float dx = data[ix][0];
+            float ddx = ddata[ix][0];
+            fvec4 xdata(ddx, dx, dx, 0);
+
+            for (int iy = 0; iy < PME_ORDER; iy++) {
+                int ybase = gridIndexY+iy;
+                ybase -= (ybase >= gridy ? gridy : 0);
+                ybase = xbase + ybase*gridz;
+                float dy = data[iy][1];
+                float ddy = ddata[iy][1];
+                fvec4 xydata = xdata*fvec4(dy, ddy, dy, 0);
+
+                for (int iz = 0; iz < PME_ORDER; iz++) {
+                    fvec4 gridValue(grid[ybase+zindex[iz]]);
+                    f = f+xydata*zdata[iz]*gridValue;
                 }
             }
-            f *= -epsilonFactor*posq[4*i+3];
-            float fc[4];
-            f.store(fc);
-            force[4*i+0] = fc[0]*gridx*(float)recipBoxVectors[0][0];
-            force[4*i+1] = fc[0]*gridx*(float)recipBoxVectors[1][0]+fc[1]*gridy*(float)recipBoxVectors[1][1];
-            force[4*i+2] = fc[0]*gridx*(float)recipBoxVectors[2][0]+fc[1]*gridy*(float)recipBoxVectors[2][1]+fc[2]*gridz*(float)recipBoxVectors[2][2];
         }
+        f *= -epsilonFactor*posq[4*i+3];
+        float fc[4];
+        f.store(fc);
+        force[4*i+0] = fc[0]*gridx*(float)recipBoxVectors[0][0];
+        force[4*i+1] = fc[0]*gridx*(float)recipBoxVectors[1][0]+fc[1]*gridy*(float)recipBoxVectors[1][1];
+        force[4*i+2] = fc[0]*gridx*(float)recipBoxVectors[2][0]+fc[1]*gridy*(float)recipBoxVectors[2][1]+fc[2]*gridz*(float)recipBoxVectors[2][2];
     }
 }
 
@@ -474,7 +577,13 @@ void CpuCalcPmeReciprocalForceKernel::initialize(int xsize, int ysize, int zsize
     
     // Initialize the FFT grids.
 
-    realGrids.resize(numThreads, vector<float>(gridx*gridy*gridz+3));
+    if (!slabModeSpecified)
+        useSlabs = (numThreads > 1);
+    realGrids.resize(useSlabs ? 1 : numThreads, vector<float>(gridx*gridy*gridz+3));
+    if (useSlabs) {
+        slabSpreader = new CpuPmeSlabSpreader();
+        slabSpreader->initialize(gridx, gridy, gridz, numParticles, numThreads);
+    }
     complexGrid.resize(gridx*gridy*(gridz/2+1));
     
     // Initialize the b-spline moduli.
@@ -539,6 +648,8 @@ CpuCalcPmeReciprocalForceKernel::~CpuCalcPmeReciprocalForceKernel() {
     pthread_cond_broadcast(&startCondition);
     pthread_mutex_unlock(&lock);
     pthread_join(mainThread, NULL);
+    if (slabSpreader != NULL)
+        delete slabSpreader;
     pthread_mutex_destroy(&lock);
     pthread_cond_destroy(&startCondition);
     pthread_cond_destroy(&endCondition);
@@ -559,6 +670,8 @@ void CpuCalcPmeReciprocalForceKernel::runMainThread() {
             break;
         posq = io->getPosq();
         atomicCounter = 0;
+        if (useSlabs)
+            slabSpreader->binParticles(threads, posq, numParticles, periodicBoxVectors, recipBoxVectors);
         threads.execute([&] (ThreadPool& threads, int threadIndex) { runWorkerThread(threads, threadIndex); }); // Signal threads to perform charge spreading.
         threads.waitForThreads();
         threads.resumeThreads(); // Signal threads to sum the charge grids.
@@ -577,9 +690,10 @@ void CpuCalcPmeReciprocalForceKernel::runMainThread() {
         threads.resumeThreads(); // Signal threads to perform reciprocal convolution.
         threads.waitForThreads();
         pocketfft::c2r(gridShape, complexGridStride, realGridStride, fftAxes, false, complexGrid.data(), realGrids[0].data(), 1.0f, 0);
-        atomicCounter = 0;
-        threads.resumeThreads(); // Signal threads to interpolate forces.
-        threads.waitForThreads();
+        const float epsilonFactor = sqrt(ONE_4PI_EPS0);
+        threads.parallelFor(numParticles, max(1, numParticles/(10*numThreads)), [&] (ThreadPool& threads, int threadIndex, int start, int end) {
+            interpolateForces(posq, force, realGrids[0], gridx, gridy, gridz, start, end, periodicBoxVectors, recipBoxVectors, epsilonFactor);
+        });
         isFinished = true;
         lastBoxVectors[0] = periodicBoxVectors[0];
         lastBoxVectors[1] = periodicBoxVectors[1];
@@ -599,14 +713,21 @@ void CpuCalcPmeReciprocalForceKernel::runWorkerThread(ThreadPool& threads, int i
     int complexStart = std::max(1, ((index*complexSize)/numThreads));
     int complexEnd = (((index+1)*complexSize)/numThreads);
     const float epsilonFactor = sqrt(ONE_4PI_EPS0);
-    spreadCharge(posq, realGrids[index], gridx, gridy, gridz, numParticles, periodicBoxVectors, recipBoxVectors, atomicCounter, epsilonFactor, index, numThreads, deterministic);
+    if (useSlabs)
+        slabSpreader->spreadCharge(index, posq, periodicBoxVectors, recipBoxVectors, epsilonFactor);
+    else
+        spreadCharge(posq, realGrids[index], gridx, gridy, gridz, numParticles, periodicBoxVectors, recipBoxVectors, atomicCounter, epsilonFactor, index, numThreads, deterministic);
     threads.syncThreads();
-    int numGrids = realGrids.size();
-    for (int i = gridStart; i < gridEnd; i += 4) {
-        fvec4 sum(&realGrids[0][i]);
-        for (int j = 1; j < numGrids; j++)
-            sum += fvec4(&realGrids[j][i]);
-        sum.store(&realGrids[0][i]);
+    if (useSlabs)
+        slabSpreader->mergeSlabs(index, realGrids[0]);
+    else {
+        int numGrids = realGrids.size();
+        for (int i = gridStart; i < gridEnd; i += 4) {
+            fvec4 sum(&realGrids[0][i]);
+            for (int j = 1; j < numGrids; j++)
+                sum += fvec4(&realGrids[j][i]);
+            sum.store(&realGrids[0][i]);
+        }
     }
     threads.syncThreads();
     if (lastBoxVectors[0] != periodicBoxVectors[0] || lastBoxVectors[1] != periodicBoxVectors[1] || lastBoxVectors[2] != periodicBoxVectors[2]) {
@@ -618,8 +739,6 @@ void CpuCalcPmeReciprocalForceKernel::runWorkerThread(ThreadPool& threads, int i
         threads.syncThreads();
     }
     reciprocalConvolution(complexStart, complexEnd, complexGrid, recipEterm);
-    threads.syncThreads();
-    interpolateForces(posq, force, realGrids[0], gridx, gridy, gridz, numParticles, periodicBoxVectors, recipBoxVectors, atomicCounter, epsilonFactor, numThreads);
 }
 
 void CpuCalcPmeReciprocalForceKernel::beginComputation(IO& io, const Vec3* periodicBoxVectors, bool includeEnergy) {
@@ -660,6 +779,11 @@ bool CpuCalcPmeReciprocalForceKernel::isProcessorSupported() {
     return isVec4Supported();
 }
 
+void CpuCalcPmeReciprocalForceKernel::setUseSlabDecomposition(bool use) {
+    useSlabs = use;
+    slabModeSpecified = true;
+}
+
 void CpuCalcPmeReciprocalForceKernel::getPMEParameters(double& alpha, int& nx, int& ny, int& nz) const {
     alpha = this->alpha;
     nx = gridx;
@@ -757,7 +881,13 @@ void CpuCalcDispersionPmeReciprocalForceKernel::initialize(int xsize, int ysize,
 
     // Initialize the FFT grids.
 
-    realGrids.resize(numThreads, vector<float>(gridx*gridy*gridz+3));
+    if (!slabModeSpecified)
+        useSlabs = (numThreads > 1);
+    realGrids.resize(useSlabs ? 1 : numThreads, vector<float>(gridx*gridy*gridz+3));
+    if (useSlabs) {
+        slabSpreader = new CpuPmeSlabSpreader();
+        slabSpreader->initialize(gridx, gridy, gridz, numParticles, numThreads);
+    }
     complexGrid.resize(gridx*gridy*(gridz/2+1));
     
     // Initialize the b-spline moduli.
@@ -822,6 +952,8 @@ CpuCalcDispersionPmeReciprocalForceKernel::~CpuCalcDispersionPmeReciprocalForceK
     pthread_cond_broadcast(&startCondition);
     pthread_mutex_unlock(&lock);
     pthread_join(mainThread, NULL);
+    if (slabSpreader != NULL)
+        delete slabSpreader;
     pthread_mutex_destroy(&lock);
     pthread_cond_destroy(&startCondition);
     pthread_cond_destroy(&endCondition);
@@ -843,6 +975,8 @@ void CpuCalcDispersionPmeReciprocalForceKernel::runMainThread() {
         posq = io->getPosq();
         ComputeTask task(*this);
         atomicCounter = 0;
+        if (useSlabs)
+            slabSpreader->binParticles(threads, posq, numParticles, periodicBoxVectors, recipBoxVectors);
         threads.execute(task); // Signal threads to perform charge spreading.
         threads.waitForThreads();
         threads.resumeThreads(); // Signal threads to sum the charge grids.
@@ -861,9 +995,10 @@ void CpuCalcDispersionPmeReciprocalForceKernel::runMainThread() {
         threads.resumeThreads(); // Signal threads to perform reciprocal convolution.
         threads.waitForThreads();
         pocketfft::c2r(gridShape, complexGridStride, realGridStride, fftAxes, false, complexGrid.data(), realGrids[0].data(), 1.0f, 0);
-        atomicCounter = 0;
-        threads.resumeThreads(); // Signal threads to interpolate forces.
-        threads.waitForThreads();
+        const float epsilonFactor = 1.0f;
+        threads.parallelFor(numParticles, max(1, numParticles/(10*numThreads)), [&] (ThreadPool& threads, int threadIndex, int start, int end) {
+            interpolateForces(posq, force, realGrids[0], gridx, gridy, gridz, start, end, periodicBoxVectors, recipBoxVectors, epsilonFactor);
+        });
         isFinished = true;
         lastBoxVectors[0] = periodicBoxVectors[0];
         lastBoxVectors[1] = periodicBoxVectors[1];
@@ -883,14 +1018,21 @@ void CpuCalcDispersionPmeReciprocalForceKernel::runWorkerThread(ThreadPool& thre
     int complexStart = std::max(1, ((index*complexSize)/numThreads));
     int complexEnd = (((index+1)*complexSize)/numThreads);
     const float epsilonFactor = 1.0f;
-    spreadCharge(posq, realGrids[index], gridx, gridy, gridz, numParticles, periodicBoxVectors, recipBoxVectors, atomicCounter, epsilonFactor, index, numThreads, deterministic);
+    if (useSlabs)
+        slabSpreader->spreadCharge(index, posq, periodicBoxVectors, recipBoxVectors, epsilonFactor);
+    else
+        spreadCharge(posq, realGrids[index], gridx, gridy, gridz, numParticles, periodicBoxVectors, recipBoxVectors, atomicCounter, epsilonFactor, index, numThreads, deterministic);
     threads.syncThreads();
-    int numGrids = realGrids.size();
-    for (int i = gridStart; i < gridEnd; i += 4) {
-        fvec4 sum(&realGrids[0][i]);
-        for (int j = 1; j < numGrids; j++)
-            sum += fvec4(&realGrids[j][i]);
-        sum.store(&realGrids[0][i]);
+    if (useSlabs)
+        slabSpreader->mergeSlabs(index, realGrids[0]);
+    else {
+        int numGrids = realGrids.size();
+        for (int i = gridStart; i < gridEnd; i += 4) {
+            fvec4 sum(&realGrids[0][i]);
+            for (int j = 1; j < numGrids; j++)
+                sum += fvec4(&realGrids[j][i]);
+            sum.store(&realGrids[0][i]);
+        }
     }
     threads.syncThreads();
     if (lastBoxVectors[0] != periodicBoxVectors[0] || lastBoxVectors[1] != periodicBoxVectors[1] || lastBoxVectors[2] != periodicBoxVectors[2]) {
@@ -904,8 +1046,6 @@ void CpuCalcDispersionPmeReciprocalForceKernel::runWorkerThread(ThreadPool& thre
     // For dispersion, we include the {0,0,0} term, so the start point needs to be redefined
     complexStart = (index*complexSize)/numThreads;
     reciprocalConvolution(complexStart, complexEnd, complexGrid, recipEterm);
-    threads.syncThreads();
-    interpolateForces(posq, force, realGrids[0], gridx, gridy, gridz, numParticles, periodicBoxVectors, recipBoxVectors, atomicCounter, epsilonFactor, numThreads);
 }
 
 void CpuCalcDispersionPmeReciprocalForceKernel::beginComputation(CalcPmeReciprocalForceKernel::IO& io, const Vec3* periodicBoxVectors, bool includeEnergy) {
@@ -946,6 +1086,11 @@ bool CpuCalcDispersionPmeReciprocalForceKernel::isProcessorSupported() {
     return isVec4Supported();
 }
 
+void CpuCalcDispersionPmeReciprocalForceKernel::setUseSlabDecomposition(bool use) {
+    useSlabs = use;
+    slabModeSpecified = true;
+}
+
 void CpuCalcDispersionPmeReciprocalForceKernel::getPMEParameters(double& alpha, int& nx, int& ny, int& nz) const {
     alpha = this->alpha;
     nx = gridx;
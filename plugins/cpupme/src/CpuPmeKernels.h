@@ -44,6 +44,8 @@
 
 namespace OpenMM {
 
+class CpuPmeSlabSpreader;
+
 /**
  * This is an optimized CPU implementation of CalcPmeReciprocalForceKernel.  It is both
  * vectorized (requiring SSE 4.1) and multithreaded.  It uses PocketFFT to perform the FFTs.
@@ -52,8 +54,17 @@ namespace OpenMM {
 class OPENMM_EXPORT_PME CpuCalcPmeReciprocalForceKernel : public CalcPmeReciprocalForceKernel {
 public:
     CpuCalcPmeReciprocalForceKernel(const std::string& name, const Platform& platform) : CalcPmeReciprocalForceKernel(name, platform),
-            isDeleted(false) {
+            isDeleted(false), useSlabs(false), slabModeSpecified(false), slabSpreader(NULL) {
     }
+    /**
+     * Set whether to spread charges with slab decomposition.  In that mode, particles are binned by the x slab
+     * of the grid their charge starts at.  Each thread spreads the particles in a contiguous range of slabs onto a
+     * buffer that covers only those slabs plus the PME_ORDER-1 slabs after them, so only the overlapping slabs
+     * need to be summed.  The result is deterministic.  Otherwise, each thread spreads charges onto its own copy
+     * of the full grid.  By default, slab decomposition is used whenever there is more than one thread.  This
+     * must be called before initialize().
+     */
+    void setUseSlabDecomposition(bool use);
     /**
      * Initialize the kernel.
      * 
@@ -112,7 +123,8 @@ private:
     int gridx, gridy, gridz, numParticles;
     double alpha;
     bool deterministic;
-    bool isFinished, isDeleted;
+    bool isFinished, isDeleted, useSlabs, slabModeSpecified;
+    CpuPmeSlabSpreader* slabSpreader;
     std::vector<float> force;
     std::vector<float> bsplineModuli[3];
     std::vector<float> recipEterm;
@@ -145,8 +157,17 @@ private:
 class OPENMM_EXPORT_PME CpuCalcDispersionPmeReciprocalForceKernel : public CalcDispersionPmeReciprocalForceKernel {
 public:
     CpuCalcDispersionPmeReciprocalForceKernel(const std::string& name, const Platform& platform) : CalcDispersionPmeReciprocalForceKernel(name, platform),
-            isDeleted(false) {
+            isDeleted(false), useSlabs(false), slabModeSpecified(false), slabSpreader(NULL) {
     }
+    /**
+     * Set whether to spread charges with slab decomposition.  In that mode, particles are binned by the x slab
+     * of the grid their charge starts at.  Each thread spreads the particles in a contiguous range of slabs onto a
+     * buffer that covers only those slabs plus the PME_ORDER-1 slabs after them, so only the overlapping slabs
+     * need to be summed.  The result is deterministic.  Otherwise, each thread spreads charges onto its own copy
+     * of the full grid.  By default, slab decomposition is used whenever there is more than one thread.  This
+     * must be called before initialize().
+     */
+    void setUseSlabDecomposition(bool use);
     /**
      * Initialize the kernel.
      * 
@@ -206,7 +227,8 @@ private:
     int gridx, gridy, gridz, numParticles;
     double alpha;
     bool deterministic;
-    bool isFinished, isDeleted;
+    bool isFinished, isDeleted, useSlabs, slabModeSpecified;
+    CpuPmeSlabSpreader* slabSpreader;
     std::vector<float> force;
     std::vector<float> bsplineModuli[3];
     std::vector<float> recipEterm;
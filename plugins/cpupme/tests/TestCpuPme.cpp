@@ -706,6 +706,49 @@ void testLJPME(bool triclinic) {
         ASSERT_EQUAL_VEC(refState.getForces()[i], Vec3(io.force[4*i], io.force[4*i+1], io.force[4*i+2]), 1e-3);
 }
 
+template <class KERNEL>
+void computeWithSlabDecomposition(const string& name, bool useSlabs, IO& io, Vec3* boxVectors, double& energy, vector<float>& forces) {
+    KERNEL pme(name, Platform::getPlatformByName("Reference"));
+    pme.setUseSlabDecomposition(useSlabs);
+    pme.initialize(30, 28, 32, io.posq.size()/4, 3.0, true);
+    pme.beginComputation(io, boxVectors, true);
+    energy = pme.finishComputation(io);
+    forces.assign(io.force, io.force+io.posq.size());
+}
+
+template <class KERNEL>
+void testSlabDecomposition(const string& name) {
+    // Spread charges with and without slab decomposition, and check that the results agree and that slab
+    // decomposition is deterministic.
+
+    const int numParticles = 500;
+    const double boxWidth = 3.0;
+    Vec3 boxVectors[3];
+    boxVectors[0] = Vec3(boxWidth, 0, 0);
+    boxVectors[1] = Vec3(0.2*boxWidth, boxWidth, 0);
+    boxVectors[2] = Vec3(-0.3*boxWidth, -0.1*boxWidth, boxWidth);
+    IO io;
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    for (int i = 0; i < numParticles; i++) {
+        io.posq.push_back(boxWidth*genrand_real2(sfmt));
+        io.posq.push_back(boxWidth*genrand_real2(sfmt));
+        io.posq.push_back(boxWidth*genrand_real2(sfmt));
+        io.posq.push_back(genrand_real2(sfmt)-0.5);
+    }
+    double energy1, energy2, energy3;
+    vector<float> forces1, forces2, forces3;
+    computeWithSlabDecomposition<KERNEL>(name, false, io, boxVectors, energy1, forces1);
+    computeWithSlabDecomposition<KERNEL>(name, true, io, boxVectors, energy2, forces2);
+    computeWithSlabDecomposition<KERNEL>(name, true, io, boxVectors, energy3, forces3);
+    ASSERT_EQUAL_TOL(energy1, energy2, 1e-5);
+    for (int i = 0; i < numParticles; i++)
+        ASSERT_EQUAL_VEC(Vec3(forces1[4*i], forces1[4*i+1], forces1[4*i+2]), Vec3(forces2[4*i], forces2[4*i+1], forces2[4*i+2]), 1e-4);
+    ASSERT_EQUAL(energy2, energy3);
+    for (int i = 0; i < 4*numParticles; i++)
+        ASSERT_EQUAL(forces2[i], forces3[i]);
+}
+
 int main(int argc, char* argv[]) {
     try {
         if (!CpuCalcPmeReciprocalForceKernel::isProcessorSupported()) {
@@ -717,6 +760,8 @@ int main(int argc, char* argv[]) {
         testLJPME(false);
         testLJPME(true);
         test_water2_dpme_energies_forces_no_exclusions();
+        testSlabDecomposition<CpuCalcPmeReciprocalForceKernel>(CalcPmeReciprocalForceKernel::Name());
+        testSlabDecomposition<CpuCalcDispersionPmeReciprocalForceKernel>(CalcDispersionPmeReciprocalForceKernel::Name());
     }
     catch(const exception& e) {
         cout << "exception: " << e.what() << endl;
@@ -62,6 +62,13 @@ namespace OpenMM {
  * property as a string.  Similarly, you can use setStringProperty() to specify a property and then access it
  * using getIntProperty().  This will produce the expected result if the original value was, in fact, the
  * string representation of an int, but if the original string was non-numeric, the result is undefined.
+ *
+ * A node can also store array properties, which hold a vector of doubles or ints.  Proxies use them for
+ * data that has one value per particle or per bond, since storing it in an array is far more compact than
+ * creating a separate child node for every element.  When a node is written as XML, each array is written
+ * as an attribute containing a space separated list of values.  On reading, getDoubleArrayProperty() and
+ * getIntArrayProperty() convert such a string back to an array, so proxies work the same way regardless of
+ * the format the node was read from.
  */
 
 class OPENMM_EXPORT SerializationNode {
@@ -103,7 +110,8 @@ public:
      */
     const std::map<std::string, std::string>& getProperties() const;
     /**
-     * Determine whether this node has a property with a particular node.
+     * Determine whether this node has a property with a particular node.  This includes both
+     * ordinary properties and array properties.
      *
      * @param name  the name of the property to check for
      */
@@ -218,6 +226,44 @@ public:
      * @param value  the value to set for the property
      */
     SerializationNode& setDoubleProperty(const std::string& name, double value);
+    /**
+     * Get a map containing all of this node's array properties whose values are doubles.
+     */
+    const std::map<std::string, std::vector<double> >& getDoubleArrayProperties() const;
+    /**
+     * Get a map containing all of this node's array properties whose values are ints.
+     */
+    const std::map<std::string, std::vector<int> >& getIntArrayProperties() const;
+    /**
+     * Get the property with a particular name, specified as an array of doubles.  If the property
+     * was specified as a string, it is interpreted as a space separated list of values.  If there is
+     * no property with the specified name, an exception is thrown.
+     *
+     * @param name   the name of the property to get
+     */
+    std::vector<double> getDoubleArrayProperty(const std::string& name) const;
+    /**
+     * Set the value of a property, specified as an array of doubles.
+     *
+     * @param name   the name of the property to set
+     * @param value  the value to set for the property
+     */
+    SerializationNode& setDoubleArrayProperty(const std::string& name, const std::vector<double>& value);
+    /**
+     * Get the property with a particular name, specified as an array of ints.  If the property
+     * was specified as a string, it is interpreted as a space separated list of values.  If there is
+     * no property with the specified name, an exception is thrown.
+     *
+     * @param name   the name of the property to get
+     */
+    std::vector<int> getIntArrayProperty(const std::string& name) const;
+    /**
+     * Set the value of a property, specified as an array of ints.
+     *
+     * @param name   the name of the property to set
+     * @param value  the value to set for the property
+     */
+    SerializationNode& setIntArrayProperty(const std::string& name, const std::vector<int>& value);
     /**
      * Create a new child node
      *
@@ -266,6 +312,8 @@ private:
     std::string name;
     std::vector<SerializationNode> children;
     std::map<std::string, std::string> properties;
+    std::map<std::string, std::vector<double> > doubleArrayProperties;
+    std::map<std::string, std::vector<int> > intArrayProperties;
 };
 
 } // namespace OpenMM
@@ -67,6 +67,11 @@ public:
     /**
      * Reconstruct an object that has been serialized as XML.
      *
+     * If the object is a System, its Forces are decoded on worker threads as soon as each one has
+     * been read, and the intermediate data for each Force is discarded once it has been created.
+     * This reduces the memory needed to load large Systems, although the XML text itself is still
+     * read into memory in full.
+     *
      * @param stream    an input stream to read the XML from
      * @return a pointer to the newly created object.  The caller assumes ownership of the object.
      */
@@ -0,0 +1,236 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.      *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "openmm/serialization/BinarySerializer.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+using namespace OpenMM;
+using namespace std;
+
+// The data begins with a magic number, a marker used to detect a mismatch in byte order, and a format version.
+
+static const char magic[] = {'O', 'M', 'M', 'B'};
+static const int32_t formatVersion = 1;
+static const int32_t byteOrderMarker = 0x01020304;
+
+// The smallest number of bytes that can encode a string property, an array property, and a node.  These are used
+// to reject counts that could not possibly fit in the remaining input before allocating memory for them.
+
+static const uint64_t minPropertySize = 2*sizeof(uint32_t);
+static const uint64_t minArraySize = sizeof(uint32_t)+sizeof(uint64_t);
+static const uint64_t minNodeSize = 5*sizeof(uint32_t);
+
+// When the size of the input is unknown, strings and arrays are read in pieces of at least this many bytes, and
+// storage grows as the data arrives.  A corrupt length then fails at the end of the input instead of allocating
+// the full amount up front.
+
+static const uint64_t readChunkSize = 1<<20;
+
+// Nodes nested deeper than this are rejected, so corrupt input cannot overflow the stack.
+
+static const int maxNodeDepth = 256;
+
+template <class T>
+static void writeValue(ostream& stream, T value) {
+    stream.write((const char*) &value, sizeof(T));
+}
+
+static void writeString(ostream& stream, const string& str) {
+    writeValue<uint32_t>(stream, str.size());
+    stream.write(str.data(), str.size());
+}
+
+template <class T>
+static void writeArray(ostream& stream, const vector<T>& array) {
+    writeValue<uint64_t>(stream, array.size());
+    if (array.size() > 0)
+        stream.write((const char*) array.data(), array.size()*sizeof(T));
+}
+
+/**
+ * Get the number of bytes between the current position and the end of a stream.  If the stream does not
+ * support seeking, the size is unknown and lengths can only be checked as the data is read.
+ */
+static uint64_t getRemainingBytes(istream& stream) {
+    streampos start = stream.tellg();
+    if (start != streampos(-1) && stream.seekg(0, ios::end)) {
+        streampos end = stream.tellg();
+        stream.seekg(start);
+        if (stream && end != streampos(-1) && end >= start)
+            return (uint64_t) (end-start);
+    }
+    stream.clear();
+    if (start != streampos(-1))
+        stream.seekg(start);
+    return numeric_limits<uint64_t>::max();
+}
+
+static void checkRemaining(uint64_t size, uint64_t remainingBytes) {
+    if (size > remainingBytes)
+        throw OpenMMException("BinarySerializer: Unexpected end of input");
+}
+
+static void readBytes(istream& stream, char* buffer, uint64_t size, uint64_t& remainingBytes) {
+    checkRemaining(size, remainingBytes);
+    stream.read(buffer, size);
+    if ((uint64_t) stream.gcount() != size)
+        throw OpenMMException("BinarySerializer: Unexpected end of input");
+    remainingBytes -= size;
+}
+
+template <class T>
+static T readValue(istream& stream, uint64_t& remainingBytes) {
+    T value;
+    readBytes(stream, (char*) &value, sizeof(T), remainingBytes);
+    return value;
+}
+
+/**
+ * Read the number of items in a list, each of which takes at least minItemSize bytes.
+ */
+static uint32_t readCount(istream& stream, uint64_t minItemSize, uint64_t& remainingBytes) {
+    uint32_t count = readValue<uint32_t>(stream, remainingBytes);
+    checkRemaining(count*minItemSize, remainingBytes);
+    return count;
+}
+
+/**
+ * Read size elements into a string or vector.  If the length of the input is known it has already been
+ * checked, so the storage is allocated at once.  Otherwise it is read in chunks that double in size.
+ */
+template <class C>
+static void readElements(istream& stream, C& container, uint64_t size, uint64_t& remainingBytes) {
+    const uint64_t elementSize = sizeof(typename C::value_type);
+    container.clear();
+    uint64_t chunk = (remainingBytes == numeric_limits<uint64_t>::max() ? readChunkSize/elementSize : size);
+    while (container.size() < size) {
+        uint64_t start = container.size();
+        uint64_t count = min(size-start, max(chunk, start));
+        container.resize(start+count);
+        readBytes(stream, (char*) &container[start], count*elementSize, remainingBytes);
+    }
+}
+
+static string readString(istream& stream, uint64_t& remainingBytes) {
+    uint32_t size = readValue<uint32_t>(stream, remainingBytes);
+    checkRemaining(size, remainingBytes);
+    string str;
+    readElements(stream, str, size, remainingBytes);
+    return str;
+}
+
+template <class T>
+static void readArray(istream& stream, vector<T>& array, uint64_t& remainingBytes) {
+    uint64_t size = readValue<uint64_t>(stream, remainingBytes);
+    checkRemaining(size, remainingBytes/sizeof(T));
+    readElements(stream, array, size, remainingBytes);
+}
+
+void BinarySerializer::serialize(const SerializationNode& node, std::ostream& stream) {
+    stream.write(magic, sizeof(magic));
+    writeValue(stream, byteOrderMarker);
+    writeValue(stream, formatVersion);
+    encodeNode(node, stream);
+    if (!stream)
+        throw OpenMMException("BinarySerializer: Error writing to stream");
+}
+
+void BinarySerializer::encodeNode(const SerializationNode& node, std::ostream& stream) {
+    writeString(stream, node.getName());
+    writeValue<uint32_t>(stream, node.getProperties().size());
+    for (auto& prop : node.getProperties()) {
+        writeString(stream, prop.first);
+        writeString(stream, prop.second);
+    }
+    writeValue<uint32_t>(stream, node.getDoubleArrayProperties().size());
+    for (auto& prop : node.getDoubleArrayProperties()) {
+        writeString(stream, prop.first);
+        writeArray(stream, prop.second);
+    }
+    writeValue<uint32_t>(stream, node.getIntArrayProperties().size());
+    for (auto& prop : node.getIntArrayProperties()) {
+        writeString(stream, prop.first);
+        writeArray(stream, prop.second);
+    }
+    const vector<SerializationNode>& children = node.getChildren();
+    writeValue<uint32_t>(stream, children.size());
+    for (auto& child : children)
+        encodeNode(child, stream);
+}
+
+void BinarySerializer::decodeNode(SerializationNode& node, std::istream& stream, uint64_t& remainingBytes, int depth) {
+    if (depth > maxNodeDepth)
+        throw OpenMMException("BinarySerializer: Nodes are nested too deeply");
+    node.setName(readString(stream, remainingBytes));
+    uint32_t numProperties = readCount(stream, minPropertySize, remainingBytes);
+    for (uint32_t i = 0; i < numProperties; i++) {
+        string name = readString(stream, remainingBytes);
+        node.setStringProperty(name, readString(stream, remainingBytes));
+    }
+    vector<double> doubleArray;
+    uint32_t numDoubleArrays = readCount(stream, minArraySize, remainingBytes);
+    for (uint32_t i = 0; i < numDoubleArrays; i++) {
+        string name = readString(stream, remainingBytes);
+        readArray(stream, doubleArray, remainingBytes);
+        node.setDoubleArrayProperty(name, doubleArray);
+    }
+    vector<int> intArray;
+    uint32_t numIntArrays = readCount(stream, minArraySize, remainingBytes);
+    for (uint32_t i = 0; i < numIntArrays; i++) {
+        string name = readString(stream, remainingBytes);
+        readArray(stream, intArray, remainingBytes);
+        node.setIntArrayProperty(name, intArray);
+    }
+    uint32_t numChildren = readCount(stream, minNodeSize, remainingBytes);
+    node.getChildren().reserve(min((uint64_t) numChildren, min(remainingBytes, readChunkSize)/minNodeSize));
+    for (uint32_t i = 0; i < numChildren; i++)
+        decodeNode(node.createChildNode(""), stream, remainingBytes, depth+1);
+}
+
+void* BinarySerializer::deserializeStream(std::istream& stream) {
+    uint64_t remainingBytes = getRemainingBytes(stream);
+    char header[sizeof(magic)];
+    readBytes(stream, header, sizeof(magic), remainingBytes);
+    if (memcmp(header, magic, sizeof(magic)) != 0)
+        throw OpenMMException("BinarySerializer: The input is not in OpenMM binary format");
+    if (readValue<int32_t>(stream, remainingBytes) != byteOrderMarker)
+        throw OpenMMException("BinarySerializer: The input was written on a machine with a different byte order");
+    if (readValue<int32_t>(stream, remainingBytes) != formatVersion)
+        throw OpenMMException("BinarySerializer: Unsupported format version");
+    SerializationNode root;
+    decodeNode(root, stream, remainingBytes, 0);
+    const SerializationProxy& proxy = SerializationProxy::getProxy(root.getStringProperty("type"));
+    return proxy.deserialize(root);
+}
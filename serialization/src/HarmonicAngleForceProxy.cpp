@@ -42,23 +42,22 @@ HarmonicAngleForceProxy::HarmonicAngleForceProxy() : SerializationProxy("Harmoni
 }
 
 void HarmonicAngleForceProxy::serialize(const void* object, SerializationNode& node) const {
-    node.setIntProperty("version", 2);
+    node.setIntProperty("version", 3);
     const HarmonicAngleForce& force = *reinterpret_cast<const HarmonicAngleForce*>(object);
     node.setIntProperty("forceGroup", force.getForceGroup());
     node.setStringProperty("name", force.getName());
     node.setBoolProperty("usesPeriodic", force.usesPeriodicBoundaryConditions());
-    SerializationNode& bonds = node.createChildNode("Angles");
-    for (int i = 0; i < force.getNumAngles(); i++) {
-        int particle1, particle2, particle3;
-        double angle, k;
-        force.getAngleParameters(i, particle1, particle2, particle3, angle, k);
-        bonds.createChildNode("Angle").setIntProperty("p1", particle1).setIntProperty("p2", particle2).setIntProperty("p3", particle3).setDoubleProperty("a", angle).setDoubleProperty("k", k);
-    }
+    int numAngles = force.getNumAngles();
+    vector<int> particle1(numAngles), particle2(numAngles), particle3(numAngles);
+    vector<double> angle(numAngles), k(numAngles);
+    for (int i = 0; i < numAngles; i++)
+        force.getAngleParameters(i, particle1[i], particle2[i], particle3[i], angle[i], k[i]);
+    node.createChildNode("Angles").setIntArrayProperty("p1", particle1).setIntArrayProperty("p2", particle2).setIntArrayProperty("p3", particle3).setDoubleArrayProperty("a", angle).setDoubleArrayProperty("k", k);
 }
 
 void* HarmonicAngleForceProxy::deserialize(const SerializationNode& node) const {
     int version = node.getIntProperty("version");
-    if (version < 1 || version > 2)
+    if (version < 1 || version > 3)
         throw OpenMMException("Unsupported version number");
     HarmonicAngleForce* force = new HarmonicAngleForce();
     try {
@@ -67,8 +66,21 @@ void* HarmonicAngleForceProxy::deserialize(const SerializationNode& node) const
         if (version > 1)
             force->setUsesPeriodicBoundaryConditions(node.getBoolProperty("usesPeriodic"));
         const SerializationNode& angles = node.getChildNode("Angles");
-        for (auto& angle : angles.getChildren())
-            force->addAngle(angle.getIntProperty("p1"), angle.getIntProperty("p2"), angle.getIntProperty("p3"), angle.getDoubleProperty("a"), angle.getDoubleProperty("k"));
+        if (version > 2) {
+            vector<int> particle1 = angles.getIntArrayProperty("p1");
+            vector<int> particle2 = angles.getIntArrayProperty("p2");
+            vector<int> particle3 = angles.getIntArrayProperty("p3");
+            vector<double> angle = angles.getDoubleArrayProperty("a");
+            vector<double> k = angles.getDoubleArrayProperty("k");
+            if (particle2.size() != particle1.size() || particle3.size() != particle1.size() || angle.size() != particle1.size() || k.size() != particle1.size())
+                throw OpenMMException("Inconsistent array lengths in node 'Angles'");
+            for (int i = 0; i < particle1.size(); i++)
+                force->addAngle(particle1[i], particle2[i], particle3[i], angle[i], k[i]);
+        }
+        else {
+            for (auto& angle : angles.getChildren())
+                force->addAngle(angle.getIntProperty("p1"), angle.getIntProperty("p2"), angle.getIntProperty("p3"), angle.getDoubleProperty("a"), angle.getDoubleProperty("k"));
+        }
     }
     catch (...) {
         delete force;
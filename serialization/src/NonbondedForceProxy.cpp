@@ -42,7 +42,7 @@ NonbondedForceProxy::NonbondedForceProxy() : SerializationProxy("NonbondedForce"
 }
 
 void NonbondedForceProxy::serialize(const void* object, SerializationNode& node) const {
-    node.setIntProperty("version", 4);
+    node.setIntProperty("version", 5);
     const NonbondedForce& force = *reinterpret_cast<const NonbondedForce*>(object);
     node.setIntProperty("forceGroup", force.getForceGroup());
     node.setStringProperty("name", force.getName());
@@ -87,24 +87,24 @@ void NonbondedForceProxy::serialize(const void* object, SerializationNode& node)
         force.getExceptionParameterOffset(i, parameter, exception, chargeProdScale, sigmaScale, epsilonScale);
         exceptionOffsets.createChildNode("Offset").setStringProperty("parameter", parameter).setIntProperty("exception", exception).setDoubleProperty("q", chargeProdScale).setDoubleProperty("sig", sigmaScale).setDoubleProperty("eps", epsilonScale);
     }
-    SerializationNode& particles = node.createChildNode("Particles");
-    for (int i = 0; i < force.getNumParticles(); i++) {
-        double charge, sigma, epsilon;
-        force.getParticleParameters(i, charge, sigma, epsilon);
-        particles.createChildNode("Particle").setDoubleProperty("q", charge).setDoubleProperty("sig", sigma).setDoubleProperty("eps", epsilon);
-    }
-    SerializationNode& exceptions = node.createChildNode("Exceptions");
-    for (int i = 0; i < force.getNumExceptions(); i++) {
-        int particle1, particle2;
-        double chargeProd, sigma, epsilon;
-        force.getExceptionParameters(i, particle1, particle2, chargeProd, sigma, epsilon);
-        exceptions.createChildNode("Exception").setIntProperty("p1", particle1).setIntProperty("p2", particle2).setDoubleProperty("q", chargeProd).setDoubleProperty("sig", sigma).setDoubleProperty("eps", epsilon);
-    }
+    int numParticles = force.getNumParticles();
+    vector<double> charge(numParticles), sigma(numParticles), epsilon(numParticles);
+    for (int i = 0; i < numParticles; i++)
+        force.getParticleParameters(i, charge[i], sigma[i], epsilon[i]);
+    node.createChildNode("Particles").setDoubleArrayProperty("q", charge).setDoubleArrayProperty("sig", sigma).setDoubleArrayProperty("eps", epsilon);
+    int numExceptions = force.getNumExceptions();
+    vector<int> particle1(numExceptions), particle2(numExceptions);
+    vector<double> chargeProd(numExceptions);
+    sigma.resize(numExceptions);
+    epsilon.resize(numExceptions);
+    for (int i = 0; i < numExceptions; i++)
+        force.getExceptionParameters(i, particle1[i], particle2[i], chargeProd[i], sigma[i], epsilon[i]);
+    node.createChildNode("Exceptions").setIntArrayProperty("p1", particle1).setIntArrayProperty("p2", particle2).setDoubleArrayProperty("q", chargeProd).setDoubleArrayProperty("sig", sigma).setDoubleArrayProperty("eps", epsilon);
 }
 
 void* NonbondedForceProxy::deserialize(const SerializationNode& node) const {
     int version = node.getIntProperty("version");
-    if (version < 1 || version > 4)
+    if (version < 1 || version > 5)
         throw OpenMMException("Unsupported version number");
     NonbondedForce* force = new NonbondedForce();
     try {
@@ -146,11 +146,33 @@ void* NonbondedForceProxy::deserialize(const SerializationNode& node) const {
         if (version >= 4)
             force->setExceptionsUsePeriodicBoundaryConditions(node.getIntProperty("exceptionsUsePeriodic"));
         const SerializationNode& particles = node.getChildNode("Particles");
-        for (auto& particle : particles.getChildren())
-            force->addParticle(particle.getDoubleProperty("q"), particle.getDoubleProperty("sig"), particle.getDoubleProperty("eps"));
         const SerializationNode& exceptions = node.getChildNode("Exceptions");
-        for (auto& exception : exceptions.getChildren())
-            force->addException(exception.getIntProperty("p1"), exception.getIntProperty("p2"), exception.getDoubleProperty("q"), exception.getDoubleProperty("sig"), exception.getDoubleProperty("eps"));
+        if (version >= 5) {
+            // Per-particle and per-exception values are stored as arrays.
+
+            vector<double> charge = particles.getDoubleArrayProperty("q");
+            vector<double> sigma = particles.getDoubleArrayProperty("sig");
+            vector<double> epsilon = particles.getDoubleArrayProperty("eps");
+            if (sigma.size() != charge.size() || epsilon.size() != charge.size())
+                throw OpenMMException("Inconsistent array lengths in node 'Particles'");
+            for (int i = 0; i < charge.size(); i++)
+                force->addParticle(charge[i], sigma[i], epsilon[i]);
+            vector<int> particle1 = exceptions.getIntArrayProperty("p1");
+            vector<int> particle2 = exceptions.getIntArrayProperty("p2");
+            vector<double> chargeProd = exceptions.getDoubleArrayProperty("q");
+            sigma = exceptions.getDoubleArrayProperty("sig");
+            epsilon = exceptions.getDoubleArrayProperty("eps");
+            if (particle2.size() != particle1.size() || chargeProd.size() != particle1.size() || sigma.size() != particle1.size() || epsilon.size() != particle1.size())
+                throw OpenMMException("Inconsistent array lengths in node 'Exceptions'");
+            for (int i = 0; i < particle1.size(); i++)
+                force->addException(particle1[i], particle2[i], chargeProd[i], sigma[i], epsilon[i]);
+        }
+        else {
+            for (auto& particle : particles.getChildren())
+                force->addParticle(particle.getDoubleProperty("q"), particle.getDoubleProperty("sig"), particle.getDoubleProperty("eps"));
+            for (auto& exception : exceptions.getChildren())
+                force->addException(exception.getIntProperty("p1"), exception.getIntProperty("p2"), exception.getDoubleProperty("q"), exception.getDoubleProperty("sig"), exception.getDoubleProperty("eps"));
+        }
     }
     catch (...) {
         delete force;
@@ -42,23 +42,23 @@ PeriodicTorsionForceProxy::PeriodicTorsionForceProxy() : SerializationProxy("Per
 }
 
 void PeriodicTorsionForceProxy::serialize(const void* object, SerializationNode& node) const {
-    node.setIntProperty("version", 2);
+    node.setIntProperty("version", 3);
     const PeriodicTorsionForce& force = *reinterpret_cast<const PeriodicTorsionForce*>(object);
     node.setIntProperty("forceGroup", force.getForceGroup());
     node.setStringProperty("name", force.getName());
     node.setBoolProperty("usesPeriodic", force.usesPeriodicBoundaryConditions());
-    SerializationNode& torsions = node.createChildNode("Torsions");
-    for (int i = 0; i < force.getNumTorsions(); i++) {
-        int particle1, particle2, particle3, particle4, periodicity;
-        double phase, k;
-        force.getTorsionParameters(i, particle1, particle2, particle3, particle4, periodicity, phase, k);
-        torsions.createChildNode("Torsion").setIntProperty("p1", particle1).setIntProperty("p2", particle2).setIntProperty("p3", particle3).setIntProperty("p4", particle4).setIntProperty("periodicity", periodicity).setDoubleProperty("phase", phase).setDoubleProperty("k", k);
-    }
+    int numTorsions = force.getNumTorsions();
+    vector<int> particle1(numTorsions), particle2(numTorsions), particle3(numTorsions), particle4(numTorsions), periodicity(numTorsions);
+    vector<double> phase(numTorsions), k(numTorsions);
+    for (int i = 0; i < numTorsions; i++)
+        force.getTorsionParameters(i, particle1[i], particle2[i], particle3[i], particle4[i], periodicity[i], phase[i], k[i]);
+    node.createChildNode("Torsions").setIntArrayProperty("p1", particle1).setIntArrayProperty("p2", particle2).setIntArrayProperty("p3", particle3).setIntArrayProperty("p4", particle4)
+            .setIntArrayProperty("periodicity", periodicity).setDoubleArrayProperty("phase", phase).setDoubleArrayProperty("k", k);
 }
 
 void* PeriodicTorsionForceProxy::deserialize(const SerializationNode& node) const {
     int version = node.getIntProperty("version");
-    if (version < 1 || version > 2)
+    if (version < 1 || version > 3)
         throw OpenMMException("Unsupported version number");
     PeriodicTorsionForce* force = new PeriodicTorsionForce();
     try {
@@ -67,9 +67,26 @@ void* PeriodicTorsionForceProxy::deserialize(const SerializationNode& node) cons
         if (version > 1)
             force->setUsesPeriodicBoundaryConditions(node.getBoolProperty("usesPeriodic"));
         const SerializationNode& torsions = node.getChildNode("Torsions");
-        for (auto& torsion : torsions.getChildren())
-            force->addTorsion(torsion.getIntProperty("p1"), torsion.getIntProperty("p2"), torsion.getIntProperty("p3"), torsion.getIntProperty("p4"),
-                    torsion.getIntProperty("periodicity"), torsion.getDoubleProperty("phase"), torsion.getDoubleProperty("k"));
+        if (version > 2) {
+            vector<int> particle1 = torsions.getIntArrayProperty("p1");
+            vector<int> particle2 = torsions.getIntArrayProperty("p2");
+            vector<int> particle3 = torsions.getIntArrayProperty("p3");
+            vector<int> particle4 = torsions.getIntArrayProperty("p4");
+            vector<int> periodicity = torsions.getIntArrayProperty("periodicity");
+            vector<double> phase = torsions.getDoubleArrayProperty("phase");
+            vector<double> k = torsions.getDoubleArrayProperty("k");
+            int numTorsions = particle1.size();
+            if (particle2.size() != numTorsions || particle3.size() != numTorsions || particle4.size() != numTorsions || periodicity.size() != numTorsions ||
+                    phase.size() != numTorsions || k.size() != numTorsions)
+                throw OpenMMException("Inconsistent array lengths in node 'Torsions'");
+            for (int i = 0; i < numTorsions; i++)
+                force->addTorsion(particle1[i], particle2[i], particle3[i], particle4[i], periodicity[i], phase[i], k[i]);
+        }
+        else {
+            for (auto& torsion : torsions.getChildren())
+                force->addTorsion(torsion.getIntProperty("p1"), torsion.getIntProperty("p2"), torsion.getIntProperty("p3"), torsion.getIntProperty("p4"),
+                        torsion.getIntProperty("periodicity"), torsion.getDoubleProperty("phase"), torsion.getDoubleProperty("k"));
+        }
     }
     catch (...) {
         delete force;
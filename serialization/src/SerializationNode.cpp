@@ -31,6 +31,8 @@
 
 #include "openmm/serialization/SerializationNode.h"
 #include "openmm/OpenMMException.h"
+#include <cctype>
+#include <cstdlib>
 #include <sstream>
 
 using namespace OpenMM;
@@ -74,7 +76,8 @@ const map<string, string>& SerializationNode::getProperties() const {
 }
 
 bool SerializationNode::hasProperty(const string& name) const {
-    return (properties.find(name) != properties.end());
+    return (properties.find(name) != properties.end() || doubleArrayProperties.find(name) != doubleArrayProperties.end() ||
+            intArrayProperties.find(name) != intArrayProperties.end());
 }
 
 const string& SerializationNode::getStringProperty(const string& name) const {
@@ -93,6 +96,8 @@ const string& SerializationNode::getStringProperty(const string& name, const str
 
 SerializationNode& SerializationNode::setStringProperty(const string& name, const string& value) {
     properties[name] = value;
+    doubleArrayProperties.erase(name);
+    intArrayProperties.erase(name);
     return *this;
 }
 
@@ -117,8 +122,7 @@ int SerializationNode::getIntProperty(const string& name, int defaultValue) cons
 SerializationNode& SerializationNode::setIntProperty(const string& name, int value) {
     stringstream s;
     s << value;
-    properties[name] = s.str();
-    return *this;
+    return setStringProperty(name, s.str());
 }
 
 long long SerializationNode::getLongProperty(const string& name) const {
@@ -142,8 +146,7 @@ long long SerializationNode::getLongProperty(const string& name, long long defau
 SerializationNode& SerializationNode::setLongProperty(const string& name, long long value) {
     stringstream s;
     s << value;
-    properties[name] = s.str();
-    return *this;
+    return setStringProperty(name, s.str());
 }
 
 bool SerializationNode::getBoolProperty(const string& name) const {
@@ -167,8 +170,7 @@ bool SerializationNode::getBoolProperty(const string& name, bool defaultValue) c
 SerializationNode& SerializationNode::setBoolProperty(const string& name, bool value) {
     stringstream s;
     s << value;
-    properties[name] = s.str();
-    return *this;
+    return setStringProperty(name, s.str());
 }
 
 double SerializationNode::getDoubleProperty(const string& name) const {
@@ -188,7 +190,80 @@ double SerializationNode::getDoubleProperty(const string& name, double defaultVa
 SerializationNode& SerializationNode::setDoubleProperty(const string& name, double value) {
     char buffer[32];
     g_fmt(buffer, value);
-    properties[name] = string(buffer);
+    return setStringProperty(name, string(buffer));
+}
+
+const map<string, vector<double> >& SerializationNode::getDoubleArrayProperties() const {
+    return doubleArrayProperties;
+}
+
+const map<string, vector<int> >& SerializationNode::getIntArrayProperties() const {
+    return intArrayProperties;
+}
+
+vector<double> SerializationNode::getDoubleArrayProperty(const string& name) const {
+    map<string, vector<double> >::const_iterator iter = doubleArrayProperties.find(name);
+    if (iter != doubleArrayProperties.end())
+        return iter->second;
+    map<string, vector<int> >::const_iterator intIter = intArrayProperties.find(name);
+    if (intIter != intArrayProperties.end())
+        return vector<double>(intIter->second.begin(), intIter->second.end());
+
+    // Parse a space separated list of values.
+
+    vector<double> value;
+    const char* start = getStringProperty(name).c_str();
+    while (true) {
+        while (isspace(*start))
+            start++;
+        if (*start == 0)
+            break;
+        char* end;
+        value.push_back(strtod2(start, &end));
+        if (end == start)
+            throw OpenMMException("Illegal value for array property '"+name+"' in node '"+getName()+"'");
+        start = end;
+    }
+    return value;
+}
+
+SerializationNode& SerializationNode::setDoubleArrayProperty(const string& name, const vector<double>& value) {
+    properties.erase(name);
+    intArrayProperties.erase(name);
+    doubleArrayProperties[name] = value;
+    return *this;
+}
+
+vector<int> SerializationNode::getIntArrayProperty(const string& name) const {
+    map<string, vector<int> >::const_iterator iter = intArrayProperties.find(name);
+    if (iter != intArrayProperties.end())
+        return iter->second;
+    map<string, vector<double> >::const_iterator doubleIter = doubleArrayProperties.find(name);
+    if (doubleIter != doubleArrayProperties.end())
+        return vector<int>(doubleIter->second.begin(), doubleIter->second.end());
+
+    // Parse a space separated list of values.
+
+    vector<int> value;
+    const char* start = getStringProperty(name).c_str();
+    while (true) {
+        while (isspace(*start))
+            start++;
+        if (*start == 0)
+            break;
+        char* end;
+        value.push_back((int) strtol(start, &end, 10));
+        if (end == start)
+            throw OpenMMException("Illegal value for array property '"+name+"' in node '"+getName()+"'");
+        start = end;
+    }
+    return value;
+}
+
+SerializationNode& SerializationNode::setIntArrayProperty(const string& name, const vector<int>& value) {
+    properties.erase(name);
+    doubleArrayProperties.erase(name);
+    intArrayProperties[name] = value;
     return *this;
 }
 
@@ -44,7 +44,7 @@ SystemProxy::SystemProxy() : SerializationProxy("System") {
 }
 
 void SystemProxy::serialize(const void* object, SerializationNode& node) const {
-    node.setIntProperty("version", 1);
+    node.setIntProperty("version", 2);
     node.setStringProperty("openmmVersion", Platform::getOpenMMVersion());
     const System& system = *reinterpret_cast<const System*>(object);
     Vec3 a, b, c;
@@ -53,22 +53,28 @@ void SystemProxy::serialize(const void* object, SerializationNode& node) const {
     box.createChildNode("A").setDoubleProperty("x", a[0]).setDoubleProperty("y", a[1]).setDoubleProperty("z", a[2]);
     box.createChildNode("B").setDoubleProperty("x", b[0]).setDoubleProperty("y", b[1]).setDoubleProperty("z", b[2]);
     box.createChildNode("C").setDoubleProperty("x", c[0]).setDoubleProperty("y", c[1]).setDoubleProperty("z", c[2]);
-    SerializationNode& particles = node.createChildNode("Particles");
-    for (int i = 0; i < system.getNumParticles(); i++) {
-        SerializationNode& particle = particles.createChildNode("Particle").setDoubleProperty("mass", system.getParticleMass(i));
+    int numParticles = system.getNumParticles();
+    vector<double> masses(numParticles);
+    for (int i = 0; i < numParticles; i++)
+        masses[i] = system.getParticleMass(i);
+    SerializationNode& particles = node.createChildNode("Particles").setDoubleArrayProperty("mass", masses);
+
+    // Virtual sites are stored as child nodes, each recording the index of the particle it applies to.
+
+    for (int i = 0; i < numParticles; i++) {
         if (system.isVirtualSite(i)) {
             const VirtualSite& vsite = system.getVirtualSite(i);
             if (typeid(vsite) == typeid(TwoParticleAverageSite)) {
                 const TwoParticleAverageSite& site = dynamic_cast<const TwoParticleAverageSite&>(vsite);
-                particle.createChildNode("TwoParticleAverageSite").setIntProperty("p1", site.getParticle(0)).setIntProperty("p2", site.getParticle(1)).setDoubleProperty("w1", site.getWeight(0)).setDoubleProperty("w2", site.getWeight(1));
+                particles.createChildNode("TwoParticleAverageSite").setIntProperty("index", i).setIntProperty("p1", site.getParticle(0)).setIntProperty("p2", site.getParticle(1)).setDoubleProperty("w1", site.getWeight(0)).setDoubleProperty("w2", site.getWeight(1));
             }
             else if (typeid(vsite) == typeid(ThreeParticleAverageSite)) {
                 const ThreeParticleAverageSite& site = dynamic_cast<const ThreeParticleAverageSite&>(vsite);
-                particle.createChildNode("ThreeParticleAverageSite").setIntProperty("p1", site.getParticle(0)).setIntProperty("p2", site.getParticle(1)).setIntProperty("p3", site.getParticle(2)).setDoubleProperty("w1", site.getWeight(0)).setDoubleProperty("w2", site.getWeight(1)).setDoubleProperty("w3", site.getWeight(2));
+                particles.createChildNode("ThreeParticleAverageSite").setIntProperty("index", i).setIntProperty("p1", site.getParticle(0)).setIntProperty("p2", site.getParticle(1)).setIntProperty("p3", site.getParticle(2)).setDoubleProperty("w1", site.getWeight(0)).setDoubleProperty("w2", site.getWeight(1)).setDoubleProperty("w3", site.getWeight(2));
             }
             else if (typeid(vsite) == typeid(OutOfPlaneSite)) {
                 const OutOfPlaneSite& site = dynamic_cast<const OutOfPlaneSite&>(vsite);
-                particle.createChildNode("OutOfPlaneSite").setIntProperty("p1", site.getParticle(0)).setIntProperty("p2", site.getParticle(1)).setIntProperty("p3", site.getParticle(2)).setDoubleProperty("w12", site.getWeight12()).setDoubleProperty("w13", site.getWeight13()).setDoubleProperty("wc", site.getWeightCross());
+                particles.createChildNode("OutOfPlaneSite").setIntProperty("index", i).setIntProperty("p1", site.getParticle(0)).setIntProperty("p2", site.getParticle(1)).setIntProperty("p3", site.getParticle(2)).setDoubleProperty("w12", site.getWeight12()).setDoubleProperty("w13", site.getWeight13()).setDoubleProperty("wc", site.getWeightCross());
             }
             else if (typeid(vsite) == typeid(LocalCoordinatesSite)) {
                 const LocalCoordinatesSite& site = dynamic_cast<const LocalCoordinatesSite&>(vsite);
@@ -78,7 +84,7 @@ void SystemProxy::serialize(const void* object, SerializationNode& node) const {
                 site.getXWeights(wx);
                 site.getYWeights(wy);
                 Vec3 p = site.getLocalPosition();
-                SerializationNode& siteNode = particle.createChildNode("LocalCoordinatesSite");
+                SerializationNode& siteNode = particles.createChildNode("LocalCoordinatesSite").setIntProperty("index", i);
                 siteNode.setDoubleProperty("pos1", p[0]).setDoubleProperty("pos2", p[1]).setDoubleProperty("pos3", p[2]);
                 for (int j = 0; j < numParticles; j++) {
                     stringstream ss;
@@ -92,20 +98,51 @@ void SystemProxy::serialize(const void* object, SerializationNode& node) const {
             }
         }
     }
-    SerializationNode& constraints = node.createChildNode("Constraints");
-    for (int i = 0; i < system.getNumConstraints(); i++) {
-        int particle1, particle2;
-        double distance;
-        system.getConstraintParameters(i, particle1, particle2, distance);
-        constraints.createChildNode("Constraint").setIntProperty("p1", particle1).setIntProperty("p2", particle2).setDoubleProperty("d", distance);
-    }
+    int numConstraints = system.getNumConstraints();
+    vector<int> particle1(numConstraints), particle2(numConstraints);
+    vector<double> distance(numConstraints);
+    for (int i = 0; i < numConstraints; i++)
+        system.getConstraintParameters(i, particle1[i], particle2[i], distance[i]);
+    node.createChildNode("Constraints").setIntArrayProperty("p1", particle1).setIntArrayProperty("p2", particle2).setDoubleArrayProperty("d", distance);
     SerializationNode& forces = node.createChildNode("Forces");
     for (int i = 0; i < system.getNumForces(); i++)
         forces.createChildNode("Force", &system.getForce(i));
 }
 
+/**
+ * Create a VirtualSite from the information stored in a node.  If the node does not describe a known
+ * type of virtual site, this returns NULL.
+ */
+static VirtualSite* decodeVirtualSite(const SerializationNode& vsite) {
+    if (vsite.getName() == "TwoParticleAverageSite")
+        return new TwoParticleAverageSite(vsite.getIntProperty("p1"), vsite.getIntProperty("p2"), vsite.getDoubleProperty("w1"), vsite.getDoubleProperty("w2"));
+    if (vsite.getName() == "ThreeParticleAverageSite")
+        return new ThreeParticleAverageSite(vsite.getIntProperty("p1"), vsite.getIntProperty("p2"), vsite.getIntProperty("p3"), vsite.getDoubleProperty("w1"), vsite.getDoubleProperty("w2"), vsite.getDoubleProperty("w3"));
+    if (vsite.getName() == "OutOfPlaneSite")
+        return new OutOfPlaneSite(vsite.getIntProperty("p1"), vsite.getIntProperty("p2"), vsite.getIntProperty("p3"), vsite.getDoubleProperty("w12"), vsite.getDoubleProperty("w13"), vsite.getDoubleProperty("wc"));
+    if (vsite.getName() == "LocalCoordinatesSite") {
+        vector<int> particleIndices;
+        vector<double> wo, wx, wy;
+        for (int j = 0; ; j++) {
+            stringstream ss;
+            ss << (j+1);
+            string index = ss.str();
+            if (!vsite.hasProperty("p"+index))
+                break;
+            particleIndices.push_back(vsite.getIntProperty("p"+index));
+            wo.push_back(vsite.getDoubleProperty("wo"+index));
+            wx.push_back(vsite.getDoubleProperty("wx"+index));
+            wy.push_back(vsite.getDoubleProperty("wy"+index));
+        }
+        Vec3 p(vsite.getDoubleProperty("pos1"), vsite.getDoubleProperty("pos2"), vsite.getDoubleProperty("pos3"));
+        return new LocalCoordinatesSite(particleIndices, wo, wx, wy, p);
+    }
+    return NULL;
+}
+
 void* SystemProxy::deserialize(const SerializationNode& node) const {
-    if (node.getIntProperty("version") != 1)
+    int version = node.getIntProperty("version");
+    if (version < 1 || version > 2)
         throw OpenMMException("Unsupported version number");
     System* system = new System();
     try {
@@ -118,38 +155,38 @@ void* SystemProxy::deserialize(const SerializationNode& node) const {
         Vec3 c(boxc.getDoubleProperty("x"), boxc.getDoubleProperty("y"), boxc.getDoubleProperty("z"));
         system->setDefaultPeriodicBoxVectors(a, b, c);
         const SerializationNode& particles = node.getChildNode("Particles");
-        for (int i = 0; i < (int) particles.getChildren().size(); i++) {
-            system->addParticle(particles.getChildren()[i].getDoubleProperty("mass"));
-            if (particles.getChildren()[i].getChildren().size() > 0) {
-                const SerializationNode& vsite = particles.getChildren()[i].getChildren()[0];
-                if (vsite.getName() == "TwoParticleAverageSite")
-                    system->setVirtualSite(i, new TwoParticleAverageSite(vsite.getIntProperty("p1"), vsite.getIntProperty("p2"), vsite.getDoubleProperty("w1"), vsite.getDoubleProperty("w2")));
-                else if (vsite.getName() == "ThreeParticleAverageSite")
-                    system->setVirtualSite(i, new ThreeParticleAverageSite(vsite.getIntProperty("p1"), vsite.getIntProperty("p2"), vsite.getIntProperty("p3"), vsite.getDoubleProperty("w1"), vsite.getDoubleProperty("w2"), vsite.getDoubleProperty("w3")));
-                else if (vsite.getName() == "OutOfPlaneSite")
-                    system->setVirtualSite(i, new OutOfPlaneSite(vsite.getIntProperty("p1"), vsite.getIntProperty("p2"), vsite.getIntProperty("p3"), vsite.getDoubleProperty("w12"), vsite.getDoubleProperty("w13"), vsite.getDoubleProperty("wc")));
-                else if (vsite.getName() == "LocalCoordinatesSite") {
-                    vector<int> particleIndices;
-                    vector<double> wo, wx, wy;
-                    for (int j = 0; ; j++) {
-                        stringstream ss;
-                        ss << (j+1);
-                        string index = ss.str();
-                        if (!vsite.hasProperty("p"+index))
-                            break;
-                        particleIndices.push_back(vsite.getIntProperty("p"+index));
-                        wo.push_back(vsite.getDoubleProperty("wo"+index));
-                        wx.push_back(vsite.getDoubleProperty("wx"+index));
-                        wy.push_back(vsite.getDoubleProperty("wy"+index));
-                    }
-                    Vec3 p(vsite.getDoubleProperty("pos1"), vsite.getDoubleProperty("pos2"), vsite.getDoubleProperty("pos3"));
-                    system->setVirtualSite(i, new LocalCoordinatesSite(particleIndices, wo, wx, wy, p));
+        const SerializationNode& constraints = node.getChildNode("Constraints");
+        if (version > 1) {
+            for (double mass : particles.getDoubleArrayProperty("mass"))
+                system->addParticle(mass);
+            for (auto& vsite : particles.getChildren()) {
+                int index = vsite.getIntProperty("index");
+                if (index < 0 || index >= system->getNumParticles())
+                    throw OpenMMException("Illegal particle index for virtual site: "+vsite.getStringProperty("index"));
+                VirtualSite* site = decodeVirtualSite(vsite);
+                if (site != NULL)
+                    system->setVirtualSite(index, site);
+            }
+            vector<int> particle1 = constraints.getIntArrayProperty("p1");
+            vector<int> particle2 = constraints.getIntArrayProperty("p2");
+            vector<double> distance = constraints.getDoubleArrayProperty("d");
+            if (particle2.size() != particle1.size() || distance.size() != particle1.size())
+                throw OpenMMException("Inconsistent array lengths in node 'Constraints'");
+            for (int i = 0; i < particle1.size(); i++)
+                system->addConstraint(particle1[i], particle2[i], distance[i]);
+        }
+        else {
+            for (int i = 0; i < (int) particles.getChildren().size(); i++) {
+                system->addParticle(particles.getChildren()[i].getDoubleProperty("mass"));
+                if (particles.getChildren()[i].getChildren().size() > 0) {
+                    VirtualSite* site = decodeVirtualSite(particles.getChildren()[i].getChildren()[0]);
+                    if (site != NULL)
+                        system->setVirtualSite(i, site);
                 }
             }
+            for (auto& constraint : constraints.getChildren())
+                system->addConstraint(constraint.getIntProperty("p1"), constraint.getIntProperty("p2"), constraint.getDoubleProperty("d"));
         }
-        const SerializationNode& constraints = node.getChildNode("Constraints");
-        for (auto& constraint : constraints.getChildren())
-            system->addConstraint(constraint.getIntProperty("p1"), constraint.getIntProperty("p2"), constraint.getDoubleProperty("d"));
         const SerializationNode& forces = node.getChildNode("Forces");
         for (auto& force : forces.getChildren())
             system->addForce(force.decodeObject<Force>());
@@ -30,16 +30,29 @@
  * -------------------------------------------------------------------------- */
 
 #include "openmm/serialization/XmlSerializer.h"
+#include "openmm/Force.h"
+#include "openmm/System.h"
+#include "openmm/internal/ThreadPool.h"
 #include "irrXML.h"
 #include <cstring>
+#include <deque>
+#include <exception>
 #include <iostream>
 #include <map>
+#include <memory>
 
 using namespace OpenMM;
 using namespace std;
 using namespace irr;
 using namespace io;
 
+extern "C" char* g_fmt(char*, double);
+
+// Documents smaller than this are decoded on the calling thread, since starting worker threads would take
+// longer than decoding them.
+
+static const int MinParallelDecodeSize = 1<<20;
+
 /**
  * Apply XML encoding to a string.  This is adapted from TinyXML (written by Lee Thomason).
  */
@@ -121,6 +134,25 @@ void XmlSerializer::encodeNode(const SerializationNode& node, std::ostream& stre
         encodeString(prop.second, &value);
         stream << ' ' << name << "=\"" << value << '\"';
     }
+    for (auto& prop : node.getDoubleArrayProperties()) {
+        string name;
+        encodeString(prop.first, &name);
+        stream << ' ' << name << "=\"";
+        char buffer[32];
+        for (int i = 0; i < prop.second.size(); i++) {
+            g_fmt(buffer, prop.second[i]);
+            stream << (i == 0 ? "" : " ") << buffer;
+        }
+        stream << '\"';
+    }
+    for (auto& prop : node.getIntArrayProperties()) {
+        string name;
+        encodeString(prop.first, &name);
+        stream << ' ' << name << "=\"";
+        for (int i = 0; i < prop.second.size(); i++)
+            stream << (i == 0 ? "" : " ") << prop.second[i];
+        stream << '\"';
+    }
     const vector<SerializationNode>& children = node.getChildren();
     if (children.size() == 0)
         stream << "/>\n";
@@ -178,6 +210,95 @@ static void decodeNode(SerializationNode& node, IrrXMLReader& xml) {
     }
 }
 
+/**
+ * Create a Force from its SerializationNode, recording any exception so it can be reported once all
+ * Forces have been decoded.  The node is released as soon as it is no longer needed.
+ */
+static void decodeForce(shared_ptr<SerializationNode>& forceNode, unique_ptr<Force>* force, exception_ptr* error) {
+    try {
+        force->reset(forceNode->decodeObject<Force>());
+    }
+    catch (...) {
+        *error = current_exception();
+    }
+    forceNode.reset();
+}
+
+/**
+ * Process the XML for a System.  This produces the same result as calling decodeNode() and then passing
+ * the node to the System's proxy, but it never holds the SerializationNodes for the whole System in memory.
+ * Each Force is decoded as soon as its XML has been read, and its nodes are discarded once the Force has
+ * been created.  The XML text itself is still held in full, since irrXML reads the whole document into
+ * memory before parsing it.  If parallel is true, the Forces are handed to worker threads while the main
+ * thread continues reading the following Forces.
+ */
+static void* decodeSystem(IrrXMLReader& xml, bool parallel) {
+    SerializationNode root;
+    for (int i = 0; i < xml.getAttributeCount(); i++)
+        root.setStringProperty(xml.getAttributeName(i), xml.getAttributeValue(i));
+    // The thread pool is declared last so it is destroyed first, which waits for any running tasks to finish
+    // before the Forces they write to are deleted.
+
+    deque<unique_ptr<Force> > forces;
+    deque<exception_ptr> errors;
+    unique_ptr<ThreadPool> threads;
+    if (parallel)
+        threads.reset(new ThreadPool());
+    bool finished = xml.isEmptyElement();
+    while (!finished && xml.read()) {
+        switch (xml.getNodeType()) {
+            case EXN_ELEMENT:
+            {
+                SerializationNode& childNode = root.createChildNode(xml.getNodeName());
+                if (childNode.getName() != "Forces") {
+                    decodeNode(childNode, xml);
+                    break;
+                }
+                for (int i = 0; i < xml.getAttributeCount(); i++)
+                    childNode.setStringProperty(xml.getAttributeName(i), xml.getAttributeValue(i));
+                bool forcesFinished = xml.isEmptyElement();
+                while (!forcesFinished && xml.read()) {
+                    if (xml.getNodeType() == EXN_ELEMENT) {
+                        shared_ptr<SerializationNode> forceNode = make_shared<SerializationNode>();
+                        forceNode->setName(xml.getNodeName());
+                        decodeNode(*forceNode, xml);
+                        forces.emplace_back();
+                        errors.push_back(nullptr);
+                        unique_ptr<Force>* force = &forces.back();
+                        exception_ptr* error = &errors.back();
+                        if (threads) {
+                            threads->addTask([forceNode, force, error] (ThreadPool& threads, int threadIndex) mutable {
+                                decodeForce(forceNode, force, error);
+                            });
+                            threads->startTasks();
+                        }
+                        else
+                            decodeForce(forceNode, force, error);
+                    }
+                    else if (xml.getNodeType() == EXN_ELEMENT_END)
+                        forcesFinished = true;
+                }
+                break;
+            }
+            case EXN_ELEMENT_END:
+                finished = true;
+                break;
+        }
+    }
+    if (threads)
+        threads->executeTasks();
+
+    // Create the System and add the Forces to it.
+
+    for (auto& error : errors)
+        if (error)
+            rethrow_exception(error);
+    System* system = reinterpret_cast<System*>(SerializationProxy::getProxy("System").deserialize(root));
+    for (auto& force : forces)
+        system->addForce(force.release());
+    return system;
+}
+
 void* XmlSerializer::deserializeStream(std::istream& stream) {
     SerializationNode root;
     StreamReader reader(stream);
@@ -187,6 +308,22 @@ void* XmlSerializer::deserializeStream(std::istream& stream) {
     
     while (xml->read() && xml->getNodeType() != EXN_ELEMENT)
         ;
+
+    // Systems are decoded one Force at a time, so the SerializationNodes for the whole System never need to be
+    // stored at once.
+
+    if (string(xml->getAttributeValueSafe("type")) == "System") {
+        void* result;
+        try {
+            result = decodeSystem(*xml, reader.getSize() >= MinParallelDecodeSize);
+        }
+        catch (...) {
+            delete xml;
+            throw;
+        }
+        delete xml;
+        return result;
+    }
     decodeNode(root, *xml);
     delete xml;
     
@@ -75,9 +75,58 @@ void testProperties() {
     ASSERT_EQUAL(false, node.hasProperty("prop2"));
 }
 
+void testArrayProperties() {
+    SerializationNode node;
+    vector<double> doubles = {1.5, -2.0, 1e-20, 3.0};
+    vector<int> ints = {5, -1, 0};
+    node.setDoubleArrayProperty("doubles", doubles);
+    node.setIntArrayProperty("ints", ints);
+    ASSERT(node.hasProperty("doubles"));
+    ASSERT(node.hasProperty("ints"));
+    ASSERT_EQUAL_CONTAINERS(doubles, node.getDoubleArrayProperty("doubles"));
+    ASSERT_EQUAL_CONTAINERS(ints, node.getIntArrayProperty("ints"));
+    ASSERT_EQUAL(1, node.getDoubleArrayProperties().size());
+    ASSERT_EQUAL(1, node.getIntArrayProperties().size());
+    ASSERT_EQUAL(0, node.getProperties().size());
+
+    // An int array can be accessed as doubles, and vice versa.
+
+    vector<double> intsAsDoubles = {5.0, -1.0, 0.0};
+    ASSERT_EQUAL_CONTAINERS(intsAsDoubles, node.getDoubleArrayProperty("ints"));
+
+    // A string is interpreted as a space separated list, which is how arrays are stored in XML.
+
+    node.setStringProperty("text", " 1.25 -3 4e2 ");
+    vector<double> parsed = {1.25, -3.0, 400.0};
+    ASSERT_EQUAL_CONTAINERS(parsed, node.getDoubleArrayProperty("text"));
+    node.setStringProperty("text", "7 8 -9");
+    vector<int> parsedInts = {7, 8, -9};
+    ASSERT_EQUAL_CONTAINERS(parsedInts, node.getIntArrayProperty("text"));
+    node.setStringProperty("text", "");
+    ASSERT_EQUAL(0, node.getDoubleArrayProperty("text").size());
+
+    // Setting a property replaces any previous value with the same name, regardless of type.
+
+    node.setIntProperty("ints", 2);
+    ASSERT_EQUAL(0, node.getIntArrayProperties().size());
+    ASSERT_EQUAL(2, node.getIntProperty("ints"));
+    node.setDoubleArrayProperty("ints", doubles);
+    ASSERT(!node.hasProperty("missing"));
+    ASSERT_EQUAL(0, node.getProperties().count("ints"));
+    bool exists = false;
+    try {
+        node.getDoubleArrayProperty("missing");
+        exists = true;
+    }
+    catch (const exception& ex) {
+    }
+    ASSERT_EQUAL(false, exists);
+}
+
 int main() {
     try {
         testProperties();
+        testArrayProperties();
     }
     catch(const exception& e) {
         cout << "exception: " << e.what() << endl;
@@ -30,16 +30,33 @@
  * -------------------------------------------------------------------------- */
 
 #include "openmm/internal/AssertionUtilities.h"
+#include "openmm/CustomBondForce.h"
 #include "openmm/HarmonicBondForce.h"
+#include "openmm/NonbondedForce.h"
 #include "openmm/System.h"
 #include "openmm/VirtualSite.h"
+#include "openmm/serialization/BinarySerializer.h"
 #include "openmm/serialization/XmlSerializer.h"
+#include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <sstream>
 
 using namespace OpenMM;
 using namespace std;
 
+/**
+ * A stream buffer that reads from a string but does not support seeking, like a pipe.
+ */
+class NonSeekableBuffer : public streambuf {
+public:
+    NonSeekableBuffer(const string& data) : data(data) {
+        setg(&this->data[0], &this->data[0], &this->data[0]+this->data.size());
+    }
+private:
+    string data;
+};
+
 void compareSystems(System& system, System& system2) {
     ASSERT_EQUAL(system.getNumParticles(), system2.getNumParticles());
     for (int i = 0; i < system.getNumParticles(); i++)
@@ -135,11 +152,204 @@ void testSerialization() {
     copy = XmlSerializer::clone(system);
     compareSystems(system, *copy);
     delete copy;
+
+    // Do it again with the binary format.
+
+    stringstream binaryBuffer;
+    BinarySerializer::serialize<System>(&system, "System", binaryBuffer);
+    copy = BinarySerializer::deserialize<System>(binaryBuffer);
+    compareSystems(system, *copy);
+    delete copy;
+}
+
+void testReadVersion1() {
+    // Versions before 2 stored every particle and constraint in its own node.  Make sure they
+    // can still be read.
+
+    string xml = "<?xml version=\"1.0\" ?>\n"
+        "<System openmmVersion=\"8.0\" type=\"System\" version=\"1\">\n"
+        "<PeriodicBoxVectors><A x=\"2\" y=\"0\" z=\"0\"/><B x=\"0\" y=\"2\" z=\"0\"/><C x=\"0\" y=\"0\" z=\"2\"/></PeriodicBoxVectors>\n"
+        "<Particles>\n"
+        "<Particle mass=\"1.5\"/>\n"
+        "<Particle mass=\"2\"/>\n"
+        "<Particle mass=\"0\"><TwoParticleAverageSite p1=\"0\" p2=\"1\" w1=\"0.25\" w2=\"0.75\"/></Particle>\n"
+        "</Particles>\n"
+        "<Constraints><Constraint d=\"0.1\" p1=\"0\" p2=\"1\"/></Constraints>\n"
+        "<Forces/>\n"
+        "</System>\n";
+    stringstream buffer(xml);
+    System* system = XmlSerializer::deserialize<System>(buffer);
+    ASSERT_EQUAL(3, system->getNumParticles());
+    ASSERT_EQUAL(1.5, system->getParticleMass(0));
+    ASSERT_EQUAL(2.0, system->getParticleMass(1));
+    ASSERT_EQUAL(0.0, system->getParticleMass(2));
+    ASSERT(!system->isVirtualSite(0));
+    ASSERT(system->isVirtualSite(2));
+    const TwoParticleAverageSite& site = dynamic_cast<const TwoParticleAverageSite&>(system->getVirtualSite(2));
+    ASSERT_EQUAL(1, site.getParticle(1));
+    ASSERT_EQUAL(0.75, site.getWeight(1));
+    ASSERT_EQUAL(1, system->getNumConstraints());
+    int p1, p2;
+    double d;
+    system->getConstraintParameters(0, p1, p2, d);
+    ASSERT_EQUAL(0, p1);
+    ASSERT_EQUAL(1, p2);
+    ASSERT_EQUAL(0.1, d);
+    delete system;
+}
+
+void testManyForces(bool large) {
+    // Create a System with many Forces.  Large Systems are decoded in parallel, so make sure they all
+    // come out correctly and in the right order.
+
+    System system;
+    for (int i = 0; i < 10; i++)
+        system.addParticle(1.0);
+    for (int i = 0; i < 30; i++) {
+        if (i%3 == 0) {
+            HarmonicBondForce* force = new HarmonicBondForce();
+            force->addBond(i%10, (i+1)%10, 0.1*i, 1.0);
+            if (large)
+                for (int j = 0; j < 20000; j++)
+                    force->addBond(j%10, (j+3)%10, 0.001*j, 2.0);
+            system.addForce(force);
+        }
+        else if (i%3 == 1) {
+            NonbondedForce* force = new NonbondedForce();
+            for (int j = 0; j < 10; j++)
+                force->addParticle(0.1*i, 0.3, 0.5);
+            system.addForce(force);
+        }
+        else {
+            CustomBondForce* force = new CustomBondForce("k*r^2");
+            force->addPerBondParameter("k");
+            force->addBond(0, 1, {(double) i});
+            system.addForce(force);
+        }
+        system.getForce(i).setForceGroup(i);
+    }
+    stringstream buffer;
+    XmlSerializer::serialize<System>(&system, "System", buffer);
+    if (large)
+        ASSERT(buffer.str().size() > 1<<20);
+    System* copy = XmlSerializer::deserialize<System>(buffer);
+    ASSERT_EQUAL(system.getNumForces(), copy->getNumForces());
+    for (int i = 0; i < system.getNumForces(); i++) {
+        ASSERT(typeid(system.getForce(i)) == typeid(copy->getForce(i)));
+        ASSERT_EQUAL(i, copy->getForce(i).getForceGroup());
+    }
+    int p1, p2;
+    double length, k;
+    dynamic_cast<HarmonicBondForce&>(copy->getForce(9)).getBondParameters(0, p1, p2, length, k);
+    ASSERT_EQUAL(9, p1);
+    ASSERT_EQUAL(0, p2);
+    ASSERT_EQUAL_TOL(0.9, length, 1e-15);
+    double charge, sigma, epsilon;
+    dynamic_cast<NonbondedForce&>(copy->getForce(13)).getParticleParameters(5, charge, sigma, epsilon);
+    ASSERT_EQUAL_TOL(1.3, charge, 1e-15);
+    vector<double> params;
+    dynamic_cast<CustomBondForce&>(copy->getForce(29)).getBondParameters(0, p1, p2, params);
+    ASSERT_EQUAL(29.0, params[0]);
+    delete copy;
+}
+
+void testInvalidForce() {
+    // An error decoding one Force should be reported to the caller.
+
+    string xml = "<?xml version=\"1.0\" ?>\n"
+        "<System type=\"System\" version=\"2\">\n"
+        "<PeriodicBoxVectors><A x=\"2\" y=\"0\" z=\"0\"/><B x=\"0\" y=\"2\" z=\"0\"/><C x=\"0\" y=\"0\" z=\"2\"/></PeriodicBoxVectors>\n"
+        "<Particles mass=\"1 1\"/>\n"
+        "<Constraints d=\"\" p1=\"\" p2=\"\"/>\n"
+        "<Forces>\n"
+        "<Force type=\"HarmonicBondForce\" version=\"3\"><Bonds d=\"0.1\" k=\"1\" p1=\"0\" p2=\"1\"/></Force>\n"
+        "<Force type=\"HarmonicBondForce\" version=\"100\"><Bonds d=\"0.1\" k=\"1\" p1=\"0\" p2=\"1\"/></Force>\n"
+        "</Forces>\n"
+        "</System>\n";
+    stringstream buffer(xml);
+    bool threw = false;
+    try {
+        delete XmlSerializer::deserialize<System>(buffer);
+    }
+    catch (const OpenMMException& ex) {
+        threw = true;
+    }
+    ASSERT(threw);
+}
+
+void testCorruptBinaryInput() {
+    // Truncated or corrupted binary data should produce an exception, not a crash or a huge allocation.
+
+    System system;
+    NonbondedForce* force = new NonbondedForce();
+    for (int i = 0; i < 100; i++) {
+        system.addParticle(1.0);
+        force->addParticle(0.1, 0.3, 0.5);
+    }
+    system.addForce(force);
+    stringstream buffer;
+    BinarySerializer::serialize<System>(&system, "System", buffer);
+    string data = buffer.str();
+    auto checkFails = [] (const string& data) {
+        stringstream input(data);
+        bool threw = false;
+        try {
+            delete BinarySerializer::deserialize<System>(input);
+        }
+        catch (const OpenMMException& ex) {
+            threw = true;
+        }
+        ASSERT(threw);
+    };
+    for (int length : {0, 10, 20, (int) data.size()/2, (int) data.size()-1})
+        checkFails(data.substr(0, length));
+
+    // Replace the length of the root node's name, which follows the 12 byte header, with a huge value.
+
+    string corrupt = data;
+    uint32_t hugeLength = 0xFFFFFFF0;
+    memcpy(&corrupt[12], &hugeLength, sizeof(hugeLength));
+    checkFails(corrupt);
+
+    // Input that cannot be seeked has no known length, so lengths are only checked as the data is read.
+
+    auto deserializeUnseekable = [] (const string& data) {
+        NonSeekableBuffer buffer(data);
+        istream input(&buffer);
+        return BinarySerializer::deserialize<System>(input);
+    };
+    System* copy = deserializeUnseekable(data);
+    ASSERT_EQUAL(system.getNumParticles(), copy->getNumParticles());
+    delete copy;
+    for (const string& input : {corrupt, data.substr(0, data.size()/2)}) {
+        bool threw = false;
+        try {
+            delete deserializeUnseekable(input);
+        }
+        catch (const OpenMMException& ex) {
+            threw = true;
+        }
+        ASSERT(threw);
+    }
+
+    // Deeply nested nodes should be rejected instead of overflowing the stack.  Each node has an empty name,
+    // no properties, and one child.
+
+    string nested = data.substr(0, 12);
+    uint32_t node[] = {0, 0, 0, 0, 1};
+    for (int i = 0; i < 100000; i++)
+        nested.append((const char*) node, sizeof(node));
+    checkFails(nested);
 }
 
 int main() {
     try {
         testSerialization();
+        testReadVersion1();
+        testManyForces(false);
+        testManyForces(true);
+        testInvalidForce();
+        testCorruptBinaryInput();
     }
     catch(const exception& e) {
         cout << "exception: " << e.what() << endl;
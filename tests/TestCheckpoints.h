@@ -31,11 +31,14 @@
 
 #include "openmm/internal/AssertionUtilities.h"
 #include "openmm/AndersenThermostat.h"
+#include "openmm/CheckpointWriter.h"
 #include "openmm/Context.h"
 #include "openmm/NonbondedForce.h"
 #include "openmm/System.h"
 #include "openmm/VerletIntegrator.h"
 #include "sfmt/SFMT.h"
+#include <cstdio>
+#include <fstream>
 #include <iostream>
 #include <sstream>
 #include <vector>
@@ -116,12 +119,165 @@ void testSetState() {
     }
 }
 
+void testCheckpointWriter() {
+    // Put particles on a jittered grid so the system is stable, and make it large enough that
+    // positions and velocities account for most of the checkpoint.
+
+    const int gridSize = 8;
+    const int numParticles = gridSize*gridSize*gridSize;
+    const double boxSize = 3.0;
+    const double spacing = boxSize/gridSize;
+    System system;
+    AndersenThermostat* thermostat = new AndersenThermostat(200.0, 1.0);
+    thermostat->setRandomNumberSeed(5);
+    system.addForce(thermostat);
+    NonbondedForce* nonbonded = new NonbondedForce();
+    system.addForce(nonbonded);
+    nonbonded->setNonbondedMethod(NonbondedForce::CutoffPeriodic);
+    vector<Vec3> positions(numParticles);
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    for (int i = 0; i < numParticles; i++) {
+        system.addParticle(1.0);
+        nonbonded->addParticle(i%2 == 0 ? 0.1 : -0.1, 0.2, 0.1);
+        Vec3 gridPos(i%gridSize, (i/gridSize)%gridSize, i/(gridSize*gridSize));
+        positions[i] = (gridPos+Vec3(genrand_real2(sfmt), genrand_real2(sfmt), genrand_real2(sfmt))*0.2)*spacing;
+    }
+    VerletIntegrator integrator(0.001);
+    Context context(system, integrator, platform);
+    context.setPositions(positions);
+    context.setPeriodicBoxVectors(Vec3(boxSize, 0, 0), Vec3(0, boxSize, 0), Vec3(0, 0, boxSize));
+    context.setVelocitiesToTemperature(200.0, 1);
+    integrator.step(100);
+
+    // Write a series of checkpoints, with every third one being a full checkpoint.
+
+    const int numCheckpoints = 5;
+    CheckpointWriter writer(context, 3);
+    vector<stringstream> streams;
+    vector<State> states;
+    for (int i = 0; i < numCheckpoints; i++)
+        streams.emplace_back(ios_base::out | ios_base::in | ios_base::binary);
+    for (int i = 0; i < numCheckpoints; i++) {
+        states.push_back(context.getState(State::Positions | State::Velocities | State::Parameters));
+        ASSERT_EQUAL(i%3 == 0, writer.writeCheckpoint(streams[i]));
+        integrator.step(10);
+    }
+    writer.waitForCompletion();
+
+    // In 10 steps, the sign, exponent, and leading bits of the mantissa of most positions and
+    // velocities do not change.  Deltas are lossless, so the remaining bits cannot be compressed,
+    // but this should still save over 10% of the size.
+
+    ASSERT(streams[1].str().size() < 0.9*streams[0].str().size());
+
+    // Load each delta checkpoint and see if the state is restored exactly, including the
+    // random number generator.
+
+    for (int i = 1; i < 3; i++) {
+        streams[0].seekg(0, streams[0].beg);
+        CheckpointWriter::loadCheckpoint(context, streams[0], streams[i]);
+        State s1 = context.getState(State::Positions | State::Velocities | State::Parameters);
+        compareStates(states[i], s1);
+        integrator.step(10);
+        State s2 = context.getState(State::Positions | State::Velocities | State::Parameters);
+        compareStates(states[i+1], s2);
+    }
+
+    // A full checkpoint can be loaded directly.
+
+    context.loadCheckpoint(streams[3]);
+    State s3 = context.getState(State::Positions | State::Velocities | State::Parameters);
+    compareStates(states[3], s3);
+
+    // Loading a delta checkpoint relative to the wrong full checkpoint should fail.
+
+    streams[0].seekg(0, streams[0].beg);
+    bool failed = false;
+    try {
+        CheckpointWriter::loadCheckpoint(context, streams[0], streams[4]);
+    }
+    catch (exception& ex) {
+        failed = true;
+    }
+    ASSERT(failed);
+    streams[3].seekg(0, streams[3].beg);
+    streams[4].seekg(0, streams[4].beg);
+    CheckpointWriter::loadCheckpoint(context, streams[3], streams[4]);
+    State s4 = context.getState(State::Positions | State::Velocities | State::Parameters);
+    compareStates(states[4], s4);
+}
+
+void testQuantizedCheckpointWriter() {
+    const int gridSize = 8;
+    const int numParticles = gridSize*gridSize*gridSize;
+    const double boxSize = 3.0;
+    const double spacing = boxSize/gridSize;
+    const double tolerance = 1e-4;
+    System system;
+    NonbondedForce* nonbonded = new NonbondedForce();
+    system.addForce(nonbonded);
+    nonbonded->setNonbondedMethod(NonbondedForce::CutoffPeriodic);
+    vector<Vec3> positions(numParticles);
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    for (int i = 0; i < numParticles; i++) {
+        system.addParticle(1.0);
+        nonbonded->addParticle(i%2 == 0 ? 0.1 : -0.1, 0.2, 0.1);
+        Vec3 gridPos(i%gridSize, (i/gridSize)%gridSize, i/(gridSize*gridSize));
+        positions[i] = (gridPos+Vec3(genrand_real2(sfmt), genrand_real2(sfmt), genrand_real2(sfmt))*0.2)*spacing;
+    }
+    VerletIntegrator integrator(0.001);
+    Context context(system, integrator, platform);
+    context.setPositions(positions);
+    context.setPeriodicBoxVectors(Vec3(boxSize, 0, 0), Vec3(0, boxSize, 0), Vec3(0, 0, boxSize));
+    context.setVelocitiesToTemperature(200.0, 1);
+    integrator.step(100);
+
+    // Write a full checkpoint to a file, then a quantized delta checkpoint to a stream.
+
+    string filename = "TestQuantizedCheckpoint.chk";
+    CheckpointWriter writer(context, 2, tolerance);
+    ASSERT_EQUAL_TOL(tolerance, writer.getTolerance(), 0.0);
+    ASSERT(writer.writeCheckpoint(filename));
+    integrator.step(10);
+    State state = context.getState(State::Positions | State::Velocities | State::Parameters);
+    stringstream delta(ios_base::out | ios_base::in | ios_base::binary);
+    ASSERT(!writer.writeCheckpoint(delta));
+    writer.waitForCompletion();
+
+    // Each coordinate changes by a small multiple of the tolerance, so it takes at most a few bytes.
+
+    ifstream full(filename.c_str(), ios::binary);
+    string fullData((istreambuf_iterator<char>(full)), istreambuf_iterator<char>());
+    ASSERT(delta.str().size() < 0.5*fullData.size());
+    ASSERT(delta.str().size() < 3*2*numParticles*3);
+
+    // Loading it should restore positions and velocities to within the tolerance, and everything else exactly.
+
+    integrator.step(10);
+    stringstream fullStream(fullData, ios_base::in | ios_base::binary);
+    CheckpointWriter::loadCheckpoint(context, fullStream, delta);
+    State loaded = context.getState(State::Positions | State::Velocities | State::Parameters);
+    ASSERT_EQUAL(state.getTime(), loaded.getTime());
+    ASSERT_EQUAL(state.getStepCount(), loaded.getStepCount());
+    for (int i = 0; i < numParticles; i++)
+        for (int j = 0; j < 3; j++) {
+            ASSERT(fabs(state.getPositions()[i][j]-loaded.getPositions()[i][j]) <= tolerance);
+            ASSERT(fabs(state.getVelocities()[i][j]-loaded.getVelocities()[i][j]) <= tolerance);
+        }
+    full.close();
+    remove(filename.c_str());
+}
+
 void runPlatformTests();
 
 int main(int argc, char* argv[]) {
     try {
         initializeTests(argc, argv);
         testSetState();
+        testCheckpointWriter();
+        testQuantizedCheckpointWriter();
         runPlatformTests();
     }
     catch(const exception& e) {
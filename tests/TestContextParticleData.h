@@ -0,0 +1,132 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "openmm/internal/AssertionUtilities.h"
+#include "openmm/Context.h"
+#include "openmm/NonbondedForce.h"
+#include "openmm/System.h"
+#include "openmm/VerletIntegrator.h"
+#include "sfmt/SFMT.h"
+#include <iostream>
+#include <vector>
+
+using namespace OpenMM;
+using namespace std;
+
+const double TOL = 1e-5;
+
+void testGetParticleData() {
+    const int numParticles = 10;
+    const double boxSize = 3.0;
+    System system;
+    NonbondedForce* nonbonded = new NonbondedForce();
+    system.addForce(nonbonded);
+    nonbonded->setNonbondedMethod(NonbondedForce::CutoffPeriodic);
+    nonbonded->setForceGroup(1);
+    vector<Vec3> positions(numParticles);
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    for (int i = 0; i < numParticles; i++) {
+        system.addParticle(1.0);
+        nonbonded->addParticle(i%2 == 0 ? 0.1 : -0.1, 0.2, 0.1);
+        positions[i] = Vec3(boxSize*genrand_real2(sfmt), boxSize*genrand_real2(sfmt), boxSize*genrand_real2(sfmt));
+    }
+    VerletIntegrator integrator(0.001);
+    Context context(system, integrator, platform);
+    context.setPositions(positions);
+    context.setPeriodicBoxVectors(Vec3(boxSize, 0, 0), Vec3(0, boxSize, 0), Vec3(0, 0, boxSize));
+    context.setVelocitiesToTemperature(300.0);
+    integrator.step(10);
+    State state = context.getState(State::Positions | State::Velocities | State::Forces);
+
+    // Retrieve data for all particles.
+
+    vector<Vec3> pos, vel, force;
+    context.getPositions(pos);
+    context.getVelocities(vel);
+    context.getForces(force);
+    ASSERT_EQUAL(numParticles, pos.size());
+    ASSERT_EQUAL(numParticles, vel.size());
+    ASSERT_EQUAL(numParticles, force.size());
+    for (int i = 0; i < numParticles; i++) {
+        ASSERT_EQUAL_VEC(state.getPositions()[i], pos[i], TOL);
+        ASSERT_EQUAL_VEC(state.getVelocities()[i], vel[i], TOL);
+        ASSERT_EQUAL_VEC(state.getForces()[i], force[i], TOL);
+    }
+
+    // Retrieve data for a subset of particles, reusing the same vectors.
+
+    vector<int> indices = {7, 2, 2, 9};
+    context.getPositions(pos, indices);
+    context.getVelocities(vel, indices);
+    context.getForces(force, indices);
+    ASSERT_EQUAL(indices.size(), pos.size());
+    ASSERT_EQUAL(indices.size(), vel.size());
+    ASSERT_EQUAL(indices.size(), force.size());
+    for (int i = 0; i < indices.size(); i++) {
+        ASSERT_EQUAL_VEC(state.getPositions()[indices[i]], pos[i], TOL);
+        ASSERT_EQUAL_VEC(state.getVelocities()[indices[i]], vel[i], TOL);
+        ASSERT_EQUAL_VEC(state.getForces()[indices[i]], force[i], TOL);
+    }
+
+    // Force groups should be respected.
+
+    context.getForces(force, indices, 1<<0);
+    for (int i = 0; i < indices.size(); i++)
+        ASSERT_EQUAL_VEC(Vec3(), force[i], TOL);
+
+    // Illegal indices should throw an exception.
+
+    bool failed = false;
+    try {
+        context.getPositions(pos, {0, numParticles});
+    }
+    catch (exception& ex) {
+        failed = true;
+    }
+    ASSERT(failed);
+}
+
+void runPlatformTests();
+
+int main(int argc, char* argv[]) {
+    try {
+        initializeTests(argc, argv);
+        testGetParticleData();
+        runPlatformTests();
+    }
+    catch(const exception& e) {
+        cout << "exception: " << e.what() << endl;
+        return 1;
+    }
+    cout << "Done" << endl;
+    return 0;
+}
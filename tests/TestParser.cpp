@@ -37,6 +37,63 @@ class ExampleFunction : public CustomFunction {
     }
 };
 
+/**
+ * This is a custom function that is a different cubic polynomial in every cell of a grid.
+ */
+
+class PiecewiseCubicFunction : public CustomFunction {
+public:
+    PiecewiseCubicFunction(int dimensions, bool periodic) : dimensions(dimensions), periodic(periodic) {
+    }
+    int getNumArguments() const {
+        return dimensions;
+    }
+    double evaluate(const double* arguments) const {
+        int derivOrder[] = {0, 0, 0};
+        return evaluateDerivative(arguments, derivOrder);
+    }
+    double evaluateDerivative(const double* arguments, const int* derivOrder) const {
+        double result = 1.0;
+        for (int i = 0; i < dimensions; i++) {
+            double x = (arguments[i]-min)/(max-min);
+            if (periodic)
+                x -= floor(x);
+            else if (x < 0 || x > 1)
+                return 0.0;
+            double scale = numCells(i)/(max-min);
+            int cell = std::min((int) (x*numCells(i)), numCells(i)-1);
+            double t = x*numCells(i)-cell;
+            double a = cell+1, b = 0.5-cell, c = 0.3*cell, d = 0.2;
+            if (derivOrder[i] == 0)
+                result *= a+t*(b+t*(c+t*d));
+            else if (derivOrder[i] == 1)
+                result *= scale*(b+t*(2*c+t*3*d));
+            else
+                return 0.0;
+        }
+        return result;
+    }
+    CustomFunction* clone() const {
+        return new PiecewiseCubicFunction(dimensions, periodic);
+    }
+    bool getPiecewiseCubicGrid(vector<double>& minValues, vector<double>& maxValues, vector<int>& cells, bool& isPeriodic) const {
+        minValues.assign(dimensions, min);
+        maxValues.assign(dimensions, max);
+        cells.resize(dimensions);
+        for (int i = 0; i < dimensions; i++)
+            cells[i] = numCells(i);
+        isPeriodic = periodic;
+        return true;
+    }
+    static int numCells(int axis) {
+        return 5-axis;
+    }
+    const double min = -1.0, max = 2.0;
+private:
+    int dimensions;
+    bool periodic;
+};
+
 /**
  * Verify that an expression gives the correct value.
  */
@@ -187,6 +244,218 @@ void assertNumbersEqual(double val1, double val2, double tol=1e-10) {
                 ASSERT_EQUAL_TOL(val1, val2, tol);
 }
 
+/**
+ * Verify that a function of x evaluated by CompiledVectorExpression agrees with the scalar
+ * implementation over a range of arguments.
+ */
+
+void verifyVectorFunction(const string& expression, double minValue, double maxValue, bool relative) {
+    ParsedExpression parsed = Parser::parse(expression).optimize();
+    CompiledExpression scalar = parsed.createCompiledExpression();
+    const int numValues = 1024;
+    for (int width : CompiledVectorExpression::getAllowedWidths()) {
+        CompiledVectorExpression vector = parsed.createCompiledVectorExpression(width);
+        float* x = vector.getVariablePointer("x");
+        for (int i = 0; i < numValues; i += width) {
+            for (int j = 0; j < width; j++)
+                x[j] = (float) (minValue + (maxValue-minValue)*(i+j)/(numValues-1));
+            const float* result = vector.evaluate();
+            for (int j = 0; j < width; j++) {
+                scalar.getVariableReference("x") = x[j];
+                double expected = scalar.evaluate();
+                if (relative && expected != 0.0) {
+                    ASSERT_EQUAL_TOL(1.0, result[j]/expected, 2e-6);
+                }
+                else {
+                    ASSERT_EQUAL_TOL(expected, result[j], 2e-6);
+                }
+            }
+        }
+
+        // Check special values.
+
+        float special[] = {0.0f, -1.0f, numeric_limits<float>::infinity(), -numeric_limits<float>::infinity(), 100.0f, -100.0f, 1.0f, 1e-30f};
+        for (int i = 0; i < 8; i++) {
+            for (int j = 0; j < width; j++)
+                x[j] = special[(i+j)%8];
+            const float* result = vector.evaluate();
+            for (int j = 0; j < width; j++) {
+                scalar.getVariableReference("x") = x[j];
+                assertNumbersEqual((float) scalar.evaluate(), result[j], 2e-6);
+            }
+        }
+    }
+}
+
+/**
+ * Verify that identical expressions share cached code, but still evaluate independently.
+ */
+
+void testCompiledExpressionCache() {
+    CompiledExpressionCache::clear();
+    ParsedExpression parsed = Parser::parse("x*exp(y)+2").optimize();
+    CompiledExpression compiled1 = parsed.createCompiledExpression();
+    CompiledExpression compiled2 = parsed.createCompiledExpression();
+    CompiledExpression compiled3 = Parser::parse("x*exp(y)+3").optimize().createCompiledExpression();
+    compiled1.getVariableReference("x") = 1.0;
+    compiled1.getVariableReference("y") = 0.5;
+    compiled2.getVariableReference("x") = 2.0;
+    compiled2.getVariableReference("y") = 1.5;
+    compiled3.getVariableReference("x") = 1.0;
+    compiled3.getVariableReference("y") = 0.5;
+    ASSERT_EQUAL_TOL(1.0*exp(0.5)+2, compiled1.evaluate(), 1e-10);
+    ASSERT_EQUAL_TOL(2.0*exp(1.5)+2, compiled2.evaluate(), 1e-10);
+    ASSERT_EQUAL_TOL(1.0*exp(0.5)+3, compiled3.evaluate(), 1e-10);
+
+    // Copying an expression or changing its variable locations should reuse the code.
+
+    CompiledExpression compiled4 = compiled2;
+    compiled4.getVariableReference("x") = 0.5;
+    compiled4.getVariableReference("y") = 2.0;
+    ASSERT_EQUAL_TOL(0.5*exp(2.0)+2, compiled4.evaluate(), 1e-10);
+    double x = 3.0, y = -1.0;
+    map<string, double*> variablePointers;
+    variablePointers["x"] = &x;
+    variablePointers["y"] = &y;
+    compiled4.setVariableLocations(variablePointers);
+    ASSERT_EQUAL_TOL(3.0*exp(-1.0)+2, compiled4.evaluate(), 1e-10);
+    ASSERT_EQUAL_TOL(2.0*exp(1.5)+2, compiled2.evaluate(), 1e-10);
+
+    // Vector expressions of each width are cached separately.
+
+    vector<int> widths = CompiledVectorExpression::getAllowedWidths();
+    for (int width : widths) {
+        CompiledVectorExpression vector1 = parsed.createCompiledVectorExpression(width);
+        CompiledVectorExpression vector2 = vector1;
+        for (int i = 0; i < width; i++) {
+            vector1.getVariablePointer("x")[i] = i;
+            vector1.getVariablePointer("y")[i] = 0.5;
+            vector2.getVariablePointer("x")[i] = 1.0;
+            vector2.getVariablePointer("y")[i] = 0.1*i;
+        }
+        const float* result1 = vector1.evaluate();
+        for (int i = 0; i < width; i++)
+            ASSERT_EQUAL_TOL(i*exp(0.5)+2, result1[i], 1e-6);
+        const float* result2 = vector2.evaluate();
+        for (int i = 0; i < width; i++)
+            ASSERT_EQUAL_TOL(exp(0.1*i)+2, result2[i], 1e-6);
+    }
+#ifdef LEPTON_USE_JIT
+    ASSERT_EQUAL(2+widths.size(), CompiledExpressionCache::getNumMisses());
+    ASSERT_EQUAL(3+widths.size(), CompiledExpressionCache::getNumHits());
+
+    // Code is released once no expression uses it, so compiling the expression again is a miss.
+
+    CompiledExpressionCache::clear();
+    {
+        CompiledExpression compiled5 = Parser::parse("x*sin(y)").optimize().createCompiledExpression();
+        CompiledExpression compiled6 = Parser::parse("x*sin(y)").optimize().createCompiledExpression();
+    }
+    CompiledExpression compiled7 = Parser::parse("x*sin(y)").optimize().createCompiledExpression();
+    compiled7.getVariableReference("x") = 2.0;
+    compiled7.getVariableReference("y") = 0.5;
+    ASSERT_EQUAL_TOL(2.0*sin(0.5), compiled7.evaluate(), 1e-10);
+    ASSERT_EQUAL(2, CompiledExpressionCache::getNumMisses());
+    ASSERT_EQUAL(1, CompiledExpressionCache::getNumHits());
+#endif
+}
+
+/**
+ * Verify that a set of expressions compiled together give the same results as compiling each one separately.
+ */
+
+void testExpressionSet() {
+    ParsedExpression energy = Parser::parse("a*exp(-k*r)/r^6+step(r-1)*r^2").optimize();
+    vector<ParsedExpression> parsed;
+    parsed.push_back(energy);
+    parsed.push_back(energy.differentiate("r").optimize());
+    parsed.push_back(energy.differentiate("k").optimize());
+    parsed.push_back(Parser::parse("r^2").optimize()); // Also appears in the first expression
+    parsed.push_back(Parser::parse("a").optimize());
+    parsed.push_back(Parser::parse("1.5").optimize());
+    CompiledExpression compiled(parsed);
+    ASSERT_EQUAL(parsed.size(), compiled.getNumResults());
+    double r = 0.0, results[6];
+    map<string, double*> variablePointers;
+    variablePointers["r"] = &r;
+    compiled.setVariableLocations(variablePointers);
+    compiled.getVariableReference("a") = 2.0;
+    compiled.getVariableReference("k") = 0.3;
+    for (r = 0.5; r < 2.0; r += 0.25) {
+        compiled.evaluate(results);
+        map<string, double> variables;
+        variables["r"] = r;
+        variables["a"] = 2.0;
+        variables["k"] = 0.3;
+        for (int i = 0; i < parsed.size(); i++)
+            ASSERT_EQUAL_TOL(parsed[i].evaluate(variables), results[i], 1e-10);
+        ASSERT_EQUAL_TOL(parsed[0].evaluate(variables), compiled.evaluate(), 1e-10);
+    }
+
+    // Try the same thing with vector expressions.
+
+    for (int width : CompiledVectorExpression::getAllowedWidths()) {
+        CompiledVectorExpression vectorCompiled(parsed, width);
+        ASSERT_EQUAL(parsed.size(), vectorCompiled.getNumResults());
+        for (int i = 0; i < width; i++) {
+            vectorCompiled.getVariablePointer("r")[i] = 0.5+0.2*i;
+            vectorCompiled.getVariablePointer("a")[i] = 2.0;
+            vectorCompiled.getVariablePointer("k")[i] = 0.3;
+        }
+        const float* vectorResults = vectorCompiled.evaluate();
+        for (int i = 0; i < width; i++) {
+            map<string, double> variables;
+            variables["r"] = 0.5+0.2*i;
+            variables["a"] = 2.0;
+            variables["k"] = 0.3;
+            for (int j = 0; j < parsed.size(); j++)
+                ASSERT_EQUAL_TOL(parsed[j].evaluate(variables), vectorResults[j*width+i], 1e-5);
+        }
+    }
+}
+
+/**
+ * Verify that vector expressions evaluate piecewise cubic functions and their derivatives correctly.
+ */
+
+void testPiecewiseCubicFunction(int dimensions, bool periodic) {
+    PiecewiseCubicFunction function(dimensions, periodic);
+    map<string, CustomFunction*> functions;
+    functions["f"] = &function;
+    vector<string> names = {"x", "y", "z"};
+    string expression = "2*f(";
+    for (int i = 0; i < dimensions; i++)
+        expression += (i == 0 ? "" : ",")+names[i];
+    expression += ")+x";
+    vector<ParsedExpression> parsed;
+    parsed.push_back(Parser::parse(expression, functions).optimize());
+    for (int i = 0; i < dimensions; i++)
+        parsed.push_back(parsed[0].differentiate(names[i]).optimize());
+    for (int width : CompiledVectorExpression::getAllowedWidths()) {
+        CompiledVectorExpression compiled(parsed, width);
+        for (int trial = 0; trial < 20; trial++) {
+            // Put each point inside a cell, not on a boundary, and sometimes outside the grid.
+
+            vector<map<string, double> > variables(width);
+            for (int i = 0; i < width; i++)
+                for (int j = 0; j < dimensions; j++) {
+                    int n = PiecewiseCubicFunction::numCells(j);
+                    int cell = (7*trial+3*i+5*j)%(n+4)-2;
+                    double fraction = 0.05+0.9*((11*trial+7*i+3*j)%13)/12.0;
+                    double value = function.min+(cell+fraction)*(function.max-function.min)/n;
+                    variables[i][names[j]] = value;
+                    compiled.getVariablePointer(names[j])[i] = value;
+                }
+            const float* results = compiled.evaluate();
+            for (int i = 0; i < width; i++)
+                for (int j = 0; j < parsed.size(); j++) {
+                    double expected = parsed[j].evaluate(variables[i]);
+                    ASSERT_EQUAL_TOL(expected, results[j*width+i], 1e-4);
+                }
+        }
+    }
+}
+
 /**
  * Verify that two expressions give the same value.
  */
@@ -368,6 +637,24 @@ int main() {
         verifyDerivative("abs(3*x)", "step(3*x)*3+(1-step(3*x))*-3");
         verifyDerivative("floor(x)+0.5*x*ceil(x)", "0.5*ceil(x)");
         verifyDerivative("select(x, x^2, 3*x)", "select(x, 2*x, 3)");
+        verifyVectorFunction("exp(x)", -87.0, 88.0, true);
+        verifyVectorFunction("exp(-x^2)", -5.0, 5.0, true);
+        verifyVectorFunction("log(x)", 1e-30, 1e30, false);
+        verifyVectorFunction("log(x)", 0.1, 10.0, false);
+        verifyVectorFunction("sin(x)", -100.0, 100.0, false);
+        verifyVectorFunction("cos(x)", -100.0, 100.0, false);
+        verifyVectorFunction("erf(x)", -5.0, 5.0, true);
+        verifyVectorFunction("erf(x)", -0.01, 0.01, true);
+        verifyVectorFunction("erfc(x)", -3.0, 3.0, true);
+        verifyVectorFunction("erfc(2*x)", 0.0, 5.0, false);
+        verifyVectorFunction("x^1.7", 0.0, 50.0, true);
+        verifyVectorFunction("x^-0.35", 1e-3, 1e3, true);
+        testCompiledExpressionCache();
+        testExpressionSet();
+        for (int dimensions = 1; dimensions < 4; dimensions++) {
+            testPiecewiseCubicFunction(dimensions, false);
+            testPiecewiseCubicFunction(dimensions, true);
+        }
         testCustomFunction("custom(x, y)/2", "x*y");
         testCustomFunction("custom(x^2, 1)+custom(2, y-1)", "2*x^2+4*(y-1)");
         cout << Parser::parse("x*x").optimize() << endl;
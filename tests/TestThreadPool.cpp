@@ -0,0 +1,271 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "openmm/internal/AssertionUtilities.h"
+#include "openmm/internal/ThreadPool.h"
+#include "openmm/OpenMMException.h"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace OpenMM;
+using namespace std;
+
+void testParallelFor() {
+    // Every index should be processed exactly once, in chunks no larger than requested.
+
+    ThreadPool threads(4);
+    for (int numItems : {0, 1, 7, 1000}) {
+        vector<atomic<int> > counts(numItems);
+        for (auto& count : counts)
+            count = 0;
+        atomic<bool> chunkTooLarge(false);
+        threads.parallelFor(numItems, 10, [&] (ThreadPool& threads, int threadIndex, int start, int end) {
+            ASSERT(threadIndex >= 0 && threadIndex < threads.getNumThreads());
+            if (end-start > 10)
+                chunkTooLarge = true;
+            for (int i = start; i < end; i++)
+                counts[i]++;
+        });
+        ASSERT(!chunkTooLarge);
+        for (auto& count : counts)
+            ASSERT_EQUAL(1, count);
+    }
+}
+
+void testDependencies() {
+    // Build a chain of tasks, each of which records the order it ran in.  Add them in reverse
+    // order, so they can only run correctly if the dependencies are respected.
+
+    ThreadPool threads(4);
+    const int numTasks = 20;
+    vector<int> order(numTasks, -1);
+    atomic<int> counter(0);
+    vector<ThreadPool::TaskHandle> handles(numTasks);
+    for (int i = numTasks-1; i >= 0; i--) {
+        vector<ThreadPool::TaskHandle> dependencies;
+        if (i < numTasks-1)
+            dependencies.push_back(handles[i+1]);
+        handles[i] = threads.addTask([&, i] (ThreadPool& threads, int threadIndex) {
+            order[i] = counter++;
+        }, dependencies);
+    }
+    threads.executeTasks();
+    for (int i = 0; i < numTasks; i++)
+        ASSERT_EQUAL(numTasks-1-i, order[i]);
+
+    // A task that depends on one which has already finished should still run.
+
+    bool ran = false;
+    threads.addTask([&] (ThreadPool& threads, int threadIndex) {
+        ran = true;
+    }, {handles[0]});
+    threads.executeTasks();
+    ASSERT(ran);
+}
+
+void testNestedTasks() {
+    // Tasks add other tasks and wait for them, and call parallelFor() from inside a task.
+
+    ThreadPool threads(3);
+    atomic<int> sum(0);
+    for (int i = 0; i < 10; i++) {
+        threads.addTask([&, i] (ThreadPool& threads, int threadIndex) {
+            ThreadPool::TaskHandle child = threads.addTask([&, i] (ThreadPool& threads, int threadIndex) {
+                sum += i;
+            });
+            threads.parallelFor(100, 7, [&] (ThreadPool& threads, int threadIndex, int start, int end) {
+                sum += end-start;
+            });
+            threads.waitForTask(child);
+        });
+    }
+    threads.executeTasks();
+    ASSERT_EQUAL(45+10*100, sum);
+
+    // The older fork/join interface should still work after using tasks.
+
+    vector<int> visited(threads.getNumThreads(), 0);
+    threads.execute([&] (ThreadPool& threads, int threadIndex) {
+        visited[threadIndex]++;
+    });
+    threads.waitForThreads();
+    for (int count : visited)
+        ASSERT_EQUAL(1, count);
+}
+
+void testBackgroundTasks() {
+    // Start tasks in the background, add more while they are running, and make sure they all
+    // finish before executeTasks() or execute() returns.
+
+    ThreadPool threads(3);
+    for (int iteration = 0; iteration < 20; iteration++) {
+        atomic<int> count(0);
+        ThreadPool::TaskHandle previous;
+        for (int i = 0; i < 5; i++) {
+            vector<ThreadPool::TaskHandle> dependencies;
+            if (previous)
+                dependencies.push_back(previous);
+            previous = threads.addTask([&] (ThreadPool& threads, int threadIndex) { count++; }, dependencies);
+            threads.startTasks();
+        }
+        if (iteration%2 == 0)
+            threads.executeTasks();
+        else {
+            threads.execute([&] (ThreadPool& threads, int threadIndex) {});
+            threads.waitForThreads();
+            threads.executeTasks();
+        }
+        ASSERT_EQUAL(5, count);
+    }
+}
+
+void testStartTasksWithoutWaiting() {
+    // Repeatedly add a task just as the threads are stopping.  startTasks() must make sure it
+    // gets run even though nobody calls executeTasks().
+
+    ThreadPool threads(3);
+    for (int iteration = 0; iteration < 1000; iteration++) {
+        atomic<bool> done(false);
+        threads.addTask([&] (ThreadPool& threads, int threadIndex) { done = true; });
+        threads.startTasks();
+        auto start = chrono::steady_clock::now();
+        while (!done) {
+            if (chrono::steady_clock::now()-start > chrono::seconds(10))
+                throw OpenMMException("Task was never run");
+            this_thread::yield();
+        }
+    }
+    threads.executeTasks();
+}
+
+void assertThrows(function<void ()> f) {
+    try {
+        f();
+    }
+    catch (const OpenMMException& e) {
+        return;
+    }
+    throw OpenMMException("Expected an exception");
+}
+
+void testExceptions() {
+    // An exception thrown by a task should be rethrown on the parent thread, and the pool should
+    // still work afterward.
+
+    ThreadPool threads(3);
+    for (int iteration = 0; iteration < 10; iteration++) {
+        atomic<int> count(0);
+        for (int i = 0; i < 20; i++)
+            threads.addTask([&, i] (ThreadPool& threads, int threadIndex) {
+                count++;
+                if (i == 7)
+                    throw OpenMMException("task failed");
+            });
+        bool thrown = false;
+        try {
+            threads.executeTasks();
+        }
+        catch (const OpenMMException& e) {
+            ASSERT_EQUAL(string("task failed"), string(e.what()));
+            thrown = true;
+        }
+        ASSERT(thrown);
+        ASSERT_EQUAL(20, count);
+    }
+
+    // Exceptions from inside a nested parallelFor() should not make the waiting task hang.
+
+    threads.addTask([&] (ThreadPool& threads, int threadIndex) {
+        threads.parallelFor(100, 5, [&] (ThreadPool& threads, int threadIndex, int start, int end) {
+            if (start == 0)
+                throw OpenMMException("range failed");
+        });
+    });
+    assertThrows([&] () { threads.executeTasks(); });
+
+    // The same applies to the fork/join interface.
+
+    threads.execute([&] (ThreadPool& threads, int threadIndex) {
+        if (threadIndex == 1)
+            throw OpenMMException("thread failed");
+    });
+    assertThrows([&] () { threads.waitForThreads(); });
+    atomic<int> sum(0);
+    threads.parallelFor(50, 3, [&] (ThreadPool& threads, int threadIndex, int start, int end) {
+        sum += end-start;
+    });
+    ASSERT_EQUAL(50, sum);
+}
+
+void testIdleThreadsWake() {
+    // Keep the other threads idle long enough that they go to sleep, then give them work.  They
+    // must wake up to run it, since the task that added it waits for it to finish.
+
+    ThreadPool threads(4);
+    for (int iteration = 0; iteration < 5; iteration++) {
+        atomic<int> count(0);
+        threads.addTask([&] (ThreadPool& threads, int threadIndex) {
+            this_thread::sleep_for(chrono::milliseconds(50));
+            vector<ThreadPool::TaskHandle> children;
+            for (int i = 0; i < 8; i++)
+                children.push_back(threads.addTask([&] (ThreadPool& threads, int threadIndex) {
+                    this_thread::sleep_for(chrono::milliseconds(5));
+                    count++;
+                }));
+            for (auto& child : children)
+                threads.waitForTask(child);
+        });
+        threads.executeTasks();
+        ASSERT_EQUAL(8, count);
+    }
+}
+
+int main() {
+    try {
+        testParallelFor();
+        testDependencies();
+        testNestedTasks();
+        testBackgroundTasks();
+        testStartTasksWithoutWaiting();
+        testExceptions();
+        testIdleThreadsWake();
+    }
+    catch(const exception& e) {
+        cout << "exception: " << e.what() << endl;
+        return 1;
+    }
+    cout << "Done" << endl;
+    return 0;
+}
@@ -0,0 +1,316 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2008-2015 Stanford University and the Authors.      *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "openmm/internal/AssertionUtilities.h"
+#include "openmm/Context.h"
+#include "openmm/CustomIntegrator.h"
+#include "openmm/NonbondedForce.h"
+#include "openmm/Platform.h"
+#include "openmm/System.h"
+#include "openmm/TrajectoryWriter.h"
+#include "openmm/VerletIntegrator.h"
+#include "sfmt/SFMT.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+using namespace OpenMM;
+using namespace std;
+
+const int numParticles = 20;
+const double boxSize = 3.0;
+
+System* createSystem(vector<Vec3>& positions) {
+    System* system = new System();
+    system->setDefaultPeriodicBoxVectors(Vec3(boxSize, 0, 0), Vec3(0, boxSize, 0), Vec3(0, 0, boxSize));
+    NonbondedForce* nonbonded = new NonbondedForce();
+    system->addForce(nonbonded);
+    nonbonded->setNonbondedMethod(NonbondedForce::CutoffPeriodic);
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    positions.resize(numParticles);
+    for (int i = 0; i < numParticles; i++) {
+        system->addParticle(1.0);
+        nonbonded->addParticle(i%2 == 0 ? 0.1 : -0.1, 0.2, 0.1);
+        positions[i] = Vec3(boxSize*genrand_real2(sfmt), boxSize*genrand_real2(sfmt), boxSize*genrand_real2(sfmt));
+    }
+    return system;
+}
+
+/**
+ * Simulate the system without a TrajectoryWriter and record the positions every interval steps.
+ */
+vector<vector<Vec3> > computeExpectedFrames(System& system, const vector<Vec3>& positions, int interval, int numFrames) {
+    VerletIntegrator integrator(0.001);
+    Context context(system, integrator, Platform::getPlatform("Reference"));
+    context.setPositions(positions);
+    context.setVelocitiesToTemperature(300.0, 1);
+    vector<vector<Vec3> > frames;
+    for (int i = 0; i < numFrames; i++) {
+        integrator.step(interval);
+        frames.push_back(context.getState(State::Positions).getPositions());
+    }
+    return frames;
+}
+
+string readFile(const string& filename) {
+    ifstream file(filename.c_str(), ios::binary);
+    return string((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+}
+
+uint32_t readBits(const string& data, size_t offset, bool bigEndian) {
+    uint32_t bits = 0;
+    for (int i = 0; i < 4; i++) {
+        uint32_t byte = (unsigned char) data[offset+(bigEndian ? i : 3-i)];
+        bits = (bits<<8) | byte;
+    }
+    return bits;
+}
+
+int readInt(const string& data, size_t offset, bool bigEndian=false) {
+    return (int) readBits(data, offset, bigEndian);
+}
+
+float readFloat(const string& data, size_t offset, bool bigEndian=false) {
+    uint32_t bits = readBits(data, offset, bigEndian);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+double readDouble(const string& data, size_t offset) {
+    uint64_t bits = ((uint64_t) readBits(data, offset+4, false)<<32) | readBits(data, offset, false);
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+void testDcd() {
+    vector<Vec3> positions;
+    System* system = createSystem(positions);
+    const int interval = 5;
+    const int numFrames = 10;
+    vector<vector<Vec3> > expected = computeExpectedFrames(*system, positions, interval, numFrames);
+    string filename = "TestTrajectoryWriter.dcd";
+    VerletIntegrator integrator(0.001);
+    Context context(*system, integrator, Platform::getPlatform("Reference"));
+    context.setPositions(positions);
+    context.setVelocitiesToTemperature(300.0, 1);
+    TrajectoryWriter writer(context, filename, TrajectoryWriter::DCD, interval, vector<int>(), 3);
+    ASSERT_EQUAL(TrajectoryWriter::DCD, writer.getFormat());
+    ASSERT_EQUAL(interval, writer.getInterval());
+    integrator.step(interval*numFrames);
+    writer.flush();
+    ASSERT_EQUAL(numFrames, writer.getNumFrames());
+
+    // Check the header.
+
+    string data = readFile(filename);
+    ASSERT_EQUAL(84, readInt(data, 0));
+    ASSERT_EQUAL("CORD", data.substr(4, 4));
+    ASSERT_EQUAL(numFrames, readInt(data, 8));
+    ASSERT_EQUAL(0, readInt(data, 12));
+    ASSERT_EQUAL(interval, readInt(data, 16));
+    ASSERT_EQUAL(interval*numFrames, readInt(data, 20));
+    ASSERT_EQUAL_TOL(0.001/0.04888821, readFloat(data, 44), 1e-6);
+    ASSERT_EQUAL(1, readInt(data, 48));
+    ASSERT_EQUAL(numParticles, readInt(data, 268));
+
+    // Check the frames.
+
+    size_t frameSize = 56+3*(4*numParticles+8);
+    ASSERT_EQUAL(276+numFrames*frameSize, data.size());
+    for (int frame = 0; frame < numFrames; frame++) {
+        size_t offset = 276+frame*frameSize;
+        ASSERT_EQUAL(48, readInt(data, offset));
+        ASSERT_EQUAL_TOL(10*boxSize, readDouble(data, offset+4), 1e-10);
+        ASSERT_EQUAL_TOL(0.0, readDouble(data, offset+12), 1e-10);
+        ASSERT_EQUAL_TOL(10*boxSize, readDouble(data, offset+20), 1e-10);
+        ASSERT_EQUAL_TOL(10*boxSize, readDouble(data, offset+44), 1e-10);
+        offset += 56;
+        for (int j = 0; j < 3; j++) {
+            ASSERT_EQUAL(4*numParticles, readInt(data, offset));
+            for (int i = 0; i < numParticles; i++)
+                ASSERT_EQUAL_TOL(10*expected[frame][i][j], readFloat(data, offset+4+4*i), 1e-6);
+            offset += 4*numParticles+8;
+        }
+    }
+    remove(filename.c_str());
+    delete system;
+}
+
+void testXtcSubset() {
+    vector<Vec3> positions;
+    System* system = createSystem(positions);
+    const int interval = 4;
+    const int numFrames = 5;
+    vector<int> particles = {3, 1, 7, 4};
+    vector<vector<Vec3> > expected = computeExpectedFrames(*system, positions, interval, numFrames);
+    string filename = "TestTrajectoryWriter.xtc";
+    {
+        VerletIntegrator integrator(0.001);
+        Context context(*system, integrator, Platform::getPlatform("Reference"));
+        context.setPositions(positions);
+        context.setVelocitiesToTemperature(300.0, 1);
+        TrajectoryWriter writer(context, filename, TrajectoryWriter::XTC, interval, particles);
+        integrator.step(interval*numFrames);
+
+        // The destructor should capture the final frame.
+    }
+
+    // XTC files are big endian.  Frames with up to 9 particles are stored uncompressed.
+
+    string data = readFile(filename);
+    int numSelected = particles.size();
+    size_t frameSize = 4*(14+3*numSelected);
+    ASSERT_EQUAL(numFrames*frameSize, data.size());
+    for (int frame = 0; frame < numFrames; frame++) {
+        size_t offset = frame*frameSize;
+        ASSERT_EQUAL(1995, readInt(data, offset, true));
+        ASSERT_EQUAL(numSelected, readInt(data, offset+4, true));
+        ASSERT_EQUAL(interval*(frame+1), readInt(data, offset+8, true));
+        ASSERT_EQUAL_TOL(0.001*interval*(frame+1), readFloat(data, offset+12, true), 1e-6);
+        for (int i = 0; i < 3; i++)
+            for (int j = 0; j < 3; j++)
+                ASSERT_EQUAL_TOL(i == j ? boxSize : 0.0, readFloat(data, offset+16+4*(3*i+j), true), 1e-6);
+        ASSERT_EQUAL(numSelected, readInt(data, offset+52, true));
+        for (int i = 0; i < numSelected; i++)
+            for (int j = 0; j < 3; j++)
+                ASSERT_EQUAL_TOL(expected[frame][particles[i]][j], readFloat(data, offset+56+4*(3*i+j), true), 1e-6);
+    }
+    remove(filename.c_str());
+    delete system;
+}
+
+void testCustomIntegrator() {
+    // This integrator has no UpdateContextState step, so it must notify the writer separately.
+
+    vector<Vec3> positions;
+    System* system = createSystem(positions);
+    const int interval = 5;
+    const int numFrames = 4;
+    vector<vector<Vec3> > expected = computeExpectedFrames(*system, positions, interval, numFrames);
+    string filename = "TestTrajectoryWriterCustom.dcd";
+    CustomIntegrator integrator(0.001);
+    integrator.addComputePerDof("v", "v+dt*f/m");
+    integrator.addComputePerDof("x", "x+dt*v");
+    Context context(*system, integrator, Platform::getPlatform("Reference"));
+    context.setPositions(positions);
+    context.setVelocitiesToTemperature(300.0, 1);
+    TrajectoryWriter writer(context, filename, TrajectoryWriter::DCD, interval);
+    integrator.step(interval*numFrames);
+    writer.flush();
+    ASSERT_EQUAL(numFrames, writer.getNumFrames());
+    string data = readFile(filename);
+    ASSERT_EQUAL(numFrames, readInt(data, 8));
+    size_t frameSize = 56+3*(4*numParticles+8);
+    ASSERT_EQUAL(276+numFrames*frameSize, data.size());
+    size_t offset = 276+(numFrames-1)*frameSize+56;
+    for (int i = 0; i < numParticles; i++)
+        ASSERT_EQUAL_TOL(10*expected[numFrames-1][i][0], readFloat(data, offset+4+4*i), 1e-4);
+    remove(filename.c_str());
+    delete system;
+}
+
+void testLargeStepCount() {
+    // Step numbers beyond the range of a 32 bit integer should be rescaled in the DCD header.
+
+    vector<Vec3> positions;
+    System* system = createSystem(positions);
+    const int interval = 10;
+    const int numFrames = 3;
+    const long long firstStep = interval*500000000LL;
+    string filename = "TestTrajectoryWriterLarge.dcd";
+    VerletIntegrator integrator(0.001);
+    Context context(*system, integrator, Platform::getPlatform("Reference"));
+    context.setPositions(positions);
+    context.setStepCount(firstStep);
+    TrajectoryWriter writer(context, filename, TrajectoryWriter::DCD, interval);
+    integrator.step(interval*numFrames);
+    writer.flush();
+    ASSERT_EQUAL(numFrames, writer.getNumFrames());
+    string data = readFile(filename);
+    ASSERT_EQUAL(numFrames, readInt(data, 8));
+    ASSERT_EQUAL(firstStep/interval, readInt(data, 12));
+    ASSERT_EQUAL(1, readInt(data, 16));
+    ASSERT_EQUAL(firstStep/interval+numFrames, readInt(data, 20));
+    ASSERT_EQUAL_TOL(interval*0.001/0.04888821, readFloat(data, 44), 1e-6);
+    remove(filename.c_str());
+    delete system;
+}
+
+void testErrors() {
+    vector<Vec3> positions;
+    System* system = createSystem(positions);
+    VerletIntegrator integrator(0.001);
+    Context context(*system, integrator, Platform::getPlatform("Reference"));
+    int failures = 0;
+    try {
+        TrajectoryWriter writer(context, "TestTrajectoryWriter.dcd", TrajectoryWriter::DCD, 0);
+    }
+    catch (exception& ex) {
+        failures++;
+    }
+    try {
+        TrajectoryWriter writer(context, "TestTrajectoryWriter.dcd", TrajectoryWriter::DCD, 10, {0, numParticles});
+    }
+    catch (exception& ex) {
+        failures++;
+    }
+    try {
+        TrajectoryWriter writer(context, "no/such/directory/trajectory.xtc", TrajectoryWriter::XTC, 10);
+    }
+    catch (exception& ex) {
+        failures++;
+    }
+    ASSERT_EQUAL(3, failures);
+    delete system;
+}
+
+int main() {
+    try {
+        testDcd();
+        testXtcSubset();
+        testCustomIntegrator();
+        testLargeStepCount();
+        testErrors();
+    }
+    catch(const exception& e) {
+        cout << "exception: " << e.what() << endl;
+        return 1;
+    }
+    cout << "Done" << endl;
+    return 0;
+}
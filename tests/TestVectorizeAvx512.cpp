@@ -0,0 +1,93 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Daniel Towner                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+/**
+ * This tests vectorized operations.
+ */
+
+#include "openmm/internal/AssertionUtilities.h"
+
+#include <iostream>
+
+#ifndef __AVX512F__
+int main () {
+    std::cout << "AVX-512 CPU is not supported. Exiting." << std::endl;
+    return 0;
+}
+#else
+
+#include "openmm/internal/hardware.h"
+#include "openmm/internal/vectorizeAvx512.h"
+#include "TestVectorizeGeneric.h"
+
+using namespace OpenMM;
+
+/**
+ * Comparisons produce opmasks rather than vectors, so check that masks can be combined
+ * and tested the way the nonbonded kernels use them.
+ */
+void testMasks() {
+    float values[16];
+    for (int i = 0; i < 16; i++)
+        values[i] = (float) i;
+    const fvec16 v(values);
+    const fvec16 zero = {};
+    const auto exclusions = fvec16::expandBitsToMask(0b0101010101010101);
+    const auto include = blendZero(v < 8.0f, exclusions);
+    ASSERT(any(include));
+    ASSERT(!any(blendZero(v > 20.0f, exclusions)));
+    float expected[16];
+    for (int i = 0; i < 16; i++)
+        expected[i] = (i < 8 && i%2 == 0 ? values[i] : 0.0f);
+    ASSERT_VEC_EQUAL(blendZero(v, include), expected);
+    ASSERT(any(ivec16(v)));
+    ASSERT(!any(ivec16(zero)));
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        if (!isAvx512Supported()) {
+            std::cout << "CPU is not supported. Exiting." << std::endl;
+            return 0;
+        }
+
+        TestFvec<fvec16>::testAll();
+        testMasks();
+    }
+    catch(const std::exception& e) {
+        std::cout << "exception: " << e.what() << std::endl;
+        return 1;
+    }
+    std::cout << "Done" << std::endl;
+    return 0;
+}
+
+#endif
\ No newline at end of file
@@ -65,10 +65,13 @@ class WrapperGenerator:
     """This is the parent class of generators for various API wrapper files.  It defines functions common to all of them."""
     
     def __init__(self, inputDirname, output):
-        self.skipClasses = ['OpenMM::Vec3', 'OpenMM::XmlSerializer', 'OpenMM::Kernel', 'OpenMM::KernelImpl', 'OpenMM::KernelFactory', 'OpenMM::ContextImpl', 'OpenMM::SerializationNode', 'OpenMM::SerializationProxy']
+        self.skipClasses = ['OpenMM::Vec3', 'OpenMM::XmlSerializer', 'OpenMM::Kernel', 'OpenMM::KernelImpl', 'OpenMM::KernelFactory', 'OpenMM::ContextImpl', 'OpenMM::CheckpointWriter', 'OpenMM::SerializationNode', 'OpenMM::SerializationProxy']
         self.skipMethods = ['State OpenMM::Context::getState',
                             'void OpenMM::Context::createCheckpoint',
                             'void OpenMM::Context::loadCheckpoint',
+                            'void OpenMM::Context::getPositions',
+                            'void OpenMM::Context::getVelocities',
+                            'void OpenMM::Context::getForces',
                             'const std::vector<std::vector<int> >& OpenMM::Context::getMolecules',
                             'static std::vector<std::string> OpenMM::Platform::getPluginLoadFailures',
                             'static std::vector<std::string> OpenMM::Platform::loadPluginsFromDirectory',
@@ -146,6 +149,8 @@ class WrapperGenerator:
                 methodDefinition = getText("definition", memberNode)
                 if methodDefinition.replace(' ', '') in self.skipMethods:
                     continue
+                if getText("argsstring", memberNode).replace(' ', '').endswith('=delete'):
+                    continue
                 methodList.append(memberNode)
         return methodList
     
@@ -429,6 +434,10 @@ extern OPENMM_EXPORT void %(name)s_insert(%(name)s* set, %(type)s value);""" % v
    Unlike the C++ versions, the return value is allocated on the heap, and you must delete it yourself. */
 extern OPENMM_EXPORT OpenMM_State* OpenMM_Context_getState(const OpenMM_Context* target, int types, int enforcePeriodicBox);
 extern OPENMM_EXPORT OpenMM_State* OpenMM_Context_getState_2(const OpenMM_Context* target, int types, int enforcePeriodicBox, int groups);
+/* The particle subset getters fill in an array you provide.  Pass NULL for indices to retrieve every particle. */
+extern OPENMM_EXPORT void OpenMM_Context_getPositions(const OpenMM_Context* target, OpenMM_Vec3Array* positions, const OpenMM_IntArray* indices);
+extern OPENMM_EXPORT void OpenMM_Context_getVelocities(const OpenMM_Context* target, OpenMM_Vec3Array* velocities, const OpenMM_IntArray* indices);
+extern OPENMM_EXPORT void OpenMM_Context_getForces(const OpenMM_Context* target, OpenMM_Vec3Array* forces, const OpenMM_IntArray* indices, int groups);
 extern OPENMM_EXPORT OpenMM_StringArray* OpenMM_Platform_loadPluginsFromDirectory(const char* directory);
 extern OPENMM_EXPORT OpenMM_StringArray* OpenMM_Platform_getPluginLoadFailures();
 extern OPENMM_EXPORT char* OpenMM_XmlSerializer_serializeSystem(const OpenMM_System* system);
@@ -845,6 +854,19 @@ OPENMM_EXPORT OpenMM_State* OpenMM_Context_getState_2(const OpenMM_Context* targ
     State result = reinterpret_cast<const Context*>(target)->getState(types, enforcePeriodicBox, groups);
     return reinterpret_cast<OpenMM_State*>(new State(result));
 }
+static const vector<int>& getParticleIndices(const OpenMM_IntArray* indices) {
+    static const vector<int> allParticles;
+    return (indices == NULL ? allParticles : *reinterpret_cast<const vector<int>*>(indices));
+}
+OPENMM_EXPORT void OpenMM_Context_getPositions(const OpenMM_Context* target, OpenMM_Vec3Array* positions, const OpenMM_IntArray* indices) {
+    reinterpret_cast<const Context*>(target)->getPositions(*reinterpret_cast<vector<Vec3>*>(positions), getParticleIndices(indices));
+}
+OPENMM_EXPORT void OpenMM_Context_getVelocities(const OpenMM_Context* target, OpenMM_Vec3Array* velocities, const OpenMM_IntArray* indices) {
+    reinterpret_cast<const Context*>(target)->getVelocities(*reinterpret_cast<vector<Vec3>*>(velocities), getParticleIndices(indices));
+}
+OPENMM_EXPORT void OpenMM_Context_getForces(const OpenMM_Context* target, OpenMM_Vec3Array* forces, const OpenMM_IntArray* indices, int groups) {
+    reinterpret_cast<const Context*>(target)->getForces(*reinterpret_cast<vector<Vec3>*>(forces), getParticleIndices(indices), groups);
+}
 OPENMM_EXPORT OpenMM_StringArray* OpenMM_Platform_loadPluginsFromDirectory(const char* directory) {
     vector<string> result = Platform::loadPluginsFromDirectory(string(directory));
     return reinterpret_cast<OpenMM_StringArray*>(new vector<string>(result));
@@ -1379,6 +1401,25 @@ MODULE OpenMM
             integer*4 groups
             type(OpenMM_State) result
         end subroutine
+        subroutine OpenMM_Context_getPositions(target, positions, indices)
+            use OpenMM_Types; implicit none
+            type (OpenMM_Context) target
+            type (OpenMM_Vec3Array) positions
+            type (OpenMM_IntArray) indices
+        end subroutine
+        subroutine OpenMM_Context_getVelocities(target, velocities, indices)
+            use OpenMM_Types; implicit none
+            type (OpenMM_Context) target
+            type (OpenMM_Vec3Array) velocities
+            type (OpenMM_IntArray) indices
+        end subroutine
+        subroutine OpenMM_Context_getForces(target, forces, indices, groups)
+            use OpenMM_Types; implicit none
+            type (OpenMM_Context) target
+            type (OpenMM_Vec3Array) forces
+            type (OpenMM_IntArray) indices
+            integer*4 groups
+        end subroutine
         subroutine OpenMM_Platform_loadPluginsFromDirectory(directory, result)
             use OpenMM_Types; implicit none
             character(*) directory
@@ -2067,6 +2108,24 @@ OPENMM_EXPORT void openmm_context_getstate_2_(const OpenMM_Context*& target, int
 OPENMM_EXPORT void OPENMM_CONTEXT_GETSTATE_2(const OpenMM_Context*& target, int const& types, int const& enforcePeriodicBox, int const& groups, OpenMM_State*& result) {
     result = OpenMM_Context_getState_2(target, types, enforcePeriodicBox, groups);
 }
+OPENMM_EXPORT void openmm_context_getpositions_(const OpenMM_Context*& target, OpenMM_Vec3Array*& positions, const OpenMM_IntArray*& indices) {
+    OpenMM_Context_getPositions(target, positions, indices);
+}
+OPENMM_EXPORT void OPENMM_CONTEXT_GETPOSITIONS(const OpenMM_Context*& target, OpenMM_Vec3Array*& positions, const OpenMM_IntArray*& indices) {
+    OpenMM_Context_getPositions(target, positions, indices);
+}
+OPENMM_EXPORT void openmm_context_getvelocities_(const OpenMM_Context*& target, OpenMM_Vec3Array*& velocities, const OpenMM_IntArray*& indices) {
+    OpenMM_Context_getVelocities(target, velocities, indices);
+}
+OPENMM_EXPORT void OPENMM_CONTEXT_GETVELOCITIES(const OpenMM_Context*& target, OpenMM_Vec3Array*& velocities, const OpenMM_IntArray*& indices) {
+    OpenMM_Context_getVelocities(target, velocities, indices);
+}
+OPENMM_EXPORT void openmm_context_getforces_(const OpenMM_Context*& target, OpenMM_Vec3Array*& forces, const OpenMM_IntArray*& indices, int const& groups) {
+    OpenMM_Context_getForces(target, forces, indices, groups);
+}
+OPENMM_EXPORT void OPENMM_CONTEXT_GETFORCES(const OpenMM_Context*& target, OpenMM_Vec3Array*& forces, const OpenMM_IntArray*& indices, int const& groups) {
+    OpenMM_Context_getForces(target, forces, indices, groups);
+}
 OPENMM_EXPORT void openmm_platform_loadpluginsfromdirectory_(const char* directory, OpenMM_StringArray*& result, int length) {
     result = OpenMM_Platform_loadPluginsFromDirectory(makeString(directory, length).c_str());
 }
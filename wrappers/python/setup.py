@@ -232,13 +232,14 @@ def buildKeywordDictionary(major_version_num=MAJOR_VERSION_NUM,
     setupKeywords["ext_modules"] +=cythonize(Extension(
         "openmm.app.internal.xtc_utils",
         sources=[
-            "openmm/app/internal/xtc_utils/src/xdrfile_xtc.cpp",
-            "openmm/app/internal/xtc_utils/src/xdrfile.cpp",
+            "@CMAKE_SOURCE_DIR@/libraries/xdrfile/src/xdrfile_xtc.cpp",
+            "@CMAKE_SOURCE_DIR@/libraries/xdrfile/src/xdrfile.cpp",
             "openmm/app/internal/xtc_utils/src/xtc.cpp",
             "openmm/app/internal/xtc_utils/xtc.pyx",
         ],
         include_dirs=include_dirs +[
             "openmm/app/internal/xtc_utils/include",
+            "@CMAKE_SOURCE_DIR@/libraries/xdrfile/include",
             "openmm/app/internal/xtc_utils/",
             numpy.get_include(),
         ],
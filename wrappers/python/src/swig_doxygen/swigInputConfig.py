@@ -86,6 +86,15 @@ SKIP_METHODS = [('State', 'getPositions'),
                 ('Context',  'getIntegrator'),
                 ('Context',  'createCheckpoint'),
                 ('Context',  'loadCheckpoint'),
+                ('Context',  'getPositions'),
+                ('Context',  'getVelocities'),
+                ('Context',  'getForces'),
+                ('CheckpointWriter', 'writeCheckpoint'),
+                ('CheckpointWriter', 'loadCheckpoint'),
+                ('CheckpointWriter', 'CheckpointWriter', 1),
+                ('CheckpointWriter', 'operator='),
+                ('TrajectoryWriter', 'TrajectoryWriter', 1),
+                ('TrajectoryWriter', 'operator='),
                 ('CudaPlatform',),
                 ('Force',    'Force'),
                 ('ParticleParameterInfo',),
@@ -325,6 +334,8 @@ UNITS = {
 ("HippoNonbondedForce",                 "getInducedDipoles")                             :  ( None, ()),
 ("HippoNonbondedForce",                 "getLabFramePermanentDipoles")                   :  ( None, ()),
     
+("CheckpointWriter", "getTolerance") : (None, ()),
+("TrajectoryWriter", "getFormat") : (None, ()),
 ("Context", "getParameter") : (None, ()),
 ("Context", "getParameters") : (None, ()),
 ("Context", "getMolecules") : (None, ()),
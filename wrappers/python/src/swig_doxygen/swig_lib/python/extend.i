@@ -89,8 +89,85 @@
         state = _openmm.Context_getState(self, types, enforcePeriodicBox, groups_mask)
         return state
 
+    def getPositions(self, indices=None):
+        """Get the positions of particles as a numpy array.  Unlike getState(), this does not
+        create a State, which makes it a cheaper way to retrieve positions frequently, especially
+        when you only need them for some of the particles.  Positions are returned exactly as
+        stored in the Context, without translating molecules into the periodic box.
+
+        Parameters
+        ----------
+        indices : list=None
+            the indices of the particles to get.  If this is None, all particles are returned.
+            Otherwise row i is the position of particle indices[i].
+        """
+        return self._getParticleData(State.Positions, indices, -1)*unit.nanometers
+
+    def getVelocities(self, indices=None):
+        """Get the velocities of particles as a numpy array.  This is a cheaper alternative to
+        getState() for retrieving velocities frequently.  See getPositions() for details.
+
+        Parameters
+        ----------
+        indices : list=None
+            the indices of the particles to get.  If this is None, all particles are returned.
+            Otherwise row i is the velocity of particle indices[i].
+        """
+        return self._getParticleData(State.Velocities, indices, -1)*unit.nanometers/unit.picosecond
+
+    def getForces(self, indices=None, groups=-1):
+        """Compute the forces on particles and return them as a numpy array.  This is a cheaper
+        alternative to getState() for retrieving forces frequently.  See getPositions() for details.
+
+        Parameters
+        ----------
+        indices : list=None
+            the indices of the particles to get.  If this is None, all particles are returned.
+            Otherwise row i is the force on particle indices[i].
+        groups : set={0,1,2,...,31}
+            a set of indices for which force groups to include when computing forces.  This can
+            also be passed as an integer bitmask, as for getState().
+        """
+        try:
+            groups_mask = int(groups)
+        except TypeError:
+            if isinstance(groups, set):
+                groups_mask = functools.reduce(operator.or_,
+                        ((1<<x) & 0xffffffff for x in groups))
+            else:
+                raise TypeError('%s is neither an int nor set' % groups)
+        if groups_mask >= 0x80000000:
+            groups_mask -= 0x100000000
+        return self._getParticleData(State.Forces, indices, groups_mask)*unit.kilojoules_per_mole/unit.nanometer
+
+    def _getParticleData(self, type, indices, groups):
+        if indices is None:
+            indices = []
+            numParticles = self.getSystem().getNumParticles()
+        else:
+            indices = [int(i) for i in indices]
+            numParticles = len(indices)
+        output = numpy.empty([numParticles, 3], numpy.float64)
+        self._fillParticleData(type, indices, groups, output)
+        return output
   %}
 
+  void _fillParticleData(State::DataType type, const std::vector<int>& indices, int groups, PyObject* output) {
+      std::vector<Vec3> values;
+      if (type == State::Positions)
+          self->getPositions(values, indices);
+      else if (type == State::Velocities)
+          self->getVelocities(values, indices);
+      else if (type == State::Forces)
+          self->getForces(values, indices, groups);
+      else {
+        PyErr_SetString(PyExc_ValueError, "Illegal type specified in _fillParticleData");
+        return;
+      }
+      if (values.size() > 0)
+          memcpy(PyArray_DATA((PyArrayObject*) output), &values[0][0], 3*sizeof(double)*values.size());
+  }
+
   %feature("docstring") createCheckpoint "Create a checkpoint recording the current state of the Context.
 This should be treated as an opaque block of binary data.  See loadCheckpoint() for more details.
 
@@ -128,6 +205,33 @@ Parameters:
   }
 }
 
+%extend OpenMM::CheckpointWriter {
+  %feature("docstring") writeCheckpoint "Capture a checkpoint of the Context and begin writing it to a file in the background.
+The file is created or overwritten.  Call waitForCompletion() before reading it.
+
+Parameters:
+ - filename (string) the path of the file to write the checkpoint to
+
+Returns: True if a full checkpoint is being written, False if it is a delta checkpoint
+"
+  bool writeCheckpoint(std::string filename) {
+    return self->writeCheckpoint(filename);
+  }
+
+  %feature("docstring") loadCheckpoint "Load a delta checkpoint that was created by a CheckpointWriter.
+
+Parameters:
+ - context (Context) the Context to load the checkpoint into
+ - fullCheckpoint (bytes) the full checkpoint the delta checkpoint was created relative to
+ - deltaCheckpoint (bytes) the delta checkpoint
+"
+  static void loadCheckpoint(OpenMM::Context& context, std::string fullCheckpoint, std::string deltaCheckpoint) {
+    std::stringstream full(fullCheckpoint, std::ios_base::in | std::ios_base::binary);
+    std::stringstream delta(deltaCheckpoint, std::ios_base::in | std::ios_base::binary);
+    OpenMM::CheckpointWriter::loadCheckpoint(context, full, delta);
+  }
+}
+
 %extend OpenMM::Integrator {
   %pythoncode %{
     def setIntegrationForceGroups(self, groups):
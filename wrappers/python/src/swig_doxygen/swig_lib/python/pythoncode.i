@@ -28,6 +28,14 @@ from openmm.vec3 import Vec3
     self._integrator = args[1]
 %}
 
+%pythonappend OpenMM::CheckpointWriter::CheckpointWriter %{
+    self._context = args[0]
+%}
+
+%pythonappend OpenMM::TrajectoryWriter::TrajectoryWriter %{
+    self._context = args[0]
+%}
+
 %pythonprepend OpenMM::AmoebaAngleForce::addAngle %{
     try:
         length = args[3]
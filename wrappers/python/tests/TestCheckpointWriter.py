@@ -0,0 +1,39 @@
+import os
+import tempfile
+import unittest
+import openmm as mm
+
+
+class TestCheckpointWriter(unittest.TestCase):
+    def test_quantizedDelta(self):
+        system = mm.System()
+        for i in range(2):
+            system.addParticle(1.0)
+        integrator = mm.VerletIntegrator(0.001)
+        context = mm.Context(system, integrator, mm.Platform.getPlatform('Reference'))
+        context.setPositions([(0,0,0), (1,0,0)])
+        context.setVelocities([(0.1,0,0), (0,0.2,0)])
+        writer = mm.CheckpointWriter(context, 2, 1e-3)
+        self.assertEqual(2, writer.getFullCheckpointInterval())
+        self.assertEqual(1e-3, writer.getTolerance())
+        directory = tempfile.mkdtemp()
+        fullFile = os.path.join(directory, 'full.chk')
+        deltaFile = os.path.join(directory, 'delta.chk')
+        self.assertTrue(writer.writeCheckpoint(fullFile))
+        integrator.step(10)
+        expected = context.getState(getPositions=True).getPositions(asNumpy=True)._value
+        self.assertFalse(writer.writeCheckpoint(deltaFile))
+        writer.waitForCompletion()
+        integrator.step(10)
+        with open(fullFile, 'rb') as f:
+            full = f.read()
+        with open(deltaFile, 'rb') as f:
+            delta = f.read()
+        mm.CheckpointWriter.loadCheckpoint(context, full, delta)
+        self.assertEqual(10, context.getStepCount())
+        positions = context.getState(getPositions=True).getPositions(asNumpy=True)._value
+        self.assertTrue(abs(positions-expected).max() <= 1e-3)
+
+
+if __name__ == '__main__':
+    unittest.main()
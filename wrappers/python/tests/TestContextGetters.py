@@ -0,0 +1,39 @@
+import unittest
+import openmm as mm
+import openmm.unit as unit
+
+
+class TestContextGetters(unittest.TestCase):
+    def setUp(self):
+        system = mm.System()
+        force = mm.CustomExternalForce('x*x+2*y*y+3*z*z')
+        for i in range(4):
+            system.addParticle(1.0)
+            force.addParticle(i)
+        system.addForce(force)
+        self.integrator = mm.VerletIntegrator(0.001)
+        self.context = mm.Context(system, self.integrator, mm.Platform.getPlatform('Reference'))
+        self.context.setPositions([(i, 0.5*i, 0.1*i) for i in range(4)])
+        self.context.setVelocities([(0, i, 0) for i in range(4)])
+
+    def test_allParticles(self):
+        state = self.context.getState(getPositions=True, getVelocities=True, getForces=True)
+        self.assertEqual((4, 3), self.context.getPositions().shape)
+        self.assertTrue(abs(self.context.getPositions().value_in_unit(unit.nanometers)-state.getPositions(asNumpy=True).value_in_unit(unit.nanometers)).max() < 1e-10)
+        self.assertTrue(abs(self.context.getVelocities().value_in_unit(unit.nanometers/unit.picosecond)-state.getVelocities(asNumpy=True).value_in_unit(unit.nanometers/unit.picosecond)).max() < 1e-10)
+        self.assertTrue(abs(self.context.getForces().value_in_unit(unit.kilojoules_per_mole/unit.nanometer)-state.getForces(asNumpy=True).value_in_unit(unit.kilojoules_per_mole/unit.nanometer)).max() < 1e-10)
+
+    def test_subset(self):
+        positions = self.context.getPositions([3, 1]).value_in_unit(unit.nanometers)
+        self.assertEqual((2, 3), positions.shape)
+        self.assertEqual([3, 1.5, 0.3], list(positions[0]))
+        self.assertEqual([1, 0.5, 0.1], list(positions[1]))
+        velocities = self.context.getVelocities([2]).value_in_unit(unit.nanometers/unit.picosecond)
+        self.assertEqual([0, 2, 0], list(velocities[0]))
+        forces = self.context.getForces([1], groups={0}).value_in_unit(unit.kilojoules_per_mole/unit.nanometer)
+        self.assertTrue(abs(forces[0]-[-2, -2, -0.6]).max() < 1e-10)
+        self.assertRaises(Exception, lambda: self.context.getPositions([4]))
+
+
+if __name__ == '__main__':
+    unittest.main()
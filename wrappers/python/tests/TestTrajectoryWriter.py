@@ -0,0 +1,40 @@
+import os
+import tempfile
+import unittest
+import openmm as mm
+
+
+class TestTrajectoryWriter(unittest.TestCase):
+    def test_writeDcd(self):
+        system = mm.System()
+        for i in range(3):
+            system.addParticle(1.0)
+        integrator = mm.VerletIntegrator(0.001)
+        context = mm.Context(system, integrator, mm.Platform.getPlatform('Reference'))
+        context.setPositions([(0,0,0), (1,0,0), (0,1,0)])
+        context.setVelocities([(0.1,0,0), (0,0.2,0), (0,0,0.3)])
+        filename = os.path.join(tempfile.mkdtemp(), 'traj.dcd')
+        writer = mm.TrajectoryWriter(context, filename, mm.TrajectoryWriter.DCD, 2, [0, 2])
+        self.assertEqual(mm.TrajectoryWriter.DCD, writer.getFormat())
+        self.assertEqual(2, writer.getInterval())
+        integrator.step(10)
+        writer.flush()
+        self.assertEqual(5, writer.getNumFrames())
+        self.assertTrue(os.path.getsize(filename) > 0)
+
+    def test_keepsContextAlive(self):
+        system = mm.System()
+        system.addParticle(1.0)
+        integrator = mm.VerletIntegrator(0.001)
+        context = mm.Context(system, integrator, mm.Platform.getPlatform('Reference'))
+        context.setPositions([(0,0,0)])
+        filename = os.path.join(tempfile.mkdtemp(), 'traj.xtc')
+        writer = mm.TrajectoryWriter(context, filename, mm.TrajectoryWriter.XTC, 1)
+        del context
+        integrator.step(3)
+        writer.flush()
+        self.assertEqual(3, writer.getNumFrames())
+
+
+if __name__ == '__main__':
+    unittest.main()